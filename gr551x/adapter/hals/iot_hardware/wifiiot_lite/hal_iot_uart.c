@@ -13,14 +13,35 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
 #include "iot_errno.h"
 #include "iot_uart.h"
+#include "hal_iot_uart_ext.h"
 #include "app_uart.h"
 #include "app_io.h"
 #include "los_sem.h"
+#include "los_tick.h"
+#include "hdf_base.h"
+#include "device_resource_if.h"
 
 #define UART_TIMEOUT     1000
 
+/* Received data is kept in a per-UART ring between IoTUartRead calls. Both rings are allocated by
+ * IoTUartInit and freed by IoTUartDeinit, so a port that is never opened costs no RAM. */
+#ifndef UART_RX_RING_SIZE
+#define UART_RX_RING_SIZE       1024
+#endif
+
+/* Asynchronous writes are queued here until the UART takes them. */
+#ifndef UART_TX_RING_SIZE
+#define UART_TX_RING_SIZE       1024
+#endif
+
+/* Ticks IoTUartRead waits for data when the ring is empty; it returns 0 on expiry. */
+#ifndef UART_READ_TIMEOUT
+#define UART_READ_TIMEOUT       LOS_WAIT_FOREVER
+#endif
+
 static void app_uart0_callback(app_uart_evt_t *p_evt);
 static void app_uart1_callback(app_uart_evt_t *p_evt);
 
@@ -76,34 +97,84 @@ static app_uart_params_t uart_param[APP_UART_ID_MAX] = {
 static uint32_t uart_rx_sem[APP_UART_ID_MAX];
 static uint32_t uart_tx_mutex[APP_UART_ID_MAX];
 static uint32_t uart_rx_mutex[APP_UART_ID_MAX];
-static uint32_t g_rx_num[APP_UART_ID_MAX];
-
-static const app_uart_evt_handler_t *evt_handler[APP_UART_ID_MAX] = {
+static uint8_t *uart_rx_ring[APP_UART_ID_MAX];
+static uint8_t *uart_tx_ring[APP_UART_ID_MAX];
+static uint32_t uart_tx_sem[APP_UART_ID_MAX];
+static IotUartWriteMode uart_write_mode[APP_UART_ID_MAX];
+static IotUartDrainCallback uart_drain_cb[APP_UART_ID_MAX];
+static void *uart_drain_arg[APP_UART_ID_MAX];
+static bool uart_tx_queued[APP_UART_ID_MAX];
+static IotUartWriteStats uart_write_stats[APP_UART_ID_MAX];
+
+static const app_uart_evt_handler_t evt_handler[APP_UART_ID_MAX] = {
     app_uart0_callback,
     app_uart1_callback
 };
 
+static const char *uart_match_attr[APP_UART_ID_MAX] = {
+    "goodix_gr55xx_uart_0",
+    "goodix_gr55xx_uart_1"
+};
+
+/* FIFO thresholds and RX event batching, from uart_config.hcs when it sets them. */
+static void uart_irq_cfg(unsigned int id)
+{
+    app_uart_irq_cfg_t cfg = {
+        .rx_fifo_threshold = LL_UART_RX_FIFO_TH_HALF_FULL,
+        .tx_fifo_threshold = LL_UART_TX_FIFO_TH_EMPTY,
+        .rx_block = 0,
+    };
+    struct DeviceResourceIface *iface = DeviceResourceGetIfaceInstance(HDF_CONFIG_SOURCE);
+    const struct DeviceResourceNode *node = NULL;
+    uint32_t block = 0;
+
+    if (iface != NULL && iface->GetRootNode != NULL && iface->GetNodeByMatchAttr != NULL) {
+        node = iface->GetNodeByMatchAttr(iface->GetRootNode(), uart_match_attr[id]);
+    }
+    if (node != NULL) {
+        (void)iface->GetUint32(node, "rx_fifo_threshold", &cfg.rx_fifo_threshold, cfg.rx_fifo_threshold);
+        (void)iface->GetUint32(node, "tx_fifo_threshold", &cfg.tx_fifo_threshold, cfg.tx_fifo_threshold);
+        (void)iface->GetUint32(node, "rx_block", &block, 0);
+        cfg.rx_block = (block > UART_RX_RING_SIZE / 2) ? UART_RX_RING_SIZE / 2 : (uint16_t)block;
+    }
+    (void)app_uart_irq_config(id, &cfg);
+}
+
+/* The ring only counts as drained when IoTUartWrite queued something since the last drain: the
+ * completions of other transfers on the UART are not reported. */
+static void uart_tx_drained(unsigned int id, bool drained)
+{
+    LOS_SemPost(uart_tx_sem[id]);
+    if (drained && uart_tx_queued[id]) {
+        uart_tx_queued[id] = false;
+        uart_write_stats[id].drains++;
+        if (uart_drain_cb[id] != NULL) {
+            uart_drain_cb[id](id, uart_drain_arg[id]);
+        }
+    }
+}
+
 static void app_uart0_callback(app_uart_evt_t *p_evt)
 {
-    if (p_evt->type == APP_UART_EVT_RX_DATA) {
-        g_rx_num[APP_UART_ID_0] = p_evt->data.size;
-        LOS_SemPost(uart_rx_sem[APP_UART_ID_0]);
-    } else if (p_evt->type == APP_UART_EVT_ERROR) {
+    if (p_evt->type == APP_UART_EVT_RX_DATA || p_evt->type == APP_UART_EVT_ERROR) {
         LOS_SemPost(uart_rx_sem[APP_UART_ID_0]);
     }
+    if (p_evt->type == APP_UART_EVT_TX_CPLT || p_evt->type == APP_UART_EVT_ERROR) {
+        uart_tx_drained(APP_UART_ID_0, p_evt->type == APP_UART_EVT_TX_CPLT);
+    }
 }
 
 static void app_uart1_callback(app_uart_evt_t *p_evt)
 {
-    if (p_evt->type == APP_UART_EVT_RX_DATA) {
-        g_rx_num[APP_UART_ID_1] = p_evt->data.size;
-        LOS_SemPost(uart_rx_sem[APP_UART_ID_1]);
-    } else if (p_evt->type == APP_UART_EVT_ERROR) {
+    if (p_evt->type == APP_UART_EVT_RX_DATA || p_evt->type == APP_UART_EVT_ERROR) {
         LOS_SemPost(uart_rx_sem[APP_UART_ID_1]);
     }
+    if (p_evt->type == APP_UART_EVT_TX_CPLT || p_evt->type == APP_UART_EVT_ERROR) {
+        uart_tx_drained(APP_UART_ID_1, p_evt->type == APP_UART_EVT_TX_CPLT);
+    }
 }
 
-struct app_uart_params_t* uart_cfg(unsigned int id, const IotUartAttribute *param)
+app_uart_params_t *uart_cfg(unsigned int id, const IotUartAttribute *param)
 {
     app_uart_params_t *params = &uart_param[id];
     params->init.baud_rate = param->baudRate;
@@ -142,6 +213,14 @@ struct app_uart_params_t* uart_cfg(unsigned int id, const IotUartAttribute *para
     return params;
 }
 
+static void uart_ring_free(unsigned int id)
+{
+    free(uart_rx_ring[id]);
+    free(uart_tx_ring[id]);
+    uart_rx_ring[id] = NULL;
+    uart_tx_ring[id] = NULL;
+}
+
 unsigned int IoTUartInit(unsigned int id, const IotUartAttribute *param)
 {
     app_uart_tx_buf_t uart_buffer;
@@ -149,9 +228,6 @@ unsigned int IoTUartInit(unsigned int id, const IotUartAttribute *param)
     int ret = 0;
     uint32_t uwRet = 0;
 
-    uart_buffer.tx_buf       = NULL;
-    uart_buffer.tx_buf_size  = 0;
-
     if (param == NULL) {
         return IOT_FAILURE;
     }
@@ -159,28 +235,69 @@ unsigned int IoTUartInit(unsigned int id, const IotUartAttribute *param)
     if (id >= APP_UART_ID_MAX) {
         return IOT_FAILURE;
     }
+
+    if (uart_tx_ring[id] == NULL) {
+        uart_rx_ring[id] = malloc(UART_RX_RING_SIZE);
+        uart_tx_ring[id] = malloc(UART_TX_RING_SIZE);
+        if (uart_rx_ring[id] == NULL || uart_tx_ring[id] == NULL) {
+            uart_ring_free(id);
+            return IOT_FAILURE;
+        }
+    }
+
+    uart_buffer.tx_buf       = uart_tx_ring[id];
+    uart_buffer.tx_buf_size  = UART_TX_RING_SIZE;
     params = uart_cfg(id, param);
+    uart_irq_cfg(id);
 
     ret = app_uart_init(params, evt_handler[id], &uart_buffer);
     if (ret != 0) {
+        uart_ring_free(id);
         return IOT_FAILURE;
     }
 
     uwRet = LOS_BinarySemCreate(0, &uart_rx_sem[id]);
     if (uwRet != LOS_OK) {
+        app_uart_deinit(id);
+        uart_ring_free(id);
+        return IOT_FAILURE;
+    }
+
+    uwRet = LOS_BinarySemCreate(0, &uart_tx_sem[id]);
+    if (uwRet != LOS_OK) {
+        app_uart_deinit(id);
+        LOS_SemDelete(uart_rx_sem[id]);
+        uart_ring_free(id);
         return IOT_FAILURE;
     }
 
     uwRet = LOS_MuxCreate(&uart_tx_mutex[id]);
     if (uwRet != LOS_OK) {
-        LOS_SemDelete(&uart_rx_sem[id]);
+        app_uart_deinit(id);
+        LOS_SemDelete(uart_rx_sem[id]);
+        LOS_SemDelete(uart_tx_sem[id]);
+        uart_ring_free(id);
         return IOT_FAILURE;
     }
 
     uwRet = LOS_MuxCreate(&uart_rx_mutex[id]);
     if (uwRet != LOS_OK) {
+        app_uart_deinit(id);
         LOS_SemDelete(uart_rx_sem[id]);
-        LOS_SemDelete(uart_tx_mutex[id]);
+        LOS_SemDelete(uart_tx_sem[id]);
+        LOS_MuxDelete(uart_tx_mutex[id]);
+        uart_ring_free(id);
+        return IOT_FAILURE;
+    }
+
+    ret = app_uart_receive_ring_start(id, uart_rx_ring[id], UART_RX_RING_SIZE);
+    if (ret != 0) {
+        app_uart_deinit(id);
+        LOS_SemDelete(uart_rx_sem[id]);
+        LOS_SemDelete(uart_tx_sem[id]);
+        LOS_MuxDelete(uart_tx_mutex[id]);
+        LOS_MuxDelete(uart_rx_mutex[id]);
+        uart_ring_free(id);
         return IOT_FAILURE;
     }
 
@@ -189,36 +306,118 @@ unsigned int IoTUartInit(unsigned int id, const IotUartAttribute *param)
 
 int IoTUartRead(unsigned int id, unsigned char *data, unsigned int dataLen)
 {
-    int ret = 0;
-    uint32_t uwRet = 0;
-
-    LOS_MuxPend(uart_rx_mutex[id], LOS_WAIT_FOREVER);
+    uint32_t len;
+    uint32_t uwRet;
 
-    g_rx_num[id] = 0;
-    LOS_SemPend(uart_rx_sem[id], 0);
-    ret = app_uart_receive_async(id, data, dataLen);
-    if (ret != 0) {
-        LOS_MuxPost(uart_rx_mutex[id]);
+    if (id >= APP_UART_ID_MAX || data == NULL) {
         return IOT_FAILURE;
     }
 
-    uwRet = LOS_SemPend(uart_rx_sem[id], LOS_WAIT_FOREVER);
-    if (uwRet != LOS_OK)  {
-        LOS_MuxPost(uart_rx_mutex[id]);
-        return IOT_FAILURE;
+    LOS_MuxPend(uart_rx_mutex[id], LOS_WAIT_FOREVER);
+
+    /* The semaphore is posted for every block published to the ring, so a post that raced
+     * with the previous read only costs one more pass. */
+    len = app_uart_receive_ring_read(id, data, dataLen);
+    while (len == 0) {
+        uwRet = LOS_SemPend(uart_rx_sem[id], UART_READ_TIMEOUT);
+        len = app_uart_receive_ring_read(id, data, dataLen);
+        if (uwRet != LOS_OK) {
+            break;
+        }
     }
 
     LOS_MuxPost(uart_rx_mutex[id]);
 
-    return g_rx_num[id];
+    return len;
+}
+
+/* Wait for the transmit ring to drain or make room. LOS_OK if woken before the deadline. */
+static uint32_t uart_tx_pend(unsigned int id, UINT64 deadline)
+{
+    UINT64 now;
+
+    if (deadline == (UINT64)-1) {
+        return LOS_SemPend(uart_tx_sem[id], LOS_WAIT_FOREVER);
+    }
+    now = LOS_TickCountGet();
+    if (now >= deadline) {
+        return LOS_ERRNO_SEM_TIMEOUT;
+    }
+    return LOS_SemPend(uart_tx_sem[id], (UINT32)(deadline - now));
+}
+
+static int uart_write_async(unsigned int id, const unsigned char *data, unsigned int dataLen)
+{
+    IotUartWriteStats *stats = &uart_write_stats[id];
+    UINT64 start = LOS_TickCountGet();
+    UINT64 deadline = start + LOS_MS2Tick(UART_TIMEOUT);
+    uint32_t space;
+    uint32_t queued;
+    uint32_t len;
+    uint32_t ms;
+    uint16_t err;
+    bool blocked = false;
+
+    while (dataLen != 0) {
+        space = app_uart_transmit_space_get(id);
+        if (space != 0) {
+            len = (dataLen > space) ? space : dataLen;
+            /* Marked together with the queueing, so the completion of these bytes cannot miss it. */
+            GLOBAL_EXCEPTION_DISABLE();
+            err = app_uart_transmit_async(id, (uint8_t *)data, len);
+            uart_tx_queued[id] = true;
+            GLOBAL_EXCEPTION_ENABLE();
+            if (err != 0) {
+                return IOT_FAILURE;
+            }
+            data += len;
+            dataLen -= len;
+            stats->bytes += len;
+            queued = UART_TX_RING_SIZE - 1 - app_uart_transmit_space_get(id);
+            if (queued > stats->queuedMax) {
+                stats->queuedMax = queued;
+            }
+            continue;
+        }
+
+        /* Ring full: it only empties while a transfer is running. */
+        if (!app_uart_transmit_busy(id)) {
+            return IOT_FAILURE;
+        }
+        blocked = true;
+        if (uart_tx_pend(id, deadline) != LOS_OK) {
+            stats->timeouts++;
+            return IOT_FAILURE;
+        }
+    }
+
+    stats->writes++;
+    if (blocked) {
+        stats->blocked++;
+        ms = LOS_Tick2MS((UINT32)(LOS_TickCountGet() - start));
+        if (ms > stats->blockedMsMax) {
+            stats->blockedMsMax = ms;
+        }
+    }
+
+    return IOT_SUCCESS;
 }
 
 int IoTUartWrite(unsigned int id, const unsigned char *data, unsigned int dataLen)
 {
     int ret = 0;
 
+    if (id >= APP_UART_ID_MAX || data == NULL) {
+        return IOT_FAILURE;
+    }
+
     LOS_MuxPend(uart_tx_mutex[id], LOS_WAIT_FOREVER);
-    ret = app_uart_transmit_sync(id, data, dataLen, UART_TIMEOUT);
+    if (uart_write_mode[id] == IOT_UART_WRITE_ASYNC) {
+        ret = uart_write_async(id, data, dataLen);
+        LOS_MuxPost(uart_tx_mutex[id]);
+        return ret;
+    }
+    ret = app_uart_transmit_sync(id, (uint8_t *)data, dataLen, UART_TIMEOUT);
     if (ret != 0) {
         LOS_MuxPost(uart_tx_mutex[id]);
         return IOT_FAILURE;
@@ -228,12 +427,96 @@ int IoTUartWrite(unsigned int id, const unsigned char *data, unsigned int dataLe
     return IOT_SUCCESS;
 }
 
+static unsigned int uart_flush(unsigned int id, unsigned int timeoutMs)
+{
+    UINT64 deadline = (UINT64)-1;
+
+    if (timeoutMs != IOT_UART_WAIT_FOREVER) {
+        deadline = LOS_TickCountGet() + LOS_MS2Tick(timeoutMs);
+    }
+
+    /* A completion that raced with the check leaves the semaphore posted, so re-check after each wake. */
+    while (app_uart_transmit_busy(id)) {
+        if (uart_tx_pend(id, deadline) != LOS_OK && app_uart_transmit_busy(id)) {
+            return IOT_FAILURE;
+        }
+    }
+
+    return IOT_SUCCESS;
+}
+
+unsigned int IoTUartFlush(unsigned int id, unsigned int timeoutMs)
+{
+    unsigned int ret;
+
+    if (id >= APP_UART_ID_MAX) {
+        return IOT_FAILURE;
+    }
+
+    LOS_MuxPend(uart_tx_mutex[id], LOS_WAIT_FOREVER);
+    ret = uart_flush(id, timeoutMs);
+    LOS_MuxPost(uart_tx_mutex[id]);
+
+    return ret;
+}
+
+unsigned int IoTUartSetWriteMode(unsigned int id, IotUartWriteMode mode)
+{
+    unsigned int ret = IOT_SUCCESS;
+
+    if (id >= APP_UART_ID_MAX || (mode != IOT_UART_WRITE_SYNC && mode != IOT_UART_WRITE_ASYNC)) {
+        return IOT_FAILURE;
+    }
+
+    LOS_MuxPend(uart_tx_mutex[id], LOS_WAIT_FOREVER);
+    if (mode == IOT_UART_WRITE_SYNC) {
+        ret = uart_flush(id, UART_TIMEOUT);
+    }
+    if (ret == IOT_SUCCESS) {
+        uart_write_mode[id] = mode;
+    }
+    LOS_MuxPost(uart_tx_mutex[id]);
+
+    return ret;
+}
+
+unsigned int IoTUartSetDrainCallback(unsigned int id, IotUartDrainCallback cb, void *arg)
+{
+    if (id >= APP_UART_ID_MAX) {
+        return IOT_FAILURE;
+    }
+
+    uart_drain_cb[id] = NULL;
+    uart_drain_arg[id] = arg;
+    uart_drain_cb[id] = cb;
+
+    return IOT_SUCCESS;
+}
+
+unsigned int IoTUartWriteStatsGet(unsigned int id, IotUartWriteStats *stats)
+{
+    if (id >= APP_UART_ID_MAX || stats == NULL) {
+        return IOT_FAILURE;
+    }
+
+    *stats = uart_write_stats[id];
+
+    return IOT_SUCCESS;
+}
+
 unsigned int IoTUartDeinit(unsigned int id)
 {
+    if (id >= APP_UART_ID_MAX) {
+        return IOT_FAILURE;
+    }
+
     app_uart_deinit(id);
     LOS_SemDelete(uart_rx_sem[id]);
-    LOS_SemDelete(uart_tx_mutex[id]);
-    LOS_SemDelete(uart_rx_mutex[id]);
+    LOS_SemDelete(uart_tx_sem[id]);
+    LOS_MuxDelete(uart_tx_mutex[id]);
+    LOS_MuxDelete(uart_rx_mutex[id]);
+    uart_tx_queued[id] = false;
+    uart_ring_free(id);
 
     return IOT_SUCCESS;
 }
@@ -242,13 +525,14 @@ unsigned int IoTUartSetFlowCtrl(unsigned int id, IotFlowCtrl flowCtrl)
 {
     int ret = 0;
     app_uart_tx_buf_t uart_buffer;
-    uart_buffer.tx_buf       = NULL;
-    uart_buffer.tx_buf_size  = 0;
 
-    if (id >= APP_UART_ID_MAX) {
+    if (id >= APP_UART_ID_MAX || uart_tx_ring[id] == NULL) {
         return IOT_FAILURE;
     }
 
+    uart_buffer.tx_buf       = uart_tx_ring[id];
+    uart_buffer.tx_buf_size  = UART_TX_RING_SIZE;
+
     app_uart_params_t *params = &uart_param[id];
     switch (flowCtrl) {
         case IOT_FLOW_CTRL_NONE:
@@ -265,8 +549,17 @@ unsigned int IoTUartSetFlowCtrl(unsigned int id, IotFlowCtrl flowCtrl)
             break;
     }
 
+    /* Queued data would be dropped by the re-initialization. */
+    LOS_MuxPend(uart_tx_mutex[id], LOS_WAIT_FOREVER);
+    (void)uart_flush(id, UART_TIMEOUT);
     app_uart_deinit(params->id);
     ret = app_uart_init(params, evt_handler[id], &uart_buffer);
+    LOS_MuxPost(uart_tx_mutex[id]);
+    if (ret != 0) {
+        return IOT_FAILURE;
+    }
+
+    ret = app_uart_receive_ring_start(id, uart_rx_ring[id], UART_RX_RING_SIZE);
     if (ret != 0) {
         return IOT_FAILURE;
     }
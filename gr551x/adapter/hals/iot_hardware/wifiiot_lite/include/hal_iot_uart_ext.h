@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HAL_IOT_UART_EXT_H__
+#define __HAL_IOT_UART_EXT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * gr551x extensions to the OHOS IoT UART API (iot_uart.h).
+ */
+
+#define IOT_UART_WAIT_FOREVER   0xFFFFFFFF
+
+typedef enum {
+    IOT_UART_WRITE_SYNC,    /* IoTUartWrite returns once the data has been sent (default) */
+    IOT_UART_WRITE_ASYNC,   /* IoTUartWrite queues the data in the transmit ring and returns */
+} IotUartWriteMode;
+
+/*
+ * Select the IoTUartWrite mode. In asynchronous mode a write only waits when the transmit ring
+ * is full, for at most the write timeout, and fails if the data could not all be queued by then.
+ * Switching back to synchronous mode flushes the ring first.
+ */
+unsigned int IoTUartSetWriteMode(unsigned int id, IotUartWriteMode mode);
+
+/* Wait until the queued data has been handed to the UART. IOT_FAILURE on timeout. */
+unsigned int IoTUartFlush(unsigned int id, unsigned int timeoutMs);
+
+/* Called from the UART interrupt each time the data queued by IoTUartWrite has all been handed to
+ * the UART; transfers on the UART that did not come through IoTUartWrite do not call it. NULL to
+ * remove. */
+typedef void (*IotUartDrainCallback)(unsigned int id, void *arg);
+
+unsigned int IoTUartSetDrainCallback(unsigned int id, IotUartDrainCallback cb, void *arg);
+
+typedef struct {
+    unsigned int writes;        /* asynchronous writes */
+    unsigned int bytes;         /* bytes queued by them */
+    unsigned int blocked;       /* writes that had to wait for room in the ring */
+    unsigned int blockedMsMax;  /* longest such wait */
+    unsigned int timeouts;      /* writes that gave up waiting */
+    unsigned int queuedMax;     /* most bytes held in the ring */
+    unsigned int drains;        /* times the ring ran empty */
+} IotUartWriteStats;
+
+unsigned int IoTUartWriteStatsGet(unsigned int id, IotUartWriteStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
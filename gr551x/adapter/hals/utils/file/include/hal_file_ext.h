@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HAL_FILE_EXT_H__
+#define __HAL_FILE_EXT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * gr551x extensions to the OHOS file HAL (utils/native/lite/hals/file/hal_file.h).
+ * Paths are relative to the /data partition, as for HalFileOpen.
+ */
+
+/*
+ * Write back data buffered for fd and commit the file to flash. Buffered data is also written back
+ * by HalFileSeek and HalFileClose.
+ */
+int HalFileFlush(int fd);
+
+/*
+ * Positional read/write of len bytes at offset, which must not lie beyond the end of the file.
+ * The file position is left just past the transferred data. The file size is cached per descriptor
+ * when the file is opened, so these and HalFileSeek do not query the file system; writes made
+ * through another descriptor of the same file are not seen until it is reopened.
+ */
+int HalFileReadAt(int fd, unsigned int offset, char *buf, unsigned int len);
+int HalFileWriteAt(int fd, unsigned int offset, const char *buf, unsigned int len);
+
+/*
+ * Map a file read-only. On success *addr points at the memory-mapped flash holding the byte at
+ * offset and *len is the number of bytes readable from there, which may be less than the rest of
+ * the file since littlefs stores data in blocks. The mapping stays valid until the file is written
+ * or deleted. Only available on unencrypted flash.
+ */
+int HalFileMap(const char *path, unsigned int offset, const void **addr, unsigned int *len);
+
+typedef struct {
+    unsigned int pathAllocAvoided;  /* path buffers built on the stack instead of the heap */
+    unsigned int bufAllocAvoided;   /* opens that reused the buffer a closed descriptor left in its slot */
+    unsigned int fdScanAvoided;     /* table slots a first-fit search would have examined, the bitmap looks at none */
+} HalFileStats;
+
+/* Copy the hal_file counters. Returns -1 unless built with HAL_FILE_STATS_ENABLE=1. */
+int HalFileStatsGet(HalFileStats *stats);
+
+/*
+ * Asynchronous writes. Requests are queued and executed in order by a background task, so callers
+ * such as BLE or UART callbacks do not block on flash erase and program. buf must stay valid until
+ * the request completes. The callback runs in the background task with the HalFileWrite or
+ * HalFileFlush result. Do not mix synchronous calls on an fd that has requests pending; use
+ * HalFileAsyncBarrier first. HalFileClose waits for the requests pending on its fd. Submission
+ * returns a request id > 0, or -1 when the queue is full, fd is out of range or HalFileAsyncInit
+ * has not been called. Not callable from interrupts.
+ */
+#define HAL_FILE_WAIT_FOREVER   0xFFFFFFFF
+
+typedef void (*HalFileAsyncCallback)(int fd, int result, void *arg);
+
+typedef struct {
+    unsigned int submitted;
+    unsigned int completed;
+    unsigned int failed;
+    unsigned int rejected;          /* submissions refused because the queue was full */
+    unsigned int depth;             /* requests queued or in progress */
+    unsigned int maxDepth;
+    unsigned int latencyMaxMs;      /* submission to completion */
+    unsigned long long latencyTotalMs;
+} HalFileAsyncStats;
+
+int HalFileAsyncInit(void);
+int HalFileWriteAsync(int fd, const char *buf, unsigned int len, HalFileAsyncCallback cb, void *arg);
+int HalFileSyncAsync(int fd, HalFileAsyncCallback cb, void *arg);
+
+/* Wait until request id, or every request submitted so far, has completed. 0 on success, -1 on timeout. */
+int HalFileAsyncWait(int id, unsigned int timeoutMs);
+int HalFileAsyncBarrier(unsigned int timeoutMs);
+
+/*
+ * Wait until every request queued on fd has completed; HalFileClose calls this first. From an async
+ * callback it cannot wait and returns -1 if later requests on fd are still queued, so the close fails.
+ */
+int HalFileAsyncDrain(int fd, unsigned int timeoutMs);
+
+/* Returns -1 unless built with HAL_FILE_STATS_ENABLE=1. */
+int HalFileAsyncStatsGet(HalFileAsyncStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,41 +17,301 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include "utils_file.h"
 #include "log.h"
+#include "securec.h"
 #include "hal_file.h"
+#include "hal_file_ext.h"
+#include "littlefs.h"
+#include "los_mux.h"
+#include "los_task.h"
 
 #define LOG_E(fmt, ...)  HILOG_ERROR(HILOG_MODULE_APP, fmt, ##__VA_ARGS__)
 #define LOG_I(fmt, ...)  HILOG_INFO(HILOG_MODULE_APP, fmt, ##__VA_ARGS__)
 
-#define ROOT_LEN         2
+/* Longest path accepted from callers, excluding the "/data/" prefix. */
+#ifndef MAX_PATH_LEN
 #define MAX_PATH_LEN     40
+#endif
 #define MaxOpenFile      32
 #define ROOT_PATH        "/data"
+#define FILE_PATH_LEN    (sizeof(ROOT_PATH) + MAX_PATH_LEN)
+
+/* Count heap allocations and table scans saved, read with HalFileStatsGet. */
+#ifndef HAL_FILE_STATS_ENABLE
+#define HAL_FILE_STATS_ENABLE   0
+#endif
+
+#if (HAL_FILE_STATS_ENABLE == 1)
+#define FILE_STATS_INC(field)       (g_fileStats.field++)
+#define FILE_STATS_ADD(field, n)    (g_fileStats.field += (n))
+#else
+#define FILE_STATS_INC(field)
+#define FILE_STATS_ADD(field, n)
+#endif
+
+/* Per-descriptor read-ahead/write-behind buffer, 0 passes every call straight to the file system. */
+#ifndef HAL_FILE_BUF_SIZE
+#define HAL_FILE_BUF_SIZE   256
+#endif
+
+#define BUF_MODE_NONE    0
+#define BUF_MODE_READ    1
+#define BUF_MODE_WRITE   2
 
 typedef struct _File_Context {
     int fs_fd;
     unsigned char fd;
+    unsigned char append;
+    unsigned char accmode;      /* O_RDONLY, O_WRONLY or O_RDWR */
+    unsigned int pos;           /* caller's file position */
+    unsigned int size;          /* file size, read once at open and kept up to date by writes */
+#if (HAL_FILE_BUF_SIZE > 0)
+    unsigned char buf_mode;
+    unsigned short buf_len;     /* valid bytes in buf */
+    unsigned short buf_pos;     /* read cursor in buf */
+    char *buf;
+#endif
 } File_Context;
 
 static File_Context File[MaxOpenFile] = { 0 };
+/* Bit n set means descriptor n + 1 is in use. */
+static uint32_t g_fileUsedMap = 0;
+/* Guards the table and the slot buffers, which the async worker uses too. Created on first use. */
+static UINT32 g_fileMux;
+static bool g_fileMuxReady = false;
+#if (HAL_FILE_STATS_ENABLE == 1)
+static HalFileStats g_fileStats = { 0 };
+#endif
+
+typedef char FileUsedMapCheck[((MaxOpenFile >= 1) && (MaxOpenFile <= 32)) ? 1 : -1];
+
+/* One bit per descriptor, shifted right so that no shift reaches the width of the type. */
+#define FILE_SLOT_MASK   (0xFFFFFFFFUL >> (32 - MaxOpenFile))
+
+static int FileLock(void)
+{
+    if (!g_fileMuxReady) {
+        LOS_TaskLock();
+        if (!g_fileMuxReady && (LOS_MuxCreate(&g_fileMux) == LOS_OK)) {
+            g_fileMuxReady = true;
+        }
+        LOS_TaskUnlock();
+        if (!g_fileMuxReady) {
+            LOG_E("create file table mutex failed!\n");
+            return -1;
+        }
+    }
+
+    return (LOS_MuxPend(g_fileMux, LOS_WAIT_FOREVER) == LOS_OK) ? 0 : -1;
+}
+
+static void FileUnlock(void)
+{
+    (void)LOS_MuxPost(g_fileMux);
+}
+
+/* The context of an open descriptor, NULL if fd is out of range or not in use. */
+static File_Context *FileGet(int fd)
+{
+    if ((fd > MaxOpenFile) || (fd <= 0) || (File[fd - 1].fd == 0)) {
+        return NULL;
+    }
+
+    return &File[fd - 1];
+}
 
 int Find_Free_Num(void)
 {
-    int i = MaxOpenFile;
-    for (; i > 0; i--) {
-        if (File[i - 1].fd == 0) {
-            break;
+    uint32_t free_map = ~g_fileUsedMap & FILE_SLOT_MASK;
+
+    if (free_map == 0) {
+        return 0;
+    }
+
+    return __builtin_ctz(free_map) + 1;
+}
+
+/* Build "/data/<path>" in a caller supplied FILE_PATH_LEN buffer. */
+static int BuildPath(char *file_path, const char *path)
+{
+    if (strlen(path) >= MAX_PATH_LEN) {
+        LOG_E("path name is too long!!!\n");
+        return -1;
+    }
+
+    if (strcpy_s(file_path, FILE_PATH_LEN, ROOT_PATH) != 0) {
+        return -1;
+    }
+    if (strcat_s(file_path, FILE_PATH_LEN, "/") != 0) {
+        return -1;
+    }
+    if (strcat_s(file_path, FILE_PATH_LEN, path) != 0) {
+        return -1;
+    }
+    FILE_STATS_INC(pathAllocAvoided);
+
+    return 0;
+}
+
+
+#if (HAL_FILE_BUF_SIZE > 0)
+/* Write back pending data, or give back read-ahead data so the fs offset matches the caller's view. */
+static int BufSync(File_Context *file)
+{
+    int ret = 0;
+
+    if (file->buf_mode == BUF_MODE_WRITE && file->buf_len > 0) {
+        if (write(file->fs_fd, file->buf, file->buf_len) != file->buf_len) {
+            ret = -1;
+        }
+    } else if (file->buf_mode == BUF_MODE_READ && file->buf_pos < file->buf_len) {
+        if (lseek(file->fs_fd, (off_t)file->buf_pos - file->buf_len, SEEK_CUR) < 0) {
+            ret = -1;
+        }
+    }
+    file->buf_mode = BUF_MODE_NONE;
+    file->buf_len = 0;
+    file->buf_pos = 0;
+
+    return ret;
+}
+
+static int BufRead(File_Context *file, char *buf, unsigned int len)
+{
+    unsigned int done = 0;
+
+    if (file->buf_mode == BUF_MODE_WRITE && BufSync(file) != 0) {
+        return -1;
+    }
+    while (done < len) {
+        if (file->buf_mode == BUF_MODE_READ && file->buf_pos < file->buf_len) {
+            unsigned int n = file->buf_len - file->buf_pos;
+            n = (n < len - done) ? n : (len - done);
+            (void)memcpy_s(buf + done, len - done, file->buf + file->buf_pos, n);
+            file->buf_pos += n;
+            done += n;
+            continue;
+        }
+        if (len - done >= HAL_FILE_BUF_SIZE) {
+            /* Large reads go straight to the caller's buffer. */
+            file->buf_mode = BUF_MODE_NONE;
+            file->buf_len = 0;
+            file->buf_pos = 0;
+            int ret = read(file->fs_fd, buf + done, len - done);
+            if (ret < 0) {
+                return (done > 0) ? (int)done : -1;
+            }
+            return (int)(done + ret);
+        }
+        int ret = read(file->fs_fd, file->buf, HAL_FILE_BUF_SIZE);
+        if (ret <= 0) {
+            file->buf_mode = BUF_MODE_NONE;
+            file->buf_len = 0;
+            file->buf_pos = 0;
+            return (done > 0 || ret == 0) ? (int)done : -1;
+        }
+        file->buf_mode = BUF_MODE_READ;
+        file->buf_len = ret;
+        file->buf_pos = 0;
+    }
+
+    return (int)done;
+}
+
+static int BufWrite(File_Context *file, const char *buf, unsigned int len)
+{
+    if (file->buf_mode == BUF_MODE_READ && BufSync(file) != 0) {
+        return -1;
+    }
+    if (file->buf_len + len > HAL_FILE_BUF_SIZE) {
+        if (BufSync(file) != 0) {
+            return -1;
+        }
+        if (len >= HAL_FILE_BUF_SIZE) {
+            return write(file->fs_fd, buf, len);
+        }
+    }
+    (void)memcpy_s(file->buf + file->buf_len, HAL_FILE_BUF_SIZE - file->buf_len, buf, len);
+    file->buf_len += len;
+    file->buf_mode = BUF_MODE_WRITE;
+
+    return (int)len;
+}
+#endif
+
+/* Move to offset, reusing buffered read-ahead when it already covers the target. */
+static int FileMoveTo(File_Context *file, unsigned int offset)
+{
+    if (offset == file->pos) {
+        return 0;
+    }
+#if (HAL_FILE_BUF_SIZE > 0)
+    if (file->buf_mode == BUF_MODE_READ) {
+        unsigned int start = file->pos - file->buf_pos;
+        if ((offset >= start) && (offset < start + file->buf_len)) {
+            file->buf_pos = offset - start;
+            file->pos = offset;
+            return 0;
         }
     }
+    if (BufSync(file) != 0) {
+        return -1;
+    }
+#endif
+    if (lseek(file->fs_fd, offset, SEEK_SET) < 0) {
+        return -1;
+    }
+    file->pos = offset;
+
+    return 0;
+}
+
+static int FileRead(File_Context *file, char *buf, unsigned int len)
+{
+    if (file->accmode == O_WRONLY) {
+        return -1;
+    }
+#if (HAL_FILE_BUF_SIZE > 0)
+    int ret = BufRead(file, buf, len);
+#else
+    int ret = read(file->fs_fd, buf, len);
+#endif
+    if (ret > 0) {
+        file->pos += ret;
+    }
 
-    return i;
+    return ret;
 }
 
+static int FileWrite(File_Context *file, const char *buf, unsigned int len)
+{
+    /* Checked here since a buffered write only reaches the file system at the next flush. */
+    if (file->accmode == O_RDONLY) {
+        return -1;
+    }
+    if (file->append) {
+        file->pos = file->size;
+    }
+#if (HAL_FILE_BUF_SIZE > 0)
+    int ret = BufWrite(file, buf, len);
+#else
+    int ret = write(file->fs_fd, buf, len);
+#endif
+    if (ret > 0) {
+        file->pos += ret;
+        if (file->pos > file->size) {
+            file->size = file->pos;
+        }
+    }
+
+    return ret;
+}
 
 int ReadModeChange(int oflag)
 {
@@ -88,175 +348,320 @@ int ReadModeChange(int oflag)
     return ret;
 }
 
-int HalFileOpen(const char *path, int oflag, int mode)
+/* Called with the table locked. */
+static int FileOpen(const char *file_path, int oflag)
 {
-    char *file_path;
-    int fd;
-    uint16_t path_len;
-
-    if (strlen(path) >= MAX_PATH_LEN) {
-        LOG_E("path name is too long!!!\n");
+    int fd = Find_Free_Num();
+    if (fd == 0) {
+        LOG_E("NO enougn file Space!!!\n");
         return -1;
     }
 
-    fd = Find_Free_Num();
-    if (fd == 0) {
-        LOG_E("NO enougn file Space!!!\n");
+    int fs_fd = open(file_path, ReadModeChange(oflag));
+    if (fs_fd < 0) {
+        LOG_E("open file '%s' failed, %s\r\n", file_path, strerror(errno));
         return -1;
     }
 
-    path_len = strlen(path) + strlen(ROOT_PATH) + ROOT_LEN;
-    file_path = (char *)malloc(path_len);
-    if (file_path == NULL) {
-        LOG_E("malloc path name buffer failed!\n");
+    struct stat f_info;
+    if (fstat(fs_fd, &f_info) != 0) {
+        close(fs_fd);
         return -1;
     }
-    strcpy_s(file_path, path_len, ROOT_PATH);
-    if (strcat_s(file_path, path_len, "/") != 0) {
+
+#if (HAL_FILE_BUF_SIZE > 0)
+    /* A buffer stays with its slot once allocated and is reused by every later open of the slot. */
+    if (File[fd - 1].buf == NULL) {
+        File[fd - 1].buf = (char *)malloc(HAL_FILE_BUF_SIZE);
+        if (File[fd - 1].buf == NULL) {
+            LOG_E("malloc file buffer failed!\n");
+            close(fs_fd);
+            return -1;
+        }
+    } else {
+        FILE_STATS_INC(bufAllocAvoided);
+    }
+    File[fd - 1].buf_mode = BUF_MODE_NONE;
+    File[fd - 1].buf_len = 0;
+    File[fd - 1].buf_pos = 0;
+#endif
+    File[fd - 1].append = ((ReadModeChange(oflag) & O_APPEND) != 0);
+    File[fd - 1].accmode = (unsigned char)(ReadModeChange(oflag) & O_ACCMODE);
+    File[fd - 1].pos = 0;
+    File[fd - 1].size = f_info.st_size;
+    File[fd - 1].fd = 1;
+    File[fd - 1].fs_fd = fs_fd;
+    g_fileUsedMap |= (1UL << (fd - 1));
+    /* A first-fit search of the table would have looked at every slot up to this one. */
+    FILE_STATS_ADD(fdScanAvoided, fd);
+
+    return fd;
+}
+
+int HalFileOpen(const char *path, int oflag, int mode)
+{
+    char file_path[FILE_PATH_LEN];
+    int fd;
+
+    if (BuildPath(file_path, path) != 0) {
         return -1;
     }
-    if (strcat_s(file_path, path_len, path) != 0) {
+    if (FileLock() != 0) {
         return -1;
     }
+    fd = FileOpen(file_path, oflag);
+    FileUnlock();
 
-    int fs_fd = open(file_path, ReadModeChange(oflag));
-    if (fs_fd < 0) {
-        LOG_E("open file '%s' failed, %s\r\n", file_path, strerror(errno));
-        free(file_path);
+    return fd;
+}
+
+/* Called with the table locked. */
+static int FileClose(File_Context *file)
+{
+    int ret = 0;
+
+#if (HAL_FILE_BUF_SIZE > 0)
+    /* The descriptor is released either way, but data lost in the flush is reported. */
+    if (BufSync(file) != 0) {
+        LOG_E("flush file buffer failed!\n");
+        ret = -1;
+    }
+#endif
+    if (close(file->fs_fd) != 0) {
         return -1;
     }
 
-    File[fd - 1].fd = 1;
-    File[fd - 1].fs_fd = fs_fd;
-    free(file_path);
+    g_fileUsedMap &= ~(1UL << (file - File));
+    file->fd = 0;
+    file->fs_fd = -1;
 
-    return fd;
+    return ret;
 }
 
 int HalFileClose(int fd)
 {
-    int ret;
+    File_Context *file = NULL;
+    int ret = -1;
 
-    if ((fd > MaxOpenFile) || (fd <= 0)) {
+    /* Queued writes must land before the slot can be reused; the worker takes the table lock to run them. */
+    if (HalFileAsyncDrain(fd, HAL_FILE_WAIT_FOREVER) != 0) {
         return -1;
     }
-
-    ret = close(File[fd - 1].fs_fd);
-    if (ret != 0) {
+    if (FileLock() != 0) {
         return -1;
     }
-
-    File[fd - 1].fd = 0;
-    File[fd - 1].fs_fd = -1;
+    file = FileGet(fd);
+    if (file != NULL) {
+        ret = FileClose(file);
+    }
+    FileUnlock();
 
     return ret;
 }
 
 int HalFileRead(int fd, char *buf, unsigned int len)
 {
-    if ((fd > MaxOpenFile) || (fd <= 0)) {
+    File_Context *file = NULL;
+    int ret = -1;
+
+    if (FileLock() != 0) {
         return -1;
     }
+    file = FileGet(fd);
+    if (file != NULL) {
+        ret = FileRead(file, buf, len);
+    }
+    FileUnlock();
 
-    return read(File[fd - 1].fs_fd, buf, len);
+    return ret;
 }
 
 int HalFileWrite(int fd, const char *buf, unsigned int len)
 {
-    if ((fd > MaxOpenFile) || (fd <= 0)) {
+    File_Context *file = NULL;
+    int ret = -1;
+
+    if (FileLock() != 0) {
         return -1;
     }
+    file = FileGet(fd);
+    if (file != NULL) {
+        ret = FileWrite(file, buf, len);
+    }
+    FileUnlock();
 
-    return write(File[fd - 1].fs_fd, buf, len);
+    return ret;
 }
 
-int HalFileDelete(const char *path)
+int HalFileReadAt(int fd, unsigned int offset, char *buf, unsigned int len)
 {
-    char *file_path;
-    uint16_t path_len;
+    File_Context *file = NULL;
+    int ret = -1;
 
-    if (strlen(path) >= MAX_PATH_LEN) {
-        LOG_E("path name is too long!!!\n");
+    if (FileLock() != 0) {
         return -1;
     }
+    file = FileGet(fd);
+    if ((file != NULL) && (offset <= file->size) && (FileMoveTo(file, offset) == 0)) {
+        ret = FileRead(file, buf, len);
+    }
+    FileUnlock();
 
-    path_len = strlen(path) + strlen(ROOT_PATH) + ROOT_LEN;
-    file_path = (char *)malloc(path_len);
-    if (file_path == NULL) {
-        LOG_E("malloc path name buffer failed!\n");
+    return ret;
+}
+
+int HalFileWriteAt(int fd, unsigned int offset, const char *buf, unsigned int len)
+{
+    File_Context *file = NULL;
+    int ret = -1;
+
+    if (FileLock() != 0) {
         return -1;
     }
+    file = FileGet(fd);
+    if ((file != NULL) && (offset <= file->size) && (FileMoveTo(file, offset) == 0)) {
+        ret = FileWrite(file, buf, len);
+    }
+    FileUnlock();
+
+    return ret;
+}
 
-    strcpy_s(file_path, path_len, ROOT_PATH);
-    if (strcat_s(file_path, path_len, "/") != 0) {
+/* Called with the table locked. */
+static int FileFlush(File_Context *file)
+{
+#if (HAL_FILE_BUF_SIZE > 0)
+    if (BufSync(file) != 0) {
         return -1;
     }
-    if (strcat_s(file_path, path_len, path) != 0) {
+#endif
+    return (fsync(file->fs_fd) == 0) ? 0 : -1;
+}
+
+int HalFileFlush(int fd)
+{
+    File_Context *file = NULL;
+    int ret = -1;
+
+    if (FileLock() != 0) {
         return -1;
     }
-
-    int ret = unlink(file_path);
-    free(file_path);
+    file = FileGet(fd);
+    if (file != NULL) {
+        ret = FileFlush(file);
+    }
+    FileUnlock();
 
     return ret;
 }
 
+int HalFileDelete(const char *path)
+{
+    char file_path[FILE_PATH_LEN];
+
+    if (BuildPath(file_path, path) != 0) {
+        return -1;
+    }
+
+    return unlink(file_path);
+}
+
 int HalFileStat(const char *path, unsigned int *fileSize)
 {
-    char *file_path;
+    char file_path[FILE_PATH_LEN];
     struct stat f_info;
-    uint16_t path_len;
 
-    if (strlen(path) >= MAX_PATH_LEN) {
-        LOG_E("path name is too long!!!\n");
+    if (BuildPath(file_path, path) != 0) {
         return -1;
     }
 
-    path_len = strlen(path) + strlen(ROOT_PATH) + ROOT_LEN;
-    file_path = (char *)malloc(path_len);
-    if (file_path == NULL) {
-        LOG_E("malloc path name buffer failed!\n");
+    int ret = stat(file_path, &f_info);
+    *fileSize = f_info.st_size;
+
+    return ((ret == 0) ? 0 : -1);
+}
+
+/* Called with the table locked. */
+static int FileSeek(File_Context *file, int offset, unsigned int whence)
+{
+    int64_t target;
+
+    if (whence == SEEK_SET_FS) {
+        target = offset;
+    } else if (whence == SEEK_CUR_FS) {
+        target = (int64_t)file->pos + offset;
+    } else if (whence == SEEK_END_FS) {
+        target = (int64_t)file->size + offset;
+    } else {
         return -1;
     }
-    strcpy_s(file_path, path_len, ROOT_PATH);
-    if (strcat_s(file_path, path_len, "/") != 0) {
+
+    if ((target < 0) || (target > file->size)) {
         return -1;
     }
-    if (strcat_s(file_path, path_len, path) != 0) {
+    if (FileMoveTo(file, (unsigned int)target) != 0) {
         return -1;
     }
 
-    int ret = stat(file_path, &f_info);
-    *fileSize = f_info.st_size;
-    free(file_path);
-
-    return ((ret == 0) ? 0 : -1);
+    return (int)target;
 }
 
 int HalFileSeek(int fd, int offset, unsigned int whence)
 {
-    int ret = 0;
-    struct stat f_info;
+    File_Context *file = NULL;
+    int ret = -1;
 
-    if ((fd > MaxOpenFile) || (fd <= 0)) {
+    if (FileLock() != 0) {
         return -1;
     }
+    file = FileGet(fd);
+    if (file != NULL) {
+        ret = FileSeek(file, offset, whence);
+    }
+    FileUnlock();
 
-    ret = fstat(File[fd - 1].fs_fd, &f_info);
-    if (ret != 0) {
+    return ret;
+}
+
+int HalFileMap(const char *path, unsigned int offset, const void **addr, unsigned int *len)
+{
+#if (LFS_XIP_READ_ENABLE == 1)
+    lfs_t *lfs;
+    lfs_size_t size;
+
+    if ((path == NULL) || (addr == NULL) || (len == NULL)) {
+        return -1;
+    }
+    if (strlen(path) >= MAX_PATH_LEN) {
+        LOG_E("path name is too long!!!\n");
         return -1;
     }
 
-    if (whence == SEEK_SET_FS) {
-        if (offset > f_info.st_size) {
-            ret = -1;
-        }
+    lfs = FsGetLfsHandle(ROOT_PATH);
+    if (lfs == NULL) {
+        return -1;
     }
+    if (littlefs_map(lfs, path, offset, addr, &size) != LFS_ERR_OK) {
+        return -1;
+    }
+    *len = size;
+
+    return 0;
+#else
+    return -1;
+#endif
+}
 
-    ret = lseek(File[fd - 1].fs_fd, offset, whence);
-    if ((ret >  f_info.st_size) || (ret < 0)) {
+int HalFileStatsGet(HalFileStats *stats)
+{
+#if (HAL_FILE_STATS_ENABLE == 1)
+    if (stats == NULL) {
         return -1;
     }
+    *stats = g_fileStats;
 
-    return ret;
+    return 0;
+#else
+    return -1;
+#endif
 }
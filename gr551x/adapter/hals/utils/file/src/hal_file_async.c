@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "los_mux.h"
+#include "los_queue.h"
+#include "los_sem.h"
+#include "los_task.h"
+#include "los_tick.h"
+#include "log.h"
+#include "hal_file.h"
+#include "hal_file_ext.h"
+
+#define LOG_E(fmt, ...)  HILOG_ERROR(HILOG_MODULE_APP, fmt, ##__VA_ARGS__)
+
+#ifndef HAL_FILE_ASYNC_QUEUE_LEN
+#define HAL_FILE_ASYNC_QUEUE_LEN        16
+#endif
+
+#ifndef HAL_FILE_STATS_ENABLE
+#define HAL_FILE_STATS_ENABLE           0
+#endif
+
+#define HAL_FILE_ASYNC_TASK_NAME        "HalFileAsync"
+#define HAL_FILE_ASYNC_TASK_STACKSIZE   0x800
+#define HAL_FILE_ASYNC_TASK_PRIOR       20  /* below the BLE and UART service tasks */
+
+#define ASYNC_SEQ_MASK                  0x7FFFFFFF
+
+/* Same size as the descriptor table in hal_file.c. */
+#define ASYNC_MAX_FD                    32
+
+#define ASYNC_OP_WRITE                  0
+#define ASYNC_OP_SYNC                   1
+
+typedef struct {
+    uint8_t op;
+    int fd;
+    const char *buf;
+    unsigned int len;
+    HalFileAsyncCallback cb;
+    void *arg;
+    uint32_t seq;
+    UINT64 tick;
+} AsyncReq;
+
+/*
+ * A task blocked in HalFileAsyncWait. Each waiter sleeps on its own semaphore, posted once by the
+ * completion that reaches its target, so one waiter can never consume the wake-up of another.
+ */
+typedef struct AsyncWaiter {
+    struct AsyncWaiter *next;
+    uint32_t target;
+    UINT32 sem;
+} AsyncWaiter;
+
+static bool g_asyncReady = false;
+static UINT32 g_asyncQueue;
+static UINT32 g_asyncTaskID;
+static UINT32 g_asyncMux;                           /* protects everything below */
+static uint32_t g_asyncSubmitted = 0;               /* seq of the last queued request */
+static uint32_t g_asyncCompleted = 0;               /* seq of the last finished request */
+static uint32_t g_asyncFdLast[ASYNC_MAX_FD] = { 0 }; /* seq of the last request queued per fd, 0 if none */
+static AsyncWaiter *g_asyncWaiters = NULL;
+#if (HAL_FILE_STATS_ENABLE == 1)
+static HalFileAsyncStats g_asyncStats = { 0 };
+#endif
+
+/* Sequence numbers stay positive so they can be handed out as request ids, and wrap at 2^31. */
+static bool AsyncSeqReached(uint32_t done, uint32_t target)
+{
+    return ((done - target) & ASYNC_SEQ_MASK) < ((ASYNC_SEQ_MASK >> 1) + 1);
+}
+
+static void AsyncStatsSubmit(bool queued)
+{
+#if (HAL_FILE_STATS_ENABLE == 1)
+    uint32_t depth;
+
+    if (!queued) {
+        g_asyncStats.rejected++;
+        return;
+    }
+    g_asyncStats.submitted++;
+    depth = (g_asyncSubmitted - g_asyncCompleted) & ASYNC_SEQ_MASK;
+    if (depth > g_asyncStats.maxDepth) {
+        g_asyncStats.maxDepth = depth;
+    }
+#else
+    (void)queued;
+#endif
+}
+
+static void AsyncStatsUpdate(const AsyncReq *req, int ret)
+{
+#if (HAL_FILE_STATS_ENABLE == 1)
+    uint32_t ms = (uint32_t)LOS_Tick2MS((UINT32)(LOS_TickCountGet() - req->tick));
+
+    g_asyncStats.completed++;
+    if (ret < 0) {
+        g_asyncStats.failed++;
+    }
+    if (ms > g_asyncStats.latencyMaxMs) {
+        g_asyncStats.latencyMaxMs = ms;
+    }
+    g_asyncStats.latencyTotalMs += ms;
+#else
+    (void)req;
+    (void)ret;
+#endif
+}
+
+/* Called with g_asyncMux held: release every waiter whose target has completed. */
+static void AsyncWakeWaiters(void)
+{
+    AsyncWaiter **link = &g_asyncWaiters;
+
+    while (*link != NULL) {
+        AsyncWaiter *w = *link;
+        if (AsyncSeqReached(g_asyncCompleted, w->target)) {
+            *link = w->next;
+            w->next = NULL;
+            (void)LOS_SemPost(w->sem);
+        } else {
+            link = &w->next;
+        }
+    }
+}
+
+/* Called with g_asyncMux held. Returns false if w had already been released by a completion. */
+static bool AsyncUnlinkWaiter(const AsyncWaiter *w)
+{
+    AsyncWaiter **link = &g_asyncWaiters;
+
+    while (*link != NULL) {
+        if (*link == w) {
+            *link = w->next;
+            return true;
+        }
+        link = &(*link)->next;
+    }
+    return false;
+}
+
+static void HalFileAsyncTask(void)
+{
+    AsyncReq req;
+    UINT32 size;
+    int ret;
+
+    while (1) {
+        size = sizeof(req);
+        if (LOS_QueueReadCopy(g_asyncQueue, &req, &size, LOS_WAIT_FOREVER) != LOS_OK) {
+            continue;
+        }
+
+        if (req.op == ASYNC_OP_WRITE) {
+            ret = HalFileWrite(req.fd, req.buf, req.len);
+        } else {
+            ret = HalFileFlush(req.fd);
+        }
+        if (req.cb != NULL) {
+            req.cb(req.fd, ret, req.arg);
+        }
+
+        (void)LOS_MuxPend(g_asyncMux, LOS_WAIT_FOREVER);
+        AsyncStatsUpdate(&req, ret);
+        g_asyncCompleted = req.seq;
+        AsyncWakeWaiters();
+        (void)LOS_MuxPost(g_asyncMux);
+    }
+}
+
+int HalFileAsyncInit(void)
+{
+    UINT32 taskID;
+    TSK_INIT_PARAM_S stTask = {0};
+
+    if (g_asyncReady) {
+        return 0;
+    }
+
+    if (LOS_QueueCreate("HalFileAsyncQ", HAL_FILE_ASYNC_QUEUE_LEN, &g_asyncQueue, 0, sizeof(AsyncReq)) != LOS_OK) {
+        LOG_E("create async file queue failed!\n");
+        return -1;
+    }
+    if (LOS_MuxCreate(&g_asyncMux) != LOS_OK) {
+        (void)LOS_QueueDelete(g_asyncQueue);
+        return -1;
+    }
+
+    stTask.pfnTaskEntry = (TSK_ENTRY_FUNC)HalFileAsyncTask;
+    stTask.uwStackSize = HAL_FILE_ASYNC_TASK_STACKSIZE;
+    stTask.pcName = HAL_FILE_ASYNC_TASK_NAME;
+    stTask.usTaskPrio = HAL_FILE_ASYNC_TASK_PRIOR;
+    if (LOS_TaskCreate(&taskID, &stTask) != LOS_OK) {
+        LOG_E("create async file task failed!\n");
+        (void)LOS_MuxDelete(g_asyncMux);
+        (void)LOS_QueueDelete(g_asyncQueue);
+        return -1;
+    }
+    g_asyncTaskID = taskID;
+    g_asyncReady = true;
+
+    return 0;
+}
+
+static int AsyncSubmit(uint8_t op, int fd, const char *buf, unsigned int len, HalFileAsyncCallback cb, void *arg)
+{
+    AsyncReq req;
+    int ret = -1;
+
+    if (!g_asyncReady || (fd <= 0) || (fd > ASYNC_MAX_FD)) {
+        return -1;
+    }
+
+    req.op = op;
+    req.fd = fd;
+    req.buf = buf;
+    req.len = len;
+    req.cb = cb;
+    req.arg = arg;
+    req.tick = LOS_TickCountGet();
+
+    /* Sequence numbers must be handed out in queue order, so both happen under the lock. */
+    (void)LOS_MuxPend(g_asyncMux, LOS_WAIT_FOREVER);
+    req.seq = (g_asyncSubmitted + 1) & ASYNC_SEQ_MASK;
+    if (req.seq == 0) {
+        req.seq = 1;
+    }
+    if (LOS_QueueWriteCopy(g_asyncQueue, &req, sizeof(req), 0) == LOS_OK) {
+        g_asyncSubmitted = req.seq;
+        g_asyncFdLast[fd - 1] = req.seq;
+        ret = (int)req.seq;
+    }
+    AsyncStatsSubmit(ret > 0);
+    (void)LOS_MuxPost(g_asyncMux);
+
+    return ret;
+}
+
+int HalFileWriteAsync(int fd, const char *buf, unsigned int len, HalFileAsyncCallback cb, void *arg)
+{
+    if (buf == NULL) {
+        return -1;
+    }
+
+    return AsyncSubmit(ASYNC_OP_WRITE, fd, buf, len, cb, arg);
+}
+
+int HalFileSyncAsync(int fd, HalFileAsyncCallback cb, void *arg)
+{
+    return AsyncSubmit(ASYNC_OP_SYNC, fd, NULL, 0, cb, arg);
+}
+
+int HalFileAsyncWait(int id, unsigned int timeoutMs)
+{
+    AsyncWaiter waiter;
+    UINT32 timeout;
+    bool done;
+
+    if (!g_asyncReady || (id <= 0)) {
+        return -1;
+    }
+
+    /* Checking the target and queueing the waiter under the lock the worker completes under loses no wake-up. */
+    (void)LOS_MuxPend(g_asyncMux, LOS_WAIT_FOREVER);
+    if (AsyncSeqReached(g_asyncCompleted, (uint32_t)id)) {
+        (void)LOS_MuxPost(g_asyncMux);
+        return 0;
+    }
+    if (LOS_BinarySemCreate(0, &waiter.sem) != LOS_OK) {
+        (void)LOS_MuxPost(g_asyncMux);
+        LOG_E("create async file wait semaphore failed!\n");
+        return -1;
+    }
+    waiter.target = (uint32_t)id;
+    waiter.next = g_asyncWaiters;
+    g_asyncWaiters = &waiter;
+    (void)LOS_MuxPost(g_asyncMux);
+
+    timeout = (timeoutMs == HAL_FILE_WAIT_FOREVER) ? LOS_WAIT_FOREVER : LOS_MS2Tick(timeoutMs);
+    (void)LOS_SemPend(waiter.sem, timeout);
+
+    /* On a timeout the request may still have completed meanwhile; either way the waiter leaves the list. */
+    (void)LOS_MuxPend(g_asyncMux, LOS_WAIT_FOREVER);
+    (void)AsyncUnlinkWaiter(&waiter);
+    done = AsyncSeqReached(g_asyncCompleted, (uint32_t)id);
+    (void)LOS_MuxPost(g_asyncMux);
+    (void)LOS_SemDelete(waiter.sem);
+
+    return done ? 0 : -1;
+}
+
+int HalFileAsyncBarrier(unsigned int timeoutMs)
+{
+    uint32_t last;
+
+    if (!g_asyncReady) {
+        return -1;
+    }
+    (void)LOS_MuxPend(g_asyncMux, LOS_WAIT_FOREVER);
+    last = g_asyncSubmitted;
+    (void)LOS_MuxPost(g_asyncMux);
+    if (last == 0) {
+        return 0;
+    }
+
+    return HalFileAsyncWait((int)last, timeoutMs);
+}
+
+int HalFileAsyncDrain(int fd, unsigned int timeoutMs)
+{
+    uint32_t last;
+    uint32_t completed;
+    uint32_t running;
+
+    if (!g_asyncReady || (fd <= 0) || (fd > ASYNC_MAX_FD)) {
+        return 0;
+    }
+    (void)LOS_MuxPend(g_asyncMux, LOS_WAIT_FOREVER);
+    last = g_asyncFdLast[fd - 1];
+    completed = g_asyncCompleted;
+    (void)LOS_MuxPost(g_asyncMux);
+    if ((last == 0) || AsyncSeqReached(completed, last)) {
+        return 0;
+    }
+
+    if (LOS_CurTaskIDGet() == g_asyncTaskID) {
+        /* From a callback: only the request being reported on is done, later ones cannot run before we return. */
+        running = (completed + 1) & ASYNC_SEQ_MASK;
+        if (running == 0) {
+            running = 1;
+        }
+        return (running == last) ? 0 : -1;
+    }
+
+    return HalFileAsyncWait((int)last, timeoutMs);
+}
+
+int HalFileAsyncStatsGet(HalFileAsyncStats *stats)
+{
+#if (HAL_FILE_STATS_ENABLE == 1)
+    if ((stats == NULL) || !g_asyncReady) {
+        return -1;
+    }
+    (void)LOS_MuxPend(g_asyncMux, LOS_WAIT_FOREVER);
+    *stats = g_asyncStats;
+    stats->depth = (g_asyncSubmitted - g_asyncCompleted) & ASYNC_SEQ_MASK;
+    (void)LOS_MuxPost(g_asyncMux);
+
+    return 0;
+#else
+    (void)stats;
+    return -1;
+#endif
+}
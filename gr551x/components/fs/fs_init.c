@@ -12,20 +12,47 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <string.h>
 #include <sys/mount.h>
 #include "littlefs.h"
 #include "los_config.h"
+#include "los_memory.h"
+#include "los_task.h"
+#include "los_tick.h"
+#include "gr55xx_hal.h"
+#include "hal_flash_sched.h"
 #include "hdf_log.h"
 #include "hdf_device_desc.h"
 #include "device_resource_if.h"
 #include "lfs_adapter.h"
+#include "securec.h"
+#if (LOSCFG_USE_SHELL == 1)
+#include "shcmd.h"
+#endif
 
+/*
+ * read_size and prog_size are not derived in auto mode. The NOR flash reads and programs at byte
+ * granularity, so nothing in the geometry asks for a larger unit, and littlefs pads every metadata
+ * commit to prog_size: a bigger unit only wastes metadata space. Batching into flash pages is done
+ * by cache_size, which auto mode does size from the page.
+ */
 #define LFS_CFG_READ_SIZE       16
 #define LFS_CFG_PROG_SIZE       16
-#define LFS_CFG_CACHE_SIZE      16
-#define LFS_CFG_LOOKAHEAD_SIZE  32
 #define LFS_CFG_BLOCK_CYCLES    500
 
+/* Auto mode: littlefs caches may take at most 1/LFS_AUTO_HEAP_SHARE of the free heap. */
+#define LFS_AUTO_HEAP_SHARE     16
+#define LFS_AUTO_OPEN_FILES     4
+#define LFS_LOOKAHEAD_ALIGN     8
+#define BITS_PER_BYTE           8
+
+#define LFS_PRE_ERASE_TASK_NAME         "LfsPreErase"
+#define LFS_PRE_ERASE_TASK_STACKSIZE    0x800
+#define LFS_PRE_ERASE_TASK_PRIOR        30  /* just above the idle task */
+#define LFS_PRE_ERASE_INTERVAL_MS       1000
+#define LFS_SCHED_IDLE_MS               20  /* poll period with no flash job queued */
+#define LFS_PRE_ERASE_BATCH             4
+
 struct fs_cfg {
     char *mount_point;
     struct lfs_config lfs_cfg;
@@ -64,6 +91,13 @@ static uint32_t FsGetResource(struct fs_cfg *fs, const struct DeviceResourceNode
             HDF_LOGE("%s: failed to get block_count", __func__);
             return HDF_FAILURE;
         }
+        /* Tuning attributes are optional, a missing or zero value selects auto mode. */
+        (void)resource->GetUint32ArrayElem(resourceNode, "read_size", i, &fs[i].lfs_cfg.read_size, 0);
+        (void)resource->GetUint32ArrayElem(resourceNode, "prog_size", i, &fs[i].lfs_cfg.prog_size, 0);
+        (void)resource->GetUint32ArrayElem(resourceNode, "cache_size", i, &fs[i].lfs_cfg.cache_size, 0);
+        (void)resource->GetUint32ArrayElem(resourceNode, "lookahead_size", i, &fs[i].lfs_cfg.lookahead_size, 0);
+        (void)resource->GetUint32ArrayElem(resourceNode, "block_cycles", i,
+                                           (uint32_t *)&fs[i].lfs_cfg.block_cycles, 0);
         HDF_LOGD("%s: fs[%d] mount_point=%s, partition=%u, block_size=%u, block_count=%u", __func__, i,
                  fs[i].mount_point, (uint32_t)fs[i].lfs_cfg.context, fs[i].lfs_cfg.block_size,
                  fs[i].lfs_cfg.block_count);
@@ -71,10 +105,188 @@ static uint32_t FsGetResource(struct fs_cfg *fs, const struct DeviceResourceNode
     return HDF_SUCCESS;
 }
 
-static int32_t FsDriverInit(struct HdfDeviceObject *object)
+static uint32_t FsAutoCacheSize(const struct lfs_config *cfg)
+{
+    uint32_t freeHeap = LOS_MemPoolSizeGet(m_aucSysMem0) - LOS_MemTotalUsedGet(m_aucSysMem0);
+    uint32_t budget = freeHeap / LFS_AUTO_HEAP_SHARE;
+    uint32_t unit = (cfg->read_size > cfg->prog_size) ? cfg->read_size : cfg->prog_size;
+    uint32_t size = EXFLASH_SIZE_PAGE_BYTES;
+
+    /* One read cache, one prog cache and one cache per open file. */
+    while ((size > unit) && (size * (LFS_AUTO_OPEN_FILES + 2) > budget)) {
+        size >>= 1;
+    }
+    return (size < unit) ? unit : size;
+}
+
+static uint32_t FsAutoLookaheadSize(const struct lfs_config *cfg)
+{
+    /* One bit per block, so a single lookahead window covers the whole partition. */
+    uint32_t size = (cfg->block_count + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+
+    return (size + LFS_LOOKAHEAD_ALIGN - 1) / LFS_LOOKAHEAD_ALIGN * LFS_LOOKAHEAD_ALIGN;
+}
+
+static uint32_t FsTuneConfig(struct fs_cfg *fs)
+{
+    struct lfs_config *cfg = &fs->lfs_cfg;
+
+    if (cfg->read_size == 0) {
+        cfg->read_size = LFS_CFG_READ_SIZE;
+    }
+    if (cfg->prog_size == 0) {
+        cfg->prog_size = LFS_CFG_PROG_SIZE;
+    }
+    if (cfg->cache_size == 0) {
+        cfg->cache_size = FsAutoCacheSize(cfg);
+    }
+    if (cfg->lookahead_size == 0) {
+        cfg->lookahead_size = FsAutoLookaheadSize(cfg);
+    }
+    if (cfg->block_cycles == 0) {
+        cfg->block_cycles = LFS_CFG_BLOCK_CYCLES;
+    }
+
+    if ((cfg->cache_size % cfg->read_size != 0) || (cfg->cache_size % cfg->prog_size != 0) ||
+        (cfg->block_size % cfg->cache_size != 0) || (cfg->lookahead_size % LFS_LOOKAHEAD_ALIGN != 0)) {
+        HDF_LOGE("%s: invalid geometry on '%s'", __func__, fs->mount_point);
+        return HDF_FAILURE;
+    }
+    HDF_LOGI("%s: '%s' read=%u prog=%u cache=%u lookahead=%u cycles=%d", __func__, fs->mount_point,
+             cfg->read_size, cfg->prog_size, cfg->cache_size, cfg->lookahead_size, cfg->block_cycles);
+    return HDF_SUCCESS;
+}
+
+/*
+ * The adapter changes its mount table under a lock of its own that is not exported, so the lookup runs with
+ * the scheduler locked: no mount or unmount can run between checking an entry and reading its name.
+ */
+lfs_t *FsGetLfsHandle(const char *mountPoint)
+{
+    struct FileOpInfo *fileOpInfo = GetFsOpInfo();
+    lfs_t *lfs = NULL;
+
+    LOS_TaskLock();
+    for (int i = 0; i < LOSCFG_LFS_MAX_MOUNT_SIZE; i++) {
+        if (fileOpInfo[i].useFlag && (fileOpInfo[i].dirName != NULL) &&
+            (strcmp(fileOpInfo[i].dirName, mountPoint) == 0)) {
+            lfs = &fileOpInfo[i].lfsInfo;
+            break;
+        }
+    }
+    LOS_TaskUnlock();
+    return lfs;
+}
+
+#if (LFS_PRE_ERASE_ENABLE == 1)
+/* Also issues the jobs queued on the flash scheduler, one piece per tick while any are queued. */
+static void FsPreEraseTask(void)
+{
+    UINT64 next = LOS_TickCountGet() + LOS_MS2Tick(LFS_PRE_ERASE_INTERVAL_MS);
+    bool pending;
+
+    while (1) {
+        pending = hal_flash_sched_poll();
+        if (LOS_TickCountGet() < next) {
+            LOS_TaskDelay(pending ? 1 : LOS_MS2Tick(LFS_SCHED_IDLE_MS));
+            continue;
+        }
+        next = LOS_TickCountGet() + LOS_MS2Tick(LFS_PRE_ERASE_INTERVAL_MS);
+        for (int i = 0; i < LOSCFG_LFS_MAX_MOUNT_SIZE; i++) {
+            if (fs[i].mount_point == NULL) {
+                continue;
+            }
+            lfs_t *lfs = FsGetLfsHandle(fs[i].mount_point);
+            if (lfs != NULL) {
+                (void)littlefs_pre_erase(lfs, &fs[i].lfs_cfg, LFS_PRE_ERASE_BATCH);
+            }
+        }
+    }
+}
+
+static uint32_t FsTimeMs(void)
+{
+    return (uint32_t)LOS_Tick2MS((UINT32)LOS_TickCountGet());
+}
+
+static void FsPreEraseStart(void)
+{
+    UINT32 taskID;
+    TSK_INIT_PARAM_S stTask = {0};
+
+    /*
+     * Pre-erase passes stop at the first block whose erase could not be suspended, or end on parts that
+     * cannot suspend, before the next radio event. A gap source the application installed first is kept.
+     */
+    (void)hal_flash_sched_init(FsTimeMs, NULL);
+
+    stTask.pfnTaskEntry = (TSK_ENTRY_FUNC)FsPreEraseTask;
+    stTask.uwStackSize = LFS_PRE_ERASE_TASK_STACKSIZE;
+    stTask.pcName = LFS_PRE_ERASE_TASK_NAME;
+    stTask.usTaskPrio = LFS_PRE_ERASE_TASK_PRIOR;
+    if (LOS_TaskCreate(&taskID, &stTask) != LOS_OK) {
+        HDF_LOGE("%s: pre-erase task create failed", __func__);
+    }
+}
+#endif
+
+#if (HAL_FLASH_STATS_ENABLE == 1)
+static void FsDumpOpStats(const char *name, const hal_flash_op_stats_t *op)
 {
-    struct FileOpInfo *fileOpInfo = NULL;
+    char hist[HAL_FLASH_STATS_HIST_BINS * 6 + 1] = {0};
+    int len = 0;
 
+    for (int i = 0; i < HAL_FLASH_STATS_HIST_BINS; i++) {
+        int ret = snprintf_s(hist + len, sizeof(hist) - len, sizeof(hist) - len - 1, " %u", op->hist[i]);
+        if (ret < 0) {
+            break;
+        }
+        len += ret;
+    }
+    HDF_LOGI("%-8s cnt=%u err=%u bytes=%llu us min/avg/max=%u/%u/%u hist(log2 us):%s", name, op->count,
+             op->errors, (unsigned long long)op->bytes, op->min_us, (op->count != 0) ? (uint32_t)(op->total_us / op->count) : 0,
+             op->max_us, hist);
+}
+
+/* Dump flash statistics to HiLog, hal_flash write bytes over littlefs prog bytes is the write amplification. */
+void FsFlashStatsDump(void)
+{
+    static const char *flashOps[HAL_FLASH_OP_MAX] = { "read", "write", "write_r", "erase" };
+    static const char *lfsOps[LFS_STATS_OP_MAX] = { "lfs_read", "lfs_prog", "lfs_ers", "lfs_sync" };
+    hal_flash_stats_t flashStats;
+    hal_flash_op_stats_t lfsStats[LFS_STATS_OP_MAX];
+
+    hal_flash_stats_get(&flashStats);
+    littlefs_stats_get(lfsStats);
+    HDF_LOGI("hal_flash statistics kept across %u boots", flashStats.boots);
+    for (int i = 0; i < HAL_FLASH_OP_MAX; i++) {
+        FsDumpOpStats(flashOps[i], &flashStats.op[i]);
+    }
+    HDF_LOGI("erase suspends=%u suspend max=%u us resume avg/max=%u/%u us", flashStats.suspends,
+             flashStats.suspend_max_us,
+             (flashStats.suspends != 0) ? (uint32_t)(flashStats.resume_total_us / flashStats.suspends) : 0,
+             flashStats.resume_max_us);
+    for (int i = 0; i < LFS_STATS_OP_MAX; i++) {
+        FsDumpOpStats(lfsOps[i], &lfsStats[i]);
+    }
+}
+
+#if (LOSCFG_USE_SHELL == 1)
+static UINT32 FsFlashStatsCmd(UINT32 argc, const CHAR **argv)
+{
+    if ((argc == 1) && (strcmp(argv[0], "reset") == 0)) {
+        hal_flash_stats_reset();
+        littlefs_stats_reset();
+        return LOS_OK;
+    }
+    FsFlashStatsDump();
+    return LOS_OK;
+}
+#endif
+#endif
+
+static int32_t FsDriverInit(struct HdfDeviceObject *object)
+{
     if (object == NULL) {
         return HDF_FAILURE;
     }
@@ -85,7 +297,7 @@ static int32_t FsDriverInit(struct HdfDeviceObject *object)
         }
     }
 
-    for (int i = 0; i < sizeof(fs) / sizeof(fs[0]); i++) {
+    for (int i = 0; i < LOSCFG_LFS_MAX_MOUNT_SIZE; i++) {
         if (fs[i].mount_point == NULL) {
             continue;
         }
@@ -94,11 +306,9 @@ static int32_t FsDriverInit(struct HdfDeviceObject *object)
         fs[i].lfs_cfg.erase = littlefs_block_erase;
         fs[i].lfs_cfg.sync  = littlefs_block_sync;
 
-        fs[i].lfs_cfg.read_size = LFS_CFG_READ_SIZE;
-        fs[i].lfs_cfg.prog_size = LFS_CFG_PROG_SIZE;
-        fs[i].lfs_cfg.cache_size = LFS_CFG_CACHE_SIZE;
-        fs[i].lfs_cfg.lookahead_size = LFS_CFG_LOOKAHEAD_SIZE;
-        fs[i].lfs_cfg.block_cycles = LFS_CFG_BLOCK_CYCLES;
+        if (FsTuneConfig(&fs[i]) != HDF_SUCCESS) {
+            continue;
+        }
 
         littlefs_flash_init(&fs[i].lfs_cfg);
 
@@ -116,6 +326,12 @@ static int32_t FsDriverInit(struct HdfDeviceObject *object)
         }
     }
 
+#if (LFS_PRE_ERASE_ENABLE == 1)
+    FsPreEraseStart();
+#endif
+#if (HAL_FLASH_STATS_ENABLE == 1) && (LOSCFG_USE_SHELL == 1)
+    (void)osCmdReg(CMD_TYPE_EX, "flashstat", XARGS, (CmdCallBackFunc)FsFlashStatsCmd);
+#endif
     return HDF_SUCCESS;
 }
 
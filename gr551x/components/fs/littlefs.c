@@ -12,14 +12,432 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <stdlib.h>
+#include <string.h>
 #include "littlefs.h"
 #include "gr55xx_hal.h"
-#include "hal_flash.h"
+#include "hal_flash_ext.h"
+#include "hal_flash_sched.h"
 #include "hdf_log.h"
+#include "los_mux.h"
+#include "los_task.h"
 
 #define SIZE_TO_KB 1024
 static uint32_t g_lfs_start_addr;
 
+#if (LFS_XIP_READ_ENABLE == 1)
+/* Plain-text partitions are read straight from the XIP window instead of through QSPI commands. */
+static bool g_lfs_xip_read;
+#define LFS_XIP_READ()          (g_lfs_xip_read)
+#else
+#define LFS_XIP_READ()          (false)
+#endif
+
+static uint32_t lfs_flash_read(uint32_t addr, uint8_t *buf, uint32_t size)
+{
+#if (LFS_XIP_READ_ENABLE == 1)
+    if (g_lfs_xip_read) {
+        memcpy(buf, (const void *)addr, size);
+        return size;
+    }
+#endif
+    return hal_flash_ext_read(addr, buf, size);
+}
+
+/* Drop XIP cache lines that may still hold the old content of a programmed or erased range. */
+static void lfs_flash_changed(void)
+{
+#if (LFS_XIP_READ_ENABLE == 1)
+    if (g_lfs_xip_read) {
+        ll_xqspi_enable_cache_flush(XQSPI);
+        ll_xqspi_disable_cache_flush(XQSPI);
+    }
+#endif
+}
+
+static uint32_t lfs_flash_write(uint32_t addr, const uint8_t *buf, uint32_t size)
+{
+    uint32_t ret = hal_flash_ext_write(addr, buf, size);
+
+    lfs_flash_changed();
+    return ret;
+}
+
+static bool lfs_flash_erase(uint32_t addr, uint32_t size)
+{
+    bool ret = hal_flash_ext_erase(addr, size);
+
+    lfs_flash_changed();
+    return ret;
+}
+
+#if (LFS_BLOCK_CACHE_PAGES > 0)
+#define LFS_CACHE_PAGE_SIZE     EXFLASH_SIZE_PAGE_BYTES
+#define LFS_CACHE_PAGE_MASK     (LFS_CACHE_PAGE_SIZE - 1)
+#define LFS_CACHE_ADDR_INVALID  0xFFFFFFFF
+
+/*
+ * One cached flash page. [dirty_start, dirty_end) is the range progged by littlefs but not yet written to flash,
+ * seq orders dirty ranges by when they were progged (0 when clean). Ranges are written back oldest first, so flash
+ * sees progs in the order littlefs issued them whatever page gets evicted.
+ */
+struct lfs_cache_page {
+    uint32_t addr;
+    uint32_t lru;
+    uint32_t seq;
+    uint16_t dirty_start;
+    uint16_t dirty_end;
+    uint8_t  data[LFS_CACHE_PAGE_SIZE];
+};
+
+static struct lfs_cache_page g_lfs_cache[LFS_BLOCK_CACHE_PAGES];
+static uint32_t g_lfs_cache_tick;
+static uint32_t g_lfs_cache_seq;    /* seq of the most recently dirtied range */
+
+static void lfs_cache_reset(void)
+{
+    for (int i = 0; i < LFS_BLOCK_CACHE_PAGES; i++) {
+        g_lfs_cache[i].addr = LFS_CACHE_ADDR_INVALID;
+        g_lfs_cache[i].lru = 0;
+        g_lfs_cache[i].seq = 0;
+        g_lfs_cache[i].dirty_start = 0;
+        g_lfs_cache[i].dirty_end = 0;
+    }
+    g_lfs_cache_tick = 0;
+    g_lfs_cache_seq = 0;
+}
+
+static int32_t lfs_cache_flush_page(struct lfs_cache_page *page)
+{
+    uint32_t size = page->dirty_end - page->dirty_start;
+
+    if (size != 0) {
+        if (size != lfs_flash_write(page->addr + page->dirty_start, &page->data[page->dirty_start], size)) {
+            return LFS_ERR_IO;
+        }
+    }
+    page->seq = 0;
+    page->dirty_start = 0;
+    page->dirty_end = 0;
+    return LFS_ERR_OK;
+}
+
+/* Write back every dirty range progged no later than seq, oldest first. */
+static int32_t lfs_cache_flush_upto(uint32_t seq)
+{
+    for (;;) {
+        struct lfs_cache_page *oldest = NULL;
+
+        for (int i = 0; i < LFS_BLOCK_CACHE_PAGES; i++) {
+            if ((g_lfs_cache[i].seq != 0) && (g_lfs_cache[i].seq <= seq) &&
+                ((oldest == NULL) || (g_lfs_cache[i].seq < oldest->seq))) {
+                oldest = &g_lfs_cache[i];
+            }
+        }
+        if (oldest == NULL) {
+            return LFS_ERR_OK;
+        }
+        if (lfs_cache_flush_page(oldest) != LFS_ERR_OK) {
+            return LFS_ERR_IO;
+        }
+    }
+}
+
+static struct lfs_cache_page *lfs_cache_lookup(uint32_t page_addr)
+{
+    for (int i = 0; i < LFS_BLOCK_CACHE_PAGES; i++) {
+        if (g_lfs_cache[i].addr == page_addr) {
+            g_lfs_cache[i].lru = ++g_lfs_cache_tick;
+            return &g_lfs_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/* Take the least recently used page for page_addr, writing back its dirty range and any older one first. */
+static struct lfs_cache_page *lfs_cache_alloc(uint32_t page_addr)
+{
+    struct lfs_cache_page *victim = &g_lfs_cache[0];
+
+    for (int i = 0; i < LFS_BLOCK_CACHE_PAGES; i++) {
+        if (g_lfs_cache[i].addr == LFS_CACHE_ADDR_INVALID) {
+            victim = &g_lfs_cache[i];
+            break;
+        }
+        if (g_lfs_cache[i].lru < victim->lru) {
+            victim = &g_lfs_cache[i];
+        }
+    }
+    if ((victim->seq != 0) && (lfs_cache_flush_upto(victim->seq) != LFS_ERR_OK)) {
+        return NULL;
+    }
+    victim->addr = page_addr;
+    victim->lru = ++g_lfs_cache_tick;
+    return victim;
+}
+
+static struct lfs_cache_page *lfs_cache_load(uint32_t page_addr)
+{
+    struct lfs_cache_page *page = lfs_cache_alloc(page_addr);
+
+    if (page == NULL) {
+        return NULL;
+    }
+    if (LFS_CACHE_PAGE_SIZE != lfs_flash_read(page_addr, page->data, LFS_CACHE_PAGE_SIZE)) {
+        page->addr = LFS_CACHE_ADDR_INVALID;
+        return NULL;
+    }
+    return page;
+}
+
+static int32_t lfs_cache_read(uint32_t addr, uint8_t *buf, uint32_t size)
+{
+    while (size > 0) {
+        uint32_t page_addr = addr & ~LFS_CACHE_PAGE_MASK;
+        uint32_t offset = addr - page_addr;
+        uint32_t len = lfs_min(size, LFS_CACHE_PAGE_SIZE - offset);
+        struct lfs_cache_page *page = lfs_cache_lookup(page_addr);
+
+        if (page != NULL) {
+            memcpy(buf, &page->data[offset], len);
+        } else if ((len == LFS_CACHE_PAGE_SIZE) || LFS_XIP_READ()) {
+            /* Whole-page streaming reads and mapped reads bypass the cache so they do not evict hot metadata. */
+            if (len != lfs_flash_read(addr, buf, len)) {
+                return LFS_ERR_IO;
+            }
+        } else {
+            page = lfs_cache_load(page_addr);
+            if (page == NULL) {
+                return LFS_ERR_IO;
+            }
+            memcpy(buf, &page->data[offset], len);
+        }
+        addr += len;
+        buf  += len;
+        size -= len;
+    }
+    return LFS_ERR_OK;
+}
+
+static int32_t lfs_cache_prog(uint32_t addr, const uint8_t *buf, uint32_t size)
+{
+    while (size > 0) {
+        uint32_t page_addr = addr & ~LFS_CACHE_PAGE_MASK;
+        uint32_t offset = addr - page_addr;
+        uint32_t len = lfs_min(size, LFS_CACHE_PAGE_SIZE - offset);
+        struct lfs_cache_page *page = lfs_cache_lookup(page_addr);
+
+        if (page == NULL) {
+            page = (len == LFS_CACHE_PAGE_SIZE) ? lfs_cache_alloc(page_addr) : lfs_cache_load(page_addr);
+            if (page == NULL) {
+                return LFS_ERR_IO;
+            }
+        }
+        /*
+         * Only a contiguous dirty range is tracked, and merging into a range that is not the latest would write
+         * this prog ahead of later ones on other pages. Write back up to the range first in both cases.
+         */
+        if ((page->seq != 0) && ((page->seq != g_lfs_cache_seq) ||
+            (offset > page->dirty_end) || (offset + len < page->dirty_start))) {
+            if (lfs_cache_flush_upto(page->seq) != LFS_ERR_OK) {
+                return LFS_ERR_IO;
+            }
+        }
+        memcpy(&page->data[offset], buf, len);
+        if (page->seq == 0) {
+            page->seq = ++g_lfs_cache_seq;
+            page->dirty_start = offset;
+            page->dirty_end = offset + len;
+        } else {
+            page->dirty_start = lfs_min(page->dirty_start, offset);
+            page->dirty_end = lfs_max(page->dirty_end, offset + len);
+        }
+        addr += len;
+        buf  += len;
+        size -= len;
+    }
+    return LFS_ERR_OK;
+}
+
+static void lfs_cache_invalidate(uint32_t addr, uint32_t size)
+{
+    for (int i = 0; i < LFS_BLOCK_CACHE_PAGES; i++) {
+        if ((g_lfs_cache[i].addr != LFS_CACHE_ADDR_INVALID) &&
+            (g_lfs_cache[i].addr >= addr) && (g_lfs_cache[i].addr < addr + size)) {
+            g_lfs_cache[i].addr = LFS_CACHE_ADDR_INVALID;
+            g_lfs_cache[i].lru = 0;
+            g_lfs_cache[i].seq = 0;
+            g_lfs_cache[i].dirty_start = 0;
+            g_lfs_cache[i].dirty_end = 0;
+        }
+    }
+}
+
+static int32_t lfs_cache_sync(void)
+{
+    if (lfs_cache_flush_upto(g_lfs_cache_seq) != LFS_ERR_OK) {
+        return LFS_ERR_IO;
+    }
+    /* Everything is clean, restart the numbering so it never wraps. */
+    g_lfs_cache_seq = 0;
+    return LFS_ERR_OK;
+}
+#endif
+
+#if (LFS_PRE_ERASE_ENABLE == 1) || (LFS_XIP_READ_ENABLE == 1)
+#define LFS_GLUE_SHADOW_ENABLE
+#define LFS_BLOCK_NONE          ((lfs_block_t)-1)
+
+static uint32_t g_lfs_mux;
+
+#define LFS_GLUE_LOCK()         LOS_MuxPend(g_lfs_mux, LOS_WAIT_FOREVER)
+#define LFS_GLUE_UNLOCK()       LOS_MuxPost(g_lfs_mux)
+#else
+#define LFS_GLUE_LOCK()
+#define LFS_GLUE_UNLOCK()
+#endif
+
+#if (LFS_PRE_ERASE_ENABLE == 1)
+#define LFS_PRE_ERASE_MAP_SIZE  ((LFS_PRE_ERASE_MAX_BLOCKS + 7) / 8)
+
+/* Blocks erased ahead of time and not touched by littlefs since. */
+static uint8_t  g_lfs_pre_erased[LFS_PRE_ERASE_MAP_SIZE];
+/* Bumped on every block callback from littlefs, a pre-erase pass is dropped if it changed meanwhile. */
+static uint32_t g_lfs_gen;
+/* Set by progs and erases, cleared by sync: blocks of the commit in flight are not reachable from flash yet. */
+static bool     g_lfs_unsynced;
+
+#define LFS_MAP_TEST(map, b)    (((map)[(b) >> 3] >> ((b) & 7)) & 1)
+#define LFS_MAP_SET(map, b)     ((map)[(b) >> 3] |= (uint8_t)(1 << ((b) & 7)))
+#define LFS_MAP_CLR(map, b)     ((map)[(b) >> 3] &= (uint8_t)~(1 << ((b) & 7)))
+
+#endif
+
+#ifdef LFS_GLUE_SHADOW_ENABLE
+/*
+ * Copy of a mounted instance for the glue's own lookups. It has private caches and a private config whose
+ * callbacks read through the glue without counting as littlefs activity and refuse to write, and its mlist
+ * holds private copies of the open files or nothing. Nothing of the mounted instance is touched through it.
+ */
+struct lfs_shadow {
+    lfs_t lfs;
+    struct lfs_config cfg;
+    void *buffer;
+};
+
+static int32_t lfs_glue_read(uint32_t addr, uint8_t *buf, uint32_t size);
+
+static int lfs_shadow_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buf, lfs_size_t size)
+{
+    int32_t ret;
+
+    LFS_GLUE_LOCK();
+    ret = lfs_glue_read(g_lfs_start_addr + c->block_size * block + off, buf, size);
+    LFS_GLUE_UNLOCK();
+    return ret;
+}
+
+static int lfs_shadow_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+                           const void *buf, lfs_size_t size)
+{
+    (void)c;
+    (void)block;
+    (void)off;
+    (void)buf;
+    (void)size;
+    return LFS_ERR_IO;
+}
+
+static int lfs_shadow_erase(const struct lfs_config *c, lfs_block_t block)
+{
+    (void)c;
+    (void)block;
+    return LFS_ERR_IO;
+}
+
+static int lfs_shadow_sync(const struct lfs_config *c)
+{
+    (void)c;
+    return LFS_ERR_OK;
+}
+
+/*
+ * Snapshot lfs into shadow, with copies of its open files if with_files is set. Called with the glue lock
+ * and the scheduler lock held, so no callback and no other task is in the middle of changing lfs.
+ */
+static int lfs_shadow_init(struct lfs_shadow *shadow, const lfs_t *lfs, bool with_files)
+{
+    lfs_size_t cache_size = lfs->cfg->cache_size;
+    uint32_t files = 0;
+
+    if (with_files) {
+        for (const struct lfs_mlist *m = lfs->mlist; m != NULL; m = m->next) {
+            files += (m->type == LFS_TYPE_REG) ? 1 : 0;
+        }
+    }
+    shadow->buffer = malloc(cache_size * 2 + files * sizeof(lfs_file_t));
+    if (shadow->buffer == NULL) {
+        return LFS_ERR_NOMEM;
+    }
+
+    shadow->lfs = *lfs;
+    shadow->cfg = *lfs->cfg;
+    shadow->cfg.read = lfs_shadow_read;
+    shadow->cfg.prog = lfs_shadow_prog;
+    shadow->cfg.erase = lfs_shadow_erase;
+    shadow->cfg.sync = lfs_shadow_sync;
+    shadow->lfs.cfg = &shadow->cfg;
+    shadow->lfs.rcache.buffer = (uint8_t *)shadow->buffer;
+    shadow->lfs.rcache.block = LFS_BLOCK_NONE;
+    shadow->lfs.pcache.buffer = (uint8_t *)shadow->buffer + cache_size;
+    shadow->lfs.pcache.block = LFS_BLOCK_NONE;
+    shadow->lfs.mlist = NULL;
+
+    /* littlefs finds blocks of files being written through mlist, only regular files hold any. */
+    lfs_file_t *copy = (lfs_file_t *)((uint8_t *)shadow->buffer + cache_size * 2);
+    for (const struct lfs_mlist *m = lfs->mlist; (m != NULL) && (files != 0); m = m->next) {
+        if (m->type == LFS_TYPE_REG) {
+            *copy = *(const lfs_file_t *)m;
+            copy->next = (lfs_file_t *)shadow->lfs.mlist;
+            shadow->lfs.mlist = (struct lfs_mlist *)copy;
+            copy++;
+        }
+    }
+    return LFS_ERR_OK;
+}
+
+static void lfs_shadow_deinit(struct lfs_shadow *shadow)
+{
+    free(shadow->buffer);
+    shadow->buffer = NULL;
+}
+#endif
+
+#if (HAL_FLASH_STATS_ENABLE == 1)
+static hal_flash_op_stats_t g_lfs_stats[LFS_STATS_OP_MAX];
+
+#define LFS_STATS_BEGIN()               uint32_t stats_start = hal_flash_stats_timestamp()
+#define LFS_STATS_END(op, bytes, ret)   \
+    hal_flash_stats_update(&g_lfs_stats[op], stats_start, ((ret) == LFS_ERR_OK) ? (bytes) : 0, (ret) == LFS_ERR_OK)
+
+void littlefs_stats_get(hal_flash_op_stats_t stats[LFS_STATS_OP_MAX])
+{
+    LFS_GLUE_LOCK();
+    memcpy(stats, g_lfs_stats, sizeof(g_lfs_stats));
+    LFS_GLUE_UNLOCK();
+}
+
+void littlefs_stats_reset(void)
+{
+    LFS_GLUE_LOCK();
+    memset(g_lfs_stats, 0, sizeof(g_lfs_stats));
+    LFS_GLUE_UNLOCK();
+}
+#else
+#define LFS_STATS_BEGIN()
+#define LFS_STATS_END(op, bytes, ret)
+#endif
+
 int32_t littlefs_flash_init(const struct lfs_config *cfg)
 {
     uint32_t flash_id;
@@ -31,36 +449,240 @@ int32_t littlefs_flash_init(const struct lfs_config *cfg)
     nvds_start_addr = EXFLASH_START_ADDR + flash_size - hal_flash_sector_size() * NVDS_NUM_SECTOR;
     g_lfs_start_addr  = nvds_start_addr - cfg->block_count * cfg->block_size;
 
-    HDF_LOGI("littlefs flash start addr=0x%x, all size=%dKB", g_lfs_start_addr,
-             cfg->block_count * cfg->block_size / SIZE_TO_KB);
+#if (LFS_BLOCK_CACHE_PAGES > 0)
+    lfs_cache_reset();
+#endif
+#if (LFS_XIP_READ_ENABLE == 1)
+    g_lfs_xip_read = !hal_flash_get_security();
+#endif
+#ifdef LFS_GLUE_SHADOW_ENABLE
+    if ((g_lfs_mux == 0) && (LOS_MuxCreate(&g_lfs_mux) != LOS_OK)) {
+        HDF_LOGE("littlefs glue mutex create failed");
+        return -1;
+    }
+#endif
+#if (LFS_PRE_ERASE_ENABLE == 1)
+    memset(g_lfs_pre_erased, 0, sizeof(g_lfs_pre_erased));
+    g_lfs_unsynced = false;
+#endif
+
+    HDF_LOGI("littlefs flash start addr=0x%x, all size=%dKB, xip read %d", g_lfs_start_addr,
+             cfg->block_count * cfg->block_size / SIZE_TO_KB, LFS_XIP_READ());
 
     return 0;
 }
 
+static int32_t lfs_glue_read(uint32_t addr, uint8_t *buf, uint32_t size)
+{
+#if (LFS_BLOCK_CACHE_PAGES > 0)
+    return lfs_cache_read(addr, buf, size);
+#else
+    return size == lfs_flash_read(addr, buf, size) ? LFS_ERR_OK : LFS_ERR_IO;
+#endif
+}
+
 int32_t littlefs_block_read(const struct lfs_config *c, lfs_block_t block,
                             lfs_off_t off, uint8_t *buf, lfs_size_t size)
 {
     uint32_t addr = g_lfs_start_addr + c->block_size * block + off;
+    int32_t ret;
+    LFS_STATS_BEGIN();
 
-    return size == hal_flash_read(addr, buf, size) ? LFS_ERR_OK : LFS_ERR_IO;
+    LFS_GLUE_LOCK();
+#if (LFS_PRE_ERASE_ENABLE == 1)
+    g_lfs_gen++;
+#endif
+    ret = lfs_glue_read(addr, buf, size);
+    LFS_GLUE_UNLOCK();
+    LFS_STATS_END(LFS_STATS_READ, size, ret);
+    return ret;
 }
 
 int32_t littlefs_block_write(const struct lfs_config *c, lfs_block_t block,
                              lfs_off_t off, const uint8_t *dst, lfs_size_t size)
 {
     uint32_t addr = g_lfs_start_addr + c->block_size * block + off;
+    int32_t ret;
+    LFS_STATS_BEGIN();
 
-    return size == hal_flash_write(addr, dst, size) ? LFS_ERR_OK : LFS_ERR_IO;
+    LFS_GLUE_LOCK();
+#if (LFS_PRE_ERASE_ENABLE == 1)
+    g_lfs_gen++;
+    g_lfs_unsynced = true;
+    if (block < LFS_PRE_ERASE_MAX_BLOCKS) {
+        LFS_MAP_CLR(g_lfs_pre_erased, block);
+    }
+#endif
+#if (LFS_BLOCK_CACHE_PAGES > 0)
+    ret = lfs_cache_prog(addr, dst, size);
+#else
+    ret = size == lfs_flash_write(addr, dst, size) ? LFS_ERR_OK : LFS_ERR_IO;
+#endif
+    LFS_GLUE_UNLOCK();
+    LFS_STATS_END(LFS_STATS_PROG, size, ret);
+    return ret;
 }
 
 int32_t littlefs_block_erase(const struct lfs_config *c, lfs_block_t block)
 {
     uint32_t addr = g_lfs_start_addr + block * c->block_size;
+    int32_t ret;
+    LFS_STATS_BEGIN();
 
-    return hal_flash_erase (addr, c->block_size) ? LFS_ERR_OK : LFS_ERR_IO;
+    LFS_GLUE_LOCK();
+#if (LFS_BLOCK_CACHE_PAGES > 0)
+    lfs_cache_invalidate(addr, c->block_size);
+#endif
+#if (LFS_PRE_ERASE_ENABLE == 1)
+    g_lfs_gen++;
+    g_lfs_unsynced = true;
+    if ((block < LFS_PRE_ERASE_MAX_BLOCKS) && LFS_MAP_TEST(g_lfs_pre_erased, block)) {
+        /* Already erased in the background, littlefs now owns the block again. */
+        LFS_MAP_CLR(g_lfs_pre_erased, block);
+        ret = LFS_ERR_OK;
+    } else {
+        ret = lfs_flash_erase(addr, c->block_size) ? LFS_ERR_OK : LFS_ERR_IO;
+    }
+#else
+    ret = lfs_flash_erase(addr, c->block_size) ? LFS_ERR_OK : LFS_ERR_IO;
+#endif
+    LFS_GLUE_UNLOCK();
+    LFS_STATS_END(LFS_STATS_ERASE, c->block_size, ret);
+    return ret;
 }
 
 int32_t littlefs_block_sync(const struct lfs_config *c)
 {
+    int32_t ret = 0;
+    LFS_STATS_BEGIN();
+
+    LFS_GLUE_LOCK();
+#if (LFS_BLOCK_CACHE_PAGES > 0)
+    ret = lfs_cache_sync();
+#endif
+#if (LFS_PRE_ERASE_ENABLE == 1)
+    g_lfs_gen++;
+    g_lfs_unsynced = g_lfs_unsynced && (ret != LFS_ERR_OK);
+#endif
+    LFS_GLUE_UNLOCK();
+    LFS_STATS_END(LFS_STATS_SYNC, 0, ret);
+    return ret;
+}
+
+#if (LFS_PRE_ERASE_ENABLE == 1)
+static int lfs_pre_erase_mark_used(void *data, lfs_block_t block)
+{
+    if (block < LFS_PRE_ERASE_MAX_BLOCKS) {
+        LFS_MAP_SET((uint8_t *)data, block);
+    }
     return 0;
 }
+
+/*
+ * The free blocks are those a traversal of the flash and of the open files does not reach. That only holds
+ * between commits: blocks littlefs erased or progged since its last sync may belong to a commit in flight,
+ * so no pass starts then. The traversal runs without the glue lock and every erase checks that littlefs
+ * did not call back meanwhile, which also catches a foreground task that was waiting in a callback.
+ */
+int32_t littlefs_pre_erase(lfs_t *lfs, const struct lfs_config *c, uint32_t max_erase)
+{
+    uint8_t used[LFS_PRE_ERASE_MAP_SIZE] = {0};
+    uint32_t count = lfs_min(c->block_count, LFS_PRE_ERASE_MAX_BLOCKS);
+    uint32_t erased = 0;
+    uint32_t gen = 0;
+    struct lfs_shadow shadow;
+    int err = LFS_ERR_OK;
+    bool unsynced;
+
+    LFS_GLUE_LOCK();
+    LOS_TaskLock();
+    unsynced = g_lfs_unsynced;
+    if (!unsynced) {
+        err = lfs_shadow_init(&shadow, lfs, true);
+        gen = g_lfs_gen;
+    }
+    LOS_TaskUnlock();
+    LFS_GLUE_UNLOCK();
+    if (unsynced) {
+        return 0;
+    }
+    if (err < 0) {
+        return err;
+    }
+    err = lfs_fs_traverse(&shadow.lfs, lfs_pre_erase_mark_used, used);
+    lfs_shadow_deinit(&shadow);
+    if (err < 0) {
+        return err;
+    }
+
+    for (lfs_block_t block = 0; (block < count) && (erased < max_erase); block++) {
+        if (LFS_MAP_TEST(used, block) || LFS_MAP_TEST(g_lfs_pre_erased, block)) {
+            continue;
+        }
+        LFS_GLUE_LOCK();
+        /* The rest waits for the next pass rather than stall a radio event. */
+        if ((gen != g_lfs_gen) || !hal_flash_sched_gap_fits(HAL_FLASH_JOB_ERASE, c->block_size)) {
+            LFS_GLUE_UNLOCK();
+            break;
+        }
+        uint32_t addr = g_lfs_start_addr + block * c->block_size;
+#if (LFS_BLOCK_CACHE_PAGES > 0)
+        lfs_cache_invalidate(addr, c->block_size);
+#endif
+        if (lfs_flash_erase(addr, c->block_size)) {
+            LFS_MAP_SET(g_lfs_pre_erased, block);
+            erased++;
+        }
+        LFS_GLUE_UNLOCK();
+    }
+    return (int32_t)erased;
+}
+#endif
+
+#if (LFS_XIP_READ_ENABLE == 1)
+/*
+ * The lookup runs on a shadow with an empty mlist while the glue lock is held, so littlefs cannot change the
+ * flash until it is done. A foreground operation that is waiting in a callback may have half written a commit,
+ * littlefs ignores that on fetch like it does after a power loss.
+ */
+int32_t littlefs_map(lfs_t *lfs, const char *path, lfs_off_t off, const void **addr, lfs_size_t *size)
+{
+    const struct lfs_config *c = lfs->cfg;
+    lfs_file_t file;
+    struct lfs_shadow shadow;
+    uint8_t byte;
+    int32_t ret;
+
+    if (!g_lfs_xip_read) {
+        return LFS_ERR_INVAL;
+    }
+
+    LFS_GLUE_LOCK();
+    LOS_TaskLock();
+    ret = lfs_shadow_init(&shadow, lfs, false);
+    LOS_TaskUnlock();
+    if (ret < 0) {
+        LFS_GLUE_UNLOCK();
+        return ret;
+    }
+    ret = lfs_file_open(&shadow.lfs, &file, path, LFS_O_RDONLY);
+    if (ret == LFS_ERR_OK) {
+        if ((file.flags & LFS_F_INLINE) || (off >= file.ctz.size)) {
+            /* Inline data lives inside a metadata pair and is not contiguous. */
+            ret = LFS_ERR_INVAL;
+        } else if ((lfs_file_seek(&shadow.lfs, &file, off, LFS_SEEK_SET) < 0) ||
+                   (lfs_file_read(&shadow.lfs, &file, &byte, 1) != 1)) {
+            ret = LFS_ERR_CORRUPT;
+        } else {
+            /* After the read, file.block/file.off sit one byte past the data at off. */
+            lfs_off_t block_off = file.off - 1;
+            *addr = (const void *)(g_lfs_start_addr + file.block * c->block_size + block_off);
+            *size = lfs_min(c->block_size - block_off, file.ctz.size - off);
+        }
+        (void)lfs_file_close(&shadow.lfs, &file);
+    }
+    LFS_GLUE_UNLOCK();
+    lfs_shadow_deinit(&shadow);
+    return ret;
+}
+#endif
@@ -16,6 +16,27 @@
 #define __FS_LITTLEFS_H__
 
 #include "lfs.h"
+#include "hal_flash_ext.h"
+
+/* Number of 256 B flash pages cached under the littlefs block callbacks, 0 disables the cache. */
+#ifndef LFS_BLOCK_CACHE_PAGES
+#define LFS_BLOCK_CACHE_PAGES   8
+#endif
+
+/* Erase free blocks from a low priority task so littlefs does not pay the erase inline. */
+#ifndef LFS_PRE_ERASE_ENABLE
+#define LFS_PRE_ERASE_ENABLE    1
+#endif
+
+/* Blocks beyond this index are never pre-erased. */
+#ifndef LFS_PRE_ERASE_MAX_BLOCKS
+#define LFS_PRE_ERASE_MAX_BLOCKS    256
+#endif
+
+/* Read unencrypted partitions through the memory-mapped XIP window. */
+#ifndef LFS_XIP_READ_ENABLE
+#define LFS_XIP_READ_ENABLE     1
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +51,43 @@ int32_t littlefs_block_write(const struct lfs_config *c, lfs_block_t block,
 int32_t littlefs_block_erase(const struct lfs_config *c, lfs_block_t block);
 int32_t littlefs_block_sync(const struct lfs_config *c);
 
+#if (LFS_PRE_ERASE_ENABLE == 1)
+/* Erase up to max_erase free blocks of a mounted littlefs, returns the number erased or a LFS_ERR_*. */
+int32_t littlefs_pre_erase(lfs_t *lfs, const struct lfs_config *c, uint32_t max_erase);
+#endif
+
+#if (LFS_XIP_READ_ENABLE == 1)
+/*
+ * Map a file read-only. On success *addr points at the XIP address of byte off and *size is the
+ * number of bytes contiguous from there, bounded by the littlefs block and the end of file.
+ * The mapping stays valid until the file is written or removed.
+ */
+int32_t littlefs_map(lfs_t *lfs, const char *path, lfs_off_t off, const void **addr, lfs_size_t *size);
+#endif
+
+#if (HAL_FLASH_STATS_ENABLE == 1)
+enum littlefs_stats_op {
+    LFS_STATS_READ,
+    LFS_STATS_PROG,
+    LFS_STATS_ERASE,
+    LFS_STATS_SYNC,
+    LFS_STATS_OP_MAX,
+};
+
+/*
+ * Statistics of the littlefs block callbacks, in the hal_flash format so both can be compared.
+ * Unlike the hal_flash statistics they are plain RAM and start from zero at every boot.
+ */
+void littlefs_stats_get(hal_flash_op_stats_t stats[LFS_STATS_OP_MAX]);
+void littlefs_stats_reset(void);
+
+/* Dump hal_flash and littlefs statistics to HiLog. Implemented in fs_init.c. */
+void FsFlashStatsDump(void);
+#endif
+
+/* Handle of the littlefs mounted on mountPoint, NULL if none. Implemented in fs_init.c. */
+lfs_t *FsGetLfsHandle(const char *mountPoint);
+
 #ifdef __cplusplus
 }
 #endif
@@ -173,7 +173,7 @@ typedef struct {
     app_qspi_evt_type_t type;    /**< Type of event. */
     union {
         uint32_t error_code;     /**< QSPI Error code . */
-        uint16_t size;           /**< QSPI transmitted/received counter. */
+        uint32_t size;           /**< QSPI transmitted/received counter, the whole length of a chained transfer. */
     } data;                      /**< Event data. */
 } app_qspi_evt_t;
 /** @} */
@@ -360,6 +360,42 @@ uint16_t app_qspi_receive_sync(app_qspi_id_t id, uint8_t *p_data, uint32_t lengt
  */
 uint16_t app_qspi_receive_async(app_qspi_id_t id, uint8_t *p_data, uint32_t length);
 
+/**
+ ****************************************************************************************
+ * @brief  Transmit data of any length in non-blocking mode, without a command.
+ *
+ * @note   The data is sent in blocks of up to the DMA block size, each started from the
+ *         completion interrupt of the one before. One APP_QSPI_EVT_TX_CPLT is reported for
+ *         the whole transfer. CS is held between blocks only when it is driven by software
+ *         (pin_cfg.cs enabled), so use that for devices that need one frame. A block that fails
+ *         to start or complete ends the transfer with one APP_QSPI_EVT_ERROR, whose error code
+ *         is never HAL_QSPI_ERROR_NONE.
+ *
+ * @param[in]  id: which QSPI module want to transmit.
+ * @param[in]  p_data: Pointer to data buffer
+ * @param[in]  length: Amount of data to be sent in bytes
+ *
+ * @return Result of operation.
+ ****************************************************************************************
+ */
+uint16_t app_qspi_transmit_large_async(app_qspi_id_t id, uint8_t *p_data, uint32_t length);
+
+/**
+ ****************************************************************************************
+ * @brief  Receive data of any length in non-blocking mode, without a command.
+ *
+ * @note   Chained as app_qspi_transmit_large_async, with one APP_QSPI_EVT_RX_DATA for the
+ *         whole transfer.
+ *
+ * @param[in]  id: which QSPI module want to receive.
+ * @param[out] p_data: Pointer to data buffer
+ * @param[in]  length: Amount of data to be received in bytes
+ *
+ * @return Result of operation.
+ ****************************************************************************************
+ */
+uint16_t app_qspi_receive_large_async(app_qspi_id_t id, uint8_t *p_data, uint32_t length);
+
 /**
  ****************************************************************************************
  * @brief  Return the QSPI handle.
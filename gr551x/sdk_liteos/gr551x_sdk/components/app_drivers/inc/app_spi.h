@@ -161,7 +161,7 @@ typedef struct {
     app_spi_evt_type_t  type; /**< Type of event. */
     union {
         uint32_t error_code;           /**< SPI Error code . */
-        uint16_t size;                 /**< SPI transmitted/received counter. */
+        uint32_t size;                 /**< SPI transmitted/received counter, the whole length of a chained transfer. */
     } data;                            /**< SPI data. */
 } app_spi_evt_t;
 
@@ -258,6 +258,41 @@ uint16_t app_spi_transmit_sync(app_spi_id_t id, uint8_t *p_data, uint16_t size,
  */
 uint16_t app_spi_transmit_async(app_spi_id_t id, uint8_t *p_data, uint16_t size);
 
+/**
+ ****************************************************************************************
+ * @brief  Transmit in master or slave mode an amount of data of any size in non-blocking mode.
+ *
+ * @note   The data is sent in blocks of up to the DMA block size, each started from the
+ *         completion interrupt of the one before. One APP_SPI_EVT_TX_CPLT is reported for
+ *         the whole transfer. CS is held between blocks when it is driven by software
+ *         (pin_cfg.cs enabled). A block that fails to start or complete ends the transfer with
+ *         one APP_SPI_EVT_ERROR, whose error code is never HAL_SPI_ERROR_NONE.
+ *
+ * @param[in]  id: which SPI module want to transmit.
+ * @param[in]  p_data: Pointer to data buffer
+ * @param[in]  size: Amount of data to be sent
+ *
+ * @return Result of operation.
+ ****************************************************************************************
+ */
+uint16_t app_spi_transmit_large_async(app_spi_id_t id, uint8_t *p_data, uint32_t size);
+
+/**
+ ****************************************************************************************
+ * @brief  Receive in master or slave mode an amount of data of any size in non-blocking mode.
+ *
+ * @note   Chained as app_spi_transmit_large_async, with one APP_SPI_EVT_RX_DATA for the
+ *         whole transfer.
+ *
+ * @param[in]  id: which SPI module want to receive.
+ * @param[in]  p_data: Pointer to data buffer
+ * @param[in]  size: Amount of data to be received
+ *
+ * @return Result of operation.
+ ****************************************************************************************
+ */
+uint16_t app_spi_receive_large_async(app_spi_id_t id, uint8_t *p_data, uint32_t size);
+
 /**
  ****************************************************************************************
  * @brief  Transmits and receive in master or slave mode an amount of data in blocking mode.
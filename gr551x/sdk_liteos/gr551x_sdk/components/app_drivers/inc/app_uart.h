@@ -169,6 +169,50 @@ typedef struct {
     uint8_t   *tx_buf;     /**< Pointer to the TX buffer. */
     uint32_t  tx_buf_size; /**< Size of the TX buffer. */
 } app_uart_tx_buf_t;
+
+/**
+  * @brief UART interrupt configuration structure definition
+  */
+typedef struct {
+    uint32_t  rx_fifo_threshold;  /**< RX FIFO level raising the data available interrupt.
+                                       This parameter can be a value of LL_UART_RX_FIFO_TH_xxx. */
+    uint32_t  tx_fifo_threshold;  /**< TX FIFO level raising the THR empty interrupt.
+                                       This parameter can be a value of LL_UART_TX_FIFO_TH_xxx. */
+    uint16_t  rx_block;           /**< Largest block the ring receive collects before reporting
+                                       APP_UART_EVT_RX_DATA, 0 for the default. */
+} app_uart_irq_cfg_t;
+
+/**
+  * @brief UART interrupt statistics structure definition
+  */
+typedef struct {
+    uint32_t  irq_count;          /**< UART interrupt entries. */
+    uint32_t  rx_events;          /**< APP_UART_EVT_RX_DATA reported. */
+    uint32_t  rx_bytes;           /**< Bytes reported by them. */
+    uint32_t  tx_events;          /**< TX transfers completed. */
+    uint32_t  tx_bytes;           /**< Bytes sent by them. */
+} app_uart_irq_stats_t;
+
+/**
+  * @brief UART TX descriptor structure definition
+  */
+typedef struct app_uart_tx_desc {
+    struct app_uart_tx_desc *p_next;                      /**< Queue link, owned by the driver. */
+    uint8_t                 *p_data;                      /**< Pointer to the data, sent in place. */
+    uint32_t                 size;                        /**< Size of the data. */
+    void                   (*release)(struct app_uart_tx_desc *p_desc); /**< Called once the data
+                                                               has been sent, or dropped by
+                                                               app_uart_deinit(). May be NULL. */
+    void                    *p_arg;                       /**< User context for release. */
+    uint32_t                 error_code;                  /**< Set by the driver before release:
+                                                               HAL_UART_ERROR_NONE once sent, the UART
+                                                               error code if a transfer of it failed,
+                                                               APP_UART_TX_DESC_DROPPED if dropped by
+                                                               app_uart_deinit(). */
+} app_uart_tx_desc_t;
+
+/** @brief error_code of a TX descriptor dropped by app_uart_deinit() before it was sent. */
+#define APP_UART_TX_DESC_DROPPED    0x80000000U
 /** @} */
 
 
@@ -215,6 +259,58 @@ uint16_t app_uart_deinit(app_uart_id_t id);
  */
 uint16_t app_uart_transmit_async(app_uart_id_t id, uint8_t *p_data, uint16_t size);
 
+/**
+ ****************************************************************************************
+ * @brief  Queue a buffer for transmission without copying it.
+ *
+ * @note   The descriptor and its data belong to the driver until release is called from
+ *         the UART interrupt (or from app_uart_flush()). Queued descriptors are sent back to
+ *         back, each in transfers of up to the DMA block size, straight from p_data.
+ *         Descriptors are served before data queued with app_uart_transmit_async(), by
+ *         app_uart_flush() too; order is kept within each of the two paths, not between
+ *         them. APP_UART_EVT_TX_CPLT is reported once both are empty. A transfer that fails
+ *         releases its descriptor with error_code set, reports APP_UART_EVT_ERROR, and the
+ *         queue goes on with the next one.
+ *         In DMA mode p_data must be in SRAM: the DMA cannot read flash through the XIP
+ *         cache, so descriptors pointing below GR55XX_RAM_ADDRESS are refused. Send flash
+ *         data with app_uart_transmit_async(), which copies it. Each descriptor takes at
+ *         least one completion interrupt, so writes of less than 128 bytes cost fewer
+ *         interrupts through the TX ring, which batches them.
+ *
+ * @param[in]  id:     which UART module want to transmit.
+ * @param[in]  p_desc: Pointer to the descriptor.
+ *
+ * @return Result of operation. On error the descriptor is not queued.
+ ****************************************************************************************
+ */
+uint16_t app_uart_transmit_desc_async(app_uart_id_t id, app_uart_tx_desc_t *p_desc);
+
+/**
+ ****************************************************************************************
+ * @brief  Return the free space in the TX buffer used by app_uart_transmit_async().
+ *
+ * @note   app_uart_transmit_async() queues only what fits, so callers that must not
+ *         lose data check the space first.
+ *
+ * @param[in]  id: UART Channel ID.
+ *
+ * @return Number of bytes that can be queued without truncation.
+ ****************************************************************************************
+ */
+uint32_t app_uart_transmit_space_get(app_uart_id_t id);
+
+/**
+ ****************************************************************************************
+ * @brief  Check whether data queued by app_uart_transmit_async() is still being sent.
+ *
+ * @param[in]  id: UART Channel ID.
+ *
+ * @return true until the TX buffer has been handed to the UART, which is reported by
+ *         APP_UART_EVT_TX_CPLT.
+ ****************************************************************************************
+ */
+bool app_uart_transmit_busy(app_uart_id_t id);
+
 /**
  ****************************************************************************************
  * @brief  Send an amount of data in blocking mode.
@@ -242,6 +338,63 @@ uint16_t app_uart_transmit_sync(app_uart_id_t id, uint8_t *p_data, uint16_t size
  */
 uint16_t app_uart_receive_async(app_uart_id_t id, uint8_t *p_data, uint16_t size);
 
+/**
+ ****************************************************************************************
+ * @brief  Start receiving continuously into a ring buffer.
+ *
+ * @note   Reception stays armed until app_uart_receive_ring_stop() or app_uart_deinit(), so
+ *         bytes arriving while nobody is reading are kept. Data is received in interrupt
+ *         mode straight into the ring, whatever the use_mode, because the receiver timeout
+ *         that publishes a partial block on an idle line is only available there; this
+ *         requires init.rx_timeout_mode = UART_RECEIVER_TIMEOUT_ENABLE. Each published
+ *         block is reported with APP_UART_EVT_RX_DATA and its size. When the ring is full,
+ *         reception pauses until the ring is read. app_uart_receive_async() is refused
+ *         while the ring receive runs, and the UART does not enter sleep.
+ *
+ * @param[in]  id:     which UART module want to receive.
+ * @param[in]  p_buf:  Pointer to ring buffer storage, which must stay valid until stopped.
+ * @param[in]  size:   Size of the ring buffer; one byte of it is never filled.
+ *
+ * @return Result of operation.
+ ****************************************************************************************
+ */
+uint16_t app_uart_receive_ring_start(app_uart_id_t id, uint8_t *p_buf, uint32_t size);
+
+/**
+ ****************************************************************************************
+ * @brief  Read received data out of the ring buffer without blocking.
+ *
+ * @param[in]  id:     which UART module want to read.
+ * @param[out] p_data: Pointer to data buffer
+ * @param[in]  size:   Maximum amount of data to be read
+ *
+ * @return Amount of data read, 0 if the ring is empty or not started.
+ ****************************************************************************************
+ */
+uint32_t app_uart_receive_ring_read(app_uart_id_t id, uint8_t *p_data, uint32_t size);
+
+/**
+ ****************************************************************************************
+ * @brief  Return the amount of received data waiting in the ring buffer.
+ *
+ * @param[in]  id: which UART module.
+ *
+ * @return Amount of data in the ring buffer.
+ ****************************************************************************************
+ */
+uint32_t app_uart_receive_ring_count(app_uart_id_t id);
+
+/**
+ ****************************************************************************************
+ * @brief  Stop the ring receive started by app_uart_receive_ring_start().
+ *
+ * @param[in]  id: which UART module.
+ *
+ * @return Result of operation.
+ ****************************************************************************************
+ */
+uint16_t app_uart_receive_ring_stop(app_uart_id_t id);
+
 /**
  ****************************************************************************************
  * @brief  Receive an amount of data in blocking mode.
@@ -256,6 +409,35 @@ uint16_t app_uart_receive_async(app_uart_id_t id, uint8_t *p_data, uint16_t size
  */
 uint16_t app_uart_receive_sync(app_uart_id_t id, uint8_t *p_data, uint16_t size, uint32_t timeout);
 
+/**
+ ****************************************************************************************
+ * @brief  Set the FIFO thresholds and the ring receive block size.
+ *
+ * @note   Higher RX thresholds and larger blocks mean fewer interrupts and events per byte,
+ *         at the cost of latency; the receiver timeout still reports a partial FIFO or block
+ *         once the line goes idle. The setting is kept across app_uart_init() and sleep.
+ *
+ * @param[in]  id:    UART Channel ID.
+ * @param[in]  p_cfg: Pointer to the configuration.
+ *
+ * @return Result of operation.
+ ****************************************************************************************
+ */
+uint16_t app_uart_irq_config(app_uart_id_t id, const app_uart_irq_cfg_t *p_cfg);
+
+/**
+ ****************************************************************************************
+ * @brief  Copy the interrupt counters of a UART.
+ *
+ * @param[in]  id:      UART Channel ID.
+ * @param[out] p_stats: Pointer to the counters.
+ * @param[in]  clear:   Reset the counters after copying them.
+ *
+ * @return Result of operation.
+ ****************************************************************************************
+ */
+uint16_t app_uart_irq_stats_get(app_uart_id_t id, app_uart_irq_stats_t *p_stats, bool clear);
+
 /**
  ****************************************************************************************
  * @brief  Return the UART handle.
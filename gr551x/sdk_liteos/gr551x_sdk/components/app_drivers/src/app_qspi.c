@@ -67,6 +67,10 @@
  */
 #define QSPI_QUAD_WRITE_DATA_ENDIAN_MODE            0u
 
+#ifndef APP_QSPI_XFER_BLOCK_MAX
+#define APP_QSPI_XFER_BLOCK_MAX                     4095u  /* DMA block size limit, larger transfers are chained */
+#endif
+
 /*
  * STRUCT DEFINE
  *****************************************************************************************
@@ -92,6 +96,9 @@ struct qspi_env_t {
     volatile uint8_t        rx_done;
     volatile uint8_t        tx_done;
     volatile uint8_t        user_mode;
+    uint8_t                *p_chain;            /**< Next block of a chained transfer. */
+    uint32_t                chain_left;         /**< Bytes not started yet. */
+    uint32_t                chain_size;         /**< Total size, 0 when not chaining. */
 
 #ifdef ENV_RTOS_USE_SEMP
     APP_DRV_SEM_DECL(sem_tx);
@@ -146,7 +153,7 @@ struct qspi_env_t s_qspi_env[APP_QSPI_ID_MAX] = {
     }
 };
 static bool       s_sleep_cb_registered_flag = false;
-static pwr_id_t   s_qspi_pwr_id;
+static int16_t    s_qspi_pwr_id;
 
 static const app_sleep_callbacks_t qspi_sleep_cb = {
     .app_prepare_for_sleep = qspi_prepare_for_sleep,
@@ -355,10 +362,41 @@ static uint16_t app_qspi_config_dma(app_qspi_params_t *p_params)
     return APP_DRV_SUCCESS;
 }
 
+static hal_status_t qspi_chain_next(app_qspi_id_t id, bool rx)
+{
+    uint8_t *p_data = s_qspi_env[id].p_chain;
+    uint32_t length = s_qspi_env[id].chain_left;
+    hal_status_t err_code = HAL_ERROR;
+
+    if (length > APP_QSPI_XFER_BLOCK_MAX) {
+        length = APP_QSPI_XFER_BLOCK_MAX;
+    }
+    s_qspi_env[id].p_chain    += length;
+    s_qspi_env[id].chain_left -= length;
+
+    switch (s_qspi_env[id].use_mode.type) {
+        case APP_QSPI_TYPE_INTERRUPT:
+            err_code = rx ? hal_qspi_receive_it(&s_qspi_env[id].handle, p_data, length) :
+                            hal_qspi_transmit_it(&s_qspi_env[id].handle, p_data, length);
+            break;
+
+        case APP_QSPI_TYPE_DMA:
+            err_code = rx ? hal_qspi_receive_dma(&s_qspi_env[id].handle, p_data, length) :
+                            hal_qspi_transmit_dma(&s_qspi_env[id].handle, p_data, length);
+            break;
+
+        default:
+            break;
+    }
+
+    return err_code;
+}
+
 static void app_qspi_event_call(qspi_handle_t *p_qspi, app_qspi_evt_type_t evt_type)
 {
     app_qspi_evt_t qspi_evt;
     app_qspi_id_t id = APP_QSPI_ID_MAX;
+    uint32_t chain_error = HAL_QSPI_ERROR_NONE;
 
     if (p_qspi->p_instance == QSPI0) {
         id = APP_QSPI_ID_0;
@@ -366,9 +404,19 @@ static void app_qspi_event_call(qspi_handle_t *p_qspi, app_qspi_evt_type_t evt_t
         id = APP_QSPI_ID_1;
     }
 
+    /* Start the next block of a chained transfer from here, no event is reported until the last one. */
+    if (((evt_type == APP_QSPI_EVT_TX_CPLT) || (evt_type == APP_QSPI_EVT_RX_DATA)) && s_qspi_env[id].chain_left) {
+        if (qspi_chain_next(id, evt_type == APP_QSPI_EVT_RX_DATA) == HAL_OK) {
+            return;
+        }
+        /* A block the HAL refused to start (busy, bad length) may leave its error code clear. */
+        evt_type = APP_QSPI_EVT_ERROR;
+        chain_error = (p_qspi->error_code != HAL_QSPI_ERROR_NONE) ? p_qspi->error_code : HAL_QSPI_ERROR_TRANSFER;
+    }
+
     qspi_evt.type = evt_type;
     if (evt_type == APP_QSPI_EVT_ERROR) {
-        qspi_evt.data.error_code = p_qspi->error_code;
+        qspi_evt.data.error_code = (chain_error != HAL_QSPI_ERROR_NONE) ? chain_error : p_qspi->error_code;
 #ifdef  ENV_RTOS_USE_SEMP
         if (!s_qspi_env[id].user_mode) {
             app_driver_sem_post_from_isr(s_qspi_env[id].sem_tx);
@@ -394,6 +442,11 @@ static void app_qspi_event_call(qspi_handle_t *p_qspi, app_qspi_evt_type_t evt_t
 #endif
         s_qspi_env[id].rx_done = 1;
     }
+    if (s_qspi_env[id].chain_size && (evt_type != APP_QSPI_EVT_ERROR)) {
+        qspi_evt.data.size = s_qspi_env[id].chain_size;
+    }
+    s_qspi_env[id].chain_left = 0;
+    s_qspi_env[id].chain_size = 0;
     s_qspi_env[id].start_flag = false;
     QSPI_SMART_CS_HIGH(id);
     if (s_qspi_env[id].evt_handler != NULL) {
@@ -1581,6 +1634,53 @@ uint16_t app_qspi_receive_async(app_qspi_id_t id, uint8_t *p_data, uint32_t leng
     return APP_DRV_SUCCESS;
 }
 
+static uint16_t qspi_chain_start(app_qspi_id_t id, uint8_t *p_data, uint32_t length, bool rx)
+{
+    hal_status_t err_code;
+
+    if (id >= APP_QSPI_ID_MAX ||
+            length == 0 ||
+            p_data == NULL ||
+            s_qspi_env[id].qspi_state == APP_QSPI_INVALID ||
+            s_qspi_env[id].use_mode.type == APP_QSPI_TYPE_POLLING) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+
+#ifdef APP_DRIVER_WAKEUP_CALL_FUN
+    qspi_wake_up(id);
+#endif
+
+    if (s_qspi_env[id].start_flag == false) {
+        s_qspi_env[id].start_flag = true;
+        s_qspi_env[id].p_chain    = p_data;
+        s_qspi_env[id].chain_left = length;
+        s_qspi_env[id].chain_size = length;
+        QSPI_SMART_CS_LOW(id);
+        err_code = qspi_chain_next(id, rx);
+        if (err_code != HAL_OK) {
+            QSPI_SMART_CS_HIGH(id);
+            s_qspi_env[id].chain_left = 0;
+            s_qspi_env[id].chain_size = 0;
+            s_qspi_env[id].start_flag = false;
+            return (uint16_t)err_code;
+        }
+    } else {
+        return APP_DRV_ERR_BUSY;
+    }
+
+    return APP_DRV_SUCCESS;
+}
+
+uint16_t app_qspi_transmit_large_async(app_qspi_id_t id, uint8_t *p_data, uint32_t length)
+{
+    return qspi_chain_start(id, p_data, length, false);
+}
+
+uint16_t app_qspi_receive_large_async(app_qspi_id_t id, uint8_t *p_data, uint32_t length)
+{
+    return qspi_chain_start(id, p_data, length, true);
+}
+
 qspi_handle_t *app_qspi_get_handle(app_qspi_id_t id)
 {
     if (id >= APP_QSPI_ID_MAX ||
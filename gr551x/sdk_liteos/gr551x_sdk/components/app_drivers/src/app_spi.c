@@ -56,6 +56,10 @@
  */
 #define MS_1000           1000
 
+#ifndef APP_SPI_XFER_BLOCK_MAX
+#define APP_SPI_XFER_BLOCK_MAX  4095    /* DMA block size limit, larger transfers are chained */
+#endif
+
 /*
  * STRUCT DEFINE
  *****************************************************************************************
@@ -81,6 +85,9 @@ struct spi_env_t {
     volatile uint8_t        rx_done;
     volatile uint8_t        tx_done;
     volatile uint8_t        user_mode;
+    uint8_t                *p_chain;            /**< Next block of a chained transfer. */
+    uint32_t                chain_left;         /**< Bytes not started yet. */
+    uint32_t                chain_size;         /**< Total size, 0 when not chaining. */
 #ifdef ENV_RTOS_USE_SEMP
     APP_DRV_SEM_DECL(sem_tx);
     APP_DRV_SEM_DECL(sem_rx);
@@ -401,10 +408,41 @@ static uint16_t app_spi_config_dma(app_spi_params_t *p_params)
     return APP_DRV_SUCCESS;
 }
 
+static hal_status_t spi_chain_next(app_spi_id_t id, bool rx)
+{
+    uint8_t *p_data = s_spi_env[id].p_chain;
+    uint32_t size = s_spi_env[id].chain_left;
+    hal_status_t err_code = HAL_ERROR;
+
+    if (size > APP_SPI_XFER_BLOCK_MAX) {
+        size = APP_SPI_XFER_BLOCK_MAX;
+    }
+    s_spi_env[id].p_chain    += size;
+    s_spi_env[id].chain_left -= size;
+
+    switch (s_spi_env[id].use_mode.type) {
+        case APP_SPI_TYPE_INTERRUPT:
+            err_code = rx ? hal_spi_receive_it(&s_spi_env[id].handle, p_data, size) :
+                            hal_spi_transmit_it(&s_spi_env[id].handle, p_data, size);
+            break;
+
+        case APP_SPI_TYPE_DMA:
+            err_code = rx ? hal_spi_receive_dma(&s_spi_env[id].handle, p_data, size) :
+                            hal_spi_transmit_dma(&s_spi_env[id].handle, p_data, size);
+            break;
+
+        default:
+            break;
+    }
+
+    return err_code;
+}
+
 static void app_spi_event_call(spi_handle_t *p_spi, app_spi_evt_type_t evt_type)
 {
     app_spi_evt_t spi_evt;
     app_spi_id_t id = APP_SPI_ID_MAX;
+    uint32_t chain_error = HAL_SPI_ERROR_NONE;
 
     if (p_spi->p_instance == SPIS) {
         id = APP_SPI_ID_SLAVE;
@@ -412,9 +450,19 @@ static void app_spi_event_call(spi_handle_t *p_spi, app_spi_evt_type_t evt_type)
         id = APP_SPI_ID_MASTER;
     }
 
+    /* Start the next block of a chained transfer from here, no event is reported until the last one. */
+    if (((evt_type == APP_SPI_EVT_TX_CPLT) || (evt_type == APP_SPI_EVT_RX_DATA)) && s_spi_env[id].chain_left) {
+        if (spi_chain_next(id, evt_type == APP_SPI_EVT_RX_DATA) == HAL_OK) {
+            return;
+        }
+        /* A block the HAL refused to start (busy, bad length) may leave its error code clear. */
+        evt_type = APP_SPI_EVT_ERROR;
+        chain_error = (p_spi->error_code != HAL_SPI_ERROR_NONE) ? p_spi->error_code : HAL_SPI_ERROR_TRANSFER;
+    }
+
     spi_evt.type = evt_type;
     if (evt_type == APP_SPI_EVT_ERROR) {
-        spi_evt.data.error_code = p_spi->error_code;
+        spi_evt.data.error_code = (chain_error != HAL_SPI_ERROR_NONE) ? chain_error : p_spi->error_code;
 #ifdef  ENV_RTOS_USE_SEMP
         if (!s_spi_env[id].user_mode) {
             app_driver_sem_post_from_isr(s_spi_env[id].sem_tx);
@@ -442,6 +490,11 @@ static void app_spi_event_call(spi_handle_t *p_spi, app_spi_evt_type_t evt_type)
     } else if (evt_type == APP_SPI_EVT_TX_RX) {
         spi_evt.data.size = p_spi->rx_xfer_size - p_spi->rx_xfer_count;
     }
+    if (s_spi_env[id].chain_size && (evt_type != APP_SPI_EVT_ERROR)) {
+        spi_evt.data.size = s_spi_env[id].chain_size;
+    }
+    s_spi_env[id].chain_left = 0;
+    s_spi_env[id].chain_size = 0;
 
     s_spi_env[id].start_flag = false;
     SPI_SMART_CS_HIGH(id);
@@ -1372,6 +1425,54 @@ uint16_t app_spi_write_memory_async(app_spi_id_t id, uint8_t *p_cmd_data, \
     return APP_DRV_SUCCESS;
 }
 
+static uint16_t spi_chain_start(app_spi_id_t id, uint8_t *p_data, uint32_t size, bool rx)
+{
+    hal_status_t err_code;
+
+    if (id >= APP_SPI_ID_MAX ||
+            p_data == NULL ||
+            size == 0 ||
+            s_spi_env[id].spi_state == APP_SPI_INVALID ||
+            s_spi_env[id].use_mode.type == APP_SPI_TYPE_POLLING) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+
+#ifdef APP_DRIVER_WAKEUP_CALL_FUN
+    spi_wake_up(id);
+#endif
+
+    if (s_spi_env[id].start_flag == false) {
+        s_spi_env[id].start_flag = true;
+        s_spi_env[id].p_chain    = p_data;
+        s_spi_env[id].chain_left = size;
+        s_spi_env[id].chain_size = size;
+        SPI_SMART_CS_LOW(id);
+        err_code = spi_chain_next(id, rx);
+        if (err_code != HAL_OK) {
+            s_spi_env[id].chain_left = 0;
+            s_spi_env[id].chain_size = 0;
+            s_spi_env[id].start_flag = false;
+            SPI_SMART_CS_HIGH(id);
+
+            return (uint16_t)err_code;
+        }
+    } else {
+        return APP_DRV_ERR_BUSY;
+    }
+
+    return APP_DRV_SUCCESS;
+}
+
+uint16_t app_spi_transmit_large_async(app_spi_id_t id, uint8_t *p_data, uint32_t size)
+{
+    return spi_chain_start(id, p_data, size, false);
+}
+
+uint16_t app_spi_receive_large_async(app_spi_id_t id, uint8_t *p_data, uint32_t size)
+{
+    return spi_chain_start(id, p_data, size, true);
+}
+
 spi_handle_t *app_spi_get_handle(app_spi_id_t id)
 {
     if (id >= APP_SPI_ID_MAX ||
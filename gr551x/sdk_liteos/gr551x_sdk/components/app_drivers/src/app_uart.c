@@ -53,6 +53,16 @@
 
 #define MS_5000              5000
 
+#ifndef APP_UART_TX_DESC_BLOCK_MAX
+#define APP_UART_TX_DESC_BLOCK_MAX  4095    /* DMA block size limit, larger descriptors are chained */
+#endif
+
+/* Default for the largest receive armed at once by the ring receive; bounds how long a
+ * continuous stream is held before it is published to the reader. */
+#ifndef APP_UART_RX_RING_BLOCK
+#define APP_UART_RX_RING_BLOCK   64
+#endif
+
 /*
  * STRUCT DEFINE
  *****************************************************************************************
@@ -78,6 +88,17 @@ struct uart_env_t {
     uint8_t                tx_send_buf[TX_ONCE_MAX_SIZE];
     bool                   start_tx_flag;
     bool                   start_flush_flag;
+    app_uart_tx_desc_t    *p_desc_head;
+    app_uart_tx_desc_t    *p_desc_tail;
+    uint32_t               desc_offset;
+    uint16_t               desc_xfer;
+    bool                   desc_active;
+    ring_buffer_t          rx_ring_buffer;
+    bool                   rx_ring_flag;
+    bool                   rx_ring_armed;
+    app_uart_irq_cfg_t     irq_cfg;
+    bool                   irq_cfg_flag;
+    app_uart_irq_stats_t   irq_stats;
 #ifdef ENV_RTOS_USE_SEMP
     APP_DRV_SEM_DECL(sem_tx);
     APP_DRV_SEM_DECL(sem_rx);
@@ -170,6 +191,15 @@ static inline void APP_UART_DRV_ASYNC_MUTEX_UNLOCK(uint8_t id)
  *****************************************************************************************
  */
 
+/* Program the FIFO thresholds set by app_uart_irq_config(), after init or resume. */
+static void uart_irq_cfg_apply(uint8_t id)
+{
+    if (s_uart_env[id].irq_cfg_flag) {
+        ll_uart_set_rx_fifo_threshold(s_uart_env[id].handle.p_instance, s_uart_env[id].irq_cfg.rx_fifo_threshold);
+        ll_uart_set_tx_fifo_threshold(s_uart_env[id].handle.p_instance, s_uart_env[id].irq_cfg.tx_fifo_threshold);
+    }
+}
+
 static bool uart_prepare_for_sleep(void)
 {
     hal_uart_state_t state;
@@ -206,6 +236,7 @@ SECTION_RAM_CODE static void uart_wake_up_ind(void)
         if (s_uart_env[i].uart_state == APP_UART_ENABLE) {
             GLOBAL_EXCEPTION_DISABLE();
             hal_uart_resume_reg(&s_uart_env[i].handle);
+            uart_irq_cfg_apply(i);
             GLOBAL_EXCEPTION_ENABLE();
 
             if (s_uart_env[i].use_mode.type == APP_UART_TYPE_INTERRUPT ||
@@ -224,6 +255,7 @@ static void uart_wake_up(app_uart_id_t id)
     if (s_uart_env[id].uart_state == APP_UART_SLEEP) {
         GLOBAL_EXCEPTION_DISABLE();
         hal_uart_resume_reg(&s_uart_env[id].handle);
+        uart_irq_cfg_apply(id);
         GLOBAL_EXCEPTION_ENABLE();
 
         if (s_uart_env[id].use_mode.type == APP_UART_TYPE_INTERRUPT ||
@@ -324,13 +356,107 @@ static uint16_t app_uart_config_dma(app_uart_params_t *p_params)
     return APP_DRV_SUCCESS;
 }
 
+/* Send the next block of the head descriptor, in place. */
+static uint16_t uart_desc_transmit(app_uart_id_t id)
+{
+    app_uart_tx_desc_t *p_desc = s_uart_env[id].p_desc_head;
+    uint32_t size = p_desc->size - s_uart_env[id].desc_offset;
+    hal_status_t err_code = HAL_OK;
+
+    if (size > APP_UART_TX_DESC_BLOCK_MAX) {
+        size = APP_UART_TX_DESC_BLOCK_MAX;
+    }
+    s_uart_env[id].desc_xfer   = (uint16_t)size;
+    s_uart_env[id].desc_active = true;
+
+    switch (s_uart_env[id].use_mode.type) {
+        case APP_UART_TYPE_INTERRUPT:
+            err_code = hal_uart_transmit_it(&s_uart_env[id].handle,
+                                            p_desc->p_data + s_uart_env[id].desc_offset, size);
+            break;
+
+        case APP_UART_TYPE_DMA:
+            err_code = hal_uart_transmit_dma(&s_uart_env[id].handle,
+                                             p_desc->p_data + s_uart_env[id].desc_offset, size);
+            break;
+
+        default:
+            break;
+    }
+    if (err_code != HAL_OK) {
+        s_uart_env[id].desc_active = false;
+        return (uint16_t)err_code;
+    }
+
+    return APP_DRV_SUCCESS;
+}
+
+/* Take the head descriptor off the queue and hand it back to its owner. */
+static void uart_desc_release(app_uart_id_t id, uint32_t error_code)
+{
+    app_uart_tx_desc_t *p_desc = s_uart_env[id].p_desc_head;
+
+    s_uart_env[id].p_desc_head = p_desc->p_next;
+    if (s_uart_env[id].p_desc_head == NULL) {
+        s_uart_env[id].p_desc_tail = NULL;
+    }
+    s_uart_env[id].desc_offset = 0;
+    p_desc->error_code = error_code;
+    if (p_desc->release != NULL) {
+        p_desc->release(p_desc);
+    }
+}
+
+/* Account for the block just sent and release the head descriptor once it is complete. */
+static void uart_desc_complete(app_uart_id_t id)
+{
+    if (!s_uart_env[id].desc_active) {
+        return;
+    }
+    s_uart_env[id].desc_active  = false;
+    s_uart_env[id].desc_offset += s_uart_env[id].desc_xfer;
+
+    if (s_uart_env[id].desc_offset >= s_uart_env[id].p_desc_head->size) {
+        uart_desc_release(id, HAL_UART_ERROR_NONE);
+    }
+}
+
+/* The block in flight failed: release the head descriptor with the error, the rest of it unsent. */
+static void uart_desc_fail(app_uart_id_t id, uint32_t error_code)
+{
+    if (!s_uart_env[id].desc_active) {
+        return;
+    }
+    s_uart_env[id].desc_active = false;
+    uart_desc_release(id, error_code);
+}
+
+static void uart_desc_release_all(app_uart_id_t id)
+{
+    while (s_uart_env[id].p_desc_head != NULL) {
+        uart_desc_release(id, APP_UART_TX_DESC_DROPPED);
+    }
+    s_uart_env[id].desc_active = false;
+}
+
 static uint16_t app_uart_start_transmit_async(app_uart_id_t id)
 {
-    uint16_t items_count = ring_buffer_items_count_get(&s_uart_env[id].tx_ring_buffer);
-    uint16_t send_size   = items_count;
+    uint16_t items_count;
+    uint16_t send_size;
     hal_status_t err_code;
 
-    if ((items_count == 0) || (s_uart_env[id].start_flush_flag == true)) {
+    if (s_uart_env[id].start_flush_flag == true) {
+        s_uart_env[id].start_tx_flag = false;
+        return APP_DRV_SUCCESS;
+    }
+
+    if (s_uart_env[id].p_desc_head != NULL) {
+        return uart_desc_transmit(id);
+    }
+
+    items_count = ring_buffer_items_count_get(&s_uart_env[id].tx_ring_buffer);
+    send_size   = items_count;
+    if (items_count == 0) {
         s_uart_env[id].start_tx_flag = false;
         return APP_DRV_SUCCESS;
     }
@@ -360,23 +486,92 @@ static uint16_t app_uart_start_transmit_async(app_uart_id_t id)
     return APP_DRV_SUCCESS;
 }
 
+/* Arm an interrupt receive straight into the free space following the ring's write index.
+ * Called from the UART interrupt or with interrupts disabled. */
+static void uart_rx_ring_arm(app_uart_id_t id)
+{
+    ring_buffer_t *p_ring = &s_uart_env[id].rx_ring_buffer;
+    uint32_t wr_idx = p_ring->write_index;
+    uint32_t rd_idx = p_ring->read_index;
+    uint32_t space;
+
+    if (rd_idx > wr_idx) {
+        space = rd_idx - wr_idx - 1;
+    } else {
+        space = p_ring->buffer_size - wr_idx - (rd_idx == 0 ? 1 : 0);
+    }
+    if (space > s_uart_env[id].irq_cfg.rx_block) {
+        space = s_uart_env[id].irq_cfg.rx_block;
+    }
+
+    /* Ring full: the reader re-arms once it has made room, meanwhile the RX FIFO holds on. */
+    s_uart_env[id].rx_ring_armed = false;
+    if (space == 0) {
+        return;
+    }
+    if (hal_uart_receive_it(&s_uart_env[id].handle, p_ring->p_buffer + wr_idx, space) == HAL_OK) {
+        s_uart_env[id].rx_ring_armed = true;
+    }
+}
+
+static uint16_t uart_rx_ring_received(app_uart_id_t id, uart_handle_t *p_uart)
+{
+    ring_buffer_t *p_ring = &s_uart_env[id].rx_ring_buffer;
+    uint16_t size = p_uart->rx_xfer_size - p_uart->rx_xfer_count;
+    uint32_t wr_idx = p_ring->write_index + size;
+
+    if (wr_idx >= p_ring->buffer_size) {
+        wr_idx -= p_ring->buffer_size;
+    }
+
+    /* Take what is already waiting in the RX FIFO now, instead of in another interrupt. */
+    while (ll_uart_is_active_flag_rfne(p_uart->p_instance) &&
+            (wr_idx + 1 == p_ring->buffer_size ? 0 : wr_idx + 1) != p_ring->read_index) {
+        p_ring->p_buffer[wr_idx] = ll_uart_receive_data8(p_uart->p_instance);
+        wr_idx = (wr_idx + 1 == p_ring->buffer_size) ? 0 : wr_idx + 1;
+        size++;
+    }
+    p_ring->write_index = wr_idx;
+    uart_rx_ring_arm(id);
+
+    return size;
+}
+
 static void evt_handler_process(app_uart_id_t id, uart_handle_t *p_uart, app_uart_evt_type_t evt_type)
 {
     app_uart_evt_t uart_evt;
     uart_evt.type = evt_type;
 
     if (evt_type == APP_UART_EVT_ERROR) {
+        /* Line errors concern the receiver only; the HAL ends a transmit only on a DMA error. */
+        bool tx_ended = s_uart_env[id].start_tx_flag && (p_uart->error_code & HAL_UART_ERROR_DMA) &&
+                        p_uart->tx_state != HAL_UART_STATE_BUSY_TX;
+
         uart_evt.data.error_code = p_uart->error_code;
+        if (s_uart_env[id].rx_ring_flag && p_uart->rx_state == HAL_UART_STATE_READY) {
+            uart_rx_ring_received(id, p_uart);
+        }
+        if (tx_ended) {
+            /* Drop what failed and go on with the rest of the queue, as a completion would. */
+            uart_desc_fail(id, p_uart->error_code);
+            if (app_uart_start_transmit_async(id) != APP_DRV_SUCCESS) {
+                s_uart_env[id].start_tx_flag = false;
+            }
+        }
 #ifdef  ENV_RTOS_USE_SEMP
-        app_driver_sem_post_from_isr(s_uart_env[id].sem_tx);
+        if (tx_ended && s_uart_env[id].start_tx_flag == false) {
+            app_driver_sem_post_from_isr(s_uart_env[id].sem_tx);
+        }
         app_driver_sem_post_from_isr(s_uart_env[id].sem_rx);
 #endif
-        s_uart_env[id].start_tx_flag = false;
         if (s_uart_env[id].evt_handler != NULL) {
             s_uart_env[id].evt_handler(&uart_evt);
         }
     } else if (evt_type == APP_UART_EVT_TX_CPLT) {
         uart_evt.data.size = p_uart->tx_xfer_size - p_uart->tx_xfer_count;
+        s_uart_env[id].irq_stats.tx_events++;
+        s_uart_env[id].irq_stats.tx_bytes += uart_evt.data.size;
+        uart_desc_complete(id);
         app_uart_start_transmit_async(id);
 #ifdef  ENV_RTOS_USE_SEMP
         if (s_uart_env[id].start_tx_flag == false) {
@@ -390,7 +585,13 @@ static void evt_handler_process(app_uart_id_t id, uart_handle_t *p_uart, app_uar
 #ifdef  ENV_RTOS_USE_SEMP
         app_driver_sem_post_from_isr(s_uart_env[id].sem_rx);
 #endif
-        uart_evt.data.size = p_uart->rx_xfer_size - p_uart->rx_xfer_count;
+        if (s_uart_env[id].rx_ring_flag) {
+            uart_evt.data.size = uart_rx_ring_received(id, p_uart);
+        } else {
+            uart_evt.data.size = p_uart->rx_xfer_size - p_uart->rx_xfer_count;
+        }
+        s_uart_env[id].irq_stats.rx_events++;
+        s_uart_env[id].irq_stats.rx_bytes += uart_evt.data.size;
         if (s_uart_env[id].evt_handler != NULL) {
             s_uart_env[id].evt_handler(&uart_evt);
         }
@@ -562,6 +763,10 @@ uint16_t app_uart_init(app_uart_params_t *p_params, app_uart_evt_handler_t evt_h
 
     hal_uart_deinit(&s_uart_env[id].handle);
     hal_uart_init(&s_uart_env[id].handle);
+    if (s_uart_env[id].irq_cfg.rx_block == 0) {
+        s_uart_env[id].irq_cfg.rx_block = APP_UART_RX_RING_BLOCK;
+    }
+    uart_irq_cfg_apply(id);
 
     err_code = register_cb();
     APP_DRV_ERR_CODE_CHECK(err_code);
@@ -662,6 +867,9 @@ uint16_t app_uart_deinit(app_uart_id_t id)
     s_uart_env[id].uart_state = APP_UART_INVALID;
     s_uart_env[id].start_tx_flag = false;
     s_uart_env[id].start_flush_flag = false;
+    s_uart_env[id].rx_ring_flag = false;
+    s_uart_env[id].rx_ring_armed = false;
+    uart_desc_release_all(id);
 
     unregister_cb();
 
@@ -683,6 +891,10 @@ uint16_t app_uart_receive_async(app_uart_id_t id, uint8_t *p_data, uint16_t size
         return APP_DRV_ERR_INVALID_PARAM;
     }
 
+    if (s_uart_env[id].rx_ring_flag) {
+        return APP_DRV_ERR_BUSY;
+    }
+
 #ifdef APP_DRIVER_WAKEUP_CALL_FUN
     uart_wake_up(id);
 #endif
@@ -709,6 +921,85 @@ uint16_t app_uart_receive_async(app_uart_id_t id, uint8_t *p_data, uint16_t size
     return APP_DRV_SUCCESS;
 }
 
+uint16_t app_uart_receive_ring_start(app_uart_id_t id, uint8_t *p_buf, uint32_t size)
+{
+    if (id >= APP_UART_ID_MAX ||
+            p_buf == NULL ||
+            size < 2 ||
+            s_uart_env[id].uart_state == APP_UART_INVALID ||
+            s_uart_env[id].use_mode.type == APP_UART_TYPE_POLLING ||
+            s_uart_env[id].handle.init.rx_timeout_mode != UART_RECEIVER_TIMEOUT_ENABLE) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+
+    if (s_uart_env[id].rx_ring_flag) {
+        return APP_DRV_ERR_BUSY;
+    }
+
+#ifdef APP_DRIVER_WAKEUP_CALL_FUN
+    uart_wake_up(id);
+#endif
+
+    GLOBAL_EXCEPTION_DISABLE();
+    ring_buffer_init(&s_uart_env[id].rx_ring_buffer, p_buf, size);
+    s_uart_env[id].rx_ring_flag = true;
+    uart_rx_ring_arm(id);
+    GLOBAL_EXCEPTION_ENABLE();
+
+    if (!s_uart_env[id].rx_ring_armed) {
+        s_uart_env[id].rx_ring_flag = false;
+        return APP_DRV_ERR_HAL;
+    }
+
+    return APP_DRV_SUCCESS;
+}
+
+uint32_t app_uart_receive_ring_read(app_uart_id_t id, uint8_t *p_data, uint32_t size)
+{
+    uint32_t len;
+
+    if (id >= APP_UART_ID_MAX || p_data == NULL || !s_uart_env[id].rx_ring_flag) {
+        return 0;
+    }
+
+    len = ring_buffer_read(&s_uart_env[id].rx_ring_buffer, p_data, size);
+
+    if (!s_uart_env[id].rx_ring_armed) {
+        GLOBAL_EXCEPTION_DISABLE();
+        if (s_uart_env[id].rx_ring_flag && !s_uart_env[id].rx_ring_armed) {
+            uart_rx_ring_arm(id);
+        }
+        GLOBAL_EXCEPTION_ENABLE();
+    }
+
+    return len;
+}
+
+uint32_t app_uart_receive_ring_count(app_uart_id_t id)
+{
+    if (id >= APP_UART_ID_MAX || !s_uart_env[id].rx_ring_flag) {
+        return 0;
+    }
+
+    return ring_buffer_items_count_get(&s_uart_env[id].rx_ring_buffer);
+}
+
+uint16_t app_uart_receive_ring_stop(app_uart_id_t id)
+{
+    if (id >= APP_UART_ID_MAX || !s_uart_env[id].rx_ring_flag) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+
+    GLOBAL_EXCEPTION_DISABLE();
+    s_uart_env[id].rx_ring_flag = false;
+    s_uart_env[id].rx_ring_armed = false;
+    GLOBAL_EXCEPTION_ENABLE();
+
+    hal_uart_abort_receive(&s_uart_env[id].handle);
+
+    return APP_DRV_SUCCESS;
+}
+
 uint16_t app_uart_receive_sync(app_uart_id_t id, uint8_t *p_data, uint16_t size, uint32_t timeout)
 {
     hal_status_t err_code;
@@ -819,6 +1110,96 @@ uint16_t app_uart_transmit_async(app_uart_id_t id, uint8_t *p_data, uint16_t siz
     return APP_DRV_SUCCESS;
 }
 
+uint16_t app_uart_transmit_desc_async(app_uart_id_t id, app_uart_tx_desc_t *p_desc)
+{
+    app_uart_tx_desc_t *p_prev;
+    uint16_t err_code;
+    bool start;
+
+    if (id >= APP_UART_ID_MAX ||
+            p_desc == NULL ||
+            p_desc->p_data == NULL ||
+            p_desc->size == 0 ||
+            s_uart_env[id].uart_state == APP_UART_INVALID ||
+            s_uart_env[id].use_mode.type == APP_UART_TYPE_POLLING) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+
+    /* The DMA cannot read through the XIP cache: only SRAM data is sent in place. */
+    if (s_uart_env[id].use_mode.type == APP_UART_TYPE_DMA && (uintptr_t)p_desc->p_data < GR55XX_RAM_ADDRESS) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+
+#ifdef APP_DRIVER_WAKEUP_CALL_FUN
+    uart_wake_up(id);
+#endif
+
+    p_desc->p_next = NULL;
+
+    GLOBAL_EXCEPTION_DISABLE();
+    if (s_uart_env[id].p_desc_tail == NULL) {
+        s_uart_env[id].p_desc_head = p_desc;
+    } else {
+        s_uart_env[id].p_desc_tail->p_next = p_desc;
+    }
+    s_uart_env[id].p_desc_tail = p_desc;
+
+    start = (s_uart_env[id].start_tx_flag == false) && (s_uart_env[id].start_flush_flag == false) &&
+            (s_uart_env[id].uart_state == APP_UART_ENABLE) &&
+            ll_uart_is_enabled_fifo(s_uart_env[id].handle.p_instance);
+    if (start) {
+        s_uart_env[id].start_tx_flag = true;
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+
+    if (!start) {
+        return APP_DRV_SUCCESS;
+    }
+
+    err_code = app_uart_start_transmit_async(id);
+    if (err_code != APP_DRV_SUCCESS) {
+        /* Nothing is in flight, so the descriptor can be taken back off the tail. */
+        GLOBAL_EXCEPTION_DISABLE();
+        s_uart_env[id].start_tx_flag = false;
+        if (s_uart_env[id].p_desc_head == p_desc) {
+            s_uart_env[id].p_desc_head = NULL;
+            s_uart_env[id].p_desc_tail = NULL;
+            s_uart_env[id].desc_offset = 0;
+        } else {
+            p_prev = s_uart_env[id].p_desc_head;
+            while (p_prev->p_next != p_desc) {
+                p_prev = p_prev->p_next;
+            }
+            p_prev->p_next = NULL;
+            s_uart_env[id].p_desc_tail = p_prev;
+        }
+        GLOBAL_EXCEPTION_ENABLE();
+        return err_code;
+    }
+
+    return APP_DRV_SUCCESS;
+}
+
+uint32_t app_uart_transmit_space_get(app_uart_id_t id)
+{
+    if (id >= APP_UART_ID_MAX ||
+            s_uart_env[id].uart_state == APP_UART_INVALID ||
+            s_uart_env[id].tx_ring_buffer.buffer_size == 0) {
+        return 0;
+    }
+
+    return ring_buffer_surplus_space_get(&s_uart_env[id].tx_ring_buffer);
+}
+
+bool app_uart_transmit_busy(app_uart_id_t id)
+{
+    if (id >= APP_UART_ID_MAX) {
+        return false;
+    }
+
+    return s_uart_env[id].start_tx_flag;
+}
+
 #ifdef  ENV_RTOS_USE_SEMP
 uint16_t app_uart_transmit_sem_sync(app_uart_id_t id, uint8_t *p_data, uint16_t size)
 {
@@ -892,6 +1273,44 @@ uint16_t app_uart_transmit_sync(app_uart_id_t id, uint8_t *p_data, uint16_t size
     return APP_DRV_SUCCESS;
 }
 
+uint16_t app_uart_irq_config(app_uart_id_t id, const app_uart_irq_cfg_t *p_cfg)
+{
+    if (id >= APP_UART_ID_MAX || p_cfg == NULL ||
+            p_cfg->rx_fifo_threshold > LL_UART_RX_FIFO_TH_FULL_2 ||
+            p_cfg->tx_fifo_threshold > LL_UART_TX_FIFO_TH_HALF_FULL) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+
+    GLOBAL_EXCEPTION_DISABLE();
+    s_uart_env[id].irq_cfg = *p_cfg;
+    if (s_uart_env[id].irq_cfg.rx_block == 0) {
+        s_uart_env[id].irq_cfg.rx_block = APP_UART_RX_RING_BLOCK;
+    }
+    s_uart_env[id].irq_cfg_flag = true;
+    if (s_uart_env[id].uart_state == APP_UART_ENABLE) {
+        uart_irq_cfg_apply(id);
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+
+    return APP_DRV_SUCCESS;
+}
+
+uint16_t app_uart_irq_stats_get(app_uart_id_t id, app_uart_irq_stats_t *p_stats, bool clear)
+{
+    if (id >= APP_UART_ID_MAX || p_stats == NULL) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+
+    GLOBAL_EXCEPTION_DISABLE();
+    *p_stats = s_uart_env[id].irq_stats;
+    if (clear) {
+        memset(&s_uart_env[id].irq_stats, 0, sizeof(s_uart_env[id].irq_stats));
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+
+    return APP_DRV_SUCCESS;
+}
+
 uart_handle_t *app_uart_get_handle(app_uart_id_t id)
 {
     if (id >= APP_UART_ID_MAX || s_uart_env[id].uart_state == APP_UART_INVALID) {
@@ -923,21 +1342,41 @@ static void flush_process(app_uart_id_t id)
     while (!ll_uart_is_active_flag_tfe(s_uart_env[id].handle.p_instance));
 
     if (APP_UART_TYPE_INTERRUPT == s_uart_env[id].use_mode.type) {
+        uint8_t *p_sending = s_uart_env[id].tx_send_buf;
+
+        if (s_uart_env[id].desc_active) {
+            p_sending = s_uart_env[id].p_desc_head->p_data + s_uart_env[id].desc_offset;
+        }
         tx_xfer_size  = s_uart_env[id].handle.tx_xfer_size;
         tx_xfer_count = s_uart_env[id].handle.tx_xfer_count;
         hal_uart_abort_transmit_it(&s_uart_env[id].handle);
         hal_uart_transmit(&s_uart_env[id].handle,
-                          s_uart_env[id].tx_send_buf + tx_xfer_size - tx_xfer_count,
+                          p_sending + tx_xfer_size - tx_xfer_count,
                           tx_xfer_count,
                           MS_5000);
     } else {
         do {
             tx_wait_count++;
         } while (HAL_UART_STATE_READY != hal_uart_get_state(&s_uart_env[id].handle) &&
-                (tx_wait_count <= data_width * TX_ONCE_MAX_SIZE * \
+                (tx_wait_count <= data_width * APP_UART_TX_DESC_BLOCK_MAX * \
                 (SystemCoreClock/s_uart_env[id].handle.init.baud_rate)));
     }
 
+    /* The block in flight is done; with interrupts masked its completion was not seen. */
+    uart_desc_complete(id);
+
+    /* Descriptors first, as app_uart_start_transmit_async() serves them. */
+    while (s_uart_env[id].p_desc_head != NULL) {
+        app_uart_tx_desc_t *p_desc = s_uart_env[id].p_desc_head;
+
+        while (s_uart_env[id].desc_offset < p_desc->size) {
+            while (!ll_uart_is_active_flag_tfnf(s_uart_env[id].handle.p_instance));
+
+            ll_uart_transmit_data8(s_uart_env[id].handle.p_instance, p_desc->p_data[s_uart_env[id].desc_offset++]);
+        }
+        uart_desc_release(id, HAL_UART_ERROR_NONE);
+    }
+
     do {
         items_count = ring_buffer_items_count_get(&s_uart_env[id].tx_ring_buffer);
         while (items_count) {
@@ -1014,6 +1453,7 @@ SECTION_RAM_CODE void UART0_IRQHandler(void)
 #if FLASH_PROTECT_PRIORITY
     platform_interrupt_protection_push();
 #endif
+    s_uart_env[APP_UART_ID_0].irq_stats.irq_count++;
     hal_uart_irq_handler(&s_uart_env[APP_UART_ID_0].handle);
 #if FLASH_PROTECT_PRIORITY
     platform_interrupt_protection_pop();
@@ -1025,6 +1465,7 @@ SECTION_RAM_CODE void UART1_IRQHandler(void)
 #if FLASH_PROTECT_PRIORITY
     platform_interrupt_protection_push();
 #endif
+    s_uart_env[APP_UART_ID_1].irq_stats.irq_count++;
     hal_uart_irq_handler(&s_uart_env[APP_UART_ID_1].handle);
 #if FLASH_PROTECT_PRIORITY
     platform_interrupt_protection_pop();
@@ -40,6 +40,7 @@
 #include <string.h>
 #include "gr55xx_hal.h"
 #include "gr551x_spi_flash.h"
+#include "los_sem.h"
 
 /*
  * DEFINES
@@ -58,6 +59,69 @@
 #define SPI_SPEED_32M                     (32000000)
 
 #define DEFAULT_QSPI_SPEED                (SPI_SPEED_8M)
+
+#ifndef SPI_FLASH_QUAD_ENABLE
+#define SPI_FLASH_QUAD_ENABLE             1
+#endif
+#ifndef SPI_FLASH_QUAD_READ_DUMMY
+#define SPI_FLASH_QUAD_READ_DUMMY         4         /* clocks after the 0xEB mode byte */
+#endif
+#define SPI_FLASH_QUAD_MODE_BITS          0x00      /* M5-4 != 10b, no continuous read */
+#define SPI_FLASH_SR_WIP                  0x01
+#ifndef SPI_FLASH_PAGE_PROG_US
+#define SPI_FLASH_PAGE_PROG_US            600       /* first status poll after a page program */
+#endif
+#ifndef SPI_FLASH_WIP_POLL_US
+#define SPI_FLASH_WIP_POLL_US             50        /* status poll interval after that */
+#endif
+#define SPI_FLASH_SR2_QE                  0x02
+#define SPI_FLASH_SR_QE_MXIC              0x40      /* Macronix keeps QE in status register 1 */
+#define SPI_FLASH_MANU_MXIC               0xC2
+#define SPI_FLASH_SR2_QE7                 0x80
+#define SPI_FLASH_SR_FLOAT                0xFF      /* no such register, MISO floats high */
+#define SPI_FLASH_SIZE_3B_MAX             0x1000000 /* reach of 3-byte addresses */
+#define SPI_FLASH_ID_CAPACITY_MIN         0x10      /* JEDEC ID capacity byte, log2 of the size */
+#define SPI_FLASH_ID_CAPACITY_MAX         0x1F
+#ifndef SPI_FLASH_SUSPEND_POLLS
+#define SPI_FLASH_SUSPEND_POLLS           8         /* status polls of an erase between suspends */
+#endif
+
+/* JEDEC JESD216 SFDP, see spi_flash_sfdp_probe. DWORDs are numbered from 1 as in the standard. */
+#define SFDP_SIGNATURE                    0x50444653    /* "SFDP" */
+#define SFDP_HEADER_SIZE                  8
+#define SFDP_PARAM_HEADERS_MAX            8
+#define SFDP_BFPT_ID_LSB                  0x00
+#define SFDP_BFPT_ID_MSB                  0xFF
+#define SFDP_BFPT_DWORDS_MIN              9
+#define SFDP_BFPT_DWORDS_MAX              16
+#define SFDP_DUMMY_CLOCKS                 8
+#define SFDP_GET_LE32(p)                  (((uint32_t)(p)[ITEM_3] << BIT_24) | ((uint32_t)(p)[ITEM_2] << BIT_16) | \
+                                           ((uint32_t)(p)[ITEM_1] << BIT_8) | (uint32_t)(p)[ITEM_0])
+#define SFDP_DW1                          0
+#define SFDP_DW2                          1
+#define SFDP_DW3                          2
+#define SFDP_DW8                          7
+#define SFDP_DW10                         9
+#define SFDP_DW11                         10
+#define SFDP_DW12                         11
+#define SFDP_DW13                         12
+#define SFDP_DW15                         14
+#define SFDP_DW16                         15
+#define SFDP_DW1_ADDR_BYTES               17
+#define SFDP_DW1_READ_144                 (1UL << 21)
+#define SFDP_DW1_READ_114                 (1UL << 22)
+#define SFDP_DW2_EXP                      (1UL << 31)
+#define SFDP_DW12_NO_SUSPEND              (1UL << 31)
+#define SFDP_DW15_QER                     20
+#define SFDP_DW16_EN4B                    (1UL << 24)
+#define SFDP_DW16_WREN_EN4B               (1UL << 25)
+#define SFDP_ADDR_3_ONLY                  0
+#define SFDP_ADDR_4_ONLY                  2
+#define SFDP_ERASE_4K_SUPPORTED           1
+#define SFDP_ERASE_EXP_MAX                32
+#define SFDP_ERASE_TIME_BITS              7
+#define SFDP_DENSITY_EXP_MAX              35
+
 #define DEFAULT_QSPI_IO_CONFIG            { { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_15}, \
                                             { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_9 }, \
                                             { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_8 }, \
@@ -81,23 +145,77 @@
 #define DEFAULT_SPIM_PARAM_CONFIG         {APP_SPI_ID_MASTER, DEFAULT_SPIM_IO_CONFIG, \
                                            DEFAULT_SPIM_MODE_CONFIG, DEFAULT_SPIM_CONFIG}
 
-#define MS_5000                           5000
 /*
  * LOCAL VARIABLE DEFINITIONS
  *****************************************************************************************
  */
 static volatile qspi_control_t g_qspi_ctl;
-static dma_handle_t            g_dma_handle;
-static spi_handle_t            g_spim_handle;
-static qspi_handle_t           g_qspi_handle;
 static flash_init_t            g_flash_init;
+static spi_flash_mode_t        g_flash_mode = SPI_FLASH_MODE_SINGLE;
+static spi_flash_caps_t        g_flash_caps;
+
+/*
+ * The flash is owned by one caller at a time: g_flash_lock is taken by every public call for its
+ * duration, and by spi_flash_write_async until its last page completes, when the writer releases
+ * it from the QSPI interrupt. The blocking spi_flash_write waits on g_flash_done meanwhile.
+ */
+static bool                    g_flash_sem_ready;
+static UINT32                  g_flash_lock;
+static UINT32                  g_flash_done;
+
+/*
+ * Tasks waiting in spi_flash_read, counted so that spi_flash_sector_erase can suspend the erase
+ * and hand them the flash. Callers other than readers resume a suspended erase and wait for it.
+ */
+static volatile uint32_t       g_flash_readers;
+static volatile uint32_t       g_flash_reads;
+static volatile bool           g_erase_suspended;
+
+typedef enum {
+    PIPE_IDLE,
+    PIPE_WREN,                       /* write enable in flight */
+    PIPE_PROG,                       /* page program data in flight */
+    PIPE_WIP_WAIT,                   /* page programming, waiting for the poll timer */
+    PIPE_WIP_READ,                   /* status read in flight */
+} spi_flash_pipe_state_t;
+
+typedef struct {
+    volatile spi_flash_pipe_state_t state;
+    volatile bool        xfer;       /* a transfer started by the writer is in flight */
+    uint32_t             next_addr;  /* flash address of the first byte not staged yet */
+    uint8_t             *p_src;      /* caller data not staged yet */
+    uint32_t             left;       /* bytes not staged yet */
+    uint32_t             written;    /* bytes programmed */
+    uint32_t             page_addr[ITEM_2];
+    uint32_t             page_len[ITEM_2];
+    uint8_t              cur;        /* staging buffer being programmed */
+    bool                 staged;     /* the other staging buffer holds the next page */
+    bool                 failed;     /* a program reported an error, finish once the part is idle */
+    uint8_t              status;
+    spi_flash_write_cb_t cb;
+    void                *p_arg;
+} spi_flash_pipe_t;
+
+static spi_flash_pipe_t          g_pipe;
+static uint8_t                   g_pipe_buf[ITEM_2][SPI_FLASH_PAGE_SIZE];
+static uint8_t                   g_pipe_wren = SPI_FLASH_CMD_WREN;
+static spi_flash_timer_start_t   g_pipe_timer_start;
+static spi_flash_write_stats_t   g_pipe_stats;
 
 /*
  * LOCAL FUNCTION DEFINITIONS
  *****************************************************************************************
  */
+static void spi_flash_pipe_event(app_qspi_evt_type_t type);
+
 static void spi_app_qspi_callback(app_qspi_evt_t *p_evt)
 {
+    /* Only the completion of a transfer the writer started is its own. */
+    if (g_pipe.xfer) {
+        g_pipe.xfer = false;
+        spi_flash_pipe_event(p_evt->type);
+        return;
+    }
     if (p_evt->type == APP_QSPI_EVT_TX_CPLT) {
         g_qspi_ctl.qspi_tmt_done = 1;
     }
@@ -124,21 +242,84 @@ void spi_app_spim_callback(app_spi_evt_t *p_evt)
     }
 }
 
-static void spi_flash_write_enable(void)
+static bool spi_flash_sem_init(void)
 {
-    uint8_t control_frame[1] = {SPI_FLASH_CMD_WREN};
+    if (g_flash_sem_ready) {
+        return true;
+    }
+    if (LOS_BinarySemCreate(1, &g_flash_lock) != LOS_OK) {
+        return false;
+    }
+    if (LOS_BinarySemCreate(0, &g_flash_done) != LOS_OK) {
+        (void)LOS_SemDelete(g_flash_lock);
+        return false;
+    }
+    g_flash_sem_ready = true;
+
+    return true;
+}
+
+/* Waits for the caller before, unless called from an interrupt, which cannot wait and is refused. */
+static bool spi_flash_lock(void)
+{
+    if (!g_flash_sem_ready) {
+        return false;
+    }
+
+    return LOS_SemPend(g_flash_lock, __get_IPSR() ? LOS_NO_WAIT : LOS_WAIT_FOREVER) == LOS_OK;
+}
+
+static void spi_flash_unlock(void)
+{
+    (void)LOS_SemPost(g_flash_lock);
+}
 
+static bool spi_flash_transmit(uint8_t *p_frame, uint32_t length)
+{
     if (FLASH_SPIM_ID == g_flash_init.spi_type) {
         g_qspi_ctl.spi_tmt_done = 0;
-        app_spi_transmit_async(g_qspi_ctl.spi_id, control_frame, sizeof(control_frame));
+        if (app_spi_transmit_async(g_qspi_ctl.spi_id, p_frame, length) != APP_DRV_SUCCESS) {
+            return false;
+        }
         while (g_qspi_ctl.spi_tmt_done == 0);
     } else {
         g_qspi_ctl.qspi_tmt_done = 0;
-        app_qspi_transmit_async(g_qspi_ctl.qspi_id, control_frame, sizeof(control_frame));
+        if (app_qspi_transmit_async(g_qspi_ctl.qspi_id, p_frame, length) != APP_DRV_SUCCESS) {
+            return false;
+        }
         while (g_qspi_ctl.qspi_tmt_done == 0);
     }
 
-    return;
+    return true;
+}
+
+static void spi_flash_write_enable(void)
+{
+    uint8_t control_frame[1] = {SPI_FLASH_CMD_WREN};
+
+    (void)spi_flash_transmit(control_frame, sizeof(control_frame));
+}
+
+static uint8_t qspi_flash_read_reg(uint8_t cmd)
+{
+    uint8_t status = 0;
+    qspi_command_t command = {
+        .instruction      = cmd,
+        .address          = 0,
+        .instruction_size = QSPI_INSTSIZE_08_BITS,
+        .address_size     = QSPI_ADDRSIZE_00_BITS,
+        .data_size        = QSPI_DATASIZE_08_BITS,
+        .dummy_cycles     = 0,
+        .instruction_address_mode = QSPI_INST_ADDR_ALL_IN_SPI,
+        .data_mode        = QSPI_DATA_MODE_SPI,
+        .length           = 1,
+    };
+
+    g_qspi_ctl.qspi_rcv_done = 0;
+    app_qspi_command_receive_async(g_qspi_ctl.qspi_id, &command, &status);
+    while (g_qspi_ctl.qspi_rcv_done == 0);
+
+    return status;
 }
 
 static uint8_t spi_flash_read_status(void)
@@ -151,94 +332,520 @@ static uint8_t spi_flash_read_status(void)
         g_qspi_ctl.spi_rcv_done = 0;
         app_spi_read_memory_async(g_qspi_ctl.spi_id, control_frame, (uint8_t*)&status, sizeof(control_frame), 1);
         while (g_qspi_ctl.spi_rcv_done == 0);
+    } else {
+        status = qspi_flash_read_reg(SPI_FLASH_CMD_RDSR);
+    }
+
+    return status;
+}
+
+static void spi_flash_command(uint8_t cmd)
+{
+    uint8_t control_frame[1] = {cmd};
+
+    (void)spi_flash_transmit(control_frame, sizeof(control_frame));
+}
+
+/* For every caller but the readers: an erase suspended for them is resumed and waited for. */
+static bool spi_flash_lock_excl(void)
+{
+    if (!spi_flash_lock()) {
+        return false;
+    }
+    if (g_erase_suspended) {
+        if (__get_IPSR()) {
+            spi_flash_unlock();
+            return false;
+        }
+        g_erase_suspended = false;
+        spi_flash_command(g_flash_caps.resume_cmd);
+        while (spi_flash_read_status() & SPI_FLASH_SR_WIP);
+    }
+
+    return true;
+}
+
+static bool spi_flash_lock_read(void)
+{
+    bool locked;
+
+    if (__get_IPSR()) {
+        return spi_flash_lock();
+    }
+    GLOBAL_EXCEPTION_DISABLE();
+    g_flash_readers++;
+    GLOBAL_EXCEPTION_ENABLE();
+    locked = spi_flash_lock();
+    GLOBAL_EXCEPTION_DISABLE();
+    g_flash_readers--;
+    GLOBAL_EXCEPTION_ENABLE();
+
+    return locked;
+}
+
+/*
+ * Suspend the erase in progress and hand the flash to the waiting readers, for as long as they
+ * keep reading. A reader that has not reached the semaphore yet reads nothing during a hand-off,
+ * which ends it rather than spinning; it waits for the next suspend then.
+ */
+static void spi_flash_erase_suspend(void)
+{
+    uint32_t reads;
+
+    spi_flash_command(g_flash_caps.suspend_cmd);
+    while (spi_flash_read_status() & SPI_FLASH_SR_WIP);
+    g_erase_suspended = true;
+    do {
+        reads = g_flash_reads;
+        spi_flash_unlock();
+        (void)spi_flash_lock();
+    } while (g_erase_suspended && (g_flash_readers != 0) && (reads != g_flash_reads));
+    if (g_erase_suspended) {
+        g_erase_suspended = false;
+        spi_flash_command(g_flash_caps.resume_cmd);
+    }
+}
+
+static void spi_flash_erase_wait(void)
+{
+    uint32_t polls = 0;
+
+    while (spi_flash_read_status() & SPI_FLASH_SR_WIP) {
+        if (g_flash_caps.suspend && (g_flash_readers != 0) && (++polls >= SPI_FLASH_SUSPEND_POLLS)) {
+            spi_flash_erase_suspend();
+            polls = 0;
+        }
+    }
+}
+
+/* Instruction and address, most significant byte first; returns the frame length. */
+static uint32_t spi_flash_addr_frame(uint8_t *p_frame, uint8_t cmd, uint32_t address)
+{
+    uint32_t i, n = g_flash_caps.addr_bytes;
+
+    p_frame[0] = cmd;
+    for (i = 0; i < n; i++) {
+        p_frame[1 + i] = (address >> ((n - 1 - i) * BIT_8)) & 0xFF;
+    }
+
+    return n + 1;
+}
+
+static uint32_t qspi_flash_addr_size(void)
+{
+    return (g_flash_caps.addr_bytes == ITEM_4) ? QSPI_ADDRSIZE_32_BITS : QSPI_ADDRSIZE_24_BITS;
+}
+
+static void spi_flash_addr4_enter(void)
+{
+    if (g_flash_caps.addr4_enter == SPI_FLASH_ADDR4_ENTER_NONE) {
+        return;
+    }
+    if (g_flash_caps.addr4_enter == SPI_FLASH_ADDR4_ENTER_WREN_EN4B) {
+        spi_flash_write_enable();
+    }
+    spi_flash_command(SPI_FLASH_CMD_EN4B);
+}
+
+#if (SPI_FLASH_QUAD_ENABLE == 1)
+static void qspi_flash_write_reg(uint8_t *p_frame, uint32_t length)
+{
+    spi_flash_write_enable();
+
+    g_qspi_ctl.qspi_tmt_done = 0;
+    app_qspi_transmit_async(g_qspi_ctl.qspi_id, p_frame, length);
+    while (g_qspi_ctl.qspi_tmt_done == 0);
+
+    while (spi_flash_read_status() & SPI_FLASH_SR_WIP);
+}
+
+static bool qspi_flash_qe_sr1(void)
+{
+    uint8_t control_frame[ITEM_2];
+    uint8_t sr = qspi_flash_read_reg(SPI_FLASH_CMD_RDSR);
+
+    if ((sr & SPI_FLASH_SR_QE_MXIC) == 0) {
+        control_frame[ITEM_0] = SPI_FLASH_CMD_WRSR;
+        control_frame[ITEM_1] = sr | SPI_FLASH_SR_QE_MXIC;
+        qspi_flash_write_reg(control_frame, ITEM_2);
+    }
+
+    return (qspi_flash_read_reg(SPI_FLASH_CMD_RDSR) & SPI_FLASH_SR_QE_MXIC) != 0;
+}
+
+static bool qspi_flash_qe_sr2_wrsr1(void)
+{
+    uint8_t control_frame[ITEM_2];
+    uint8_t sr2 = qspi_flash_read_reg(SPI_FLASH_CMD_RDSR1);
+
+    if (sr2 == SPI_FLASH_SR_FLOAT) {
+        return false;
+    }
+    if ((sr2 & SPI_FLASH_SR2_QE) == 0) {
+        control_frame[ITEM_0] = SPI_FLASH_CMD_WRSR1;
+        control_frame[ITEM_1] = sr2 | SPI_FLASH_SR2_QE;
+        qspi_flash_write_reg(control_frame, ITEM_2);
+    }
+
+    return (qspi_flash_read_reg(SPI_FLASH_CMD_RDSR1) & SPI_FLASH_SR2_QE) != 0;
+}
+
+/* Parts without SPI_FLASH_CMD_WRSR1 take both status registers through SPI_FLASH_CMD_WRSR. */
+static bool qspi_flash_qe_sr2_wrsr(void)
+{
+    uint8_t control_frame[ITEM_3];
+    uint8_t sr2 = qspi_flash_read_reg(SPI_FLASH_CMD_RDSR1);
+
+    if (sr2 == SPI_FLASH_SR_FLOAT) {
+        return false;
+    }
+    if ((sr2 & SPI_FLASH_SR2_QE) == 0) {
+        control_frame[ITEM_0] = SPI_FLASH_CMD_WRSR;
+        control_frame[ITEM_1] = qspi_flash_read_reg(SPI_FLASH_CMD_RDSR);
+        control_frame[ITEM_2] = sr2 | SPI_FLASH_SR2_QE;
+        qspi_flash_write_reg(control_frame, ITEM_3);
+    }
+
+    return (qspi_flash_read_reg(SPI_FLASH_CMD_RDSR1) & SPI_FLASH_SR2_QE) != 0;
+}
+
+static bool qspi_flash_qe_sr2_bit7(void)
+{
+    uint8_t control_frame[ITEM_2];
+    uint8_t sr2 = qspi_flash_read_reg(SPI_FLASH_CMD_RDSR2_QE7);
+
+    if ((sr2 & SPI_FLASH_SR2_QE7) == 0) {
+        control_frame[ITEM_0] = SPI_FLASH_CMD_WRSR2_QE7;
+        control_frame[ITEM_1] = sr2 | SPI_FLASH_SR2_QE7;
+        qspi_flash_write_reg(control_frame, ITEM_2);
+    }
+
+    return (qspi_flash_read_reg(SPI_FLASH_CMD_RDSR2_QE7) & SPI_FLASH_SR2_QE7) != 0;
+}
+
+/* QE is non-volatile, it is only written the first time a part is used in quad mode. */
+static bool qspi_flash_quad_enable(uint32_t device_id)
+{
+    switch (g_flash_caps.qe) {
+        case SPI_FLASH_QE_NONE:
+            return true;
+        case SPI_FLASH_QE_SR1_BIT6:
+            return qspi_flash_qe_sr1();
+        case SPI_FLASH_QE_SR2_BIT7:
+            return qspi_flash_qe_sr2_bit7();
+        case SPI_FLASH_QE_SR2_BIT1_WRSR:
+        case SPI_FLASH_QE_SR2_BIT1_WRSR_KEEP:
+        case SPI_FLASH_QE_SR2_BIT1_RDSR1:
+            return qspi_flash_qe_sr2_wrsr();
+        case SPI_FLASH_QE_SR2_BIT1_WRSR1:
+            return qspi_flash_qe_sr2_wrsr1();
+        default:
+            break;
+    }
+
+    /* No SFDP: Macronix keeps QE in SR1, try SPI_FLASH_CMD_WRSR1 before SPI_FLASH_CMD_WRSR for the rest. */
+    if ((device_id >> BIT_16) == SPI_FLASH_MANU_MXIC) {
+        return qspi_flash_qe_sr1();
+    }
+
+    return qspi_flash_qe_sr2_wrsr1() || qspi_flash_qe_sr2_wrsr();
+}
+#endif
+
+static void spi_flash_caps_default(spi_flash_caps_t *p_caps)
+{
+    memset(p_caps, 0, sizeof(*p_caps));
+    p_caps->page_size            = SPI_FLASH_PAGE_SIZE;
+    p_caps->addr_bytes           = ITEM_3;
+    p_caps->read_144.cmd         = SPI_FLASH_CMD_QIOFR;
+    p_caps->read_144.mode_clocks = ITEM_2;
+    p_caps->read_144.dummy_clocks = SPI_FLASH_QUAD_READ_DUMMY;
+    p_caps->qe                   = SPI_FLASH_QE_UNKNOWN;
+    p_caps->erase[0].size        = SPI_FLASH_SECTOR_SIZE;
+    p_caps->erase[0].cmd         = SPI_FLASH_CMD_SE;
+}
+
+static void spi_flash_sfdp_read(uint32_t address, uint8_t *p_data, uint32_t length)
+{
+    if (FLASH_SPIM_ID == g_flash_init.spi_type) {
+        uint8_t control_frame[ITEM_5] = {SPI_FLASH_CMD_SFUD, 0, 0, 0, DUMMY_BYTE};
+
+        control_frame[ITEM_1] = (address >> BIT_16) & 0xFF;
+        control_frame[ITEM_2] = (address >> BIT_8) & 0xFF;
+        control_frame[ITEM_3] = address & 0xFF;
+
+        g_qspi_ctl.spi_rcv_done = 0;
+        app_spi_read_memory_async(g_qspi_ctl.spi_id, control_frame, p_data, sizeof(control_frame), length);
+        while (g_qspi_ctl.spi_rcv_done == 0);
     } else {
         qspi_command_t command = {
-            .instruction      = SPI_FLASH_CMD_RDSR,
-            .address          = 0,
+            .instruction      = SPI_FLASH_CMD_SFUD,
+            .address          = address,
             .instruction_size = QSPI_INSTSIZE_08_BITS,
-            .address_size     = QSPI_ADDRSIZE_00_BITS,
+            .address_size     = QSPI_ADDRSIZE_24_BITS,
             .data_size        = QSPI_DATASIZE_08_BITS,
-            .dummy_cycles     = 0,
+            .dummy_cycles     = SFDP_DUMMY_CLOCKS,
             .instruction_address_mode = QSPI_INST_ADDR_ALL_IN_SPI,
             .data_mode        = QSPI_DATA_MODE_SPI,
-            .length           = 1,
+            .length           = length,
         };
 
         g_qspi_ctl.qspi_rcv_done = 0;
-        app_qspi_command_receive_async(g_qspi_ctl.qspi_id, &command, (uint8_t*)&status);
+        app_qspi_command_receive_async(g_qspi_ctl.qspi_id, &command, p_data);
         while (g_qspi_ctl.qspi_rcv_done == 0);
     }
+}
+
+static uint32_t sfdp_bits(uint32_t dword, uint8_t lsb, uint8_t width)
+{
+    return (dword >> lsb) & ((1UL << width) - 1);
+}
+
+/* Erase time field of DWORD 10: count in bits 4:0, unit 1 ms, 16 ms, 128 ms or 1 s in bits 6:5. */
+static uint16_t sfdp_erase_time_ms(uint32_t field)
+{
+    static const uint16_t unit_ms[ITEM_4] = {1, 16, 128, 1000};
+
+    return (uint16_t)((sfdp_bits(field, 0, ITEM_5) + 1) * unit_ms[sfdp_bits(field, ITEM_5, ITEM_2)]);
+}
+
+static void sfdp_read_mode(uint32_t field, spi_flash_read_mode_t *p_mode)
+{
+    p_mode->dummy_clocks = sfdp_bits(field, 0, ITEM_5);
+    p_mode->mode_clocks  = sfdp_bits(field, ITEM_5, ITEM_3);
+    p_mode->cmd          = sfdp_bits(field, BIT_8, BIT_8);
+}
+
+/* p_dw[0] is DWORD 1 of the JESD216 basic flash parameter table. */
+static void spi_flash_sfdp_parse(const uint32_t *p_dw, uint32_t count, spi_flash_caps_t *p_caps)
+{
+    spi_flash_erase_type_t types[SPI_FLASH_ERASE_TYPES];
+    uint32_t density = p_dw[SFDP_DW2];
+    uint32_t addr_mode = sfdp_bits(p_dw[SFDP_DW1], SFDP_DW1_ADDR_BYTES, ITEM_2);
+    uint32_t i, j, n = 0;
+
+    if ((density & SFDP_DW2_EXP) == 0) {
+        p_caps->size = ((density & ~SFDP_DW2_EXP) + 1) / BIT_8;
+    } else if ((density & ~SFDP_DW2_EXP) < SFDP_DENSITY_EXP_MAX) {
+        p_caps->size = 1UL << ((density & ~SFDP_DW2_EXP) - ITEM_3);
+    }
 
-    return status;
+    /* Above 16 MB a part that also takes 3 bytes is switched to 4, if DWORD 16 says how. */
+    p_caps->addr_bytes  = (addr_mode == SFDP_ADDR_4_ONLY) ? ITEM_4 : ITEM_3;
+    p_caps->addr4       = (addr_mode != SFDP_ADDR_3_ONLY);
+    p_caps->addr4_enter = SPI_FLASH_ADDR4_ENTER_NONE;
+    if ((p_caps->addr_bytes == ITEM_3) && p_caps->addr4 && (p_caps->size > SPI_FLASH_SIZE_3B_MAX) &&
+        (count > SFDP_DW16)) {
+        if (p_dw[SFDP_DW16] & SFDP_DW16_EN4B) {
+            p_caps->addr4_enter = SPI_FLASH_ADDR4_ENTER_EN4B;
+        } else if (p_dw[SFDP_DW16] & SFDP_DW16_WREN_EN4B) {
+            p_caps->addr4_enter = SPI_FLASH_ADDR4_ENTER_WREN_EN4B;
+        }
+        if (p_caps->addr4_enter != SPI_FLASH_ADDR4_ENTER_NONE) {
+            p_caps->addr_bytes = ITEM_4;
+        }
+    }
+    if ((p_caps->addr_bytes == ITEM_3) && (p_caps->size > SPI_FLASH_SIZE_3B_MAX)) {
+        p_caps->size = SPI_FLASH_SIZE_3B_MAX;
+    }
+
+    memset(&p_caps->read_144, 0, sizeof(p_caps->read_144));
+    memset(&p_caps->read_114, 0, sizeof(p_caps->read_114));
+    if (p_dw[SFDP_DW1] & SFDP_DW1_READ_144) {
+        sfdp_read_mode(p_dw[SFDP_DW3], &p_caps->read_144);
+    }
+    if (p_dw[SFDP_DW1] & SFDP_DW1_READ_114) {
+        sfdp_read_mode(p_dw[SFDP_DW3] >> BIT_16, &p_caps->read_114);
+    }
+
+    /* Erase types 1-4 in DWORDs 8-9: size exponent then instruction, 0 exponent for unused slots. */
+    for (i = 0; i < SPI_FLASH_ERASE_TYPES; i++) {
+        uint32_t field = p_dw[SFDP_DW8 + i / ITEM_2] >> ((i % ITEM_2) * BIT_16);
+        uint32_t exp = sfdp_bits(field, 0, BIT_8);
+
+        if ((exp == 0) || (exp >= SFDP_ERASE_EXP_MAX)) {
+            continue;
+        }
+        types[n].size   = 1UL << exp;
+        types[n].cmd    = sfdp_bits(field, BIT_8, BIT_8);
+        types[n].typ_ms = (count > SFDP_DW10) ?
+                          sfdp_erase_time_ms(p_dw[SFDP_DW10] >> (ITEM_4 + i * SFDP_ERASE_TIME_BITS)) : 0;
+        for (j = n; (j > 0) && (types[j - 1].size > types[j].size); j--) {
+            spi_flash_erase_type_t t = types[j - 1];
+            types[j - 1] = types[j];
+            types[j] = t;
+        }
+        n++;
+    }
+    /* An empty table leaves the 4 KB erase of DWORD 1, or none: spi_flash_sector_erase then fails. */
+    memset(p_caps->erase, 0, sizeof(p_caps->erase));
+    if (n > 0) {
+        memcpy(p_caps->erase, types, n * sizeof(types[0]));
+    } else if (sfdp_bits(p_dw[SFDP_DW1], 0, ITEM_2) == SFDP_ERASE_4K_SUPPORTED) {
+        p_caps->erase[0].size = SPI_FLASH_SECTOR_SIZE;
+        p_caps->erase[0].cmd  = sfdp_bits(p_dw[SFDP_DW1], BIT_8, BIT_8);
+    }
+
+    /* DWORDs 10-16 only exist from JESD216A on. */
+    if (count > SFDP_DW11) {
+        p_caps->page_size = 1U << sfdp_bits(p_dw[SFDP_DW11], ITEM_4, ITEM_4);
+    }
+    if ((count > SFDP_DW13) && ((p_dw[SFDP_DW12] & SFDP_DW12_NO_SUSPEND) == 0)) {
+        p_caps->suspend     = true;
+        p_caps->suspend_cmd = sfdp_bits(p_dw[SFDP_DW13], BIT_24, BIT_8);
+        p_caps->resume_cmd  = sfdp_bits(p_dw[SFDP_DW13], BIT_16, BIT_8);
+    }
+    if (count > SFDP_DW15) {
+        p_caps->qe = (spi_flash_qe_t)sfdp_bits(p_dw[SFDP_DW15], SFDP_DW15_QER, ITEM_3);
+        if (p_caps->qe > SPI_FLASH_QE_SR2_BIT1_WRSR1) {
+            p_caps->qe = SPI_FLASH_QE_UNKNOWN;
+        }
+    }
 }
 
-static uint32_t spi_flash_device_size(void)
+static bool spi_flash_sfdp_probe(spi_flash_caps_t *p_caps)
 {
-    uint32_t flash_size = 0;
+    uint8_t  header[SFDP_HEADER_SIZE];
+    uint8_t  table[SFDP_BFPT_DWORDS_MAX * ITEM_4];
+    uint32_t dwords[SFDP_BFPT_DWORDS_MAX];
+    uint32_t i, nph, ptr = 0, len = 0;
+    uint8_t  rev = 0;
+
+    spi_flash_sfdp_read(0, header, sizeof(header));
+    if (SFDP_GET_LE32(header) != SFDP_SIGNATURE) {
+        return false;
+    }
+
+    /* Later revisions may append a newer basic table, take the highest revision. */
+    nph = header[ITEM_6] + 1;
+    for (i = 0; (i < nph) && (i < SFDP_PARAM_HEADERS_MAX); i++) {
+        uint8_t ph[SFDP_HEADER_SIZE];
+
+        spi_flash_sfdp_read(SFDP_HEADER_SIZE * (i + 1), ph, sizeof(ph));
+        if ((ph[ITEM_0] != SFDP_BFPT_ID_LSB) || (ph[ITEM_7] != SFDP_BFPT_ID_MSB)) {
+            continue;
+        }
+        if ((len == 0) || (((ph[ITEM_2] << ITEM_4) | (ph[ITEM_1] & 0x0F)) > rev)) {
+            rev = (ph[ITEM_2] << ITEM_4) | (ph[ITEM_1] & 0x0F);
+            len = ph[ITEM_3];
+            ptr = SFDP_GET_LE32(&ph[ITEM_4]) & 0xFFFFFF;
+        }
+    }
+    if (len < SFDP_BFPT_DWORDS_MIN) {
+        return false;
+    }
+    if (len > SFDP_BFPT_DWORDS_MAX) {
+        len = SFDP_BFPT_DWORDS_MAX;
+    }
+
+    memset(table, 0, sizeof(table));
+    spi_flash_sfdp_read(ptr, table, len * ITEM_4);
+    for (i = 0; i < SFDP_BFPT_DWORDS_MAX; i++) {
+        dwords[i] = SFDP_GET_LE32(&table[i * ITEM_4]);
+    }
+
+    spi_flash_sfdp_parse(dwords, len, p_caps);
+    p_caps->sfdp     = true;
+    p_caps->sfdp_rev = rev;
+
+    return true;
+}
+
+static uint32_t spi_flash_read_id(void)
+{
+    uint8_t data[3] = {0};
 
     if (FLASH_SPIM_ID == g_flash_init.spi_type) {
-        uint8_t data[ITEM_5] = {0};
-        uint8_t control_frame[ITEM_5] = {SPI_FLASH_CMD_SFUD, 0, 0, 0x34, DUMMY_BYTE};
+        uint8_t control_frame[1] = {SPI_FLASH_CMD_RDID};
 
         g_qspi_ctl.spi_rcv_done = 0;
         app_spi_read_memory_async(g_qspi_ctl.spi_id, control_frame, data, sizeof(control_frame), sizeof(data));
         while (g_qspi_ctl.spi_rcv_done == 0);
-
-        if (data[ITEM_0] != 0 && data[ITEM_3] < 0xFF) {
-            flash_size = ((data[ITEM_3] << BIT_24) + (data[ITEM_2] << BIT_16) +
-                          (data[ITEM_1] << BIT_8) + (data[ITEM_0] << BIT_0) + 1) / BIT_8;
-        }
     } else {
-        uint8_t data[ITEM_4] = {0};
         qspi_command_t command = {
-            .instruction      = SPI_FLASH_CMD_SFUD,   // SPI_FLASH_CMD_SFUD  //SPI_FLASH_CMD_RDSR
-            .address          = 0x000034,
+            .instruction      = SPI_FLASH_CMD_RDID,
+            .address          = 0,
             .instruction_size = QSPI_INSTSIZE_08_BITS,
-            .address_size     = QSPI_ADDRSIZE_24_BITS,
+            .address_size     = QSPI_ADDRSIZE_00_BITS,
             .data_size        = QSPI_DATASIZE_08_BITS,
-            .dummy_cycles     = 8,
+            .dummy_cycles     = 0,
             .instruction_address_mode = QSPI_INST_ADDR_ALL_IN_SPI,
             .data_mode        = QSPI_DATA_MODE_SPI,
-            .length           = sizeof(data),
+            .length           = 3,
         };
 
         g_qspi_ctl.qspi_rcv_done = 0;
         app_qspi_command_receive_async(g_qspi_ctl.qspi_id, &command, data);
         while (g_qspi_ctl.qspi_rcv_done == 0);
+    }
 
-        if (data[ITEM_0] != 0 && data[ITEM_3] < 0xFF) {
-            flash_size = ((data[ITEM_3] << BIT_24) + (data[ITEM_2] << BIT_16) +
-                          (data[ITEM_1] << BIT_8) + (data[ITEM_0] << BIT_0) + 1) / BIT_8;
+    return (((uint32_t)data[ITEM_0] << BIT_16) + ((uint32_t)data[ITEM_1] << BIT_8) + data[ITEM_2]);
+}
+
+/*
+ * Returns the JEDEC ID. Without SFDP the size comes from its capacity byte, as far as 3-byte
+ * addresses reach.
+ */
+static uint32_t spi_flash_caps_probe(spi_flash_caps_t *p_caps)
+{
+    bool sfdp = spi_flash_sfdp_probe(p_caps);
+    uint32_t id = spi_flash_read_id();
+    uint32_t capacity = id & 0xFF;
+
+    if (!sfdp && (capacity >= SPI_FLASH_ID_CAPACITY_MIN) && (capacity <= SPI_FLASH_ID_CAPACITY_MAX)) {
+        p_caps->size = 1UL << capacity;
+        if (p_caps->size > SPI_FLASH_SIZE_3B_MAX) {
+            p_caps->size = SPI_FLASH_SIZE_3B_MAX;
         }
     }
 
-    return flash_size;
+    return id;
+}
+
+static uint32_t spi_flash_device_size(void)
+{
+    return g_flash_caps.size;
 }
 
+/* The page buffers of this driver hold SPI_FLASH_PAGE_SIZE bytes. */
+static uint32_t spi_flash_page_size(void)
+{
+    return (g_flash_caps.page_size < SPI_FLASH_PAGE_SIZE) ? g_flash_caps.page_size : SPI_FLASH_PAGE_SIZE;
+}
 
-static uint32_t spim_flash_write(uint32_t address, uint8_t *buffer, uint32_t nbytes)
+static const spi_flash_erase_type_t *spi_flash_erase_pick(uint32_t address, uint32_t remain)
 {
-    uint8_t control_frame[ITEM_4] = {0};
+    uint32_t i;
+
+    for (i = SPI_FLASH_ERASE_TYPES - 1; i > 0; i--) {
+        uint32_t size = g_flash_caps.erase[i].size;
+        if ((size != 0) && ((address & (size - 1)) == 0) && (remain >= size)) {
+            return &g_flash_caps.erase[i];
+        }
+    }
 
-    control_frame[ITEM_0] = SPI_FLASH_CMD_PP;
-    control_frame[ITEM_1] = (address >> BIT_16) & 0xFF;
-    control_frame[ITEM_2] = (address >> BIT_8) & 0xFF;
-    control_frame[ITEM_3] = address & 0xFF;
+    return &g_flash_caps.erase[0];
+}
+
+static uint32_t spim_flash_write(uint32_t address, uint8_t *buffer, uint32_t nbytes)
+{
+    uint8_t control_frame[ITEM_5] = {0};
+    uint32_t length = spi_flash_addr_frame(control_frame, SPI_FLASH_CMD_PP, address);
 
     g_qspi_ctl.spi_tmt_done = 0;
-    app_spi_write_memory_async(g_qspi_ctl.spi_id, control_frame, buffer, sizeof(control_frame), nbytes);
+    app_spi_write_memory_async(g_qspi_ctl.spi_id, control_frame, buffer, length, nbytes);
     while (g_qspi_ctl.spi_tmt_done == 0);
 
     return nbytes;
 }
 
-static uint32_t qspi_flash_write(uint32_t address, uint8_t *buffer, uint32_t nbytes)
+static uint16_t qspi_flash_program_start(uint32_t address, uint8_t *buffer, uint32_t nbytes)
 {
     qspi_command_t command = {
         .instruction      = SPI_FLASH_CMD_PP,
         .address          = address,
         .instruction_size = QSPI_INSTSIZE_08_BITS,
-        .address_size     = QSPI_ADDRSIZE_24_BITS,
+        .address_size     = qspi_flash_addr_size(),
         .data_size        = QSPI_DATASIZE_08_BITS,
         .dummy_cycles     = 0,
         .instruction_address_mode = QSPI_INST_ADDR_ALL_IN_SPI,
@@ -246,36 +853,174 @@ static uint32_t qspi_flash_write(uint32_t address, uint8_t *buffer, uint32_t nby
         .length           = nbytes,
     };
 
-    g_qspi_ctl.qspi_tmt_done = 0;
-    app_qspi_command_transmit_async(g_qspi_ctl.qspi_id, &command, buffer);
-    while (g_qspi_ctl.qspi_tmt_done == 0);
+    if (SPI_FLASH_MODE_QUAD == g_flash_mode) {
+        command.instruction = SPI_FLASH_CMD_QPP;
+        command.data_mode   = QSPI_DATA_MODE_QUADSPI;
+    }
 
-    return nbytes;
+    return app_qspi_command_transmit_async(g_qspi_ctl.qspi_id, &command, buffer);
 }
 
-static uint32_t spim_flash_read(uint32_t address, uint8_t *buffer, uint32_t nbytes)
+/*
+ * Pipelined page writer for QSPI. Every step is started from the completion callback of the one
+ * before, so the caller does not spin: WREN -> program -> status polls -> WREN of the next page.
+ * While a page programs (about SPI_FLASH_PAGE_PROG_US) the next one is copied into the other
+ * staging buffer, which also keeps the DMA source in RAM when the caller passes XIP data.
+ */
+static void spi_flash_pipe_stage(uint8_t idx)
+{
+    uint32_t len = spi_flash_page_size() - (g_pipe.next_addr & (spi_flash_page_size() - 1));
+
+    if (len > g_pipe.left) {
+        len = g_pipe.left;
+    }
+    memcpy(g_pipe_buf[idx], g_pipe.p_src, len);
+    g_pipe.page_addr[idx] = g_pipe.next_addr;
+    g_pipe.page_len[idx]  = len;
+    g_pipe.next_addr += len;
+    g_pipe.p_src     += len;
+    g_pipe.left      -= len;
+}
+
+static void spi_flash_pipe_finish(void)
+{
+    spi_flash_write_cb_t cb = g_pipe.cb;
+
+    g_pipe.state = PIPE_IDLE;
+    spi_flash_unlock();
+    if (cb != NULL) {
+        cb(g_pipe.written, g_pipe.p_arg);
+    }
+}
+
+static void spi_flash_pipe_wren(void)
+{
+    g_pipe.state = PIPE_WREN;
+    g_pipe.xfer  = true;
+    if (app_qspi_transmit_async(g_qspi_ctl.qspi_id, &g_pipe_wren, sizeof(g_pipe_wren)) != APP_DRV_SUCCESS) {
+        g_pipe.xfer = false;
+        spi_flash_pipe_finish();
+    }
+}
+
+static void spi_flash_pipe_poll(void)
+{
+    qspi_command_t command = {
+        .instruction      = SPI_FLASH_CMD_RDSR,
+        .address          = 0,
+        .instruction_size = QSPI_INSTSIZE_08_BITS,
+        .address_size     = QSPI_ADDRSIZE_00_BITS,
+        .data_size        = QSPI_DATASIZE_08_BITS,
+        .dummy_cycles     = 0,
+        .instruction_address_mode = QSPI_INST_ADDR_ALL_IN_SPI,
+        .data_mode        = QSPI_DATA_MODE_SPI,
+        .length           = 1,
+    };
+
+    g_pipe.state = PIPE_WIP_READ;
+    g_pipe.xfer  = true;
+    g_pipe_stats.wip_polls++;
+    if (app_qspi_command_receive_async(g_qspi_ctl.qspi_id, &command, &g_pipe.status) != APP_DRV_SUCCESS) {
+        g_pipe.xfer = false;
+        spi_flash_pipe_finish();
+    }
+}
+
+/* Without a timer the status is read back to back, which keeps the bus busy but not the caller. */
+static void spi_flash_pipe_wait(uint32_t delay_us)
+{
+    g_pipe.state = PIPE_WIP_WAIT;
+    if (g_pipe_timer_start != NULL) {
+        g_pipe_timer_start(delay_us);
+    } else {
+        spi_flash_pipe_poll();
+    }
+}
+
+static void spi_flash_pipe_event(app_qspi_evt_type_t type)
 {
-    uint8_t control_frame[ITEM_4] = {0};
+    /* Once a page may be programming, give up only when the part is idle, not to leave it busy. */
+    if (type == APP_QSPI_EVT_ERROR) {
+        if (!g_pipe.failed && ((g_pipe.state == PIPE_PROG) || (g_pipe.state == PIPE_WIP_READ))) {
+            g_pipe.failed = true;
+            spi_flash_pipe_wait(SPI_FLASH_WIP_POLL_US);
+        } else {
+            spi_flash_pipe_finish();
+        }
+        return;
+    }
 
-    control_frame[ITEM_0] = SPI_FLASH_CMD_READ;
-    control_frame[ITEM_1] = (address >> BIT_16) & 0xFF;
-    control_frame[ITEM_2] = (address >> BIT_8) & 0xFF;
-    control_frame[ITEM_3] = address & 0xFF;
+    switch (g_pipe.state) {
+        case PIPE_WREN:
+            g_pipe.state = PIPE_PROG;
+            g_pipe.xfer  = true;
+            if (qspi_flash_program_start(g_pipe.page_addr[g_pipe.cur], g_pipe_buf[g_pipe.cur],
+                                         g_pipe.page_len[g_pipe.cur]) != APP_DRV_SUCCESS) {
+                g_pipe.xfer = false;
+                spi_flash_pipe_finish();
+            }
+            break;
+
+        case PIPE_PROG:
+            /* The page is programming now, stage the next one before polling for it. */
+            if (g_pipe.left) {
+                spi_flash_pipe_stage(g_pipe.cur ^ 1);
+                g_pipe.staged = true;
+            }
+            spi_flash_pipe_wait(SPI_FLASH_PAGE_PROG_US);
+            break;
+
+        case PIPE_WIP_READ:
+            if (g_pipe.status & SPI_FLASH_SR_WIP) {
+                spi_flash_pipe_wait(SPI_FLASH_WIP_POLL_US);
+                break;
+            }
+            if (g_pipe.failed) {
+                spi_flash_pipe_finish();
+                break;
+            }
+            g_pipe.written += g_pipe.page_len[g_pipe.cur];
+            g_pipe_stats.pages++;
+            if (!g_pipe.staged) {
+                spi_flash_pipe_finish();
+                break;
+            }
+            g_pipe.cur ^= 1;
+            g_pipe.staged = false;
+            spi_flash_pipe_wren();
+            break;
+
+        default:
+            break;
+    }
+}
+
+static uint32_t spim_flash_read(uint32_t address, uint8_t *buffer, uint32_t nbytes)
+{
+    uint8_t control_frame[ITEM_5] = {0};
+    uint32_t length = spi_flash_addr_frame(control_frame, SPI_FLASH_CMD_READ, address);
 
     g_qspi_ctl.spi_rcv_done = 0;
-    app_spi_read_memory_async(g_qspi_ctl.spi_id, control_frame, buffer, sizeof(control_frame), nbytes);
+    app_spi_read_memory_async(g_qspi_ctl.spi_id, control_frame, buffer, length, nbytes);
     while (g_qspi_ctl.spi_rcv_done == 0);
 
     return nbytes;
 }
 
+/* With 4-byte addresses the 0xEB mode byte no longer fits in the 32-bit address phase. */
+static bool qspi_flash_read_144_usable(void)
+{
+    return (g_flash_caps.read_144.cmd != 0) &&
+           ((g_flash_caps.addr_bytes == ITEM_3) || (g_flash_caps.read_144.mode_clocks < ITEM_2));
+}
+
 static uint32_t qspi_flash_read(uint32_t address, uint8_t *buffer, uint32_t nbytes)
 {
     qspi_command_t command = {
         .instruction      = SPI_FLASH_CMD_READ,
         .address          = address,
         .instruction_size = QSPI_INSTSIZE_08_BITS,
-        .address_size     = QSPI_ADDRSIZE_24_BITS,
+        .address_size     = qspi_flash_addr_size(),
         .data_size        = QSPI_DATASIZE_08_BITS,
         .dummy_cycles     = 0,
         .instruction_address_mode = QSPI_INST_ADDR_ALL_IN_SPI,
@@ -283,6 +1028,25 @@ static uint32_t qspi_flash_read(uint32_t address, uint8_t *buffer, uint32_t nbyt
         .length           = nbytes,
     };
 
+    if ((SPI_FLASH_MODE_QUAD == g_flash_mode) && qspi_flash_read_144_usable()) {
+        const spi_flash_read_mode_t *p_mode = &g_flash_caps.read_144;
+
+        command.instruction  = p_mode->cmd;
+        command.dummy_cycles = p_mode->mode_clocks + p_mode->dummy_clocks;
+        command.instruction_address_mode = QSPI_INST_IN_SPI_ADDR_IN_SPIFRF;
+        command.data_mode    = QSPI_DATA_MODE_QUADSPI;
+        /* The mode byte goes out as the low byte of a 32-bit address, so its value is defined. */
+        if (p_mode->mode_clocks >= ITEM_2) {
+            command.address      = (address << BIT_8) | SPI_FLASH_QUAD_MODE_BITS;
+            command.address_size = QSPI_ADDRSIZE_32_BITS;
+            command.dummy_cycles -= ITEM_2;
+        }
+    } else if ((SPI_FLASH_MODE_QUAD == g_flash_mode) && g_flash_caps.read_114.cmd) {
+        command.instruction  = g_flash_caps.read_114.cmd;
+        command.dummy_cycles = g_flash_caps.read_114.mode_clocks + g_flash_caps.read_114.dummy_clocks;
+        command.data_mode    = QSPI_DATA_MODE_QUADSPI;
+    }
+
     g_qspi_ctl.qspi_rcv_done = 0;
     app_qspi_command_receive_async(g_qspi_ctl.qspi_id, &command, buffer);
     while (g_qspi_ctl.qspi_rcv_done == 0);
@@ -290,33 +1054,25 @@ static uint32_t qspi_flash_read(uint32_t address, uint8_t *buffer, uint32_t nbyt
     return nbytes;
 }
 
-bool spim_flash_sector_erase(uint32_t address)
+bool spim_flash_sector_erase(uint8_t cmd, uint32_t address)
 {
-    uint8_t control_frame[4] = {0};
-
-    control_frame[ITEM_0] = SPI_FLASH_CMD_SE;
-    control_frame[ITEM_1] = (address >> BIT_16) & 0xFF;
-    control_frame[ITEM_2] = (address >> BIT_8) & 0xFF;
-    control_frame[ITEM_3] = address & 0xFF;
+    uint8_t control_frame[ITEM_5] = {0};
+    uint32_t length = spi_flash_addr_frame(control_frame, cmd, address);
 
     g_qspi_ctl.spi_tmt_done = 0;
-    app_spi_transmit_async(g_qspi_ctl.spi_id, control_frame, sizeof(control_frame));
+    app_spi_transmit_async(g_qspi_ctl.spi_id, control_frame, length);
     while (g_qspi_ctl.spi_tmt_done == 0);
 
     return true;
 }
 
-bool qspi_flash_sector_erase(uint32_t address)
+bool qspi_flash_sector_erase(uint8_t cmd, uint32_t address)
 {
-    uint8_t control_frame[4] = {0};
-
-    control_frame[ITEM_0] = SPI_FLASH_CMD_SE;
-    control_frame[ITEM_1] = (address >> BIT_16) & 0xFF;
-    control_frame[ITEM_2] = (address >> BIT_8) & 0xFF;
-    control_frame[ITEM_3] = address & 0xFF;
+    uint8_t control_frame[ITEM_5] = {0};
+    uint32_t length = spi_flash_addr_frame(control_frame, cmd, address);
 
     g_qspi_ctl.qspi_tmt_done = 0;
-    app_qspi_transmit_async(g_qspi_ctl.qspi_id, control_frame, sizeof(control_frame));
+    app_qspi_transmit_async(g_qspi_ctl.qspi_id, control_frame, length);
     while (g_qspi_ctl.qspi_tmt_done == 0);
 
     return true;
@@ -352,8 +1108,10 @@ uint32_t FLASH_SPIM_ID_init(flash_init_t *p_flash_init)
     app_spi_deinit(g_qspi_ctl.spi_id);
 
     if (app_spi_init(&spim_params, spi_app_spim_callback)) {
-        return;
+        return false;
     }
+
+    return true;
 }
 
 uint32_t FLASH_SPIM_ID0_ID1_init(flash_init_t *p_flash_init, app_qspi_params_t *qspi_params)
@@ -395,6 +1153,8 @@ uint32_t FLASH_SPIM_ID0_ID1_init(flash_init_t *p_flash_init, app_qspi_params_t *
     qspi_params->pin_cfg.io_3.mux       = p_flash_init->flash_io.qspi_io3.mux;
     qspi_params->pin_cfg.io_3.pull      = APP_IO_NOPULL;
     qspi_params->pin_cfg.io_3.enable    = APP_SPI_PIN_ENABLE;
+
+    return true;
 }
 
 uint32_t IO_init(app_qspi_params_t qspi_params)
@@ -428,36 +1188,98 @@ uint32_t IO_init(app_qspi_params_t qspi_params)
     if (app_io_write_pin(qspi_params.pin_cfg.io_3.type, qspi_params.pin_cfg.io_3.pin, APP_IO_PIN_SET)) {
         return false;
     }
+
+    return true;
 }
 
+#if (SPI_FLASH_QUAD_ENABLE == 1)
+/* With QE set IO2/IO3 stop being WP#/HOLD#, so they go back from GPIO high to the QSPI. */
+static void qspi_flash_quad_init(app_qspi_params_t *p_qspi_params, uint32_t device_id)
+{
+    app_io_init_t io_init = APP_IO_DEFAULT_CONFIG;
+
+    g_flash_mode = SPI_FLASH_MODE_SINGLE;
+    if (!qspi_flash_read_144_usable() && (g_flash_caps.read_114.cmd == 0)) {
+        return;
+    }
+    if (!qspi_flash_quad_enable(device_id)) {
+        return;
+    }
+
+    io_init.mode = APP_IO_MODE_MUX;
+    io_init.pull = APP_IO_PULLUP;
+    io_init.pin  = p_qspi_params->pin_cfg.io_2.pin;
+    io_init.mux  = p_qspi_params->pin_cfg.io_2.mux;
+    if (app_io_init(p_qspi_params->pin_cfg.io_2.type, &io_init)) {
+        return;
+    }
+
+    io_init.pin  = p_qspi_params->pin_cfg.io_3.pin;
+    io_init.mux  = p_qspi_params->pin_cfg.io_3.mux;
+    if (app_io_init(p_qspi_params->pin_cfg.io_3.type, &io_init)) {
+        return;
+    }
+
+    g_flash_mode = SPI_FLASH_MODE_QUAD;
+}
+#endif
+
 /*
  * GLOBAL FUNCTION DEFINITIONS
  ****************************************************************************************
  */
 bool spi_flash_init(flash_init_t *p_flash_init)
 {
+    app_qspi_params_t qspi_params = DEFAULT_QSPI_PARAM_CONFIG;
+    uint32_t device_id;
+    bool ret;
+
+    if ((p_flash_init == NULL) || (p_flash_init->spi_type >= FLASH_SPI_ID_MAX)) {
+        return false;
+    }
+    if (!spi_flash_sem_init() || !spi_flash_lock_excl()) {
+        return false;
+    }
+
     memcpy_s(&g_flash_init, sizeof (g_flash_init), p_flash_init, sizeof(flash_init_t));
+    spi_flash_caps_default(&g_flash_caps);
+    g_flash_mode = SPI_FLASH_MODE_SINGLE;
 
     if (FLASH_SPIM_ID == p_flash_init->spi_type) {
-        FLASH_SPIM_ID_init(p_flash_init);
-    } else if ((FLASH_QSPI_ID0 == p_flash_init->spi_type) || (FLASH_QSPI_ID1 == p_flash_init->spi_type)) {
-        app_qspi_params_t qspi_params = DEFAULT_QSPI_PARAM_CONFIG;
+        ret = FLASH_SPIM_ID_init(p_flash_init);
+    } else {
         FLASH_SPIM_ID0_ID1_init(p_flash_init, &qspi_params);
         app_qspi_deinit(g_qspi_ctl.qspi_id);
-        IO_init(qspi_params);
+        ret = IO_init(qspi_params);
     }
+    if (ret) {
+        device_id = spi_flash_caps_probe(&g_flash_caps);
+        spi_flash_addr4_enter();
+#if (SPI_FLASH_QUAD_ENABLE == 1)
+        if (FLASH_SPIM_ID != p_flash_init->spi_type) {
+            qspi_flash_quad_init(&qspi_params, device_id);
+        }
+#else
+        (void)device_id;
+#endif
+    }
+    spi_flash_unlock();
 
-    return true;
+    return ret;
 }
 
-uint32_t spi_flash_write(uint32_t address, uint8_t *buffer, uint32_t nbytes)
+spi_flash_mode_t spi_flash_mode_get(void)
+{
+    return g_flash_mode;
+}
+
+static uint32_t spim_flash_write_pages(uint32_t address, uint8_t *buffer, uint32_t nbytes)
 {
     uint32_t page_ofs, write_size, write_cont = nbytes;
-    hal_status_t status      = HAL_OK;
 
     while (write_cont) {
-        page_ofs = address & 0xFF;
-        write_size = EXFLASH_SIZE_PAGE_BYTES - page_ofs;
+        page_ofs = address & (spi_flash_page_size() - 1);
+        write_size = spi_flash_page_size() - page_ofs;
 
         if (write_cont < write_size) {
             write_size = write_cont;
@@ -467,31 +1289,108 @@ uint32_t spi_flash_write(uint32_t address, uint8_t *buffer, uint32_t nbytes)
         }
 
         spi_flash_write_enable();
-
-        if (FLASH_SPIM_ID == g_flash_init.spi_type) {
-            spim_flash_write(address, buffer, write_size);
-        } else {
-            qspi_flash_write(address, buffer, write_size);
-        }
-
+        spim_flash_write(address, buffer, write_size);
         while (spi_flash_read_status() & 0x1);
 
         address += write_size;
         buffer += write_size;
     }
 
-    return ((status == HAL_OK) ? nbytes : 0);
+    return nbytes;
+}
+
+bool spi_flash_write_async(uint32_t address, uint8_t *buffer, uint32_t nbytes,
+                           spi_flash_write_cb_t cb, void *p_arg)
+{
+    if ((buffer == NULL) || (nbytes == 0) || !spi_flash_lock_excl()) {
+        return false;
+    }
+
+    if (FLASH_SPIM_ID == g_flash_init.spi_type) {
+        uint32_t written = spim_flash_write_pages(address, buffer, nbytes);
+        spi_flash_unlock();
+        if (cb != NULL) {
+            cb(written, p_arg);
+        }
+        return true;
+    }
+
+    g_pipe.next_addr = address;
+    g_pipe.p_src     = buffer;
+    g_pipe.left      = nbytes;
+    g_pipe.written   = 0;
+    g_pipe.cur       = 0;
+    g_pipe.staged    = false;
+    g_pipe.failed    = false;
+    g_pipe.cb        = cb;
+    g_pipe.p_arg     = p_arg;
+    spi_flash_pipe_stage(0);
+    g_pipe_stats.writes++;
+    spi_flash_pipe_wren();
+
+    return true;
+}
+
+bool spi_flash_write_busy(void)
+{
+    return g_pipe.state != PIPE_IDLE;
+}
+
+void spi_flash_write_timer_register(spi_flash_timer_start_t timer_start)
+{
+    g_pipe_timer_start = timer_start;
+}
+
+void spi_flash_write_timer_expired(void)
+{
+    if (g_pipe.state == PIPE_WIP_WAIT) {
+        spi_flash_pipe_poll();
+    }
+}
+
+void spi_flash_write_stats_get(spi_flash_write_stats_t *p_stats)
+{
+    if (p_stats != NULL) {
+        *p_stats = g_pipe_stats;
+    }
+}
+
+static void spi_flash_write_done(uint32_t written, void *p_arg)
+{
+    *(uint32_t *)p_arg = written;
+    (void)LOS_SemPost(g_flash_done);
+}
+
+/* Sleeps on g_flash_done until the writer completes, so it cannot be used from an interrupt. */
+uint32_t spi_flash_write(uint32_t address, uint8_t *buffer, uint32_t nbytes)
+{
+    uint32_t written = 0;
+
+    if (__get_IPSR()) {
+        return 0;
+    }
+    if (!spi_flash_write_async(address, buffer, nbytes, spi_flash_write_done, &written)) {
+        return 0;
+    }
+    (void)LOS_SemPend(g_flash_done, LOS_WAIT_FOREVER);
+
+    return (written == nbytes) ? nbytes : 0;
 }
 
 uint32_t spi_flash_read(uint32_t address, uint8_t *buffer, uint32_t nbytes)
 {
     uint32_t count = 0;
 
+    if (!spi_flash_lock_read()) {
+        return 0;
+    }
     if (FLASH_SPIM_ID == g_flash_init.spi_type) {
         count = spim_flash_read(address, buffer, nbytes);
     } else {
         count = qspi_flash_read(address, buffer, nbytes);
     }
+    g_flash_reads++;
+    spi_flash_unlock();
 
     return count;
 }
@@ -502,10 +1401,16 @@ bool spi_flash_sector_erase(uint32_t address, uint32_t size)
 
     uint32_t erase_addr = address;
     uint32_t sector_ofs, erase_size, erase_cont = size;
+    const spi_flash_erase_type_t *p_type;
 
+    if ((g_flash_caps.erase[0].size == 0) || !spi_flash_lock_excl()) {
+        return false;
+    }
     while (erase_cont) {
-        sector_ofs = erase_addr & 0xFFF;
-        erase_size = EXFLASH_SIZE_SECTOR_BYTES - sector_ofs;
+        /* The largest erase type aligned at erase_addr that fits, else the smallest one. */
+        p_type = spi_flash_erase_pick(erase_addr, erase_cont);
+        sector_ofs = erase_addr & (p_type->size - 1);
+        erase_size = p_type->size - sector_ofs;
 
         if (erase_cont < erase_size) {
             erase_size = erase_cont;
@@ -517,93 +1422,69 @@ bool spi_flash_sector_erase(uint32_t address, uint32_t size)
         spi_flash_write_enable();
 
         if (FLASH_SPIM_ID == g_flash_init.spi_type) {
-            status = spim_flash_sector_erase(erase_addr);
+            status = spim_flash_sector_erase(p_type->cmd, erase_addr);
         } else {
-            status = qspi_flash_sector_erase(erase_addr);
+            status = qspi_flash_sector_erase(p_type->cmd, erase_addr);
         }
 
-        while (spi_flash_read_status() & 0x1);
+        spi_flash_erase_wait();
 
         erase_addr += erase_size;
     }
+    spi_flash_unlock();
 
     return status;
 }
 
 bool spi_flash_chip_erase(void)
 {
-    hal_status_t status = HAL_OK;
+    bool status;
     uint8_t control_frame[1] = {SPI_FLASH_CMD_CE};
 
-    spi_flash_write_enable();
-
-    if (FLASH_SPIM_ID == g_flash_init.spi_type) {
-        g_qspi_ctl.spi_tmt_done = 0;
-        app_spi_transmit_async(g_qspi_ctl.spi_id, control_frame, sizeof(control_frame));
-        while (g_qspi_ctl.spi_tmt_done == 0);
-    } else {
-        g_qspi_ctl.qspi_tmt_done = 0;
-        app_qspi_transmit_async(g_qspi_ctl.qspi_id, control_frame, sizeof(control_frame));
-        while (g_qspi_ctl.qspi_tmt_done == 0);
+    if (!spi_flash_lock_excl()) {
+        return false;
     }
+    spi_flash_write_enable();
+    status = spi_flash_transmit(control_frame, sizeof(control_frame));
     while (spi_flash_read_status() & 0x1);
+    spi_flash_unlock();
 
-    return ((status == HAL_OK) ? true : false);
+    return status;
 }
 
+/*
+ * Both instructions go through the controller set up by spi_flash_init, as every other command.
+ * The part takes no instruction for tRST after it; its status reads back busy until then. The
+ * reset also leaves 4-byte mode, which is entered again.
+ */
 void spi_flash_chip_reset(void)
 {
     uint8_t control_frame[1] = {SPI_FLASH_CMD_RSTEN};
 
-    if (FLASH_SPIM_ID == g_flash_init.spi_type) {
-        g_qspi_ctl.spi_tmt_done = 0;
-        app_spi_transmit_async(g_qspi_ctl.spi_id, control_frame, sizeof(control_frame));
-        while (g_qspi_ctl.spi_tmt_done == 0);
-    } else {
-        hal_qspi_transmit(&g_qspi_handle, control_frame, sizeof(control_frame), MS_5000);
+    if (!spi_flash_lock_excl()) {
+        return;
     }
-
-    control_frame[0] = SPI_FLASH_CMD_RST;
-    if (FLASH_SPIM_ID == g_flash_init.spi_type) {
-        g_qspi_ctl.spi_tmt_done = 0;
-        app_spi_transmit_async(g_qspi_ctl.spi_id, control_frame, sizeof(control_frame));
-        while (g_qspi_ctl.spi_tmt_done == 0);
-    } else {
-        hal_qspi_transmit(&g_qspi_handle, control_frame, sizeof(control_frame), MS_5000);
+    if (spi_flash_transmit(control_frame, sizeof(control_frame))) {
+        control_frame[0] = SPI_FLASH_CMD_RST;
+        if (spi_flash_transmit(control_frame, sizeof(control_frame))) {
+            while (spi_flash_read_status() & SPI_FLASH_SR_WIP);
+            spi_flash_addr4_enter();
+        }
     }
-
-    return;
+    spi_flash_unlock();
 }
 
 uint32_t spi_flash_device_id(void)
 {
-    uint8_t data[3] = {0};
+    uint32_t id;
 
-    if (FLASH_SPIM_ID == g_flash_init.spi_type) {
-        uint8_t control_frame[1] = {SPI_FLASH_CMD_RDID};
-
-        g_qspi_ctl.spi_rcv_done = 0;
-        app_spi_read_memory_async(g_qspi_ctl.spi_id, control_frame, data, sizeof(control_frame), sizeof(data));
-        while (g_qspi_ctl.spi_rcv_done == 0);
-    } else {
-        qspi_command_t command = {
-            .instruction      = SPI_FLASH_CMD_RDID,
-            .address          = 0,
-            .instruction_size = QSPI_INSTSIZE_08_BITS,
-            .address_size     = QSPI_ADDRSIZE_00_BITS,
-            .data_size        = QSPI_DATASIZE_08_BITS,
-            .dummy_cycles     = 0,
-            .instruction_address_mode = QSPI_INST_ADDR_ALL_IN_SPI,
-            .data_mode        = QSPI_DATA_MODE_SPI,
-            .length           = 3,
-        };
-
-        g_qspi_ctl.qspi_rcv_done = 0;
-        app_qspi_command_receive_async(g_qspi_ctl.qspi_id, &command, data);
-        while (g_qspi_ctl.qspi_rcv_done == 0);
+    if (!spi_flash_lock()) {
+        return 0;
     }
+    id = spi_flash_read_id();
+    spi_flash_unlock();
 
-    return (((uint32_t)data[ITEM_0] << BIT_16) + ((uint32_t)data[ITEM_1] << BIT_8) + data[ITEM_2]);
+    return id;
 }
 
 void spi_flash_device_info(uint32_t *id, uint32_t *size)
@@ -618,3 +1499,7 @@ void spi_flash_device_info(uint32_t *id, uint32_t *size)
     return;
 }
 
+const spi_flash_caps_t *spi_flash_caps_get(void)
+{
+    return &g_flash_caps;
+}
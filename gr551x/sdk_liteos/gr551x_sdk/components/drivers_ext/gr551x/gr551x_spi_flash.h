@@ -52,6 +52,7 @@ extern "C" {
 #define SPI_FLASH_CMD_WRSR              0x01
 #define SPI_FLASH_CMD_WRSR1             0x31
 #define SPI_FLASH_CMD_RDSR              0x05
+#define SPI_FLASH_CMD_RDSR1             0x35
 
 #define SPI_FLASH_CMD_WREN              0x06
 #define SPI_FLASH_CMD_WRDI              0x04
@@ -65,6 +66,7 @@ extern "C" {
 #define SPI_FLASH_CMD_READ_RESET        0xFF
 
 #define SPI_FLASH_CMD_PP                0x02
+#define SPI_FLASH_CMD_QPP               0x32
 #define SPI_FLASH_CMD_SE                0x20
 #define SPI_FLASH_CMD_BE_32             0x52
 #define SPI_FLASH_CMD_BE_64             0xD8
@@ -81,7 +83,12 @@ extern "C" {
 #define SPI_FLASH_CMD_DP                0xB9
 #define SPI_FLASH_CMD_RDP               0xAB
 
+#define SPI_FLASH_CMD_EN4B              0xB7
+#define SPI_FLASH_CMD_EX4B              0xE9
+
 #define SPI_FLASH_CMD_SFUD              0x5A
+#define SPI_FLASH_CMD_RDSR2_QE7         0x3F
+#define SPI_FLASH_CMD_WRSR2_QE7         0x3E
 
 #define DUMMY_BYTE                      0xFF
 
@@ -153,6 +160,11 @@ typedef struct _flash_init {
     flash_io_t flash_io;
 } flash_init_t;
 
+typedef enum {
+    SPI_FLASH_MODE_SINGLE,           /**< SPI_FLASH_CMD_READ and SPI_FLASH_CMD_PP on one line. */
+    SPI_FLASH_MODE_QUAD,             /**< SPI_FLASH_CMD_QIOFR (1-4-4) and SPI_FLASH_CMD_QPP (1-1-4). */
+} spi_flash_mode_t;
+
 typedef struct flash_control {
     uint8_t         qspi_tmt_done;
     uint8_t         qspi_rcv_done;
@@ -162,6 +174,68 @@ typedef struct flash_control {
     app_spi_id_t    spi_id;
 } qspi_control_t;
 
+#define SPI_FLASH_ERASE_TYPES           4
+
+/** JESD216 quad enable requirements, basic flash parameter table DWORD 15 bits 22:20. */
+typedef enum {
+    SPI_FLASH_QE_NONE,               /**< No QE bit, quad commands always available. */
+    SPI_FLASH_QE_SR2_BIT1_WRSR,      /**< Bit 1 of SR2, SPI_FLASH_CMD_WRSR with two bytes. */
+    SPI_FLASH_QE_SR1_BIT6,           /**< Bit 6 of SR1, SPI_FLASH_CMD_WRSR with one byte. */
+    SPI_FLASH_QE_SR2_BIT7,           /**< Bit 7 of SR2, SPI_FLASH_CMD_WRSR2_QE7 / SPI_FLASH_CMD_RDSR2_QE7. */
+    SPI_FLASH_QE_SR2_BIT1_WRSR_KEEP, /**< As SPI_FLASH_QE_SR2_BIT1_WRSR, one byte writes keep SR2. */
+    SPI_FLASH_QE_SR2_BIT1_RDSR1,     /**< As SPI_FLASH_QE_SR2_BIT1_WRSR, SR2 read with SPI_FLASH_CMD_RDSR1. */
+    SPI_FLASH_QE_SR2_BIT1_WRSR1,     /**< Bit 1 of SR2, SPI_FLASH_CMD_WRSR1 with one byte. */
+    SPI_FLASH_QE_UNKNOWN = 0xFF,     /**< No SFDP, the driver probes by manufacturer. */
+} spi_flash_qe_t;
+
+/** How a part that takes 3 or 4 address bytes enters 4-byte mode, JESD216B DWORD 16 bits 31:24. */
+typedef enum {
+    SPI_FLASH_ADDR4_ENTER_NONE,      /**< Not needed, or no method the driver supports. */
+    SPI_FLASH_ADDR4_ENTER_EN4B,      /**< SPI_FLASH_CMD_EN4B. */
+    SPI_FLASH_ADDR4_ENTER_WREN_EN4B, /**< SPI_FLASH_CMD_WREN, then SPI_FLASH_CMD_EN4B. */
+} spi_flash_addr4_enter_t;
+
+typedef struct {
+    uint32_t size;                   /**< Erase size in bytes, 0 if the slot is unused. */
+    uint8_t  cmd;                    /**< Erase instruction. */
+    uint16_t typ_ms;                 /**< Typical erase time, 0 if not reported. */
+} spi_flash_erase_type_t;
+
+typedef struct {
+    uint8_t cmd;                     /**< Instruction, 0 if the mode is not supported. */
+    uint8_t mode_clocks;             /**< Mode bit clocks after the address. */
+    uint8_t dummy_clocks;            /**< Wait state clocks after the mode bits. */
+} spi_flash_read_mode_t;
+
+/** Device capabilities, read from the JEDEC SFDP basic flash parameter table by spi_flash_init. */
+typedef struct {
+    bool                   sfdp;             /**< Filled in from SFDP, otherwise defaults. */
+    uint8_t                sfdp_rev;         /**< Table revision, major in the high nibble. */
+    uint32_t               size;             /**< Bytes the driver can address, 0 if unknown. */
+    uint16_t               page_size;        /**< Page program size in bytes. */
+    uint8_t                addr_bytes;       /**< Address bytes the driver sends, 3 or 4. */
+    bool                   addr4;            /**< 4-byte addressing supported. */
+    spi_flash_addr4_enter_t addr4_enter;     /**< Sent by spi_flash_init and spi_flash_chip_reset. */
+    spi_flash_read_mode_t  read_114;         /**< Quad output fast read. */
+    spi_flash_read_mode_t  read_144;         /**< Quad I/O fast read. */
+    spi_flash_qe_t         qe;               /**< Quad enable requirement. */
+    spi_flash_erase_type_t erase[SPI_FLASH_ERASE_TYPES];  /**< Ascending size, erase[0] the smallest. */
+    bool                   suspend;          /**< Erase suspend supported, used for waiting readers. */
+    uint8_t                suspend_cmd;
+    uint8_t                resume_cmd;
+} spi_flash_caps_t;
+
+/**< Called when an spi_flash_write_async request ends, with the number of bytes programmed. */
+typedef void (*spi_flash_write_cb_t)(uint32_t written, void *p_arg);
+
+/**< Arms a one-shot timer that calls spi_flash_write_timer_expired after delay_us. */
+typedef void (*spi_flash_timer_start_t)(uint32_t delay_us);
+
+typedef struct {
+    uint32_t writes;                 /**< spi_flash_write_async requests started on QSPI. */
+    uint32_t pages;                  /**< Pages programmed by the pipelined writer. */
+    uint32_t wip_polls;              /**< Status reads issued while waiting for page programs. */
+} spi_flash_write_stats_t;
 
 /** @} */
 
@@ -175,8 +249,14 @@ typedef struct flash_control {
  * @brief  Initialize the SPI FLASH DRIVER according to the specified parameters
  *         in the spi_flash_io_t.
  *
+ * @note The calls below serialize on the flash: called from a task they wait for
+ *       the request in progress, an spi_flash_write_async included; called from
+ *       an interrupt while the flash is in use they fail.
+ *
  * @param[in]  p_params: Pointer to spi_flash_io_t parameter.
  *
+ * @retval true: If the controller and its pins were set up.
+ * @retval false: If the parameters are invalid or the controller could not be set up.
  ****************************************************************************************
  */
 bool spi_flash_init(flash_init_t *p_flash_init);
@@ -185,6 +265,9 @@ bool spi_flash_init(flash_init_t *p_flash_init);
  *******************************************************************************
  * @brief Write flash Memory.
  *
+ * @note The calling task sleeps until the last page is programmed, so this
+ *       returns 0 from an interrupt.
+ *
  * @param[in]       address: start address in flash to write data to.
  * @param[in,out]   buffer: buffer of data to write.
  * @param[in]       nbytes: number of bytes to write.
@@ -194,10 +277,79 @@ bool spi_flash_init(flash_init_t *p_flash_init);
  */
 uint32_t spi_flash_write(uint32_t address, uint8_t *buffer, uint32_t nbytes);
 
+/**
+ *******************************************************************************
+ * @brief Write flash Memory without blocking.
+ *
+ * @note On QSPI the pages are programmed by a state machine driven from the QSPI
+ *       completion interrupt: the next page is copied into a RAM staging buffer
+ *       while the current one programs, and the status is polled from the timer
+ *       set with spi_flash_write_timer_register, or back to back without one.
+ *       The first SPI_FLASH_PAGE_SIZE bytes of buffer are copied before this
+ *       returns, the rest must stay valid until cb is called. cb runs in
+ *       interrupt context. On SPIM the write completes before this returns.
+ *
+ * @param[in]       address: start address in flash to write data to.
+ * @param[in]       buffer: buffer of data to write.
+ * @param[in]       nbytes: number of bytes to write.
+ * @param[in]       cb: completion callback, may be NULL.
+ * @param[in]       p_arg: argument passed to cb.
+ *
+ * @retval true: If the write was started.
+ * @retval false: If the parameters are invalid, or if called from an interrupt
+ *                while the flash is in use.
+ *******************************************************************************
+ */
+bool spi_flash_write_async(uint32_t address, uint8_t *buffer, uint32_t nbytes,
+                           spi_flash_write_cb_t cb, void *p_arg);
+
+/**
+ *******************************************************************************
+ * @brief Check whether an spi_flash_write_async request is in progress.
+ *
+ * @note This does not wait: the other calls do that themselves.
+ *
+ * @retval true: If a write is in progress.
+ *******************************************************************************
+ */
+bool spi_flash_write_busy(void);
+
+/**
+ *******************************************************************************
+ * @brief Register the timer used to poll the status during page programs.
+ *
+ * @note The timer interrupt must call spi_flash_write_timer_expired. Pass NULL
+ *       to go back to back-to-back status reads.
+ *
+ * @param[in]       timer_start: function arming a one-shot timer.
+ *******************************************************************************
+ */
+void spi_flash_write_timer_register(spi_flash_timer_start_t timer_start);
+
+/**
+ *******************************************************************************
+ * @brief Timer expiry handler for the pipelined writer.
+ *******************************************************************************
+ */
+void spi_flash_write_timer_expired(void);
+
+/**
+ *******************************************************************************
+ * @brief Get the counters of the pipelined writer.
+ *
+ * @param[in,out]   p_stats: Pointer to the counters.
+ *******************************************************************************
+ */
+void spi_flash_write_stats_get(spi_flash_write_stats_t *p_stats);
+
 /**
  *******************************************************************************
  * @brief Read flash Memory.
  *
+ * @note On parts with erase suspend, a task reading while spi_flash_sector_erase
+ *       is waiting for an erase gets the flash between the suspend and resume
+ *       commands instead of waiting for the erase to finish.
+ *
  * @param[in]       address: start address in flash to read data.
  * @param[in,out]   buffer: buffer to read data to.
  * @param[in]       nbytes: number of bytes to read.
@@ -221,7 +373,7 @@ uint32_t spi_flash_read(uint32_t address, uint8_t *buffer, uint32_t nbytes);
  * @param[in] size: number of bytes to write.
  *
  * @retval true: If successful.
- * @retval false: If failure.
+ * @retval false: If failure, or if the part reports no erase type.
  *******************************************************************************
  */
 bool spi_flash_sector_erase(uint32_t address, uint32_t size);
@@ -264,6 +416,33 @@ uint32_t spi_flash_device_id(void);
  */
 void spi_flash_device_info(uint32_t *id, uint32_t *size);
 
+/**
+ *******************************************************************************
+ * @brief Get the transfer mode selected by spi_flash_init.
+ *
+ * @note QSPI instances switch to quad mode when SPI_FLASH_QUAD_ENABLE is set
+ *       and the QE bit of the flash could be set; SPIM stays single line.
+ *
+ * @retval Flash transfer mode.
+ *******************************************************************************
+ */
+spi_flash_mode_t spi_flash_mode_get(void);
+
+/**
+ *******************************************************************************
+ * @brief Get the device capabilities found by spi_flash_init.
+ *
+ * @note Without SFDP the capabilities describe a 4 KB sector erase,
+ *       SPI_FLASH_CMD_QIOFR and a 256 byte page, as used before SFDP support,
+ *       and the size given by the capacity byte of the JEDEC ID. Parts above
+ *       16 MB use 4-byte addresses where SFDP says how to enter that mode, and
+ *       are used up to 16 MB otherwise.
+ *
+ * @retval Pointer to the capabilities.
+ *******************************************************************************
+ */
+const spi_flash_caps_t *spi_flash_caps_get(void);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -178,6 +178,8 @@ __WEAK void app_assert_warn_cb(int param0, int param1, const char *file, int lin
 __WEAK void app_assert_param_cb(int param0, int param1, const char *file, int line)
 {
     __disable_irq();
+    /* Out with the log queued so far, so that the report comes last. */
+    app_log_flush();
 
     uint32_t file_name_len;
 
@@ -203,6 +205,8 @@ __WEAK void app_assert_param_cb(int param0, int param1, const char *file, int li
 __WEAK void app_assert_err_cb(const char *expr, const char *file, int line)
 {
     __disable_irq();
+    /* Out with the log queued so far, so that the report comes last. */
+    app_log_flush();
 
     uint32_t file_name_len;
     uint32_t expre_len;
@@ -40,6 +40,7 @@
  * INCLUDE FILES
  *****************************************************************************************
  */
+#include "app_log_store.h"
 #if APP_LOG_STORE_ENABLE
 #include "utility.h"
 
@@ -152,53 +153,93 @@ static bool log_store_time_stamp_encode(uint8_t *p_buffer, uint8_t buffer_size)
     }
 
     app_log_store_time_t rtc_time = {0};
+    char                 stamp[APP_LOG_STORE_TIME_SIZE + 1];   /* the stamp fills the buffer, plus NUL */
 
     s_log_store_ops.time_get(&rtc_time);
 
-    if (APP_LOG_STORE_TIME_SIZE == snprintf_s((char *)p_buffer, APP_LOG_STORE_TIME_SIZE, \
+    if (APP_LOG_STORE_TIME_SIZE != snprintf_s(stamp, sizeof(stamp), \
         APP_LOG_STORE_TIME_SIZE, \
         "[%04d/%02d/%02d %02d:%02d:%02d:%03d] ", \
         rtc_time.year, rtc_time.month, rtc_time.day, \
         rtc_time.hour, rtc_time.min, \
         rtc_time.sec, rtc_time.msec)) {
-        return true;
+        return false;
     }
+    memcpy_s(p_buffer, buffer_size, stamp, APP_LOG_STORE_TIME_SIZE);
 
-    return false;
+    return true;
 }
 
-static void log_store_data_flash_write(void)
+static uint32_t log_store_spans_write(uint32_t addr, hal_flash_iovec_t *p_iov)
 {
-    uint32_t align_num = 0;
-    uint32_t read_len;
-    uint8_t  read_buff[APP_LOG_STORE_ONECE_OP_SIZE];
+    uint32_t written;
+
+    if (s_log_store_ops.flash_writev) {
+        return s_log_store_ops.flash_writev(addr, p_iov, OFFSET_2);
+    }
+
+    written = s_log_store_ops.flash_write(addr, p_iov[OFFSET_0].p_base, p_iov[OFFSET_0].len);
+    if ((written == p_iov[OFFSET_0].len) && p_iov[OFFSET_1].len) {
+        if (s_log_store_ops.flash_write(addr + written, p_iov[OFFSET_1].p_base, p_iov[OFFSET_1].len) ==
+            p_iov[OFFSET_1].len) {
+            written += p_iov[OFFSET_1].len;
+        }
+    }
+
+    return written;
+}
+
+/* Cached logs are only dropped once they are in the flash; false if nothing could be written. */
+static bool log_store_data_flash_write(void)
+{
+    uint32_t          align_num = 0;
+    uint32_t          write_len;
+    uint32_t          written;
+    hal_flash_iovec_t iov[OFFSET_2];
+    uint8_t          *p_span[OFFSET_2];
+    uint32_t          span_len[OFFSET_2];
 
     if ((s_log_store_env.store_head.offset % s_log_store_env.blk_size) == 0) {
-        if (s_log_store_ops.flash_erase) {
-            s_log_store_ops.flash_erase(s_log_store_env.store_head.db_addr + s_log_store_env.store_head.offset,
-                                        s_log_store_env.blk_size);
+        if (!s_log_store_ops.flash_erase(s_log_store_env.store_head.db_addr + s_log_store_env.store_head.offset,
+                                         s_log_store_env.blk_size)) {
+            return false;
         }
     }
 
     align_num = ALIGN_NUM(APP_LOG_STORE_ONECE_OP_SIZE, s_log_store_env.store_head.offset);
     if (align_num != s_log_store_env.store_head.offset) {
-        read_len = ring_buffer_read(&s_log_store_rbuf, read_buff, align_num - s_log_store_env.store_head.offset);
+        write_len = align_num - s_log_store_env.store_head.offset;
     } else {
-        read_len = ring_buffer_read(&s_log_store_rbuf, read_buff, APP_LOG_STORE_ONECE_OP_SIZE);
+        write_len = APP_LOG_STORE_ONECE_OP_SIZE;
     }
 
-    if (s_log_store_ops.flash_write && read_len) {
-        s_log_store_ops.flash_write(s_log_store_env.store_head.db_addr + s_log_store_env.store_head.offset, read_buff,
-                                    read_len);
-        s_log_store_env.store_head.offset += read_len;
+    /* Program straight from the cache, both halves in one call when it has wrapped. */
+    ring_buffer_items_peek(&s_log_store_rbuf, p_span, span_len);
+    iov[OFFSET_0].p_base = p_span[OFFSET_0];
+    iov[OFFSET_0].len    = span_len[OFFSET_0] < write_len ? span_len[OFFSET_0] : write_len;
+    iov[OFFSET_1].p_base = p_span[OFFSET_1];
+    iov[OFFSET_1].len    = span_len[OFFSET_1] < (write_len - iov[OFFSET_0].len) ?
+                           span_len[OFFSET_1] : (write_len - iov[OFFSET_0].len);
+    write_len = iov[OFFSET_0].len + iov[OFFSET_1].len;
+    if (write_len == 0) {
+        return true;
     }
 
+    written = log_store_spans_write(s_log_store_env.store_head.db_addr + s_log_store_env.store_head.offset, iov);
+    if (written == 0) {
+        return false;
+    }
+    ring_buffer_items_drop(&s_log_store_rbuf, written);
+    s_log_store_env.store_head.offset += written;
+
     if (s_log_store_env.store_head.offset >= s_log_store_env.store_head.db_size) {
         s_log_store_env.store_head.offset    = 0;
         s_log_store_env.store_head.flip_over = 1;
     }
 
     log_store_head_update(s_log_store_env.head_nv_tag, &s_log_store_env.store_head);
+
+    return written == write_len;
 }
 
 static void log_store_to_flash(void)
@@ -211,9 +252,10 @@ static void log_store_to_flash(void)
     s_log_store_env.store_status |= APP_LOG_STORE_BUSY_BIT;
 #endif
 
-    log_store_data_flash_write();
-
-    s_log_store_env.store_status &= ~APP_LOG_STORE_SAVE_BIT;
+    /* Left pending on failure, the next schedule tries again. */
+    if (log_store_data_flash_write()) {
+        s_log_store_env.store_status &= ~APP_LOG_STORE_SAVE_BIT;
+    }
 #if (APP_LOG_STORE_RUN_ON_OS == 0)
     s_log_store_env.store_status &= ~APP_LOG_STORE_BUSY_BIT;
 #endif
@@ -337,7 +379,7 @@ uint16_t app_log_store_save(const uint8_t *p_data, const uint16_t length)
     ring_buffer_write(&s_log_store_rbuf, time_encode, APP_LOG_STORE_TIME_SIZE);
     ring_buffer_write(&s_log_store_rbuf, p_data, length);
 
-    if (ring_buffer_items_count_get(&s_log_store_rbuf >= APP_LOG_STORE_ONECE_OP_SIZE)) {
+    if (ring_buffer_items_count_get(&s_log_store_rbuf) >= APP_LOG_STORE_ONECE_OP_SIZE) {
         s_log_store_env.store_status |= APP_LOG_STORE_SAVE_BIT;
 #if APP_LOG_STORE_RUN_ON_OS
         log_store_to_flash();
@@ -360,8 +402,8 @@ void app_log_store_flush(void)
 
     do {
         items_count = ring_buffer_items_count_get(&s_log_store_rbuf);
-        if (items_count) {
-            log_store_data_flash_write();
+        if (items_count && !log_store_data_flash_write()) {
+            break;
         }
     } while (items_count >= APP_LOG_STORE_ONECE_OP_SIZE);
 }
@@ -42,6 +42,7 @@
 #if APP_LOG_STORE_ENABLE
 #include "gr55xx_sys.h"
 #include "ring_buffer.h"
+#include "hal_flash_ext.h"
 #include <string.h>
 #include <stdarg.h>
 #include <stdint.h>
@@ -79,13 +80,16 @@ typedef struct {
     uint16_t msec;              /**< Millisecond time element. */
 } app_log_store_time_t;
 
-/**@brief App log store operation functions. */
+/**@brief App log store operation functions. flash_writev is optional, flash_write is called once per
+ *        span of the log cache without it. */
 typedef struct {
     bool     (*flash_init)(void);                                                          /**< Flash init. */
     bool     (*flash_erase)(const uint32_t addr, const uint32_t size);                     /**< Flash erase. */
     uint32_t (*flash_read)(const uint32_t addr, uint8_t *buf, const uint32_t size);        /**< Flash read. */
     uint32_t (*flash_write)(const uint32_t addr, const uint8_t *buf, const uint32_t size); /**< Flash write. */
     void     (*time_get)(app_log_store_time_t *p_time);                                    /**< Get real time. */
+    uint32_t (*flash_writev)(const uint32_t addr, const hal_flash_iovec_t *iov,
+                             const uint32_t cnt);                                          /**< Vectored write, e.g. hal_flash_ext_writev. */
 } app_log_store_op_t;
 
 /**@brief App log store init stucture. */
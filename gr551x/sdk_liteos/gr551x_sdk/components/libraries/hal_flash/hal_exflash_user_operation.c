@@ -40,3 +40,143 @@ uint32_t hal_flash_read_identification_id(void)
     hal_exflash_operation(&g_exflash_handle, exflash_read_identification_id);
     return s_identification_id;
 }
+
+/*
+ * Sector and block erase (0x20/0x52/0xD8) that can be suspended. The exflash driver only erases
+ * sectors and keeps the handle until the erase is over, so nothing can read the flash meanwhile.
+ * Here the wait runs from RAM and polls *p_hold as well as the status register: as soon as it is
+ * set, the erase is suspended (0x75) and control goes back to the caller with the flash readable.
+ */
+#define FLASH_WIP_RETRY           2000000
+#define FLASH_SUSPEND_RETRY       1000      /* tSUS is 20-30 us on the supported parts */
+#define FLASH_XQSPI_RETRY         1000
+#define FLASH_ADDR_BYTE2_POS      16
+#define FLASH_ADDR_BYTE1_POS      8
+
+static uint8_t  s_erase_cmd;
+static uint32_t s_erase_addr;
+static volatile const uint32_t *s_p_erase_hold;
+static uint32_t s_erase_result;
+
+static SECTION_RAM_CODE hal_status_t exflash_wip_wait(exflash_handle_t *p_exflash, uint32_t retry)
+{
+    hal_status_t status;
+    xqspi_command_t command;
+    uint8_t sr = SPI_FLASH_SR_WIP;
+
+    command.inst = SPI_FLASH_CMD_RDSR;
+    command.addr = 0;
+    command.inst_size = XQSPI_INSTSIZE_08_BITS;
+    command.addr_size = XQSPI_ADDRSIZE_00_BITS;
+    command.dummy_cycles = 0;
+    command.inst_addr_mode = XQSPI_INST_ADDR_ALL_IN_SPI;
+    command.data_mode = XQSPI_DATA_MODE_SPI;
+    command.length = 1;
+
+    while (retry--) {
+        if ((s_p_erase_hold != NULL) && (*s_p_erase_hold != 0)) {
+            s_erase_result = HAL_FLASH_ERASE_SUSPENDED;
+            return HAL_OK;
+        }
+        status = hal_xqspi_command_receive_patch(p_exflash->p_xqspi, &command, &sr, FLASH_XQSPI_RETRY);
+        if (HAL_OK != status) {
+            return status;
+        }
+        if ((sr & SPI_FLASH_SR_WIP) == 0) {
+            s_erase_result = HAL_FLASH_ERASE_DONE;
+            return HAL_OK;
+        }
+    }
+
+    return HAL_TIMEOUT;
+}
+
+/* Wait for the erase in flight, or suspend it once a hold is raised. */
+static SECTION_RAM_CODE hal_status_t exflash_erase_wait(exflash_handle_t *p_exflash)
+{
+    hal_status_t status;
+    uint8_t pes = SPI_FLASH_CMD_PES;
+
+    status = exflash_wip_wait(p_exflash, FLASH_WIP_RETRY);
+    if ((HAL_OK != status) || (s_erase_result != HAL_FLASH_ERASE_SUSPENDED)) {
+        return status;
+    }
+
+    /*
+     * An erase that ended just before ignores the suspend and reads as suspended too; the resume
+     * is then ignored as well and the next wait finds it done.
+     */
+    status = hal_xqspi_transmit(p_exflash->p_xqspi, &pes, sizeof(pes), FLASH_XQSPI_RETRY);
+    if (HAL_OK != status) {
+        return status;
+    }
+    s_p_erase_hold = NULL;
+    status = exflash_wip_wait(p_exflash, FLASH_SUSPEND_RETRY);
+    s_erase_result = HAL_FLASH_ERASE_SUSPENDED;
+
+    return status;
+}
+
+static SECTION_RAM_CODE hal_status_t exflash_erase_start(exflash_handle_t *p_exflash)
+{
+    hal_status_t status;
+    uint8_t wren = SPI_FLASH_CMD_WREN;
+    uint8_t cmd[4];
+
+    cmd[0] = s_erase_cmd;
+    cmd[1] = (uint8_t)(s_erase_addr >> FLASH_ADDR_BYTE2_POS);
+    cmd[2] = (uint8_t)(s_erase_addr >> FLASH_ADDR_BYTE1_POS);
+    cmd[3] = (uint8_t)s_erase_addr;
+
+    status = hal_xqspi_transmit(p_exflash->p_xqspi, &wren, sizeof(wren), FLASH_XQSPI_RETRY);
+    if (HAL_OK != status) {
+        return status;
+    }
+    status = hal_xqspi_transmit(p_exflash->p_xqspi, cmd, sizeof(cmd), FLASH_XQSPI_RETRY);
+    if (HAL_OK != status) {
+        return status;
+    }
+
+    return exflash_erase_wait(p_exflash);
+}
+
+static SECTION_RAM_CODE hal_status_t exflash_erase_resume(exflash_handle_t *p_exflash)
+{
+    hal_status_t status;
+    uint8_t per = SPI_FLASH_CMD_PER;
+
+    status = hal_xqspi_transmit(p_exflash->p_xqspi, &per, sizeof(per), FLASH_XQSPI_RETRY);
+    if (HAL_OK != status) {
+        return status;
+    }
+
+    return exflash_erase_wait(p_exflash);
+}
+
+static uint32_t hal_flash_erase_op(exflash_operation_func p_func, volatile const uint32_t *p_hold)
+{
+    s_p_erase_hold = p_hold;
+    s_erase_result = HAL_FLASH_ERASE_FAILED;
+    if (HAL_OK != hal_exflash_operation(&g_exflash_handle, p_func)) {
+        return HAL_FLASH_ERASE_FAILED;
+    }
+
+    return s_erase_result;
+}
+
+uint32_t hal_flash_erase_run(uint8_t cmd, uint32_t addr, volatile const uint32_t *p_hold)
+{
+    s_erase_cmd  = cmd;
+    s_erase_addr = addr - EXFLASH_START_ADDR;
+    return hal_flash_erase_op(exflash_erase_start, p_hold);
+}
+
+uint32_t hal_flash_erase_continue(volatile const uint32_t *p_hold)
+{
+    return hal_flash_erase_op(exflash_erase_resume, p_hold);
+}
+
+hal_status_t hal_flash_block_erase(uint8_t cmd, uint32_t addr)
+{
+    return (hal_flash_erase_run(cmd, addr, NULL) == HAL_FLASH_ERASE_DONE) ? HAL_OK : HAL_ERROR;
+}
@@ -34,10 +34,25 @@
 #define SPI_FLASH_CMD_DP                0xB9
 #define SPI_FLASH_CMD_RDP               0xAB
 
+#define SPI_FLASH_SR_WIP                0x01
+
+#define HAL_FLASH_ERASE_DONE            0       /* the erase is over */
+#define HAL_FLASH_ERASE_SUSPENDED       1       /* suspended on a hold, continue with hal_flash_erase_continue */
+#define HAL_FLASH_ERASE_FAILED          2
+
 extern exflash_handle_t g_exflash_handle;
 extern hal_status_t hal_xqspi_command_receive_patch(xqspi_handle_t *p_xqspi, xqspi_command_t *p_cmd, \
                                                     uint8_t *p_data, uint32_t retry);
 
 uint32_t hal_flash_read_identification_id(void);
+/*
+ * Erase the sector or block at addr with cmd (SPI_FLASH_CMD_SE/BE_32/BE_64). When p_hold is not NULL
+ * and *p_hold becomes nonzero before the end, the erase is suspended and HAL_FLASH_ERASE_SUSPENDED
+ * returned: the flash can be read, except the unit being erased, until hal_flash_erase_continue.
+ */
+uint32_t hal_flash_erase_run(uint8_t cmd, uint32_t addr, volatile const uint32_t *p_hold);
+uint32_t hal_flash_erase_continue(volatile const uint32_t *p_hold);
+/* hal_flash_erase_run without suspend, for callers that cannot be held off. */
+hal_status_t hal_flash_block_erase(uint8_t cmd, uint32_t addr);
 
 #endif /* __HAL_EXFLASH_USER_OPERATION_H_ */
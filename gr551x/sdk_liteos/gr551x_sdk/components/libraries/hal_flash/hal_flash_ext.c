@@ -0,0 +1,751 @@
+/**
+  ******************************************************************************
+  * @file    hal_flash_ext.c
+  * @author  Engineering Team
+  * @brief   Implementation of the HAL flash extensions.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright(C) 2016-2017, Shenzhen Huiding Technology Co., Ltd
+  * All Rights Reserved
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted, provided that the following conditions are met:
+  *
+  * 1. Redistribution of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  * 3. Neither the name of Goodix Technology nor the names of other
+  *    contributors to this software may be used to endorse or promote products
+  *    derived from this software without specific written permission.
+  * 4. This software, including modifications and/or derivative works of this
+  *    software, must execute solely and exclusively on microcontroller or
+  *    microprocessor devices manufactured by or for Goodix Technology.
+  * 5. Redistribution and use of this software other than as permitted under
+  *    this license is void and will automatically terminate your rights under
+  *    this license.
+  *
+  * THIS SOFTWARE IS PROVIDED BY Goodix Technology AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS, IMPLIED OR STATUTORY WARRANTIES, INCLUDING, BUT NOT
+  * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+  * PARTICULAR PURPOSE AND NON-INFRINGEMENT OF THIRD PARTY INTELLECTUAL PROPERTY
+  * RIGHTS ARE DISCLAIMED TO THE FULLEST EXTENT PERMITTED BY LAW. IN NO EVENT
+  * SHALL Goodix Technology OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "gr55xx_hal.h"
+#include "hal_flash_ext.h"
+#include "hal_exflash_user_operation.h"
+
+#if (HAL_FLASH_STATS_ENABLE == 1)
+
+#define CYCLES_PER_US           (SystemCoreClock / 1000000)
+#define HAL_FLASH_STATS_MAGIC   0x53544653      /* "FSTS" */
+
+typedef struct {
+    uint32_t          magic;
+    uint32_t          size;         /* a different layout from another firmware is not taken over */
+    hal_flash_stats_t stats;
+} hal_flash_stats_block_t;
+
+/* Not cleared by the startup code, see hal_flash_ext.h. */
+static hal_flash_stats_block_t s_flash_stats __attribute__((section(".noinit")));
+
+uint32_t hal_flash_stats_timestamp(void)
+{
+    return DWT->CYCCNT;
+}
+
+void hal_flash_stats_update(hal_flash_op_stats_t *p_op, uint32_t start, uint32_t bytes, bool ok)
+{
+    uint32_t elapsed_us = (DWT->CYCCNT - start) / CYCLES_PER_US;
+    uint32_t bin = 0;
+
+    while ((bin < HAL_FLASH_STATS_HIST_BINS - 1) && ((elapsed_us >> (bin + 1)) != 0)) {
+        bin++;
+    }
+
+    GLOBAL_EXCEPTION_DISABLE();
+    if (p_op->count == 0 || elapsed_us < p_op->min_us) {
+        p_op->min_us = elapsed_us;
+    }
+    if (elapsed_us > p_op->max_us) {
+        p_op->max_us = elapsed_us;
+    }
+    p_op->count++;
+    p_op->errors += ok ? 0 : 1;
+    p_op->bytes += bytes;
+    p_op->total_us += elapsed_us;
+    p_op->hist[bin]++;
+    GLOBAL_EXCEPTION_ENABLE();
+}
+
+void hal_flash_stats_get(hal_flash_stats_t *p_stats)
+{
+    if (p_stats == NULL) {
+        return;
+    }
+
+    GLOBAL_EXCEPTION_DISABLE();
+    memcpy(p_stats, &s_flash_stats.stats, sizeof(s_flash_stats.stats));
+    GLOBAL_EXCEPTION_ENABLE();
+}
+
+void hal_flash_stats_reset(void)
+{
+    GLOBAL_EXCEPTION_DISABLE();
+    memset(&s_flash_stats.stats, 0, sizeof(s_flash_stats.stats));
+    s_flash_stats.stats.boots = 1;
+    s_flash_stats.size  = sizeof(s_flash_stats.stats);
+    s_flash_stats.magic = HAL_FLASH_STATS_MAGIC;
+    GLOBAL_EXCEPTION_ENABLE();
+}
+
+static void hal_flash_stats_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    if ((s_flash_stats.magic == HAL_FLASH_STATS_MAGIC) && (s_flash_stats.size == sizeof(s_flash_stats.stats))) {
+        s_flash_stats.stats.boots++;
+    } else {
+        hal_flash_stats_reset();
+    }
+}
+
+/* An erase suspended at suspended, raised is when the first hold came. */
+static void hal_flash_stats_suspend(uint32_t raised, uint32_t suspended)
+{
+    uint32_t elapsed_us = (suspended - raised) / CYCLES_PER_US;
+
+    GLOBAL_EXCEPTION_DISABLE();
+    s_flash_stats.stats.suspends++;
+    if (elapsed_us > s_flash_stats.stats.suspend_max_us) {
+        s_flash_stats.stats.suspend_max_us = elapsed_us;
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+}
+
+/* A suspended erase resumed at resumed, released is when the last hold went. */
+static void hal_flash_stats_resume(uint32_t released, uint32_t resumed)
+{
+    uint32_t elapsed_us = (resumed - released) / CYCLES_PER_US;
+
+    GLOBAL_EXCEPTION_DISABLE();
+    if (elapsed_us > s_flash_stats.stats.resume_max_us) {
+        s_flash_stats.stats.resume_max_us = elapsed_us;
+    }
+    s_flash_stats.stats.resume_total_us += elapsed_us;
+    GLOBAL_EXCEPTION_ENABLE();
+}
+
+#define HAL_FLASH_STATS_BEGIN()                 uint32_t stats_start = hal_flash_stats_timestamp()
+#define HAL_FLASH_STATS_END(op_type, bytes, ok) \
+    hal_flash_stats_update(&s_flash_stats.stats.op[op_type], stats_start, (ok) ? (bytes) : 0, (ok))
+#define HAL_FLASH_STATS_COUNT(field)            (s_flash_stats.stats.field++)
+#define HAL_FLASH_STATS_SUSPEND(raised)         hal_flash_stats_suspend((raised), hal_flash_stats_timestamp())
+#define HAL_FLASH_STATS_RESUME(released)        hal_flash_stats_resume((released), hal_flash_stats_timestamp())
+#define HAL_FLASH_STATS_MARK(stamp)             ((stamp) = DWT->CYCCNT)      /* from RAM code too */
+#else
+#define HAL_FLASH_STATS_BEGIN()
+#define HAL_FLASH_STATS_END(op_type, bytes, ok)
+#define HAL_FLASH_STATS_COUNT(field)
+#define HAL_FLASH_STATS_SUSPEND(raised)
+#define HAL_FLASH_STATS_RESUME(released)
+#define HAL_FLASH_STATS_MARK(stamp)
+#endif
+
+#if (HAL_FLASH_READ_CACHE_SETS > 0)
+
+#define HAL_FLASH_CACHE_LINE        HAL_FLASH_READ_CACHE_LINE
+#define HAL_FLASH_CACHE_VALID       0x1     /* tags are line aligned, bit 0 marks a valid line */
+
+typedef struct {
+    uint32_t tag;
+    uint32_t lru;
+    uint8_t  data[HAL_FLASH_CACHE_LINE];
+} hal_flash_cache_line_t;
+
+static hal_flash_cache_line_t s_cache[HAL_FLASH_READ_CACHE_SETS][HAL_FLASH_READ_CACHE_WAYS];
+static uint32_t               s_cache_tick;
+static volatile uint32_t      s_cache_gen;      /* bumped by every invalidation, see hal_flash_cache_fill */
+
+static hal_flash_cache_line_t *hal_flash_cache_set(uint32_t page)
+{
+    return s_cache[(page / HAL_FLASH_CACHE_LINE) % HAL_FLASH_READ_CACHE_SETS];
+}
+
+static bool hal_flash_cache_lookup(uint32_t page, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    hal_flash_cache_line_t *p_set = hal_flash_cache_set(page);
+    bool hit = false;
+
+    GLOBAL_EXCEPTION_DISABLE();
+    for (uint32_t way = 0; way < HAL_FLASH_READ_CACHE_WAYS; way++) {
+        if (p_set[way].tag == (page | HAL_FLASH_CACHE_VALID)) {
+            memcpy(buf, &p_set[way].data[offset], len);
+            p_set[way].lru = ++s_cache_tick;
+            hit = true;
+            break;
+        }
+    }
+    if (hit) {
+        HAL_FLASH_STATS_COUNT(cache_hits);
+    } else {
+        HAL_FLASH_STATS_COUNT(cache_misses);
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+
+    return hit;
+}
+
+/* Pages are read outside the lock. An invalidation in the meantime changes gen, and the page is then dropped. */
+static void hal_flash_cache_fill(uint32_t page, const uint8_t *data, uint32_t gen)
+{
+    hal_flash_cache_line_t *p_set = hal_flash_cache_set(page);
+    hal_flash_cache_line_t *p_victim = &p_set[0];
+
+    GLOBAL_EXCEPTION_DISABLE();
+    if (gen == s_cache_gen) {
+        for (uint32_t way = 1; way < HAL_FLASH_READ_CACHE_WAYS; way++) {
+            if ((p_victim->tag & HAL_FLASH_CACHE_VALID) == 0) {
+                break;
+            }
+            if (((p_set[way].tag & HAL_FLASH_CACHE_VALID) == 0) || (p_set[way].lru < p_victim->lru)) {
+                p_victim = &p_set[way];
+            }
+        }
+        memcpy(p_victim->data, data, HAL_FLASH_CACHE_LINE);
+        p_victim->tag = page | HAL_FLASH_CACHE_VALID;
+        p_victim->lru = ++s_cache_tick;
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+}
+
+static bool hal_flash_cache_read(uint32_t addr, uint8_t *buf, uint32_t size)
+{
+    uint8_t line[HAL_FLASH_CACHE_LINE];
+
+    if (size >= HAL_FLASH_CACHE_LINE) {
+        return (hal_flash_read(addr, buf, size) == size);
+    }
+
+    /* A small read touches one line, or two if it crosses a boundary. */
+    while (size > 0) {
+        uint32_t page   = addr & ~(HAL_FLASH_CACHE_LINE - 1);
+        uint32_t offset = addr - page;
+        uint32_t len    = HAL_FLASH_CACHE_LINE - offset;
+        if (len > size) {
+            len = size;
+        }
+
+        if (!hal_flash_cache_lookup(page, offset, buf, len)) {
+            uint32_t gen = s_cache_gen;
+            if (hal_flash_read(page, line, HAL_FLASH_CACHE_LINE) != HAL_FLASH_CACHE_LINE) {
+                return false;
+            }
+            hal_flash_cache_fill(page, line, gen);
+            memcpy(buf, &line[offset], len);
+        }
+        addr += len;
+        buf  += len;
+        size -= len;
+    }
+
+    return true;
+}
+#endif
+
+void hal_flash_ext_cache_invalidate(const uint32_t addr, const uint32_t size)
+{
+#if (HAL_FLASH_READ_CACHE_SETS > 0)
+    GLOBAL_EXCEPTION_DISABLE();
+    s_cache_gen++;
+    for (uint32_t set = 0; set < HAL_FLASH_READ_CACHE_SETS; set++) {
+        for (uint32_t way = 0; way < HAL_FLASH_READ_CACHE_WAYS; way++) {
+            uint32_t page = s_cache[set][way].tag & ~HAL_FLASH_CACHE_VALID;
+            if ((size == 0) || ((page < addr + size) && (addr < page + HAL_FLASH_CACHE_LINE))) {
+                s_cache[set][way].tag = 0;
+            }
+        }
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+#endif
+}
+
+#define HAL_FLASH_MANU_ID_MASK      0xFF    /* low byte of flash_id is the JEDEC manufacturer ID */
+#define HAL_FLASH_BLOCK32_BYTES     0x8000
+#define HAL_FLASH_BLOCK64_BYTES     0x10000
+
+/* Typical and maximum erase times in ms, from the datasheets. */
+#define HAL_FLASH_ERASE_TYPES(se_typ, se_max, be32_typ, be32_max, be64_typ, be64_max)   {   \
+        3, {                                                                                \
+            { EXFLASH_SIZE_SECTOR_BYTES, SPI_FLASH_CMD_SE,    (se_typ),   (se_max)   },     \
+            { HAL_FLASH_BLOCK32_BYTES,   SPI_FLASH_CMD_BE_32, (be32_typ), (be32_max) },     \
+            { HAL_FLASH_BLOCK64_BYTES,   SPI_FLASH_CMD_BE_64, (be64_typ), (be64_max) },     \
+        }                                                                                   \
+    }
+
+typedef struct {
+    uint8_t                    manufacturer;
+    hal_flash_erase_geometry_t geo;
+} hal_flash_erase_part_t;
+
+static const hal_flash_erase_part_t s_erase_parts[] = {
+    { 0xC8, HAL_FLASH_ERASE_TYPES(50, 400, 160, 800, 250, 1200) },      /* GigaDevice GD25Q/WQ */
+    { 0xEF, HAL_FLASH_ERASE_TYPES(45, 400, 120, 1600, 150, 2000) },     /* Winbond W25Q */
+};
+
+/* Parts not in the table are only sector erased. */
+#define HAL_FLASH_ERASE_SECTORS     { 1, { { EXFLASH_SIZE_SECTOR_BYTES, SPI_FLASH_CMD_SE, 50, 400 } } }
+
+static const hal_flash_erase_geometry_t s_erase_sectors = HAL_FLASH_ERASE_SECTORS;
+static hal_flash_erase_geometry_t       s_erase_geo     = HAL_FLASH_ERASE_SECTORS;
+
+static void hal_flash_erase_geometry_select(uint32_t flash_id)
+{
+    for (uint32_t i = 0; i < sizeof(s_erase_parts) / sizeof(s_erase_parts[0]); i++) {
+        if (s_erase_parts[i].manufacturer == (flash_id & HAL_FLASH_MANU_ID_MASK)) {
+            s_erase_geo = s_erase_parts[i].geo;
+            return;
+        }
+    }
+    s_erase_geo = s_erase_sectors;
+}
+
+const hal_flash_erase_geometry_t *hal_flash_ext_erase_geometry(void)
+{
+    return &s_erase_geo;
+}
+
+uint32_t hal_flash_ext_erase_step(const hal_flash_erase_geometry_t *p_geo, uint32_t addr, uint32_t end)
+{
+    uint32_t idx = p_geo->count;
+
+    if (idx <= 1) {
+        return 0;
+    }
+    while (--idx > 0) {
+        uint32_t size = p_geo->types[idx].size;
+        if ((size <= HAL_FLASH_ERASE_BLOCK_MAX) && ((addr & (size - 1)) == 0) && (end - addr >= size)) {
+            break;
+        }
+    }
+
+    return idx;
+}
+
+uint32_t hal_flash_ext_erase_time(const uint32_t addr, const uint32_t size)
+{
+    uint32_t cur = addr & ~(EXFLASH_SIZE_SECTOR_BYTES - 1);
+    uint32_t end = (addr + size + EXFLASH_SIZE_SECTOR_BYTES - 1) & ~(EXFLASH_SIZE_SECTOR_BYTES - 1);
+    uint32_t ms  = 0;
+
+    while (cur < end) {
+        const hal_flash_erase_type_t *p_type = &s_erase_geo.types[hal_flash_ext_erase_step(&s_erase_geo, cur, end)];
+        ms  += p_type->typ_ms;
+        cur += p_type->size;
+    }
+
+    return ms;
+}
+
+/* hal_flash_ext_suspend nesting, read by the erase wait loop in RAM. */
+static volatile uint32_t             s_flash_hold;
+static volatile hal_flash_ext_state_t s_flash_state = HAL_FLASH_EXT_IDLE;
+#if (HAL_FLASH_STATS_ENABLE == 1)
+/* Cycle counts when the first hold was raised and the last one released. */
+static volatile uint32_t             s_flash_hold_raised;
+static volatile uint32_t             s_flash_hold_released;
+#endif
+
+void hal_flash_ext_init(void)
+{
+    uint32_t id;
+    uint32_t size;
+
+    hal_flash_get_info(&id, &size);
+    hal_flash_erase_geometry_select(id);
+#if (HAL_FLASH_STATS_ENABLE == 1)
+    hal_flash_stats_init();
+#endif
+}
+
+uint32_t hal_flash_ext_read(const uint32_t addr, uint8_t *buf, const uint32_t size)
+{
+    HAL_FLASH_STATS_BEGIN();
+#if (HAL_FLASH_READ_CACHE_SETS > 0)
+    uint32_t ret = ((buf != NULL) && hal_flash_cache_read(addr, buf, size)) ? size : 0;
+#else
+    uint32_t ret = hal_flash_read(addr, buf, size);
+#endif
+    HAL_FLASH_STATS_END(HAL_FLASH_OP_READ, size, ret == size);
+
+    return ret;
+}
+
+__WEAK void hal_flash_ext_hold_wait(void)
+{
+}
+
+/* No erase or program starts while a hold is raised. */
+static void hal_flash_ext_hold_off(void)
+{
+    while (s_flash_hold != 0) {
+        hal_flash_ext_hold_wait();
+    }
+}
+
+/* Programs are not suspended: one page takes below 1 ms, so they are started one page at a time instead. */
+static uint32_t hal_flash_ext_program(const uint32_t addr, const uint8_t *buf, const uint32_t size)
+{
+    uint32_t done = 0;
+
+    while (done < size) {
+        uint32_t len = EXFLASH_SIZE_PAGE_BYTES - ((addr + done) & (EXFLASH_SIZE_PAGE_BYTES - 1));
+        if (len > size - done) {
+            len = size - done;
+        }
+        hal_flash_ext_hold_off();
+        s_flash_state = HAL_FLASH_EXT_BUSY;
+        uint32_t ret = hal_flash_write(addr + done, buf + done, len);
+        s_flash_state = HAL_FLASH_EXT_IDLE;
+        hal_flash_ext_cache_invalidate(addr + done, len);
+        if (ret != len) {
+            break;
+        }
+        done += len;
+    }
+
+    return done;
+}
+
+uint32_t hal_flash_ext_write(const uint32_t addr, const uint8_t *buf, const uint32_t size)
+{
+    HAL_FLASH_STATS_BEGIN();
+    uint32_t ret = (buf != NULL) ? hal_flash_ext_program(addr, buf, size) : 0;
+    ret = (ret == size) ? size : 0;
+    HAL_FLASH_STATS_END(HAL_FLASH_OP_WRITE, size, ret == size);
+
+    return ret;
+}
+
+uint32_t hal_flash_ext_writev(const uint32_t addr, const hal_flash_iovec_t *iov, const uint32_t cnt)
+{
+    uint8_t  page[EXFLASH_SIZE_PAGE_BYTES];
+    uint32_t fill  = 0;         /* bytes staged in page, destined for [cur, cur + fill) */
+    uint32_t cur   = addr;
+    uint32_t total = 0;
+    bool     ok    = (iov != NULL);
+
+    HAL_FLASH_STATS_BEGIN();
+    for (uint32_t i = 0; ok && (i < cnt); i++) {
+        const uint8_t *p_data = (const uint8_t *)iov[i].p_base;
+        uint32_t left = iov[i].len;
+
+        total += left;
+        while (ok && (left > 0)) {
+            uint32_t room = EXFLASH_SIZE_PAGE_BYTES - ((cur + fill) & (EXFLASH_SIZE_PAGE_BYTES - 1));
+            uint32_t len;
+
+            if ((fill == 0) && (left >= room)) {
+                /* Runs that reach the end of a page are programmed in place, whole pages included. */
+                len = room + ((left - room) & ~(EXFLASH_SIZE_PAGE_BYTES - 1));
+                uint32_t done = hal_flash_ext_program(cur, p_data, len);
+                ok = (done == len);
+                cur += done;
+            } else {
+                len = (left < room) ? left : room;
+                memcpy(&page[fill], p_data, len);
+                fill += len;
+                if (len == room) {
+                    uint32_t done = hal_flash_ext_program(cur, page, fill);
+                    ok = (done == fill);
+                    cur += done;
+                    fill = 0;
+                }
+            }
+            p_data += len;
+            left   -= len;
+        }
+    }
+    if (ok && (fill > 0)) {
+        uint32_t done = hal_flash_ext_program(cur, page, fill);
+        ok = (done == fill);
+        cur += done;
+    }
+    HAL_FLASH_STATS_END(HAL_FLASH_OP_WRITE, cur - addr, ok && (cur - addr == total));
+
+    return cur - addr;
+}
+
+uint32_t hal_flash_ext_readv(const uint32_t addr, const hal_flash_iovec_t *iov, const uint32_t cnt)
+{
+    uint32_t cur = addr;
+
+    for (uint32_t i = 0; (iov != NULL) && (i < cnt); i++) {
+        if ((iov[i].len != 0) && (hal_flash_ext_read(cur, (uint8_t *)iov[i].p_base, iov[i].len) != iov[i].len)) {
+            break;
+        }
+        cur += iov[i].len;
+    }
+
+    return cur - addr;
+}
+
+#define HAL_FLASH_CRC32_INIT        0xFFFFFFFF
+#define HAL_FLASH_CRC32_NIBBLE      4
+
+/* Reflected CRC32 (0xEDB88320), a nibble at a time to keep the table at 64 bytes. */
+static uint32_t hal_flash_crc32_update(uint32_t crc, const uint8_t *p_data, uint32_t size)
+{
+    static const uint32_t s_crc32_nibble[] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+
+    while (size--) {
+        crc ^= *p_data++;
+        crc = (crc >> HAL_FLASH_CRC32_NIBBLE) ^ s_crc32_nibble[crc & 0xF];
+        crc = (crc >> HAL_FLASH_CRC32_NIBBLE) ^ s_crc32_nibble[crc & 0xF];
+    }
+
+    return crc;
+}
+
+/* CRC32 of a flash range read over QSPI, which decrypts. false if the range cannot be read. */
+static bool hal_flash_crc32_range(uint32_t addr, uint32_t size, uint32_t *p_crc)
+{
+    uint8_t  buf[EXFLASH_SIZE_PAGE_BYTES];
+    uint32_t crc = HAL_FLASH_CRC32_INIT;
+    uint32_t offset = 0;
+
+    while (offset < size) {
+        uint32_t len = (size - offset > sizeof(buf)) ? sizeof(buf) : (size - offset);
+        if (hal_flash_read(addr + offset, buf, len) != len) {
+            return false;
+        }
+        crc = hal_flash_crc32_update(crc, buf, len);
+        offset += len;
+    }
+    *p_crc = ~crc;
+
+    return true;
+}
+
+uint32_t hal_flash_ext_crc32(const uint32_t addr, const uint32_t size)
+{
+    uint32_t crc = 0;
+
+    HAL_FLASH_STATS_BEGIN();
+    bool ok = hal_flash_crc32_range(addr, size, &crc);
+    HAL_FLASH_STATS_END(HAL_FLASH_OP_READ, size, ok);
+
+    return ok ? crc : 0;
+}
+
+#if (HAL_FLASH_VERIFY_MODE == HAL_FLASH_VERIFY_SHA256)
+
+#define HAL_FLASH_SHA256_WORDS      8
+#define HAL_FLASH_SHA256_RETRY      1000000
+
+static hmac_handle_t s_verify_hmac;
+
+/*
+ * Digest by DMA with the completion polled, so the HMAC vector stays the application's: the
+ * interrupt is masked meanwhile and its enable state restored on every path. false if another driver
+ * has the engine enabled, or the digest fails.
+ */
+static bool hal_flash_sha256(const void *p_data, uint32_t size, uint32_t *p_digest)
+{
+    uint32_t retry = HAL_FLASH_SHA256_RETRY;
+    uint32_t irq_enabled;
+    hal_status_t status = HAL_BUSY;
+    bool ok;
+
+    if (ll_hmac_is_enabled(HMAC)) {
+        return false;
+    }
+    if (hal_hmac_get_state(&s_verify_hmac) == HAL_HMAC_STATE_RESET) {
+        s_verify_hmac.p_instance          = HMAC;
+        s_verify_hmac.init.mode           = HMAC_MODE_SHA;
+        s_verify_hmac.init.p_key          = NULL;
+        s_verify_hmac.init.p_user_hash    = NULL;
+        s_verify_hmac.init.key_fetch_type = HAL_HMAC_KEYTYPE_MCU;
+        s_verify_hmac.init.dpa_mode       = DISABLE;
+        if (HAL_OK != hal_hmac_init(&s_verify_hmac)) {
+            return false;
+        }
+    }
+
+    irq_enabled = NVIC_GetEnableIRQ(HMAC_IRQn);
+    NVIC_DisableIRQ(HMAC_IRQn);
+    /* Checked again with the start, so no other driver gets in between. */
+    GLOBAL_EXCEPTION_DISABLE();
+    if (!ll_hmac_is_enabled(HMAC)) {
+        status = hal_hmac_sha256_digest_dma(&s_verify_hmac, (uint32_t *)p_data, size, p_digest);
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+    while ((status == HAL_OK) && (hal_hmac_get_state(&s_verify_hmac) == HAL_HMAC_STATE_BUSY) && (retry-- > 0)) {
+        if (NVIC_GetPendingIRQ(HMAC_IRQn)) {
+            NVIC_ClearPendingIRQ(HMAC_IRQn);
+            hal_hmac_irq_handler(&s_verify_hmac);
+        }
+    }
+    ok = (status == HAL_OK) && (hal_hmac_get_state(&s_verify_hmac) == HAL_HMAC_STATE_READY);
+    if (!ok && (status != HAL_BUSY)) {
+        /* Stops what was started, leaves the engine to the next user and drops our interrupt. */
+        hal_hmac_deinit(&s_verify_hmac);
+        NVIC_ClearPendingIRQ(HMAC_IRQn);
+    }
+    if (irq_enabled) {
+        NVIC_EnableIRQ(HMAC_IRQn);
+    }
+
+    return ok;
+}
+#endif
+
+/* 1 if the flash holds buf, 0 if not, -1 if the mode cannot tell and the range must be read back. */
+static int hal_flash_ext_verify_digest(uint32_t addr, const uint8_t *buf, uint32_t size)
+{
+#if (HAL_FLASH_VERIFY_MODE == HAL_FLASH_VERIFY_SHA256)
+    uint32_t digest_data[HAL_FLASH_SHA256_WORDS];
+    uint32_t digest_flash[HAL_FLASH_SHA256_WORDS];
+
+    /* The XIP window only shows plain text unencrypted, and the HMAC DMA moves words. */
+    if (hal_flash_get_security() || (((addr | (uint32_t)buf) & 0x3) != 0)) {
+        return -1;
+    }
+    /* XIP may have cached the old content. */
+    ll_xqspi_enable_cache_flush(XQSPI);
+    ll_xqspi_disable_cache_flush(XQSPI);
+    if (!hal_flash_sha256(buf, size, digest_data) || !hal_flash_sha256((const void *)addr, size, digest_flash)) {
+        return -1;
+    }
+    return (memcmp(digest_data, digest_flash, sizeof(digest_data)) == 0) ? 1 : 0;
+#elif (HAL_FLASH_VERIFY_MODE == HAL_FLASH_VERIFY_CRC32)
+    uint32_t crc;
+
+    if (!hal_flash_crc32_range(addr, size, &crc)) {
+        return 0;
+    }
+    return (~hal_flash_crc32_update(HAL_FLASH_CRC32_INIT, buf, size) == crc) ? 1 : 0;
+#else
+    return -1;
+#endif
+}
+
+static bool hal_flash_ext_read_back(uint32_t addr, const uint8_t *buf, uint32_t size)
+{
+    uint8_t  rd_buf[EXFLASH_SIZE_PAGE_BYTES];
+    uint32_t offset = 0;
+
+    while (offset < size) {
+        uint32_t len = (size - offset > sizeof(rd_buf)) ? sizeof(rd_buf) : (size - offset);
+        if ((hal_flash_read(addr + offset, rd_buf, len) != len) || (memcmp(buf + offset, rd_buf, len) != 0)) {
+            return false;
+        }
+        offset += len;
+    }
+
+    return true;
+}
+
+uint32_t hal_flash_ext_write_r(const uint32_t addr, const uint8_t *buf, const uint32_t size)
+{
+    HAL_FLASH_STATS_BEGIN();
+    bool ok = (buf != NULL) && (size != 0) && (hal_flash_ext_program(addr, buf, size) == size);
+    if (ok) {
+        /* It's possible that the data is not written to flash memory, so check it. */
+        int match = hal_flash_ext_verify_digest(addr, buf, size);
+        ok = (match < 0) ? hal_flash_ext_read_back(addr, buf, size) : (match == 1);
+    }
+    HAL_FLASH_STATS_END(HAL_FLASH_OP_WRITE_R, size, ok);
+
+    return ok ? size : 0;
+}
+
+static bool hal_flash_ext_erase_unit(uint8_t cmd, uint32_t addr, uint32_t size)
+{
+    uint32_t ret;
+
+    hal_flash_ext_hold_off();
+    /* Nothing cached of the unit is served while it is suspended, nor filled from it meanwhile. */
+    hal_flash_ext_cache_invalidate(addr, size);
+    s_flash_state = HAL_FLASH_EXT_BUSY;
+    ret = hal_flash_erase_run(cmd, addr, &s_flash_hold);
+    while (ret == HAL_FLASH_ERASE_SUSPENDED) {
+        s_flash_state = HAL_FLASH_EXT_SUSPENDED;
+        HAL_FLASH_STATS_SUSPEND(s_flash_hold_raised);
+        hal_flash_ext_hold_off();
+        HAL_FLASH_STATS_RESUME(s_flash_hold_released);
+        s_flash_state = HAL_FLASH_EXT_BUSY;
+        ret = hal_flash_erase_continue(&s_flash_hold);
+    }
+    s_flash_state = HAL_FLASH_EXT_IDLE;
+    hal_flash_ext_cache_invalidate(addr, size);
+    /* XIP may have cached the old content. */
+    ll_xqspi_enable_cache_flush(XQSPI);
+    ll_xqspi_disable_cache_flush(XQSPI);
+
+    return (ret == HAL_FLASH_ERASE_DONE);
+}
+
+bool hal_flash_ext_erase(const uint32_t addr, const uint32_t size)
+{
+    uint32_t id;
+    uint32_t flash_size;
+    uint32_t cur = addr & ~(EXFLASH_SIZE_SECTOR_BYTES - 1);
+    uint32_t end = addr + size;
+    bool ok;
+
+    HAL_FLASH_STATS_BEGIN();
+    hal_flash_get_info(&id, &flash_size);
+    ok = (size != 0) && (addr >= EXFLASH_START_ADDR) && (end > addr) && (end <= EXFLASH_START_ADDR + flash_size);
+    end = (end + EXFLASH_SIZE_SECTOR_BYTES - 1) & ~(EXFLASH_SIZE_SECTOR_BYTES - 1);
+    /* Largest aligned block first, sectors at the edges. A hold waits for tSUS, whatever the unit. */
+    while (ok && (cur < end)) {
+        const hal_flash_erase_type_t *p_type = &s_erase_geo.types[hal_flash_ext_erase_step(&s_erase_geo, cur, end)];
+        ok = hal_flash_ext_erase_unit(p_type->cmd, cur, p_type->size);
+        cur += p_type->size;
+    }
+    HAL_FLASH_STATS_END(HAL_FLASH_OP_ERASE, size, ok);
+
+    return ok;
+}
+
+/* In RAM: the BLE interrupts that raise a hold run while an erase keeps XIP stalled. */
+SECTION_RAM_CODE void hal_flash_ext_suspend(void)
+{
+    GLOBAL_EXCEPTION_DISABLE();
+    if (s_flash_hold++ == 0) {
+        HAL_FLASH_STATS_MARK(s_flash_hold_raised);
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+}
+
+SECTION_RAM_CODE void hal_flash_ext_resume(void)
+{
+    GLOBAL_EXCEPTION_DISABLE();
+    if ((s_flash_hold > 0) && (--s_flash_hold == 0)) {
+        HAL_FLASH_STATS_MARK(s_flash_hold_released);
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+}
+
+hal_flash_ext_state_t hal_flash_ext_state(void)
+{
+    return s_flash_state;
+}
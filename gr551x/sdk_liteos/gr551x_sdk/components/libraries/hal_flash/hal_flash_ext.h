@@ -0,0 +1,479 @@
+/**
+  ******************************************************************************
+  * @file    hal_flash_ext.h
+  * @author  Engineering Team
+  * @brief   Statistics and extensions on top of the HAL flash driver.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright(C) 2016-2017, Shenzhen Huiding Technology Co., Ltd
+  * All Rights Reserved
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted, provided that the following conditions are met:
+  *
+  * 1. Redistribution of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  * 3. Neither the name of Goodix Technology nor the names of other
+  *    contributors to this software may be used to endorse or promote products
+  *    derived from this software without specific written permission.
+  * 4. This software, including modifications and/or derivative works of this
+  *    software, must execute solely and exclusively on microcontroller or
+  *    microprocessor devices manufactured by or for Goodix Technology.
+  * 5. Redistribution and use of this software other than as permitted under
+  *    this license is void and will automatically terminate your rights under
+  *    this license.
+  *
+  * THIS SOFTWARE IS PROVIDED BY Goodix Technology AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS, IMPLIED OR STATUTORY WARRANTIES, INCLUDING, BUT NOT
+  * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+  * PARTICULAR PURPOSE AND NON-INFRINGEMENT OF THIRD PARTY INTELLECTUAL PROPERTY
+  * RIGHTS ARE DISCLAIMED TO THE FULLEST EXTENT PERMITTED BY LAW. IN NO EVENT
+  * SHALL Goodix Technology OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/**
+ @addtogroup PERIPHERAL
+ @{
+*/
+
+/**
+  @addtogroup PERIPHERAL_API_HAL_FLASH_EXT HAL flash extensions
+  @{
+  @brief Flash services built on top of the HAL flash driver.
+
+  hal_flash_init/read/write/write_r/erase come prebuilt with the SDK libraries,
+  so what the application adds to flash access lives here: the hal_flash_ext_*
+  calls take the same arguments as the hal_flash_* calls they wrap and account
+  every operation in the flash statistics.
+
+  Erases are split into the largest aligned units the flash offers, up to
+  HAL_FLASH_ERASE_BLOCK_MAX: 64 KB and 32 KB blocks, sectors at the unaligned
+  edges. Blocks erase several times faster per byte than sectors, and since a
+  block erase is suspended like a sector erase, its longer run does not hold
+  up anyone. Programs are issued one page at a time. Both can be held off with
+  @ref hal_flash_ext_suspend: an erase in flight is suspended within tSUS, a
+  program ends within one page program time, and
+  nothing new starts until @ref hal_flash_ext_resume. The erasing task itself
+  sends the suspend and resume commands from its wait loop, since the exflash
+  handle is its own while the erase runs; a hold can therefore be raised from
+  any task or interrupt handler. Only writes and erases made through
+  hal_flash_ext_* are covered.
+
+  Reads shorter than HAL_FLASH_READ_CACHE_LINE go through a set-associative
+  cache of HAL_FLASH_READ_CACHE_SETS x HAL_FLASH_READ_CACHE_WAYS lines, so
+  repeated metadata and header lookups skip the QSPI transfer and, with
+  encryption, the decryption. Lines are kept short because a miss reads a whole
+  line: with page sized lines the fills cost more than the hits save on
+  scattered lookups (see tools/host_test/bench_hal_flash_cache.c). Writes and
+  erases through hal_flash_ext_* keep it coherent; after changing the flash or
+  the security mode any other way, call @ref hal_flash_ext_cache_invalidate.
+
+  The statistics are kept in a .noinit section, which the startup code does not
+  clear and which lies in the retention RAM cells: they survive deep sleep and
+  warm resets such as a watchdog reset, and are only cleared on power-on (when
+  the block magic does not match) or by @ref hal_flash_stats_reset.
+ */
+
+#ifndef _HAL_FLASH_EXT_H
+#define _HAL_FLASH_EXT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal_flash.h"
+
+/** @addtogroup HAL_FLASH_EXT_DEFINES Defines
+ * @{ */
+
+#ifndef HAL_FLASH_STATS_ENABLE
+#define HAL_FLASH_STATS_ENABLE      1       /**< Keep per-operation counters and latency histograms. */
+#endif
+
+#define HAL_FLASH_STATS_HIST_BINS   16      /**< Bin n counts latencies in [2^n, 2^(n+1)) us, bin 0 also < 1 us. */
+
+#ifndef HAL_FLASH_READ_CACHE_SETS
+#define HAL_FLASH_READ_CACHE_SETS   8       /**< Read cache sets for small reads, 0 disables the cache. */
+#endif
+
+#ifndef HAL_FLASH_READ_CACHE_WAYS
+#define HAL_FLASH_READ_CACHE_WAYS   4       /**< Lines per set. */
+#endif
+
+#ifndef HAL_FLASH_READ_CACHE_LINE
+#define HAL_FLASH_READ_CACHE_LINE   64      /**< Bytes per line, a power of 2; a miss reads one line. */
+#endif
+
+#define HAL_FLASH_VERIFY_READBACK   0       /**< Read the range back page by page and compare. */
+#define HAL_FLASH_VERIFY_SHA256     1       /**< Compare SHA-256 digests of the data and the flash, from the HMAC engine by DMA. */
+#define HAL_FLASH_VERIFY_CRC32      2       /**< Compare software CRC32 of the data and the flash. */
+
+#ifndef HAL_FLASH_VERIFY_MODE
+#define HAL_FLASH_VERIFY_MODE       HAL_FLASH_VERIFY_SHA256  /**< Verification of hal_flash_ext_write_r. */
+#endif
+
+#ifndef HAL_FLASH_ERASE_BLOCK_MAX
+#define HAL_FLASH_ERASE_BLOCK_MAX   0x10000 /**< Largest erase unit, EXFLASH_SIZE_SECTOR_BYTES for sectors only. */
+#endif
+
+#define HAL_FLASH_ERASE_TYPES_MAX   4       /**< Erase types a flash can describe, as in the JEDEC SFDP basic table. */
+
+/** @} */
+
+/** @addtogroup HAL_FLASH_EXT_STRUCTURES Structures
+ * @{ */
+
+/**
+ * @brief One erase command of the flash.
+ */
+typedef struct {
+    uint32_t size;                                  /**< Erase unit in bytes, a power of two. */
+    uint8_t  cmd;                                   /**< SPI command. */
+    uint16_t typ_ms;                                /**< Typical erase time. */
+    uint16_t max_ms;                                /**< Maximum erase time. */
+} hal_flash_erase_type_t;
+
+/**
+ * @brief Erase commands of the flash, by ascending size. types[0] is the sector erase.
+ */
+typedef struct {
+    uint32_t               count;                   /**< Valid entries in types. */
+    hal_flash_erase_type_t types[HAL_FLASH_ERASE_TYPES_MAX];
+} hal_flash_erase_geometry_t;
+
+/**
+ * @brief One segment of a vectored flash access.
+ */
+typedef struct {
+    void     *p_base;                               /**< Segment data. */
+    uint32_t  len;                                  /**< Segment length in bytes. */
+} hal_flash_iovec_t;
+
+/**
+ * @brief Flash operations tracked by the statistics.
+ */
+typedef enum {
+    HAL_FLASH_OP_READ,
+    HAL_FLASH_OP_WRITE,
+    HAL_FLASH_OP_WRITE_R,
+    HAL_FLASH_OP_ERASE,
+    HAL_FLASH_OP_MAX,
+} hal_flash_op_t;
+
+/**
+ * @brief Statistics of one operation type.
+ */
+typedef struct {
+    uint32_t count;                                 /**< Number of calls. */
+    uint32_t errors;                                /**< Number of failed calls. */
+    uint64_t bytes;                                 /**< Bytes read, written or erased by successful calls. */
+    uint32_t min_us;                                /**< Shortest call. */
+    uint32_t max_us;                                /**< Longest call, i.e. the worst stall seen by a caller. */
+    uint64_t total_us;                              /**< Sum of all calls, total_us / count is the average. */
+    uint32_t hist[HAL_FLASH_STATS_HIST_BINS];       /**< log2 latency histogram in us. */
+} hal_flash_op_stats_t;
+
+/**
+ * @brief Statistics of all hal_flash_ext operations.
+ */
+typedef struct {
+    uint32_t boots;                                 /**< Boots the statistics were kept across, 1 after a reset. */
+    hal_flash_op_stats_t op[HAL_FLASH_OP_MAX];
+    uint32_t cache_hits;                            /**< Lines of small reads served by the read cache. */
+    uint32_t cache_misses;                          /**< Lines of small reads fetched from the flash. */
+    uint32_t suspends;                              /**< Erases suspended by a hold. */
+    uint32_t suspend_max_us;                        /**< Longest time from the first hold to the erase being suspended. */
+    uint32_t resume_max_us;                         /**< Longest time from the last release to the erase resuming. */
+    uint64_t resume_total_us;                       /**< resume_total_us / suspends is the average. */
+} hal_flash_stats_t;
+
+/**
+ * @brief State of the flash as seen by the hal_flash_ext calls.
+ */
+typedef enum {
+    HAL_FLASH_EXT_IDLE,                             /**< No write or erase in flight. */
+    HAL_FLASH_EXT_BUSY,                             /**< A page program or an erase is running, the flash cannot be read. */
+    HAL_FLASH_EXT_SUSPENDED,                        /**< An erase is suspended, everything but its sector can be read. */
+} hal_flash_ext_state_t;
+
+/** @} */
+
+/** @addtogroup HAL_FLASH_EXT_FUNCTIONS Functions
+ * @{ */
+
+/**
+ *******************************************************************************
+ * @brief Initialize the extensions, after @ref hal_flash_init. Keeps the
+ *        statistics of the previous boot if they are still valid.
+ *******************************************************************************
+ */
+void hal_flash_ext_init(void);
+
+/**
+ *******************************************************************************
+ * @brief @ref hal_flash_read, accounted in the statistics. Reads shorter
+ *        than a cache line are served from the read cache when possible.
+ *
+ * @param[in]       addr    start address in flash to read data.
+ * @param[in,out]   buf     buffer to read data to.
+ * @param[in]       size    number of bytes to read.
+ *
+ * @return          number of bytes read
+ *******************************************************************************
+ */
+uint32_t hal_flash_ext_read(const uint32_t addr, uint8_t *buf, const uint32_t size);
+
+/**
+ *******************************************************************************
+ * @brief @ref hal_flash_write, accounted in the statistics.
+ *
+ * @param[in]       addr    start address in flash to write data to.
+ * @param[in]       buf     buffer of data to write.
+ * @param[in]       size    number of bytes to write.
+ *
+ * @return          number of bytes written
+ *******************************************************************************
+ */
+uint32_t hal_flash_ext_write(const uint32_t addr, const uint8_t *buf, const uint32_t size);
+
+/**
+ *******************************************************************************
+ * @brief Write several buffers to consecutive flash addresses, accounted as
+ *        one write in the statistics.
+ *
+ * @note Segments are packed into page programs, so a header and its payload,
+ *       or the two halves of a wrapped ring buffer, cost one program per page
+ *       instead of one per segment. Runs that fill whole pages are programmed
+ *       from the segment itself.
+ *
+ * @param[in]       addr    start address in flash to write data to.
+ * @param[in]       iov     segments to write, in order.
+ * @param[in]       cnt     number of segments.
+ *
+ * @return          number of bytes written from addr on, less than the sum of
+ *                  the segment lengths if a program failed
+ *******************************************************************************
+ */
+uint32_t hal_flash_ext_writev(const uint32_t addr, const hal_flash_iovec_t *iov, const uint32_t cnt);
+
+/**
+ *******************************************************************************
+ * @brief Read consecutive flash addresses into several buffers, each segment
+ *        by @ref hal_flash_ext_read.
+ *
+ * @param[in]       addr    start address in flash to read data.
+ * @param[in,out]   iov     segments to fill, in order.
+ * @param[in]       cnt     number of segments.
+ *
+ * @return          number of bytes read from addr on
+ *******************************************************************************
+ */
+uint32_t hal_flash_ext_readv(const uint32_t addr, const hal_flash_iovec_t *iov, const uint32_t cnt);
+
+/**
+ *******************************************************************************
+ * @brief Write like @ref hal_flash_ext_write, then check the flash holds buf,
+ *        accounted in the statistics.
+ *
+ * @note The check is chosen by HAL_FLASH_VERIFY_MODE. SHA256 hashes buf and
+ *       the flash through the XIP window on the HMAC engine and compares the
+ *       digests, so nothing is read over QSPI; it needs word aligned addr and
+ *       buf and unencrypted flash, and an engine no other driver has enabled.
+ *       The HMAC interrupt is masked while the digests run and restored
+ *       after. CRC32 reads the range back but only keeps its CRC. Whenever a
+ *       digest cannot be taken, the range is read back and compared.
+ *
+ * @param[in]       addr    start address in flash to write data to.
+ * @param[in]       buf     buffer of data to write.
+ * @param[in]       size    number of bytes to write.
+ *
+ * @return          number of bytes written
+ *******************************************************************************
+ */
+uint32_t hal_flash_ext_write_r(const uint32_t addr, const uint8_t *buf, const uint32_t size);
+
+/**
+ *******************************************************************************
+ * @brief @ref hal_flash_erase, accounted in the statistics.
+ *
+ * @note Each unit picked by @ref hal_flash_ext_erase_step is erased by its own
+ *       command, so the flash is HAL_FLASH_EXT_BUSY and can be suspended
+ *       during block erases as well as sector erases.
+ *
+ * @param[in]       addr    start address in flash to erase.
+ * @param[in]       size    number of bytes to erase.
+ *
+ * @retval true             If successful.
+ * @retval false            If failure.
+ *******************************************************************************
+ */
+bool hal_flash_ext_erase(const uint32_t addr, const uint32_t size);
+
+/**
+ *******************************************************************************
+ * @brief Get the erase commands used by @ref hal_flash_ext_erase.
+ *
+ * @note Selected by the JEDEC manufacturer ID in @ref hal_flash_ext_init.
+ *       Unknown parts only use the sector erase.
+ *
+ * @return Pointer to the erase geometry.
+ *******************************************************************************
+ */
+const hal_flash_erase_geometry_t *hal_flash_ext_erase_geometry(void);
+
+/**
+ *******************************************************************************
+ * @brief Pick the erase command for the start of a range.
+ *
+ * @note The largest unit aligned at addr that does not go beyond end and is
+ *       not larger than HAL_FLASH_ERASE_BLOCK_MAX. Erasing it and calling again
+ *       from addr + size until end covers [addr, end) exactly. Both addresses
+ *       must be sector aligned.
+ *
+ * @param[in] p_geo   Erase geometry.
+ * @param[in] addr    Sector aligned start of the range left to erase.
+ * @param[in] end     Sector aligned end of the range.
+ *
+ * @return Index in p_geo->types.
+ *******************************************************************************
+ */
+uint32_t hal_flash_ext_erase_step(const hal_flash_erase_geometry_t *p_geo, uint32_t addr, uint32_t end);
+
+/**
+ *******************************************************************************
+ * @brief Typical time @ref hal_flash_ext_erase takes for a range.
+ *
+ * @param[in] addr    start address in flash to erase.
+ * @param[in] size    number of bytes to erase.
+ *
+ * @return Typical erase time in ms.
+ *******************************************************************************
+ */
+uint32_t hal_flash_ext_erase_time(const uint32_t addr, const uint32_t size);
+
+/**
+ *******************************************************************************
+ * @brief Compute the CRC32 (IEEE 802.3) of a flash range.
+ *
+ * @note Lets a host check an image or a range it has written, e.g. over DFU,
+ *       without reading it back.
+ *
+ * @param[in] addr    start address in flash.
+ * @param[in] size    number of bytes.
+ *
+ * @return CRC32 of the range, 0 if it could not be read.
+ *******************************************************************************
+ */
+uint32_t hal_flash_ext_crc32(const uint32_t addr, const uint32_t size);
+
+/**
+ *******************************************************************************
+ * @brief Drop the read cache lines overlapping [addr, addr + size), all of them
+ *        if size is 0.
+ *
+ * @param[in] addr    start address in flash.
+ * @param[in] size    number of bytes.
+ *******************************************************************************
+ */
+void hal_flash_ext_cache_invalidate(const uint32_t addr, const uint32_t size);
+
+/**
+ *******************************************************************************
+ * @brief Raise a hold on flash writes and erases.
+ *
+ * @note Holds nest and each one is released by @ref hal_flash_ext_resume. The
+ *       erase in flight is suspended at the next status poll of its wait loop,
+ *       and no program or erase starts while a hold is raised. While an erase
+ *       runs, only interrupt handlers in RAM above the priority masked by
+ *       hal_exflash_operation_protection execute: they can raise a hold but not
+ *       wait for the suspend, which needs them to return first. A task that
+ *       needs the flash polls @ref hal_flash_ext_state until it is not
+ *       HAL_FLASH_EXT_BUSY, sleeping between polls.
+ *******************************************************************************
+ */
+void hal_flash_ext_suspend(void);
+
+/**
+ *******************************************************************************
+ * @brief Release a hold raised by @ref hal_flash_ext_suspend. The suspended
+ *        erase continues once the last hold is released.
+ *******************************************************************************
+ */
+void hal_flash_ext_resume(void);
+
+/**
+ *******************************************************************************
+ * @brief Get the state of hal_flash_ext writes and erases.
+ *
+ * @return Current state.
+ *******************************************************************************
+ */
+hal_flash_ext_state_t hal_flash_ext_state(void);
+
+/**
+ *******************************************************************************
+ * @brief Called by the writing or erasing task while it waits for the last
+ *        hold to be released. Empty by default, i.e. the task spins; override
+ *        it to yield or sleep, as the platform flash port does.
+ *******************************************************************************
+ */
+void hal_flash_ext_hold_wait(void);
+
+#if (HAL_FLASH_STATS_ENABLE == 1)
+
+/**
+ *******************************************************************************
+ * @brief Get a snapshot of the flash operation statistics.
+ *
+ * @param[out] p_stats  Pointer to the statistics to fill.
+ *******************************************************************************
+ */
+void hal_flash_stats_get(hal_flash_stats_t *p_stats);
+
+/**
+ *******************************************************************************
+ * @brief Clear the flash operation statistics.
+ *******************************************************************************
+ */
+void hal_flash_stats_reset(void);
+
+/**
+ *******************************************************************************
+ * @brief Get a timestamp for measuring an operation with @ref hal_flash_stats_update.
+ *
+ * @return  CPU cycle counter.
+ *******************************************************************************
+ */
+uint32_t hal_flash_stats_timestamp(void);
+
+/**
+ *******************************************************************************
+ * @brief Account one operation. Also used by flash users such as the littlefs
+ *        glue to keep their own statistics in the same format.
+ *
+ * @param[in,out] p_op   Statistics to update.
+ * @param[in]     start  Timestamp taken by @ref hal_flash_stats_timestamp before the operation.
+ * @param[in]     bytes  Bytes processed, 0 if the operation failed.
+ * @param[in]     ok     Whether the operation succeeded.
+ *******************************************************************************
+ */
+void hal_flash_stats_update(hal_flash_op_stats_t *p_op, uint32_t start, uint32_t bytes, bool ok);
+
+#endif
+
+/** @} */
+
+#endif /* _HAL_FLASH_EXT_H */
+
+/** @} */
+/** @} */
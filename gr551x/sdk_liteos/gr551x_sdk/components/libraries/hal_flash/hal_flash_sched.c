@@ -0,0 +1,276 @@
+/**
+  ******************************************************************************
+  * @file    hal_flash_sched.c
+  * @author  Engineering Team
+  * @brief   Implementation of the flash job scheduler.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright(C) 2016-2017, Shenzhen Huiding Technology Co., Ltd
+  * All Rights Reserved
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted, provided that the following conditions are met:
+  *
+  * 1. Redistribution of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  * 3. Neither the name of Goodix Technology nor the names of other
+  *    contributors to this software may be used to endorse or promote products
+  *    derived from this software without specific written permission.
+  * 4. This software, including modifications and/or derivative works of this
+  *    software, must execute solely and exclusively on microcontroller or
+  *    microprocessor devices manufactured by or for Goodix Technology.
+  * 5. Redistribution and use of this software other than as permitted under
+  *    this license is void and will automatically terminate your rights under
+  *    this license.
+  *
+  * THIS SOFTWARE IS PROVIDED BY Goodix Technology AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS, IMPLIED OR STATUTORY WARRANTIES, INCLUDING, BUT NOT
+  * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+  * PARTICULAR PURPOSE AND NON-INFRINGEMENT OF THIRD PARTY INTELLECTUAL PROPERTY
+  * RIGHTS ARE DISCLAIMED TO THE FULLEST EXTENT PERMITTED BY LAW. IN NO EVENT
+  * SHALL Goodix Technology OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "gr55xx_hal.h"
+#include "gr55xx_pwr.h"
+#include "hal_flash_sched.h"
+
+typedef struct {
+    hal_flash_job_type_t type;
+    uint32_t             addr;          /* next byte or sector to process */
+    uint32_t             end;
+    const uint8_t       *buf;           /* data for addr, writes only */
+    uint32_t             start_addr;
+    uint32_t             due_ms;
+    uint32_t             queued_ms;
+    bool                 started;
+    hal_flash_job_cb_t   cb;
+    void                *p_arg;
+} hal_flash_job_t;
+
+static hal_flash_job_t          s_jobs[HAL_FLASH_SCHED_QUEUE_LEN];
+static volatile uint32_t        s_job_head;
+static volatile uint32_t        s_job_tail;
+static hal_flash_time_get_t     s_time_get;
+static hal_flash_gap_get_t      s_gap_get;
+static hal_flash_sched_stats_t  s_sched_stats;
+
+/* The baseband only sleeps when its next event is further away than the BLE sleep threshold. */
+static uint32_t hal_flash_sched_baseband_gap(void)
+{
+    return (pwr_mgmt_baseband_state_get() == PMR_MGMT_SLEEP_MODE) ? HAL_FLASH_SCHED_SLEEP_GAP_US : 0;
+}
+
+bool hal_flash_sched_init(hal_flash_time_get_t time_get, hal_flash_gap_get_t gap_get)
+{
+    if (time_get == NULL) {
+        return false;
+    }
+
+    GLOBAL_EXCEPTION_DISABLE();
+    if ((gap_get != NULL) && ((s_gap_get == NULL) || (s_gap_get == hal_flash_sched_baseband_gap))) {
+        s_gap_get = gap_get;
+    } else if (s_gap_get == NULL) {
+        s_gap_get = hal_flash_sched_baseband_gap;
+    }
+    /* Set last: the other calls take a set clock to mean a usable scheduler. */
+    if (s_time_get == NULL) {
+        s_time_get = time_get;
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+
+    return true;
+}
+
+static bool hal_flash_sched_push(const hal_flash_job_t *p_job)
+{
+    bool ok = false;
+
+    if (s_time_get == NULL) {
+        return false;
+    }
+
+    GLOBAL_EXCEPTION_DISABLE();
+    if (s_job_tail - s_job_head < HAL_FLASH_SCHED_QUEUE_LEN) {
+        s_jobs[s_job_tail % HAL_FLASH_SCHED_QUEUE_LEN] = *p_job;
+        s_job_tail++;
+        s_sched_stats.jobs++;
+        ok = true;
+    } else {
+        s_sched_stats.rejected++;
+    }
+    GLOBAL_EXCEPTION_ENABLE();
+
+    return ok;
+}
+
+bool hal_flash_sched_write(uint32_t addr, const uint8_t *buf, uint32_t size, uint32_t deadline_ms,
+                           hal_flash_job_cb_t cb, void *p_arg)
+{
+    hal_flash_job_t job = {0};
+
+    if ((buf == NULL) || (size == 0)) {
+        return false;
+    }
+
+    job.type       = HAL_FLASH_JOB_WRITE;
+    job.addr       = addr;
+    job.end        = addr + size;
+    job.buf        = buf;
+    job.start_addr = addr;
+    job.cb         = cb;
+    job.p_arg      = p_arg;
+    if (s_time_get != NULL) {
+        job.queued_ms = s_time_get();
+        job.due_ms    = job.queued_ms + deadline_ms;
+    }
+
+    return hal_flash_sched_push(&job);
+}
+
+bool hal_flash_sched_erase(uint32_t addr, uint32_t size, uint32_t deadline_ms, hal_flash_job_cb_t cb, void *p_arg)
+{
+    hal_flash_job_t job = {0};
+
+    if (size == 0) {
+        return false;
+    }
+
+    job.type       = HAL_FLASH_JOB_ERASE;
+    job.addr       = addr & ~(EXFLASH_SIZE_SECTOR_BYTES - 1);
+    job.end        = addr + size;
+    job.start_addr = addr;
+    job.cb         = cb;
+    job.p_arg      = p_arg;
+    if (s_time_get != NULL) {
+        job.queued_ms = s_time_get();
+        job.due_ms    = job.queued_ms + deadline_ms;
+    }
+
+    return hal_flash_sched_push(&job);
+}
+
+/* Time the radio waits for an erase or write of size bytes from addr, one command per sector or page. */
+static uint32_t hal_flash_sched_op_us(hal_flash_job_type_t type, uint32_t addr, uint32_t size)
+{
+#if (HAL_FLASH_SCHED_ERASE_SUSPEND == 1)
+    if (type == HAL_FLASH_JOB_ERASE) {
+        return HAL_FLASH_SCHED_SUSPEND_US + HAL_FLASH_SCHED_MARGIN_US;
+    }
+#endif
+    uint32_t unit = (type == HAL_FLASH_JOB_ERASE) ? EXFLASH_SIZE_SECTOR_BYTES : EXFLASH_SIZE_PAGE_BYTES;
+    uint32_t first = addr & ~(unit - 1);
+    uint32_t count = (addr + size - first + unit - 1) / unit;
+
+    return count * ((type == HAL_FLASH_JOB_ERASE) ? HAL_FLASH_SCHED_ERASE_US : HAL_FLASH_SCHED_PAGE_US) +
+           HAL_FLASH_SCHED_MARGIN_US;
+}
+
+bool hal_flash_sched_gap_fits(hal_flash_job_type_t type, uint32_t size)
+{
+    if ((s_time_get == NULL) || (size == 0)) {
+        return true;
+    }
+
+    return (hal_flash_sched_op_us(type, 0, size) <= s_gap_get());
+}
+
+/* Length of the next piece: one sector, or the part of the write up to the next page boundary. */
+static uint32_t hal_flash_sched_piece_len(const hal_flash_job_t *p_job)
+{
+    if (p_job->type == HAL_FLASH_JOB_ERASE) {
+        return EXFLASH_SIZE_SECTOR_BYTES;
+    }
+
+    uint32_t len = EXFLASH_SIZE_PAGE_BYTES - (p_job->addr & (EXFLASH_SIZE_PAGE_BYTES - 1));
+    return (len > p_job->end - p_job->addr) ? (p_job->end - p_job->addr) : len;
+}
+
+static bool hal_flash_sched_piece(hal_flash_job_t *p_job, uint32_t len)
+{
+    if (p_job->type == HAL_FLASH_JOB_ERASE) {
+        bool ok = hal_flash_ext_erase(p_job->addr, len);
+        p_job->addr += len;
+        return ok;
+    }
+
+    bool ok = (hal_flash_ext_write(p_job->addr, p_job->buf, len) == len);
+    p_job->addr += len;
+    p_job->buf  += len;
+
+    return ok;
+}
+
+bool hal_flash_sched_poll(void)
+{
+    if ((s_time_get == NULL) || (s_job_head == s_job_tail)) {
+        return false;
+    }
+
+    hal_flash_job_t *p_job = &s_jobs[s_job_head % HAL_FLASH_SCHED_QUEUE_LEN];
+    uint32_t now = s_time_get();
+    bool overdue = ((int32_t)(now - p_job->due_ms) >= 0);
+    uint32_t len = hal_flash_sched_piece_len(p_job);
+
+    if (hal_flash_sched_op_us(p_job->type, p_job->addr, len) > s_gap_get()) {
+        if (!overdue) {
+            return true;
+        }
+        s_sched_stats.pieces_forced++;
+    } else {
+        s_sched_stats.pieces_in_gap++;
+    }
+
+    if (!p_job->started) {
+        p_job->started = true;
+        if (now - p_job->queued_ms > s_sched_stats.max_wait_ms) {
+            s_sched_stats.max_wait_ms = now - p_job->queued_ms;
+        }
+    }
+
+    bool ok = hal_flash_sched_piece(p_job, len);
+    if (ok && (p_job->addr < p_job->end)) {
+        return true;
+    }
+
+    if (!ok) {
+        s_sched_stats.failed++;
+    }
+    hal_flash_job_cb_t cb = p_job->cb;
+    hal_flash_job_type_t type = p_job->type;
+    uint32_t start_addr = p_job->start_addr;
+    void *p_arg = p_job->p_arg;
+
+    GLOBAL_EXCEPTION_DISABLE();
+    s_job_head++;
+    GLOBAL_EXCEPTION_ENABLE();
+    if (cb != NULL) {
+        cb(type, start_addr, ok, p_arg);
+    }
+
+    return (s_job_head != s_job_tail);
+}
+
+void hal_flash_sched_stats_get(hal_flash_sched_stats_t *p_stats)
+{
+    if (p_stats == NULL) {
+        return;
+    }
+
+    GLOBAL_EXCEPTION_DISABLE();
+    memcpy(p_stats, &s_sched_stats, sizeof(s_sched_stats));
+    GLOBAL_EXCEPTION_ENABLE();
+}
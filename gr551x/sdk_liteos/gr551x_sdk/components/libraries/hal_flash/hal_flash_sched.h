@@ -0,0 +1,252 @@
+/**
+  ******************************************************************************
+  * @file    hal_flash_sched.h
+  * @author  Engineering Team
+  * @brief   Flash job scheduler aligned to BLE radio idle windows.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright(C) 2016-2017, Shenzhen Huiding Technology Co., Ltd
+  * All Rights Reserved
+  *
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted, provided that the following conditions are met:
+  *
+  * 1. Redistribution of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  * 3. Neither the name of Goodix Technology nor the names of other
+  *    contributors to this software may be used to endorse or promote products
+  *    derived from this software without specific written permission.
+  * 4. This software, including modifications and/or derivative works of this
+  *    software, must execute solely and exclusively on microcontroller or
+  *    microprocessor devices manufactured by or for Goodix Technology.
+  * 5. Redistribution and use of this software other than as permitted under
+  *    this license is void and will automatically terminate your rights under
+  *    this license.
+  *
+  * THIS SOFTWARE IS PROVIDED BY Goodix Technology AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS, IMPLIED OR STATUTORY WARRANTIES, INCLUDING, BUT NOT
+  * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+  * PARTICULAR PURPOSE AND NON-INFRINGEMENT OF THIRD PARTY INTELLECTUAL PROPERTY
+  * RIGHTS ARE DISCLAIMED TO THE FULLEST EXTENT PERMITTED BY LAW. IN NO EVENT
+  * SHALL Goodix Technology OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/**
+ @addtogroup PERIPHERAL
+ @{
+*/
+
+/**
+  @addtogroup PERIPHERAL_API_HAL_FLASH_SCHED HAL flash job scheduler
+  @{
+  @brief Queue flash writes and erases and run them while the BLE radio is idle.
+
+  A sector erase or a page program stalls XIP and the BLE stack for milliseconds.
+  Jobs queued here are cut into sectors and pages, and @ref hal_flash_sched_poll
+  issues the next piece only when its estimated time, HAL_FLASH_SCHED_ERASE_US or
+  HAL_FLASH_SCHED_PAGE_US plus HAL_FLASH_SCHED_MARGIN_US, fits in the time left
+  before the next radio event. A piece that has waited past the job's deadline
+  is issued anyway so the queue always drains. Pieces go through hal_flash_ext,
+  so they are accounted in the flash statistics and can be suspended.
+
+  With HAL_FLASH_SCHED_ERASE_SUSPEND, the flash suspends erases and the
+  platform raises a hal_flash_ext hold when the BLE core wakes up for an event.
+  An erase then only has to be suspendable before the event, so the gap must
+  hold HAL_FLASH_SCHED_SUSPEND_US rather than the whole erase. Page programs
+  are not suspended and always need the gap for their full time.
+
+  The SDK does not tell when the next radio event is due. Without a gap source
+  from the application, the baseband sleep state is used: the baseband only
+  sleeps when its next event is at least the BLE sleep threshold away, taken to
+  be HAL_FLASH_SCHED_SLEEP_GAP_US.
+ */
+
+#ifndef _HAL_FLASH_SCHED_H
+#define _HAL_FLASH_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal_flash_ext.h"
+
+/** @addtogroup HAL_FLASH_SCHED_DEFINES Defines
+ * @{ */
+
+#ifndef HAL_FLASH_SCHED_QUEUE_LEN
+#define HAL_FLASH_SCHED_QUEUE_LEN   8       /**< Maximum number of queued jobs. */
+#endif
+
+#ifndef HAL_FLASH_SCHED_ERASE_US
+#define HAL_FLASH_SCHED_ERASE_US    50000   /**< Sector erase time the gap must hold. */
+#endif
+
+#ifndef HAL_FLASH_SCHED_PAGE_US
+#define HAL_FLASH_SCHED_PAGE_US     1000    /**< Page program time the gap must hold. */
+#endif
+
+#ifndef HAL_FLASH_SCHED_MARGIN_US
+#define HAL_FLASH_SCHED_MARGIN_US   500     /**< Added to every estimate for the wake-up before the event. */
+#endif
+
+#ifndef HAL_FLASH_SCHED_ERASE_SUSPEND
+#define HAL_FLASH_SCHED_ERASE_SUSPEND 1     /**< Erases are suspended by a hold ahead of each radio event. */
+#endif
+
+#ifndef HAL_FLASH_SCHED_SUSPEND_US
+#define HAL_FLASH_SCHED_SUSPEND_US  100     /**< Time to suspend an erase: a status poll plus tSUS, rounded up. */
+#endif
+
+#ifndef HAL_FLASH_SCHED_SLEEP_GAP_US
+#define HAL_FLASH_SCHED_SLEEP_GAP_US 2000   /**< Gap assumed while the baseband sleeps, the BLE sleep threshold. */
+#endif
+
+#define HAL_FLASH_SCHED_GAP_ANY     0xFFFFFFFF  /**< Gap value for no radio event scheduled. */
+
+/** @} */
+
+/** @addtogroup HAL_FLASH_SCHED_STRUCTURES Structures
+ * @{ */
+
+/**
+ * @brief Flash job types.
+ */
+typedef enum {
+    HAL_FLASH_JOB_WRITE,
+    HAL_FLASH_JOB_ERASE,
+} hal_flash_job_type_t;
+
+/**
+ * @brief Job completion callback, called from @ref hal_flash_sched_poll.
+ */
+typedef void (*hal_flash_job_cb_t)(hal_flash_job_type_t type, uint32_t addr, bool ok, void *p_arg);
+
+/**
+ * @brief Returns the time in us until the radio next needs the CPU and flash,
+ *        0 while it does, HAL_FLASH_SCHED_GAP_ANY if nothing is scheduled.
+ */
+typedef uint32_t (*hal_flash_gap_get_t)(void);
+
+/**
+ * @brief Returns a free running millisecond counter.
+ */
+typedef uint32_t (*hal_flash_time_get_t)(void);
+
+/**
+ * @brief Scheduler statistics.
+ */
+typedef struct {
+    uint32_t jobs;                  /**< Jobs accepted. */
+    uint32_t rejected;              /**< Jobs refused because the queue was full. */
+    uint32_t failed;                /**< Jobs aborted by a flash error. */
+    uint32_t pieces_in_gap;         /**< Sectors/pages issued in a gap that could hold them. */
+    uint32_t pieces_forced;         /**< Sectors/pages issued because the deadline passed. */
+    uint32_t max_wait_ms;           /**< Longest time a job waited for its first piece. */
+} hal_flash_sched_stats_t;
+
+/** @} */
+
+/** @addtogroup HAL_FLASH_SCHED_FUNCTIONS Functions
+ * @{ */
+
+/**
+ *******************************************************************************
+ * @brief Initialize the scheduler. Later calls, e.g. by the application and
+ *        the file system, keep the queue, the statistics and the first clock,
+ *        and a gap_get only replaces the default gap source.
+ *
+ * @param[in] time_get   Millisecond clock, used for deadlines.
+ * @param[in] gap_get    Time to the next radio event, NULL to use the baseband sleep state.
+ *
+ * @retval true          If successful.
+ * @retval false         If time_get is NULL.
+ *******************************************************************************
+ */
+bool hal_flash_sched_init(hal_flash_time_get_t time_get, hal_flash_gap_get_t gap_get);
+
+/**
+ *******************************************************************************
+ * @brief Queue a write. buf must stay valid until the callback.
+ *
+ * @param[in] addr         Start address in flash.
+ * @param[in] buf          Data to write.
+ * @param[in] size         Number of bytes to write.
+ * @param[in] deadline_ms  Time after which pieces are issued regardless of the radio.
+ * @param[in] cb           Completion callback, may be NULL.
+ * @param[in] p_arg        Argument passed to cb.
+ *
+ * @retval true            If queued.
+ * @retval false           If the queue is full.
+ *******************************************************************************
+ */
+bool hal_flash_sched_write(uint32_t addr, const uint8_t *buf, uint32_t size, uint32_t deadline_ms,
+                           hal_flash_job_cb_t cb, void *p_arg);
+
+/**
+ *******************************************************************************
+ * @brief Queue an erase of all sectors in [addr, addr + size).
+ *
+ * @param[in] addr         Start address in flash.
+ * @param[in] size         Number of bytes to erase.
+ * @param[in] deadline_ms  Time after which pieces are issued regardless of the radio.
+ * @param[in] cb           Completion callback, may be NULL.
+ * @param[in] p_arg        Argument passed to cb.
+ *
+ * @retval true            If queued.
+ * @retval false           If the queue is full.
+ *******************************************************************************
+ */
+bool hal_flash_sched_erase(uint32_t addr, uint32_t size, uint32_t deadline_ms, hal_flash_job_cb_t cb, void *p_arg);
+
+/**
+ *******************************************************************************
+ * @brief Issue at most one sector erase or page program if it fits in the gap
+ *        before the next radio event or the head job is overdue. Call it from the idle loop or a low
+ *        priority task, from one context only.
+ *
+ * @retval true            If jobs remain queued.
+ * @retval false           If the queue is empty.
+ *******************************************************************************
+ */
+bool hal_flash_sched_poll(void);
+
+/**
+ *******************************************************************************
+ * @brief Check whether an erase or write made now fits in the gap before the
+ *        next radio event, for callers that access the flash directly.
+ *
+ * @param[in] type         Operation type.
+ * @param[in] size         Number of bytes to erase or write.
+ *
+ * @retval true            If the estimated time fits, or the scheduler is not
+ *                         initialized.
+ * @retval false           If the radio needs the flash before it would end.
+ *******************************************************************************
+ */
+bool hal_flash_sched_gap_fits(hal_flash_job_type_t type, uint32_t size);
+
+/**
+ *******************************************************************************
+ * @brief Get a snapshot of the scheduler statistics.
+ *
+ * @param[out] p_stats     Pointer to the statistics to fill.
+ *******************************************************************************
+ */
+void hal_flash_sched_stats_get(hal_flash_sched_stats_t *p_stats);
+
+/** @} */
+
+#endif /* _HAL_FLASH_SCHED_H */
+
+/** @} */
+/** @} */
@@ -74,7 +74,7 @@ uint32_t ring_buffer_write(ring_buffer_t *p_ring_buff, uint8_t const *p_wr_data,
     uint32_t over_flow      = 0;
     uint32_t wr_idx         = p_ring_buff->write_index;
     uint32_t rd_idx         = p_ring_buff->read_index;
-    uint32_t ret = 0;
+    int      ret;
     uint32_t len = length;
 
     RING_BUFFER_LOCK();
@@ -92,12 +92,14 @@ uint32_t ring_buffer_write(ring_buffer_t *p_ring_buff, uint8_t const *p_wr_data,
     }
 
     ret = memcpy_s(p_ring_buff->p_buffer + wr_idx, len - over_flow, p_wr_data, len - over_flow);
-    if (ret < 0) {
-        return ret;
+    if (ret != 0) {
+        RING_BUFFER_UNLOCK();
+        return 0;
     }
     ret = memcpy_s(p_ring_buff->p_buffer, over_flow, p_wr_data + len - over_flow, over_flow);
-    if (ret < 0) {
-        return ret;
+    if (ret != 0) {
+        RING_BUFFER_UNLOCK();
+        return 0;
     }
     wr_idx += len;
 
@@ -179,6 +181,47 @@ uint32_t ring_buffer_pick(ring_buffer_t *p_ring_buff, uint8_t *p_rd_data, uint32
     return len;
 }
 
+uint32_t ring_buffer_items_peek(ring_buffer_t *p_ring_buff, uint8_t *pp_data[2], uint32_t p_len[2])
+{
+    uint32_t wr_idx;
+    uint32_t rd_idx;
+
+    RING_BUFFER_LOCK();
+    wr_idx = p_ring_buff->write_index;
+    rd_idx = p_ring_buff->read_index;
+    RING_BUFFER_UNLOCK();
+
+    pp_data[0] = p_ring_buff->p_buffer + rd_idx;
+    pp_data[1] = p_ring_buff->p_buffer;
+
+    if (rd_idx <= wr_idx) {
+        p_len[0] = wr_idx - rd_idx;
+        p_len[1] = 0;
+    } else {
+        p_len[0] = p_ring_buff->buffer_size - rd_idx;
+        p_len[1] = wr_idx;
+    }
+
+    return p_len[0] + p_len[1];
+}
+
+uint32_t ring_buffer_items_drop(ring_buffer_t *p_ring_buff, uint32_t length)
+{
+    RING_BUFFER_LOCK();
+
+    uint32_t items_avail = ring_buffer_items_count_get(p_ring_buff);
+    uint32_t len = (length > items_avail ? items_avail : length);
+    uint32_t rd_idx = p_ring_buff->read_index + len;
+    if (rd_idx >= p_ring_buff->buffer_size) {
+        rd_idx -= p_ring_buff->buffer_size;
+    }
+    p_ring_buff->read_index = rd_idx;
+
+    RING_BUFFER_UNLOCK();
+
+    return len;
+}
+
 uint32_t ring_buffer_items_count_get(ring_buffer_t *p_ring_buff)
 {
     uint32_t wr_idx = p_ring_buff->write_index;
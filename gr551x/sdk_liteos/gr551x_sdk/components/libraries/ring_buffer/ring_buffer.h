@@ -115,6 +115,35 @@ uint32_t ring_buffer_read(ring_buffer_t *p_ring_buff, uint8_t *p_rd_data, uint32
  *****************************************************************************************
  */
 uint32_t ring_buffer_pick(ring_buffer_t *p_ring_buff, uint8_t *p_rd_data, uint32_t length);
+
+/**
+ *****************************************************************************************
+ * @brief Get the availdble data of one ring buffer in place, without copying it.
+ *
+ * @note The data is split in two spans when it wraps around the end of the buffer,
+ *       the second span length is 0 otherwise. Writers never overwrite it, so it stays
+ *       valid until released with ring_buffer_items_drop by the single reader.
+ *
+ * @param[in]  p_ring_buff: Pointer to ring buffer.
+ * @param[out] pp_data:     Array of two span pointers.
+ * @param[out] p_len:       Array of two span lengths.
+ *
+ * @return Length of availdble data.
+ *****************************************************************************************
+ */
+uint32_t ring_buffer_items_peek(ring_buffer_t *p_ring_buff, uint8_t *pp_data[2], uint32_t p_len[2]);
+
+/**
+ *****************************************************************************************
+ * @brief Discard data from one ring buffer.
+ *
+ * @param[in] p_ring_buff: Pointer to ring buffer.
+ * @param[in] length:      Length of data want to discard.
+ *
+ * @return Length of discarded data.
+ *****************************************************************************************
+ */
+uint32_t ring_buffer_items_drop(ring_buffer_t *p_ring_buff, uint32_t length);
 /**
  *****************************************************************************************
  * @brief Get surplus space of one ring buffer.
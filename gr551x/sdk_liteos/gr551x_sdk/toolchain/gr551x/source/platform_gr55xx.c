@@ -45,6 +45,7 @@
 #include "gr55xx_sys.h"
 #include "gr55xx_ll_pwr.h"
 #include "hal_flash.h"
+#include "hal_flash_ext.h"
 #include "platform_sdk.h"
 #include "pmu_calibration.h"
 #include "boards.h"
@@ -208,6 +209,7 @@ void platform_init(void)
          * Output log via UART or Dump an error code to flash. */
         while (1) {}
     }
+    hal_flash_ext_init();
 
 #if (defined(GR5515_E) && defined(ROM_RUN_IN_FLASH)) || !defined(GR5515_E)
     platform_flash_enable_quad();
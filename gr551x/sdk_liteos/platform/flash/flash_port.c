@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include "gr55xx_hal.h"
+#include "gr55xx_pwr.h"
+#include "hal_flash_ext.h"
+#include "los_task.h"
+#include "los_tick.h"
+#include "flash_port.h"
+
+#ifndef FLASH_RADIO_HOLD_MAX_MS
+#define FLASH_RADIO_HOLD_MAX_MS     20      /* a few connection events at the shortest interval */
+#endif
+
+void BLESLP_IRQHandler(void);
+
+static volatile bool g_flashRadioHold = false;
+static UINT64 g_flashRadioHoldTick;         /* when the erasing task first saw the hold, 0 not yet */
+
+/* In RAM, like the BLE handler it wraps in ROM: it runs while an erase keeps XIP stalled. */
+SECTION_RAM_CODE void FlashBleWakeupHandler(void)
+{
+    if (!g_flashRadioHold) {
+        g_flashRadioHold = true;
+        hal_flash_ext_suspend();
+    }
+    BLESLP_IRQHandler();
+}
+
+/* Drop the radio hold once the baseband is done, or has kept the flash long enough. */
+static bool FlashRadioHoldRelease(void)
+{
+    UINT64 now = LOS_TickCountGet();
+    bool release;
+
+    if (!g_flashRadioHold) {
+        return false;
+    }
+    if (g_flashRadioHoldTick == 0) {
+        g_flashRadioHoldTick = now;
+    }
+    release = (pwr_mgmt_baseband_state_get() != PMR_MGMT_ACTIVE_MODE) ||
+              (now - g_flashRadioHoldTick >= LOS_MS2Tick(FLASH_RADIO_HOLD_MAX_MS));
+    if (!release) {
+        return false;
+    }
+
+    GLOBAL_EXCEPTION_DISABLE();
+    g_flashRadioHold = false;
+    g_flashRadioHoldTick = 0;
+    hal_flash_ext_resume();
+    GLOBAL_EXCEPTION_ENABLE();
+
+    return true;
+}
+
+/* Writes and erases run in tasks: sleep while a flash hold is raised so its holder gets the CPU. */
+void hal_flash_ext_hold_wait(void)
+{
+    if (!FlashRadioHoldRelease()) {
+        (void)LOS_TaskDelay(1);
+    }
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FLASH_PORT_H
+#define __FLASH_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Keeps flash erases off the radio. The BLE core wakes up ahead of each radio event with BLESLP_IRQn,
+ * which main.c routes to FlashBleWakeupHandler: it raises a hal_flash_ext hold, so an erase in flight
+ * is suspended and the BLE stack can fetch from flash again. The erasing task releases the hold once
+ * the baseband is no longer active, or after FLASH_RADIO_HOLD_MAX_MS so that erases still progress.
+ */
+void FlashBleWakeupHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FLASH_PORT_H */
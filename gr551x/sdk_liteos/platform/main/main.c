@@ -19,6 +19,7 @@
 #include "gr55xx_sys.h"
 #include "custom_config.h"
 #include "uart.h"
+#include "flash_port.h"
 #include "app_rng.h"
 #include "app_log.h"
 #include "los_task.h"
@@ -97,7 +98,7 @@ void OSVectorInit(void)
     OsSetVector(XQSPI_IRQn, (HWI_PROC_FUNC)XQSPI_IRQHandler);
     OsSetVector(QSPI1_IRQn, (HWI_PROC_FUNC)QSPI1_IRQHandler);
     OsSetVector(PWR_CMD_IRQn, (HWI_PROC_FUNC)PWR_CMD_IRQHandler);
-    OsSetVector(BLESLP_IRQn, (HWI_PROC_FUNC)BLESLP_IRQHandler);
+    OsSetVector(BLESLP_IRQn, (HWI_PROC_FUNC)FlashBleWakeupHandler);
     OsSetVector(SLPTIMER_IRQn, (HWI_PROC_FUNC)SLPTIMER_IRQHandler);
     OsSetVector(COMP_EXT_IRQn, (HWI_PROC_FUNC)COMP_IRQHandler);
     OsSetVector(AON_WDT_IRQn, (HWI_PROC_FUNC)AON_WDT_IRQHandler);
@@ -14,16 +14,434 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "gr55xx.h"
 #include "app_log.h"
 #include "los_sem.h"
+#include "los_task.h"
+#include "los_tick.h"
 #include "uart.h"
 
 #define UART_TX_TIMEOUT         1000
 #define HILOG_IDX               2
 
+/* HiLog records are queued and sent by a low-priority task instead of by the logging task. */
+#ifndef HILOG_ASYNC_ENABLE
+#define HILOG_ASYNC_ENABLE          1
+#endif
+
+#ifndef HILOG_ASYNC_RING_SIZE
+#define HILOG_ASYNC_RING_SIZE       0x1000  /* power of two, at most 0x8000 */
+#endif
+
+#ifndef HILOG_ASYNC_POLICY
+#define HILOG_ASYNC_POLICY          HILOG_ASYNC_DROP_NEWEST
+#endif
+
+#define HILOG_ASYNC_RECORD_MAX      256     /* longer records are truncated */
+#define HILOG_ASYNC_BATCH_SIZE      512
+#define HILOG_ASYNC_TASK_NAME       "HiLogAsync"
+#define HILOG_ASYNC_TASK_STACKSIZE  0x400
+#define HILOG_ASYNC_TASK_PRIOR      25      /* below every service task, above idle */
+
+/* Exception numbers of the fault handlers, NMI to usage fault, as __get_IPSR() reads them. */
+#define UART_EXC_FAULT_FIRST        (NonMaskableInt_IRQn + 16)
+#define UART_EXC_FAULT_LAST         (UsageFault_IRQn + 16)
+
 static UINT32 rxSemHandle;
 static bool uart_initialized = false;
+static volatile bool uart_panic = false;
+
+/* Busy-wait the bytes into the TX FIFO, clear of the HAL lock a preempted sender may still hold. */
+static void uart_poll_send(const uint8_t *p_data, uint32_t length)
+{
+    uart_regs_t *p_instance = app_uart_get_handle(LOG_UART_ID)->p_instance;
+
+    for (uint32_t i = 0; i < length; i++) {
+        while (!ll_uart_is_active_flag_tfnf(p_instance)) {
+        }
+        ll_uart_transmit_data8(p_instance, p_data[i]);
+    }
+}
+
+/* A fault handler is printing: nothing else will run again, so switch to bsp_uart_panic() first. */
+static bool uart_in_panic(void)
+{
+    uint32_t exc = __get_IPSR();
+
+    if (!uart_panic && exc >= UART_EXC_FAULT_FIRST && exc <= UART_EXC_FAULT_LAST) {
+        bsp_uart_panic();
+    }
+
+    return uart_panic;
+}
+
+#if (HILOG_ASYNC_ENABLE == 1)
+#define HILOG_RING_MASK             (HILOG_ASYNC_RING_SIZE - 1)
+#define HILOG_REC_ALIGN(n)          (((n) + 7U) & ~7U)
+#define HILOG_REC_PAD               0x8000  /* in len */
+#define HILOG_REC_CHECK(pos, len)   ((uint16_t)(~(pos) ^ (len)))
+
+/*
+ * Records are reserved by moving g_hilogHead with compare-and-swap, filled in, then published by
+ * storing their ring position in pos. Positions run freely and are masked into the ring; a record
+ * that would cross the end is preceded by a pad record filling the gap. The record at the tail is
+ * valid once pos matches the tail and check matches both, so writers may finish out of order and
+ * stale ring contents are not mistaken for a record. Whoever frees it, the drain task or a writer
+ * dropping the oldest record, first claims it by swapping pos to an unaligned value and only then
+ * moves the tail; the drain task discards its copy of a record it lost the claim on.
+ */
+typedef struct {
+    uint32_t pos;
+    uint16_t len;
+    uint16_t check;
+} HiLogRecHdr;
+
+static uint64_t g_hilogRing[HILOG_ASYNC_RING_SIZE / sizeof(uint64_t)];
+static uint8_t g_hilogBatch[HILOG_ASYNC_BATCH_SIZE];
+static uint32_t g_hilogHead = 0;            /* next position to reserve */
+static uint32_t g_hilogTail = 0;            /* oldest record not yet taken by the drain task */
+static uint32_t g_hilogWaiters = 0;
+static uint32_t g_hilogPolicy = HILOG_ASYNC_POLICY;
+static volatile bool g_hilogSending = false;
+static volatile bool g_hilogRunning = false;
+static bool g_hilogReady = false;
+static UINT32 g_hilogDataSem;
+static UINT32 g_hilogSpaceSem;
+static UINT32 g_hilogTaskID;
+static HiLogAsyncStats g_hilogStats;
+
+static inline HiLogRecHdr *HiLogRecAt(uint32_t pos)
+{
+    return (HiLogRecHdr *)((uint8_t *)g_hilogRing + (pos & HILOG_RING_MASK));
+}
+
+static inline void HiLogStatAdd(uint32_t *cnt, uint32_t val)
+{
+    (void)__atomic_fetch_add(cnt, val, __ATOMIC_RELAXED);
+}
+
+static inline void HiLogStatMax(uint32_t *cnt, uint32_t val)
+{
+    uint32_t old = __atomic_load_n(cnt, __ATOMIC_RELAXED);
+
+    while (val > old && !__atomic_compare_exchange_n(cnt, &old, val, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/* Read a counter, resetting it in the same step so that no concurrent update is lost. */
+static inline uint32_t HiLogStatTake(uint32_t *cnt, bool clear)
+{
+    return clear ? __atomic_exchange_n(cnt, 0, __ATOMIC_RELAXED) : __atomic_load_n(cnt, __ATOMIC_RELAXED);
+}
+
+static inline void HiLogRecPublish(uint32_t pos, uint16_t len)
+{
+    HiLogRecHdr *hdr = HiLogRecAt(pos);
+
+    hdr->len = len;
+    hdr->check = HILOG_REC_CHECK(pos, len);
+    __atomic_store_n(&hdr->pos, pos, __ATOMIC_RELEASE);
+}
+
+/* Ring bytes taken by the record at tail, or 0 if it is not published or is being freed. */
+static uint32_t HiLogRecSize(uint32_t tail, uint16_t *len)
+{
+    HiLogRecHdr *hdr = HiLogRecAt(tail);
+
+    if (__atomic_load_n(&hdr->pos, __ATOMIC_ACQUIRE) != tail) {
+        return 0;
+    }
+    *len = hdr->len;
+    if (hdr->check != HILOG_REC_CHECK(tail, *len)) {
+        return 0;
+    }
+
+    return sizeof(HiLogRecHdr) + HILOG_REC_ALIGN(*len & ~HILOG_REC_PAD);
+}
+
+static bool HiLogRecFree(uint32_t tail, uint32_t size)
+{
+    uint32_t pos = tail;
+
+    if (!__atomic_compare_exchange_n(&HiLogRecAt(tail)->pos, &pos, tail | 1, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    __atomic_store_n(&g_hilogTail, tail + size, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static bool HiLogReserve(uint32_t need, uint32_t *pos)
+{
+    uint32_t tail;
+    uint32_t head;
+    uint32_t contig;
+    uint32_t total;
+
+    do {
+        /* tail first: it never passes head, so the difference below cannot go negative */
+        tail = __atomic_load_n(&g_hilogTail, __ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&g_hilogHead, __ATOMIC_RELAXED);
+        contig = HILOG_ASYNC_RING_SIZE - (head & HILOG_RING_MASK);
+        total = (contig < need) ? (contig + need) : need;
+        if (head + total - tail > HILOG_ASYNC_RING_SIZE) {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&g_hilogHead, &head, head + total, false,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    if (total != need) {
+        HiLogRecPublish(head, (uint16_t)(contig - sizeof(HiLogRecHdr)) | HILOG_REC_PAD);
+        head += contig;
+    }
+    HiLogStatMax(&g_hilogStats.highWater, head + need - tail);
+    *pos = head;
+
+    return true;
+}
+
+/*
+ * Make room by discarding the oldest record. false if it is still being written or freed, so a
+ * writer never spins on a lower-priority task that was preempted halfway.
+ */
+static bool HiLogDropOldest(void)
+{
+    uint32_t tail = __atomic_load_n(&g_hilogTail, __ATOMIC_ACQUIRE);
+    uint16_t len = 0;
+    uint32_t size = HiLogRecSize(tail, &len);
+
+    if (size == 0) {
+        return false;
+    }
+    if (HiLogRecFree(tail, size) && !(len & HILOG_REC_PAD)) {
+        HiLogStatAdd(&g_hilogStats.droppedRecords, 1);
+        HiLogStatAdd(&g_hilogStats.droppedBytes, len);
+    }
+
+    return true;
+}
+
+/*
+ * Wait for the drain task to free space, for as long as it takes. Not possible from interrupts, the
+ * drain task itself, before it runs or with the scheduler locked: the record is dropped there.
+ */
+static bool HiLogWaitSpace(bool *waited)
+{
+    UINT32 ret;
+
+    if (!g_hilogRunning || __get_IPSR() || LOS_CurTaskIDGet() == g_hilogTaskID) {
+        return false;
+    }
+    if (!*waited) {
+        *waited = true;
+        HiLogStatAdd(&g_hilogStats.blocked, 1);
+    }
+
+    HiLogStatAdd(&g_hilogWaiters, 1);
+    ret = LOS_SemPend(g_hilogSpaceSem, 1);
+    (void)__atomic_fetch_sub(&g_hilogWaiters, 1, __ATOMIC_RELAXED);
+
+    return (ret == LOS_OK) || (ret == LOS_ERRNO_SEM_TIMEOUT);
+}
+
+static int HiLogAsyncPut(const char *buf, uint32_t len)
+{
+    uint32_t need;
+    uint32_t pos = 0;
+    bool waited = false;
+    HiLogRecHdr *hdr = NULL;
+    bool truncated = false;
+
+    if (len > HILOG_ASYNC_RECORD_MAX) {
+        len = HILOG_ASYNC_RECORD_MAX;
+        truncated = true;
+        HiLogStatAdd(&g_hilogStats.truncated, 1);
+    }
+    need = sizeof(HiLogRecHdr) + HILOG_REC_ALIGN(len);
+
+    while (!HiLogReserve(need, &pos)) {
+        uint32_t policy = __atomic_load_n(&g_hilogPolicy, __ATOMIC_RELAXED);
+        if ((policy == HILOG_ASYNC_DROP_OLDEST && HiLogDropOldest()) ||
+                (policy == HILOG_ASYNC_BLOCK && HiLogWaitSpace(&waited))) {
+            continue;
+        }
+        HiLogStatAdd(&g_hilogStats.droppedRecords, 1);
+        HiLogStatAdd(&g_hilogStats.droppedBytes, len);
+        return -1;
+    }
+
+    hdr = HiLogRecAt(pos);
+    memcpy(hdr + 1, buf, len);
+    if (truncated) {
+        ((char *)(hdr + 1))[len - 1] = '\n';
+    }
+    HiLogRecPublish(pos, (uint16_t)len);
+
+    HiLogStatAdd(&g_hilogStats.records, 1);
+    HiLogStatAdd(&g_hilogStats.bytes, len);
+    (void)LOS_SemPost(g_hilogDataSem);
+
+    return 0;
+}
+
+/* Move published records into the batch buffer. A record a writer dropped meanwhile is discarded. */
+static uint32_t HiLogCollect(void)
+{
+    uint32_t n = 0;
+    uint32_t tail;
+    uint32_t size;
+    uint16_t len = 0;
+
+    for (;;) {
+        tail = __atomic_load_n(&g_hilogTail, __ATOMIC_ACQUIRE);
+        size = HiLogRecSize(tail, &len);
+        if (size == 0) {
+            break;
+        }
+        if (len & HILOG_REC_PAD) {
+            len = 0;
+        } else if (n + len > HILOG_ASYNC_BATCH_SIZE) {
+            break;
+        } else {
+            memcpy(g_hilogBatch + n, HiLogRecAt(tail) + 1, len);
+        }
+        if (HiLogRecFree(tail, size)) {
+            n += len;
+        }
+    }
+    if (__atomic_load_n(&g_hilogWaiters, __ATOMIC_RELAXED) != 0) {
+        (void)LOS_SemPost(g_hilogSpaceSem);
+    }
+
+    return n;
+}
+
+static void HiLogAsyncTask(void)
+{
+    uint32_t n;
+
+    g_hilogRunning = true;
+    for (;;) {
+        g_hilogSending = true;
+        n = HiLogCollect();
+        if (n != 0) {
+            (void)app_uart_transmit_sync(LOG_UART_ID, g_hilogBatch, n, UART_TX_TIMEOUT);
+            continue;
+        }
+        g_hilogSending = false;
+        (void)LOS_SemPend(g_hilogDataSem, LOS_WAIT_FOREVER);
+    }
+}
+
+/*
+ * Send what is queued straight from the ring, for bsp_uart_panic(). Nothing else runs by then, so the
+ * records go out in ring order, up to one a preempted writer left unpublished. The batch the drain
+ * task was sending stays cut where it stopped.
+ */
+static void HiLogAsyncPanicDrain(void)
+{
+    uint32_t tail;
+    uint32_t size;
+    uint16_t len = 0;
+
+    for (;;) {
+        tail = __atomic_load_n(&g_hilogTail, __ATOMIC_ACQUIRE);
+        size = HiLogRecSize(tail, &len);
+        if (size == 0) {
+            break;
+        }
+        if (!(len & HILOG_REC_PAD)) {
+            uart_poll_send((const uint8_t *)(HiLogRecAt(tail) + 1), len);
+        }
+        if (!HiLogRecFree(tail, size)) {
+            break;
+        }
+    }
+}
+
+static void HiLogAsyncInit(void)
+{
+    TSK_INIT_PARAM_S stTask = {0};
+
+    if (LOS_BinarySemCreate(0, &g_hilogDataSem) != LOS_OK) {
+        return;
+    }
+    if (LOS_BinarySemCreate(0, &g_hilogSpaceSem) != LOS_OK) {
+        (void)LOS_SemDelete(g_hilogDataSem);
+        return;
+    }
+
+    stTask.pfnTaskEntry = (TSK_ENTRY_FUNC)HiLogAsyncTask;
+    stTask.uwStackSize = HILOG_ASYNC_TASK_STACKSIZE;
+    stTask.pcName = HILOG_ASYNC_TASK_NAME;
+    stTask.usTaskPrio = HILOG_ASYNC_TASK_PRIOR;
+    if (LOS_TaskCreate(&g_hilogTaskID, &stTask) != LOS_OK) {
+        (void)LOS_SemDelete(g_hilogSpaceSem);
+        (void)LOS_SemDelete(g_hilogDataSem);
+        return;
+    }
+    g_hilogReady = true;
+}
+
+void HiLogAsyncSetPolicy(HiLogAsyncPolicy policy)
+{
+    __atomic_store_n(&g_hilogPolicy, (uint32_t)policy, __ATOMIC_RELAXED);
+}
+
+void HiLogAsyncStatsGet(HiLogAsyncStats *stats, bool clear)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->records = HiLogStatTake(&g_hilogStats.records, clear);
+    stats->bytes = HiLogStatTake(&g_hilogStats.bytes, clear);
+    stats->droppedRecords = HiLogStatTake(&g_hilogStats.droppedRecords, clear);
+    stats->droppedBytes = HiLogStatTake(&g_hilogStats.droppedBytes, clear);
+    stats->blocked = HiLogStatTake(&g_hilogStats.blocked, clear);
+    stats->truncated = HiLogStatTake(&g_hilogStats.truncated, clear);
+    stats->highWater = HiLogStatTake(&g_hilogStats.highWater, clear);
+}
+
+int HiLogAsyncFlush(uint32_t timeoutMs)
+{
+    uint32_t target = __atomic_load_n(&g_hilogHead, __ATOMIC_ACQUIRE);
+    UINT64 deadline = LOS_TickCountGet() + LOS_MS2Tick(timeoutMs);
+
+    if (!g_hilogReady) {
+        return 0;
+    }
+    while ((int32_t)(__atomic_load_n(&g_hilogTail, __ATOMIC_ACQUIRE) - target) < 0 || g_hilogSending) {
+        if (!g_hilogRunning || __get_IPSR() || LOS_CurTaskIDGet() == g_hilogTaskID ||
+                LOS_TickCountGet() >= deadline) {
+            return -1;
+        }
+        (void)LOS_TaskDelay(1);
+    }
+
+    return 0;
+}
+#else
+void HiLogAsyncSetPolicy(HiLogAsyncPolicy policy)
+{
+    (void)policy;
+}
+
+void HiLogAsyncStatsGet(HiLogAsyncStats *stats, bool clear)
+{
+    (void)clear;
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+int HiLogAsyncFlush(uint32_t timeoutMs)
+{
+    (void)timeoutMs;
+    return 0;
+}
+#endif
 
 static void uart_callback(app_uart_evt_t *p_evt)
 {
@@ -74,15 +492,43 @@ void bsp_uart_send(uint8_t *p_data, uint16_t length)
     if (uart_initialized != true) {
         return;
     }
+    if (uart_in_panic()) {
+        uart_poll_send(p_data, length);
+        return;
+    }
 
     app_uart_transmit_sync(LOG_UART_ID, p_data, length, UART_TX_TIMEOUT);
 }
 
 void bsp_uart_flush(void)
 {
+    if (uart_initialized != true) {
+        return;
+    }
+    /* With interrupts masked for good, as on an assert, the drain task cannot run again. */
+    if (uart_in_panic() || __get_PRIMASK() != 0) {
+        bsp_uart_panic();
+        return;
+    }
+#if (HILOG_ASYNC_ENABLE == 1)
+    (void)HiLogAsyncFlush(UART_TX_TIMEOUT);
+#endif
     app_uart_flush(LOG_UART_ID);
 }
 
+void bsp_uart_panic(void)
+{
+    if (uart_initialized != true || uart_panic) {
+        return;
+    }
+    uart_panic = true;
+#if (HILOG_ASYNC_ENABLE == 1)
+    HiLogAsyncPanicDrain();
+#endif
+    while (!ll_uart_is_active_flag_tfe(app_uart_get_handle(LOG_UART_ID)->p_instance)) {
+    }
+}
+
 void bsp_log_init(void)
 {
     app_log_init_t  log_init;
@@ -96,6 +542,9 @@ void bsp_log_init(void)
     bsp_uart_init();
     app_log_init(&log_init, bsp_uart_send, bsp_uart_flush);
     app_assert_init();
+#if (HILOG_ASYNC_ENABLE == 1)
+    HiLogAsyncInit();
+#endif
 }
 
 int HiLogWriteInternal(const char *buffer, size_t bufLen)
@@ -113,7 +562,16 @@ int HiLogWriteInternal(const char *buffer, size_t bufLen)
     } else {
         len--;
     }
-    int ret = app_uart_transmit_sync(LOG_UART_ID, buffer, bufLen, UART_TX_TIMEOUT);
+    if (uart_initialized && uart_in_panic()) {
+        uart_poll_send((const uint8_t *)buffer, len);
+        return 0;
+    }
+#if (HILOG_ASYNC_ENABLE == 1)
+    if (g_hilogReady) {
+        return HiLogAsyncPut(buffer, len);
+    }
+#endif
+    int ret = app_uart_transmit_sync(LOG_UART_ID, buffer, len, UART_TX_TIMEOUT);
 
     return ret;
 }
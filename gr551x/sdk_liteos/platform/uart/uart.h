@@ -41,7 +41,44 @@ extern "C" {
 
 extern EVENT_CB_S g_shellInputEvent;
 
+/* What HiLogWriteInternal does when the asynchronous log ring is full. */
+typedef enum {
+    HILOG_ASYNC_DROP_NEWEST = 0,    /* discard the record being written */
+    HILOG_ASYNC_DROP_OLDEST,        /* discard queued records until it fits */
+    HILOG_ASYNC_BLOCK,              /* wait for the drain task, drop only where a task cannot wait */
+} HiLogAsyncPolicy;
+
+typedef struct {
+    uint32_t records;               /* records queued */
+    uint32_t bytes;
+    uint32_t droppedRecords;        /* by either drop policy, or a block from where no task can wait */
+    uint32_t droppedBytes;
+    uint32_t blocked;               /* writers that waited for space */
+    uint32_t truncated;             /* records cut to HILOG_ASYNC_RECORD_MAX */
+    uint32_t highWater;             /* most ring bytes in use */
+} HiLogAsyncStats;
+
+/*
+ * Ordering on the log UART. printf, APP_LOG and the shell write it at once from the calling task,
+ * while HiLog records wait in the ring for the drain task: a record queued before a printf can reach
+ * the wire after it. Call HiLogAsyncFlush first where the order matters. Records of one task keep
+ * their order. Once bsp_uart_panic has run, all of it is sent at once and in call order.
+ */
 void bsp_log_init(void);
+void HiLogAsyncSetPolicy(HiLogAsyncPolicy policy);
+/* Each counter is read and, with clear, reset in one atomic step, so none is lost to a concurrent writer. */
+void HiLogAsyncStatsGet(HiLogAsyncStats *stats, bool clear);
+
+/* Wait until every record queued so far is on the wire. 0 on success, -1 on timeout. */
+int HiLogAsyncFlush(uint32_t timeoutMs);
+
+/*
+ * Send the queued HiLog records, then everything written to the log UART from here on, by polling
+ * its TX FIFO from the caller. For the exception and assert paths, where the drain task will not run
+ * again: bsp_uart_send and HiLogWriteInternal call it from a fault handler, bsp_uart_flush (that is
+ * app_log_flush) also with interrupts masked. The batch the drain task was sending is cut short.
+ */
+void bsp_uart_panic(void);
 uint8_t UartGetc(void);
 void _putchar(char character);
 
@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "hal_flash_sim.h"
+
+#define NS_PER_US           1000
+#define US_PER_SEC          1000000
+#define POWER_LOSS_NONE     0xFFFFFFFFUL
+#define BLOCK32_SIZE        0x8000
+#define BLOCK64_SIZE        0x10000
+#define CMD_SE              0x20
+#define CMD_BE_32           0x52
+#define CMD_BE_64           0xD8
+
+/* Typical GD25/P25 class NOR figures at the XQSPI clock used by hal_flash_init. */
+static struct flash_sim_timing g_timing = {
+    .cmd_overhead_us  = 5,
+    .read_ns_per_byte = 125,
+    .page_program_us  = 700,
+    .sector_erase_us  = 45000,
+    .block32_erase_us = 160000,
+    .block64_erase_us = 250000,
+    .chip_erase_us    = 8000000,
+    .suspend_us       = 20,
+    .realtime         = false,
+};
+
+static uint8_t *g_image;
+static bool g_xip;                  /* g_image is mapped at FLASH_SIM_BASE_ADDR */
+static uint32_t *g_wear;
+static uint32_t g_size;
+static char *g_path;
+static uint32_t g_id = FLASH_SIM_DEFAULT_ID;
+static bool g_security;
+static bool g_powered = true;
+static uint32_t g_power_budget = POWER_LOSS_NONE;
+static struct flash_sim_stats g_stats;
+static uint64_t g_clock_us;
+static flash_sim_trace_t g_trace;
+static flash_sim_poll_t g_poll;
+
+/* The erase started by hal_flash_erase_run, until it is over. */
+static struct {
+    bool active;
+    bool suspended;
+    uint32_t addr;
+    uint32_t size;
+    uint64_t done_at_us;            /* while running */
+    uint64_t left_us;               /* while suspended */
+} g_erase;
+
+static void sim_trace(enum flash_sim_op op, uint32_t addr, uint32_t size)
+{
+    if (g_trace != NULL && size > 0) {
+        g_trace(op, addr, size);
+    }
+}
+
+static void sim_spend(uint64_t us)
+{
+    g_stats.time_us += us;
+    g_clock_us += us;
+    if (g_timing.realtime && us > 0) {
+        struct timespec ts = { .tv_sec = us / US_PER_SEC, .tv_nsec = (us % US_PER_SEC) * NS_PER_US };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static bool sim_range_valid(uint32_t addr, uint32_t size)
+{
+    if (g_image == NULL || !g_powered || addr < FLASH_SIM_BASE_ADDR) {
+        return false;
+    }
+    return (addr - FLASH_SIM_BASE_ADDR) <= g_size && size <= g_size - (addr - FLASH_SIM_BASE_ADDR);
+}
+
+/* An access the flash cannot serve now: everything while an erase runs, the unit itself while it is suspended. */
+static bool sim_erase_blocks(uint32_t addr, uint32_t size)
+{
+    if (!g_erase.active) {
+        return false;
+    }
+    if (g_erase.suspended && (addr >= g_erase.addr + g_erase.size || addr + size <= g_erase.addr)) {
+        return false;
+    }
+    g_stats.busy_rejects++;
+    return true;
+}
+
+/* Consume power budget, returns how many of the wanted units still complete. */
+static uint32_t sim_power_take(uint32_t wanted)
+{
+    if (g_power_budget == POWER_LOSS_NONE) {
+        return wanted;
+    }
+    if (wanted < g_power_budget) {
+        g_power_budget -= wanted;
+        return wanted;
+    }
+    wanted = g_power_budget;
+    g_power_budget = POWER_LOSS_NONE;
+    g_powered = false;
+    return wanted;
+}
+
+/* Place the image where the XIP window is on the device, NULL if that address range is taken. */
+static uint8_t *sim_xip_map(uint32_t size)
+{
+#ifdef MAP_FIXED_NOREPLACE
+    void *p = mmap((void *)FLASH_SIM_BASE_ADDR, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+    if (p != (void *)FLASH_SIM_BASE_ADDR) {
+        /* Kernels before 4.17 take the address as a hint only. */
+        munmap(p, size);
+        return NULL;
+    }
+    return p;
+#else
+    (void)size;
+    return NULL;
+#endif
+}
+
+int flash_sim_open(const char *path, uint32_t size)
+{
+    flash_sim_close();
+    if (size == 0 || size % FLASH_SIM_SECTOR_SIZE != 0) {
+        return -1;
+    }
+    g_size = size;
+    g_image = sim_xip_map(size);
+    g_xip = (g_image != NULL);
+    if (!g_xip) {
+        g_image = malloc(size);
+    }
+    g_wear = calloc(size / FLASH_SIM_SECTOR_SIZE, sizeof(uint32_t));
+    if (g_image == NULL || g_wear == NULL) {
+        flash_sim_close();
+        return -1;
+    }
+    memset(g_image, 0xFF, size);
+    if (path != NULL) {
+        FILE *fp = fopen(path, "rb");
+        if (fp != NULL) {
+            size_t len = fread(g_image, 1, size, fp);
+            (void)len;
+            fclose(fp);
+        }
+        g_path = strdup(path);
+    }
+    g_powered = true;
+    g_power_budget = POWER_LOSS_NONE;
+    memset(&g_erase, 0, sizeof(g_erase));
+    flash_sim_reset_stats();
+    return 0;
+}
+
+int flash_sim_save(void)
+{
+    if (g_image == NULL || g_path == NULL) {
+        return 0;
+    }
+    FILE *fp = fopen(g_path, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    size_t len = fwrite(g_image, 1, g_size, fp);
+    fclose(fp);
+    return (len == g_size) ? 0 : -1;
+}
+
+void flash_sim_close(void)
+{
+    (void)flash_sim_save();
+    if (g_xip) {
+        munmap(g_image, g_size);
+    } else {
+        free(g_image);
+    }
+    g_xip = false;
+    free(g_wear);
+    free(g_path);
+    g_image = NULL;
+    g_wear = NULL;
+    g_path = NULL;
+    g_size = 0;
+}
+
+void flash_sim_set_timing(const struct flash_sim_timing *timing)
+{
+    if (timing != NULL) {
+        g_timing = *timing;
+    }
+}
+
+void flash_sim_get_timing(struct flash_sim_timing *timing)
+{
+    if (timing != NULL) {
+        *timing = g_timing;
+    }
+}
+
+void flash_sim_get_stats(struct flash_sim_stats *stats)
+{
+    if (stats != NULL) {
+        *stats = g_stats;
+    }
+}
+
+void flash_sim_reset_stats(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+void flash_sim_advance(uint32_t us)
+{
+    g_clock_us += us;
+}
+
+void flash_sim_set_trace(flash_sim_trace_t trace)
+{
+    g_trace = trace;
+}
+
+void flash_sim_set_poll(flash_sim_poll_t poll)
+{
+    g_poll = poll;
+}
+
+void flash_sim_set_id(uint32_t id)
+{
+    g_id = (id != 0) ? id : FLASH_SIM_DEFAULT_ID;
+}
+
+uint32_t flash_sim_sector_wear(uint32_t addr)
+{
+    if (g_image == NULL || addr < FLASH_SIM_BASE_ADDR || addr - FLASH_SIM_BASE_ADDR >= g_size) {
+        return 0;
+    }
+    return g_wear[(addr - FLASH_SIM_BASE_ADDR) / FLASH_SIM_SECTOR_SIZE];
+}
+
+uint64_t flash_sim_clock_us(void)
+{
+    return g_clock_us;
+}
+
+bool flash_sim_xip(void)
+{
+    return g_xip;
+}
+
+uint8_t *flash_sim_image(void)
+{
+    return g_image;
+}
+
+void flash_sim_set_power_loss(uint32_t budget)
+{
+    g_power_budget = budget;
+}
+
+void flash_sim_power_on(void)
+{
+    g_powered = (g_image != NULL);
+    g_power_budget = POWER_LOSS_NONE;
+}
+
+bool flash_sim_powered(void)
+{
+    return g_powered;
+}
+
+bool hal_flash_init(void)
+{
+    if (g_image == NULL) {
+        return flash_sim_open(NULL, FLASH_SIM_DEFAULT_SIZE) == 0;
+    }
+    return true;
+}
+
+uint32_t hal_flash_read(const uint32_t addr, uint8_t *buf, const uint32_t size)
+{
+    if (buf == NULL || !sim_range_valid(addr, size) || sim_erase_blocks(addr, size)) {
+        return 0;
+    }
+    memcpy(buf, g_image + (addr - FLASH_SIM_BASE_ADDR), size);
+    sim_trace(FLASH_SIM_OP_READ, addr, size);
+    g_stats.read_ops++;
+    g_stats.read_bytes += size;
+    sim_spend(g_timing.cmd_overhead_us + ((uint64_t)size * g_timing.read_ns_per_byte) / NS_PER_US);
+    return size;
+}
+
+uint32_t hal_flash_write(const uint32_t addr, const uint8_t *buf, const uint32_t size)
+{
+    if (buf == NULL || !sim_range_valid(addr, size) || sim_erase_blocks(0, UINT32_MAX)) {
+        return 0;
+    }
+    uint32_t done = sim_power_take(size);
+    uint8_t *dst = g_image + (addr - FLASH_SIM_BASE_ADDR);
+    uint32_t pages = 0;
+    uint32_t last_page = UINT32_MAX;
+
+    for (uint32_t i = 0; i < done; i++) {
+        if ((buf[i] & ~dst[i]) != 0) {
+            g_stats.nor_violations++;
+        }
+        dst[i] &= buf[i];
+        if ((addr + i) / FLASH_SIM_PAGE_SIZE != last_page) {
+            last_page = (addr + i) / FLASH_SIM_PAGE_SIZE;
+            pages++;
+        }
+    }
+    sim_trace(FLASH_SIM_OP_WRITE, addr, done);
+    g_stats.write_ops++;
+    g_stats.write_bytes += done;
+    g_stats.program_pages += pages;
+    sim_spend(g_timing.cmd_overhead_us + (uint64_t)pages * g_timing.page_program_us);
+    return (done == size) ? size : 0;
+}
+
+uint32_t hal_flash_write_r(const uint32_t addr, const uint8_t *buf, const uint32_t size)
+{
+    if (hal_flash_write(addr, buf, size) != size) {
+        return 0;
+    }
+    /* Mirror the device implementation, which reads the range back for verification. */
+    g_stats.read_ops++;
+    g_stats.read_bytes += size;
+    sim_spend(g_timing.cmd_overhead_us + ((uint64_t)size * g_timing.read_ns_per_byte) / NS_PER_US);
+    return (memcmp(g_image + (addr - FLASH_SIM_BASE_ADDR), buf, size) == 0) ? size : 0;
+}
+
+/* Erase count sectors from first, as far as the power lasts. Returns the sectors erased. */
+static uint32_t sim_erase_sectors(uint32_t first, uint32_t count)
+{
+    uint32_t done = sim_power_take(count);
+
+    for (uint32_t i = 0; i < done; i++) {
+        memset(g_image + (first + i) * FLASH_SIM_SECTOR_SIZE, 0xFF, FLASH_SIM_SECTOR_SIZE);
+        g_wear[first + i]++;
+    }
+    if (done < count) {
+        /* An interrupted sector erase leaves the sector in an undefined, partly erased state. */
+        memset(g_image + (first + done) * FLASH_SIM_SECTOR_SIZE, 0xFF, FLASH_SIM_SECTOR_SIZE / 2);
+    }
+    sim_trace(FLASH_SIM_OP_ERASE, FLASH_SIM_BASE_ADDR + first * FLASH_SIM_SECTOR_SIZE, done * FLASH_SIM_SECTOR_SIZE);
+    g_stats.erase_ops++;
+    g_stats.erase_bytes += (uint64_t)done * FLASH_SIM_SECTOR_SIZE;
+    return done;
+}
+
+bool hal_flash_erase(const uint32_t addr, const uint32_t size)
+{
+    if (size == 0 || !sim_range_valid(addr, size) || sim_erase_blocks(0, UINT32_MAX)) {
+        return false;
+    }
+    uint32_t first = (addr - FLASH_SIM_BASE_ADDR) / FLASH_SIM_SECTOR_SIZE;
+    uint32_t last = (addr - FLASH_SIM_BASE_ADDR + size - 1) / FLASH_SIM_SECTOR_SIZE;
+    uint32_t count = last - first + 1;
+    uint32_t done = sim_erase_sectors(first, count);
+
+    /* Sector by sector, like the exflash driver behind the lib's hal_flash_erase. */
+    g_stats.erase_cmds += done;
+    sim_spend(g_timing.cmd_overhead_us + (uint64_t)done * g_timing.sector_erase_us);
+    return done == count;
+}
+
+/* Poll the status until the erase is over, or suspend it once *p_hold is set, like the device's RAM loop. */
+static uint32_t sim_erase_wait(volatile const uint32_t *p_hold)
+{
+    while (1) {
+        if (p_hold != NULL && *p_hold != 0) {
+            sim_spend(g_timing.cmd_overhead_us + g_timing.suspend_us);
+            g_erase.left_us = (g_erase.done_at_us > g_clock_us) ? g_erase.done_at_us - g_clock_us : 0;
+            g_erase.suspended = true;
+            g_stats.suspends++;
+            return HAL_FLASH_ERASE_SUSPENDED;
+        }
+        sim_spend(g_timing.cmd_overhead_us);
+        if (g_poll != NULL) {
+            g_poll(g_clock_us);
+        }
+        if (g_clock_us >= g_erase.done_at_us) {
+            g_erase.active = false;
+            return HAL_FLASH_ERASE_DONE;
+        }
+    }
+}
+
+uint32_t hal_flash_erase_run(uint8_t cmd, uint32_t addr, volatile const uint32_t *p_hold)
+{
+    uint32_t size;
+    uint32_t us;
+
+    switch (cmd) {
+        case CMD_SE:
+            size = FLASH_SIM_SECTOR_SIZE;
+            us = g_timing.sector_erase_us;
+            break;
+        case CMD_BE_32:
+            size = BLOCK32_SIZE;
+            us = g_timing.block32_erase_us;
+            break;
+        case CMD_BE_64:
+            size = BLOCK64_SIZE;
+            us = g_timing.block64_erase_us;
+            break;
+        default:
+            return HAL_FLASH_ERASE_FAILED;
+    }
+    if ((addr & (size - 1)) != 0 || !sim_range_valid(addr, size) || sim_erase_blocks(0, UINT32_MAX)) {
+        return HAL_FLASH_ERASE_FAILED;
+    }
+
+    uint32_t first = (addr - FLASH_SIM_BASE_ADDR) / FLASH_SIM_SECTOR_SIZE;
+    uint32_t count = size / FLASH_SIM_SECTOR_SIZE;
+    g_stats.erase_cmds++;
+    sim_spend(g_timing.cmd_overhead_us);
+    if (sim_erase_sectors(first, count) < count) {
+        return HAL_FLASH_ERASE_FAILED;
+    }
+    g_erase.active = true;
+    g_erase.suspended = false;
+    g_erase.addr = addr;
+    g_erase.size = size;
+    g_erase.done_at_us = g_clock_us + us;
+    return sim_erase_wait(p_hold);
+}
+
+uint32_t hal_flash_erase_continue(volatile const uint32_t *p_hold)
+{
+    if (!g_erase.active || !g_erase.suspended || !g_powered) {
+        return HAL_FLASH_ERASE_FAILED;
+    }
+    sim_spend(g_timing.cmd_overhead_us);
+    g_erase.suspended = false;
+    g_erase.done_at_us = g_clock_us + g_erase.left_us;
+    return sim_erase_wait(p_hold);
+}
+
+hal_status_t hal_flash_block_erase(uint8_t cmd, uint32_t addr)
+{
+    return (hal_flash_erase_run(cmd, addr, NULL) == HAL_FLASH_ERASE_DONE) ? HAL_OK : HAL_ERROR;
+}
+
+bool hal_flash_erase_chip(void)
+{
+    if (g_image == NULL || !g_powered || sim_erase_blocks(0, UINT32_MAX)) {
+        return false;
+    }
+    memset(g_image, 0xFF, g_size);
+    for (uint32_t i = 0; i < g_size / FLASH_SIM_SECTOR_SIZE; i++) {
+        g_wear[i]++;
+    }
+    sim_trace(FLASH_SIM_OP_ERASE, FLASH_SIM_BASE_ADDR, g_size);
+    g_stats.erase_ops++;
+    g_stats.erase_bytes += g_size;
+    sim_spend(g_timing.chip_erase_us);
+    return true;
+}
+
+void hal_flash_get_info(uint32_t *id, uint32_t *size)
+{
+    if (id == NULL || size == NULL) {
+        return;
+    }
+
+    *id   = g_id;
+    *size = g_size;
+}
+
+uint32_t hal_flash_sector_size(void)
+{
+    return FLASH_SIM_SECTOR_SIZE;
+}
+
+void hal_flash_set_security(bool enable)
+{
+    /* The image is kept in plain text, the flag is only reported back. */
+    g_security = enable;
+}
+
+bool hal_flash_get_security(void)
+{
+    return g_security;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host-side implementation of the hal_flash API (libraries/hal_flash/hal_flash.h) on a RAM or
+ * file-backed image. It models NOR programming (bits only go 1 -> 0), page-program and
+ * sector-erase latency, per-sector wear and power loss, so flash users such as the littlefs glue,
+ * app_log_store and hal_file can be run and measured on a PC.
+ *
+ * Build it together with the code under test, e.g.
+ *     gcc -Itools/flash_sim hal_flash_sim.c <sources> -o <target>
+ * or link libflash_sim.a from the Makefile next to this file. "make test" runs the simulator's
+ * own tests in test/.
+ */
+#ifndef __HAL_FLASH_SIM_H__
+#define __HAL_FLASH_SIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_SIM_BASE_ADDR         0x01000000UL    /* EXFLASH_START_ADDR */
+#define FLASH_SIM_PAGE_SIZE         256             /* EXFLASH_SIZE_PAGE_BYTES */
+#define FLASH_SIM_SECTOR_SIZE       4096            /* EXFLASH_SIZE_SECTOR_BYTES */
+#define FLASH_SIM_DEFAULT_SIZE      0x00800000UL
+#define FLASH_SIM_DEFAULT_ID        0x001765C8
+
+/* gr55xx_hal.h */
+typedef enum {
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U,
+} hal_status_t;
+
+struct flash_sim_timing {
+    uint32_t cmd_overhead_us;       /* lock + QSPI command setup per hal_flash_* call */
+    uint32_t read_ns_per_byte;
+    uint32_t page_program_us;
+    uint32_t sector_erase_us;
+    uint32_t block32_erase_us;      /* 32 KB block erase, see hal_flash_erase_run */
+    uint32_t block64_erase_us;
+    uint32_t chip_erase_us;
+    uint32_t suspend_us;            /* tSUS, from the erase suspend command until the flash can be read */
+    bool     realtime;              /* also sleep for the modelled time */
+};
+
+struct flash_sim_stats {
+    uint64_t time_us;               /* modelled flash busy time */
+    uint32_t read_ops;
+    uint32_t write_ops;
+    uint32_t erase_ops;
+    uint32_t erase_cmds;            /* sector and block erase commands issued */
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t erase_bytes;
+    uint32_t program_pages;
+    uint32_t nor_violations;        /* programs that tried to flip a 0 bit back to 1 */
+    uint32_t suspends;              /* erases suspended by hal_flash_erase_run/continue */
+    uint32_t busy_rejects;          /* accesses refused because an erase was running */
+};
+
+enum flash_sim_op {
+    FLASH_SIM_OP_READ,
+    FLASH_SIM_OP_WRITE,
+    FLASH_SIM_OP_ERASE,
+};
+
+/* Called for every read, write and erase that reached the image, in issue order. */
+typedef void (*flash_sim_trace_t)(enum flash_sim_op op, uint32_t addr, uint32_t size);
+
+/* Called after every status poll of an erase wait, with the modelled time: the points where interrupt
+ * handlers run on the device while hal_flash_erase_run waits. */
+typedef void (*flash_sim_poll_t)(uint64_t now_us);
+
+/* Create a flash of size bytes. path == NULL keeps the image in RAM, otherwise it is loaded
+ * from and saved back to path. Returns 0 on success. */
+int flash_sim_open(const char *path, uint32_t size);
+void flash_sim_close(void);
+/* Write the image back to its file, if any. */
+int flash_sim_save(void);
+
+void flash_sim_set_timing(const struct flash_sim_timing *timing);
+void flash_sim_get_timing(struct flash_sim_timing *timing);
+void flash_sim_get_stats(struct flash_sim_stats *stats);
+void flash_sim_reset_stats(void);
+/* Modelled time since the program started, never reset: a clock for latency measurements. */
+uint64_t flash_sim_clock_us(void);
+/* Let us of modelled time pass without flash activity, e.g. for work done while an erase is suspended. */
+void flash_sim_advance(uint32_t us);
+/* Install a trace callback, NULL removes it. */
+void flash_sim_set_trace(flash_sim_trace_t trace);
+/* Install an erase poll callback, NULL removes it. */
+void flash_sim_set_poll(flash_sim_poll_t poll);
+/* JEDEC ID reported by hal_flash_get_info, 0 restores FLASH_SIM_DEFAULT_ID (a GigaDevice part). */
+void flash_sim_set_id(uint32_t id);
+/* Erase count of the sector holding addr. */
+uint32_t flash_sim_sector_wear(uint32_t addr);
+/* Direct access to the image, e.g. to preload or inspect content. */
+uint8_t *flash_sim_image(void);
+/* True when the image sits at FLASH_SIM_BASE_ADDR like the XIP window, so code that reads flash
+ * through XIP pointers works on it unchanged. */
+bool flash_sim_xip(void);
+
+/* Cut the power after the given number of programmed bytes plus erased sectors. The operation in
+ * flight is left partially applied and every later call fails until flash_sim_power_on(). */
+void flash_sim_set_power_loss(uint32_t budget);
+void flash_sim_power_on(void);
+bool flash_sim_powered(void);
+
+/* hal_flash API, same prototypes as libraries/hal_flash/hal_flash.h. */
+bool hal_flash_init(void);
+uint32_t hal_flash_read(const uint32_t addr, uint8_t *buf, const uint32_t size);
+uint32_t hal_flash_write(const uint32_t addr, const uint8_t *buf, const uint32_t size);
+uint32_t hal_flash_write_r(const uint32_t addr, const uint8_t *buf, const uint32_t size);
+bool hal_flash_erase(const uint32_t addr, const uint32_t size);
+bool hal_flash_erase_chip(void);
+void hal_flash_get_info(uint32_t *id, uint32_t *size);
+uint32_t hal_flash_sector_size(void);
+void hal_flash_set_security(bool enable);
+bool hal_flash_get_security(void);
+
+/* Erase commands, same prototypes as libraries/hal_flash/hal_exflash_user_operation.h. While an erase
+ * runs, reads, writes and erases fail; while it is suspended only the unit being erased is unreadable. */
+#define HAL_FLASH_ERASE_DONE        0
+#define HAL_FLASH_ERASE_SUSPENDED   1
+#define HAL_FLASH_ERASE_FAILED      2
+
+uint32_t hal_flash_erase_run(uint8_t cmd, uint32_t addr, volatile const uint32_t *p_hold);
+uint32_t hal_flash_erase_continue(volatile const uint32_t *p_hold);
+hal_status_t hal_flash_block_erase(uint8_t cmd, uint32_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,611 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spi_nor_model.h"
+
+#define NS_PER_US           1000ULL
+#define NS_PER_S            1000000000ULL
+#define CMD_CLOCKS          8
+#define SFDP_DUMMY          8
+#define FREAD_DUMMY         8
+#define MODE_CLOCKS_QUAD    2
+#define RESET_NS            30000ULL
+#define SUSPEND_NS          20000ULL
+
+#define SR1_WIP             0x01
+#define SR1_WEL             0x02
+#define SR1_QE_MXIC         0x40
+#define SR1_WRITABLE        0xFC
+#define SR2_QE              0x02
+#define SR2_QE_BIT7         0x80
+#define SR2_WRITABLE        0x7F
+#define MODE_CONTINUOUS(m)  (((m) & 0x30) == 0x20)
+
+#define SECTOR_SIZE         0x1000
+#define BLOCK32_SIZE        0x8000
+#define BLOCK64_SIZE        0x10000
+
+static struct {
+    struct spi_nor_part  part;
+    uint8_t             *image;
+    uint8_t              sr1;
+    uint8_t              sr2;
+    uint64_t             now_ns;
+    uint64_t             busy_until_ns;
+    uint64_t             suspended_left_ns;
+    bool                 suspended;
+    bool                 rsten;
+    bool                 continuous;
+    bool                 addr4;
+    uint32_t             sclk_hz;
+    uint32_t             overhead_ns;
+    struct spi_nor_stats stats;
+    spi_nor_trace_t      trace;
+} g_nor = {
+    .sclk_hz     = 8000000,
+    .overhead_ns = 2000,
+};
+
+static void Violation(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (g_nor.stats.violations++ == 0) {
+        va_start(ap, fmt);
+        vsnprintf(g_nor.stats.reason, sizeof(g_nor.stats.reason), fmt, ap);
+        va_end(ap);
+    }
+}
+
+static bool QeSet(void)
+{
+    switch (g_nor.part.qe) {
+        case SPI_NOR_QE_NONE:
+            return true;
+        case SPI_NOR_QE_SR1_BIT6:
+            return (g_nor.sr1 & SR1_QE_MXIC) != 0;
+        case SPI_NOR_QE_SR2_BIT7:
+            return (g_nor.sr2 & SR2_QE_BIT7) != 0;
+        default:
+            return (g_nor.sr2 & SR2_QE) != 0;
+    }
+}
+
+void spi_nor_part_default(struct spi_nor_part *part, enum spi_nor_qe qe)
+{
+    static const uint32_t ids[] = {
+        [SPI_NOR_QE_NONE]      = 0x204014,  /* Micron: no QE bit */
+        [SPI_NOR_QE_SR2_WRSR1] = 0xC84014,  /* GigaDevice GD25Q80 */
+        [SPI_NOR_QE_SR2_WRSR]  = 0xEF4014,  /* Winbond W25Q80BV, before 0x31 */
+        [SPI_NOR_QE_SR1_BIT6]  = 0xC22014,  /* Macronix MX25L8006 */
+        [SPI_NOR_QE_SR2_BIT7]  = 0xBF2614,  /* SR2 bit 7 type */
+    };
+
+    memset(part, 0, sizeof(*part));
+    part->jedec_id         = ids[qe];
+    part->size             = 0x100000;
+    part->qe               = qe;
+    part->read_144_dummy   = 4;
+    part->read_114_dummy   = 8;
+    part->suspend_cmd      = 0x75;
+    part->resume_cmd       = 0x7A;
+    part->write_status_us  = 10000;
+    part->page_program_us  = 700;
+    part->sector_erase_us  = 45000;
+    part->block32_erase_us = 160000;
+    part->block64_erase_us = 250000;
+    part->chip_erase_us    = 8000000;
+}
+
+int spi_nor_open(const struct spi_nor_part *part)
+{
+    spi_nor_close();
+    g_nor.part = *part;
+    g_nor.image = malloc(part->size);
+    if (g_nor.image == NULL) {
+        return -1;
+    }
+    memset(g_nor.image, 0xFF, part->size);
+    g_nor.sr1 = 0;
+    g_nor.sr2 = 0;
+    spi_nor_power_cycle();
+    spi_nor_reset_stats();
+    return 0;
+}
+
+void spi_nor_close(void)
+{
+    free(g_nor.image);
+    g_nor.image = NULL;
+}
+
+void spi_nor_power_cycle(void)
+{
+    g_nor.sr1 &= ~(SR1_WIP | SR1_WEL);
+    g_nor.busy_until_ns = g_nor.now_ns;
+    g_nor.suspended = false;
+    g_nor.rsten = false;
+    g_nor.continuous = false;
+    g_nor.addr4 = (g_nor.part.addr == SPI_NOR_ADDR_4);
+}
+
+uint8_t *spi_nor_image(void)
+{
+    return g_nor.image;
+}
+
+void spi_nor_set_bus(uint32_t sclk_hz, uint32_t xfer_overhead_ns)
+{
+    g_nor.sclk_hz = sclk_hz;
+    g_nor.overhead_ns = xfer_overhead_ns;
+}
+
+uint64_t spi_nor_now_ns(void)
+{
+    return g_nor.now_ns;
+}
+
+void spi_nor_advance_ns(uint64_t ns)
+{
+    g_nor.now_ns += ns;
+}
+
+bool spi_nor_busy(void)
+{
+    return !g_nor.suspended && g_nor.now_ns < g_nor.busy_until_ns;
+}
+
+uint8_t spi_nor_sr(int reg)
+{
+    return (reg == 1) ? (uint8_t)(g_nor.sr1 | (spi_nor_busy() ? SR1_WIP : 0)) : g_nor.sr2;
+}
+
+void spi_nor_set_trace(spi_nor_trace_t trace)
+{
+    g_nor.trace = trace;
+}
+
+void spi_nor_get_stats(struct spi_nor_stats *stats)
+{
+    *stats = g_nor.stats;
+}
+
+void spi_nor_reset_stats(void)
+{
+    memset(&g_nor.stats, 0, sizeof(g_nor.stats));
+}
+
+static uint64_t BusNs(const struct spi_nor_op *op)
+{
+    uint64_t clocks = CMD_CLOCKS + op->dummy_clocks;
+
+    if (op->addr_bits != 0) {
+        clocks += op->addr_bits / (op->addr_lines ? op->addr_lines : 1);
+    }
+    clocks += (uint64_t)op->len * 8 / (op->data_lines ? op->data_lines : 1);
+    return clocks * NS_PER_S / g_nor.sclk_hz + g_nor.overhead_ns;
+}
+
+static void FillRx(const struct spi_nor_op *op, uint8_t value)
+{
+    if (op->rx != NULL) {
+        memset(op->rx, value, op->len);
+    }
+}
+
+static void ReadArray(uint32_t addr, const struct spi_nor_op *op)
+{
+    for (uint32_t i = 0; op->rx != NULL && i < op->len; i++) {
+        op->rx[i] = g_nor.image[(addr + i) % g_nor.part.size];
+    }
+    g_nor.stats.read_bytes += op->len;
+}
+
+/* SFDP is always read with 3 address bytes. */
+static uint8_t AddrBits(uint8_t cmd)
+{
+    return (g_nor.addr4 && cmd != 0x5A) ? 32 : 24;
+}
+
+/* Address, lines and dummy clocks as the part expects them for instruction op->cmd. */
+static bool Expect(const struct spi_nor_op *op, uint8_t addr_lines, uint8_t dummy, uint8_t data_lines)
+{
+    if (op->addr_bits != AddrBits(op->cmd) || op->addr_lines != addr_lines || op->dummy_clocks != dummy ||
+        op->data_lines != data_lines) {
+        Violation("0x%02X: %u-bit address on %u lines, %u dummy, data on %u lines", op->cmd, op->addr_bits,
+                  op->addr_lines, op->dummy_clocks, op->data_lines);
+        FillRx(op, 0xFF);
+        return false;
+    }
+    return true;
+}
+
+/* Quad phases need QE, and IO2/IO3 driven by the controller rather than held as WP#/HOLD#. */
+static bool QuadOk(const struct spi_nor_op *op)
+{
+    if (op->addr_lines != 4 && op->data_lines != 4) {
+        return true;
+    }
+    if (!QeSet()) {
+        Violation("0x%02X: quad phase with QE clear", op->cmd);
+    } else if (!op->io23_driven) {
+        Violation("0x%02X: quad phase with IO2/IO3 held as GPIO", op->cmd);
+    } else {
+        return true;
+    }
+    FillRx(op, 0xFF);
+    return false;
+}
+
+static bool TakeWel(const struct spi_nor_op *op)
+{
+    if ((g_nor.sr1 & SR1_WEL) == 0) {
+        Violation("0x%02X without WREN", op->cmd);
+        return false;
+    }
+    g_nor.sr1 &= ~SR1_WEL;
+    return true;
+}
+
+static void Busy(uint64_t end_ns, uint32_t us)
+{
+    g_nor.busy_until_ns = end_ns + us * NS_PER_US;
+}
+
+static void Program(const struct spi_nor_op *op, uint64_t end_ns)
+{
+    uint32_t page = op->addr & ~(uint32_t)(SPI_NOR_PAGE_SIZE - 1);
+    uint32_t off = op->addr & (SPI_NOR_PAGE_SIZE - 1);
+
+    if (!TakeWel(op) || op->tx == NULL) {
+        return;
+    }
+    if (off + op->len > SPI_NOR_PAGE_SIZE) {
+        Violation("0x%02X at 0x%06X: %u bytes wrap in the page", op->cmd, op->addr, op->len);
+    }
+    for (uint32_t i = 0; i < op->len; i++) {
+        g_nor.image[(page + (off + i) % SPI_NOR_PAGE_SIZE) % g_nor.part.size] &= op->tx[i];
+    }
+    g_nor.stats.program_bytes += op->len;
+    Busy(end_ns, g_nor.part.page_program_us);
+}
+
+static void Erase(const struct spi_nor_op *op, uint32_t size, uint32_t us, uint64_t end_ns)
+{
+    uint32_t base = (op->addr & ~(size - 1)) % g_nor.part.size;
+
+    if (!TakeWel(op)) {
+        return;
+    }
+    memset(g_nor.image + base, 0xFF, size);
+    g_nor.stats.erases++;
+    Busy(end_ns, us);
+}
+
+static void WriteStatus(const struct spi_nor_op *op, int reg, uint64_t end_ns)
+{
+    if (op->tx == NULL || op->len == 0 || !TakeWel(op)) {
+        return;
+    }
+    if (reg == 1) {
+        g_nor.sr1 = (g_nor.sr1 & ~SR1_WRITABLE) | (op->tx[0] & SR1_WRITABLE);
+        if (op->len > 1) {
+            g_nor.sr2 = op->tx[1] & SR2_WRITABLE;
+        } else if (g_nor.part.qe == SPI_NOR_QE_SR2_WRSR) {
+            /* JESD216 QER 001b: a one byte 0x01 clears SR2. */
+            g_nor.sr2 = 0;
+        }
+    } else {
+        g_nor.sr2 = op->tx[0] & ((g_nor.part.qe == SPI_NOR_QE_SR2_BIT7) ? SR2_QE_BIT7 : SR2_WRITABLE);
+    }
+    Busy(end_ns, g_nor.part.write_status_us);
+}
+
+/* 0xEB: the mode byte follows the address as one more byte, or is left to dummy clocks. */
+static void ReadQuadIo(const struct spi_nor_op *op)
+{
+    uint32_t addr = op->addr;
+    uint8_t dummy = g_nor.part.read_144_dummy;
+
+    if (op->addr_lines != 4 || op->data_lines != 4) {
+        Violation("0xEB: address on %u lines, data on %u lines", op->addr_lines, op->data_lines);
+        FillRx(op, 0xFF);
+        return;
+    }
+    if (op->addr_bits == AddrBits(op->cmd) + 8) {
+        addr = op->addr >> 8;
+        if (MODE_CONTINUOUS(op->addr & 0xFF)) {
+            g_nor.continuous = true;
+        }
+    } else if (op->addr_bits == AddrBits(op->cmd)) {
+        dummy += MODE_CLOCKS_QUAD;
+        Violation("0xEB: mode bits left to dummy clocks");
+    }
+    if (op->dummy_clocks != dummy) {
+        Violation("0xEB: %u dummy clocks, the part needs %u", op->dummy_clocks, dummy);
+        FillRx(op, 0xFF);
+        return;
+    }
+    if (QuadOk(op)) {
+        ReadArray(addr, op);
+    }
+}
+
+static void ReadStatus(const struct spi_nor_op *op, uint8_t value)
+{
+    FillRx(op, value);
+}
+
+static bool TakenWhileBusy(uint8_t cmd)
+{
+    if (cmd == g_nor.part.suspend_cmd) {
+        return true;
+    }
+    switch (cmd) {
+        case 0x05: /* RDSR */
+        case 0x35: /* RDSR2 */
+        case 0x3F:
+        case 0x66:
+        case 0x99:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void Run(const struct spi_nor_op *op, uint64_t end_ns)
+{
+    bool bit7 = (g_nor.part.qe == SPI_NOR_QE_SR2_BIT7);
+    /* 0x35 reads SR2 only where QE lives there; elsewhere it is another command or nothing. */
+    bool sr2 = (g_nor.part.qe == SPI_NOR_QE_SR2_WRSR1 || g_nor.part.qe == SPI_NOR_QE_SR2_WRSR);
+
+    if (g_nor.continuous) {
+        Violation("0x%02X: the part is in continuous read and takes it as address", op->cmd);
+        g_nor.continuous = false;
+        FillRx(op, 0xFF);
+        return;
+    }
+    if (op->cmd != 0x99) {
+        g_nor.rsten = (op->cmd == 0x66);
+    }
+    if (spi_nor_busy() && !TakenWhileBusy(op->cmd)) {
+        Violation("0x%02X while WIP", op->cmd);
+        FillRx(op, 0xFF);
+        return;
+    }
+    if (op->cmd == g_nor.part.suspend_cmd) {
+        if (spi_nor_busy()) {
+            g_nor.suspended_left_ns = g_nor.busy_until_ns - g_nor.now_ns;
+            g_nor.busy_until_ns = end_ns + SUSPEND_NS;
+            g_nor.now_ns = g_nor.busy_until_ns;
+            g_nor.suspended = true;
+        }
+        return;
+    }
+    if (op->cmd == g_nor.part.resume_cmd) {
+        if (g_nor.suspended) {
+            g_nor.suspended = false;
+            g_nor.busy_until_ns = end_ns + g_nor.suspended_left_ns;
+        }
+        return;
+    }
+    switch (op->cmd) {
+        case 0x06:
+            g_nor.sr1 |= SR1_WEL;
+            break;
+        case 0x04:
+            g_nor.sr1 &= ~SR1_WEL;
+            break;
+        case 0x05:
+            ReadStatus(op, spi_nor_sr(1));
+            break;
+        case 0x35:
+            if (!sr2) {
+                g_nor.stats.unknown++;
+                FillRx(op, 0xFF);
+            } else {
+                ReadStatus(op, g_nor.sr2);
+            }
+            break;
+        case 0x3F:
+            if (!bit7) {
+                g_nor.stats.unknown++;
+                FillRx(op, 0xFF);
+            } else {
+                ReadStatus(op, g_nor.sr2);
+            }
+            break;
+        case 0x01:
+            WriteStatus(op, 1, end_ns);
+            break;
+        case 0x31:
+            if (g_nor.part.qe != SPI_NOR_QE_SR2_WRSR1) {
+                g_nor.stats.unknown++;
+            } else {
+                WriteStatus(op, 2, end_ns);
+            }
+            break;
+        case 0x3E:
+            if (!bit7) {
+                g_nor.stats.unknown++;
+            } else {
+                WriteStatus(op, 2, end_ns);
+            }
+            break;
+        case 0x03:
+            if (Expect(op, 1, 0, 1)) {
+                ReadArray(op->addr, op);
+            }
+            break;
+        case 0x0B:
+            if (Expect(op, 1, FREAD_DUMMY, 1)) {
+                ReadArray(op->addr, op);
+            }
+            break;
+        case 0x6B:
+            if (Expect(op, 1, g_nor.part.read_114_dummy, 4) && QuadOk(op)) {
+                ReadArray(op->addr, op);
+            }
+            break;
+        case 0xEB:
+            ReadQuadIo(op);
+            break;
+        case 0x02:
+            if (Expect(op, 1, 0, 1)) {
+                Program(op, end_ns);
+            }
+            break;
+        case 0x32:
+            if (Expect(op, 1, 0, 4) && QuadOk(op)) {
+                Program(op, end_ns);
+            }
+            break;
+        case 0x20:
+            Erase(op, SECTOR_SIZE, g_nor.part.sector_erase_us, end_ns);
+            break;
+        case 0x52:
+            Erase(op, BLOCK32_SIZE, g_nor.part.block32_erase_us, end_ns);
+            break;
+        case 0xD8:
+            Erase(op, BLOCK64_SIZE, g_nor.part.block64_erase_us, end_ns);
+            break;
+        case 0x60:
+        case 0xC7:
+            if (TakeWel(op)) {
+                memset(g_nor.image, 0xFF, g_nor.part.size);
+                g_nor.stats.erases++;
+                Busy(end_ns, g_nor.part.chip_erase_us);
+            }
+            break;
+        case 0x9F:
+            for (uint32_t i = 0; op->rx != NULL && i < op->len; i++) {
+                op->rx[i] = (i < 3) ? (uint8_t)(g_nor.part.jedec_id >> (16 - 8 * i)) : 0xFF;
+            }
+            break;
+        case 0x5A:
+            if (Expect(op, 1, SFDP_DUMMY, 1)) {
+                for (uint32_t i = 0; op->rx != NULL && i < op->len; i++) {
+                    uint32_t at = op->addr + i;
+                    op->rx[i] = (g_nor.part.sfdp != NULL && at < g_nor.part.sfdp_len) ? g_nor.part.sfdp[at] : 0xFF;
+                }
+            }
+            break;
+        case 0x66:
+            break;
+        case 0x99:
+            if (g_nor.rsten) {
+                g_nor.rsten = false;
+                g_nor.sr1 &= ~SR1_WEL;
+                g_nor.suspended = false;
+                g_nor.addr4 = (g_nor.part.addr == SPI_NOR_ADDR_4);
+                g_nor.busy_until_ns = end_ns + RESET_NS;
+            }
+            break;
+        case 0xB7:
+        case 0xE9:
+            if (g_nor.part.addr != SPI_NOR_ADDR_3_OR_4) {
+                g_nor.stats.unknown++;
+            } else {
+                g_nor.addr4 = (op->cmd == 0xB7);
+            }
+            break;
+        case 0xB9:
+        case 0xAB:
+        case 0xFF:
+            break;
+        default:
+            g_nor.stats.unknown++;
+            FillRx(op, 0xFF);
+            break;
+    }
+}
+
+uint64_t spi_nor_xfer(const struct spi_nor_op *op)
+{
+    uint64_t ns = BusNs(op);
+
+    g_nor.stats.ops++;
+    g_nor.stats.cmds[op->cmd]++;
+    g_nor.stats.bus_ns += ns;
+    if (g_nor.trace != NULL) {
+        g_nor.trace(op);
+    }
+    Run(op, g_nor.now_ns + ns);
+    return ns;
+}
+
+/* Address and dummy bytes of the single-line instructions sent as raw frames. */
+static void FrameLayout(uint8_t cmd, uint32_t *p_addr, uint32_t *p_dummy)
+{
+    *p_addr = 0;
+    *p_dummy = 0;
+    switch (cmd) {
+        case 0x0B:
+        case 0x5A:
+            *p_dummy = 1;
+            /* fall through */
+        case 0x03:
+        case 0x02:
+        case 0x20:
+        case 0x52:
+        case 0xD8:
+            *p_addr = AddrBits(cmd) / 8;
+            break;
+        default:
+            break;
+    }
+}
+
+uint64_t spi_nor_frame(const uint8_t *tx, uint32_t tx_len, uint8_t *rx, uint32_t rx_len)
+{
+    struct spi_nor_op op = {
+        .addr_lines  = 1,
+        .data_lines  = 1,
+        .io23_driven = true,
+    };
+    uint32_t addr_bytes;
+    uint32_t dummy_bytes;
+
+    if (tx == NULL || tx_len == 0) {
+        return 0;
+    }
+    op.cmd = tx[0];
+    FrameLayout(op.cmd, &addr_bytes, &dummy_bytes);
+    if (tx_len < 1 + addr_bytes + dummy_bytes) {
+        Violation("0x%02X: frame of %u bytes", op.cmd, tx_len);
+        return spi_nor_xfer(&(struct spi_nor_op){ .cmd = 0xFF, .data_lines = 1 });
+    }
+    for (uint32_t i = 0; i < addr_bytes; i++) {
+        op.addr = (op.addr << 8) | tx[1 + i];
+    }
+    op.addr_bits = (uint8_t)(addr_bytes * 8);
+    op.dummy_clocks = (uint8_t)(dummy_bytes * 8);
+    tx += 1 + addr_bytes + dummy_bytes;
+    tx_len -= 1 + addr_bytes + dummy_bytes;
+    if (rx_len != 0) {
+        op.rx = rx;
+        op.len = rx_len;
+        /* Bytes clocked out before the read count as dummy clocks. */
+        op.dummy_clocks += (uint8_t)(tx_len * 8);
+    } else {
+        op.tx = tx;
+        op.len = tx_len;
+    }
+    return spi_nor_xfer(&op);
+}
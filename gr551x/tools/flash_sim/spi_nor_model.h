@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Command-level model of an external SPI NOR flash, as driven by drivers_ext/gr551x/gr551x_spi_flash.c
+ * through app_qspi/app_spi. Where hal_flash_sim.c models the on-chip flash behind the hal_flash API,
+ * this one sits on the other side of the bus: each transaction comes in as instruction, address,
+ * dummy clocks and data with the number of lines used for each phase, and is checked against the
+ * part's protocol the way the silicon would take it:
+ *
+ *   - status registers SR1/SR2 with WIP, WEL and the QE bit in one of the JESD216 locations;
+ *   - quad phases only work with QE set and IO2/IO3 driven by the controller;
+ *   - 0xEB mode bits: a mode byte with M5-4 = 10b enters continuous read, and mode clocks
+ *     left as dummy cycles leave the bits undefined;
+ *   - program and erase need WEL, program wraps inside the page, bits only go 1 -> 0;
+ *   - nothing but status reads, suspend and reset is taken while WIP is set;
+ *   - 3 or 4 address bytes, per part and, where it has both, per 0xB7/0xE9 mode;
+ *   - an SFDP table served from 0x5A when one is given.
+ *
+ * Anything the part would ignore or corrupt is counted as a violation with its reason, so a test
+ * can require zero. The bus time of each transaction is computed from the clock count at the
+ * configured SCLK plus a fixed per-transfer overhead, on the model's own clock.
+ */
+#ifndef __SPI_NOR_MODEL_H__
+#define __SPI_NOR_MODEL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPI_NOR_PAGE_SIZE           256
+#define SPI_NOR_REASON_LEN          96
+
+/* Where the part keeps its quad enable bit, and how it is written. */
+enum spi_nor_qe {
+    SPI_NOR_QE_NONE,                /* quad commands always work */
+    SPI_NOR_QE_SR2_WRSR1,           /* SR2 bit 1, 0x31 writes SR2, 0x01 takes SR1 and SR2 */
+    SPI_NOR_QE_SR2_WRSR,            /* SR2 bit 1, no 0x31: only 0x01 with both registers */
+    SPI_NOR_QE_SR1_BIT6,            /* Macronix: SR1 bit 6 through 0x01 */
+    SPI_NOR_QE_SR2_BIT7,            /* SR2 bit 7 through 0x3E/0x3F */
+};
+
+/* Address bytes the part takes, JESD216 BFPT DWORD 1 bits 18:17. */
+enum spi_nor_addr {
+    SPI_NOR_ADDR_3,                 /* 3 bytes only */
+    SPI_NOR_ADDR_3_OR_4,            /* 3 bytes until 0xB7, back with 0xE9, reset or power cycle */
+    SPI_NOR_ADDR_4,                 /* 4 bytes only */
+};
+
+struct spi_nor_part {
+    uint32_t        jedec_id;       /* RDID bytes, manufacturer in bits 23:16 */
+    uint32_t        size;
+    enum spi_nor_qe qe;
+    enum spi_nor_addr addr;
+    uint8_t         read_144_dummy; /* wait clocks after the 0xEB mode byte */
+    uint8_t         read_114_dummy; /* wait clocks after the 0x6B address */
+    uint8_t         suspend_cmd;    /* erase/program suspend, 0x75 or Macronix 0xB0 */
+    uint8_t         resume_cmd;
+    const uint8_t  *sfdp;           /* served by 0x5A, NULL reads 0xFF */
+    uint32_t        sfdp_len;
+    uint32_t        write_status_us;
+    uint32_t        page_program_us;
+    uint32_t        sector_erase_us;
+    uint32_t        block32_erase_us;
+    uint32_t        block64_erase_us;
+    uint32_t        chip_erase_us;
+};
+
+/* One bus transaction. Lines are 1 or 4; address and data phases may be empty. */
+struct spi_nor_op {
+    uint8_t         cmd;
+    uint8_t         addr_bits;      /* 0, 24 or 32 as clocked out, mode byte included */
+    uint8_t         addr_lines;
+    uint32_t        addr;
+    uint8_t         dummy_clocks;
+    uint8_t         data_lines;
+    const uint8_t  *tx;             /* data sent to the flash, or NULL */
+    uint8_t        *rx;             /* data read from the flash, or NULL */
+    uint32_t        len;
+    bool            io23_driven;    /* IO2/IO3 belong to the controller, not held as GPIO */
+};
+
+struct spi_nor_stats {
+    uint32_t        ops;
+    uint32_t        cmds[256];      /* transactions per instruction */
+    uint32_t        unknown;        /* instructions the part does not have, ignored */
+    uint32_t        violations;
+    char            reason[SPI_NOR_REASON_LEN];  /* the first violation */
+    uint64_t        bus_ns;         /* time the bus was busy */
+    uint64_t        read_bytes;
+    uint64_t        program_bytes;
+    uint32_t        erases;
+};
+
+typedef void (*spi_nor_trace_t)(const struct spi_nor_op *op);
+
+/* A GigaDevice-like 1 MB part with QE in SR2, 0x31 and SFDP-less defaults for the given QE type. */
+void spi_nor_part_default(struct spi_nor_part *part, enum spi_nor_qe qe);
+/* Power up with an erased array and all status bits clear. */
+int spi_nor_open(const struct spi_nor_part *part);
+void spi_nor_close(void);
+/* Power down and up again: the array and the non-volatile status bits (QE) stay. */
+void spi_nor_power_cycle(void);
+uint8_t *spi_nor_image(void);
+/* SCLK in Hz and the fixed cost of one transfer (DMA setup, interrupt) in ns. */
+void spi_nor_set_bus(uint32_t sclk_hz, uint32_t xfer_overhead_ns);
+
+/*
+ * Run one structured transaction at the model's current time and return how long it holds the
+ * bus, in ns; the caller advances the clock once it is over. spi_nor_frame runs a single-line
+ * transaction given as the raw bytes clocked out (instruction, address, dummy bytes, data)
+ * followed by rx_len bytes clocked in, as SPIM and app_qspi_transmit send them.
+ */
+uint64_t spi_nor_xfer(const struct spi_nor_op *op);
+uint64_t spi_nor_frame(const uint8_t *tx, uint32_t tx_len, uint8_t *rx, uint32_t rx_len);
+
+uint64_t spi_nor_now_ns(void);
+void spi_nor_advance_ns(uint64_t ns);
+bool spi_nor_busy(void);
+uint8_t spi_nor_sr(int reg);        /* 1 or 2; 2 is the 0x3F register on SPI_NOR_QE_SR2_BIT7 parts */
+
+void spi_nor_set_trace(spi_nor_trace_t trace);
+void spi_nor_get_stats(struct spi_nor_stats *stats);
+void spi_nor_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Checks the NOR, timing and power loss model the host tests of flash users rely on. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hal_flash_sim.h"
+
+#define SIM_SIZE            0x20000UL
+
+static int g_failed;
+
+#define CHECK(cond) do {                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            g_failed++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static void test_nor_program(void)
+{
+    uint8_t buf[FLASH_SIM_PAGE_SIZE];
+    uint8_t rd[FLASH_SIM_PAGE_SIZE];
+    struct flash_sim_stats stats;
+
+    CHECK(flash_sim_open(NULL, SIM_SIZE) == 0);
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR, rd, sizeof(rd)) == sizeof(rd));
+    for (uint32_t i = 0; i < sizeof(rd); i++) {
+        CHECK(rd[i] == 0xFF);
+    }
+
+    memset(buf, 0x0F, sizeof(buf));
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    memset(buf, 0xF3, sizeof(buf));
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR, rd, sizeof(rd)) == sizeof(rd));
+    CHECK(rd[0] == 0x03);
+
+    flash_sim_get_stats(&stats);
+    CHECK(stats.nor_violations == sizeof(buf));
+    CHECK(stats.write_ops == 2);
+    CHECK(stats.program_pages == 2);
+
+    /* A write that straddles a page boundary programs two pages. */
+    flash_sim_reset_stats();
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE - 8, buf, 16) == 16);
+    flash_sim_get_stats(&stats);
+    CHECK(stats.program_pages == 2);
+
+    CHECK(hal_flash_write_r(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE * 2, buf, 16) == 16);
+    CHECK(hal_flash_write_r(FLASH_SIM_BASE_ADDR, buf + 1, 0) == 0);
+
+    flash_sim_close();
+}
+
+static void test_erase_and_wear(void)
+{
+    uint8_t buf[16] = {0};
+    uint8_t rd[16];
+    struct flash_sim_stats stats;
+
+    CHECK(flash_sim_open(NULL, SIM_SIZE) == 0);
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR + 10, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE, buf, sizeof(buf)) == sizeof(buf));
+
+    /* An unaligned range erases every sector it touches. */
+    CHECK(hal_flash_erase(FLASH_SIM_BASE_ADDR + 100, FLASH_SIM_SECTOR_SIZE));
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE, rd, sizeof(rd)) == sizeof(rd));
+    CHECK(rd[0] == 0xFF && rd[15] == 0xFF);
+    CHECK(flash_sim_sector_wear(FLASH_SIM_BASE_ADDR) == 1);
+    CHECK(flash_sim_sector_wear(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE) == 1);
+    CHECK(flash_sim_sector_wear(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE * 2) == 0);
+
+    flash_sim_get_stats(&stats);
+    CHECK(stats.erase_ops == 1);
+    CHECK(stats.erase_bytes == 2 * FLASH_SIM_SECTOR_SIZE);
+
+    CHECK(!hal_flash_erase(FLASH_SIM_BASE_ADDR, 0));
+    CHECK(!hal_flash_erase(FLASH_SIM_BASE_ADDR + SIM_SIZE, FLASH_SIM_SECTOR_SIZE));
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR - 1, rd, 1) == 0);
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR + SIM_SIZE - 8, rd, sizeof(rd)) == 0);
+
+    CHECK(hal_flash_erase_chip());
+    CHECK(flash_sim_sector_wear(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE * 2) == 1);
+
+    flash_sim_close();
+}
+
+static void test_timing(void)
+{
+    struct flash_sim_timing timing = {
+        .cmd_overhead_us  = 10,
+        .read_ns_per_byte = 1000,
+        .page_program_us  = 100,
+        .sector_erase_us  = 1000,
+        .block32_erase_us = 4000,
+        .block64_erase_us = 6000,
+        .chip_erase_us    = 50000,
+        .realtime         = false,
+    };
+    uint8_t buf[FLASH_SIM_PAGE_SIZE * 2];
+    struct flash_sim_stats stats;
+
+    CHECK(flash_sim_open(NULL, SIM_SIZE) == 0);
+    flash_sim_set_timing(&timing);
+
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR, buf, 100) == 100);
+    flash_sim_get_stats(&stats);
+    CHECK(stats.time_us == 10 + 100);
+
+    memset(buf, 0, sizeof(buf));
+    flash_sim_reset_stats();
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    flash_sim_get_stats(&stats);
+    CHECK(stats.time_us == 10 + 2 * 100);
+
+    flash_sim_reset_stats();
+    CHECK(hal_flash_erase(FLASH_SIM_BASE_ADDR, FLASH_SIM_SECTOR_SIZE));
+    flash_sim_get_stats(&stats);
+    CHECK(stats.time_us == 10 + 1000);
+    CHECK(stats.erase_cmds == 1);
+
+    /* Like the lib's hal_flash_erase, an aligned 64 KB range still goes sector by sector. */
+    flash_sim_reset_stats();
+    CHECK(hal_flash_erase(FLASH_SIM_BASE_ADDR, 0x10000));
+    flash_sim_get_stats(&stats);
+    CHECK(stats.time_us == 10 + 16 * 1000);
+    CHECK(stats.erase_cmds == 16);
+
+    /* Blocks only come from the block erase commands. */
+    flash_sim_reset_stats();
+    CHECK(hal_flash_block_erase(0xD8, FLASH_SIM_BASE_ADDR) == HAL_OK);
+    flash_sim_get_stats(&stats);
+    CHECK(stats.time_us >= 6000 && stats.time_us <= 6000 + 3 * 10);
+    CHECK(stats.erase_cmds == 1 && stats.erase_bytes == 0x10000);
+    CHECK(hal_flash_block_erase(0x52, FLASH_SIM_BASE_ADDR + 0x1000) == HAL_ERROR);
+    CHECK(hal_flash_block_erase(0x99, FLASH_SIM_BASE_ADDR) == HAL_ERROR);
+
+    flash_sim_close();
+}
+
+static volatile uint32_t g_hold;
+static uint64_t g_hold_at_us;
+
+static void hold_at(uint64_t now_us)
+{
+    if (now_us >= g_hold_at_us) {
+        g_hold = 1;
+    }
+}
+
+/* An erase suspended by the hold reports it, leaves the rest of the flash readable and resumes for
+ * the time it had left. */
+static void test_erase_suspend(void)
+{
+    struct flash_sim_timing timing = {
+        .cmd_overhead_us  = 5,
+        .read_ns_per_byte = 125,
+        .page_program_us  = 700,
+        .sector_erase_us  = 45000,
+        .block32_erase_us = 160000,
+        .block64_erase_us = 250000,
+        .chip_erase_us    = 8000000,
+        .suspend_us       = 20,
+        .realtime         = false,
+    };
+    uint8_t buf[16];
+    struct flash_sim_stats stats;
+    uint64_t start;
+
+    CHECK(flash_sim_open(NULL, SIM_SIZE) == 0);
+    flash_sim_set_timing(&timing);
+    CHECK(hal_flash_erase_run(0x20, FLASH_SIM_BASE_ADDR + 0x100, NULL) == HAL_FLASH_ERASE_FAILED);
+    CHECK(hal_flash_erase_run(0x52, FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE, NULL) == HAL_FLASH_ERASE_FAILED);
+    CHECK(hal_flash_erase_continue(NULL) == HAL_FLASH_ERASE_FAILED);
+
+    start = flash_sim_clock_us();
+    CHECK(hal_flash_erase_run(0xD8, FLASH_SIM_BASE_ADDR, NULL) == HAL_FLASH_ERASE_DONE);
+    CHECK(flash_sim_clock_us() - start == 5 + 250000);
+    CHECK(flash_sim_sector_wear(FLASH_SIM_BASE_ADDR + 0xFFFF) == 1);
+
+    g_hold = 0;
+    start = flash_sim_clock_us();
+    g_hold_at_us = start + 10000;
+    flash_sim_set_poll(hold_at);
+    CHECK(hal_flash_erase_run(0x20, FLASH_SIM_BASE_ADDR, &g_hold) == HAL_FLASH_ERASE_SUSPENDED);
+    flash_sim_set_poll(NULL);
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR, buf, sizeof(buf)) == 0);
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE, buf, sizeof(buf)) == 0);
+    CHECK(hal_flash_erase_run(0x20, FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE, NULL) == HAL_FLASH_ERASE_FAILED);
+    flash_sim_advance(1000);
+    CHECK(hal_flash_erase_continue(&g_hold) == HAL_FLASH_ERASE_SUSPENDED);
+    g_hold = 0;
+    CHECK(hal_flash_erase_continue(&g_hold) == HAL_FLASH_ERASE_DONE);
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR, buf, sizeof(buf)) == sizeof(buf));
+
+    /* The erase itself still took sector_erase_us, the rest is suspend overhead and the idle time. */
+    flash_sim_get_stats(&stats);
+    CHECK(stats.suspends == 2);
+    CHECK(stats.busy_rejects == 3);
+    CHECK(flash_sim_clock_us() - start >= 45000 + 1000);
+    CHECK(flash_sim_clock_us() - start <= 45000 + 1000 + 4 * (5 + 20));
+    flash_sim_close();
+}
+
+static void test_power_loss(void)
+{
+    uint8_t buf[64];
+    uint8_t rd[64];
+
+    CHECK(flash_sim_open(NULL, SIM_SIZE) == 0);
+    memset(buf, 0x00, sizeof(buf));
+
+    /* The budget runs out in the middle of the write: a prefix lands and the call fails. */
+    flash_sim_set_power_loss(40);
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR, buf, sizeof(buf)) == 0);
+    CHECK(!flash_sim_powered());
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR, rd, sizeof(rd)) == 0);
+    CHECK(!hal_flash_erase(FLASH_SIM_BASE_ADDR, FLASH_SIM_SECTOR_SIZE));
+
+    flash_sim_power_on();
+    CHECK(flash_sim_powered());
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR, rd, sizeof(rd)) == sizeof(rd));
+    CHECK(rd[39] == 0x00);
+    CHECK(rd[40] == 0xFF);
+
+    /* An erase cut after one sector leaves the second partly erased. */
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE * 2 - sizeof(buf), buf, sizeof(buf)) ==
+          sizeof(buf));
+    flash_sim_set_power_loss(1);
+    CHECK(!hal_flash_erase(FLASH_SIM_BASE_ADDR, 2 * FLASH_SIM_SECTOR_SIZE));
+    flash_sim_power_on();
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR, rd, sizeof(rd)) == sizeof(rd));
+    CHECK(rd[0] == 0xFF);
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE, rd, sizeof(rd)) == sizeof(rd));
+    CHECK(rd[0] == 0xFF);
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR + FLASH_SIM_SECTOR_SIZE * 2 - sizeof(buf), rd, sizeof(rd)) ==
+          sizeof(rd));
+    CHECK(rd[0] == 0x00);
+
+    flash_sim_close();
+}
+
+static void test_image_file(void)
+{
+    char path[] = "/tmp/flash_sim_XXXXXX";
+    int fd = mkstemp(path);
+    uint8_t buf[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t rd[8];
+    uint32_t id = 0;
+    uint32_t size = 0;
+
+    CHECK(fd >= 0);
+    close(fd);
+
+    CHECK(flash_sim_open(path, SIM_SIZE) == 0);
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR + 0x100, buf, sizeof(buf)) == sizeof(buf));
+    flash_sim_close();
+
+    CHECK(flash_sim_open(path, SIM_SIZE) == 0);
+    CHECK(hal_flash_read(FLASH_SIM_BASE_ADDR + 0x100, rd, sizeof(rd)) == sizeof(rd));
+    CHECK(memcmp(buf, rd, sizeof(buf)) == 0);
+    hal_flash_get_info(&id, &size);
+    CHECK(id == FLASH_SIM_DEFAULT_ID);
+    CHECK(size == SIM_SIZE);
+    CHECK(hal_flash_sector_size() == FLASH_SIM_SECTOR_SIZE);
+    hal_flash_set_security(true);
+    CHECK(hal_flash_get_security());
+    hal_flash_set_security(false);
+    flash_sim_close();
+    unlink(path);
+
+    CHECK(flash_sim_open(NULL, SIM_SIZE + 1) != 0);
+    CHECK(hal_flash_init());
+    hal_flash_get_info(&id, &size);
+    CHECK(size == FLASH_SIM_DEFAULT_SIZE);
+    flash_sim_close();
+}
+
+/* Where the host allows it the image sits at the XIP address, and reads through pointers see programs. */
+static void test_xip_window(void)
+{
+    const uint8_t buf[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+
+    CHECK(flash_sim_open(NULL, SIM_SIZE) == 0);
+    if (!flash_sim_xip()) {
+        printf("flash_sim: XIP address range taken, window not checked\n");
+        flash_sim_close();
+        return;
+    }
+    CHECK(flash_sim_image() == (uint8_t *)FLASH_SIM_BASE_ADDR);
+    CHECK(hal_flash_write(FLASH_SIM_BASE_ADDR + 0x40, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(memcmp((const void *)(FLASH_SIM_BASE_ADDR + 0x40), buf, sizeof(buf)) == 0);
+    flash_sim_close();
+    /* Reopening maps the same range again. */
+    CHECK(flash_sim_open(NULL, SIM_SIZE) == 0);
+    CHECK(flash_sim_xip());
+    CHECK(*(const uint8_t *)(FLASH_SIM_BASE_ADDR + 0x40) == 0xFF);
+    flash_sim_close();
+}
+
+int main(void)
+{
+    test_nor_program();
+    test_erase_and_wear();
+    test_timing();
+    test_erase_suspend();
+    test_power_loss();
+    test_image_file();
+    test_xip_window();
+
+    printf("flash_sim: %s\n", g_failed ? "FAILED" : "ok");
+    return g_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Checks the protocol rules of the SPI NOR command model the external flash driver tests rely on. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spi_nor_model.h"
+
+#define SCLK_HZ             8000000
+
+static int g_failed;
+
+#define CHECK(cond) do {                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            g_failed++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static uint32_t Violations(void)
+{
+    struct spi_nor_stats st;
+
+    spi_nor_get_stats(&st);
+    return st.violations;
+}
+
+static void Open(enum spi_nor_qe qe)
+{
+    struct spi_nor_part part;
+
+    spi_nor_part_default(&part, qe);
+    CHECK(spi_nor_open(&part) == 0);
+    spi_nor_set_bus(SCLK_HZ, 0);
+}
+
+static void Cmd(uint8_t cmd)
+{
+    spi_nor_advance_ns(spi_nor_frame(&cmd, 1, NULL, 0));
+}
+
+static void WaitIdle(void)
+{
+    while (spi_nor_busy()) {
+        spi_nor_advance_ns(1000);
+    }
+}
+
+static void WriteSr(uint8_t cmd, const uint8_t *val, uint32_t len)
+{
+    uint8_t frame[3] = { cmd };
+
+    memcpy(frame + 1, val, len);
+    Cmd(0x06);
+    spi_nor_advance_ns(spi_nor_frame(frame, 1 + len, NULL, 0));
+    WaitIdle();
+}
+
+static uint64_t QuadRead(uint32_t addr, uint8_t mode, uint8_t *buf, uint32_t len, bool io23)
+{
+    struct spi_nor_op op = {
+        .cmd = 0xEB, .addr_bits = 32, .addr_lines = 4, .addr = (addr << 8) | mode,
+        .dummy_clocks = 4, .data_lines = 4, .rx = buf, .len = len, .io23_driven = io23,
+    };
+    uint64_t ns = spi_nor_xfer(&op);
+
+    spi_nor_advance_ns(ns);
+    return ns;
+}
+
+static void test_program_rules(void)
+{
+    uint8_t frame[4 + 8] = { 0x02, 0x00, 0x10, 0xFC };
+    uint8_t rd[8];
+
+    Open(SPI_NOR_QE_SR2_WRSR1);
+    memset(frame + 4, 0x5A, 8);
+    /* No WREN: ignored. */
+    spi_nor_advance_ns(spi_nor_frame(frame, sizeof(frame), NULL, 0));
+    CHECK(Violations() == 1);
+    CHECK(spi_nor_image()[0x10FC] == 0xFF);
+
+    /* 8 bytes from 0xFC wrap to the start of the page. */
+    Cmd(0x06);
+    CHECK(spi_nor_sr(1) & 0x02);
+    spi_nor_advance_ns(spi_nor_frame(frame, sizeof(frame), NULL, 0));
+    CHECK(Violations() == 2);
+    CHECK(spi_nor_image()[0x10FF] == 0x5A && spi_nor_image()[0x1000] == 0x5A && spi_nor_image()[0x1100] == 0xFF);
+    CHECK(spi_nor_busy() && (spi_nor_sr(1) & 0x03) == 0x01);
+
+    /* Reads are refused while WIP, status reads are not. */
+    uint8_t rdcmd[4] = { 0x03, 0x00, 0x10, 0xFC };
+    spi_nor_advance_ns(spi_nor_frame(rdcmd, sizeof(rdcmd), rd, sizeof(rd)));
+    CHECK(Violations() == 3);
+    Cmd(0x05);
+    CHECK(Violations() == 3);
+    WaitIdle();
+    spi_nor_advance_ns(spi_nor_frame(rdcmd, sizeof(rdcmd), rd, sizeof(rd)));
+    CHECK(Violations() == 3 && rd[0] == 0x5A && rd[4] == 0xFF);
+
+    /* Bits only go from 1 to 0. */
+    frame[3] = 0x00;
+    memset(frame + 4, 0x0F, 8);
+    Cmd(0x06);
+    spi_nor_advance_ns(spi_nor_frame(frame, sizeof(frame), NULL, 0));
+    WaitIdle();
+    CHECK(spi_nor_image()[0x1000] == 0x0A && spi_nor_image()[0x1004] == 0x0F && spi_nor_image()[0x1008] == 0xFF);
+
+    Cmd(0x06);
+    uint8_t se[4] = { 0x20, 0x00, 0x10, 0x80 };
+    spi_nor_advance_ns(spi_nor_frame(se, sizeof(se), NULL, 0));
+    WaitIdle();
+    CHECK(spi_nor_image()[0x1000] == 0xFF && Violations() == 3);
+    spi_nor_close();
+}
+
+static void test_quad_enable(void)
+{
+    static const uint8_t both[2] = { 0x00, 0x02 };
+    static const uint8_t sr1[1] = { 0x00 };
+    static const uint8_t qe2[1] = { 0x02 };
+    static const uint8_t qe6[1] = { 0x40 };
+    static const uint8_t qe7[1] = { 0x80 };
+    uint8_t buf[16];
+    struct spi_nor_stats st;
+
+    /* Quad phases need QE, then IO2/IO3 driven. */
+    Open(SPI_NOR_QE_SR2_WRSR1);
+    QuadRead(0, 0x00, buf, sizeof(buf), true);
+    CHECK(Violations() == 1 && buf[0] == 0xFF);
+    WriteSr(0x31, qe2, 1);
+    CHECK(spi_nor_sr(2) == 0x02);
+    QuadRead(0, 0x00, buf, sizeof(buf), false);
+    CHECK(Violations() == 2);
+    QuadRead(0, 0x00, buf, sizeof(buf), true);
+    CHECK(Violations() == 2);
+    /* A one byte WRSR keeps SR2 on this type; QE survives a power cycle. */
+    WriteSr(0x01, sr1, 1);
+    spi_nor_power_cycle();
+    CHECK(spi_nor_sr(2) == 0x02);
+
+    /* No 0x31 on the old type, and a one byte WRSR clears SR2. */
+    Open(SPI_NOR_QE_SR2_WRSR);
+    WriteSr(0x31, qe2, 1);
+    spi_nor_get_stats(&st);
+    CHECK(st.unknown == 1 && spi_nor_sr(2) == 0);
+    WriteSr(0x01, both, 2);
+    CHECK(spi_nor_sr(2) == 0x02);
+    WriteSr(0x01, sr1, 1);
+    CHECK(spi_nor_sr(2) == 0);
+
+    Open(SPI_NOR_QE_SR1_BIT6);
+    WriteSr(0x01, qe6, 1);
+    QuadRead(0, 0x00, buf, sizeof(buf), true);
+    CHECK(spi_nor_sr(1) == 0x40 && Violations() == 0);
+
+    Open(SPI_NOR_QE_SR2_BIT7);
+    WriteSr(0x3E, qe7, 1);
+    QuadRead(0, 0x00, buf, sizeof(buf), true);
+    CHECK(spi_nor_sr(2) == 0x80 && Violations() == 0);
+    spi_nor_close();
+}
+
+static void test_mode_bits(void)
+{
+    uint8_t buf[4];
+    static const uint8_t qe2[1] = { 0x02 };
+
+    Open(SPI_NOR_QE_SR2_WRSR1);
+    WriteSr(0x31, qe2, 1);
+    /* M5-4 = 10b: the next instruction byte is taken as address. */
+    QuadRead(0, 0x20, buf, sizeof(buf), true);
+    CHECK(Violations() == 0);
+    Cmd(0x05);
+    CHECK(Violations() == 1);
+
+    /* Mode clocks sent as dummy leave the bits to whatever IO0-IO3 float at. */
+    struct spi_nor_op op = {
+        .cmd = 0xEB, .addr_bits = 24, .addr_lines = 4, .dummy_clocks = 6, .data_lines = 4,
+        .rx = buf, .len = sizeof(buf), .io23_driven = true,
+    };
+    spi_nor_advance_ns(spi_nor_xfer(&op));
+    CHECK(Violations() == 2);
+    op.addr_bits = 32;
+    op.dummy_clocks = 6;
+    spi_nor_advance_ns(spi_nor_xfer(&op));
+    CHECK(Violations() == 3);
+    spi_nor_close();
+}
+
+static void test_timing(void)
+{
+    uint8_t buf[256];
+    static const uint8_t qe2[1] = { 0x02 };
+    uint8_t rd[4] = { 0x03 };
+
+    Open(SPI_NOR_QE_SR2_WRSR1);
+    WriteSr(0x31, qe2, 1);
+    /* 8 + 24 + 2048 clocks single, 8 + 8 + 4 + 512 quad, at 8 MHz. */
+    CHECK(spi_nor_frame(rd, sizeof(rd), buf, sizeof(buf)) == 2080ULL * 125);
+    CHECK(QuadRead(0, 0x00, buf, sizeof(buf), true) == 532ULL * 125);
+    spi_nor_set_bus(SCLK_HZ, 2000);
+    CHECK(QuadRead(0, 0x00, buf, sizeof(buf), true) == 532ULL * 125 + 2000);
+
+    /* tPP runs from the end of the transfer; suspend and resume keep what is left. */
+    uint8_t pp[4 + 1] = { 0x02, 0x00, 0x20, 0x00, 0x00 };
+    Cmd(0x06);
+    uint64_t start = spi_nor_now_ns();
+    spi_nor_advance_ns(spi_nor_frame(pp, sizeof(pp), NULL, 0));
+    WaitIdle();
+    uint64_t took = spi_nor_now_ns() - start;
+    CHECK(took >= 700000 && took < 700000 + 10000);
+
+    uint8_t se[4] = { 0x20, 0x00, 0x20, 0x00 };
+    Cmd(0x06);
+    spi_nor_advance_ns(spi_nor_frame(se, sizeof(se), NULL, 0));
+    spi_nor_advance_ns(10000000);
+    Cmd(0x75);
+    CHECK(!spi_nor_busy());
+    spi_nor_advance_ns(spi_nor_frame(rd, sizeof(rd), buf, 4));
+    Cmd(0x7A);
+    CHECK(spi_nor_busy());
+    start = spi_nor_now_ns();
+    WaitIdle();
+    took = spi_nor_now_ns() - start;
+    CHECK(took > 34000000 && took < 36000000);
+    CHECK(Violations() == 0);
+    spi_nor_close();
+}
+
+static void test_id_and_sfdp(void)
+{
+    static const uint8_t sfdp[8] = { 'S', 'F', 'D', 'P', 0x06, 0x01, 0x00, 0xFF };
+    struct spi_nor_part part;
+    uint8_t id[3];
+    uint8_t rd[8];
+    uint8_t cmd = 0x9F;
+    uint8_t cmd5a[5] = { 0x5A, 0x00, 0x00, 0x00, 0x00 };
+
+    spi_nor_part_default(&part, SPI_NOR_QE_SR1_BIT6);
+    spi_nor_open(&part);
+    spi_nor_frame(&cmd, 1, id, sizeof(id));
+    CHECK(id[0] == 0xC2 && id[1] == 0x20 && id[2] == 0x14);
+    spi_nor_frame(cmd5a, sizeof(cmd5a), rd, sizeof(rd));
+    CHECK(rd[0] == 0xFF);
+
+    part.sfdp = sfdp;
+    part.sfdp_len = sizeof(sfdp);
+    spi_nor_open(&part);
+    spi_nor_frame(cmd5a, sizeof(cmd5a), rd, sizeof(rd));
+    CHECK(memcmp(rd, sfdp, sizeof(sfdp)) == 0);
+    /* No dummy byte: the part was still waiting for it. */
+    spi_nor_frame(cmd5a, 4, rd, sizeof(rd));
+    CHECK(Violations() == 1);
+    spi_nor_close();
+}
+
+static void test_addr4(void)
+{
+    struct spi_nor_part part;
+    struct spi_nor_stats st;
+    uint8_t rd3[4] = { 0x03, 0x00, 0x10, 0x00 };
+    uint8_t rd4[5] = { 0x03, 0x01, 0x00, 0x10, 0x00 };
+    uint8_t buf[1];
+
+    spi_nor_part_default(&part, SPI_NOR_QE_SR2_WRSR1);
+    part.size = 0x2000000;
+    part.addr = SPI_NOR_ADDR_3_OR_4;
+    CHECK(spi_nor_open(&part) == 0);
+    spi_nor_image()[0x1000] = 0x33;
+    spi_nor_image()[0x1001000] = 0x44;
+    spi_nor_frame(rd3, sizeof(rd3), buf, sizeof(buf));
+    CHECK(buf[0] == 0x33);
+
+    /* After 0xB7 every address is 4 bytes, and a 3 byte one is short. */
+    Cmd(0xB7);
+    spi_nor_frame(rd4, sizeof(rd4), buf, sizeof(buf));
+    CHECK(buf[0] == 0x44 && Violations() == 0);
+    spi_nor_frame(rd3, sizeof(rd3), buf, sizeof(buf));
+    CHECK(Violations() == 1);
+
+    /* Reset goes back to 3 bytes. */
+    Cmd(0x66);
+    Cmd(0x99);
+    WaitIdle();
+    spi_nor_frame(rd3, sizeof(rd3), buf, sizeof(buf));
+    CHECK(buf[0] == 0x33 && Violations() == 1);
+
+    /* A 4-byte only part starts there and has no 0xB7. */
+    part.addr = SPI_NOR_ADDR_4;
+    CHECK(spi_nor_open(&part) == 0);
+    spi_nor_image()[0x1001000] = 0x44;
+    spi_nor_frame(rd4, sizeof(rd4), buf, sizeof(buf));
+    CHECK(buf[0] == 0x44 && Violations() == 0);
+    Cmd(0xB7);
+    spi_nor_get_stats(&st);
+    CHECK(st.unknown == 1);
+    spi_nor_close();
+}
+
+int main(void)
+{
+    test_program_rules();
+    test_quad_enable();
+    test_mode_bits();
+    test_timing();
+    test_id_and_sfdp();
+    test_addr4();
+
+    printf("spi_nor_model: %s\n", g_failed ? "FAILED" : "ok");
+    return g_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copies and interrupts per KB sent by app_uart.c in DMA mode at 921600 baud on the fake UART: 64 KB
+ * sent in writes of 64 bytes to 4095 bytes, through app_uart_transmit_async() (copied into the TX ring,
+ * then out of it into the DMA buffer) and through app_uart_transmit_desc_async() (sent in place from
+ * up to four descriptors in flight). "copied" counts the bytes memcpy_s moves, "isrs" the UART and DMA
+ * interrupt entries, "line" the share of the model time the TX line was busy until the driver went idle.
+ * Not measured on silicon.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "app_drv_fake.h"
+#include "app_uart.h"
+#include "securec.h"
+#include "uart_fake.h"
+
+#define BAUD                921600
+#define US                  1000ULL
+#define TOTAL_SIZE          (64 * 1024)
+#define TX_RING_SIZE        8192
+#define DESC_COUNT          4
+
+static uint8_t g_txRing[TX_RING_SIZE];
+static uint8_t g_data[TOTAL_SIZE];
+static app_uart_tx_desc_t g_desc[DESC_COUNT];
+static bool g_descBusy[DESC_COUNT];
+
+static void Release(app_uart_tx_desc_t *p_desc)
+{
+    g_descBusy[p_desc - g_desc] = false;
+}
+
+static void Open(void)
+{
+    app_uart_params_t params = {
+        .id = APP_UART_ID_0,
+        .pin_cfg = {
+            .tx = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_10, APP_IO_PULLUP },
+            .rx = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_11, APP_IO_PULLUP },
+        },
+        .use_mode = { APP_UART_TYPE_DMA, DMA_Channel0, DMA_Channel1 },
+        .init = {
+            .baud_rate = BAUD,
+            .data_bits = UART_DATABITS_8,
+            .stop_bits = UART_STOPBITS_1,
+            .parity = UART_PARITY_NONE,
+            .hw_flow_ctrl = UART_HWCONTROL_NONE,
+            .rx_timeout_mode = UART_RECEIVER_TIMEOUT_DISABLE,
+        },
+    };
+    app_uart_tx_buf_t tx_buf = { g_txRing, TX_RING_SIZE };
+
+    app_uart_deinit(APP_UART_ID_0);
+    uart_fake_reset();
+    app_drv_fake_reset();
+    memset(g_descBusy, 0, sizeof(g_descBusy));
+    CHECK(app_uart_init(&params, NULL, &tx_buf) == APP_DRV_SUCCESS);
+}
+
+/* Queue the next write if there is room for it; returns the bytes queued. */
+static uint32_t Queue(bool desc, uint32_t offset, uint32_t size)
+{
+    if (!desc) {
+        if (app_uart_transmit_space_get(APP_UART_ID_0) < size) {
+            return 0;
+        }
+        CHECK(app_uart_transmit_async(APP_UART_ID_0, g_data + offset, (uint16_t)size) == APP_DRV_SUCCESS);
+        return size;
+    }
+    for (uint32_t i = 0; i < DESC_COUNT; i++) {
+        if (!g_descBusy[i]) {
+            g_desc[i] = (app_uart_tx_desc_t) {
+                .p_data = g_data + offset,
+                .size = (uint16_t)size,
+                .release = Release,
+            };
+            g_descBusy[i] = true;
+            CHECK(app_uart_transmit_desc_async(APP_UART_ID_0, &g_desc[i]) == APP_DRV_SUCCESS);
+            return size;
+        }
+    }
+    return 0;
+}
+
+static void Bench(bool desc, uint32_t size)
+{
+    struct uart_fake_stats st;
+    const uint8_t *sent;
+    uint32_t queued = 0;
+    size_t copied;
+    uint64_t t0;
+    double kb = TOTAL_SIZE / 1024.0;
+
+    Open();
+    copied = g_hostCopyBytes;
+    t0 = uart_fake_now_ns();
+    while (queued < TOTAL_SIZE || app_uart_transmit_busy(APP_UART_ID_0)) {
+        uint32_t n = (TOTAL_SIZE - queued < size) ? TOTAL_SIZE - queued : size;
+
+        while (n != 0 && Queue(desc, queued, n) != 0) {
+            queued += n;
+            n = (TOTAL_SIZE - queued < size) ? TOTAL_SIZE - queued : size;
+        }
+        uart_fake_run(100 * US);
+    }
+    copied = g_hostCopyBytes - copied;
+    t0 = uart_fake_now_ns() - t0;
+    uart_fake_run(1000 * US);
+    uart_fake_get_stats(APP_UART_ID_0, &st);
+    CHECK(uart_fake_sent(APP_UART_ID_0, &sent) == TOTAL_SIZE);
+    CHECK(memcmp(sent, g_data, TOTAL_SIZE) == 0);
+
+    printf("app_uart dma %-5s write %4u B  copied %6.0f B/KB  isrs %6.2f /KB  line %5.1f %%\n",
+           desc ? "desc" : "ring", (unsigned)size, copied / kb, (st.irqs + st.dma_irqs) / kb,
+           100.0 * TOTAL_SIZE * uart_fake_char_ns(APP_UART_ID_0) / t0);
+}
+
+int main(void)
+{
+    static const uint32_t sizes[] = { 64, 256, 1024, 4095 };
+
+    for (uint32_t i = 0; i < TOTAL_SIZE; i++) {
+        g_data[i] = (uint8_t)(i * 7 + (i >> 9));
+    }
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        Bench(false, sizes[i]);
+        Bench(true, sizes[i]);
+    }
+    app_uart_deinit(APP_UART_ID_0);
+    return g_hostTestFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
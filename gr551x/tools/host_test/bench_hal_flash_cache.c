@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Small reads through hal_flash_ext_read, built once per read cache geometry (sets x ways x line) so
+ * the rows can be compared. The trace mixes lookups of a few hot pages (metadata tags, log headers: 16-64 B,
+ * HOT_SHARE percent of the reads) with reads spread over the whole partition, and a page write every
+ * WRITE_EVERY reads that invalidates what it touches.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "hal_flash_ext.h"
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x10000)
+#define PART_PAGES      1024
+#define HOT_PAGES       6
+#define HOT_SHARE       80
+#define READS           20000
+#define WRITE_EVERY     200
+
+static uint32_t g_seed = 12345;
+
+static uint32_t Rand(void)
+{
+    g_seed = g_seed * 1103515245 + 12345;
+    return g_seed >> 8;
+}
+
+int main(void)
+{
+    static uint8_t page[FLASH_SIM_PAGE_SIZE];
+    struct flash_sim_stats st;
+    hal_flash_stats_t fs;
+    uint8_t buf[64];
+    uint32_t next_write = 0;
+
+    flash_sim_open(NULL, 0x100000);
+    hal_flash_ext_init();
+    memset(page, 0x5A, sizeof(page));
+    flash_sim_reset_stats();
+
+    for (int i = 0; i < READS; i++) {
+        uint32_t pg = ((Rand() % 100) < HOT_SHARE) ? (Rand() % HOT_PAGES) : (Rand() % PART_PAGES);
+        uint32_t len = 16 << (Rand() % 3);
+        uint32_t off = (Rand() % (FLASH_SIM_PAGE_SIZE / 16)) * 16;
+        (void)hal_flash_ext_read(PART_ADDR + pg * FLASH_SIM_PAGE_SIZE + off, buf, len);
+        if ((i + 1) % WRITE_EVERY == 0) {
+            (void)hal_flash_ext_write(PART_ADDR + (HOT_PAGES + next_write++) * FLASH_SIM_PAGE_SIZE, page,
+                                      sizeof(page));
+        }
+    }
+
+    flash_sim_get_stats(&st);
+    hal_flash_stats_get(&fs);
+    printf("cache=%dx%dx%-3d  reads %6u  flash reads %6u (%8llu B)  hit rate %5.1f%%  read time %7.1f ms\n",
+           HAL_FLASH_READ_CACHE_SETS, HAL_FLASH_READ_CACHE_WAYS, HAL_FLASH_READ_CACHE_LINE, READS, st.read_ops,
+           (unsigned long long)st.read_bytes,
+           (fs.cache_hits + fs.cache_misses) ? 100.0 * fs.cache_hits / (fs.cache_hits + fs.cache_misses) : 0.0,
+           fs.op[HAL_FLASH_OP_READ].total_us / 1000.0);
+    flash_sim_close();
+    return 0;
+}
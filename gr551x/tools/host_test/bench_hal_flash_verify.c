@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Cost of the check in hal_flash_ext_write_r for the HAL_FLASH_VERIFY_MODE it is built with, from 4 KB
+ * to 256 KB: modelled time spent after programming, and the QSPI reads it takes. The SHA256 time
+ * comes from the assumed engine rate in stubs/hmac_fake.c; the CPU time of the software CRC32 is not
+ * modelled and comes on top of its reads.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "hal_flash_ext.h"
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x40000)
+#define SIZE_MAX_BYTES  0x40000
+
+static uint32_t g_data32[SIZE_MAX_BYTES / sizeof(uint32_t)];
+
+static uint64_t TimedWrite(bool verify, uint32_t size, uint32_t *p_reads)
+{
+    struct flash_sim_stats st;
+    uint64_t start;
+    uint32_t ret;
+
+    CHECK(hal_flash_ext_erase(PART_ADDR, size));
+    flash_sim_reset_stats();
+    start = flash_sim_clock_us();
+    if (verify) {
+        ret = hal_flash_ext_write_r(PART_ADDR, (const uint8_t *)g_data32, size);
+    } else {
+        ret = hal_flash_ext_write(PART_ADDR, (const uint8_t *)g_data32, size);
+    }
+    CHECK(ret == size);
+    flash_sim_get_stats(&st);
+    *p_reads = st.read_ops;
+    return flash_sim_clock_us() - start;
+}
+
+int main(void)
+{
+    static const uint32_t sizes[] = { 0x1000, 0x4000, 0x10000, 0x40000 };
+    const char *mode = (HAL_FLASH_VERIFY_MODE == HAL_FLASH_VERIFY_SHA256) ? "sha256" :
+                       (HAL_FLASH_VERIFY_MODE == HAL_FLASH_VERIFY_CRC32) ? "crc32" : "readback";
+
+    memset(g_data32, 0x3C, sizeof(g_data32));
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_ext_init();
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint32_t reads;
+        uint64_t program_us = TimedWrite(false, sizes[i], &reads);
+        uint64_t total_us = TimedWrite(true, sizes[i], &reads);
+
+        printf("verify %-8s %6u KB  program %8.1f ms  check %7.1f ms  QSPI reads %5u\n", mode,
+               (unsigned)(sizes[i] / 1024), program_us / 1000.0, (total_us - program_us) / 1000.0, (unsigned)reads);
+    }
+    flash_sim_close();
+    return g_hostTestFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
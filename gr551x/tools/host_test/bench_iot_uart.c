@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Caller latency of IoTUartWrite in synchronous and asynchronous mode, for writes of 16 bytes to
+ * 2 KB at 921600 baud on the fake UART, with the writer busy for twice the wire time of its data
+ * between writes (a half-loaded line). "wait" is the time the caller spends blocked on the UART, on
+ * the model clock; "cpu" is the host time spent in the call, which only ranks the copy costs.
+ * Not measured on silicon.
+ */
+#include <string.h>
+#include <time.h>
+#include "host_test.h"
+#include "app_drv_fake.h"
+#include "app_uart.h"
+#include "hal_iot_uart_ext.h"
+#include "iot_errno.h"
+#include "iot_uart.h"
+#include "los_shim.h"
+#include "uart_fake.h"
+
+#define TOTAL_SIZE      (32 * 1024)
+#define WRITES_MIN      8
+#define NS_PER_US       1000.0
+
+static uint8_t g_data[2048];
+
+static uint64_t HostNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void Bench(IotUartWriteMode mode, uint32_t size)
+{
+    uint32_t writes = (TOTAL_SIZE / size > WRITES_MIN) ? TOTAL_SIZE / size : WRITES_MIN;
+    uint64_t wait_sum = 0;
+    uint64_t wait_max = 0;
+    uint64_t cpu_sum = 0;
+    const uint8_t *sent;
+    uint32_t sent_before = uart_fake_sent(APP_UART_ID_0, &sent);
+
+    CHECK(IoTUartSetWriteMode(APP_UART_ID_0, mode) == IOT_SUCCESS);
+    for (uint32_t i = 0; i < writes; i++) {
+        uint64_t t0 = uart_fake_now_ns();
+        uint64_t h0 = HostNs();
+        uint64_t wait;
+
+        CHECK(IoTUartWrite(APP_UART_ID_0, g_data, size) == IOT_SUCCESS);
+        cpu_sum += HostNs() - h0;
+        wait = uart_fake_now_ns() - t0;
+        wait_sum += wait;
+        wait_max = (wait > wait_max) ? wait : wait_max;
+        uart_fake_run(2 * size * uart_fake_char_ns(APP_UART_ID_0));
+    }
+    CHECK(IoTUartFlush(APP_UART_ID_0, IOT_UART_WAIT_FOREVER) == IOT_SUCCESS);
+    uart_fake_run(1000000);
+    CHECK(uart_fake_sent(APP_UART_ID_0, &sent) == sent_before + writes * size);
+
+    printf("iot_uart %-5s write %4u B  wait mean %8.1f us  max %8.1f us  cpu %6.2f us\n",
+           (mode == IOT_UART_WRITE_SYNC) ? "sync" : "async", (unsigned)size,
+           wait_sum / NS_PER_US / writes, wait_max / NS_PER_US, cpu_sum / NS_PER_US / writes);
+}
+
+int main(void)
+{
+    static const uint32_t sizes[] = { 16, 64, 256, 1024, 2048 };
+    IotUartAttribute attr = {
+        .baudRate = 921600,
+        .dataBits = IOT_UART_DATA_BIT_8,
+        .stopBits = IOT_UART_STOP_BIT_1,
+        .parity = IOT_UART_PARITY_NONE,
+    };
+
+    for (uint32_t i = 0; i < sizeof(g_data); i++) {
+        g_data[i] = (uint8_t)i;
+    }
+    uart_fake_reset();
+    app_drv_fake_reset();
+    HostIdleHookSet(uart_fake_idle);
+    CHECK(IoTUartInit(APP_UART_ID_0, &attr) == IOT_SUCCESS);
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        Bench(IOT_UART_WRITE_SYNC, sizes[i]);
+        Bench(IOT_UART_WRITE_ASYNC, sizes[i]);
+    }
+    CHECK(IoTUartDeinit(APP_UART_ID_0) == IOT_SUCCESS);
+    HostIdleHookSet(NULL);
+    return g_hostTestFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Flash operations issued through the littlefs block callbacks for a key-value and a log
+ * workload, built once per LFS_BLOCK_CACHE_PAGES setting so the rows can be compared.
+ *
+ * littlefs itself is not in this tree, so the workloads replay the block device traffic littlefs
+ * generates for them with read_size = prog_size = 16 and cache_size = 256:
+ * - kv: each update fetches the metadata pair (16 B tag reads walking back from the end of the
+ *   last commit), appends a commit of 16 B units, reads the commit back for its CRC and syncs;
+ *   a full block is compacted into the other block of the pair.
+ * - log: 100 B records appended to a file, progged whenever the 256 B prog cache fills; every
+ *   8 records the file is synced, which flushes the cache, commits the new size to metadata and
+ *   makes the next append copy the partly written block (read back 16 B at a time).
+ */
+#include <stdio.h>
+#include <string.h>
+#include "littlefs.h"
+
+#define BLOCK_SIZE      4096
+#define BLOCK_COUNT     64
+#define CACHE_SIZE      256
+#define UNIT            16
+#define KV_UPDATES      2000
+#define KV_COMMIT       48
+#define KV_FETCH_TAGS   4
+#define KV_COMPACT      512
+#define LOG_RECORDS     4000
+#define LOG_RECORD      100
+#define LOG_SYNC_EVERY  8
+
+static struct lfs_config g_cfg = {
+    .read        = (int (*)(const struct lfs_config *, lfs_block_t, lfs_off_t, void *, lfs_size_t))
+                   littlefs_block_read,
+    .prog        = (int (*)(const struct lfs_config *, lfs_block_t, lfs_off_t, const void *, lfs_size_t))
+                   littlefs_block_write,
+    .erase       = littlefs_block_erase,
+    .sync        = littlefs_block_sync,
+    .read_size   = UNIT,
+    .prog_size   = UNIT,
+    .block_size  = BLOCK_SIZE,
+    .block_count = BLOCK_COUNT,
+    .cache_size  = CACHE_SIZE,
+};
+
+static uint8_t g_buf[BLOCK_SIZE];
+
+static void Reset(void)
+{
+    flash_sim_open(NULL, 0x100000);
+    hal_flash_set_security(true);
+    littlefs_flash_init(&g_cfg);
+}
+
+static void Report(const char *workload)
+{
+    struct flash_sim_stats st;
+
+    flash_sim_get_stats(&st);
+    printf("%-4s cache=%d  reads %7u (%8llu B)  writes %6u (%8llu B, %6u pages)  erases %5u  flash time %7.1f ms\n",
+           workload, LFS_BLOCK_CACHE_PAGES, st.read_ops, (unsigned long long)st.read_bytes, st.write_ops,
+           (unsigned long long)st.write_bytes, st.program_pages, st.erase_ops, st.time_us / 1000.0);
+    flash_sim_close();
+}
+
+static void KvWorkload(void)
+{
+    lfs_block_t pair[2] = { 0, 1 };
+    lfs_off_t off = 0;
+
+    Reset();
+    memset(g_buf, 0x3C, sizeof(g_buf));
+    for (int i = 0; i < KV_UPDATES; i++) {
+        for (int t = 1; (t <= KV_FETCH_TAGS) && (off >= (lfs_off_t)t * UNIT); t++) {
+            g_cfg.read(&g_cfg, pair[0], off - t * UNIT, g_buf, UNIT);
+        }
+        if (off + KV_COMMIT > BLOCK_SIZE) {
+            lfs_block_t tmp = pair[0];
+            pair[0] = pair[1];
+            pair[1] = tmp;
+            g_cfg.erase(&g_cfg, pair[0]);
+            for (off = 0; off < KV_COMPACT; off += CACHE_SIZE) {
+                g_cfg.prog(&g_cfg, pair[0], off, g_buf, CACHE_SIZE);
+            }
+            g_cfg.sync(&g_cfg);
+        }
+        g_cfg.prog(&g_cfg, pair[0], off, g_buf, KV_COMMIT);
+        g_cfg.read(&g_cfg, pair[0], off, g_buf, KV_COMMIT);
+        g_cfg.sync(&g_cfg);
+        off += KV_COMMIT;
+    }
+    Report("kv");
+}
+
+static void LogWorkload(void)
+{
+    lfs_block_t block = 2;
+    lfs_block_t meta = 0;
+    lfs_off_t meta_off = 0;
+    lfs_off_t pos = 0;          /* bytes of the file in the current block */
+    lfs_off_t progged = 0;      /* bytes of the current block already progged */
+    bool copy_pending = false;
+
+    Reset();
+    memset(g_buf, 0x5A, sizeof(g_buf));
+    for (int i = 0; i < LOG_RECORDS; i++) {
+        if (copy_pending) {
+            /* Committed blocks are immutable: the tail is copied into a fresh block first. */
+            lfs_block_t next = 2 + (block - 1) % (BLOCK_COUNT - 2);
+            g_cfg.erase(&g_cfg, next);
+            for (lfs_off_t o = 0; o < progged; o += UNIT) {
+                g_cfg.read(&g_cfg, block, o, g_buf, UNIT);
+            }
+            for (lfs_off_t o = 0; o < progged; o += CACHE_SIZE) {
+                g_cfg.prog(&g_cfg, next, o, g_buf, lfs_min(CACHE_SIZE, progged - o));
+            }
+            block = next;
+            copy_pending = false;
+        }
+        pos += LOG_RECORD;
+        while (pos - progged >= CACHE_SIZE) {
+            g_cfg.prog(&g_cfg, block, progged, g_buf, CACHE_SIZE);
+            progged += CACHE_SIZE;
+        }
+        if (pos >= BLOCK_SIZE) {
+            block = 2 + (block - 1) % (BLOCK_COUNT - 2);
+            g_cfg.erase(&g_cfg, block);
+            pos -= BLOCK_SIZE;
+            progged = 0;
+        }
+        if ((i + 1) % LOG_SYNC_EVERY == 0) {
+            lfs_off_t end = (pos + UNIT - 1) / UNIT * UNIT;
+            if (end > progged) {
+                g_cfg.prog(&g_cfg, block, progged, g_buf, end - progged);
+                progged = end;
+            }
+            if (meta_off + KV_COMMIT > BLOCK_SIZE) {
+                meta ^= 1;
+                g_cfg.erase(&g_cfg, meta);
+                meta_off = 0;
+            }
+            g_cfg.prog(&g_cfg, meta, meta_off, g_buf, KV_COMMIT);
+            g_cfg.read(&g_cfg, meta, meta_off, g_buf, KV_COMMIT);
+            meta_off += KV_COMMIT;
+            g_cfg.sync(&g_cfg);
+            copy_pending = (pos % BLOCK_SIZE) != 0;
+        }
+    }
+    Report("log");
+}
+
+int main(void)
+{
+    KvWorkload();
+    LogWorkload();
+    return 0;
+}
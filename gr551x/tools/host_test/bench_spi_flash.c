@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Read and write throughput of the external SPI flash driver in the mode it is built for, on the
+ * SPI NOR model clock: 64 KB in reads of 256 bytes to 16 KB, and 64 KB written through the pipelined
+ * writer. Bus time is the clock count at 8 MHz plus the assumed per-transfer cost in
+ * stubs/spi_bus_fake.h; page program time is the model's 700 us default. Not measured on silicon.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "gr551x_spi_flash.h"
+#include "spi_bus_fake.h"
+
+#ifndef SPI_FLASH_QUAD_ENABLE
+#define SPI_FLASH_QUAD_ENABLE   1
+#endif
+
+#define AREA_ADDR       0x40000
+#define AREA_SIZE       0x10000
+#define NS_PER_MS       1000000.0
+
+static uint8_t g_buf[AREA_SIZE];
+
+static void Init(void)
+{
+    flash_init_t init = {
+        .spi_type = FLASH_QSPI_ID1,
+        .flash_io = {
+            .spi_cs  = { APP_IO_TYPE_NORMAL, APP_IO_PIN_15, APP_IO_MUX_2 },
+            .spi_clk = { APP_IO_TYPE_NORMAL, APP_IO_PIN_9, APP_IO_MUX_2 },
+            .spi_io0 = { .qspi_io0 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_8, APP_IO_MUX_2 } },
+            .spi_io1 = { .qspi_io1 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_14, APP_IO_MUX_2 } },
+            .qspi_io2 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_13, APP_IO_MUX_2 },
+            .qspi_io3 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_12, APP_IO_MUX_2 },
+        },
+    };
+
+    CHECK(spi_flash_init(&init));
+    spi_bus_fake_idle();
+}
+
+static void Report(const char *what, uint32_t bytes, uint64_t ns)
+{
+    printf("spi_flash %-6s %-18s %6.2f ms  %7.1f KB/s\n", (spi_flash_mode_get() == SPI_FLASH_MODE_QUAD) ? "quad" :
+           "single", what, ns / NS_PER_MS, bytes / 1024.0 / (ns / 1e9));
+}
+
+static void BenchRead(void)
+{
+    static const uint32_t chunks[] = { 256, 4096, 16384 };
+
+    for (uint32_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        char what[32];
+        uint64_t start = spi_nor_now_ns();
+
+        for (uint32_t off = 0; off < AREA_SIZE; off += chunks[i]) {
+            CHECK(spi_flash_read(AREA_ADDR + off, g_buf + off, chunks[i]) == chunks[i]);
+        }
+        spi_bus_fake_idle();
+        snprintf(what, sizeof(what), "read 64 KB / %u", (unsigned)chunks[i]);
+        Report(what, AREA_SIZE, spi_nor_now_ns() - start);
+    }
+    CHECK(memcmp(g_buf, spi_nor_image() + AREA_ADDR, AREA_SIZE) == 0);
+}
+
+static void BenchWrite(bool timer)
+{
+    spi_flash_write_stats_t before;
+    spi_flash_write_stats_t after;
+    uint64_t start;
+
+    spi_flash_write_timer_register(timer ? spi_bus_fake_timer_start : NULL);
+    CHECK(spi_flash_sector_erase(AREA_ADDR, AREA_SIZE));
+    spi_bus_fake_idle();
+    spi_flash_write_stats_get(&before);
+    start = spi_nor_now_ns();
+    CHECK(spi_flash_write(AREA_ADDR, g_buf, AREA_SIZE) == AREA_SIZE);
+    spi_bus_fake_idle();
+    spi_flash_write_stats_get(&after);
+    Report(timer ? "write 64 KB timer" : "write 64 KB polled", AREA_SIZE, spi_nor_now_ns() - start);
+    printf("    %u pages, %.1f status polls per page\n", (unsigned)(after.pages - before.pages),
+           (double)(after.wip_polls - before.wip_polls) / (after.pages - before.pages));
+    CHECK(memcmp(g_buf, spi_nor_image() + AREA_ADDR, AREA_SIZE) == 0);
+}
+
+int main(void)
+{
+    struct spi_nor_part part;
+    struct spi_nor_stats st;
+
+    spi_nor_part_default(&part, SPI_NOR_QE_SR2_WRSR1);
+    CHECK(spi_nor_open(&part) == 0);
+    for (uint32_t i = 0; i < AREA_SIZE; i++) {
+        spi_nor_image()[AREA_ADDR + i] = (uint8_t)(i * 31 + 7);
+    }
+    spi_bus_fake_set_timer_handler(spi_flash_write_timer_expired);
+    Init();
+    CHECK((spi_flash_mode_get() == SPI_FLASH_MODE_QUAD) == (SPI_FLASH_QUAD_ENABLE == 1));
+
+    BenchRead();
+    BenchWrite(true);
+    BenchWrite(false);
+
+    spi_nor_get_stats(&st);
+    CHECK(st.violations == 0);
+    spi_nor_close();
+    return g_hostTestFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
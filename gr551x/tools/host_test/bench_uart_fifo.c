@@ -0,0 +1,106 @@
+/*
+ * RX interrupts per KB of app_uart.c in interrupt mode at 921600 baud on the fake UART, for each RX
+ * FIFO threshold and interrupt latencies of 3 us to 100 us: 32 KB arrive back to back into the
+ * 16-byte FIFO and are collected by the ring receive in 256-byte blocks. "headroom" is the time from
+ * the threshold to a full FIFO, the longest the interrupt can be held off without an overrun; "lost"
+ * the bytes dropped by overruns. Not measured on silicon.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "app_drv_fake.h"
+#include "app_uart.h"
+#include "uart_fake.h"
+
+#define BAUD                921600
+#define US                  1000ULL
+#define MS                  1000000ULL
+#define STREAM_SIZE         (32 * 1024)
+#define RX_RING_SIZE        4096
+#define TX_RING_SIZE        256
+
+static uint8_t g_rxRing[RX_RING_SIZE];
+static uint8_t g_txRing[TX_RING_SIZE];
+static uint8_t g_stream[STREAM_SIZE];
+static uint8_t g_got[STREAM_SIZE];
+
+static void Bench(uint32_t threshold, const char *name, uint32_t latency_us)
+{
+    app_uart_params_t params = {
+        .id = APP_UART_ID_0,
+        .pin_cfg = {
+            .tx = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_10, APP_IO_PULLUP },
+            .rx = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_11, APP_IO_PULLUP },
+        },
+        .use_mode = { APP_UART_TYPE_INTERRUPT, DMA_Channel0, DMA_Channel1 },
+        .init = {
+            .baud_rate = BAUD,
+            .data_bits = UART_DATABITS_8,
+            .stop_bits = UART_STOPBITS_1,
+            .parity = UART_PARITY_NONE,
+            .hw_flow_ctrl = UART_HWCONTROL_NONE,
+            .rx_timeout_mode = UART_RECEIVER_TIMEOUT_ENABLE,
+        },
+    };
+    app_uart_tx_buf_t tx_buf = { g_txRing, TX_RING_SIZE };
+    app_uart_irq_cfg_t irq_cfg = {
+        .rx_fifo_threshold = threshold,
+        .tx_fifo_threshold = LL_UART_TX_FIFO_TH_EMPTY,
+        .rx_block = 256,
+    };
+    struct uart_fake_stats st;
+    uint32_t got = 0;
+    uint32_t rx_th;
+    uint32_t tx_th;
+    double kb = STREAM_SIZE / 1024.0;
+
+    app_uart_deinit(APP_UART_ID_0);
+    uart_fake_reset();
+    app_drv_fake_reset();
+    uart_fake_set_irq_latency(latency_us * US);
+    CHECK(app_uart_irq_config(APP_UART_ID_0, &irq_cfg) == APP_DRV_SUCCESS);
+    CHECK(app_uart_init(&params, NULL, &tx_buf) == APP_DRV_SUCCESS);
+    CHECK(app_uart_receive_ring_start(APP_UART_ID_0, g_rxRing, RX_RING_SIZE) == APP_DRV_SUCCESS);
+    uart_fake_thresholds(APP_UART_ID_0, &rx_th, &tx_th);
+
+    uart_fake_rx_push(APP_UART_ID_0, g_stream, STREAM_SIZE);
+    while (uart_fake_rx_queued(APP_UART_ID_0) != 0) {
+        uart_fake_run(MS);
+        got += app_uart_receive_ring_read(APP_UART_ID_0, g_got + got, STREAM_SIZE - got);
+    }
+    uart_fake_run(10 * MS);
+    got += app_uart_receive_ring_read(APP_UART_ID_0, g_got + got, STREAM_SIZE - got);
+    uart_fake_get_stats(APP_UART_ID_0, &st);
+    CHECK(got + st.overruns == STREAM_SIZE);
+    if (st.overruns == 0) {
+        CHECK(memcmp(g_got, g_stream, STREAM_SIZE) == 0);
+    }
+
+    printf("uart rx %-12s latency %3u us  headroom %6.1f us  irqs %7.1f /KB  lost %5u B\n",
+           name, (unsigned)latency_us, (double)(UART_FAKE_FIFO_DEPTH - rx_th) * uart_fake_char_ns(APP_UART_ID_0) / US,
+           st.irqs / kb, (unsigned)st.overruns);
+}
+
+int main(void)
+{
+    static const struct {
+        uint32_t threshold;
+        const char *name;
+    } ths[] = {
+        { LL_UART_RX_FIFO_TH_CHAR_1, "CHAR_1" },
+        { LL_UART_RX_FIFO_TH_QUARTER_FULL, "QUARTER_FULL" },
+        { LL_UART_RX_FIFO_TH_HALF_FULL, "HALF_FULL" },
+        { LL_UART_RX_FIFO_TH_FULL_2, "FULL_2" },
+    };
+    static const uint32_t latencies[] = { 3, 20, 50, 100 };
+
+    for (uint32_t i = 0; i < STREAM_SIZE; i++) {
+        g_stream[i] = (uint8_t)(i * 31 + (i >> 8));
+    }
+    for (uint32_t i = 0; i < sizeof(ths) / sizeof(ths[0]); i++) {
+        for (uint32_t j = 0; j < sizeof(latencies) / sizeof(latencies[0]); j++) {
+            Bench(ths[i].threshold, ths[i].name, latencies[j]);
+        }
+    }
+    app_uart_deinit(APP_UART_ID_0);
+    return g_hostTestFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
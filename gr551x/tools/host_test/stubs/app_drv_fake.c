@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "app_dma.h"
+#include "app_io.h"
+#include "app_pwr_mgmt.h"
+#include "app_systick.h"
+#include "app_drv_fake.h"
+
+#define PIN_MAX             32
+
+static uint32_t g_pinLow[APP_IO_TYPE_MAX];
+static uint32_t g_pinFalls[APP_IO_TYPE_MAX][PIN_MAX];
+static dma_handle_t g_dma[DMA_Channel7 + 1];
+static bool g_dmaUsed[DMA_Channel7 + 1];
+
+static int PinIndex(uint32_t pin)
+{
+    for (int i = 0; i < PIN_MAX; i++) {
+        if (pin == (1UL << i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void app_drv_fake_reset(void)
+{
+    memset(g_pinLow, 0, sizeof(g_pinLow));
+    memset(g_pinFalls, 0, sizeof(g_pinFalls));
+    memset(g_dma, 0, sizeof(g_dma));
+    memset(g_dmaUsed, 0, sizeof(g_dmaUsed));
+}
+
+uint8_t app_drv_fake_pin_level(app_io_type_t type, uint32_t pin)
+{
+    return (type < APP_IO_TYPE_MAX && (g_pinLow[type] & pin)) ? 0 : 1;
+}
+
+uint32_t app_drv_fake_pin_falls(app_io_type_t type, uint32_t pin)
+{
+    int idx = PinIndex(pin);
+
+    return (type < APP_IO_TYPE_MAX && idx >= 0) ? g_pinFalls[type][idx] : 0;
+}
+
+uint16_t app_io_init(app_io_type_t type, app_io_init_t *p_init)
+{
+    return (type < APP_IO_TYPE_MAX && p_init != NULL) ? APP_DRV_SUCCESS : APP_DRV_ERR_INVALID_PARAM;
+}
+
+uint16_t app_io_deinit(app_io_type_t type, uint32_t pin)
+{
+    return (type < APP_IO_TYPE_MAX) ? APP_DRV_SUCCESS : APP_DRV_ERR_INVALID_PARAM;
+}
+
+uint16_t app_io_write_pin(app_io_type_t type, uint32_t pin, app_io_pin_state_t pin_state)
+{
+    int idx = PinIndex(pin);
+
+    if (type >= APP_IO_TYPE_MAX || idx < 0) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+    if (pin_state == APP_IO_PIN_RESET) {
+        if (!(g_pinLow[type] & pin)) {
+            g_pinFalls[type][idx]++;
+        }
+        g_pinLow[type] |= pin;
+    } else {
+        g_pinLow[type] &= ~pin;
+    }
+    return APP_DRV_SUCCESS;
+}
+
+int16_t app_dma_init(app_dma_params_t *p_params, app_dma_evt_handler_t evt_handler)
+{
+    dma_channel_t ch;
+
+    if (p_params == NULL || p_params->channel_number > DMA_Channel7) {
+        return -1;
+    }
+    ch = p_params->channel_number;
+    if (g_dmaUsed[ch]) {
+        return -1;
+    }
+    g_dmaUsed[ch] = true;
+    g_dma[ch].channel = ch;
+    g_dma[ch].init = p_params->init;
+    return (int16_t)ch;
+}
+
+uint16_t app_dma_deinit(int16_t ins_id)
+{
+    if (ins_id < 0 || ins_id > DMA_Channel7) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+    g_dmaUsed[ins_id] = false;
+    return APP_DRV_SUCCESS;
+}
+
+dma_handle_t *app_dma_get_handle(int16_t id)
+{
+    return (id >= 0 && id <= DMA_Channel7 && g_dmaUsed[id]) ? &g_dma[id] : NULL;
+}
+
+void app_systick_init(void)
+{
+}
+
+void app_systick_deinit(void)
+{
+}
+
+int16_t pwr_register_sleep_cb(const app_sleep_callbacks_t *p_cb, wakeup_priority_t wakeup_priority)
+{
+    return 0;
+}
+
+void pwr_unregister_sleep_cb(int16_t id)
+{
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * app_io, app_dma, app_systick and the sleep callback registry, for app drivers compiled from their
+ * own sources (app_spi.c, app_qspi.c, app_uart.c). app_io only remembers the level last written to
+ * each pin and counts the edges; app_dma hands out one handle per channel and moves no data, the
+ * peripheral fakes complete the transfers themselves.
+ */
+#ifndef __APP_DRV_FAKE_H__
+#define __APP_DRV_FAKE_H__
+
+#include <stdint.h>
+#include "app_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Forget pin levels, edge counts and DMA channels. Pins start high. */
+void app_drv_fake_reset(void);
+/* Level last written to one pin of a port, 1 when never written. */
+uint8_t app_drv_fake_pin_level(app_io_type_t type, uint32_t pin);
+/* Number of high-to-low writes to one pin since the last reset. */
+uint32_t app_drv_fake_pin_falls(app_io_type_t type, uint32_t pin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
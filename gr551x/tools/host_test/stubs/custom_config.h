@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Build configuration of the components under test: the optional modules the host tests cover are on. */
+#ifndef __HOST_CUSTOM_CONFIG_H__
+#define __HOST_CUSTOM_CONFIG_H__
+
+#ifndef APP_LOG_STORE_ENABLE
+#define APP_LOG_STORE_ENABLE    1
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The part of the HDF configuration interface the components under test call, served by hcs_fake.c. */
+#ifndef __HOST_DEVICE_RESOURCE_IF_H__
+#define __HOST_DEVICE_RESOURCE_IF_H__
+
+#include <stdint.h>
+#include "hdf_base.h"
+
+typedef enum {
+    HDF_CONFIG_SOURCE = 0,
+    INVALID,
+} DeviceResourceType;
+
+struct DeviceResourceNode;
+
+struct DeviceResourceIface {
+    const struct DeviceResourceNode *(*GetRootNode)(void);
+    /* HDF_SUCCESS, or HDF_FAILURE with *value set to def when the node has no such attribute. */
+    int32_t (*GetUint32)(const struct DeviceResourceNode *node, const char *attrName, uint32_t *value, uint32_t def);
+    const struct DeviceResourceNode *(*GetNodeByMatchAttr)(const struct DeviceResourceNode *node,
+                                                          const char *attrValue);
+};
+
+struct DeviceResourceIface *DeviceResourceGetIfaceInstance(DeviceResourceType type);
+
+#endif
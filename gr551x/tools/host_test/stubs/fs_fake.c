@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fs_fake.h"
+
+#define FS_FAKE_MOUNT       "/data"
+#define FS_FAKE_PATH_MAX    256
+#define FS_FAKE_NFTW_FDS    16
+
+int __real_open(const char *path, int flags, ...);
+int __real_close(int fd);
+ssize_t __real_read(int fd, void *buf, size_t len);
+ssize_t __real_write(int fd, const void *buf, size_t len);
+off_t __real_lseek(int fd, off_t offset, int whence);
+int __real_fstat(int fd, struct stat *st);
+int __real_fsync(int fd);
+int __real_unlink(const char *path);
+int __real_stat(const char *path, struct stat *st);
+
+static char g_root[FS_FAKE_PATH_MAX];
+static int g_failSkip = -1;
+static struct fs_fake_stats g_stats;
+
+/* Host path of a /data path, NULL with errno set if it is outside the mount. */
+static const char *FakePath(const char *path, char *out)
+{
+    size_t len = strlen(FS_FAKE_MOUNT);
+
+    if ((g_root[0] == '\0') || (strncmp(path, FS_FAKE_MOUNT, len) != 0) ||
+        ((path[len] != '/') && (path[len] != '\0'))) {
+        errno = ENOENT;
+        return NULL;
+    }
+    if (snprintf(out, FS_FAKE_PATH_MAX, "%s%s", g_root, path + len) >= FS_FAKE_PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    return out;
+}
+
+static int RemoveEntry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+void fs_fake_cleanup(void)
+{
+    if (g_root[0] != '\0') {
+        (void)nftw(g_root, RemoveEntry, FS_FAKE_NFTW_FDS, FTW_DEPTH | FTW_PHYS);
+        g_root[0] = '\0';
+    }
+}
+
+int fs_fake_reset(void)
+{
+    fs_fake_cleanup();
+    (void)snprintf(g_root, sizeof(g_root), "/tmp/fs_fake_XXXXXX");
+    if (mkdtemp(g_root) == NULL) {
+        g_root[0] = '\0';
+        return -1;
+    }
+    g_failSkip = -1;
+    memset(&g_stats, 0, sizeof(g_stats));
+    return 0;
+}
+
+void fs_fake_fail_write(int skip)
+{
+    g_failSkip = skip;
+}
+
+void fs_fake_get_stats(struct fs_fake_stats *stats)
+{
+    *stats = g_stats;
+}
+
+int __wrap_open(const char *path, int flags, ...)
+{
+    char host[FS_FAKE_PATH_MAX];
+    mode_t mode = 0;
+
+    if ((flags & O_CREAT) != 0) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    if (FakePath(path, host) == NULL) {
+        return -1;
+    }
+    g_stats.opens++;
+    /* littlefs creates files readable and writable whatever the mode. */
+    return __real_open(host, flags, ((flags & O_CREAT) != 0) ? (mode | 0600) : 0);
+}
+
+int __wrap_close(int fd)
+{
+    return __real_close(fd);
+}
+
+ssize_t __wrap_read(int fd, void *buf, size_t len)
+{
+    g_stats.reads++;
+    return __real_read(fd, buf, len);
+}
+
+ssize_t __wrap_write(int fd, const void *buf, size_t len)
+{
+    g_stats.writes++;
+    if (g_failSkip == 0) {
+        g_failSkip = -1;
+        errno = EIO;
+        return -1;
+    }
+    if (g_failSkip > 0) {
+        g_failSkip--;
+    }
+    return __real_write(fd, buf, len);
+}
+
+off_t __wrap_lseek(int fd, off_t offset, int whence)
+{
+    g_stats.seeks++;
+    return __real_lseek(fd, offset, whence);
+}
+
+int __wrap_fstat(int fd, struct stat *st)
+{
+    return __real_fstat(fd, st);
+}
+
+int __wrap_fsync(int fd)
+{
+    g_stats.syncs++;
+    return __real_fsync(fd);
+}
+
+int __wrap_unlink(const char *path)
+{
+    char host[FS_FAKE_PATH_MAX];
+
+    if (FakePath(path, host) == NULL) {
+        return -1;
+    }
+    return __real_unlink(host);
+}
+
+int __wrap_stat(const char *path, struct stat *st)
+{
+    char host[FS_FAKE_PATH_MAX];
+
+    if (FakePath(path, host) == NULL) {
+        return -1;
+    }
+    return __real_stat(host, st);
+}
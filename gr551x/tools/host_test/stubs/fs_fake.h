@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The POSIX file calls of code under test, redirected to a temporary directory with fault
+ * injection. Link with fs_fake.c and
+ *     -Wl,--wrap=open,--wrap=close,--wrap=read,--wrap=write,--wrap=lseek,--wrap=fstat,
+ *     --wrap=fsync,--wrap=unlink,--wrap=stat
+ * (FS_FAKE_LDFLAGS in the Makefile). Paths under /data, the littlefs mount point, land in the
+ * temporary directory, anything else fails.
+ */
+#ifndef __HOST_FS_FAKE_H__
+#define __HOST_FS_FAKE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct fs_fake_stats {
+    uint32_t opens;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t seeks;
+    uint32_t syncs;
+};
+
+/* Create an empty /data, dropping the previous one. Returns 0 on success. */
+int fs_fake_reset(void);
+/* Remove the temporary directory. */
+void fs_fake_cleanup(void);
+/* Fail the write after the next skip writes with EIO, -1 stops failing. */
+void fs_fake_fail_write(int skip);
+void fs_fake_get_stats(struct fs_fake_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The device header: the core registers and the LL calls come with the HAL definitions in gr55xx_hal.h. */
+#ifndef __HOST_GR55XX_H__
+#define __HOST_GR55XX_H__
+
+#include "gr55xx_hal.h"
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The GR551x HAL definitions the components under test use, mapped onto the flash simulator. */
+#ifndef __HOST_GR55XX_HAL_H__
+#define __HOST_GR55XX_HAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hal_flash_sim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EXFLASH_START_ADDR          FLASH_SIM_BASE_ADDR
+#define EXFLASH_SIZE_PAGE_BYTES     ((uint32_t)FLASH_SIM_PAGE_SIZE)
+#define EXFLASH_SIZE_SECTOR_BYTES   ((uint32_t)FLASH_SIM_SECTOR_SIZE)
+#define NVDS_NUM_SECTOR             1
+
+#define HAL_EXFLASH_UNENCRYPTED     0
+#define HAL_EXFLASH_ENCRYPTED       1
+
+typedef struct {
+    void     *p_xqspi;
+    uint32_t  flash_id;
+    uint32_t  flash_size;
+    uint32_t  security;
+} exflash_handle_t;
+
+#define SECTION_RAM_CODE
+#define __IO                        volatile
+
+#define ITEM_0                      0
+#define ITEM_1                      1
+#define ITEM_2                      2
+#define ITEM_3                      3
+#define ITEM_4                      4
+#define ITEM_5                      5
+#define ITEM_6                      6
+#define ITEM_7                      7
+#define __WEAK                      __attribute__((weak))
+
+/* Memory map of gr55xx.h. Host buffers all lie above GR55XX_RAM_ADDRESS. */
+#define GR55XX_FLASH_ADDRESS        0x01000000U
+#define GR55XX_RAM_ADDRESS          0x30000000U
+
+/* Interrupt masking is modelled by one global recursive lock, see los_shim.h. */
+void HostIrqDisable(void);
+void HostIrqEnable(void);
+/* True while the calling thread holds the lock, so that no interrupt can be taken on it. */
+bool HostIrqMasked(void);
+#define GLOBAL_EXCEPTION_DISABLE()  HostIrqDisable()
+#define GLOBAL_EXCEPTION_ENABLE()   HostIrqEnable()
+
+/* There is no BLE interrupt to hold off. */
+#define BLE_INT_DISABLE()           do { } while (0)
+#define BLE_INT_RESTORE()           do { } while (0)
+
+
+/* The cycle counter runs at SystemCoreClock on the flash simulator's modelled clock. */
+typedef struct {
+    uint32_t CTRL;
+    uint32_t CYCCNT;
+} HostDwt;
+
+typedef struct {
+    uint32_t DEMCR;
+} HostCoreDebug;
+
+#define HOST_CORE_CLOCK             64000000U
+#define DWT_CTRL_CYCCNTENA_Msk      0x1U
+#define CoreDebug_DEMCR_TRCENA_Msk  0x01000000U
+
+extern uint32_t SystemCoreClock;
+extern HostCoreDebug g_hostCoreDebug;
+HostDwt *HostDwtGet(void);
+#define DWT                         HostDwtGet()
+#define CoreDebug                   (&g_hostCoreDebug)
+
+/* Only the enable and pending bits of the NVIC, see los_shim.c. */
+typedef enum {
+    NonMaskableInt_IRQn = -14,
+    HardFault_IRQn = -13,
+    MemoryManagement_IRQn = -12,
+    BusFault_IRQn = -11,
+    UsageFault_IRQn = -10,
+    DMA_IRQn = 3,
+    SPI_M_IRQn = 4,
+    SPI_S_IRQn = 5,
+    HMAC_IRQn = 10,
+    QSPI0_IRQn = 11,
+    UART0_IRQn = 12,
+    UART1_IRQn = 13,
+    QSPI1_IRQn = 23,
+    HOST_IRQn_MAX = 64,
+} IRQn_Type;
+
+/*
+ * Interrupt handlers run from fake "interrupt" threads, between HostIsrEnter and HostIsrExit, and
+ * __get_IPSR reads as an exception number from HOST_EXC_IRQ_BASE on there. Between HostFaultEnter and
+ * HostFaultExit the calling thread models a fault handler instead: interrupts are masked and
+ * __get_IPSR reads as the number of the fault.
+ */
+#define HOST_EXC_IRQ_BASE           16
+void HostIsrEnter(void);
+void HostIsrExit(void);
+void HostFaultEnter(IRQn_Type irqn);
+void HostFaultExit(void);
+uint32_t __get_IPSR(void);
+/* 1 while interrupts are masked on the calling thread, see HostIrqMasked. */
+uint32_t __get_PRIMASK(void);
+
+void NVIC_EnableIRQ(IRQn_Type irqn);
+void NVIC_DisableIRQ(IRQn_Type irqn);
+uint32_t NVIC_GetEnableIRQ(IRQn_Type irqn);
+void NVIC_SetPendingIRQ(IRQn_Type irqn);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type irqn);
+void NVIC_ClearPendingIRQ(IRQn_Type irqn);
+
+#define hal_nvic_enable_irq(irqn)           NVIC_EnableIRQ(irqn)
+#define hal_nvic_disable_irq(irqn)          NVIC_DisableIRQ(irqn)
+#define hal_nvic_clear_pending_irq(irqn)    NVIC_ClearPendingIRQ(irqn)
+
+/* The XIP cache does not exist on the host. */
+#define XQSPI                       NULL
+#define ll_xqspi_enable_cache_flush(x)  ((void)(x))
+#define ll_xqspi_disable_cache_flush(x) ((void)(x))
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "gr55xx_hal_hmac.h"
+#include "gr55xx_hal_dma.h"
+#include "gr55xx_hal_qspi.h"
+#include "gr55xx_hal_uart.h"
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The DMA HAL types and constants the app drivers configure their channels with. The values are the host's own. */
+#ifndef __HOST_GR55XX_HAL_DMA_H__
+#define __HOST_GR55XX_HAL_DMA_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_DMA_MODULE_ENABLED
+
+typedef enum {
+    DMA_Channel0 = 0U,
+    DMA_Channel1,
+    DMA_Channel2,
+    DMA_Channel3,
+    DMA_Channel4,
+    DMA_Channel5,
+    DMA_Channel6,
+    DMA_Channel7,
+} dma_channel_t;
+
+#define DMA_REQUEST_SPIM_TX             0
+#define DMA_REQUEST_SPIM_RX             1
+#define DMA_REQUEST_SPIS_TX             2
+#define DMA_REQUEST_SPIS_RX             3
+#define DMA_REQUEST_QSPI0_TX            4
+#define DMA_REQUEST_QSPI0_RX            5
+#define DMA_REQUEST_QSPI1_TX            6
+#define DMA_REQUEST_QSPI1_RX            7
+#define DMA_REQUEST_MEM                 8
+#define DMA_REQUEST_UART0_TX            9
+#define DMA_REQUEST_UART0_RX            10
+
+#define DMA_MEMORY_TO_MEMORY            0
+#define DMA_MEMORY_TO_PERIPH            1
+#define DMA_PERIPH_TO_MEMORY            2
+
+#define DMA_SRC_INCREMENT               0
+#define DMA_SRC_DECREMENT               1
+#define DMA_SRC_NO_CHANGE               2
+#define DMA_DST_INCREMENT               0
+#define DMA_DST_DECREMENT               1
+#define DMA_DST_NO_CHANGE               2
+
+#define DMA_SDATAALIGN_BYTE             0
+#define DMA_SDATAALIGN_HALFWORD         1
+#define DMA_SDATAALIGN_WORD             2
+#define DMA_DDATAALIGN_BYTE             0
+#define DMA_DDATAALIGN_HALFWORD         1
+#define DMA_DDATAALIGN_WORD             2
+
+#define DMA_NORMAL                      0
+#define DMA_CIRCULAR                    1
+
+#define DMA_PRIORITY_LOW                0
+#define DMA_PRIORITY_MEDIUM             1
+#define DMA_PRIORITY_HIGH               2
+
+typedef struct _dma_init {
+    uint32_t src_request;
+    uint32_t dst_request;
+    uint32_t direction;
+    uint32_t src_increment;
+    uint32_t dst_increment;
+    uint32_t src_data_alignment;
+    uint32_t dst_data_alignment;
+    uint32_t mode;
+    uint32_t priority;
+} dma_init_t;
+
+typedef struct _dma_handle {
+    dma_channel_t channel;
+    dma_init_t    init;
+    void         *p_parent;
+} dma_handle_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_GR55XX_HAL_EXFLASH_H__
+#define __HOST_GR55XX_HAL_EXFLASH_H__
+
+/* Types named by libraries/hal_flash/hal_exflash_user_operation.h; the erase commands it declares
+ * are implemented by the flash simulator. */
+#include "gr55xx_hal.h"
+
+typedef struct xqspi_handle xqspi_handle_t;
+typedef struct xqspi_command xqspi_command_t;
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The HMAC HAL calls the components under test use, implemented by hmac_fake.c: a software SHA-256
+ * behind the DMA digest call, the engine's enable bit, and its interrupt raised in the host NVIC.
+ */
+#ifndef __HOST_GR55XX_HAL_HMAC_H__
+#define __HOST_GR55XX_HAL_HMAC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HMAC_MODE_SHA               0
+#define HAL_HMAC_KEYTYPE_MCU        0
+#define DISABLE                     0
+#define ENABLE                      1
+
+typedef struct {
+    uint32_t ctrl;
+} hmac_regs_t;
+
+extern hmac_regs_t g_hostHmacRegs;
+#define HMAC                        (&g_hostHmacRegs)
+
+typedef enum {
+    HAL_HMAC_STATE_RESET             = 0x00,
+    HAL_HMAC_STATE_READY             = 0x01,
+    HAL_HMAC_STATE_BUSY              = 0x02,
+    HAL_HMAC_STATE_ERROR             = 0x03,
+    HAL_HMAC_STATE_TIMEOUT           = 0x04,
+    HAL_HMAC_STATE_SUSPENDED         = 0x05,
+} hal_hmac_state_t;
+
+typedef struct {
+    uint32_t mode;
+    uint32_t *p_key;
+    uint32_t *p_user_hash;
+    uint32_t key_fetch_type;
+    uint32_t dpa_mode;
+} hmac_init_t;
+
+typedef struct {
+    hmac_regs_t                *p_instance;
+    hmac_init_t                init;
+    uint32_t                   *p_digest;
+    volatile hal_hmac_state_t  state;
+} hmac_handle_t;
+
+hal_status_t hal_hmac_init(hmac_handle_t *p_hmac);
+hal_status_t hal_hmac_deinit(hmac_handle_t *p_hmac);
+hal_status_t hal_hmac_sha256_digest_dma(hmac_handle_t *p_hmac, uint32_t *p_message,
+                                        uint32_t number, uint32_t *p_digest);
+void hal_hmac_irq_handler(hmac_handle_t *p_hmac);
+hal_hmac_state_t hal_hmac_get_state(hmac_handle_t *p_hmac);
+uint32_t ll_hmac_is_enabled(hmac_regs_t *HMACx);
+
+/* Fault injection and counters of the fake. */
+struct hmac_fake_stats {
+    uint32_t digests;               /* digests started */
+    uint64_t bytes;                 /* bytes hashed */
+    uint32_t stray_irqs;            /* completions raised while the HMAC IRQ was enabled in the NVIC */
+};
+
+void hmac_fake_reset(void);
+/* Another driver has the engine enabled: ll_hmac_is_enabled reads 1 until released. */
+void hmac_fake_set_foreign(bool in_use);
+/* Make the next digest_dma call fail to start. */
+void hmac_fake_fail_start(void);
+/* Make the next digest never complete. */
+void hmac_fake_hang(void);
+void hmac_fake_get_stats(struct hmac_fake_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The QSPI and SPI HAL types and calls app_qspi.c, app_spi.c and the SPI flash driver use, with the
+ * field names of drivers/inc. The register-level values are the host's own; spi_nor_model.c decodes them.
+ */
+#ifndef __HOST_GR55XX_HAL_QSPI_H__
+#define __HOST_GR55XX_HAL_QSPI_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_QSPI_MODULE_ENABLED
+#define HAL_SPI_MODULE_ENABLED
+
+#define SPIM_BASE                       0xA000C000UL
+#define SPIS_BASE                       0xA000C100UL
+#define QSPI0_BASE                      0xA000C200UL
+#define QSPI1_BASE                      0xA000C800UL
+
+typedef struct {
+    uint32_t reserved;
+} ssi_regs_t;
+
+#define SPIM                            ((ssi_regs_t *)SPIM_BASE)
+#define SPIS                            ((ssi_regs_t *)SPIS_BASE)
+#define QSPI0                           ((ssi_regs_t *)QSPI0_BASE)
+#define QSPI1                           ((ssi_regs_t *)QSPI1_BASE)
+
+#define HAL_QSPI_ERROR_NONE             0x00000000U
+#define HAL_QSPI_ERROR_TIMEOUT          0x00000001U
+#define HAL_QSPI_ERROR_TRANSFER         0x00000002U
+#define HAL_QSPI_ERROR_DMA              0x00000004U
+#define HAL_QSPI_ERROR_INVALID_PARAM    0x00000008U
+
+typedef enum {
+    HAL_QSPI_STATE_RESET             = 0x00,
+    HAL_QSPI_STATE_READY             = 0x01,
+    HAL_QSPI_STATE_BUSY              = 0x02,
+    HAL_QSPI_STATE_BUSY_INDIRECT_TX  = 0x12,
+    HAL_QSPI_STATE_BUSY_INDIRECT_RX  = 0x22,
+    HAL_QSPI_STATE_ERROR             = 0x04,
+} hal_qspi_state_t;
+
+#define QSPI_CLOCK_MODE_3               3
+
+#define QSPI_DATA_MODE_SPI              0
+#define QSPI_DATA_MODE_DUALSPI          1
+#define QSPI_DATA_MODE_QUADSPI          2
+
+#define QSPI_INSTSIZE_00_BITS           0
+#define QSPI_INSTSIZE_08_BITS           8
+#define QSPI_ADDRSIZE_00_BITS           0
+#define QSPI_ADDRSIZE_08_BITS           8
+#define QSPI_ADDRSIZE_16_BITS           16
+#define QSPI_ADDRSIZE_24_BITS           24
+#define QSPI_ADDRSIZE_32_BITS           32
+#define QSPI_DATASIZE_08_BITS           8
+#define QSPI_DATASIZE_32_BITS           32
+
+#define QSPI_INST_ADDR_ALL_IN_SPI       0
+#define QSPI_INST_IN_SPI_ADDR_IN_SPIFRF 1
+#define QSPI_INST_ADDR_ALL_IN_SPIFRF    2
+
+typedef struct _qspi_init_t {
+    uint32_t clock_prescaler;
+    uint32_t clock_mode;
+    uint32_t rx_sample_delay;
+} qspi_init_t;
+
+typedef struct _qspi_handle {
+    ssi_regs_t            *p_instance;
+    qspi_init_t            init;
+    uint8_t               *p_tx_buffer;
+    volatile uint32_t      tx_xfer_size;
+    volatile uint32_t      tx_xfer_count;
+    uint8_t               *p_rx_buffer;
+    volatile uint32_t      rx_xfer_size;
+    volatile uint32_t      rx_xfer_count;
+    dma_handle_t          *p_dma;
+    volatile hal_qspi_state_t state;
+    volatile uint32_t      error_code;
+} qspi_handle_t;
+
+typedef struct _qspi_command_t {
+    uint32_t instruction;
+    uint32_t address;
+    uint32_t instruction_size;
+    uint32_t address_size;
+    uint32_t dummy_cycles;
+    uint32_t data_size;
+    uint32_t instruction_address_mode;
+    uint32_t data_mode;
+    uint32_t length;
+} qspi_command_t;
+
+hal_status_t hal_qspi_init(qspi_handle_t *p_qspi);
+hal_status_t hal_qspi_deinit(qspi_handle_t *p_qspi);
+hal_qspi_state_t hal_qspi_get_state(qspi_handle_t *p_qspi);
+hal_status_t hal_qspi_suspend_reg(qspi_handle_t *p_qspi);
+hal_status_t hal_qspi_resume_reg(qspi_handle_t *p_qspi);
+void hal_qspi_irq_handler(qspi_handle_t *p_qspi);
+void hal_qspi_config_dma_qwrite_32b_patch(qspi_handle_t *p_qspi, bool enable_patch, uint32_t endian_mode);
+hal_status_t hal_qspi_command(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint32_t timeout);
+hal_status_t hal_qspi_command_it(qspi_handle_t *p_qspi, qspi_command_t *p_cmd);
+hal_status_t hal_qspi_command_dma(qspi_handle_t *p_qspi, qspi_command_t *p_cmd);
+hal_status_t hal_qspi_command_transmit(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data,
+    uint32_t timeout);
+hal_status_t hal_qspi_command_transmit_it(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data);
+hal_status_t hal_qspi_command_transmit_dma(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data);
+hal_status_t hal_qspi_command_receive(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data,
+    uint32_t timeout);
+hal_status_t hal_qspi_command_receive_it(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data);
+hal_status_t hal_qspi_command_receive_dma(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data);
+hal_status_t hal_qspi_transmit(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length, uint32_t timeout);
+hal_status_t hal_qspi_transmit_it(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length);
+hal_status_t hal_qspi_transmit_dma(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length);
+hal_status_t hal_qspi_receive(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length, uint32_t timeout);
+hal_status_t hal_qspi_receive_it(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length);
+hal_status_t hal_qspi_receive_dma(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length);
+void hal_qspi_tx_cplt_callback(qspi_handle_t *p_qspi);
+void hal_qspi_rx_cplt_callback(qspi_handle_t *p_qspi);
+void hal_qspi_error_callback(qspi_handle_t *p_qspi);
+
+#define SPI_DATASIZE_8BIT               8
+#define SPI_DATASIZE_16BIT              16
+#define SPI_POLARITY_LOW                0
+#define SPI_PHASE_1EDGE                 0
+#define SPI_TIMODE_DISABLE              0
+#define SPI_SLAVE_SELECT_0              1
+
+typedef struct _spi_init {
+    uint32_t data_size;
+    uint32_t clock_polarity;
+    uint32_t clock_phase;
+    uint32_t baudrate_prescaler;
+    uint32_t ti_mode;
+    uint32_t slave_select;
+} spi_init_t;
+
+#define HAL_SPI_ERROR_NONE              0x00000000U
+#define HAL_SPI_ERROR_TIMEOUT           0x00000001U
+#define HAL_SPI_ERROR_TRANSFER          0x00000002U
+#define HAL_SPI_ERROR_DMA               0x00000004U
+#define HAL_SPI_ERROR_INVALID_PARAM     0x00000008U
+
+typedef enum {
+    HAL_SPI_STATE_RESET        = 0x00,
+    HAL_SPI_STATE_READY        = 0x01,
+    HAL_SPI_STATE_BUSY         = 0x02,
+    HAL_SPI_STATE_BUSY_TX      = 0x12,
+    HAL_SPI_STATE_BUSY_RX      = 0x22,
+    HAL_SPI_STATE_BUSY_TX_RX   = 0x32,
+    HAL_SPI_STATE_ERROR        = 0x04,
+} hal_spi_state_t;
+
+typedef struct _spi_handle {
+    ssi_regs_t            *p_instance;
+    spi_init_t             init;
+    uint8_t               *p_tx_buffer;
+    volatile uint32_t      tx_xfer_size;
+    volatile uint32_t      tx_xfer_count;
+    uint8_t               *p_rx_buffer;
+    volatile uint32_t      rx_xfer_size;
+    volatile uint32_t      rx_xfer_count;
+    dma_handle_t          *p_dmatx;
+    dma_handle_t          *p_dmarx;
+    volatile hal_spi_state_t state;
+    volatile uint32_t      error_code;
+} spi_handle_t;
+
+hal_status_t hal_spi_init(spi_handle_t *p_spi);
+hal_status_t hal_spi_deinit(spi_handle_t *p_spi);
+hal_spi_state_t hal_spi_get_state(spi_handle_t *p_spi);
+hal_status_t hal_spi_suspend_reg(spi_handle_t *p_spi);
+hal_status_t hal_spi_resume_reg(spi_handle_t *p_spi);
+void hal_spi_irq_handler(spi_handle_t *p_spi);
+hal_status_t hal_spi_transmit(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length, uint32_t timeout);
+hal_status_t hal_spi_transmit_it(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length);
+hal_status_t hal_spi_transmit_dma(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length);
+hal_status_t hal_spi_receive(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length, uint32_t timeout);
+hal_status_t hal_spi_receive_it(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length);
+hal_status_t hal_spi_receive_dma(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length);
+hal_status_t hal_spi_transmit_receive(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t length, uint32_t timeout);
+hal_status_t hal_spi_transmit_receive_it(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t length);
+hal_status_t hal_spi_transmit_receive_dma(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t length);
+hal_status_t hal_spi_read_eeprom(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t tx_number_data, uint32_t rx_number_data, uint32_t timeout);
+hal_status_t hal_spi_read_eeprom_it(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t tx_number_data, uint32_t rx_number_data);
+hal_status_t hal_spi_read_eeprom_dma(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t tx_number_data, uint32_t rx_number_data);
+void hal_spi_tx_cplt_callback(spi_handle_t *p_spi);
+void hal_spi_rx_cplt_callback(spi_handle_t *p_spi);
+void hal_spi_tx_rx_cplt_callback(spi_handle_t *p_spi);
+void hal_spi_error_callback(spi_handle_t *p_spi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The UART HAL and LL types and calls app_uart.c uses, with the field names and register values of
+ * drivers/inc. The calls are implemented by uart_fake.c; the HAL itself is in ROM on the device.
+ */
+#ifndef __HOST_GR55XX_HAL_UART_H__
+#define __HOST_GR55XX_HAL_UART_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_UART_MODULE_ENABLED
+
+#define UART0_BASE                      0xA000C600UL
+#define UART1_BASE                      0xA000C700UL
+
+typedef struct {
+    uint32_t reserved;
+} uart_regs_t;
+
+#define UART0                           ((uart_regs_t *)UART0_BASE)
+#define UART1                           ((uart_regs_t *)UART1_BASE)
+
+#define LL_UART_LSR_OE                  0x02U
+#define LL_UART_LSR_PE                  0x04U
+#define LL_UART_LSR_FE                  0x08U
+#define LL_UART_LSR_BI                  0x10U
+
+#define LL_UART_IER_RDA                 0x01U
+#define LL_UART_IER_THRE                0x82U
+#define LL_UART_IER_RLS                 0x04U
+
+#define LL_UART_TX_FIFO_TH_EMPTY        0x00000000U
+#define LL_UART_TX_FIFO_TH_CHAR_2       0x00000001U
+#define LL_UART_TX_FIFO_TH_QUARTER_FULL 0x00000002U
+#define LL_UART_TX_FIFO_TH_HALF_FULL    0x00000003U
+
+#define LL_UART_RX_FIFO_TH_CHAR_1       0x00000000U
+#define LL_UART_RX_FIFO_TH_QUARTER_FULL 0x00000001U
+#define LL_UART_RX_FIFO_TH_HALF_FULL    0x00000002U
+#define LL_UART_RX_FIFO_TH_FULL_2       0x00000003U
+
+#define UART_DATABITS_5                 0x00U
+#define UART_DATABITS_6                 0x01U
+#define UART_DATABITS_7                 0x02U
+#define UART_DATABITS_8                 0x03U
+#define UART_STOPBITS_1                 0x00U
+#define UART_STOPBITS_1_5               0x04U
+#define UART_STOPBITS_2                 0x04U
+#define UART_PARITY_NONE                0x00U
+#define UART_PARITY_ODD                 0x08U
+#define UART_PARITY_EVEN                0x18U
+#define UART_HWCONTROL_NONE             0x00U
+#define UART_HWCONTROL_RTS_CTS          0x22U
+#define UART_RECEIVER_TIMEOUT_DISABLE   0x00U
+#define UART_RECEIVER_TIMEOUT_ENABLE    0x01U
+
+#define UART_IT_RLS                     LL_UART_IER_RLS
+#define UART_IT_THRE                    LL_UART_IER_THRE
+#define UART_IT_RDA                     LL_UART_IER_RDA
+
+#define HAL_UART_ERROR_NONE             0x00000000U
+#define HAL_UART_ERROR_PE               LL_UART_LSR_PE
+#define HAL_UART_ERROR_FE               LL_UART_LSR_FE
+#define HAL_UART_ERROR_OE               LL_UART_LSR_OE
+#define HAL_UART_ERROR_BI               LL_UART_LSR_BI
+#define HAL_UART_ERROR_DMA              0x00000100U
+#define HAL_UART_ERROR_BUSY             0x00000200U
+
+typedef enum {
+    HAL_UART_STATE_RESET     = 0x00U,
+    HAL_UART_STATE_READY     = 0x10U,
+    HAL_UART_STATE_BUSY      = 0x14U,
+    HAL_UART_STATE_BUSY_TX   = 0x11U,
+    HAL_UART_STATE_BUSY_RX   = 0x12U,
+    HAL_UART_STATE_BUSY_TXRX = 0x13U,
+    HAL_UART_STATE_TIMEOUT   = 0x30U,
+    HAL_UART_STATE_ERROR     = 0x70U,
+} hal_uart_state_t;
+
+typedef struct _uart_init {
+    uint32_t baud_rate;
+    uint32_t data_bits;
+    uint32_t stop_bits;
+    uint32_t parity;
+    uint32_t hw_flow_ctrl;
+    uint32_t rx_timeout_mode;
+} uart_init_t;
+
+typedef struct _uart_handle {
+    uart_regs_t           *p_instance;
+    uart_init_t            init;
+    uint8_t               *p_tx_buffer;
+    uint16_t               tx_xfer_size;
+    volatile uint16_t      tx_xfer_count;
+    uint8_t               *p_rx_buffer;
+    uint16_t               rx_xfer_size;
+    volatile uint16_t      rx_xfer_count;
+    dma_handle_t          *p_dmatx;
+    dma_handle_t          *p_dmarx;
+    volatile hal_uart_state_t tx_state;
+    volatile hal_uart_state_t rx_state;
+    volatile uint32_t      error_code;
+} uart_handle_t;
+
+hal_status_t hal_uart_init(uart_handle_t *p_uart);
+hal_status_t hal_uart_deinit(uart_handle_t *p_uart);
+hal_uart_state_t hal_uart_get_state(uart_handle_t *p_uart);
+hal_status_t hal_uart_suspend_reg(uart_handle_t *p_uart);
+hal_status_t hal_uart_resume_reg(uart_handle_t *p_uart);
+void hal_uart_irq_handler(uart_handle_t *p_uart);
+hal_status_t hal_uart_transmit(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size, uint32_t timeout);
+hal_status_t hal_uart_receive(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size, uint32_t timeout);
+hal_status_t hal_uart_transmit_it(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size);
+hal_status_t hal_uart_receive_it(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size);
+hal_status_t hal_uart_transmit_dma(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size);
+hal_status_t hal_uart_receive_dma(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size);
+hal_status_t hal_uart_abort_transmit_it(uart_handle_t *p_uart);
+hal_status_t hal_uart_abort_receive(uart_handle_t *p_uart);
+void hal_uart_tx_cplt_callback(uart_handle_t *p_uart);
+void hal_uart_rx_cplt_callback(uart_handle_t *p_uart);
+void hal_uart_error_callback(uart_handle_t *p_uart);
+void hal_uart_abort_tx_cplt_callback(uart_handle_t *p_uart);
+void hal_uart_abort_rx_cplt_callback(uart_handle_t *p_uart);
+
+void ll_uart_enable_it(uart_regs_t *UARTx, uint32_t mask);
+void ll_uart_set_rx_fifo_threshold(uart_regs_t *UARTx, uint32_t threshold);
+void ll_uart_set_tx_fifo_threshold(uart_regs_t *UARTx, uint32_t threshold);
+uint32_t ll_uart_is_enabled_fifo(uart_regs_t *UARTx);
+uint32_t ll_uart_is_active_flag_rfne(uart_regs_t *UARTx);
+uint32_t ll_uart_is_active_flag_tfnf(uart_regs_t *UARTx);
+uint32_t ll_uart_is_active_flag_tfe(uart_regs_t *UARTx);
+uint8_t ll_uart_receive_data8(uart_regs_t *UARTx);
+void ll_uart_transmit_data8(uart_regs_t *UARTx, uint8_t value);
+
+#define HAL_UART_ENABLE_IT(__HANDLE__, __INTERRUPT__)               \
+do {                                                                \
+    GLOBAL_EXCEPTION_DISABLE();                                     \
+    ll_uart_enable_it((__HANDLE__)->p_instance, (__INTERRUPT__));   \
+    GLOBAL_EXCEPTION_ENABLE();                                      \
+} while (0U)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_GR55XX_PWR_H__
+#define __HOST_GR55XX_PWR_H__
+
+typedef enum {
+    PMR_MGMT_ACTIVE_MODE = 0x0,
+    PMR_MGMT_IDLE_MODE,
+    PMR_MGMT_SLEEP_MODE,
+} pwr_mgmt_mode_t;
+
+typedef enum {
+    DEVICE_BUSY = 0x0,
+    DEVICE_IDLE,
+} pwr_mgmt_dev_state_t;
+
+/* Returns what the test set with HostBasebandStateSet, PMR_MGMT_ACTIVE_MODE by default. */
+pwr_mgmt_mode_t pwr_mgmt_baseband_state_get(void);
+void HostBasebandStateSet(pwr_mgmt_mode_t mode);
+
+#endif
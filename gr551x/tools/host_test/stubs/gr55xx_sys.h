@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The SDK error codes and NVDS calls used by the components under test. A test that needs NVDS
+ * provides nvds_get and nvds_put. */
+#ifndef __HOST_GR55XX_SYS_H__
+#define __HOST_GR55XX_SYS_H__
+
+#include <stdint.h>
+
+#define SDK_SUCCESS                 0x0000
+#define SDK_ERR_INVALID_PARAM       0x0001
+#define SDK_ERR_POINTER_NULL        0x0002
+#define SDK_ERR_BUSY                0x0006
+#define SDK_ERR_SDK_INTERNAL        0x000c
+#define SDK_ERR_DISALLOWED          0x000f
+
+typedef uint16_t sdk_err_t;
+
+enum {
+    NVDS_SUCCESS,
+    NVDS_FAIL,
+    NVDS_TAG_NOT_EXISTED,
+};
+
+typedef unsigned short NvdsTag_t;
+
+uint8_t nvds_get(NvdsTag_t tag, uint16_t *p_len, uint8_t *p_buf);
+uint8_t nvds_put(NvdsTag_t tag, uint16_t len, const uint8_t *p_buf);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "device_resource_if.h"
+#include "hcs_fake.h"
+
+struct DeviceResourceNode {
+    const char *match_attr;
+    uint32_t attr_count;
+    struct {
+        const char *name;
+        uint32_t value;
+    } attrs[HCS_FAKE_ATTRS];
+};
+
+static struct DeviceResourceNode g_root;
+static struct DeviceResourceNode g_nodes[HCS_FAKE_NODES];
+static uint32_t g_nodeCount;
+
+void hcs_fake_reset(void)
+{
+    memset(g_nodes, 0, sizeof(g_nodes));
+    g_nodeCount = 0;
+}
+
+static struct DeviceResourceNode *FindNode(const char *match_attr)
+{
+    for (uint32_t i = 0; i < g_nodeCount; i++) {
+        if (strcmp(g_nodes[i].match_attr, match_attr) == 0) {
+            return &g_nodes[i];
+        }
+    }
+    return NULL;
+}
+
+void hcs_fake_set_uint32(const char *match_attr, const char *name, uint32_t value)
+{
+    struct DeviceResourceNode *node = FindNode(match_attr);
+
+    if (node == NULL) {
+        if (g_nodeCount == HCS_FAKE_NODES) {
+            abort();
+        }
+        node = &g_nodes[g_nodeCount++];
+        node->match_attr = match_attr;
+    }
+    for (uint32_t i = 0; i < node->attr_count; i++) {
+        if (strcmp(node->attrs[i].name, name) == 0) {
+            node->attrs[i].value = value;
+            return;
+        }
+    }
+    if (node->attr_count == HCS_FAKE_ATTRS) {
+        abort();
+    }
+    node->attrs[node->attr_count].name = name;
+    node->attrs[node->attr_count].value = value;
+    node->attr_count++;
+}
+
+static const struct DeviceResourceNode *GetRootNode(void)
+{
+    return &g_root;
+}
+
+static int32_t GetUint32(const struct DeviceResourceNode *node, const char *attrName, uint32_t *value, uint32_t def)
+{
+    if (node == NULL || attrName == NULL || value == NULL) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+    for (uint32_t i = 0; i < node->attr_count; i++) {
+        if (strcmp(node->attrs[i].name, attrName) == 0) {
+            *value = node->attrs[i].value;
+            return HDF_SUCCESS;
+        }
+    }
+    *value = def;
+    return HDF_FAILURE;
+}
+
+static const struct DeviceResourceNode *GetNodeByMatchAttr(const struct DeviceResourceNode *node,
+                                                          const char *attrValue)
+{
+    return (node == &g_root && attrValue != NULL) ? FindNode(attrValue) : NULL;
+}
+
+struct DeviceResourceIface *DeviceResourceGetIfaceInstance(DeviceResourceType type)
+{
+    static struct DeviceResourceIface iface = {
+        .GetRootNode = GetRootNode,
+        .GetUint32 = GetUint32,
+        .GetNodeByMatchAttr = GetNodeByMatchAttr,
+    };
+
+    return (type == HDF_CONFIG_SOURCE) ? &iface : NULL;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The device configuration tree of the HDF, as flat nodes found by match_attr, each with a few
+ * uint32 attributes. A node exists once an attribute is set on it.
+ */
+#ifndef __HCS_FAKE_H__
+#define __HCS_FAKE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HCS_FAKE_NODES      4
+#define HCS_FAKE_ATTRS      8
+
+/* Forget every node. */
+void hcs_fake_reset(void);
+void hcs_fake_set_uint32(const char *match_attr, const char *name, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_HDF_LOG_H__
+#define __HOST_HDF_LOG_H__
+
+#include <stdio.h>
+
+/* Errors and warnings go to stderr, the rest is dropped to keep test output short. */
+#define HDF_LOGE(fmt, ...)  fprintf(stderr, "E " fmt "\n", ##__VA_ARGS__)
+#define HDF_LOGW(fmt, ...)  fprintf(stderr, "W " fmt "\n", ##__VA_ARGS__)
+#define HDF_LOGI(fmt, ...)  ((void)0)
+#define HDF_LOGD(fmt, ...)  ((void)0)
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * HMAC engine fake. A DMA digest hashes its source in software, charges the modelled time to the
+ * flash simulator's clock and raises HMAC_IRQn; hal_hmac_irq_handler then delivers the digest. DMA
+ * sources in the flash window are read from the simulator image, as the engine reads them through XIP.
+ */
+#include <string.h>
+#include "gr55xx_hal.h"
+
+/*
+ * Assumed engine throughput, one 64 byte block per 64 cycles at 64 MHz; not a datasheet figure.
+ * Sources in flash are also limited by the XIP read rate, which is the simulator's read_ns_per_byte.
+ */
+#define HMAC_FAKE_NS_PER_BYTE       16
+#define NS_PER_US                   1000
+#define SHA256_BLOCK                64
+#define SHA256_WORDS                8
+
+hmac_regs_t g_hostHmacRegs;
+
+static struct hmac_fake_stats g_stats;
+static bool g_foreign;
+static bool g_failStart;
+static bool g_hang;
+static hmac_handle_t *g_owner;       /* handle whose digest completes in hal_hmac_irq_handler */
+static uint32_t g_digest[SHA256_WORDS];
+
+static const uint32_t g_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t Ror(uint32_t x, uint32_t n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static void Sha256Block(uint32_t *h, const uint8_t *p)
+{
+    uint32_t w[64];
+    uint32_t v[SHA256_WORDS];
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) | ((uint32_t)p[4 * i + 2] << 8) |
+               p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = Ror(w[i - 15], 7) ^ Ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = Ror(w[i - 2], 17) ^ Ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    memcpy(v, h, sizeof(v));
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = v[7] + (Ror(v[4], 6) ^ Ror(v[4], 11) ^ Ror(v[4], 25)) + ((v[4] & v[5]) ^ (~v[4] & v[6])) +
+                      g_k[i] + w[i];
+        uint32_t t2 = (Ror(v[0], 2) ^ Ror(v[0], 13) ^ Ror(v[0], 22)) +
+                      ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(&v[1], &v[0], 7 * sizeof(v[0]));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < SHA256_WORDS; i++) {
+        h[i] += v[i];
+    }
+}
+
+static void Sha256(const uint8_t *p, uint32_t size, uint32_t *h)
+{
+    static const uint32_t init[SHA256_WORDS] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    uint8_t tail[2 * SHA256_BLOCK] = {0};
+    uint32_t rest = size % SHA256_BLOCK;
+    uint32_t tail_len = (rest < SHA256_BLOCK - 8) ? SHA256_BLOCK : 2 * SHA256_BLOCK;
+    uint64_t bits = (uint64_t)size * 8;
+
+    memcpy(h, init, sizeof(init));
+    for (uint32_t off = 0; off + SHA256_BLOCK <= size; off += SHA256_BLOCK) {
+        Sha256Block(h, p + off);
+    }
+    memcpy(tail, p + size - rest, rest);
+    tail[rest] = 0x80;
+    for (int i = 0; i < 8; i++) {
+        tail[tail_len - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    for (uint32_t off = 0; off < tail_len; off += SHA256_BLOCK) {
+        Sha256Block(h, tail + off);
+    }
+}
+
+/* Where the engine's DMA finds the source, and how long it takes to stream it. */
+static const uint8_t *DmaSource(const void *p_src, uint32_t size, uint64_t *p_ns)
+{
+    struct flash_sim_timing timing;
+    uint32_t id;
+    uint32_t flash_size;
+    uintptr_t addr = (uintptr_t)p_src;
+
+    *p_ns = (uint64_t)size * HMAC_FAKE_NS_PER_BYTE;
+    hal_flash_get_info(&id, &flash_size);
+    if (addr < FLASH_SIM_BASE_ADDR || addr - FLASH_SIM_BASE_ADDR + size > flash_size) {
+        return p_src;
+    }
+    flash_sim_get_timing(&timing);
+    if (timing.read_ns_per_byte > HMAC_FAKE_NS_PER_BYTE) {
+        *p_ns = (uint64_t)size * timing.read_ns_per_byte;
+    }
+    return flash_sim_image() + (addr - FLASH_SIM_BASE_ADDR);
+}
+
+hal_status_t hal_hmac_init(hmac_handle_t *p_hmac)
+{
+    if (p_hmac == NULL || p_hmac->p_instance != HMAC || p_hmac->init.mode != HMAC_MODE_SHA) {
+        return HAL_ERROR;
+    }
+    p_hmac->state = HAL_HMAC_STATE_READY;
+    return HAL_OK;
+}
+
+hal_status_t hal_hmac_deinit(hmac_handle_t *p_hmac)
+{
+    if (g_owner == p_hmac) {
+        g_owner = NULL;
+        HMAC->ctrl = 0;
+    }
+    p_hmac->state = HAL_HMAC_STATE_RESET;
+    return HAL_OK;
+}
+
+hal_status_t hal_hmac_sha256_digest_dma(hmac_handle_t *p_hmac, uint32_t *p_message, uint32_t number,
+                                        uint32_t *p_digest)
+{
+    const uint8_t *p_src;
+    uint64_t ns;
+
+    if (p_hmac->state != HAL_HMAC_STATE_READY || g_foreign) {
+        return HAL_BUSY;
+    }
+    if (g_failStart || ((uintptr_t)p_message & 0x3) != 0 || number == 0) {
+        g_failStart = false;
+        return HAL_ERROR;
+    }
+    HMAC->ctrl = 1;
+    p_hmac->state = HAL_HMAC_STATE_BUSY;
+    p_hmac->p_digest = p_digest;
+    g_owner = p_hmac;
+    g_stats.digests++;
+    if (g_hang) {
+        g_hang = false;
+        return HAL_OK;
+    }
+    p_src = DmaSource(p_message, number, &ns);
+    Sha256(p_src, number, g_digest);
+    g_stats.bytes += number;
+    flash_sim_advance((uint32_t)(ns / NS_PER_US));
+    if (NVIC_GetEnableIRQ(HMAC_IRQn)) {
+        g_stats.stray_irqs++;
+    }
+    NVIC_SetPendingIRQ(HMAC_IRQn);
+    return HAL_OK;
+}
+
+void hal_hmac_irq_handler(hmac_handle_t *p_hmac)
+{
+    if (g_owner != p_hmac) {
+        return;
+    }
+    memcpy(p_hmac->p_digest, g_digest, sizeof(g_digest));
+    p_hmac->state = HAL_HMAC_STATE_READY;
+    g_owner = NULL;
+    HMAC->ctrl = 0;
+}
+
+hal_hmac_state_t hal_hmac_get_state(hmac_handle_t *p_hmac)
+{
+    return p_hmac->state;
+}
+
+uint32_t ll_hmac_is_enabled(hmac_regs_t *HMACx)
+{
+    return (HMACx->ctrl != 0 || g_foreign) ? 1 : 0;
+}
+
+void hmac_fake_reset(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_foreign = false;
+    g_failStart = false;
+    g_hang = false;
+    g_owner = NULL;
+    HMAC->ctrl = 0;
+}
+
+void hmac_fake_set_foreign(bool in_use)
+{
+    g_foreign = in_use;
+}
+
+void hmac_fake_fail_start(void)
+{
+    g_failStart = true;
+}
+
+void hmac_fake_hang(void)
+{
+    g_hang = true;
+}
+
+void hmac_fake_get_stats(struct hmac_fake_stats *stats)
+{
+    *stats = g_stats;
+}
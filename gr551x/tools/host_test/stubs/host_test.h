@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int g_hostTestFailed;
+
+#define CHECK(cond) do {                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            g_hostTestFailed++;                                             \
+        }                                                                   \
+    } while (0)
+
+/* Print the verdict of a test program and return its exit code. */
+static inline int HostTestResult(const char *name)
+{
+    printf("%s: %s\n", name, g_hostTestFailed ? "FAILED" : "ok");
+    return g_hostTestFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The OHOS IoT UART API, as base/iot_hardware/peripheral/interfaces/kits declares it. */
+#ifndef __HOST_IOT_UART_H__
+#define __HOST_IOT_UART_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    IOT_UART_DATA_BIT_5 = 5,
+    IOT_UART_DATA_BIT_6,
+    IOT_UART_DATA_BIT_7,
+    IOT_UART_DATA_BIT_8,
+} IotUartIdxDataBit;
+
+typedef enum {
+    IOT_UART_STOP_BIT_1 = 1,
+    IOT_UART_STOP_BIT_2 = 2,
+} IotUartStopBit;
+
+typedef enum {
+    IOT_UART_PARITY_NONE = 0,
+    IOT_UART_PARITY_ODD = 1,
+    IOT_UART_PARITY_EVEN = 2,
+} IotUartParity;
+
+typedef enum {
+    IOT_UART_BLOCK_STATE_BLOCK = 0,
+    IOT_UART_BLOCK_STATE_NONE_BLOCK,
+} IotUartBlockState;
+
+typedef enum {
+    IOT_FLOW_CTRL_NONE,
+    IOT_FLOW_CTRL_RTS_CTS,
+    IOT_FLOW_CTRL_RTS_ONLY,
+    IOT_FLOW_CTRL_CTS_ONLY,
+} IotFlowCtrl;
+
+typedef struct {
+    unsigned int baudRate;
+    unsigned char dataBits;
+    unsigned char stopBits;
+    unsigned char parity;
+    unsigned char rxBlock;
+    unsigned char txBlock;
+    unsigned char pad;
+} IotUartAttribute;
+
+unsigned int IoTUartInit(unsigned int id, const IotUartAttribute *param);
+int IoTUartRead(unsigned int id, unsigned char *data, unsigned int dataLen);
+int IoTUartWrite(unsigned int id, const unsigned char *data, unsigned int dataLen);
+unsigned int IoTUartDeinit(unsigned int id);
+unsigned int IoTUartSetFlowCtrl(unsigned int id, IotFlowCtrl flowCtrl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Just enough of the littlefs v2 API (lfs.h/lfs_util.h) to build the littlefs glue on the host,
+ * with the same type, field and constant names. The filesystem itself is modelled by lfs_fake.c,
+ * which the tests load with used blocks and files. littlefs proper lives in //third_party/littlefs
+ * and is not part of this tree.
+ */
+#ifndef __HOST_LFS_H__
+#define __HOST_LFS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t lfs_size_t;
+typedef uint32_t lfs_off_t;
+typedef int32_t  lfs_ssize_t;
+typedef int32_t  lfs_soff_t;
+typedef uint32_t lfs_block_t;
+
+enum lfs_error {
+    LFS_ERR_OK          = 0,
+    LFS_ERR_IO          = -5,
+    LFS_ERR_CORRUPT     = -84,
+    LFS_ERR_NOENT       = -2,
+    LFS_ERR_NOMEM       = -12,
+    LFS_ERR_INVAL       = -22,
+};
+
+enum lfs_type {
+    LFS_TYPE_REG        = 0x001,
+    LFS_TYPE_DIR        = 0x002,
+};
+
+enum lfs_open_flags {
+    LFS_O_RDONLY        = 1,
+    LFS_O_WRONLY        = 2,
+    LFS_O_RDWR          = 3,
+    LFS_F_DIRTY         = 0x010000,
+    LFS_F_WRITING       = 0x020000,
+    LFS_F_READING       = 0x040000,
+    LFS_F_INLINE        = 0x100000,
+};
+
+enum lfs_whence_flags {
+    LFS_SEEK_SET        = 0,
+    LFS_SEEK_CUR        = 1,
+    LFS_SEEK_END        = 2,
+};
+
+struct lfs_config {
+    void *context;
+    int (*read)(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size);
+    int (*prog)(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size);
+    int (*erase)(const struct lfs_config *c, lfs_block_t block);
+    int (*sync)(const struct lfs_config *c);
+    lfs_size_t read_size;
+    lfs_size_t prog_size;
+    lfs_size_t block_size;
+    lfs_size_t block_count;
+    int32_t block_cycles;
+    lfs_size_t cache_size;
+    lfs_size_t lookahead_size;
+    void *read_buffer;
+    void *prog_buffer;
+    void *lookahead_buffer;
+    lfs_size_t name_max;
+    lfs_size_t file_max;
+    lfs_size_t attr_max;
+};
+
+typedef struct lfs_cache {
+    lfs_block_t block;
+    lfs_off_t off;
+    lfs_size_t size;
+    uint8_t *buffer;
+} lfs_cache_t;
+
+typedef struct lfs_mdir {
+    lfs_block_t pair[2];
+    uint32_t rev;
+    lfs_off_t off;
+} lfs_mdir_t;
+
+typedef struct lfs_file {
+    struct lfs_file *next;
+    uint16_t id;
+    uint8_t type;
+    lfs_mdir_t m;
+    struct lfs_ctz {
+        lfs_block_t head;
+        lfs_size_t size;
+    } ctz;
+    uint32_t flags;
+    lfs_off_t pos;
+    lfs_block_t block;
+    lfs_off_t off;
+    lfs_cache_t cache;
+    const void *cfg;
+} lfs_file_t;
+
+typedef struct lfs {
+    lfs_cache_t rcache;
+    lfs_cache_t pcache;
+    lfs_block_t root[2];
+    struct lfs_mlist {
+        struct lfs_mlist *next;
+        uint16_t id;
+        uint8_t type;
+        lfs_mdir_t m;
+    } *mlist;
+    uint32_t seed;
+    const struct lfs_config *cfg;
+} lfs_t;
+
+static inline uint32_t lfs_min(uint32_t a, uint32_t b)
+{
+    return (a < b) ? a : b;
+}
+
+static inline uint32_t lfs_max(uint32_t a, uint32_t b)
+{
+    return (a > b) ? a : b;
+}
+
+int lfs_fs_traverse(lfs_t *lfs, int (*cb)(void *data, lfs_block_t block), void *data);
+int lfs_file_open(lfs_t *lfs, lfs_file_t *file, const char *path, int flags);
+int lfs_file_close(lfs_t *lfs, lfs_file_t *file);
+lfs_soff_t lfs_file_seek(lfs_t *lfs, lfs_file_t *file, lfs_soff_t off, int whence);
+lfs_ssize_t lfs_file_read(lfs_t *lfs, lfs_file_t *file, void *buffer, lfs_size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
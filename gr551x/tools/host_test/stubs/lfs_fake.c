@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A filesystem model behind the littlefs API subset in lfs.h. Traversal and file access read
+ * through lfs->rcache and the block device callbacks like littlefs does, so tests see which
+ * caches and which flash ranges the glue code makes littlefs touch.
+ */
+#include <string.h>
+#include "lfs_fake.h"
+
+#define LFS_FAKE_PATH_MAX   32
+#define LFS_FAKE_PEEK       16
+
+struct lfs_fake_file {
+    char path[LFS_FAKE_PATH_MAX];
+    lfs_block_t head;
+    lfs_size_t size;
+    bool inline_data;
+};
+
+static lfs_block_t g_used[LFS_FAKE_MAX_USED];
+static uint32_t g_usedCount;
+static struct lfs_fake_file g_files[LFS_FAKE_MAX_FILES];
+static uint32_t g_fileCount;
+static void (*g_traverseHook)(lfs_block_t block);
+static void (*g_readHook)(lfs_block_t block);
+
+void lfs_fake_reset(void)
+{
+    g_usedCount = 0;
+    g_fileCount = 0;
+    g_traverseHook = NULL;
+    g_readHook = NULL;
+}
+
+void lfs_fake_use(lfs_block_t block)
+{
+    if (g_usedCount < LFS_FAKE_MAX_USED) {
+        g_used[g_usedCount++] = block;
+    }
+}
+
+void lfs_fake_file(const char *path, lfs_block_t head, lfs_size_t size, bool inline_data)
+{
+    if (g_fileCount < LFS_FAKE_MAX_FILES) {
+        struct lfs_fake_file *f = &g_files[g_fileCount++];
+        strncpy(f->path, path, sizeof(f->path) - 1);
+        f->head = head;
+        f->size = size;
+        f->inline_data = inline_data;
+    }
+}
+
+void lfs_fake_set_traverse_hook(void (*hook)(lfs_block_t block))
+{
+    g_traverseHook = hook;
+}
+
+void lfs_fake_set_read_hook(void (*hook)(lfs_block_t block))
+{
+    g_readHook = hook;
+}
+
+/* Read through pcache and then the read cache, as lfs_bd_read does. */
+static int lfs_fake_read(lfs_t *lfs, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size)
+{
+    const struct lfs_config *c = lfs->cfg;
+    lfs_off_t start = off - off % c->read_size;
+
+    if ((lfs->pcache.block == block) && (off >= lfs->pcache.off) &&
+        (off + size <= lfs->pcache.off + lfs->pcache.size)) {
+        memcpy(buffer, &lfs->pcache.buffer[off - lfs->pcache.off], size);
+        return 0;
+    }
+    if ((lfs->rcache.block != block) || (off < lfs->rcache.off) ||
+        (off + size > lfs->rcache.off + lfs->rcache.size)) {
+        lfs->rcache.block = block;
+        lfs->rcache.off = start;
+        lfs->rcache.size = lfs_min(c->cache_size, c->block_size - start);
+        if (g_readHook != NULL) {
+            g_readHook(block);
+        }
+        int err = c->read(c, block, start, lfs->rcache.buffer, lfs->rcache.size);
+        if (err < 0) {
+            lfs->rcache.block = (lfs_block_t)-1;
+            return err;
+        }
+    }
+    memcpy(buffer, &lfs->rcache.buffer[off - lfs->rcache.off], size);
+    return 0;
+}
+
+static int lfs_fake_visit(lfs_t *lfs, int (*cb)(void *data, lfs_block_t block), void *data, lfs_block_t block)
+{
+    uint8_t peek[LFS_FAKE_PEEK];
+    int err = lfs_fake_read(lfs, block, 0, peek, sizeof(peek));
+
+    if (err < 0) {
+        return err;
+    }
+    if (g_traverseHook != NULL) {
+        g_traverseHook(block);
+    }
+    return cb(data, block);
+}
+
+int lfs_fs_traverse(lfs_t *lfs, int (*cb)(void *data, lfs_block_t block), void *data)
+{
+    for (uint32_t i = 0; i < g_usedCount; i++) {
+        int err = lfs_fake_visit(lfs, cb, data, g_used[i]);
+        if (err) {
+            return err;
+        }
+    }
+    /* Open files hold blocks that are not committed yet, littlefs finds them through mlist. */
+    for (struct lfs_mlist *m = lfs->mlist; m != NULL; m = m->next) {
+        lfs_file_t *f = (lfs_file_t *)m;
+        if (f->type != LFS_TYPE_REG) {
+            continue;
+        }
+        if ((f->flags & LFS_F_DIRTY) && !(f->flags & LFS_F_INLINE)) {
+            int err = cb(data, f->ctz.head);
+            if (err) {
+                return err;
+            }
+        }
+        if ((f->flags & LFS_F_WRITING) && !(f->flags & LFS_F_INLINE)) {
+            int err = cb(data, f->block);
+            if (err) {
+                return err;
+            }
+        }
+    }
+    return 0;
+}
+
+int lfs_file_open(lfs_t *lfs, lfs_file_t *file, const char *path, int flags)
+{
+    for (uint32_t i = 0; i < g_fileCount; i++) {
+        if (strcmp(g_files[i].path, path) == 0) {
+            memset(file, 0, sizeof(*file));
+            file->type = LFS_TYPE_REG;
+            file->ctz.head = g_files[i].head;
+            file->ctz.size = g_files[i].size;
+            file->flags = (uint32_t)flags | (g_files[i].inline_data ? LFS_F_INLINE : 0);
+            file->block = (lfs_block_t)-1;
+            /* Open files are tracked in mlist like littlefs does. */
+            file->next = (lfs_file_t *)lfs->mlist;
+            lfs->mlist = (struct lfs_mlist *)file;
+            return 0;
+        }
+    }
+    return LFS_ERR_NOENT;
+}
+
+int lfs_file_close(lfs_t *lfs, lfs_file_t *file)
+{
+    for (struct lfs_mlist **p = &lfs->mlist; *p != NULL; p = &(*p)->next) {
+        if (*p == (struct lfs_mlist *)file) {
+            *p = (*p)->next;
+            return 0;
+        }
+    }
+    return LFS_ERR_INVAL;
+}
+
+lfs_soff_t lfs_file_seek(lfs_t *lfs, lfs_file_t *file, lfs_soff_t off, int whence)
+{
+    (void)lfs;
+    if ((whence != LFS_SEEK_SET) || (off < 0)) {
+        return LFS_ERR_INVAL;
+    }
+    file->pos = (lfs_off_t)off;
+    return off;
+}
+
+lfs_ssize_t lfs_file_read(lfs_t *lfs, lfs_file_t *file, void *buffer, lfs_size_t size)
+{
+    lfs_size_t bs = lfs->cfg->block_size;
+
+    if (file->pos >= file->ctz.size) {
+        return 0;
+    }
+    size = lfs_min(size, file->ctz.size - file->pos);
+    size = lfs_min(size, bs - file->pos % bs);
+    file->block = file->ctz.head + file->pos / bs;
+    int err = lfs_fake_read(lfs, file->block, file->pos % bs, buffer, size);
+    if (err < 0) {
+        return err;
+    }
+    file->off = file->pos % bs + size;
+    file->pos += size;
+    return (lfs_ssize_t)size;
+}
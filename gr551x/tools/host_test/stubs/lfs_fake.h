@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Test control of the filesystem model behind stubs/lfs.h. */
+#ifndef __HOST_LFS_FAKE_H__
+#define __HOST_LFS_FAKE_H__
+
+#include "lfs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LFS_FAKE_MAX_USED   256
+#define LFS_FAKE_MAX_FILES  8
+
+/* Forget all blocks and files. */
+void lfs_fake_reset(void);
+/* Report block as in use by a committed file or metadata pair. */
+void lfs_fake_use(lfs_block_t block);
+/* A committed file whose data starts at block head and runs over consecutive blocks. */
+void lfs_fake_file(const char *path, lfs_block_t head, lfs_size_t size, bool inline_data);
+/* Called once per block visited by lfs_fs_traverse, after its first bytes were read. */
+void lfs_fake_set_traverse_hook(void (*hook)(lfs_block_t block));
+/* Called before every read the model passes to the block device. */
+void lfs_fake_set_read_hook(void (*hook)(lfs_block_t block));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
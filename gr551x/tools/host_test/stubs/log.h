@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* HiLog macros of hilog_lite, errors to stderr like hdf_log.h. */
+#ifndef __HOST_LOG_H__
+#define __HOST_LOG_H__
+
+#include <stdio.h>
+
+#define HILOG_MODULE_APP    0
+#define HILOG_ERROR(mod, fmt, ...)  fprintf(stderr, "E " fmt "\n", ##__VA_ARGS__)
+#define HILOG_WARN(mod, fmt, ...)   fprintf(stderr, "W " fmt "\n", ##__VA_ARGS__)
+#define HILOG_INFO(mod, fmt, ...)   ((void)0)
+#define HILOG_DEBUG(mod, fmt, ...)  ((void)0)
+
+#endif
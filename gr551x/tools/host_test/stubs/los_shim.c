@@ -0,0 +1,657 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "los_shim.h"
+#include "gr55xx_hal.h"
+#include "gr55xx_pwr.h"
+
+#define SHIM_MAX_OBJ        64
+#define NS_PER_MS           1000000L
+#define NS_PER_US           1000L
+#define NS_PER_SEC          1000000000L
+#define US_PER_MS           1000
+
+/* A task pending on a semaphore, queued in arrival order. */
+struct shim_sem_waiter {
+    struct shim_sem_waiter *next;
+    bool granted;
+};
+
+struct shim_sem {
+    bool used;
+    UINT32 count;
+    UINT32 max;
+    struct shim_sem_waiter *head;
+    pthread_cond_t cond;
+};
+
+struct shim_queue {
+    bool used;
+    UINT16 len;
+    UINT16 msgSize;
+    UINT16 head;
+    UINT16 count;
+    UINT8 *buf;
+    pthread_cond_t cond;
+};
+
+static pthread_mutex_t g_shimLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_eventCond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t g_mux[SHIM_MAX_OBJ];
+static bool g_muxUsed[SHIM_MAX_OBJ];
+static struct shim_sem g_sem[SHIM_MAX_OBJ];
+static struct shim_queue g_queue[SHIM_MAX_OBJ];
+static pthread_mutex_t g_schedLock;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static __thread UINT32 g_taskId;
+static UINT32 g_nextTaskId = 1;
+
+static void ShimInit(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&g_schedLock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+/* Absolute CLOCK_REALTIME deadline timeout ms from now, for pthread timed waits. */
+static struct timespec ShimDeadline(UINT32 timeout)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout / US_PER_MS;
+    ts.tv_nsec += (long)(timeout % US_PER_MS) * NS_PER_MS;
+    if (ts.tv_nsec >= NS_PER_SEC) {
+        ts.tv_sec++;
+        ts.tv_nsec -= NS_PER_SEC;
+    }
+    return ts;
+}
+
+UINT32 LOS_MuxCreate(UINT32 *muxHandle)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutex_lock(&g_shimLock);
+    for (UINT32 i = 1; i < SHIM_MAX_OBJ; i++) {
+        if (!g_muxUsed[i]) {
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+            pthread_mutex_init(&g_mux[i], &attr);
+            pthread_mutexattr_destroy(&attr);
+            g_muxUsed[i] = true;
+            *muxHandle = i;
+            pthread_mutex_unlock(&g_shimLock);
+            return LOS_OK;
+        }
+    }
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_NOK;
+}
+
+UINT32 LOS_MuxDelete(UINT32 muxHandle)
+{
+    pthread_mutex_lock(&g_shimLock);
+    g_muxUsed[muxHandle] = false;
+    pthread_mutex_destroy(&g_mux[muxHandle]);
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_MuxPend(UINT32 muxHandle, UINT32 timeout)
+{
+    if (timeout == LOS_WAIT_FOREVER) {
+        return (pthread_mutex_lock(&g_mux[muxHandle]) == 0) ? LOS_OK : LOS_NOK;
+    }
+    struct timespec ts = ShimDeadline(timeout);
+    return (pthread_mutex_timedlock(&g_mux[muxHandle], &ts) == 0) ? LOS_OK : LOS_ERRNO_MUX_TIMEOUT;
+}
+
+UINT32 LOS_MuxPost(UINT32 muxHandle)
+{
+    return (pthread_mutex_unlock(&g_mux[muxHandle]) == 0) ? LOS_OK : LOS_NOK;
+}
+
+static UINT32 ShimSemCreate(UINT16 count, UINT32 max, UINT32 *semHandle)
+{
+    pthread_mutex_lock(&g_shimLock);
+    for (UINT32 i = 1; i < SHIM_MAX_OBJ; i++) {
+        if (!g_sem[i].used) {
+            g_sem[i].used = true;
+            g_sem[i].count = count;
+            g_sem[i].max = max;
+            g_sem[i].head = NULL;
+            pthread_cond_init(&g_sem[i].cond, NULL);
+            *semHandle = i;
+            pthread_mutex_unlock(&g_shimLock);
+            return LOS_OK;
+        }
+    }
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_NOK;
+}
+
+UINT32 LOS_SemCreate(UINT16 count, UINT32 *semHandle)
+{
+    return ShimSemCreate(count, UINT16_MAX, semHandle);
+}
+
+UINT32 LOS_BinarySemCreate(UINT16 count, UINT32 *semHandle)
+{
+    return ShimSemCreate(count, 1, semHandle);
+}
+
+UINT32 LOS_SemDelete(UINT32 semHandle)
+{
+    pthread_mutex_lock(&g_shimLock);
+    g_sem[semHandle].used = false;
+    pthread_cond_destroy(&g_sem[semHandle].cond);
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_OK;
+}
+
+static VOID (*g_hostIdleHook)(VOID);
+
+VOID HostIdleHookSet(VOID (*hook)(VOID))
+{
+    g_hostIdleHook = hook;
+}
+
+static bool ShimExpired(const struct timespec *ts)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec > ts->tv_sec || (now.tv_sec == ts->tv_sec && now.tv_nsec >= ts->tv_nsec);
+}
+
+UINT32 LOS_SemPend(UINT32 semHandle, UINT32 timeout)
+{
+    struct shim_sem *sem = &g_sem[semHandle];
+    struct timespec ts = ShimDeadline(timeout);
+    struct shim_sem_waiter self = { NULL, false };
+    struct shim_sem_waiter **pp;
+    UINT32 ret = LOS_OK;
+
+    pthread_mutex_lock(&g_shimLock);
+    if (sem->count > 0) {
+        sem->count--;
+        pthread_mutex_unlock(&g_shimLock);
+        return LOS_OK;
+    }
+    if (timeout == LOS_NO_WAIT) {
+        pthread_mutex_unlock(&g_shimLock);
+        return LOS_ERRNO_SEM_UNAVAILABLE;
+    }
+    while (g_hostIdleHook != NULL) {
+        if (sem->count > 0) {
+            sem->count--;
+            pthread_mutex_unlock(&g_shimLock);
+            return LOS_OK;
+        }
+        if (timeout != LOS_WAIT_FOREVER && ShimExpired(&ts)) {
+            pthread_mutex_unlock(&g_shimLock);
+            return LOS_ERRNO_SEM_TIMEOUT;
+        }
+        pthread_mutex_unlock(&g_shimLock);
+        g_hostIdleHook();
+        pthread_mutex_lock(&g_shimLock);
+    }
+    for (pp = &sem->head; *pp != NULL; pp = &(*pp)->next) {
+    }
+    *pp = &self;
+    while (!self.granted) {
+        if (timeout == LOS_WAIT_FOREVER) {
+            pthread_cond_wait(&sem->cond, &g_shimLock);
+        } else if (pthread_cond_timedwait(&sem->cond, &g_shimLock, &ts) == ETIMEDOUT && !self.granted) {
+            for (pp = &sem->head; *pp != &self; pp = &(*pp)->next) {
+            }
+            *pp = self.next;
+            ret = LOS_ERRNO_SEM_TIMEOUT;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_shimLock);
+    return ret;
+}
+
+/* As in LiteOS, a post with tasks pending goes to the first of them; the poster cannot take it back. */
+UINT32 LOS_SemPost(UINT32 semHandle)
+{
+    struct shim_sem *sem = &g_sem[semHandle];
+
+    pthread_mutex_lock(&g_shimLock);
+    if (sem->head != NULL) {
+        sem->head->granted = true;
+        sem->head = sem->head->next;
+        pthread_cond_broadcast(&sem->cond);
+    } else if (sem->count < sem->max) {
+        sem->count++;
+    }
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_QueueCreate(CHAR *queueName, UINT16 len, UINT32 *queueID, UINT32 flags, UINT16 maxMsgSize)
+{
+    (void)queueName;
+    (void)flags;
+    pthread_mutex_lock(&g_shimLock);
+    for (UINT32 i = 1; i < SHIM_MAX_OBJ; i++) {
+        if (!g_queue[i].used) {
+            g_queue[i].buf = malloc((size_t)len * maxMsgSize);
+            if (g_queue[i].buf == NULL) {
+                break;
+            }
+            g_queue[i].used = true;
+            g_queue[i].len = len;
+            g_queue[i].msgSize = maxMsgSize;
+            g_queue[i].head = 0;
+            g_queue[i].count = 0;
+            pthread_cond_init(&g_queue[i].cond, NULL);
+            *queueID = i;
+            pthread_mutex_unlock(&g_shimLock);
+            return LOS_OK;
+        }
+    }
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_NOK;
+}
+
+UINT32 LOS_QueueDelete(UINT32 queueID)
+{
+    pthread_mutex_lock(&g_shimLock);
+    g_queue[queueID].used = false;
+    free(g_queue[queueID].buf);
+    pthread_cond_destroy(&g_queue[queueID].cond);
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_OK;
+}
+
+/* Wait on q->cond with g_shimLock held until ready() holds; false on timeout. */
+static bool ShimQueueWait(struct shim_queue *q, bool (*ready)(const struct shim_queue *), UINT32 timeout)
+{
+    struct timespec ts = ShimDeadline(timeout);
+
+    while (!ready(q)) {
+        if (timeout == LOS_NO_WAIT) {
+            return false;
+        }
+        if (timeout == LOS_WAIT_FOREVER) {
+            pthread_cond_wait(&q->cond, &g_shimLock);
+        } else if (pthread_cond_timedwait(&q->cond, &g_shimLock, &ts) == ETIMEDOUT) {
+            return ready(q);
+        }
+    }
+    return true;
+}
+
+static bool ShimQueueReadable(const struct shim_queue *q)
+{
+    return q->count != 0;
+}
+
+static bool ShimQueueWritable(const struct shim_queue *q)
+{
+    return q->count < q->len;
+}
+
+UINT32 LOS_QueueReadCopy(UINT32 queueID, VOID *bufferAddr, UINT32 *bufferSize, UINT32 timeOut)
+{
+    struct shim_queue *q = &g_queue[queueID];
+    UINT32 size;
+
+    pthread_mutex_lock(&g_shimLock);
+    if (!ShimQueueWait(q, ShimQueueReadable, timeOut)) {
+        pthread_mutex_unlock(&g_shimLock);
+        return LOS_ERRNO_QUEUE_ISEMPTY;
+    }
+    size = (*bufferSize < q->msgSize) ? *bufferSize : q->msgSize;
+    memcpy(bufferAddr, q->buf + (size_t)q->head * q->msgSize, size);
+    *bufferSize = size;
+    q->head = (UINT16)((q->head + 1) % q->len);
+    q->count--;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_QueueWriteCopy(UINT32 queueID, VOID *bufferAddr, UINT32 bufferSize, UINT32 timeOut)
+{
+    struct shim_queue *q = &g_queue[queueID];
+    UINT32 tail;
+
+    if (bufferSize > q->msgSize) {
+        return LOS_NOK;
+    }
+    pthread_mutex_lock(&g_shimLock);
+    if (!ShimQueueWait(q, ShimQueueWritable, timeOut)) {
+        pthread_mutex_unlock(&g_shimLock);
+        return LOS_ERRNO_QUEUE_ISFULL;
+    }
+    tail = (q->head + q->count) % q->len;
+    memcpy(q->buf + (size_t)tail * q->msgSize, bufferAddr, bufferSize);
+    q->count++;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_EventInit(EVENT_CB_S *eventCB)
+{
+    eventCB->uwEventID = 0;
+    return LOS_OK;
+}
+
+static bool ShimEventReady(const EVENT_CB_S *eventCB, UINT32 eventMask, UINT32 mode)
+{
+    if (mode & LOS_WAITMODE_AND) {
+        return (eventCB->uwEventID & eventMask) == eventMask;
+    }
+    return (eventCB->uwEventID & eventMask) != 0;
+}
+
+UINT32 LOS_EventRead(EVENT_CB_S *eventCB, UINT32 eventMask, UINT32 mode, UINT32 timeout)
+{
+    struct timespec ts = ShimDeadline(timeout);
+    UINT32 ret;
+
+    pthread_mutex_lock(&g_shimLock);
+    while (!ShimEventReady(eventCB, eventMask, mode)) {
+        if (timeout == LOS_NO_WAIT) {
+            break;
+        }
+        if (timeout == LOS_WAIT_FOREVER) {
+            pthread_cond_wait(&g_eventCond, &g_shimLock);
+        } else if (pthread_cond_timedwait(&g_eventCond, &g_shimLock, &ts) == ETIMEDOUT) {
+            break;
+        }
+    }
+    if (ShimEventReady(eventCB, eventMask, mode)) {
+        ret = eventCB->uwEventID & eventMask;
+        if (mode & LOS_WAITMODE_CLR) {
+            eventCB->uwEventID &= ~ret;
+        }
+    } else {
+        ret = LOS_ERRNO_EVENT_READ_TIMEOUT;
+    }
+    pthread_mutex_unlock(&g_shimLock);
+    return ret;
+}
+
+UINT32 LOS_EventWrite(EVENT_CB_S *eventCB, UINT32 events)
+{
+    pthread_mutex_lock(&g_shimLock);
+    eventCB->uwEventID |= events;
+    pthread_cond_broadcast(&g_eventCond);
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_EventClear(EVENT_CB_S *eventCB, UINT32 eventMask)
+{
+    pthread_mutex_lock(&g_shimLock);
+    eventCB->uwEventID &= eventMask;
+    pthread_mutex_unlock(&g_shimLock);
+    return LOS_OK;
+}
+
+UINT32 LOS_EventDestroy(EVENT_CB_S *eventCB)
+{
+    (void)eventCB;
+    return LOS_OK;
+}
+
+struct shim_task {
+    TSK_ENTRY_FUNC entry;
+    UINT32 arg;
+    UINT32 id;
+};
+
+static void *ShimTaskRun(void *param)
+{
+    struct shim_task task = *(struct shim_task *)param;
+
+    free(param);
+    g_taskId = task.id;
+    task.entry(task.arg);
+    return NULL;
+}
+
+UINT32 LOS_TaskCreate(UINT32 *taskID, TSK_INIT_PARAM_S *initParam)
+{
+    struct shim_task *task = malloc(sizeof(*task));
+    pthread_t thread;
+
+    if (task == NULL) {
+        return LOS_NOK;
+    }
+    pthread_mutex_lock(&g_shimLock);
+    task->id = ++g_nextTaskId;
+    pthread_mutex_unlock(&g_shimLock);
+    task->entry = initParam->pfnTaskEntry;
+    task->arg = initParam->uwArg;
+    *taskID = task->id;
+    if (pthread_create(&thread, NULL, ShimTaskRun, task) != 0) {
+        free(task);
+        return LOS_NOK;
+    }
+    pthread_detach(thread);
+    return LOS_OK;
+}
+
+UINT32 LOS_TaskDelay(UINT32 tick)
+{
+    struct timespec ts = { .tv_sec = tick / US_PER_MS, .tv_nsec = (long)(tick % US_PER_MS) * NS_PER_MS };
+
+    if (tick == 0) {
+        sched_yield();
+    } else {
+        nanosleep(&ts, NULL);
+    }
+    return LOS_OK;
+}
+
+UINT32 LOS_CurTaskIDGet(VOID)
+{
+    return g_taskId;
+}
+
+static __thread uint32_t g_hostLockDepth;
+
+VOID LOS_TaskLock(VOID)
+{
+    pthread_once(&g_once, ShimInit);
+    pthread_mutex_lock(&g_schedLock);
+    g_hostLockDepth++;
+}
+
+VOID LOS_TaskUnlock(VOID)
+{
+    g_hostLockDepth--;
+    pthread_mutex_unlock(&g_schedLock);
+}
+
+UINTPTR LOS_IntLock(VOID)
+{
+    LOS_TaskLock();
+    return 0;
+}
+
+VOID LOS_IntRestore(UINTPTR intSave)
+{
+    (void)intSave;
+    LOS_TaskUnlock();
+}
+
+void HostIrqDisable(void)
+{
+    LOS_TaskLock();
+}
+
+void HostIrqEnable(void)
+{
+    LOS_TaskUnlock();
+}
+
+bool HostIrqMasked(void)
+{
+    return g_hostLockDepth != 0;
+}
+
+static __thread uint32_t g_hostIpsr;
+static __thread uint32_t g_hostFault;
+
+void HostIsrEnter(void)
+{
+    HostIrqDisable();
+    g_hostIpsr++;
+}
+
+void HostIsrExit(void)
+{
+    g_hostIpsr--;
+    HostIrqEnable();
+}
+
+void HostFaultEnter(IRQn_Type irqn)
+{
+    HostIrqDisable();
+    g_hostFault = (uint32_t)(irqn + HOST_EXC_IRQ_BASE);
+}
+
+void HostFaultExit(void)
+{
+    g_hostFault = 0;
+    HostIrqEnable();
+}
+
+uint32_t __get_IPSR(void)
+{
+    if (g_hostFault != 0) {
+        return g_hostFault;
+    }
+    return (g_hostIpsr != 0) ? HOST_EXC_IRQ_BASE : 0;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return HostIrqMasked() ? 1 : 0;
+}
+
+static uint8_t g_hostNvicEnabled[HOST_IRQn_MAX];
+static uint8_t g_hostNvicPending[HOST_IRQn_MAX];
+
+void NVIC_EnableIRQ(IRQn_Type irqn)
+{
+    g_hostNvicEnabled[irqn] = 1;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irqn)
+{
+    g_hostNvicEnabled[irqn] = 0;
+}
+
+uint32_t NVIC_GetEnableIRQ(IRQn_Type irqn)
+{
+    return g_hostNvicEnabled[irqn];
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type irqn)
+{
+    g_hostNvicPending[irqn] = 1;
+}
+
+uint32_t NVIC_GetPendingIRQ(IRQn_Type irqn)
+{
+    return g_hostNvicPending[irqn];
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irqn)
+{
+    g_hostNvicPending[irqn] = 0;
+}
+
+uint32_t SystemCoreClock = HOST_CORE_CLOCK;
+HostCoreDebug g_hostCoreDebug;
+
+HostDwt *HostDwtGet(void)
+{
+    static HostDwt dwt;
+
+    dwt.CYCCNT = (uint32_t)(flash_sim_clock_us() * (HOST_CORE_CLOCK / US_PER_MS / US_PER_MS));
+    return &dwt;
+}
+
+static pwr_mgmt_mode_t g_hostBaseband = PMR_MGMT_ACTIVE_MODE;
+
+pwr_mgmt_mode_t pwr_mgmt_baseband_state_get(void)
+{
+    return g_hostBaseband;
+}
+
+void HostBasebandStateSet(pwr_mgmt_mode_t mode)
+{
+    g_hostBaseband = mode;
+}
+
+UINT64 HostTimeUs(VOID)
+{
+    static struct timespec start;
+    struct timespec now;
+
+    if (start.tv_sec == 0 && start.tv_nsec == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UINT64)(now.tv_sec - start.tv_sec) * US_PER_MS * US_PER_MS +
+           (UINT64)(now.tv_nsec - start.tv_nsec) / NS_PER_US;
+}
+
+UINT64 LOS_TickCountGet(VOID)
+{
+    return HostTimeUs() / US_PER_MS;
+}
+
+UINT32 LOS_MS2Tick(UINT32 millisec)
+{
+    return millisec;
+}
+
+UINT32 LOS_Tick2MS(UINT32 tick)
+{
+    return tick;
+}
+
+VOID *LOS_MemAlloc(VOID *pool, UINT32 size)
+{
+    (void)pool;
+    return malloc(size);
+}
+
+UINT32 LOS_MemFree(VOID *pool, VOID *ptr)
+{
+    (void)pool;
+    free(ptr);
+    return LOS_OK;
+}
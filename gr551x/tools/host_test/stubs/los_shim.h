@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The subset of the LiteOS-M kernel API used by the components under test, on POSIX threads.
+ * Tasks are threads, a tick is a millisecond, mutexes are recursive like LOS mutexes.
+ * LOS_TaskLock and LOS_IntLock take one global recursive lock: they only exclude other
+ * code that takes it too, which is enough for the paths tested here but is not a scheduler.
+ */
+#ifndef __HOST_LOS_SHIM_H__
+#define __HOST_LOS_SHIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void VOID;
+typedef char CHAR;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t INT32;
+typedef uintptr_t UINTPTR;
+typedef bool BOOL;
+
+#define LOS_OK                      0U
+#define LOS_NOK                     1U
+#define LOS_WAIT_FOREVER            0xFFFFFFFFU
+#define LOS_NO_WAIT                 0U
+#define LOS_ERRNO_SEM_TIMEOUT       0x02000707U
+#define LOS_ERRNO_SEM_UNAVAILABLE   0x02000706U
+#define LOS_ERRNO_MUX_TIMEOUT       0x0200071eU
+#define LOS_ERRNO_EVENT_READ_TIMEOUT 0x02001c01U
+#define LOS_ERRNO_QUEUE_ISEMPTY     0x0200060dU
+#define LOS_ERRNO_QUEUE_ISFULL      0x0200060bU
+
+#define LOS_WAITMODE_AND            4U
+#define LOS_WAITMODE_OR             2U
+#define LOS_WAITMODE_CLR            1U
+
+#define LOSCFG_BASE_CORE_TICK_PER_SECOND 1000
+#define LOSCFG_LFS_MAX_MOUNT_SIZE   3
+#define OS_SYS_MEM_ADDR             NULL
+
+#define LOS_TASK_STATUS_DETACHED    0x0100U
+
+typedef VOID *(*TSK_ENTRY_FUNC)(UINT32 arg);
+
+typedef struct {
+    TSK_ENTRY_FUNC pfnTaskEntry;
+    UINT16 usTaskPrio;
+    UINT32 uwArg;
+    UINT32 uwStackSize;
+    CHAR *pcName;
+    UINT32 uwResved;
+} TSK_INIT_PARAM_S;
+
+typedef struct {
+    UINT32 uwEventID;
+} EVENT_CB_S;
+
+UINT32 LOS_MuxCreate(UINT32 *muxHandle);
+UINT32 LOS_MuxDelete(UINT32 muxHandle);
+UINT32 LOS_MuxPend(UINT32 muxHandle, UINT32 timeout);
+UINT32 LOS_MuxPost(UINT32 muxHandle);
+
+UINT32 LOS_SemCreate(UINT16 count, UINT32 *semHandle);
+UINT32 LOS_BinarySemCreate(UINT16 count, UINT32 *semHandle);
+UINT32 LOS_SemDelete(UINT32 semHandle);
+UINT32 LOS_SemPend(UINT32 semHandle, UINT32 timeout);
+UINT32 LOS_SemPost(UINT32 semHandle);
+
+UINT32 LOS_QueueCreate(CHAR *queueName, UINT16 len, UINT32 *queueID, UINT32 flags, UINT16 maxMsgSize);
+UINT32 LOS_QueueDelete(UINT32 queueID);
+UINT32 LOS_QueueReadCopy(UINT32 queueID, VOID *bufferAddr, UINT32 *bufferSize, UINT32 timeOut);
+UINT32 LOS_QueueWriteCopy(UINT32 queueID, VOID *bufferAddr, UINT32 bufferSize, UINT32 timeOut);
+
+UINT32 LOS_EventInit(EVENT_CB_S *eventCB);
+UINT32 LOS_EventRead(EVENT_CB_S *eventCB, UINT32 eventMask, UINT32 mode, UINT32 timeout);
+UINT32 LOS_EventWrite(EVENT_CB_S *eventCB, UINT32 events);
+UINT32 LOS_EventClear(EVENT_CB_S *eventCB, UINT32 eventMask);
+UINT32 LOS_EventDestroy(EVENT_CB_S *eventCB);
+
+UINT32 LOS_TaskCreate(UINT32 *taskID, TSK_INIT_PARAM_S *initParam);
+UINT32 LOS_TaskDelay(UINT32 tick);
+UINT32 LOS_CurTaskIDGet(VOID);
+VOID LOS_TaskLock(VOID);
+VOID LOS_TaskUnlock(VOID);
+
+UINTPTR LOS_IntLock(VOID);
+VOID LOS_IntRestore(UINTPTR intSave);
+
+UINT64 LOS_TickCountGet(VOID);
+UINT32 LOS_MS2Tick(UINT32 millisec);
+UINT32 LOS_Tick2MS(UINT32 tick);
+
+VOID *LOS_MemAlloc(VOID *pool, UINT32 size);
+UINT32 LOS_MemFree(VOID *pool, VOID *ptr);
+
+/* Microseconds since the first call, for latency measurements in tests. */
+UINT64 HostTimeUs(VOID);
+/* While set, a LOS_SemPend that would block calls hook instead, over and over until the semaphore
+ * is posted or the timeout expires, so a single-threaded test can run the fake device the task
+ * waits on. NULL to block again. */
+VOID HostIdleHookSet(VOID (*hook)(VOID));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
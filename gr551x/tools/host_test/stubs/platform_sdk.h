@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The platform calls of the app drivers. The interrupt protection maps to the global interrupt lock. */
+#ifndef __HOST_PLATFORM_SDK_H__
+#define __HOST_PLATFORM_SDK_H__
+
+#include "gr55xx_hal.h"
+
+#define platform_interrupt_protection_push()    GLOBAL_EXCEPTION_DISABLE()
+#define platform_interrupt_protection_pop()     GLOBAL_EXCEPTION_ENABLE()
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The bounded string and memory functions of libboundscheck used by the components under test. */
+#ifndef __HOST_SECUREC_H__
+#define __HOST_SECUREC_H__
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define EOK     0
+#define ERANGE_AND_RESET    162
+
+/* Bytes copied by memcpy_s since the program started, for the benchmarks of copy costs. */
+extern size_t g_hostCopyBytes;
+
+static inline int memcpy_s(void *dest, size_t destMax, const void *src, size_t count)
+{
+    if (dest == NULL || src == NULL || count > destMax) {
+        return ERANGE_AND_RESET;
+    }
+    memcpy(dest, src, count);
+    g_hostCopyBytes += count;
+    return EOK;
+}
+
+static inline int memset_s(void *dest, size_t destMax, int c, size_t count)
+{
+    if (dest == NULL || count > destMax) {
+        return ERANGE_AND_RESET;
+    }
+    memset(dest, c, count);
+    return EOK;
+}
+
+static inline int strcpy_s(char *dest, size_t destMax, const char *src)
+{
+    if (dest == NULL || src == NULL || strlen(src) >= destMax) {
+        return ERANGE_AND_RESET;
+    }
+    strcpy(dest, src);
+    return EOK;
+}
+
+static inline int strcat_s(char *dest, size_t destMax, const char *src)
+{
+    if (dest == NULL || src == NULL || strlen(dest) + strlen(src) >= destMax) {
+        return ERANGE_AND_RESET;
+    }
+    strcat(dest, src);
+    return EOK;
+}
+
+/* Formats at most count characters, -1 if the output was truncated. */
+#define snprintf_s(dest, destMax, count, ...)   HostSnprintfS((dest), (destMax), (count), \
+                                                              snprintf((dest), (destMax), __VA_ARGS__))
+
+static inline int HostSnprintfS(char *dest, size_t destMax, size_t count, int len)
+{
+    return (len < 0 || (size_t)len >= destMax || (size_t)len > count) ? -1 : len;
+}
+
+#endif
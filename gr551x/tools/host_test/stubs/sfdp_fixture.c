@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+#include "sfdp_fixture.h"
+
+void sfdp_fixture_put32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+uint32_t sfdp_fixture_build(uint8_t *image, const struct sfdp_fixture_bfpt *bfpt)
+{
+    const uint8_t header[16] = {
+        'S', 'F', 'D', 'P', bfpt->minor, 0x01, 0x00, 0xFF,
+        0x00, bfpt->minor, 0x01, bfpt->dwords, SFDP_FIXTURE_BFPT_PTR, 0x00, 0x00, 0xFF,
+    };
+
+    memset(image, 0xFF, SFDP_FIXTURE_SIZE);
+    memcpy(image, header, sizeof(header));
+    for (uint32_t i = 0; i < bfpt->dwords && i < SFDP_FIXTURE_DWORDS_MAX; i++) {
+        sfdp_fixture_put32(image + SFDP_FIXTURE_BFPT_PTR + i * 4, bfpt->dw[i]);
+    }
+    return SFDP_FIXTURE_BFPT_PTR + bfpt->dwords * 4;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * JESD216 SFDP images for the SPI NOR model: a header, one parameter header and the basic flash
+ * parameter table (BFPT), laid out as a part serves them from instruction 0x5A.
+ */
+#ifndef __SFDP_FIXTURE_H__
+#define __SFDP_FIXTURE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SFDP_FIXTURE_DWORDS_MAX     16
+#define SFDP_FIXTURE_BFPT_PTR       0x30
+#define SFDP_FIXTURE_SIZE           (SFDP_FIXTURE_BFPT_PTR + SFDP_FIXTURE_DWORDS_MAX * 4)
+
+/* BFPT DWORDs numbered from 1 as in the standard: dw[0] is DWORD 1. */
+struct sfdp_fixture_bfpt {
+    uint32_t dw[SFDP_FIXTURE_DWORDS_MAX];
+    uint8_t  dwords;                /* 9 for JESD216, 16 from JESD216B on */
+    uint8_t  minor;                 /* revision 1.minor */
+};
+
+void sfdp_fixture_put32(uint8_t *p, uint32_t v);
+/* Fill image (SFDP_FIXTURE_SIZE bytes) and return the number of bytes to serve. */
+uint32_t sfdp_fixture_build(uint8_t *image, const struct sfdp_fixture_bfpt *bfpt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include "app_qspi.h"
+#include "app_spi.h"
+#include "spi_bus_fake.h"
+
+#define NS_PER_US           1000ULL
+#define FRAME_MAX           (4 + 2 * SPI_NOR_PAGE_SIZE)
+
+enum {
+    SLOT_QSPI0,
+    SLOT_QSPI1,
+    SLOT_SPI,
+    SLOT_TIMER,
+    SLOT_MAX,
+};
+
+struct slot {
+    bool     armed;
+    uint64_t at_ns;
+    int      type;                  /* app_qspi_evt_type_t or app_spi_evt_type_t */
+    uint32_t size;
+};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static bool g_started;
+static bool g_delivering;
+static struct slot g_slots[SLOT_MAX];
+static app_qspi_evt_handler_t g_qspiHandler[APP_QSPI_ID_MAX];
+static app_spi_evt_handler_t g_spiHandler;
+static app_qspi_pin_t g_qspiIo[APP_QSPI_ID_MAX][2];   /* IO2, IO3 */
+static uint32_t g_gpioPins[APP_IO_TYPE_MAX];           /* pins app_io holds as GPIO */
+static void (*g_timerHandler)(void);
+static uint32_t g_failIn;                              /* 1 for the next transfer, 0 for none */
+static struct spi_bus_fake_stats g_stats;
+
+static void Deliver(int idx, const struct slot *s)
+{
+    if (idx == SLOT_TIMER) {
+        if (g_timerHandler != NULL) {
+            g_timerHandler();
+        }
+    } else if (idx == SLOT_SPI) {
+        app_spi_evt_t evt = { .type = (app_spi_evt_type_t)s->type, .data.size = s->size };
+        if (g_spiHandler != NULL) {
+            g_spiHandler(&evt);
+        }
+    } else {
+        app_qspi_evt_t evt = { .type = (app_qspi_evt_type_t)s->type, .data.size = s->size };
+        if (g_qspiHandler[idx] != NULL) {
+            g_qspiHandler[idx](&evt);
+        }
+    }
+}
+
+/* The interrupt thread: the earliest pending completion runs once the model clock reaches it. */
+static void *IrqThread(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&g_lock);
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < SLOT_MAX; i++) {
+            if (g_slots[i].armed && (next < 0 || g_slots[i].at_ns < g_slots[next].at_ns)) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            pthread_cond_broadcast(&g_cond);
+            pthread_cond_wait(&g_cond, &g_lock);
+            continue;
+        }
+        struct slot s = g_slots[next];
+        g_slots[next].armed = false;
+        if (s.at_ns > spi_nor_now_ns()) {
+            spi_nor_advance_ns(s.at_ns - spi_nor_now_ns());
+        }
+        g_delivering = true;
+        pthread_mutex_unlock(&g_lock);
+
+        HostIsrEnter();
+        Deliver(next, &s);
+        HostIsrExit();
+
+        pthread_mutex_lock(&g_lock);
+        g_delivering = false;
+    }
+    return NULL;
+}
+
+/* Called with g_lock held. */
+static void Arm(int idx, uint64_t ns, int type, uint32_t size)
+{
+    pthread_t tid;
+
+    if (!g_started) {
+        g_started = true;
+        pthread_create(&tid, NULL, IrqThread, NULL);
+        pthread_detach(tid);
+    }
+    g_slots[idx].armed = true;
+    g_slots[idx].at_ns = spi_nor_now_ns() + ns;
+    g_slots[idx].type = type;
+    g_slots[idx].size = size;
+    pthread_cond_broadcast(&g_cond);
+}
+
+/* Called with g_lock held: whether a transfer may start on the slot. */
+static bool Claim(int idx)
+{
+    if (g_slots[idx].armed) {
+        g_stats.busy++;
+        return false;
+    }
+    g_stats.transfers++;
+    return true;
+}
+
+static int Complete(int idx, uint64_t ns, int type, int error_type, uint32_t size)
+{
+    if (g_failIn != 0 && --g_failIn == 0) {
+        type = error_type;
+    }
+    Arm(idx, ns, type, size);
+    return APP_DRV_SUCCESS;
+}
+
+static bool PinGpio(const app_qspi_pin_t *pin)
+{
+    return (g_gpioPins[pin->type] & pin->pin) != 0;
+}
+
+static uint8_t Lines(uint32_t data_mode)
+{
+    return (data_mode == QSPI_DATA_MODE_QUADSPI) ? 4 : (data_mode == QSPI_DATA_MODE_DUALSPI) ? 2 : 1;
+}
+
+static void CommandOp(app_qspi_id_t id, const app_qspi_command_t *p_cmd, struct spi_nor_op *op)
+{
+    memset(op, 0, sizeof(*op));
+    op->cmd = (uint8_t)p_cmd->instruction;
+    op->addr = p_cmd->address;
+    op->addr_bits = (uint8_t)p_cmd->address_size;
+    op->addr_lines = (p_cmd->instruction_address_mode == QSPI_INST_ADDR_ALL_IN_SPI) ? 1 : Lines(p_cmd->data_mode);
+    op->dummy_clocks = (uint8_t)p_cmd->dummy_cycles;
+    op->data_lines = Lines(p_cmd->data_mode);
+    op->len = p_cmd->length;
+    op->io23_driven = !PinGpio(&g_qspiIo[id][0]) && !PinGpio(&g_qspiIo[id][1]);
+}
+
+uint16_t app_qspi_init(app_qspi_params_t *p_params, app_qspi_evt_handler_t evt_handler)
+{
+    if (p_params == NULL || p_params->id >= APP_QSPI_ID_MAX || p_params->init.clock_prescaler == 0) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+    pthread_mutex_lock(&g_lock);
+    g_qspiHandler[p_params->id] = evt_handler;
+    g_qspiIo[p_params->id][0] = p_params->pin_cfg.io_2;
+    g_qspiIo[p_params->id][1] = p_params->pin_cfg.io_3;
+    g_gpioPins[p_params->pin_cfg.io_2.type] &= ~p_params->pin_cfg.io_2.pin;
+    g_gpioPins[p_params->pin_cfg.io_3.type] &= ~p_params->pin_cfg.io_3.pin;
+    spi_nor_set_bus(SystemCoreClock / p_params->init.clock_prescaler, SPI_BUS_FAKE_XFER_NS);
+    pthread_mutex_unlock(&g_lock);
+    return APP_DRV_SUCCESS;
+}
+
+uint16_t app_qspi_deinit(app_qspi_id_t id)
+{
+    if (id >= APP_QSPI_ID_MAX) {
+        return APP_DRV_ERR_INVALID_ID;
+    }
+    pthread_mutex_lock(&g_lock);
+    g_qspiHandler[id] = NULL;
+    pthread_mutex_unlock(&g_lock);
+    return APP_DRV_SUCCESS;
+}
+
+uint16_t app_qspi_transmit_async(app_qspi_id_t id, uint8_t *p_data, uint32_t length)
+{
+    uint16_t ret = APP_DRV_ERR_BUSY;
+
+    if (id >= APP_QSPI_ID_MAX || g_qspiHandler[id] == NULL) {
+        return APP_DRV_ERR_INVALID_ID;
+    }
+    pthread_mutex_lock(&g_lock);
+    if (Claim(id)) {
+        uint64_t ns = spi_nor_frame(p_data, length, NULL, 0);
+        ret = Complete(id, ns, APP_QSPI_EVT_TX_CPLT, APP_QSPI_EVT_ERROR, length);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return ret;
+}
+
+uint16_t app_qspi_command_receive_async(app_qspi_id_t id, app_qspi_command_t *p_cmd, uint8_t *p_data)
+{
+    struct spi_nor_op op;
+    uint16_t ret = APP_DRV_ERR_BUSY;
+
+    if (id >= APP_QSPI_ID_MAX || g_qspiHandler[id] == NULL) {
+        return APP_DRV_ERR_INVALID_ID;
+    }
+    pthread_mutex_lock(&g_lock);
+    if (Claim(id)) {
+        CommandOp(id, p_cmd, &op);
+        op.rx = p_data;
+        ret = Complete(id, spi_nor_xfer(&op), APP_QSPI_EVT_RX_DATA, APP_QSPI_EVT_ERROR, op.len);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return ret;
+}
+
+uint16_t app_qspi_command_transmit_async(app_qspi_id_t id, app_qspi_command_t *p_cmd, uint8_t *p_data)
+{
+    struct spi_nor_op op;
+    uint16_t ret = APP_DRV_ERR_BUSY;
+
+    if (id >= APP_QSPI_ID_MAX || g_qspiHandler[id] == NULL) {
+        return APP_DRV_ERR_INVALID_ID;
+    }
+    pthread_mutex_lock(&g_lock);
+    if (Claim(id)) {
+        CommandOp(id, p_cmd, &op);
+        op.tx = p_data;
+        ret = Complete(id, spi_nor_xfer(&op), APP_QSPI_EVT_TX_CPLT, APP_QSPI_EVT_ERROR, op.len);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return ret;
+}
+
+uint16_t app_spi_init(app_spi_params_t *p_params, app_spi_evt_handler_t evt_handler)
+{
+    if (p_params == NULL || p_params->id != APP_SPI_ID_MASTER || p_params->init.baudrate_prescaler == 0) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+    pthread_mutex_lock(&g_lock);
+    g_spiHandler = evt_handler;
+    spi_nor_set_bus(SystemCoreClock / p_params->init.baudrate_prescaler, SPI_BUS_FAKE_XFER_NS);
+    pthread_mutex_unlock(&g_lock);
+    return APP_DRV_SUCCESS;
+}
+
+uint16_t app_spi_deinit(app_spi_id_t id)
+{
+    pthread_mutex_lock(&g_lock);
+    g_spiHandler = NULL;
+    pthread_mutex_unlock(&g_lock);
+    return APP_DRV_SUCCESS;
+}
+
+static uint16_t SpiFrame(const uint8_t *p_cmd, uint32_t cmd_size, const uint8_t *p_tx, uint32_t tx_size,
+                         uint8_t *p_rx, uint32_t rx_size)
+{
+    uint8_t frame[FRAME_MAX];
+    uint16_t ret = APP_DRV_ERR_BUSY;
+
+    if (g_spiHandler == NULL) {
+        return APP_DRV_ERR_INVALID_ID;
+    }
+    if (cmd_size + tx_size > sizeof(frame)) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+    memcpy(frame, p_cmd, cmd_size);
+    if (tx_size != 0) {
+        memcpy(frame + cmd_size, p_tx, tx_size);
+    }
+    pthread_mutex_lock(&g_lock);
+    if (Claim(SLOT_SPI)) {
+        uint64_t ns = spi_nor_frame(frame, cmd_size + tx_size, p_rx, rx_size);
+        ret = Complete(SLOT_SPI, ns, (rx_size != 0) ? APP_SPI_EVT_RX_DATA : APP_SPI_EVT_TX_CPLT, APP_SPI_EVT_ERROR,
+                       (rx_size != 0) ? rx_size : tx_size);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return ret;
+}
+
+uint16_t app_spi_transmit_async(app_spi_id_t id, uint8_t *p_data, uint16_t size)
+{
+    return SpiFrame(p_data, size, NULL, 0, NULL, 0);
+}
+
+uint16_t app_spi_write_memory_async(app_spi_id_t id, uint8_t *p_cmd_data, uint8_t *p_tx_data,
+                                    uint32_t cmd_size, uint32_t tx_size)
+{
+    return SpiFrame(p_cmd_data, cmd_size, p_tx_data, tx_size, NULL, 0);
+}
+
+uint16_t app_spi_read_memory_async(app_spi_id_t id, uint8_t *p_cmd_data, uint8_t *p_rx_data,
+                                   uint32_t cmd_size, uint32_t rx_size)
+{
+    return SpiFrame(p_cmd_data, cmd_size, NULL, 0, p_rx_data, rx_size);
+}
+
+uint16_t app_io_init(app_io_type_t type, app_io_init_t *p_init)
+{
+    if (type >= APP_IO_TYPE_MAX || p_init == NULL) {
+        return APP_DRV_ERR_INVALID_PARAM;
+    }
+    pthread_mutex_lock(&g_lock);
+    if (p_init->mode == APP_IO_MODE_MUX) {
+        g_gpioPins[type] &= ~p_init->pin;
+    } else {
+        g_gpioPins[type] |= p_init->pin;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return APP_DRV_SUCCESS;
+}
+
+uint16_t app_io_write_pin(app_io_type_t type, uint32_t pin, app_io_pin_state_t pin_state)
+{
+    return (type < APP_IO_TYPE_MAX) ? APP_DRV_SUCCESS : APP_DRV_ERR_INVALID_PARAM;
+}
+
+/* The driver may only reach the bus through the controller app_qspi set up. */
+hal_status_t hal_qspi_transmit(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length, uint32_t timeout)
+{
+    pthread_mutex_lock(&g_lock);
+    g_stats.stray_hal++;
+    pthread_mutex_unlock(&g_lock);
+    return HAL_ERROR;
+}
+
+void spi_bus_fake_reset(void)
+{
+    spi_bus_fake_idle();
+    pthread_mutex_lock(&g_lock);
+    memset(g_qspiHandler, 0, sizeof(g_qspiHandler));
+    memset(g_qspiIo, 0, sizeof(g_qspiIo));
+    memset(g_gpioPins, 0, sizeof(g_gpioPins));
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_spiHandler = NULL;
+    g_failIn = 0;
+    pthread_mutex_unlock(&g_lock);
+}
+
+void spi_bus_fake_set_timer_handler(void (*fn)(void))
+{
+    pthread_mutex_lock(&g_lock);
+    g_timerHandler = fn;
+    pthread_mutex_unlock(&g_lock);
+}
+
+void spi_bus_fake_timer_start(uint32_t delay_us)
+{
+    pthread_mutex_lock(&g_lock);
+    g_stats.timers++;
+    Arm(SLOT_TIMER, delay_us * NS_PER_US, 0, 0);
+    pthread_mutex_unlock(&g_lock);
+}
+
+void spi_bus_fake_fail(uint32_t after)
+{
+    pthread_mutex_lock(&g_lock);
+    g_failIn = after + 1;
+    pthread_mutex_unlock(&g_lock);
+}
+
+void spi_bus_fake_idle(void)
+{
+    pthread_mutex_lock(&g_lock);
+    for (;;) {
+        bool pending = g_delivering;
+        for (int i = 0; i < SLOT_MAX; i++) {
+            pending = pending || g_slots[i].armed;
+        }
+        if (!pending) {
+            break;
+        }
+        pthread_cond_wait(&g_cond, &g_lock);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void spi_bus_fake_get_stats(struct spi_bus_fake_stats *stats)
+{
+    pthread_mutex_lock(&g_lock);
+    *stats = g_stats;
+    pthread_mutex_unlock(&g_lock);
+}
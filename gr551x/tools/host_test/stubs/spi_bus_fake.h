@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * app_qspi, app_spi and app_io on top of the SPI NOR model in ../flash_sim/spi_nor_model.h, for the
+ * external flash driver. Each async call runs its transaction on the model, and its completion
+ * event is delivered from an "interrupt" thread, between HostIsrEnter and HostIsrExit, once the
+ * model clock reaches the end of the transfer. A second transfer started on a controller before the first
+ * completed is refused with APP_DRV_ERR_BUSY, as the DMA channel still belongs to the first.
+ * IO2/IO3 count as driven by the QSPI only while app_io has them in APP_IO_MODE_MUX.
+ */
+#ifndef __SPI_BUS_FAKE_H__
+#define __SPI_BUS_FAKE_H__
+
+#include <stdint.h>
+#include "spi_nor_model.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed cost of one transfer on top of its clocks: DMA setup and the completion interrupt.
+ * Assumed, not measured on the GR551x.
+ */
+#define SPI_BUS_FAKE_XFER_NS        2000
+
+struct spi_bus_fake_stats {
+    uint32_t transfers;             /* transactions started through app_qspi/app_spi */
+    uint32_t busy;                  /* refused with APP_DRV_ERR_BUSY */
+    uint32_t stray_hal;             /* hal_qspi_transmit on a handle app_qspi never set up */
+    uint32_t timers;                /* spi_bus_fake_timer_start calls */
+};
+
+/* Forget pins, controllers and statistics; the model itself is left as it is. */
+void spi_bus_fake_reset(void);
+/* One-shot timer on the model clock; fn runs in the interrupt thread when it expires. */
+void spi_bus_fake_set_timer_handler(void (*fn)(void));
+void spi_bus_fake_timer_start(uint32_t delay_us);
+/* Fail a transfer: the one after the next `after` ones completes with an ERROR event instead of its own. */
+void spi_bus_fake_fail(uint32_t after);
+/* Wait until no transfer or timer is pending and no event is being delivered. */
+void spi_bus_fake_idle(void);
+void spi_bus_fake_get_stats(struct spi_bus_fake_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
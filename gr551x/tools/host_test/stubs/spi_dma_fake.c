@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "spi_dma_fake.h"
+
+#define CHAN_MAX            4
+
+struct chan {
+    const void *handle;
+    bool        qspi;
+    bool        pending;
+    uint32_t    block;              /* index of the pending block in g_log */
+    uint32_t    rx_count;
+    uint32_t    sent;
+    uint8_t     sent_data[SPI_DMA_FAKE_SENT_MAX];
+};
+
+static struct chan g_chan[CHAN_MAX];
+static struct spi_dma_fake_block g_log[SPI_DMA_FAKE_LOG_MAX];
+static uint32_t g_logCount;
+static uint32_t g_refuseIn;
+
+static struct chan *Chan(const void *handle, bool qspi)
+{
+    for (int i = 0; i < CHAN_MAX; i++) {
+        if (g_chan[i].handle == handle) {
+            return &g_chan[i];
+        }
+    }
+    for (int i = 0; i < CHAN_MAX; i++) {
+        if (g_chan[i].handle == NULL) {
+            g_chan[i].handle = handle;
+            g_chan[i].qspi = qspi;
+            return &g_chan[i];
+        }
+    }
+    return NULL;
+}
+
+static struct chan *Find(const void *handle)
+{
+    for (int i = 0; i < CHAN_MAX; i++) {
+        if (g_chan[i].handle == handle) {
+            return &g_chan[i];
+        }
+    }
+    return NULL;
+}
+
+static hal_status_t Start(const void *handle, bool qspi, bool ready, bool has_dma, bool rx, bool dma,
+                          uint8_t *p_data, uint32_t length, volatile uint32_t *error_code)
+{
+    struct chan *c = Chan(handle, qspi);
+
+    if (c == NULL || g_logCount >= SPI_DMA_FAKE_LOG_MAX) {
+        return HAL_ERROR;
+    }
+    if (g_refuseIn != 0 && --g_refuseIn == 0) {
+        return HAL_BUSY;
+    }
+    if (!ready || c->pending) {
+        return HAL_BUSY;
+    }
+    if (p_data == NULL || length == 0 || length > SPI_DMA_FAKE_BLOCK_MAX || (dma && !has_dma)) {
+        *error_code = qspi ? HAL_QSPI_ERROR_INVALID_PARAM : HAL_SPI_ERROR_INVALID_PARAM;
+        return HAL_ERROR;
+    }
+    *error_code = 0;
+    c->pending = true;
+    c->block = g_logCount;
+    g_log[g_logCount++] = (struct spi_dma_fake_block) {
+        .handle = handle, .rx = rx, .dma = dma, .p_data = p_data, .length = length,
+    };
+    return HAL_OK;
+}
+
+static hal_status_t SpiStart(spi_handle_t *p_spi, bool rx, bool dma, uint8_t *p_data, uint32_t length)
+{
+    hal_status_t ret = Start(p_spi, false, p_spi->state == HAL_SPI_STATE_READY,
+                             rx ? p_spi->p_dmarx != NULL : p_spi->p_dmatx != NULL,
+                             rx, dma, p_data, length, &p_spi->error_code);
+
+    if (ret == HAL_OK) {
+        p_spi->state = rx ? HAL_SPI_STATE_BUSY_RX : HAL_SPI_STATE_BUSY_TX;
+        if (rx) {
+            p_spi->p_rx_buffer = p_data;
+            p_spi->rx_xfer_size = length;
+            p_spi->rx_xfer_count = length;
+        } else {
+            p_spi->p_tx_buffer = p_data;
+            p_spi->tx_xfer_size = length;
+            p_spi->tx_xfer_count = length;
+        }
+    }
+    return ret;
+}
+
+static hal_status_t QspiStart(qspi_handle_t *p_qspi, bool rx, bool dma, uint8_t *p_data, uint32_t length)
+{
+    hal_status_t ret = Start(p_qspi, true, p_qspi->state == HAL_QSPI_STATE_READY, p_qspi->p_dma != NULL,
+                             rx, dma, p_data, length, &p_qspi->error_code);
+
+    if (ret == HAL_OK) {
+        p_qspi->state = rx ? HAL_QSPI_STATE_BUSY_INDIRECT_RX : HAL_QSPI_STATE_BUSY_INDIRECT_TX;
+        if (rx) {
+            p_qspi->p_rx_buffer = p_data;
+            p_qspi->rx_xfer_size = length;
+            p_qspi->rx_xfer_count = length;
+        } else {
+            p_qspi->p_tx_buffer = p_data;
+            p_qspi->tx_xfer_size = length;
+            p_qspi->tx_xfer_count = length;
+        }
+    }
+    return ret;
+}
+
+static void Finish(struct chan *c, const struct spi_dma_fake_block *b)
+{
+    if (b->rx) {
+        for (uint32_t i = 0; i < b->length; i++) {
+            b->p_data[i] = SPI_DMA_FAKE_RX_BYTE(c->rx_count + i);
+        }
+        c->rx_count += b->length;
+    } else {
+        uint32_t n = b->length;
+        if (n > SPI_DMA_FAKE_SENT_MAX - c->sent) {
+            n = SPI_DMA_FAKE_SENT_MAX - c->sent;
+        }
+        memcpy(c->sent_data + c->sent, b->p_data, n);
+        c->sent += n;
+    }
+}
+
+static bool End(const void *handle, bool ok, uint32_t code)
+{
+    struct chan *c = Find(handle);
+    const struct spi_dma_fake_block *b;
+
+    if (c == NULL || !c->pending) {
+        return false;
+    }
+    b = &g_log[c->block];
+    c->pending = false;
+    if (ok) {
+        Finish(c, b);
+    }
+
+    HostIsrEnter();
+    if (c->qspi) {
+        qspi_handle_t *p_qspi = (qspi_handle_t *)handle;
+        p_qspi->state = HAL_QSPI_STATE_READY;
+        if (!ok) {
+            p_qspi->error_code = code;
+            hal_qspi_error_callback(p_qspi);
+        } else if (b->rx) {
+            p_qspi->rx_xfer_count = 0;
+            hal_qspi_rx_cplt_callback(p_qspi);
+        } else {
+            p_qspi->tx_xfer_count = 0;
+            hal_qspi_tx_cplt_callback(p_qspi);
+        }
+    } else {
+        spi_handle_t *p_spi = (spi_handle_t *)handle;
+        p_spi->state = HAL_SPI_STATE_READY;
+        if (!ok) {
+            p_spi->error_code = code;
+            hal_spi_error_callback(p_spi);
+        } else if (b->rx) {
+            p_spi->rx_xfer_count = 0;
+            hal_spi_rx_cplt_callback(p_spi);
+        } else {
+            p_spi->tx_xfer_count = 0;
+            hal_spi_tx_cplt_callback(p_spi);
+        }
+    }
+    HostIsrExit();
+    return true;
+}
+
+void spi_dma_fake_reset(void)
+{
+    memset(g_chan, 0, sizeof(g_chan));
+    g_logCount = 0;
+    g_refuseIn = 0;
+}
+
+void spi_dma_fake_refuse(uint32_t after)
+{
+    g_refuseIn = after + 1;
+}
+
+bool spi_dma_fake_complete(const void *handle)
+{
+    return End(handle, true, 0);
+}
+
+bool spi_dma_fake_error(const void *handle, uint32_t code)
+{
+    return End(handle, false, code);
+}
+
+bool spi_dma_fake_pending(const void *handle)
+{
+    struct chan *c = Find(handle);
+
+    return c != NULL && c->pending;
+}
+
+uint32_t spi_dma_fake_blocks(const struct spi_dma_fake_block **p_log)
+{
+    *p_log = g_log;
+    return g_logCount;
+}
+
+uint32_t spi_dma_fake_sent(const void *handle, const uint8_t **p_data)
+{
+    struct chan *c = Find(handle);
+
+    *p_data = (c != NULL) ? c->sent_data : NULL;
+    return (c != NULL) ? c->sent : 0;
+}
+
+hal_status_t hal_spi_init(spi_handle_t *p_spi)
+{
+    p_spi->state = HAL_SPI_STATE_READY;
+    p_spi->error_code = HAL_SPI_ERROR_NONE;
+    return HAL_OK;
+}
+
+hal_status_t hal_spi_deinit(spi_handle_t *p_spi)
+{
+    p_spi->state = HAL_SPI_STATE_RESET;
+    return HAL_OK;
+}
+
+hal_spi_state_t hal_spi_get_state(spi_handle_t *p_spi)
+{
+    return p_spi->state;
+}
+
+hal_status_t hal_spi_suspend_reg(spi_handle_t *p_spi)
+{
+    return HAL_OK;
+}
+
+hal_status_t hal_spi_resume_reg(spi_handle_t *p_spi)
+{
+    return HAL_OK;
+}
+
+void hal_spi_irq_handler(spi_handle_t *p_spi)
+{
+}
+
+hal_status_t hal_spi_transmit_it(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length)
+{
+    return SpiStart(p_spi, false, false, p_data, length);
+}
+
+hal_status_t hal_spi_transmit_dma(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length)
+{
+    return SpiStart(p_spi, false, true, p_data, length);
+}
+
+hal_status_t hal_spi_receive_it(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length)
+{
+    return SpiStart(p_spi, true, false, p_data, length);
+}
+
+hal_status_t hal_spi_receive_dma(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length)
+{
+    return SpiStart(p_spi, true, true, p_data, length);
+}
+
+/* The blocking and full-duplex calls are outside what the fake models. */
+hal_status_t hal_spi_transmit(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_spi_receive(spi_handle_t *p_spi, uint8_t *p_data, uint32_t length, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_spi_transmit_receive(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t length, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_spi_transmit_receive_it(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t length)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_spi_transmit_receive_dma(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t length)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_spi_read_eeprom(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t tx_number_data, uint32_t rx_number_data, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_spi_read_eeprom_it(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t tx_number_data, uint32_t rx_number_data)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_spi_read_eeprom_dma(spi_handle_t *p_spi, uint8_t *p_tx_data, uint8_t *p_rx_data,
+    uint32_t tx_number_data, uint32_t rx_number_data)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_init(qspi_handle_t *p_qspi)
+{
+    p_qspi->state = HAL_QSPI_STATE_READY;
+    p_qspi->error_code = HAL_QSPI_ERROR_NONE;
+    return HAL_OK;
+}
+
+hal_status_t hal_qspi_deinit(qspi_handle_t *p_qspi)
+{
+    p_qspi->state = HAL_QSPI_STATE_RESET;
+    return HAL_OK;
+}
+
+hal_qspi_state_t hal_qspi_get_state(qspi_handle_t *p_qspi)
+{
+    return p_qspi->state;
+}
+
+hal_status_t hal_qspi_suspend_reg(qspi_handle_t *p_qspi)
+{
+    return HAL_OK;
+}
+
+hal_status_t hal_qspi_resume_reg(qspi_handle_t *p_qspi)
+{
+    return HAL_OK;
+}
+
+void hal_qspi_irq_handler(qspi_handle_t *p_qspi)
+{
+}
+
+void hal_qspi_config_dma_qwrite_32b_patch(qspi_handle_t *p_qspi, bool enable_patch, uint32_t endian_mode)
+{
+}
+
+hal_status_t hal_qspi_transmit_it(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length)
+{
+    return QspiStart(p_qspi, false, false, p_data, length);
+}
+
+hal_status_t hal_qspi_transmit_dma(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length)
+{
+    return QspiStart(p_qspi, false, true, p_data, length);
+}
+
+hal_status_t hal_qspi_receive_it(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length)
+{
+    return QspiStart(p_qspi, true, false, p_data, length);
+}
+
+hal_status_t hal_qspi_receive_dma(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length)
+{
+    return QspiStart(p_qspi, true, true, p_data, length);
+}
+
+/* Command-framed transfers are outside what the fake models. */
+hal_status_t hal_qspi_transmit(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_receive(qspi_handle_t *p_qspi, uint8_t *p_data, uint32_t length, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_command(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_command_it(qspi_handle_t *p_qspi, qspi_command_t *p_cmd)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_command_dma(qspi_handle_t *p_qspi, qspi_command_t *p_cmd)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_command_transmit(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data,
+    uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_command_transmit_it(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_command_transmit_dma(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_command_receive(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data,
+    uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_command_receive_it(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data)
+{
+    return HAL_ERROR;
+}
+
+hal_status_t hal_qspi_command_receive_dma(qspi_handle_t *p_qspi, qspi_command_t *p_cmd, uint8_t *p_data)
+{
+    return HAL_ERROR;
+}
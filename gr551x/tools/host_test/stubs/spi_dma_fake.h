@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The SPI and QSPI HAL under app_spi.c and app_qspi.c, with a fake DMA engine in place of the
+ * controllers. A started block stays pending on its handle until the test completes it with
+ * spi_dma_fake_complete or fails it with spi_dma_fake_error; either runs the HAL callback from an
+ * "interrupt", between HostIsrEnter and HostIsrExit, on the calling thread. Like the HAL, a start
+ * is refused with HAL_BUSY while a block is pending and with HAL_ERROR above the DMA block size.
+ * TX blocks append to a per-handle record of the bytes sent; RX blocks are filled from a per-handle
+ * byte counter, so the n-th byte received on a handle is SPI_DMA_FAKE_RX_BYTE(n).
+ */
+#ifndef __SPI_DMA_FAKE_H__
+#define __SPI_DMA_FAKE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gr55xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPI_DMA_FAKE_BLOCK_MAX      4095
+#define SPI_DMA_FAKE_LOG_MAX        256
+#define SPI_DMA_FAKE_SENT_MAX       (256 * 1024)
+#define SPI_DMA_FAKE_RX_BYTE(n)     ((uint8_t)((n) * 7 + 1))
+
+struct spi_dma_fake_block {
+    const void *handle;             /* spi_handle_t or qspi_handle_t the block was started on */
+    bool        rx;
+    bool        dma;                /* false for the interrupt-driven calls */
+    uint8_t    *p_data;
+    uint32_t    length;
+};
+
+/* Forget pending blocks, the block log, the sent bytes and the RX counters. */
+void spi_dma_fake_reset(void);
+/* Refuse a start: the one after the next `after` starts returns HAL_BUSY and leaves error_code clear. */
+void spi_dma_fake_refuse(uint32_t after);
+/* Finish the block pending on a handle; false when there is none. */
+bool spi_dma_fake_complete(const void *handle);
+/* End the block pending on a handle with the error callback and error_code set to code. */
+bool spi_dma_fake_error(const void *handle, uint32_t code);
+bool spi_dma_fake_pending(const void *handle);
+/* Every block started since the reset, in order; returns how many. */
+uint32_t spi_dma_fake_blocks(const struct spi_dma_fake_block **p_log);
+/* The bytes the TX blocks of a handle sent, in order; returns how many. */
+uint32_t spi_dma_fake_sent(const void *handle, const uint8_t **p_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,790 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+#include "uart_fake.h"
+
+#define NONE                UINT64_MAX
+#define NS_PER_S            1000000000ULL
+#define NS_PER_MS           1000000ULL
+#define TIMEOUT_CHARS       4
+/* Model time a polling loop spends per look at a flag it waits on. */
+#define POLL_NS             1000
+
+struct port {
+    uart_handle_t *handle;
+    uint64_t       char_ns;
+    uint32_t       ier;
+    uint32_t       rx_th;
+    uint32_t       tx_th;
+    uint32_t       lsr;                 /* line errors latched for the next RLS interrupt */
+    uint8_t        rx_fifo[UART_FAKE_FIFO_DEPTH];
+    uint32_t       rx_head;
+    uint32_t       rx_count;
+    uint64_t       rx_activity;         /* last time a byte entered or left the RX FIFO */
+    uint8_t        tx_fifo[UART_FAKE_FIFO_DEPTH];
+    uint32_t       tx_head;
+    uint32_t       tx_count;
+    uint64_t       tx_at;               /* when the byte at the head of the TX FIFO is out */
+    uint16_t       line[UART_FAKE_LINE_MAX];    /* byte, and its line error in the high byte */
+    uint32_t       line_head;
+    uint32_t       line_count;
+    uint64_t       line_at;             /* when the byte at the head of the RX line has arrived */
+    bool           tx_dma;
+    bool           rx_dma;
+    bool           tx_dma_done;
+    bool           rx_dma_done;
+    uint64_t       irq_raised;
+    uint64_t       dma_raised;
+    uint8_t        sent[UART_FAKE_SENT_MAX];
+    uint32_t       sent_count;
+    struct uart_fake_stats stats;
+};
+
+void UART0_IRQHandler(void);
+void UART1_IRQHandler(void);
+
+static const IRQn_Type g_irqn[UART_FAKE_PORTS] = { UART0_IRQn, UART1_IRQn };
+static struct port g_port[UART_FAKE_PORTS];
+static uint64_t g_now;
+static uint64_t g_latency = UART_FAKE_IRQ_LATENCY_NS;
+
+static struct port *Port(const uart_regs_t *instance)
+{
+    if (instance == UART0) {
+        return &g_port[0];
+    }
+    if (instance == UART1) {
+        return &g_port[1];
+    }
+    return NULL;
+}
+
+static uint32_t RxThreshold(uint32_t th)
+{
+    static const uint32_t level[] = { 1, UART_FAKE_FIFO_DEPTH / 4, UART_FAKE_FIFO_DEPTH / 2, UART_FAKE_FIFO_DEPTH - 2 };
+
+    return level[th & 3];
+}
+
+static uint32_t TxThreshold(uint32_t th)
+{
+    static const uint32_t level[] = { 0, 2, UART_FAKE_FIFO_DEPTH / 4, UART_FAKE_FIFO_DEPTH / 2 };
+
+    return level[th & 3];
+}
+
+static bool TimedOut(const struct port *p)
+{
+    return p->rx_count != 0 && g_now >= p->rx_activity + TIMEOUT_CHARS * p->char_ns;
+}
+
+static bool IrqCond(const struct port *p)
+{
+    return ((p->ier & UART_IT_RLS) && p->lsr != 0) ||
+           ((p->ier & UART_IT_RDA) && p->rx_count != 0 && (p->rx_count >= p->rx_th || TimedOut(p))) ||
+           ((p->ier & UART_IT_THRE) && p->tx_count <= p->tx_th);
+}
+
+static uint8_t RxPop(struct port *p)
+{
+    uint8_t b = p->rx_fifo[p->rx_head];
+
+    p->rx_head = (p->rx_head + 1) % UART_FAKE_FIFO_DEPTH;
+    p->rx_count--;
+    p->rx_activity = g_now;
+    return b;
+}
+
+static void TxPush(struct port *p, uint8_t b)
+{
+    if (p->tx_count == 0) {
+        p->tx_at = g_now + p->char_ns;
+    }
+    p->tx_fifo[(p->tx_head + p->tx_count) % UART_FAKE_FIFO_DEPTH] = b;
+    p->tx_count++;
+}
+
+static void Arrive(struct port *p)
+{
+    uint16_t v = p->line[p->line_head];
+
+    p->line_head = (p->line_head + 1) % UART_FAKE_LINE_MAX;
+    p->line_count--;
+    if (p->rx_count == UART_FAKE_FIFO_DEPTH) {
+        p->lsr |= HAL_UART_ERROR_OE;
+        p->stats.overruns++;
+    } else {
+        p->rx_fifo[(p->rx_head + p->rx_count) % UART_FAKE_FIFO_DEPTH] = (uint8_t)v;
+        p->rx_count++;
+        p->lsr |= v >> 8;
+        p->stats.rx_bytes++;
+        if (p->rx_count > p->stats.rx_fifo_max) {
+            p->stats.rx_fifo_max = p->rx_count;
+        }
+    }
+    p->rx_activity = g_now;
+    if (p->line_count != 0) {
+        p->line_at += p->char_ns;
+    }
+}
+
+static void ShiftOut(struct port *p)
+{
+    if (p->sent_count < UART_FAKE_SENT_MAX) {
+        p->sent[p->sent_count++] = p->tx_fifo[p->tx_head];
+    }
+    p->tx_head = (p->tx_head + 1) % UART_FAKE_FIFO_DEPTH;
+    p->tx_count--;
+    p->stats.tx_bytes++;
+    if (p->tx_count != 0) {
+        p->tx_at += p->char_ns;
+    }
+}
+
+/* DMA keeps the TX FIFO fed and the RX FIFO emptied; the end of a block raises the DMA interrupt. */
+static void Pump(struct port *p)
+{
+    uart_handle_t *h = p->handle;
+
+    if (p->tx_dma) {
+        while (h->tx_xfer_count != 0 && p->tx_count < UART_FAKE_FIFO_DEPTH) {
+            TxPush(p, h->p_tx_buffer[h->tx_xfer_size - h->tx_xfer_count]);
+            h->tx_xfer_count--;
+        }
+        if (h->tx_xfer_count == 0) {
+            p->tx_dma = false;
+            p->tx_dma_done = true;
+        }
+    }
+    if (p->rx_dma) {
+        while (h->rx_xfer_count != 0 && p->rx_count != 0) {
+            h->p_rx_buffer[h->rx_xfer_size - h->rx_xfer_count] = RxPop(p);
+            h->rx_xfer_count--;
+        }
+        if (h->rx_xfer_count == 0) {
+            p->rx_dma = false;
+            p->rx_dma_done = true;
+        }
+    }
+    if ((p->tx_dma_done || p->rx_dma_done) && p->dma_raised == NONE) {
+        p->dma_raised = g_now;
+    }
+}
+
+static void Update(struct port *p)
+{
+    if (!IrqCond(p)) {
+        p->irq_raised = NONE;
+    } else if (p->irq_raised == NONE) {
+        p->irq_raised = g_now;
+    }
+}
+
+static uint64_t Due(uint64_t raised)
+{
+    return (raised == NONE) ? NONE : (raised + g_latency > g_now ? raised + g_latency : g_now);
+}
+
+static uint64_t NextEvent(const struct port *p, bool isr)
+{
+    uint64_t t = NONE;
+    uint64_t e;
+
+    if (p->handle == NULL) {
+        return NONE;
+    }
+    if (p->line_count != 0 && p->line_at < t) {
+        t = p->line_at;
+    }
+    if (p->tx_count != 0 && p->tx_at < t) {
+        t = p->tx_at;
+    }
+    if ((p->ier & UART_IT_RDA) && p->rx_count != 0 && !TimedOut(p)) {
+        e = p->rx_activity + TIMEOUT_CHARS * p->char_ns;
+        t = (e < t) ? e : t;
+    }
+    if (isr) {
+        if (NVIC_GetEnableIRQ(g_irqn[p - g_port])) {
+            e = Due(p->irq_raised);
+            t = (e < t) ? e : t;
+        }
+        e = Due(p->dma_raised);
+        t = (e < t) ? e : t;
+    }
+    return t;
+}
+
+static void TakeDma(struct port *p)
+{
+    uart_handle_t *h = p->handle;
+
+    p->dma_raised = NONE;
+    HostIsrEnter();
+    p->stats.dma_irqs++;
+    if (p->tx_dma_done) {
+        p->tx_dma_done = false;
+        h->tx_state = HAL_UART_STATE_READY;
+        hal_uart_tx_cplt_callback(h);
+    }
+    if (p->rx_dma_done) {
+        p->rx_dma_done = false;
+        h->rx_state = HAL_UART_STATE_READY;
+        hal_uart_rx_cplt_callback(h);
+    }
+    HostIsrExit();
+}
+
+static void TakeIrq(struct port *p)
+{
+    p->irq_raised = NONE;
+    HostIsrEnter();
+    p->stats.irqs++;
+    if (p == &g_port[0]) {
+        UART0_IRQHandler();
+    } else {
+        UART1_IRQHandler();
+    }
+    HostIsrExit();
+}
+
+/* Move both ports up to target; interrupts are taken only when the caller could be interrupted. */
+static void Run(uint64_t target, bool isr)
+{
+    HostIrqDisable();
+    for (;;) {
+        uint64_t t = NONE;
+
+        for (int i = 0; i < UART_FAKE_PORTS; i++) {
+            uint64_t e = NextEvent(&g_port[i], isr);
+            t = (e < t) ? e : t;
+        }
+        if (t > target) {
+            break;
+        }
+        if (t > g_now) {
+            g_now = t;
+        }
+        for (int i = 0; i < UART_FAKE_PORTS; i++) {
+            struct port *p = &g_port[i];
+
+            if (p->handle == NULL) {
+                continue;
+            }
+            while (p->line_count != 0 && p->line_at <= g_now) {
+                Arrive(p);
+            }
+            while (p->tx_count != 0 && p->tx_at <= g_now) {
+                ShiftOut(p);
+            }
+            Pump(p);
+            Update(p);
+            if (isr && p->dma_raised != NONE && p->dma_raised + g_latency <= g_now) {
+                TakeDma(p);
+                Pump(p);
+                Update(p);
+            }
+            if (isr && p->irq_raised != NONE && p->irq_raised + g_latency <= g_now &&
+                    NVIC_GetEnableIRQ(g_irqn[i])) {
+                TakeIrq(p);
+                Pump(p);
+                Update(p);
+            }
+        }
+    }
+    if (target > g_now) {
+        g_now = target;
+    }
+    HostIrqEnable();
+}
+
+/* One look at a flag a polling loop waits on: the lines move on, and the interrupts come in
+ * unless the poller has them masked. */
+static void Poll(void)
+{
+    Run(g_now + POLL_NS, !HostIrqMasked());
+}
+
+void uart_fake_reset(void)
+{
+    HostIrqDisable();
+    memset(g_port, 0, sizeof(g_port));
+    for (int i = 0; i < UART_FAKE_PORTS; i++) {
+        g_port[i].irq_raised = NONE;
+        g_port[i].dma_raised = NONE;
+    }
+    g_now = 0;
+    g_latency = UART_FAKE_IRQ_LATENCY_NS;
+    HostIrqEnable();
+}
+
+void uart_fake_set_irq_latency(uint32_t ns)
+{
+    /* At least 1 ns, so that a handler leaving its interrupt raised cannot stall the clock. */
+    g_latency = (ns == 0) ? 1 : ns;
+}
+
+static void LinePush(uint8_t id, uint16_t v)
+{
+    struct port *p = &g_port[id];
+
+    if (p->line_count == UART_FAKE_LINE_MAX) {
+        return;
+    }
+    if (p->line_count == 0) {
+        p->line_at = g_now + p->char_ns;
+    }
+    p->line[(p->line_head + p->line_count) % UART_FAKE_LINE_MAX] = v;
+    p->line_count++;
+}
+
+void uart_fake_rx_push(uint8_t id, const uint8_t *data, uint32_t len)
+{
+    HostIrqDisable();
+    for (uint32_t i = 0; i < len; i++) {
+        LinePush(id, data[i]);
+    }
+    HostIrqEnable();
+}
+
+void uart_fake_rx_push_error(uint8_t id, uint8_t byte, uint32_t code)
+{
+    HostIrqDisable();
+    LinePush(id, (uint16_t)(byte | ((code & (HAL_UART_ERROR_PE | HAL_UART_ERROR_FE | HAL_UART_ERROR_BI)) << 8)));
+    HostIrqEnable();
+}
+
+uint32_t uart_fake_rx_queued(uint8_t id)
+{
+    return g_port[id].line_count;
+}
+
+bool uart_fake_tx_dma_error(uint8_t id)
+{
+    struct port *p = &g_port[id];
+    uart_handle_t *h = p->handle;
+
+    HostIrqDisable();
+    if (h == NULL || !p->tx_dma) {
+        HostIrqEnable();
+        return false;
+    }
+    p->tx_dma = false;
+    h->tx_state = HAL_UART_STATE_READY;
+    h->error_code |= HAL_UART_ERROR_DMA;
+    HostIrqEnable();
+
+    HostIsrEnter();
+    p->stats.dma_irqs++;
+    hal_uart_error_callback(h);
+    HostIsrExit();
+    return true;
+}
+
+void uart_fake_run(uint64_t ns)
+{
+    Run(g_now + ns, true);
+}
+
+void uart_fake_idle(void)
+{
+    Poll();
+}
+
+uint64_t uart_fake_now_ns(void)
+{
+    return g_now;
+}
+
+uint64_t uart_fake_char_ns(uint8_t id)
+{
+    return g_port[id].char_ns;
+}
+
+uint32_t uart_fake_sent(uint8_t id, const uint8_t **p_data)
+{
+    *p_data = g_port[id].sent;
+    return g_port[id].sent_count;
+}
+
+void uart_fake_get_stats(uint8_t id, struct uart_fake_stats *st)
+{
+    *st = g_port[id].stats;
+}
+
+void uart_fake_thresholds(uint8_t id, uint32_t *rx, uint32_t *tx)
+{
+    *rx = g_port[id].rx_th;
+    *tx = g_port[id].tx_th;
+}
+
+/* The HAL, as the ROM implements it. */
+
+hal_status_t hal_uart_init(uart_handle_t *p_uart)
+{
+    struct port *p = Port(p_uart->p_instance);
+    uint32_t bits;
+
+    if (p == NULL || p_uart->init.baud_rate == 0) {
+        return HAL_ERROR;
+    }
+    bits = 1 + 5 + (p_uart->init.data_bits & 3) + ((p_uart->init.parity & UART_PARITY_ODD) ? 1 : 0) +
+           ((p_uart->init.stop_bits & UART_STOPBITS_2) ? 2 : 1);
+    HostIrqDisable();
+    p->handle = p_uart;
+    p->char_ns = (bits * NS_PER_S + p_uart->init.baud_rate / 2) / p_uart->init.baud_rate;
+    p->ier = 0;
+    p->rx_th = RxThreshold(LL_UART_RX_FIFO_TH_CHAR_1);
+    p->tx_th = TxThreshold(LL_UART_TX_FIFO_TH_EMPTY);
+    p->lsr = 0;
+    p->rx_count = 0;
+    p->tx_count = 0;
+    p->tx_dma = false;
+    p->rx_dma = false;
+    p->tx_dma_done = false;
+    p->rx_dma_done = false;
+    p->irq_raised = NONE;
+    p->dma_raised = NONE;
+    p_uart->tx_state = HAL_UART_STATE_READY;
+    p_uart->rx_state = HAL_UART_STATE_READY;
+    p_uart->error_code = HAL_UART_ERROR_NONE;
+    HostIrqEnable();
+    return HAL_OK;
+}
+
+hal_status_t hal_uart_deinit(uart_handle_t *p_uart)
+{
+    struct port *p = Port(p_uart->p_instance);
+
+    if (p == NULL) {
+        return HAL_ERROR;
+    }
+    HostIrqDisable();
+    p->ier = 0;
+    p->tx_dma = false;
+    p->rx_dma = false;
+    p->irq_raised = NONE;
+    p->dma_raised = NONE;
+    p_uart->tx_state = HAL_UART_STATE_RESET;
+    p_uart->rx_state = HAL_UART_STATE_RESET;
+    HostIrqEnable();
+    return HAL_OK;
+}
+
+hal_uart_state_t hal_uart_get_state(uart_handle_t *p_uart)
+{
+    return (hal_uart_state_t)(p_uart->tx_state | p_uart->rx_state);
+}
+
+hal_status_t hal_uart_suspend_reg(uart_handle_t *p_uart)
+{
+    return HAL_OK;
+}
+
+hal_status_t hal_uart_resume_reg(uart_handle_t *p_uart)
+{
+    return HAL_OK;
+}
+
+static void EndRx(struct port *p, uart_handle_t *h)
+{
+    p->ier &= ~(UART_IT_RDA | UART_IT_RLS);
+    p->rx_dma = false;
+    h->rx_state = HAL_UART_STATE_READY;
+}
+
+void hal_uart_irq_handler(uart_handle_t *p_uart)
+{
+    struct port *p = Port(p_uart->p_instance);
+    uint32_t lsr = p->lsr;
+    bool timed_out = TimedOut(p);
+
+    if ((p->ier & UART_IT_RLS) && lsr != 0) {
+        p->lsr = 0;
+        p_uart->error_code |= lsr;
+        /* An overrun ends an interrupt or DMA receive, the other line errors only report. */
+        if ((lsr & HAL_UART_ERROR_OE) && p_uart->rx_state == HAL_UART_STATE_BUSY_RX) {
+            EndRx(p, p_uart);
+        }
+        hal_uart_error_callback(p_uart);
+    }
+
+    if ((p->ier & UART_IT_RDA) && p->rx_count != 0 && (p->rx_count >= p->rx_th || timed_out)) {
+        if (p_uart->rx_state == HAL_UART_STATE_BUSY_RX && !p->rx_dma) {
+            while (p_uart->rx_xfer_count != 0 && p->rx_count != 0) {
+                p_uart->p_rx_buffer[p_uart->rx_xfer_size - p_uart->rx_xfer_count] = RxPop(p);
+                p_uart->rx_xfer_count--;
+            }
+            if (p_uart->rx_xfer_count == 0 ||
+                    (timed_out && p_uart->init.rx_timeout_mode == UART_RECEIVER_TIMEOUT_ENABLE)) {
+                EndRx(p, p_uart);
+                hal_uart_rx_cplt_callback(p_uart);
+            }
+        } else {
+            p->ier &= ~UART_IT_RDA;
+        }
+    }
+
+    if ((p->ier & UART_IT_THRE) && p->tx_count <= p->tx_th) {
+        if (p_uart->tx_state == HAL_UART_STATE_BUSY_TX && p_uart->tx_xfer_count != 0) {
+            while (p_uart->tx_xfer_count != 0 && p->tx_count < UART_FAKE_FIFO_DEPTH) {
+                TxPush(p, p_uart->p_tx_buffer[p_uart->tx_xfer_size - p_uart->tx_xfer_count]);
+                p_uart->tx_xfer_count--;
+            }
+        } else if (p_uart->tx_state == HAL_UART_STATE_BUSY_TX) {
+            p->ier &= ~UART_IT_THRE;
+            p_uart->tx_state = HAL_UART_STATE_READY;
+            hal_uart_tx_cplt_callback(p_uart);
+        } else {
+            p->ier &= ~UART_IT_THRE;
+        }
+    }
+}
+
+static hal_status_t StartTx(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size, bool dma)
+{
+    struct port *p = Port(p_uart->p_instance);
+
+    if (p == NULL || p_data == NULL || size == 0 || (dma && (p_uart->p_dmatx == NULL ||
+            size > UART_FAKE_DMA_BLOCK_MAX))) {
+        return HAL_ERROR;
+    }
+    HostIrqDisable();
+    if (p_uart->tx_state != HAL_UART_STATE_READY) {
+        HostIrqEnable();
+        return HAL_BUSY;
+    }
+    p_uart->p_tx_buffer = p_data;
+    p_uart->tx_xfer_size = size;
+    p_uart->tx_xfer_count = size;
+    p_uart->tx_state = HAL_UART_STATE_BUSY_TX;
+    p_uart->error_code = HAL_UART_ERROR_NONE;
+    if (dma) {
+        p->tx_dma = true;
+        Pump(p);
+    } else {
+        p->ier |= UART_IT_THRE;
+    }
+    Update(p);
+    HostIrqEnable();
+    return HAL_OK;
+}
+
+static hal_status_t StartRx(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size, bool dma)
+{
+    struct port *p = Port(p_uart->p_instance);
+
+    if (p == NULL || p_data == NULL || size == 0 || (dma && (p_uart->p_dmarx == NULL ||
+            size > UART_FAKE_DMA_BLOCK_MAX))) {
+        return HAL_ERROR;
+    }
+    HostIrqDisable();
+    if (p_uart->rx_state != HAL_UART_STATE_READY) {
+        HostIrqEnable();
+        return HAL_BUSY;
+    }
+    p_uart->p_rx_buffer = p_data;
+    p_uart->rx_xfer_size = size;
+    p_uart->rx_xfer_count = size;
+    p_uart->rx_state = HAL_UART_STATE_BUSY_RX;
+    p_uart->error_code = HAL_UART_ERROR_NONE;
+    p->ier |= UART_IT_RLS;
+    if (dma) {
+        p->rx_dma = true;
+        Pump(p);
+    } else {
+        p->ier |= UART_IT_RDA;
+    }
+    Update(p);
+    HostIrqEnable();
+    return HAL_OK;
+}
+
+hal_status_t hal_uart_transmit_it(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size)
+{
+    return StartTx(p_uart, p_data, size, false);
+}
+
+hal_status_t hal_uart_transmit_dma(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size)
+{
+    return StartTx(p_uart, p_data, size, true);
+}
+
+hal_status_t hal_uart_receive_it(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size)
+{
+    return StartRx(p_uart, p_data, size, false);
+}
+
+hal_status_t hal_uart_receive_dma(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size)
+{
+    return StartRx(p_uart, p_data, size, true);
+}
+
+hal_status_t hal_uart_transmit(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size, uint32_t timeout)
+{
+    struct port *p = Port(p_uart->p_instance);
+    uint64_t deadline = g_now + (uint64_t)timeout * NS_PER_MS;
+    hal_status_t ret = HAL_OK;
+
+    if (p == NULL || p_data == NULL || size == 0) {
+        return HAL_ERROR;
+    }
+    HostIrqDisable();
+    if (p_uart->tx_state != HAL_UART_STATE_READY) {
+        HostIrqEnable();
+        return HAL_BUSY;
+    }
+    p_uart->tx_state = HAL_UART_STATE_BUSY_TX;
+    HostIrqEnable();
+
+    for (uint16_t i = 0; i < size && ret == HAL_OK; i++) {
+        while (!ll_uart_is_active_flag_tfnf(p_uart->p_instance)) {
+            if (g_now >= deadline) {
+                ret = HAL_TIMEOUT;
+                break;
+            }
+        }
+        if (ret == HAL_OK) {
+            ll_uart_transmit_data8(p_uart->p_instance, p_data[i]);
+        }
+    }
+    while (ret == HAL_OK && !ll_uart_is_active_flag_tfe(p_uart->p_instance)) {
+        if (g_now >= deadline) {
+            ret = HAL_TIMEOUT;
+        }
+    }
+    p_uart->tx_state = HAL_UART_STATE_READY;
+    return ret;
+}
+
+hal_status_t hal_uart_receive(uart_handle_t *p_uart, uint8_t *p_data, uint16_t size, uint32_t timeout)
+{
+    struct port *p = Port(p_uart->p_instance);
+    uint64_t deadline = g_now + (uint64_t)timeout * NS_PER_MS;
+
+    if (p == NULL || p_data == NULL || size == 0) {
+        return HAL_ERROR;
+    }
+    HostIrqDisable();
+    if (p_uart->rx_state != HAL_UART_STATE_READY) {
+        HostIrqEnable();
+        return HAL_BUSY;
+    }
+    p_uart->rx_state = HAL_UART_STATE_BUSY_RX;
+    HostIrqEnable();
+
+    for (uint16_t i = 0; i < size; i++) {
+        while (!ll_uart_is_active_flag_rfne(p_uart->p_instance)) {
+            if (g_now >= deadline) {
+                p_uart->rx_state = HAL_UART_STATE_READY;
+                return HAL_TIMEOUT;
+            }
+            Poll();
+        }
+        p_data[i] = ll_uart_receive_data8(p_uart->p_instance);
+    }
+    p_uart->rx_state = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+hal_status_t hal_uart_abort_transmit_it(uart_handle_t *p_uart)
+{
+    struct port *p = Port(p_uart->p_instance);
+
+    HostIrqDisable();
+    p->ier &= ~UART_IT_THRE;
+    p->tx_dma = false;
+    p->tx_dma_done = false;
+    p_uart->tx_xfer_count = 0;
+    p_uart->tx_state = HAL_UART_STATE_READY;
+    Update(p);
+    HostIrqEnable();
+    hal_uart_abort_tx_cplt_callback(p_uart);
+    return HAL_OK;
+}
+
+hal_status_t hal_uart_abort_receive(uart_handle_t *p_uart)
+{
+    struct port *p = Port(p_uart->p_instance);
+
+    HostIrqDisable();
+    EndRx(p, p_uart);
+    p->rx_dma_done = false;
+    p_uart->rx_xfer_count = 0;
+    Update(p);
+    HostIrqEnable();
+    return HAL_OK;
+}
+
+void ll_uart_enable_it(uart_regs_t *UARTx, uint32_t mask)
+{
+    struct port *p = Port(UARTx);
+
+    p->ier |= mask;
+    Update(p);
+}
+
+void ll_uart_set_rx_fifo_threshold(uart_regs_t *UARTx, uint32_t threshold)
+{
+    Port(UARTx)->rx_th = RxThreshold(threshold);
+}
+
+void ll_uart_set_tx_fifo_threshold(uart_regs_t *UARTx, uint32_t threshold)
+{
+    Port(UARTx)->tx_th = TxThreshold(threshold);
+}
+
+uint32_t ll_uart_is_enabled_fifo(uart_regs_t *UARTx)
+{
+    return 1;
+}
+
+uint32_t ll_uart_is_active_flag_rfne(uart_regs_t *UARTx)
+{
+    return Port(UARTx)->rx_count != 0;
+}
+
+uint32_t ll_uart_is_active_flag_tfnf(uart_regs_t *UARTx)
+{
+    if (Port(UARTx)->tx_count < UART_FAKE_FIFO_DEPTH) {
+        return 1;
+    }
+    Poll();
+    return 0;
+}
+
+uint32_t ll_uart_is_active_flag_tfe(uart_regs_t *UARTx)
+{
+    if (Port(UARTx)->tx_count == 0) {
+        return 1;
+    }
+    Poll();
+    return 0;
+}
+
+uint8_t ll_uart_receive_data8(uart_regs_t *UARTx)
+{
+    struct port *p = Port(UARTx);
+
+    return (p->rx_count != 0) ? RxPop(p) : 0;
+}
+
+void ll_uart_transmit_data8(uart_regs_t *UARTx, uint8_t value)
+{
+    struct port *p = Port(UARTx);
+
+    if (p->tx_count < UART_FAKE_FIFO_DEPTH) {
+        TxPush(p, value);
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The UART HAL under app_uart.c, over a model of the two UARTs on a modelled clock. Each port has a
+ * 16-byte RX and TX FIFO; the lines move one character per frame time at the baud rate set by
+ * hal_uart_init. The interrupt and DMA calls behave as drivers/inc/gr55xx_hal_uart.h describes:
+ * the RX data available interrupt fires at the RX FIFO threshold, the character timeout four frames
+ * after the last RX FIFO activity, the THR empty interrupt at the TX FIFO threshold; an interrupt
+ * receive ends on its count or, with the receiver timeout on, on a character timeout; an overrun
+ * ends it with the error callback, a parity, framing or break error reports and goes on. DMA moves
+ * bytes between the buffers and the FIFOs as they have room and raises its completion as a DMA
+ * interrupt. Every interrupt is taken a set latency after it is raised, through UART0_IRQHandler
+ * and UART1_IRQHandler, between HostIsrEnter and HostIsrExit.
+ *
+ * The model only moves while uart_fake_run advances it, or while a blocking call or a poll of a FIFO
+ * flag waits on it; such a wait takes the interrupts that fall due unless its thread has them
+ * masked, as a polling loop on the device would.
+ */
+#ifndef __UART_FAKE_H__
+#define __UART_FAKE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gr55xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UART_FAKE_PORTS             2
+#define UART_FAKE_FIFO_DEPTH        16
+#define UART_FAKE_LINE_MAX          (1024 * 1024)
+#define UART_FAKE_SENT_MAX          (1024 * 1024)
+#define UART_FAKE_DMA_BLOCK_MAX     4095
+#define UART_FAKE_IRQ_LATENCY_NS    3000
+
+struct uart_fake_stats {
+    uint32_t irqs;              /* UART interrupt entries */
+    uint32_t dma_irqs;          /* DMA completion and error interrupts */
+    uint32_t rx_bytes;          /* bytes that reached the RX FIFO */
+    uint32_t overruns;          /* bytes lost to a full RX FIFO */
+    uint32_t rx_fifo_max;       /* highest RX FIFO level seen */
+    uint32_t tx_bytes;          /* bytes sent on the TX line */
+};
+
+/* Forget both ports, the clock, the lines, the sent bytes and the statistics. */
+void uart_fake_reset(void);
+/* Delay from raising an interrupt to entering its handler, UART_FAKE_IRQ_LATENCY_NS by default. */
+void uart_fake_set_irq_latency(uint32_t ns);
+/* Queue bytes on the RX line of a port, back to back behind any still queued. */
+void uart_fake_rx_push(uint8_t id, const uint8_t *data, uint32_t len);
+/* Queue one byte that arrives with a line error, HAL_UART_ERROR_PE, _FE or _BI. */
+void uart_fake_rx_push_error(uint8_t id, uint8_t byte, uint32_t code);
+/* Bytes queued on the RX line of a port that have not reached its FIFO yet. */
+uint32_t uart_fake_rx_queued(uint8_t id);
+/* End the TX DMA block in flight on a port with a DMA error; false when there is none. */
+bool uart_fake_tx_dma_error(uint8_t id);
+/* Advance the model by ns, taking the interrupts that fall due. */
+void uart_fake_run(uint64_t ns);
+/* One step of a task waiting on the UART, as a polling loop takes it; for HostIdleHookSet. */
+void uart_fake_idle(void);
+uint64_t uart_fake_now_ns(void);
+/* Frame time of a port at its baud rate and frame format. */
+uint64_t uart_fake_char_ns(uint8_t id);
+/* The bytes a port sent on its TX line, in order; returns how many. */
+uint32_t uart_fake_sent(uint8_t id, const uint8_t **p_data);
+void uart_fake_get_stats(uint8_t id, struct uart_fake_stats *st);
+/* The FIFO levels a port raises its RX data available and THR empty interrupts at, in bytes. */
+void uart_fake_thresholds(uint8_t id, uint32_t *rx, uint32_t *tx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
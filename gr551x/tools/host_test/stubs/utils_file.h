@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Open flags and seek origins of the OHOS file utilities (utils/native/lite/include/utils_file.h). */
+#ifndef __HOST_UTILS_FILE_H__
+#define __HOST_UTILS_FILE_H__
+
+#define O_RDONLY_FS     00
+#define O_WRONLY_FS     01
+#define O_RDWR_FS       02
+#define O_CREAT_FS      0100
+#define O_EXCL_FS       0200
+#define O_TRUNC_FS      01000
+#define O_APPEND_FS     02000
+
+#define SEEK_SET_FS     0
+#define SEEK_CUR_FS     1
+#define SEEK_END_FS     2
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Log store (libraries/app_log/app_log_store.c) on the hal_flash extensions: logs reach the flash in
+ * order across wraps of the log cache, a wrapped cache costs no extra page program with
+ * hal_flash_ext_writev, and logs are only dropped from the cache once written, so a failed or short
+ * write loses nothing. Built with TEST_WRITEV=0 it covers the flash_write fallback instead.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "app_log_store.h"
+
+#ifndef TEST_WRITEV
+#define TEST_WRITEV     1
+#endif
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x10000)
+#define DB_SIZE         (4 * FLASH_SIM_SECTOR_SIZE)
+#define NV_TAG          0xC010
+#define STAMP_SIZE      26          /* APP_LOG_STORE_TIME_SIZE */
+#define HEAD_OFFSET     12          /* log_store_head_t.offset */
+#define RECORD_SIZE     100
+#define STREAM_MAX      DB_SIZE
+#define BUDGET_NONE     0xFFFFFFFF
+
+static uint8_t  g_nv[32];
+static uint16_t g_nv_len;
+static uint8_t  g_stream[STREAM_MAX];   /* what the flash should hold from PART_ADDR on */
+static uint32_t g_stream_len;
+static uint32_t g_budget = BUDGET_NONE; /* bytes the flash writes may still program */
+static uint32_t g_pages_touched;        /* pages covered by each write call, summed */
+
+uint8_t nvds_get(NvdsTag_t tag, uint16_t *p_len, uint8_t *p_buf)
+{
+    if (g_nv_len == 0 || *p_len < g_nv_len) {
+        return NVDS_TAG_NOT_EXISTED;
+    }
+    memcpy(p_buf, g_nv, g_nv_len);
+    *p_len = g_nv_len;
+    return NVDS_SUCCESS;
+}
+
+uint8_t nvds_put(NvdsTag_t tag, uint16_t len, const uint8_t *p_buf)
+{
+    memcpy(g_nv, p_buf, len);
+    g_nv_len = len;
+    return NVDS_SUCCESS;
+}
+
+static uint32_t HeadOffset(void)
+{
+    uint32_t offset;
+
+    memcpy(&offset, &g_nv[HEAD_OFFSET], sizeof(offset));
+    return offset;
+}
+
+static uint32_t Budget(uint32_t len)
+{
+    return (g_budget < len) ? g_budget : len;
+}
+
+static void Spend(uint32_t addr, uint32_t len)
+{
+    if (len > 0) {
+        g_pages_touched += (addr + len - 1) / FLASH_SIM_PAGE_SIZE - addr / FLASH_SIM_PAGE_SIZE + 1;
+    }
+    if (g_budget != BUDGET_NONE) {
+        g_budget -= len;
+    }
+}
+
+static uint32_t LimitedWritev(const uint32_t addr, const hal_flash_iovec_t *iov, const uint32_t cnt)
+{
+    hal_flash_iovec_t cut[2];
+    uint32_t left = Budget(BUDGET_NONE);
+    uint32_t ret;
+
+    CHECK(cnt == 2);
+    for (uint32_t i = 0; i < cnt; i++) {
+        cut[i] = iov[i];
+        cut[i].len = (cut[i].len < left) ? cut[i].len : left;
+        left -= cut[i].len;
+    }
+    ret = hal_flash_ext_writev(addr, cut, cnt);
+    Spend(addr, ret);
+    return ret;
+}
+
+static uint32_t LimitedWrite(const uint32_t addr, const uint8_t *buf, const uint32_t size)
+{
+    uint32_t len = Budget(size);
+    uint32_t ret = (len != 0) ? hal_flash_ext_write(addr, buf, len) : 0;
+
+    Spend(addr, ret);
+    return ret;
+}
+
+static bool FlashInit(void)
+{
+    return true;
+}
+
+static void Save(uint32_t records)
+{
+    uint8_t data[RECORD_SIZE];
+
+    for (uint32_t i = 0; i < records; i++) {
+        memset(data, 'a' + (g_stream_len / RECORD_SIZE) % 26, sizeof(data));
+        CHECK(app_log_store_save(data, sizeof(data)) == SDK_SUCCESS);
+        memcpy(&g_stream[g_stream_len], "[1970/01/01 00:00:00:000] ", STAMP_SIZE);
+        memcpy(&g_stream[g_stream_len + STAMP_SIZE], data, sizeof(data));
+        g_stream_len += STAMP_SIZE + sizeof(data);
+        app_log_store_schedule();
+    }
+}
+
+static bool FlashHoldsStream(void)
+{
+    return memcmp(flash_sim_image() + (PART_ADDR - FLASH_SIM_BASE_ADDR), g_stream, g_stream_len) == 0;
+}
+
+/* Eight times the log cache, so it wraps at every point of a 1 KB flush. */
+static void TestInOrder(void)
+{
+    struct flash_sim_stats st;
+
+    flash_sim_reset_stats();
+    g_pages_touched = 0;
+    Save(100);
+    app_log_store_flush();
+    CHECK(HeadOffset() == g_stream_len);
+    CHECK(FlashHoldsStream());
+
+    flash_sim_get_stats(&st);
+    printf("%s: %u bytes in %u page programs\n", TEST_WRITEV ? "writev" : "write per span",
+           (unsigned)g_stream_len, (unsigned)st.program_pages);
+    CHECK(st.nor_violations == 0);
+    /* With writev both halves of a wrapped cache share their page program. */
+    CHECK(!TEST_WRITEV || st.program_pages == g_pages_touched);
+}
+
+static void TestFailedWritesKeepLogs(void)
+{
+    uint32_t offset = HeadOffset();
+
+    /* Nothing written: nothing dropped, nothing moved, and flush gives up instead of spinning. */
+    g_budget = 0;
+    Save(10);
+    app_log_store_flush();
+    CHECK(HeadOffset() == offset);
+
+    /* A short write only drops what reached the flash. */
+    g_budget = 100;
+    app_log_store_schedule();
+    CHECK(HeadOffset() == offset + 100);
+
+    g_budget = BUDGET_NONE;
+    app_log_store_flush();
+    CHECK(HeadOffset() == g_stream_len);
+    CHECK(FlashHoldsStream());
+}
+
+int main(void)
+{
+    app_log_store_info_t info = { NV_TAG, PART_ADDR, DB_SIZE, FLASH_SIM_SECTOR_SIZE };
+    app_log_store_op_t ops = {
+        .flash_init   = FlashInit,
+        .flash_erase  = hal_flash_ext_erase,
+        .flash_read   = hal_flash_ext_read,
+        .flash_write  = LimitedWrite,
+        .flash_writev = TEST_WRITEV ? LimitedWritev : NULL,
+    };
+
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_ext_init();
+    CHECK(app_log_store_init(&info, &ops) == SDK_SUCCESS);
+    TestInOrder();
+    TestFailedWritesKeepLogs();
+    flash_sim_close();
+    return HostTestResult(TEST_WRITEV ? "app_log_store" : "app_log_store_spans");
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The chained transfers of app_spi.c and app_qspi.c against a fake DMA engine: a large transfer is
+ * cut into contiguous blocks of at most the DMA block size, each started from the completion of the
+ * one before, with CS held low throughout. Exactly one event reports the transfer, after its last
+ * block and with its full 32-bit size; a block that fails mid-chain ends it with one ERROR event
+ * and a nonzero error code, and the controller is usable again afterwards.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "app_drv_fake.h"
+#include "app_qspi.h"
+#include "app_spi.h"
+#include "spi_dma_fake.h"
+
+#define SPI_CS_PIN          APP_IO_PIN_2
+#define QSPI_CS_PIN         APP_IO_PIN_15
+#define BUF_MAX             (150 * 1024)
+#define EVT_MAX             8
+
+struct evt {
+    int      type;
+    uint32_t value;                 /* size, or error code for an ERROR event */
+    bool     in_isr;
+    uint8_t  cs;                    /* CS level when the event was reported */
+    uint32_t blocks;                /* blocks started before the event */
+};
+
+static uint8_t g_buf[BUF_MAX];
+static struct evt g_evts[EVT_MAX];
+static uint32_t g_evtCount;
+
+static void Record(int type, uint32_t value, app_io_type_t cs_type, uint32_t cs_pin)
+{
+    const struct spi_dma_fake_block *log;
+
+    if (g_evtCount < EVT_MAX) {
+        g_evts[g_evtCount] = (struct evt) {
+            .type = type, .value = value, .in_isr = __get_IPSR() != 0,
+            .cs = app_drv_fake_pin_level(cs_type, cs_pin), .blocks = spi_dma_fake_blocks(&log),
+        };
+    }
+    g_evtCount++;
+}
+
+static void SpiEvt(app_spi_evt_t *p_evt)
+{
+    Record(p_evt->type, p_evt->type == APP_SPI_EVT_ERROR ? p_evt->data.error_code : p_evt->data.size,
+           APP_IO_TYPE_NORMAL, SPI_CS_PIN);
+}
+
+static void QspiEvt(app_qspi_evt_t *p_evt)
+{
+    Record(p_evt->type, p_evt->type == APP_QSPI_EVT_ERROR ? p_evt->data.error_code : p_evt->data.size,
+           APP_IO_TYPE_NORMAL, QSPI_CS_PIN);
+}
+
+static void Reset(void)
+{
+    spi_dma_fake_reset();
+    app_drv_fake_reset();
+    memset(g_evts, 0, sizeof(g_evts));
+    g_evtCount = 0;
+    for (uint32_t i = 0; i < BUF_MAX; i++) {
+        g_buf[i] = (uint8_t)(i * 13 + 5);
+    }
+}
+
+static void Setup(void)
+{
+    app_spi_params_t spi = {
+        .id = APP_SPI_ID_MASTER,
+        .pin_cfg = {
+            .cs   = { APP_IO_TYPE_NORMAL, APP_IO_MUX_7, SPI_CS_PIN, APP_IO_NOPULL, APP_SPI_PIN_ENABLE },
+            .clk  = { APP_IO_TYPE_NORMAL, APP_IO_MUX_4, APP_IO_PIN_3, APP_IO_NOPULL, APP_SPI_PIN_ENABLE },
+            .mosi = { APP_IO_TYPE_NORMAL, APP_IO_MUX_4, APP_IO_PIN_4, APP_IO_NOPULL, APP_SPI_PIN_ENABLE },
+            .miso = { APP_IO_TYPE_NORMAL, APP_IO_MUX_4, APP_IO_PIN_5, APP_IO_NOPULL, APP_SPI_PIN_ENABLE },
+        },
+        .use_mode = { APP_SPI_TYPE_DMA, DMA_Channel0, DMA_Channel1 },
+        .init = { .data_size = SPI_DATASIZE_8BIT },
+    };
+    app_qspi_params_t qspi = {
+        .id = APP_QSPI_ID_0,
+        .pin_cfg = {
+            .cs   = { APP_IO_TYPE_NORMAL, APP_IO_MUX_7, QSPI_CS_PIN, APP_IO_NOPULL, APP_QSPI_PIN_ENABLE },
+            .clk  = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_9, APP_IO_NOPULL, APP_QSPI_PIN_ENABLE },
+            .io_0 = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_8, APP_IO_NOPULL, APP_QSPI_PIN_ENABLE },
+            .io_1 = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_14, APP_IO_NOPULL, APP_QSPI_PIN_ENABLE },
+            .io_2 = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_13, APP_IO_NOPULL, APP_QSPI_PIN_ENABLE },
+            .io_3 = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_12, APP_IO_NOPULL, APP_QSPI_PIN_ENABLE },
+        },
+        .use_mode = { APP_QSPI_TYPE_DMA, DMA_Channel2 },
+    };
+
+    Reset();
+    CHECK(app_spi_init(&spi, SpiEvt) == APP_DRV_SUCCESS);
+    CHECK(app_qspi_init(&qspi, QspiEvt) == APP_DRV_SUCCESS);
+}
+
+/* Complete blocks one at a time, checking that no event is reported before the last one. */
+static void RunChain(const void *handle, uint32_t size)
+{
+    uint32_t expected = (size + SPI_DMA_FAKE_BLOCK_MAX - 1) / SPI_DMA_FAKE_BLOCK_MAX;
+
+    for (uint32_t i = 0; i < expected; i++) {
+        CHECK(g_evtCount == 0);
+        CHECK(spi_dma_fake_complete(handle));
+    }
+    CHECK(!spi_dma_fake_pending(handle));
+}
+
+/* The blocks are contiguous, full except the last, on one handle and in one direction. */
+static void CheckBlocks(const void *handle, uint8_t *p_data, uint32_t size, bool rx)
+{
+    const struct spi_dma_fake_block *log;
+    uint32_t count = spi_dma_fake_blocks(&log);
+    uint32_t offset = 0;
+
+    CHECK(count == (size + SPI_DMA_FAKE_BLOCK_MAX - 1) / SPI_DMA_FAKE_BLOCK_MAX);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t want = (size - offset > SPI_DMA_FAKE_BLOCK_MAX) ? SPI_DMA_FAKE_BLOCK_MAX : size - offset;
+        CHECK(log[i].handle == handle && log[i].rx == rx && log[i].dma);
+        CHECK(log[i].p_data == p_data + offset && log[i].length == want);
+        offset += log[i].length;
+    }
+    CHECK(offset == size);
+}
+
+static void CheckOneEvent(int type, uint32_t size, uint32_t blocks)
+{
+    CHECK(g_evtCount == 1);
+    CHECK(g_evts[0].type == type && g_evts[0].value == size);
+    CHECK(g_evts[0].in_isr && g_evts[0].cs == 1 && g_evts[0].blocks == blocks);
+}
+
+static void TestSpiSizes(void)
+{
+    static const uint32_t sizes[] = { 1, 4095, 4096, 8190, 8191, 70000, BUF_MAX };
+    spi_handle_t *h = app_spi_get_handle(APP_SPI_ID_MASTER);
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint32_t size = sizes[i];
+        const uint8_t *sent;
+
+        Reset();
+        CHECK(app_spi_transmit_large_async(APP_SPI_ID_MASTER, g_buf, size) == APP_DRV_SUCCESS);
+        CHECK(app_drv_fake_pin_level(APP_IO_TYPE_NORMAL, SPI_CS_PIN) == 0);
+        RunChain(h, size);
+        CheckBlocks(h, g_buf, size, false);
+        CheckOneEvent(APP_SPI_EVT_TX_CPLT, size, (size + SPI_DMA_FAKE_BLOCK_MAX - 1) / SPI_DMA_FAKE_BLOCK_MAX);
+        CHECK(spi_dma_fake_sent(h, &sent) == size && memcmp(sent, g_buf, size) == 0);
+        CHECK(app_drv_fake_pin_falls(APP_IO_TYPE_NORMAL, SPI_CS_PIN) == 1);
+
+        Reset();
+        CHECK(app_spi_receive_large_async(APP_SPI_ID_MASTER, g_buf, size) == APP_DRV_SUCCESS);
+        RunChain(h, size);
+        CheckBlocks(h, g_buf, size, true);
+        CHECK(g_evtCount == 1 && g_evts[0].type == APP_SPI_EVT_RX_DATA && g_evts[0].value == size);
+        for (uint32_t n = 0; n < size; n++) {
+            if (g_buf[n] != SPI_DMA_FAKE_RX_BYTE(n)) {
+                CHECK(g_buf[n] == SPI_DMA_FAKE_RX_BYTE(n));
+                break;
+            }
+        }
+        CHECK(app_drv_fake_pin_falls(APP_IO_TYPE_NORMAL, SPI_CS_PIN) == 1);
+    }
+}
+
+static void TestSpiBusyAndPlain(void)
+{
+    spi_handle_t *h = app_spi_get_handle(APP_SPI_ID_MASTER);
+
+    Reset();
+    CHECK(app_spi_transmit_large_async(APP_SPI_ID_MASTER, g_buf, 3 * SPI_DMA_FAKE_BLOCK_MAX) == APP_DRV_SUCCESS);
+    CHECK(spi_dma_fake_complete(h));
+    CHECK(app_spi_transmit_large_async(APP_SPI_ID_MASTER, g_buf, 10) == APP_DRV_ERR_BUSY);
+    CHECK(app_spi_transmit_async(APP_SPI_ID_MASTER, g_buf, 10) == APP_DRV_ERR_BUSY);
+    CHECK(app_spi_transmit_large_async(APP_SPI_ID_MASTER, g_buf, 0) == APP_DRV_ERR_INVALID_PARAM);
+    RunChain(h, 2 * SPI_DMA_FAKE_BLOCK_MAX);
+    CheckOneEvent(APP_SPI_EVT_TX_CPLT, 3 * SPI_DMA_FAKE_BLOCK_MAX, 3);
+
+    /* The plain call is not chained and reports its own size. */
+    Reset();
+    CHECK(app_spi_transmit_async(APP_SPI_ID_MASTER, g_buf, 4000) == APP_DRV_SUCCESS);
+    CHECK(spi_dma_fake_complete(h) && !spi_dma_fake_pending(h));
+    CheckOneEvent(APP_SPI_EVT_TX_CPLT, 4000, 1);
+}
+
+static void TestSpiErrors(void)
+{
+    spi_handle_t *h = app_spi_get_handle(APP_SPI_ID_MASTER);
+
+    /* The third block is refused with the HAL error code clear: the error still carries a code. */
+    Reset();
+    CHECK(app_spi_transmit_large_async(APP_SPI_ID_MASTER, g_buf, 5 * SPI_DMA_FAKE_BLOCK_MAX) == APP_DRV_SUCCESS);
+    spi_dma_fake_refuse(1);
+    CHECK(spi_dma_fake_complete(h));
+    CHECK(g_evtCount == 0);
+    CHECK(spi_dma_fake_complete(h));
+    CHECK(!spi_dma_fake_pending(h));
+    CheckOneEvent(APP_SPI_EVT_ERROR, HAL_SPI_ERROR_TRANSFER, 2);
+
+    /* A DMA error on the second block reports the HAL code, once. */
+    Reset();
+    CHECK(app_spi_receive_large_async(APP_SPI_ID_MASTER, g_buf, 5 * SPI_DMA_FAKE_BLOCK_MAX) == APP_DRV_SUCCESS);
+    CHECK(spi_dma_fake_complete(h));
+    CHECK(spi_dma_fake_error(h, HAL_SPI_ERROR_DMA));
+    CHECK(!spi_dma_fake_pending(h));
+    CheckOneEvent(APP_SPI_EVT_ERROR, HAL_SPI_ERROR_DMA, 2);
+
+    /* A first block refused fails the call itself, with no event and CS released. */
+    Reset();
+    spi_dma_fake_refuse(0);
+    CHECK(app_spi_transmit_large_async(APP_SPI_ID_MASTER, g_buf, 2 * SPI_DMA_FAKE_BLOCK_MAX) == HAL_BUSY);
+    CHECK(g_evtCount == 0 && app_drv_fake_pin_level(APP_IO_TYPE_NORMAL, SPI_CS_PIN) == 1);
+
+    /* The chain state is gone: the next transfer reports its own size. */
+    Reset();
+    CHECK(app_spi_transmit_large_async(APP_SPI_ID_MASTER, g_buf, 100) == APP_DRV_SUCCESS);
+    CHECK(spi_dma_fake_complete(h));
+    CheckOneEvent(APP_SPI_EVT_TX_CPLT, 100, 1);
+}
+
+static void TestQspi(void)
+{
+    qspi_handle_t *h = app_qspi_get_handle(APP_QSPI_ID_0);
+    const uint8_t *sent;
+
+    Reset();
+    CHECK(app_qspi_transmit_large_async(APP_QSPI_ID_0, g_buf, BUF_MAX) == APP_DRV_SUCCESS);
+    CHECK(app_drv_fake_pin_level(APP_IO_TYPE_NORMAL, QSPI_CS_PIN) == 0);
+    RunChain(h, BUF_MAX);
+    CheckBlocks(h, g_buf, BUF_MAX, false);
+    CHECK(g_evtCount == 1 && g_evts[0].type == APP_QSPI_EVT_TX_CPLT && g_evts[0].value == BUF_MAX);
+    CHECK(g_evts[0].in_isr && g_evts[0].cs == 1);
+    CHECK(spi_dma_fake_sent(h, &sent) == BUF_MAX && memcmp(sent, g_buf, BUF_MAX) == 0);
+    CHECK(app_drv_fake_pin_falls(APP_IO_TYPE_NORMAL, QSPI_CS_PIN) == 1);
+
+    Reset();
+    CHECK(app_qspi_receive_large_async(APP_QSPI_ID_0, g_buf, 9000) == APP_DRV_SUCCESS);
+    RunChain(h, 9000);
+    CheckBlocks(h, g_buf, 9000, true);
+    CHECK(g_evtCount == 1 && g_evts[0].type == APP_QSPI_EVT_RX_DATA && g_evts[0].value == 9000);
+    CHECK(g_buf[8999] == SPI_DMA_FAKE_RX_BYTE(8999));
+
+    Reset();
+    CHECK(app_qspi_transmit_large_async(APP_QSPI_ID_0, g_buf, 3 * SPI_DMA_FAKE_BLOCK_MAX) == APP_DRV_SUCCESS);
+    spi_dma_fake_refuse(0);
+    CHECK(spi_dma_fake_complete(h));
+    CHECK(g_evtCount == 1 && g_evts[0].type == APP_QSPI_EVT_ERROR);
+    CHECK(g_evts[0].value == HAL_QSPI_ERROR_TRANSFER && g_evts[0].cs == 1);
+    CHECK(app_qspi_transmit_large_async(APP_QSPI_ID_0, g_buf, 1) == APP_DRV_SUCCESS);
+    CHECK(spi_dma_fake_complete(h));
+    CHECK(g_evtCount == 2 && g_evts[1].type == APP_QSPI_EVT_TX_CPLT && g_evts[1].value == 1);
+}
+
+int main(void)
+{
+    Setup();
+    TestSpiSizes();
+    TestSpiBusyAndPlain();
+    TestSpiErrors();
+    TestQspi();
+    return HostTestResult("app_spi_chain");
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The TX descriptors of app_uart.c on the fake UART. A DMA error releases the descriptor in flight
+ * with the error and the queue goes on with the next one. app_uart_flush() sends the queued
+ * descriptors before the ring data, as the interrupt path does. In DMA mode a descriptor pointing
+ * into flash is refused, and app_uart_deinit() releases what it drops as APP_UART_TX_DESC_DROPPED.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "app_drv_fake.h"
+#include "app_uart.h"
+#include "uart_fake.h"
+
+#define BAUD                921600
+#define US                  1000ULL
+#define MS                  1000000ULL
+#define TX_RING_SIZE        1024
+#define DATA_SIZE           1024
+
+struct release {
+    uint32_t calls;
+    uint32_t error_code;
+    uint32_t order;                 /* release sequence number of the last call */
+};
+
+static uint8_t g_txRing[TX_RING_SIZE];
+static uint8_t g_data[DATA_SIZE];
+static app_uart_tx_desc_t g_desc[3];
+static struct release g_rel[3];
+static uint32_t g_releases;
+static uint32_t g_errors;
+static uint32_t g_cplts;
+
+static void UartEvt(app_uart_evt_t *p_evt)
+{
+    g_errors += (p_evt->type == APP_UART_EVT_ERROR);
+    g_cplts += (p_evt->type == APP_UART_EVT_TX_CPLT);
+}
+
+static void Release(app_uart_tx_desc_t *p_desc)
+{
+    struct release *rel = p_desc->p_arg;
+
+    rel->calls++;
+    rel->error_code = p_desc->error_code;
+    rel->order = ++g_releases;
+}
+
+static void Setup(app_uart_type_t type)
+{
+    app_uart_params_t params = {
+        .id = APP_UART_ID_0,
+        .pin_cfg = {
+            .tx = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_10, APP_IO_PULLUP },
+            .rx = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_11, APP_IO_PULLUP },
+        },
+        .use_mode = { type, DMA_Channel0, DMA_Channel1 },
+        .init = {
+            .baud_rate = BAUD,
+            .data_bits = UART_DATABITS_8,
+            .stop_bits = UART_STOPBITS_1,
+            .parity = UART_PARITY_NONE,
+            .hw_flow_ctrl = UART_HWCONTROL_NONE,
+            .rx_timeout_mode = UART_RECEIVER_TIMEOUT_DISABLE,
+        },
+    };
+    app_uart_tx_buf_t tx_buf = { g_txRing, TX_RING_SIZE };
+
+    app_uart_deinit(APP_UART_ID_0);
+    uart_fake_reset();
+    app_drv_fake_reset();
+    memset(g_desc, 0, sizeof(g_desc));
+    memset(g_rel, 0, sizeof(g_rel));
+    g_releases = 0;
+    g_errors = 0;
+    g_cplts = 0;
+    for (uint32_t i = 0; i < DATA_SIZE; i++) {
+        g_data[i] = (uint8_t)(i * 13 + 5);
+    }
+    CHECK(app_uart_init(&params, UartEvt, &tx_buf) == APP_DRV_SUCCESS);
+}
+
+static app_uart_tx_desc_t *Desc(uint32_t i, const uint8_t *data, uint16_t size)
+{
+    g_desc[i] = (app_uart_tx_desc_t) {
+        .p_data = (uint8_t *)data,
+        .size = size,
+        .release = Release,
+        .p_arg = &g_rel[i],
+        .error_code = UINT32_MAX,
+    };
+    return &g_desc[i];
+}
+
+static bool SentEnds(const uint8_t *data, uint32_t len, uint32_t total)
+{
+    const uint8_t *sent;
+
+    return uart_fake_sent(APP_UART_ID_0, &sent) == total && total >= len &&
+           memcmp(sent + total - len, data, len) == 0;
+}
+
+/* The first descriptor fails part way; the second and the ring data behind them still go out. */
+static void DmaErrorFailsHead(void)
+{
+    const uint8_t *sent;
+    uint32_t total;
+
+    Setup(APP_UART_TYPE_DMA);
+    CHECK(app_uart_transmit_desc_async(APP_UART_ID_0, Desc(0, g_data, 300)) == APP_DRV_SUCCESS);
+    CHECK(app_uart_transmit_desc_async(APP_UART_ID_0, Desc(1, g_data + 300, 200)) == APP_DRV_SUCCESS);
+    CHECK(app_uart_transmit_async(APP_UART_ID_0, g_data + 500, 50) == APP_DRV_SUCCESS);
+    uart_fake_run(100 * US);
+    CHECK(uart_fake_tx_dma_error(APP_UART_ID_0));
+    CHECK(g_rel[0].calls == 1);
+    CHECK(g_rel[0].error_code & HAL_UART_ERROR_DMA);
+    CHECK(g_rel[1].calls == 0);
+    CHECK(g_errors == 1);
+    CHECK(app_uart_transmit_busy(APP_UART_ID_0));
+
+    uart_fake_run(10 * MS);
+    CHECK(!app_uart_transmit_busy(APP_UART_ID_0));
+    CHECK(g_rel[0].calls == 1);
+    CHECK(g_rel[1].calls == 1);
+    CHECK(g_rel[1].error_code == HAL_UART_ERROR_NONE);
+    /* Whatever part of the first got out, then all of the second and the ring data. */
+    total = uart_fake_sent(APP_UART_ID_0, &sent);
+    CHECK(total >= 250 && total < 550);
+    CHECK(SentEnds(g_data + 300, 250, total));
+    CHECK(g_cplts == 1);
+}
+
+/* With a ring block in flight, more ring data and a descriptor queued behind it, the flush sends the
+ * descriptor before the ring data. */
+static void FlushServesDescFirst(void)
+{
+    const uint8_t *sent;
+
+    Setup(APP_UART_TYPE_INTERRUPT);
+    CHECK(app_uart_transmit_async(APP_UART_ID_0, g_data, 100) == APP_DRV_SUCCESS);
+    CHECK(app_uart_transmit_async(APP_UART_ID_0, g_data + 100, 100) == APP_DRV_SUCCESS);
+    CHECK(app_uart_transmit_desc_async(APP_UART_ID_0, Desc(0, g_data + 200, 100)) == APP_DRV_SUCCESS);
+    app_uart_flush(APP_UART_ID_0);
+    uart_fake_run(MS);
+    CHECK(g_rel[0].calls == 1);
+    CHECK(g_rel[0].error_code == HAL_UART_ERROR_NONE);
+    CHECK(uart_fake_sent(APP_UART_ID_0, &sent) == 300);
+    CHECK(memcmp(sent, g_data, 100) == 0);
+    CHECK(memcmp(sent + 100, g_data + 200, 100) == 0);
+    CHECK(memcmp(sent + 200, g_data + 100, 100) == 0);
+}
+
+/* The DMA cannot read flash through the XIP cache: such a descriptor is refused, and never released. */
+static void DmaRefusesFlash(void)
+{
+    Setup(APP_UART_TYPE_DMA);
+    CHECK(app_uart_transmit_desc_async(APP_UART_ID_0, Desc(0, (const uint8_t *)GR55XX_FLASH_ADDRESS, 64)) ==
+          APP_DRV_ERR_INVALID_PARAM);
+    CHECK(!app_uart_transmit_busy(APP_UART_ID_0));
+    CHECK(g_rel[0].calls == 0);
+    CHECK(app_uart_transmit_desc_async(APP_UART_ID_0, Desc(1, g_data, 64)) == APP_DRV_SUCCESS);
+    uart_fake_run(2 * MS);
+    CHECK(g_rel[1].calls == 1);
+    CHECK(SentEnds(g_data, 64, 64));
+}
+
+/* Deinit drops the descriptor in flight and the one queued behind it, in queue order. */
+static void DeinitDrops(void)
+{
+    Setup(APP_UART_TYPE_DMA);
+    CHECK(app_uart_transmit_desc_async(APP_UART_ID_0, Desc(0, g_data, 500)) == APP_DRV_SUCCESS);
+    CHECK(app_uart_transmit_desc_async(APP_UART_ID_0, Desc(1, g_data + 500, 500)) == APP_DRV_SUCCESS);
+    uart_fake_run(100 * US);
+    CHECK(app_uart_deinit(APP_UART_ID_0) == APP_DRV_SUCCESS);
+    CHECK(g_rel[0].calls == 1);
+    CHECK(g_rel[0].error_code == APP_UART_TX_DESC_DROPPED);
+    CHECK(g_rel[1].calls == 1);
+    CHECK(g_rel[1].error_code == APP_UART_TX_DESC_DROPPED);
+    CHECK(g_rel[0].order < g_rel[1].order);
+}
+
+int main(void)
+{
+    DmaErrorFailsHead();
+    FlushServesDescFirst();
+    DmaRefusesFlash();
+    DeinitDrops();
+    app_uart_deinit(APP_UART_ID_0);
+    return HostTestResult("app_uart_desc");
+}
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The ring receive and the async transmit of app_uart.c on the fake UART at 921600 baud. A bursty
+ * peer and a reader that stalls for up to 8 ms lose no byte and overrun no FIFO, in interrupt and
+ * in DMA mode, with a transmit running alongside. Line errors in the middle of a transmit leave it
+ * alone: every queued byte goes out once and in order, the driver stays busy until the last one, and
+ * one TX_CPLT ends it. A DMA error does end the transmit, and the next one starts afresh.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "app_drv_fake.h"
+#include "app_uart.h"
+#include "uart_fake.h"
+
+#define BAUD                921600
+#define US                  1000ULL
+#define MS                  1000000ULL
+#define RX_RING_SIZE        1024
+#define TX_RING_SIZE        8192
+#define STREAM_SIZE         (64 * 1024)
+#define STALL_MS            8
+#define EVT_MAX             64
+
+struct evt {
+    int      type;
+    uint32_t value;                 /* size, or error code for an ERROR event */
+    bool     busy;                  /* app_uart_transmit_busy() when reported */
+};
+
+static uint8_t g_rxRing[RX_RING_SIZE];
+static uint8_t g_txRing[TX_RING_SIZE];
+static uint8_t g_stream[STREAM_SIZE];
+static uint8_t g_got[STREAM_SIZE];
+static struct evt g_evts[EVT_MAX];
+static uint32_t g_evtCount;
+static uint32_t g_seed;
+
+static uint32_t Rand(uint32_t n)
+{
+    g_seed = g_seed * 1103515245u + 12345u;
+    return (g_seed >> 8) % n;
+}
+
+static void UartEvt(app_uart_evt_t *p_evt)
+{
+    if (p_evt->type == APP_UART_EVT_RX_DATA) {
+        return;
+    }
+    if (g_evtCount < EVT_MAX) {
+        g_evts[g_evtCount] = (struct evt) {
+            .type = p_evt->type,
+            .value = p_evt->type == APP_UART_EVT_ERROR ? p_evt->data.error_code : p_evt->data.size,
+            .busy = app_uart_transmit_busy(APP_UART_ID_0),
+        };
+    }
+    g_evtCount++;
+}
+
+static uint32_t EvtCount(int type)
+{
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < g_evtCount && i < EVT_MAX; i++) {
+        n += (g_evts[i].type == type);
+    }
+    return n;
+}
+
+static void Setup(app_uart_type_t type)
+{
+    app_uart_params_t params = {
+        .id = APP_UART_ID_0,
+        .pin_cfg = {
+            .tx = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_10, APP_IO_PULLUP },
+            .rx = { APP_IO_TYPE_NORMAL, APP_IO_MUX_2, APP_IO_PIN_11, APP_IO_PULLUP },
+        },
+        .use_mode = { type, DMA_Channel0, DMA_Channel1 },
+        .init = {
+            .baud_rate = BAUD,
+            .data_bits = UART_DATABITS_8,
+            .stop_bits = UART_STOPBITS_1,
+            .parity = UART_PARITY_NONE,
+            .hw_flow_ctrl = UART_HWCONTROL_NONE,
+            .rx_timeout_mode = UART_RECEIVER_TIMEOUT_ENABLE,
+        },
+    };
+    app_uart_tx_buf_t tx_buf = { g_txRing, TX_RING_SIZE };
+    app_uart_irq_cfg_t irq_cfg = {
+        .rx_fifo_threshold = LL_UART_RX_FIFO_TH_HALF_FULL,
+        .tx_fifo_threshold = LL_UART_TX_FIFO_TH_CHAR_2,
+        .rx_block = 256,
+    };
+    app_uart_irq_stats_t irq;
+
+    app_uart_deinit(APP_UART_ID_0);
+    uart_fake_reset();
+    app_drv_fake_reset();
+    memset(g_evts, 0, sizeof(g_evts));
+    g_evtCount = 0;
+    g_seed = 1;
+    for (uint32_t i = 0; i < STREAM_SIZE; i++) {
+        g_stream[i] = (uint8_t)(i * 31 + (i >> 8));
+    }
+
+    CHECK(app_uart_irq_config(APP_UART_ID_0, &irq_cfg) == APP_DRV_SUCCESS);
+    CHECK(app_uart_init(&params, UartEvt, &tx_buf) == APP_DRV_SUCCESS);
+    CHECK(app_uart_irq_stats_get(APP_UART_ID_0, &irq, true) == APP_DRV_SUCCESS);
+    CHECK(app_uart_receive_ring_start(APP_UART_ID_0, g_rxRing, RX_RING_SIZE) == APP_DRV_SUCCESS);
+}
+
+/* Queue as much of data as the TX ring takes; returns how much. */
+static uint32_t Queue(const uint8_t *data, uint32_t len)
+{
+    uint32_t space = app_uart_transmit_space_get(APP_UART_ID_0);
+    uint32_t n = (len < space) ? len : space;
+
+    n = (n > UINT16_MAX) ? UINT16_MAX : n;
+    if (n != 0) {
+        CHECK(app_uart_transmit_async(APP_UART_ID_0, (uint8_t *)data, (uint16_t)n) == APP_DRV_SUCCESS);
+    }
+    return n;
+}
+
+static bool SentMatches(uint32_t len)
+{
+    const uint8_t *sent;
+
+    return uart_fake_sent(APP_UART_ID_0, &sent) == len && memcmp(sent, g_stream, len) == 0;
+}
+
+/*
+ * The peer sends the stream in bursts of up to 600 bytes at line rate, with gaps of up to 3 ms; the
+ * reader takes up to 256 bytes every 100 us, but every 20 ms stalls for STALL_MS. Meanwhile the same
+ * stream is sent back in pieces as the TX ring has room.
+ */
+static void NoLossWithStallingReader(app_uart_type_t type)
+{
+    struct uart_fake_stats st;
+    app_uart_irq_stats_t irq;
+    uint32_t pushed = 0;
+    uint32_t got = 0;
+    uint32_t queued = 0;
+    uint64_t next_burst = 0;
+    uint64_t next_stall = 20 * MS;
+
+    Setup(type);
+    while (got < STREAM_SIZE || !SentMatches(STREAM_SIZE)) {
+        uint64_t now = uart_fake_now_ns();
+
+        CHECK(now < 10000 * MS);
+        if (now >= 10000 * MS) {
+            break;
+        }
+        if (pushed < STREAM_SIZE && now >= next_burst && uart_fake_rx_queued(APP_UART_ID_0) == 0) {
+            uint32_t n = 1 + Rand(600);
+
+            n = (n > STREAM_SIZE - pushed) ? STREAM_SIZE - pushed : n;
+            uart_fake_rx_push(APP_UART_ID_0, g_stream + pushed, n);
+            pushed += n;
+            next_burst = now + n * uart_fake_char_ns(APP_UART_ID_0) + Rand(3000) * US;
+        }
+        if (queued < STREAM_SIZE) {
+            uint32_t n = 1 + Rand(300);
+
+            queued += Queue(g_stream + queued, (n > STREAM_SIZE - queued) ? STREAM_SIZE - queued : n);
+        }
+        if (now >= next_stall) {
+            uart_fake_run(STALL_MS * MS);
+            next_stall = uart_fake_now_ns() + 20 * MS;
+        } else {
+            uart_fake_run(100 * US);
+        }
+        got += app_uart_receive_ring_read(APP_UART_ID_0, g_got + got,
+                                          (STREAM_SIZE - got < 256) ? STREAM_SIZE - got : 256);
+    }
+
+    uart_fake_get_stats(APP_UART_ID_0, &st);
+    CHECK(got == STREAM_SIZE);
+    CHECK(memcmp(g_got, g_stream, STREAM_SIZE) == 0);
+    CHECK(st.overruns == 0);
+    CHECK(st.rx_bytes == STREAM_SIZE);
+    CHECK(SentMatches(STREAM_SIZE));
+    CHECK(EvtCount(APP_UART_EVT_ERROR) == 0);
+    CHECK(app_uart_irq_stats_get(APP_UART_ID_0, &irq, false) == APP_DRV_SUCCESS);
+    CHECK(irq.rx_bytes == STREAM_SIZE);
+    /* Half-full threshold and 256-byte blocks: well under one interrupt per received byte. */
+    CHECK(irq.irq_count < STREAM_SIZE);
+}
+
+/* Run until the transmit ends or limit passes, checking the driver stays busy until the wire is done. */
+static void RunTx(uint32_t len, uint64_t limit)
+{
+    uint64_t end = uart_fake_now_ns() + limit;
+
+    while (app_uart_transmit_busy(APP_UART_ID_0) && uart_fake_now_ns() < end) {
+        uart_fake_run(50 * US);
+        if (app_uart_transmit_busy(APP_UART_ID_0)) {
+            const uint8_t *sent;
+            CHECK(uart_fake_sent(APP_UART_ID_0, &sent) < len);
+        }
+    }
+    uart_fake_run(MS);
+}
+
+/*
+ * A framing error, then an overrun forced by masking the UART interrupt while the peer sends, both in
+ * the middle of a transmit that is topped up after each of them.
+ */
+static void RxErrorsKeepTx(app_uart_type_t type)
+{
+    static const uint8_t filler[64] = { 0 };
+    uint32_t queued;
+    uint8_t drop[RX_RING_SIZE];
+
+    Setup(type);
+    queued = Queue(g_stream, 2048);
+    uart_fake_run(5 * MS);
+    CHECK(app_uart_transmit_busy(APP_UART_ID_0));
+
+    uart_fake_rx_push_error(APP_UART_ID_0, 0x55, HAL_UART_ERROR_FE);
+    uart_fake_run(MS);
+    CHECK(EvtCount(APP_UART_EVT_ERROR) == 1);
+    CHECK(g_evts[0].value & HAL_UART_ERROR_FE);
+    CHECK(g_evts[0].busy);
+    CHECK(app_uart_transmit_busy(APP_UART_ID_0));
+    queued += Queue(g_stream + queued, 2048);
+
+    hal_nvic_disable_irq(UART0_IRQn);
+    uart_fake_rx_push(APP_UART_ID_0, filler, sizeof(filler));
+    uart_fake_run(sizeof(filler) * uart_fake_char_ns(APP_UART_ID_0) + MS);
+    hal_nvic_enable_irq(UART0_IRQn);
+    uart_fake_run(MS);
+    CHECK(EvtCount(APP_UART_EVT_ERROR) == 2);
+    CHECK(g_evts[1].value & HAL_UART_ERROR_OE);
+    CHECK(app_uart_transmit_busy(APP_UART_ID_0));
+    queued += Queue(g_stream + queued, 2048);
+    CHECK(queued == 6144);
+
+    RunTx(queued, 200 * MS);
+    CHECK(!app_uart_transmit_busy(APP_UART_ID_0));
+    CHECK(SentMatches(queued));
+    CHECK(EvtCount(APP_UART_EVT_TX_CPLT) == 1);
+    CHECK(g_evts[g_evtCount - 1].type == APP_UART_EVT_TX_CPLT);
+
+    /* Reception goes on after both errors. */
+    while (app_uart_receive_ring_read(APP_UART_ID_0, drop, sizeof(drop)) != 0) {
+    }
+    uart_fake_rx_push(APP_UART_ID_0, g_stream, 100);
+    uart_fake_run(2 * MS);
+    CHECK(app_uart_receive_ring_read(APP_UART_ID_0, drop, sizeof(drop)) == 100);
+    CHECK(memcmp(drop, g_stream, 100) == 0);
+}
+
+/* A DMA error ends the transmit in flight: the driver is idle again and the next transmit goes out. */
+static void TxDmaErrorEndsTx(void)
+{
+    const uint8_t *sent;
+    uint32_t before;
+
+    Setup(APP_UART_TYPE_DMA);
+    CHECK(Queue(g_stream, 100) == 100);
+    uart_fake_run(200 * US);
+    CHECK(uart_fake_tx_dma_error(APP_UART_ID_0));
+    CHECK(!app_uart_transmit_busy(APP_UART_ID_0));
+    CHECK(EvtCount(APP_UART_EVT_ERROR) == 1);
+    CHECK(g_evts[0].value & HAL_UART_ERROR_DMA);
+
+    uart_fake_run(2 * MS);
+    before = uart_fake_sent(APP_UART_ID_0, &sent);
+    CHECK(Queue(g_stream, 50) == 50);
+    CHECK(app_uart_transmit_busy(APP_UART_ID_0));
+    RunTx(before + 50, 10 * MS);
+    CHECK(!app_uart_transmit_busy(APP_UART_ID_0));
+    CHECK(uart_fake_sent(APP_UART_ID_0, &sent) == before + 50);
+    CHECK(memcmp(sent + before, g_stream, 50) == 0);
+    CHECK(EvtCount(APP_UART_EVT_TX_CPLT) == 1);
+}
+
+int main(void)
+{
+    NoLossWithStallingReader(APP_UART_TYPE_INTERRUPT);
+    NoLossWithStallingReader(APP_UART_TYPE_DMA);
+    RxErrorsKeepTx(APP_UART_TYPE_INTERRUPT);
+    RxErrorsKeepTx(APP_UART_TYPE_DMA);
+    TxDmaErrorEndsTx();
+    app_uart_deinit(APP_UART_ID_0);
+    return HostTestResult("app_uart_ring");
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The platform flash port (platform/flash/flash_port.c) with hal_flash_ext on the simulator: a BLE
+ * wake-up during an erase suspends it until the baseband is no longer active, a baseband that stays
+ * active holds the erase for FLASH_RADIO_HOLD_MAX_MS at most, and a wake-up while the flash is idle
+ * does not delay the next write once the radio is done.
+ */
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_test.h"
+#include "los_shim.h"
+#include "gr55xx_pwr.h"
+#include "hal_flash_ext.h"
+#include "flash_port.h"
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x10000)
+#define ERASE_US        45000
+#define RADIO_US        3000
+#define HOLD_MAX_US     20000
+#define TICK_US         1000
+
+static uint32_t g_wakeups;
+static uint64_t g_wakeAtUs;     /* simulator time to raise the wake-up at, 0 never */
+
+/* The SDK handler in ROM. */
+void BLESLP_IRQHandler(void)
+{
+    g_wakeups++;
+}
+
+/* The radio wakes up for an event while the erase is being polled. */
+static void PollHook(uint64_t now_us)
+{
+    if ((g_wakeAtUs != 0) && (now_us >= g_wakeAtUs)) {
+        g_wakeAtUs = 0;
+        HostBasebandStateSet(PMR_MGMT_ACTIVE_MODE);
+        FlashBleWakeupHandler();
+    }
+}
+
+/* The connection event ends RADIO_US after the erase got suspended. */
+static void *RadioEvent(void *arg)
+{
+    (void)arg;
+    while (hal_flash_ext_state() != HAL_FLASH_EXT_SUSPENDED) {
+        usleep(100);
+    }
+    usleep(RADIO_US);
+    HostBasebandStateSet(PMR_MGMT_SLEEP_MODE);
+    return NULL;
+}
+
+static uint64_t Erase(void)
+{
+    uint64_t start = HostTimeUs();
+
+    CHECK(hal_flash_ext_erase(PART_ADDR, FLASH_SIM_SECTOR_SIZE));
+    CHECK(hal_flash_ext_state() == HAL_FLASH_EXT_IDLE);
+    return HostTimeUs() - start;
+}
+
+static void TestRadioEvent(void)
+{
+    hal_flash_stats_t before;
+    hal_flash_stats_t st;
+    pthread_t th;
+    uint64_t took;
+
+    hal_flash_stats_get(&before);
+    g_wakeups = 0;
+    HostBasebandStateSet(PMR_MGMT_SLEEP_MODE);
+    g_wakeAtUs = flash_sim_clock_us() + ERASE_US / 2;
+    CHECK(pthread_create(&th, NULL, RadioEvent, NULL) == 0);
+    took = Erase();
+    pthread_join(th, NULL);
+
+    hal_flash_stats_get(&st);
+    CHECK(g_wakeups == 1);
+    CHECK(st.suspends == before.suspends + 1);
+    /* Held for the event, but released as soon as the baseband went to sleep. */
+    CHECK(took >= RADIO_US);
+    CHECK(took < HOLD_MAX_US);
+}
+
+static void TestRadioStaysActive(void)
+{
+    hal_flash_stats_t before;
+    hal_flash_stats_t st;
+    uint64_t took;
+
+    hal_flash_stats_get(&before);
+    HostBasebandStateSet(PMR_MGMT_SLEEP_MODE);
+    g_wakeAtUs = flash_sim_clock_us() + ERASE_US / 2;
+    took = Erase();
+
+    hal_flash_stats_get(&st);
+    CHECK(st.suspends == before.suspends + 1);
+    printf("held %u us\n", (unsigned)took);
+    /* The limit counts whole ticks from the first check of the hold. */
+    CHECK(took >= HOLD_MAX_US - TICK_US);
+    CHECK(took < 10 * HOLD_MAX_US);
+}
+
+/* A wake-up with no erase in flight leaves a hold that the next write drops right away. */
+static void TestWakeupWhileIdle(void)
+{
+    uint8_t buf[16];
+    uint64_t start;
+
+    memset(buf, 0x5A, sizeof(buf));
+    HostBasebandStateSet(PMR_MGMT_ACTIVE_MODE);
+    FlashBleWakeupHandler();
+    HostBasebandStateSet(PMR_MGMT_SLEEP_MODE);
+    start = HostTimeUs();
+    CHECK(hal_flash_ext_write(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(HostTimeUs() - start < 1000);
+}
+
+int main(void)
+{
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_ext_init();
+    flash_sim_set_poll(PollHook);
+    TestRadioEvent();
+    TestRadioStaysActive();
+    TestWakeupWhileIdle();
+    flash_sim_close();
+    return HostTestResult("flash_port");
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The file HAL (adapter/hals/utils/file/src/hal_file.c) on a fake /data: buffered writes reach the
+ * file system once, a write-behind that fails is reported by close, the access mode is enforced
+ * before anything is buffered, a closed descriptor is refused by every call, and the descriptor table hands out every slot and
+ * keeps each slot's buffer for reuse, also while other tasks open, write and close files.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "host_test.h"
+#include "fs_fake.h"
+#include "los_shim.h"
+#include "utils_file.h"
+#include "hal_file.h"
+#include "hal_file_ext.h"
+
+static void TestBufferedRoundTrip(void)
+{
+    struct fs_fake_stats st;
+    char buf[64];
+    int fd;
+
+    CHECK(fs_fake_reset() == 0);
+    fd = HalFileOpen("rt", O_RDWR_FS | O_CREAT_FS, 0);
+    CHECK(fd > 0);
+    for (int i = 0; i < 8; i++) {
+        CHECK(HalFileWrite(fd, "abcd", 4) == 4);
+    }
+    fs_fake_get_stats(&st);
+    CHECK(st.writes == 0);
+    CHECK(HalFileClose(fd) == 0);
+    fs_fake_get_stats(&st);
+    CHECK(st.writes == 1);
+
+    fd = HalFileOpen("rt", O_RDONLY_FS, 0);
+    CHECK(fd > 0);
+    CHECK(HalFileRead(fd, buf, sizeof(buf)) == 32);
+    CHECK(memcmp(buf, "abcdabcd", 8) == 0);
+    CHECK(HalFileClose(fd) == 0);
+}
+
+/* The descriptor is released even though the data is lost, and the caller is told. */
+static void TestCloseReportsFlushError(void)
+{
+    unsigned int size = 0;
+    int fd;
+
+    CHECK(fs_fake_reset() == 0);
+    fd = HalFileOpen("lost", O_RDWR_FS | O_CREAT_FS, 0);
+    CHECK(fd > 0);
+    CHECK(HalFileWrite(fd, "data", 4) == 4);
+    fs_fake_fail_write(0);
+    CHECK(HalFileClose(fd) == -1);
+    CHECK(HalFileStat("lost", &size) == 0);
+    CHECK(size == 0);
+
+    /* The slot is free again. */
+    CHECK(HalFileOpen("lost", O_RDWR_FS, 0) == fd);
+    CHECK(HalFileClose(fd) == 0);
+
+    /* HalFileFlush reports it as well. */
+    fd = HalFileOpen("lost", O_RDWR_FS, 0);
+    CHECK(HalFileWrite(fd, "data", 4) == 4);
+    fs_fake_fail_write(0);
+    CHECK(HalFileFlush(fd) == -1);
+    CHECK(HalFileClose(fd) == 0);
+}
+
+static void TestAccessMode(void)
+{
+    struct fs_fake_stats st;
+    unsigned int size = 0;
+    char buf[8];
+    int fd;
+
+    CHECK(fs_fake_reset() == 0);
+    fd = HalFileOpen("ro", O_RDWR_FS | O_CREAT_FS, 0);
+    CHECK(HalFileWrite(fd, "1234", 4) == 4);
+    CHECK(HalFileClose(fd) == 0);
+
+    fd = HalFileOpen("ro", O_RDONLY_FS, 0);
+    CHECK(fd > 0);
+    CHECK(HalFileWrite(fd, "xx", 2) == -1);
+    CHECK(HalFileWriteAt(fd, 0, "xx", 2) == -1);
+    fs_fake_get_stats(&st);
+    CHECK(st.writes == 1);
+    CHECK(HalFileClose(fd) == 0);
+    CHECK(HalFileStat("ro", &size) == 0);
+    CHECK(size == 4);
+
+    fd = HalFileOpen("ro", O_WRONLY_FS, 0);
+    CHECK(fd > 0);
+    CHECK(HalFileRead(fd, buf, sizeof(buf)) == -1);
+    CHECK(HalFileReadAt(fd, 0, buf, sizeof(buf)) == -1);
+    CHECK(HalFileClose(fd) == 0);
+}
+
+/* A descriptor in range but closed reaches neither the slot buffer nor the file system. */
+static void TestClosedDescriptor(void)
+{
+    struct fs_fake_stats st;
+    char buf[8];
+    int fd;
+
+    CHECK(fs_fake_reset() == 0);
+    fd = HalFileOpen("closed", O_RDWR_FS | O_CREAT_FS, 0);
+    CHECK(fd > 0);
+    CHECK(HalFileClose(fd) == 0);
+
+    CHECK(HalFileWrite(fd, "xx", 2) == -1);
+    CHECK(HalFileWriteAt(fd, 0, "xx", 2) == -1);
+    CHECK(HalFileRead(fd, buf, sizeof(buf)) == -1);
+    CHECK(HalFileReadAt(fd, 0, buf, sizeof(buf)) == -1);
+    CHECK(HalFileFlush(fd) == -1);
+    CHECK(HalFileSeek(fd, 0, SEEK_SET_FS) == -1);
+    CHECK(HalFileClose(fd) == -1);
+    fs_fake_get_stats(&st);
+    CHECK(st.writes == 0);
+
+    /* The next open of the slot starts with an empty buffer. */
+    fd = HalFileOpen("closed", O_RDWR_FS, 0);
+    CHECK(HalFileFlush(fd) == 0);
+    fs_fake_get_stats(&st);
+    CHECK(st.writes == 0);
+    CHECK(HalFileClose(fd) == 0);
+}
+
+#define MAX_OPEN_FILE   32
+
+static void TestDescriptorTable(void)
+{
+    HalFileStats before;
+    HalFileStats st;
+    char name[8];
+    int fd[MAX_OPEN_FILE];
+
+    CHECK(fs_fake_reset() == 0);
+    CHECK(HalFileStatsGet(&before) == 0);
+    for (int i = 0; i < MAX_OPEN_FILE; i++) {
+        (void)snprintf(name, sizeof(name), "f%d", i);
+        fd[i] = HalFileOpen(name, O_RDWR_FS | O_CREAT_FS, 0);
+        CHECK(fd[i] == i + 1);
+    }
+    /* Every slot is in use, including the one at the top bit of the map. */
+    CHECK(HalFileOpen("extra", O_RDWR_FS | O_CREAT_FS, 0) == -1);
+    CHECK(HalFileStatsGet(&st) == 0);
+    /* A first-fit search looks at 1 + 2 + ... + 32 slots. */
+    CHECK(st.fdScanAvoided - before.fdScanAvoided == MAX_OPEN_FILE * (MAX_OPEN_FILE + 1) / 2);
+    /* Only the low slots earlier tests used have a buffer already. */
+    CHECK(st.bufAllocAvoided - before.bufAllocAvoided < MAX_OPEN_FILE);
+
+    /* A slot freed while others are open keeps its buffer for the next open. */
+    before = st;
+    CHECK(HalFileClose(fd[MAX_OPEN_FILE - 1]) == 0);
+    CHECK(HalFileOpen("f31", O_RDWR_FS, 0) == MAX_OPEN_FILE);
+    CHECK(HalFileStatsGet(&st) == 0);
+    CHECK(st.bufAllocAvoided == before.bufAllocAvoided + 1);
+    for (int i = 0; i < MAX_OPEN_FILE; i++) {
+        CHECK(HalFileClose(fd[i]) == 0);
+    }
+
+    /* The buffers outlive the last close as well. */
+    fd[0] = HalFileOpen("f0", O_RDWR_FS, 0);
+    CHECK(fd[0] == 1);
+    CHECK(HalFileStatsGet(&before) == 0);
+    CHECK(before.bufAllocAvoided == st.bufAllocAvoided + 1);
+    CHECK(HalFileClose(fd[0]) == 0);
+}
+
+#define CHURN_TASKS     4
+#define CHURN_ROUNDS    200
+#define CHURN_RECORDS   48
+#define CHURN_REC_LEN   8
+
+static uint32_t g_churnDone;
+static uint32_t g_churnErrors;
+
+/* Write a file in small records, close it and read it back, over and over. */
+static VOID *Churn(UINT32 id)
+{
+    char name[8];
+    char rec[CHURN_REC_LEN + 1];
+    char buf[CHURN_RECORDS * CHURN_REC_LEN];
+    uint32_t errors = 0;
+    int fd;
+
+    (void)snprintf(name, sizeof(name), "c%u", (unsigned)id);
+    for (uint32_t round = 0; round < CHURN_ROUNDS; round++) {
+        fd = HalFileOpen(name, O_RDWR_FS | O_CREAT_FS | O_TRUNC_FS, 0);
+        for (uint32_t i = 0; i < CHURN_RECORDS; i++) {
+            (void)snprintf(rec, sizeof(rec), "%u%03u%03u", (unsigned)id, (unsigned)(round % 1000), (unsigned)i);
+            errors += (HalFileWrite(fd, rec, CHURN_REC_LEN) != CHURN_REC_LEN);
+        }
+        errors += (HalFileClose(fd) != 0);
+
+        fd = HalFileOpen(name, O_RDONLY_FS, 0);
+        errors += (HalFileRead(fd, buf, sizeof(buf)) != (int)sizeof(buf));
+        for (uint32_t i = 0; i < CHURN_RECORDS; i++) {
+            (void)snprintf(rec, sizeof(rec), "%u%03u%03u", (unsigned)id, (unsigned)(round % 1000), (unsigned)i);
+            errors += (memcmp(buf + i * CHURN_REC_LEN, rec, CHURN_REC_LEN) != 0);
+        }
+        errors += (HalFileClose(fd) != 0);
+    }
+    __atomic_fetch_add(&g_churnErrors, errors, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_churnDone, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Tasks keep closing their last file while others are writing through their own slot buffers. */
+static void TestConcurrentChurn(void)
+{
+    TSK_INIT_PARAM_S task = {
+        .pfnTaskEntry = Churn,
+        .pcName = "churn",
+    };
+    UINT32 id;
+
+    CHECK(fs_fake_reset() == 0);
+    for (UINT32 i = 0; i < CHURN_TASKS; i++) {
+        task.uwArg = i;
+        CHECK(LOS_TaskCreate(&id, &task) == LOS_OK);
+    }
+    while (__atomic_load_n(&g_churnDone, __ATOMIC_ACQUIRE) < CHURN_TASKS) {
+        (void)LOS_TaskDelay(1);
+    }
+    CHECK(g_churnErrors == 0);
+}
+
+int main(void)
+{
+    TestBufferedRoundTrip();
+    TestCloseReportsFlushError();
+    TestAccessMode();
+    TestClosedDescriptor();
+    TestDescriptorTable();
+    TestConcurrentChurn();
+    fs_fake_cleanup();
+    return HostTestResult("hal_file");
+}
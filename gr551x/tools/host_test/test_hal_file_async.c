@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Asynchronous writes of the file HAL (adapter/hals/utils/file/src/hal_file_async.c) on a fake /data:
+ * requests complete in order, every task waiting on a request is released when it completes, a wait
+ * that times out leaves nothing behind, a full queue rejects submissions, and closing a descriptor
+ * waits for the writes queued on it instead of leaving them to a stale or reused slot.
+ */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_test.h"
+#include "los_shim.h"
+#include "fs_fake.h"
+#include "utils_file.h"
+#include "hal_file.h"
+#include "hal_file_ext.h"
+
+#define QUEUE_LEN       16
+#define WAITERS         4
+#define WAIT_MS         2000
+#define SETTLE_US       50000
+
+/* A callback that holds the worker until the test opens the gate. */
+static volatile bool g_gateOpen;
+static volatile int g_lastDone;
+
+static void Gate(int fd, int result, void *arg)
+{
+    (void)fd;
+    (void)arg;
+    (void)result;
+    while (!g_gateOpen) {
+        usleep(1000);
+    }
+}
+
+static void Record(int fd, int result, void *arg)
+{
+    (void)fd;
+    CHECK(result >= 0);
+    g_lastDone = (int)(intptr_t)arg;
+}
+
+static void TestInOrder(void)
+{
+    char buf[16];
+    int fd;
+    int id = -1;
+
+    CHECK(fs_fake_reset() == 0);
+    fd = HalFileOpen("order", O_RDWR_FS | O_CREAT_FS, 0);
+    CHECK(fd > 0);
+    for (int i = 1; i <= 4; i++) {
+        id = HalFileWriteAsync(fd, "abcd", 4, Record, (void *)(intptr_t)i);
+        CHECK(id > 0);
+    }
+    CHECK(HalFileSyncAsync(fd, NULL, NULL) == id + 1);
+    CHECK(HalFileAsyncBarrier(WAIT_MS) == 0);
+    CHECK(g_lastDone == 4);
+    CHECK(HalFileClose(fd) == 0);
+
+    fd = HalFileOpen("order", O_RDONLY_FS, 0);
+    CHECK(HalFileRead(fd, buf, sizeof(buf)) == 16);
+    CHECK(HalFileClose(fd) == 0);
+}
+
+static int g_waitId;
+static int g_waitResult[WAITERS];
+static UINT64 g_waitUs[WAITERS];
+
+static void *Waiter(void *arg)
+{
+    int i = (int)(intptr_t)arg;
+    UINT64 start = HostTimeUs();
+
+    /* Half of the waiters wait on the earlier request. */
+    g_waitResult[i] = HalFileAsyncWait(g_waitId - (i & 1), WAIT_MS);
+    g_waitUs[i] = HostTimeUs() - start;
+    return NULL;
+}
+
+/* Several tasks asleep on the same or on different requests all wake up once those complete. */
+static void TestConcurrentWaiters(void)
+{
+    pthread_t th[WAITERS];
+    int fd;
+
+    CHECK(fs_fake_reset() == 0);
+    fd = HalFileOpen("wait", O_RDWR_FS | O_CREAT_FS, 0);
+    g_gateOpen = false;
+    CHECK(HalFileWriteAsync(fd, "1", 1, Gate, NULL) > 0);
+    g_waitId = HalFileWriteAsync(fd, "2", 1, NULL, NULL);
+    CHECK(g_waitId > 0);
+    for (int i = 0; i < WAITERS; i++) {
+        g_waitResult[i] = 1;
+        CHECK(pthread_create(&th[i], NULL, Waiter, (void *)(intptr_t)i) == 0);
+    }
+    usleep(SETTLE_US);
+    g_gateOpen = true;
+    for (int i = 0; i < WAITERS; i++) {
+        pthread_join(th[i], NULL);
+        CHECK(g_waitResult[i] == 0);
+        /* Woken by the completion, not by running into the timeout. */
+        CHECK(g_waitUs[i] < WAIT_MS * 1000 / 2);
+    }
+
+    /* A request that already completed needs no sleep at all. */
+    CHECK(HalFileAsyncWait(g_waitId, 0) == 0);
+    CHECK(HalFileClose(fd) == 0);
+}
+
+/* A timed-out wait reports it and unlinks itself: the completion that follows touches nothing stale. */
+static void TestTimeout(void)
+{
+    int fd;
+    int id;
+
+    CHECK(fs_fake_reset() == 0);
+    fd = HalFileOpen("timeout", O_RDWR_FS | O_CREAT_FS, 0);
+    g_gateOpen = false;
+    id = HalFileWriteAsync(fd, "1", 1, Gate, NULL);
+    CHECK(HalFileAsyncWait(id, 20) == -1);
+    CHECK(HalFileAsyncWait(id, 0) == -1);
+    g_gateOpen = true;
+    CHECK(HalFileAsyncWait(id, WAIT_MS) == 0);
+    CHECK(HalFileClose(fd) == 0);
+}
+
+static void TestQueueFull(void)
+{
+    HalFileAsyncStats before;
+    HalFileAsyncStats st;
+    int fd;
+    int id;
+
+    CHECK(fs_fake_reset() == 0);
+    fd = HalFileOpen("full", O_RDWR_FS | O_CREAT_FS, 0);
+    CHECK(HalFileAsyncStatsGet(&before) == 0);
+    g_gateOpen = false;
+    CHECK(HalFileWriteAsync(fd, "x", 1, Gate, NULL) > 0);
+    /* Let the worker take the gated request off the queue. */
+    usleep(SETTLE_US);
+    for (int i = 0; i < QUEUE_LEN; i++) {
+        CHECK(HalFileWriteAsync(fd, "x", 1, NULL, NULL) > 0);
+    }
+    CHECK(HalFileWriteAsync(fd, "x", 1, NULL, NULL) == -1);
+    CHECK(HalFileAsyncStatsGet(&st) == 0);
+    CHECK(st.depth == QUEUE_LEN + 1);
+    CHECK(st.maxDepth == QUEUE_LEN + 1);
+    CHECK(st.rejected == before.rejected + 1);
+    CHECK(st.submitted == before.submitted + QUEUE_LEN + 1);
+
+    g_gateOpen = true;
+    CHECK(HalFileAsyncBarrier(WAIT_MS) == 0);
+    CHECK(HalFileAsyncStatsGet(&st) == 0);
+    CHECK(st.depth == 0);
+    CHECK(st.completed == st.submitted);
+    id = HalFileSyncAsync(fd, NULL, NULL);
+    CHECK(HalFileAsyncWait(id, WAIT_MS) == 0);
+    CHECK(HalFileClose(fd) == 0);
+}
+
+static volatile bool g_closed;
+static int g_closeFd;
+static int g_closeResult;
+
+static void *Closer(void *arg)
+{
+    (void)arg;
+    g_closeResult = HalFileClose(g_closeFd);
+    g_closed = true;
+    return NULL;
+}
+
+static void CloseFromCallback(int fd, int result, void *arg)
+{
+    (void)result;
+    *(int *)arg = HalFileClose(fd);
+}
+
+static void TestCloseDrains(void)
+{
+    pthread_t th;
+    char buf[8];
+    int other;
+    int id;
+    int ret;
+
+    CHECK(fs_fake_reset() == 0);
+    g_closeFd = HalFileOpen("drain", O_RDWR_FS | O_CREAT_FS, 0);
+    g_gateOpen = false;
+    g_closed = false;
+    CHECK(HalFileWriteAsync(g_closeFd, "a", 1, Gate, NULL) > 0);
+    CHECK(HalFileWriteAsync(g_closeFd, "bc", 2, NULL, NULL) > 0);
+    CHECK(HalFileSyncAsync(g_closeFd, NULL, NULL) > 0);
+    CHECK(pthread_create(&th, NULL, Closer, NULL) == 0);
+    usleep(SETTLE_US);
+    /* The close waits, so the slot stays taken and a new open cannot inherit the queued writes. */
+    CHECK(!g_closed);
+    other = HalFileOpen("other", O_RDWR_FS | O_CREAT_FS, 0);
+    CHECK((other > 0) && (other != g_closeFd));
+    g_gateOpen = true;
+    pthread_join(th, NULL);
+    CHECK(g_closeResult == 0);
+    CHECK(HalFileRead(other, buf, sizeof(buf)) == 0);
+    CHECK(HalFileClose(other) == 0);
+
+    g_closeFd = HalFileOpen("drain", O_RDONLY_FS, 0);
+    CHECK(HalFileRead(g_closeFd, buf, sizeof(buf)) == 3);
+    CHECK(memcmp(buf, "abc", 3) == 0);
+    CHECK(HalFileClose(g_closeFd) == 0);
+
+    /* A callback cannot wait for the worker it runs on: the close fails while later writes are queued. */
+    g_closeFd = HalFileOpen("drain", O_RDWR_FS, 0);
+    g_gateOpen = false;
+    ret = 1;
+    CHECK(HalFileWriteAsync(g_closeFd, "d", 1, Gate, NULL) > 0);
+    CHECK(HalFileWriteAsync(g_closeFd, "e", 1, CloseFromCallback, &ret) > 0);
+    id = HalFileWriteAsync(g_closeFd, "f", 1, NULL, NULL);
+    g_gateOpen = true;
+    CHECK(HalFileAsyncWait(id, WAIT_MS) == 0);
+    CHECK(ret == -1);
+    /* The last one can close its fd. */
+    ret = 1;
+    id = HalFileWriteAsync(g_closeFd, "g", 1, CloseFromCallback, &ret);
+    CHECK(HalFileAsyncWait(id, WAIT_MS) == 0);
+    CHECK(ret == 0);
+    CHECK(HalFileClose(g_closeFd) == -1);
+}
+
+int main(void)
+{
+    CHECK(HalFileWriteAsync(1, "x", 1, NULL, NULL) == -1);
+    CHECK(HalFileAsyncInit() == 0);
+    TestInOrder();
+    TestConcurrentWaiters();
+    TestTimeout();
+    TestQueueFull();
+    TestCloseDrains();
+    fs_fake_cleanup();
+    return HostTestResult("hal_file_async");
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Read cache of the hal_flash extensions (libraries/hal_flash/hal_flash_ext.c): small reads are served
+ * from cached lines, writes and erases through hal_flash_ext_* and explicit invalidation keep them
+ * coherent, large reads bypass the cache, replacement is LRU within a set, and a line fetched while
+ * an invalidation ran is not kept.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "hal_flash_ext.h"
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x10000)
+#define LINE            HAL_FLASH_READ_CACHE_LINE
+#define SET_STRIDE      (HAL_FLASH_READ_CACHE_SETS * LINE)      /* lines sharing a set */
+
+static uint8_t *Image(uint32_t addr)
+{
+    return flash_sim_image() + (addr - FLASH_SIM_BASE_ADDR);
+}
+
+static uint32_t FlashReads(void)
+{
+    struct flash_sim_stats st;
+
+    flash_sim_get_stats(&st);
+    return st.read_ops;
+}
+
+static void TestCoherence(void)
+{
+    uint8_t buf[16];
+    uint8_t data[16];
+
+    CHECK(hal_flash_ext_erase(PART_ADDR, FLASH_SIM_SECTOR_SIZE));
+    CHECK(hal_flash_ext_read(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    uint32_t reads = FlashReads();
+    CHECK(hal_flash_ext_read(PART_ADDR + 32, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(FlashReads() == reads);
+
+    /* Written through the extensions: the next read sees it. */
+    memset(data, 0x11, sizeof(data));
+    CHECK(hal_flash_ext_write(PART_ADDR + 100, data, sizeof(data)) == sizeof(data));
+    CHECK(hal_flash_ext_read(PART_ADDR + 100, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(memcmp(buf, data, sizeof(buf)) == 0);
+
+    /* Changed behind its back: stale until invalidated. */
+    memset(Image(PART_ADDR + 100), 0x01, sizeof(data));
+    CHECK(hal_flash_ext_read(PART_ADDR + 100, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(buf[0] == 0x11);
+    hal_flash_ext_cache_invalidate(PART_ADDR + 100, 1);
+    CHECK(hal_flash_ext_read(PART_ADDR + 100, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(buf[0] == 0x01);
+
+    CHECK(hal_flash_ext_erase(PART_ADDR, FLASH_SIM_SECTOR_SIZE));
+    CHECK(hal_flash_ext_read(PART_ADDR + 100, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(buf[0] == 0xFF && buf[sizeof(buf) - 1] == 0xFF);
+}
+
+static void TestLineCrossingAndBypass(void)
+{
+    uint8_t data[FLASH_SIM_PAGE_SIZE * 2];
+    uint8_t buf[FLASH_SIM_PAGE_SIZE * 2];
+    hal_flash_stats_t before;
+    hal_flash_stats_t after;
+
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+    CHECK(hal_flash_ext_write(PART_ADDR, data, sizeof(data)) == sizeof(data));
+    hal_flash_stats_get(&before);
+    CHECK(hal_flash_ext_read(PART_ADDR + LINE - 8, buf, 16) == 16);
+    CHECK(memcmp(buf, &data[LINE - 8], 16) == 0);
+    hal_flash_stats_get(&after);
+    CHECK(after.cache_misses == before.cache_misses + 2);
+
+    CHECK(hal_flash_ext_read(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(memcmp(buf, data, sizeof(buf)) == 0);
+    hal_flash_stats_get(&before);
+    CHECK(before.cache_misses == after.cache_misses && before.cache_hits == after.cache_hits);
+}
+
+/* Fill one set, touch its oldest line again, then one more line evicts the second oldest. */
+static void TestLru(void)
+{
+    uint8_t buf[4];
+    uint32_t reads;
+
+    hal_flash_ext_cache_invalidate(0, 0);
+    for (uint32_t way = 0; way < HAL_FLASH_READ_CACHE_WAYS; way++) {
+        CHECK(hal_flash_ext_read(PART_ADDR + way * SET_STRIDE, buf, sizeof(buf)) == sizeof(buf));
+    }
+    CHECK(hal_flash_ext_read(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(hal_flash_ext_read(PART_ADDR + HAL_FLASH_READ_CACHE_WAYS * SET_STRIDE, buf, sizeof(buf)) == sizeof(buf));
+    reads = FlashReads();
+    CHECK(hal_flash_ext_read(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    for (uint32_t way = 2; way <= HAL_FLASH_READ_CACHE_WAYS; way++) {
+        CHECK(hal_flash_ext_read(PART_ADDR + way * SET_STRIDE, buf, sizeof(buf)) == sizeof(buf));
+    }
+    CHECK(FlashReads() == reads);
+    CHECK(hal_flash_ext_read(PART_ADDR + SET_STRIDE, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(FlashReads() == reads + 1);
+}
+
+/* Another context writes while the line is being fetched. */
+static void InvalidateOnRead(enum flash_sim_op op, uint32_t addr, uint32_t size)
+{
+    if (op == FLASH_SIM_OP_READ) {
+        hal_flash_ext_cache_invalidate(addr, size);
+    }
+}
+
+static void TestFillRace(void)
+{
+    uint8_t buf[4];
+
+    hal_flash_ext_cache_invalidate(0, 0);
+    flash_sim_set_trace(InvalidateOnRead);
+    CHECK(hal_flash_ext_read(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    flash_sim_set_trace(NULL);
+    uint32_t reads = FlashReads();
+    CHECK(hal_flash_ext_read(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(FlashReads() == reads + 1);
+}
+
+int main(void)
+{
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_ext_init();
+    TestCoherence();
+    TestLineCrossingAndBypass();
+    TestLru();
+    TestFillRace();
+    flash_sim_close();
+    return HostTestResult("hal_flash_cache");
+}
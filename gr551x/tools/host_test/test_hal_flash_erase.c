@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Erase decomposition of the hal_flash extensions (libraries/hal_flash/hal_flash_ext.c): an unaligned
+ * range is erased by sectors at its edges and the largest aligned blocks in between, covering exactly
+ * the sectors it touches; unknown parts and HAL_FLASH_ERASE_BLOCK_MAX at sector size only use sectors;
+ * and a block erase shows HAL_FLASH_EXT_BUSY and is suspended by a hold like a sector erase.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "hal_flash_ext.h"
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x10000)
+#define OTHER_ADDR      (FLASH_SIM_BASE_ADDR + 0x80000)
+#define SECTOR          FLASH_SIM_SECTOR_SIZE
+#define BLOCK32         0x8000
+#define BLOCK64         0x10000
+#define UNKNOWN_ID      0x00401512
+#define TRACE_MAX       64
+/* Default simulator timing: cmd_overhead_us, suspend_us and block64_erase_us. */
+#define POLL_US         5
+#define SUSPEND_US      20
+#define BLOCK64_US      250000
+#define HELD_US         2000
+#define WAIT_STEP_US    500
+
+#define SECTORS_ONLY    (HAL_FLASH_ERASE_BLOCK_MAX < BLOCK32)
+
+typedef struct {
+    uint32_t addr;
+    uint32_t size;
+} unit_t;
+
+static unit_t   g_trace[TRACE_MAX];
+static uint32_t g_units;
+
+static struct {
+    bool     raise;             /* poll hook raises a hold once the erase has run for a while */
+    bool     raised;
+    bool     busy_seen;
+    bool     suspended_seen;
+    bool     read_other_ok;
+    uint32_t held_us;
+} g_t;
+
+static void TraceHook(enum flash_sim_op op, uint32_t addr, uint32_t size)
+{
+    if (op == FLASH_SIM_OP_ERASE && g_units < TRACE_MAX) {
+        g_trace[g_units].addr = addr;
+        g_trace[g_units].size = size;
+        g_units++;
+    }
+}
+
+static void PollHook(uint64_t now_us)
+{
+    if (hal_flash_ext_state() == HAL_FLASH_EXT_BUSY) {
+        g_t.busy_seen = true;
+    }
+    if (g_t.raise && !g_t.raised && g_units == 1 && g_trace[0].size == BLOCK64) {
+        g_t.raised = true;
+        hal_flash_ext_suspend();
+    }
+}
+
+void hal_flash_ext_hold_wait(void)
+{
+    uint8_t buf[16];
+
+    if (hal_flash_ext_state() == HAL_FLASH_EXT_SUSPENDED && !g_t.suspended_seen) {
+        g_t.suspended_seen = true;
+        g_t.read_other_ok = (hal_flash_ext_read(OTHER_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    }
+    flash_sim_advance(WAIT_STEP_US);
+    g_t.held_us += WAIT_STEP_US;
+    if (g_t.held_us >= HELD_US) {
+        hal_flash_ext_resume();
+    }
+}
+
+static void Reset(void)
+{
+    memset(&g_t, 0, sizeof(g_t));
+    g_units = 0;
+    flash_sim_reset_stats();
+    flash_sim_set_trace(TraceHook);
+    flash_sim_set_poll(PollHook);
+}
+
+static bool TraceIs(const unit_t *p_expect, uint32_t count)
+{
+    if (g_units != count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (g_trace[i].addr != p_expect[i].addr || g_trace[i].size != p_expect[i].size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool Erased(uint32_t addr, uint32_t size)
+{
+    const uint8_t *p_img = flash_sim_image() + (addr - FLASH_SIM_BASE_ADDR);
+
+    for (uint32_t i = 0; i < size; i++) {
+        if (p_img[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void Dirty(uint32_t addr, uint32_t size)
+{
+    memset(flash_sim_image() + (addr - FLASH_SIM_BASE_ADDR), 0, size);
+}
+
+/* [0x11064, 0x39FF6) touches sectors 0x11000..0x39000: 7 sectors, 32 KB, 64 KB, 32 KB, 2 sectors. */
+static void TestDecomposition(bool blocks)
+{
+    uint32_t addr = PART_ADDR + SECTOR + 100;
+    uint32_t end  = PART_ADDR + 0x2A000 - 10;
+    unit_t expect[TRACE_MAX];
+    uint32_t count = 0;
+    uint32_t cur;
+    struct flash_sim_stats st;
+
+    for (cur = PART_ADDR + SECTOR; cur < PART_ADDR + 0x8000; cur += SECTOR) {
+        expect[count++] = (unit_t){ cur, SECTOR };
+    }
+    if (blocks) {
+        expect[count++] = (unit_t){ PART_ADDR + 0x8000, BLOCK32 };
+        expect[count++] = (unit_t){ PART_ADDR + 0x10000, BLOCK64 };
+        expect[count++] = (unit_t){ PART_ADDR + 0x20000, BLOCK32 };
+        cur = PART_ADDR + 0x28000;
+    }
+    for (; cur < PART_ADDR + 0x2A000; cur += SECTOR) {
+        expect[count++] = (unit_t){ cur, SECTOR };
+    }
+
+    Dirty(PART_ADDR, 0x2B000);
+    Reset();
+    CHECK(hal_flash_ext_erase(addr, end - addr));
+    CHECK(TraceIs(expect, count));
+    /* Exactly the sectors touched, nothing either side. */
+    CHECK(!Erased(PART_ADDR + SECTOR - 1, 1));
+    CHECK(Erased(PART_ADDR + SECTOR, 0x29000));
+    CHECK(!Erased(PART_ADDR + 0x2A000, 1));
+
+    flash_sim_get_stats(&st);
+    printf("%s: %u commands, %u us modelled\n", blocks ? "blocks" : "sectors", (unsigned)st.erase_cmds,
+           (unsigned)st.time_us);
+    CHECK(st.erase_cmds == count);
+    CHECK(hal_flash_ext_erase_time(addr, end - addr) == (blocks ? 9 * 50 + 2 * 160 + 250 : 41 * 50));
+}
+
+/* A hold in the middle of a 64 KB erase suspends it within one poll plus tSUS, not 250 ms later. */
+static void TestBlockSuspend(void)
+{
+    uint64_t start;
+
+    Dirty(PART_ADDR, BLOCK64);
+    Reset();
+    g_t.raise = true;
+    start = flash_sim_clock_us();
+    CHECK(hal_flash_ext_erase(PART_ADDR, BLOCK64));
+    CHECK(g_units == 1 && g_trace[0].size == BLOCK64);
+    CHECK(g_t.busy_seen);
+    CHECK(g_t.raised && g_t.suspended_seen);
+    CHECK(g_t.read_other_ok);
+    CHECK(g_t.held_us == HELD_US);
+    CHECK(hal_flash_ext_state() == HAL_FLASH_EXT_IDLE);
+    CHECK(Erased(PART_ADDR, BLOCK64));
+
+    struct flash_sim_stats st;
+    flash_sim_get_stats(&st);
+    CHECK(st.suspends == 1);
+    CHECK(flash_sim_clock_us() - start >= BLOCK64_US + HELD_US);
+}
+
+int main(void)
+{
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_ext_init();
+    CHECK(hal_flash_ext_erase_geometry()->count == 3);
+    TestDecomposition(!SECTORS_ONLY);
+    if (!SECTORS_ONLY) {
+        TestBlockSuspend();
+    }
+
+    /* Parts without a known block geometry only get sector erases. */
+    flash_sim_set_id(UNKNOWN_ID);
+    hal_flash_ext_init();
+    CHECK(hal_flash_ext_erase_geometry()->count == 1);
+    TestDecomposition(false);
+    flash_sim_set_id(0);
+
+    flash_sim_close();
+    return HostTestResult(SECTORS_ONLY ? "hal_flash_erase_sectors" : "hal_flash_erase");
+}
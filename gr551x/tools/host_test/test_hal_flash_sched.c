@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The flash job scheduler (libraries/hal_flash/hal_flash_sched.c) against a simulated BLE connection:
+ * events of EVENT_US every interval on the simulator's modelled clock, an event being missed when the
+ * flash is busy during it. With HAL_FLASH_SCHED_ERASE_SUSPEND the BLE core wakes up WAKE_AHEAD_US
+ * before each event and raises a hold until the event is over, as the platform flash port does, so
+ * erases go in any gap; test_hal_flash_sched_nosuspend builds it for parts without erase suspend,
+ * where an erase needs a gap as long as itself. Pieces only go out when the radio can take them, an
+ * overdue job is forced through, the default gap source derived from the baseband sleep state lets
+ * erases through once they can be suspended, a second init keeps the queue and the gap source, and
+ * the same jobs miss fewer events queued on the scheduler than issued directly.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "gr55xx_pwr.h"
+#include "hal_flash_sched.h"
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x10000)
+#define EVENT_US        2500
+#define WAKE_AHEAD_US   300         /* BLE core wake-up ahead of an event */
+#define IDLE_STEP_US    100         /* idle loop period between polls */
+#define ERASE_SECTORS   4
+#define WRITE_BYTES     (3 * 1024)
+#define CMP_INTERVAL_US 60000       /* the gaps hold a whole sector erase */
+#define CMP_WRITE_BYTES (8 * 1024)
+#define CMP_PHASES      8           /* start points spread over the interval */
+
+static uint32_t g_interval_us;
+static uint32_t g_done;
+static uint32_t g_missed;           /* connection events the flash was busy in */
+static int64_t  g_last_missed = -1; /* index of the last one counted */
+static bool     g_held;
+
+static uint32_t TimeMs(void)
+{
+    return (uint32_t)(flash_sim_clock_us() / 1000);
+}
+
+static uint32_t ConnGap(void)
+{
+    uint32_t pos = (uint32_t)(flash_sim_clock_us() % g_interval_us);
+
+    return (pos < EVENT_US) ? 0 : g_interval_us - pos;
+}
+
+static uint32_t NoEvents(void)
+{
+    return HAL_FLASH_SCHED_GAP_ANY;
+}
+
+/* The baseband sleeps when its next event is at least the sleep threshold away. */
+static void BasebandFollow(void)
+{
+    HostBasebandStateSet((ConnGap() >= HAL_FLASH_SCHED_SLEEP_GAP_US) ? PMR_MGMT_SLEEP_MODE : PMR_MGMT_ACTIVE_MODE);
+}
+
+/* The flash is busy over [start, end): count every event it overlaps, once. */
+static void FlashBusy(uint64_t start, uint64_t end)
+{
+    for (uint64_t k = start / g_interval_us; k * g_interval_us < end; k++) {
+        if ((k * g_interval_us + EVENT_US > start) && ((int64_t)k > g_last_missed)) {
+            g_missed++;
+            g_last_missed = (int64_t)k;
+        }
+    }
+}
+
+/* The BLE wake-up interrupt: raise a hold if an event is under way or due within WAKE_AHEAD_US. */
+static void RadioWakeup(uint64_t from, uint64_t to)
+{
+#if (HAL_FLASH_SCHED_ERASE_SUSPEND == 1)
+    uint64_t event = (from / g_interval_us) * g_interval_us;
+
+    if (g_held) {
+        return;
+    }
+    if (from - event >= EVENT_US) {
+        event += g_interval_us;
+    }
+    if (event < to + WAKE_AHEAD_US) {
+        g_held = true;
+        hal_flash_ext_suspend();
+    }
+#else
+    (void)from;
+    (void)to;
+#endif
+}
+
+static void PollHook(uint64_t now_us)
+{
+    struct flash_sim_timing t;
+
+    flash_sim_get_timing(&t);
+    FlashBusy(now_us - t.cmd_overhead_us, now_us);
+    RadioWakeup(now_us, now_us);
+    if (g_held) {
+        /* The erase goes on until the suspend takes effect. */
+        FlashBusy(now_us, now_us + t.cmd_overhead_us + t.suspend_us);
+    }
+}
+
+/* Called as a page program starts: a hold raised during it only stops the next one. */
+static void TraceHook(enum flash_sim_op op, uint32_t addr, uint32_t size)
+{
+    struct flash_sim_timing t;
+    uint64_t now = flash_sim_clock_us();
+
+    if (op != FLASH_SIM_OP_WRITE) {
+        return;
+    }
+    flash_sim_get_timing(&t);
+    FlashBusy(now, now + t.cmd_overhead_us + t.page_program_us);
+    RadioWakeup(now, now + t.cmd_overhead_us + t.page_program_us);
+}
+
+/* The task side: the hold goes when the event is over. */
+void hal_flash_ext_hold_wait(void)
+{
+    uint64_t now = flash_sim_clock_us();
+    uint64_t event = (now / g_interval_us) * g_interval_us;
+
+    if (now - event >= EVENT_US) {
+        event += g_interval_us;
+    }
+    flash_sim_advance((uint32_t)(event + EVENT_US - now));
+    g_held = false;
+    hal_flash_ext_resume();
+}
+
+/* A hold raised by the last page of a run is released when its event ends, with the flash idle. */
+static void RadioIdle(void)
+{
+    if (g_held) {
+        hal_flash_ext_hold_wait();
+    }
+}
+
+static void JobDone(hal_flash_job_type_t type, uint32_t addr, bool ok, void *p_arg)
+{
+    CHECK(ok);
+    g_done++;
+}
+
+/* Run the idle loop until the queue drains. Returns the number of events missed meanwhile. */
+static uint32_t RunIdleLoop(bool baseband)
+{
+    uint32_t missed = g_missed;
+    bool more = true;
+
+    while (more) {
+        if (baseband) {
+            BasebandFollow();
+        }
+        more = hal_flash_sched_poll();
+        flash_sim_advance(IDLE_STEP_US);
+    }
+    RadioIdle();
+    return g_missed - missed;
+}
+
+static void Queue(uint32_t deadline_ms)
+{
+    static uint8_t buf[WRITE_BYTES];
+
+    memset(buf, 0x3C, sizeof(buf));
+    g_done = 0;
+    CHECK(hal_flash_sched_erase(PART_ADDR, ERASE_SECTORS * FLASH_SIM_SECTOR_SIZE, deadline_ms, JobDone, NULL));
+    CHECK(hal_flash_sched_write(PART_ADDR, buf, sizeof(buf), deadline_ms, JobDone, NULL));
+}
+
+/*
+ * Without a gap source only the baseband sleep state is known, worth HAL_FLASH_SCHED_SLEEP_GAP_US:
+ * enough for a page program and for the suspend of an erase, not for a whole erase.
+ */
+static void TestBasebandDefault(void)
+{
+    hal_flash_sched_stats_t before;
+    hal_flash_sched_stats_t st;
+    uint32_t missed;
+
+    g_interval_us = 100000;
+    CHECK(hal_flash_sched_init(TimeMs, NULL));
+    HostBasebandStateSet(PMR_MGMT_SLEEP_MODE);
+    CHECK(hal_flash_sched_gap_fits(HAL_FLASH_JOB_WRITE, FLASH_SIM_PAGE_SIZE));
+    CHECK(hal_flash_sched_gap_fits(HAL_FLASH_JOB_ERASE, FLASH_SIM_SECTOR_SIZE) == HAL_FLASH_SCHED_ERASE_SUSPEND);
+    HostBasebandStateSet(PMR_MGMT_ACTIVE_MODE);
+    CHECK(!hal_flash_sched_gap_fits(HAL_FLASH_JOB_WRITE, FLASH_SIM_PAGE_SIZE));
+    CHECK(!hal_flash_sched_gap_fits(HAL_FLASH_JOB_ERASE, FLASH_SIM_SECTOR_SIZE));
+
+    hal_flash_sched_stats_get(&before);
+    Queue(500);
+    missed = RunIdleLoop(true);
+    CHECK(g_done == 2);
+    hal_flash_sched_stats_get(&st);
+#if (HAL_FLASH_SCHED_ERASE_SUSPEND == 1)
+    CHECK(missed == 0);
+    CHECK(st.pieces_forced == before.pieces_forced);
+    CHECK(st.pieces_in_gap - before.pieces_in_gap == ERASE_SECTORS + WRITE_BYTES / FLASH_SIM_PAGE_SIZE);
+#else
+    CHECK(missed <= ERASE_SECTORS);
+    CHECK(st.pieces_forced - before.pieces_forced == ERASE_SECTORS);
+    CHECK(st.pieces_in_gap - before.pieces_in_gap == WRITE_BYTES / FLASH_SIM_PAGE_SIZE);
+#endif
+}
+
+/* A 100 ms interval leaves room for a whole sector erase between events. */
+static void TestLongInterval(void)
+{
+    hal_flash_sched_stats_t before;
+    hal_flash_sched_stats_t st;
+    uint8_t rd[16];
+
+    g_interval_us = 100000;
+    /* The application's gap source replaces the baseband default. */
+    CHECK(hal_flash_sched_init(TimeMs, ConnGap));
+    hal_flash_sched_stats_get(&before);
+    Queue(10000);
+    CHECK(RunIdleLoop(false) == 0);
+    CHECK(g_done == 2);
+    hal_flash_sched_stats_get(&st);
+    CHECK(st.pieces_in_gap - before.pieces_in_gap == ERASE_SECTORS + WRITE_BYTES / FLASH_SIM_PAGE_SIZE);
+    CHECK(st.pieces_forced == before.pieces_forced);
+    CHECK(st.failed == 0);
+    CHECK(hal_flash_read(PART_ADDR + WRITE_BYTES - sizeof(rd), rd, sizeof(rd)) == sizeof(rd));
+    CHECK(rd[0] == 0x3C && rd[sizeof(rd) - 1] == 0x3C);
+}
+
+/*
+ * A 30 ms interval never holds a whole sector erase: without erase suspend, erases wait for the
+ * deadline; with it they go in the gaps and are suspended for each event. Pages fit either way.
+ */
+static void TestShortInterval(void)
+{
+    hal_flash_sched_stats_t before;
+    hal_flash_sched_stats_t st;
+    uint32_t missed;
+
+    g_interval_us = 30000;
+    CHECK(hal_flash_sched_init(TimeMs, ConnGap));
+    hal_flash_sched_stats_get(&before);
+    Queue(400);
+    missed = RunIdleLoop(false);
+    CHECK(g_done == 2);
+    hal_flash_sched_stats_get(&st);
+#if (HAL_FLASH_SCHED_ERASE_SUSPEND == 1)
+    CHECK(missed == 0);
+    CHECK(st.pieces_forced == before.pieces_forced);
+    CHECK(st.pieces_in_gap - before.pieces_in_gap == ERASE_SECTORS + WRITE_BYTES / FLASH_SIM_PAGE_SIZE);
+#else
+    CHECK(!hal_flash_sched_gap_fits(HAL_FLASH_JOB_ERASE, FLASH_SIM_SECTOR_SIZE));
+    CHECK(missed > 0);
+    CHECK(st.pieces_forced - before.pieces_forced == ERASE_SECTORS);
+    CHECK(st.pieces_in_gap - before.pieces_in_gap == WRITE_BYTES / FLASH_SIM_PAGE_SIZE);
+    CHECK(st.max_wait_ms >= 400);
+#endif
+}
+
+/* The file system initializes the scheduler again after the application: its queue and gap source stay. */
+static void TestInitKeeps(void)
+{
+    hal_flash_sched_stats_t before;
+    hal_flash_sched_stats_t st;
+
+    g_interval_us = 100000;
+    hal_flash_sched_stats_get(&before);
+    Queue(10000);
+    CHECK(hal_flash_sched_init(TimeMs, NULL));
+    CHECK(hal_flash_sched_init(TimeMs, NoEvents));
+
+    /* In an event with the baseband asleep: ConnGap says no, the default and NoEvents would say yes. */
+    flash_sim_advance(g_interval_us - (uint32_t)(flash_sim_clock_us() % g_interval_us));
+    HostBasebandStateSet(PMR_MGMT_SLEEP_MODE);
+    CHECK(!hal_flash_sched_gap_fits(HAL_FLASH_JOB_WRITE, FLASH_SIM_PAGE_SIZE));
+    HostBasebandStateSet(PMR_MGMT_ACTIVE_MODE);
+
+    CHECK(RunIdleLoop(false) == 0);
+    CHECK(g_done == 2);
+    hal_flash_sched_stats_get(&st);
+    CHECK(st.jobs - before.jobs == 2);
+    CHECK(st.pieces_in_gap - before.pieces_in_gap == ERASE_SECTORS + WRITE_BYTES / FLASH_SIM_PAGE_SIZE);
+}
+
+/*
+ * The same erase and write issued directly from several points of the interval, and queued on the
+ * scheduler from the same points: events missed without and with it.
+ */
+static void TestCompareDirect(void)
+{
+    static uint8_t buf[CMP_WRITE_BYTES];
+    uint32_t direct = 0;
+    uint32_t sched = 0;
+    uint32_t missed;
+
+    memset(buf, 0x5A, sizeof(buf));
+    g_interval_us = CMP_INTERVAL_US;
+    for (uint32_t i = 0; i < CMP_PHASES; i++) {
+        uint32_t phase = i * g_interval_us / CMP_PHASES;
+
+        flash_sim_advance(g_interval_us - (uint32_t)(flash_sim_clock_us() % g_interval_us) + phase);
+        missed = g_missed;
+        CHECK(hal_flash_ext_erase(PART_ADDR, ERASE_SECTORS * FLASH_SIM_SECTOR_SIZE));
+        CHECK(hal_flash_ext_write(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+        RadioIdle();
+        direct += g_missed - missed;
+
+        flash_sim_advance(g_interval_us - (uint32_t)(flash_sim_clock_us() % g_interval_us) + phase);
+        g_done = 0;
+        CHECK(hal_flash_sched_erase(PART_ADDR, ERASE_SECTORS * FLASH_SIM_SECTOR_SIZE, 1000, JobDone, NULL));
+        CHECK(hal_flash_sched_write(PART_ADDR, buf, sizeof(buf), 1000, JobDone, NULL));
+        sched += RunIdleLoop(false);
+        CHECK(g_done == 2);
+    }
+    printf("missed connection events: %u direct, %u scheduled\n", (unsigned)direct, (unsigned)sched);
+    CHECK(sched < direct);
+#if (HAL_FLASH_SCHED_ERASE_SUSPEND == 1)
+    CHECK(sched == 0);
+#endif
+}
+
+int main(void)
+{
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_ext_init();
+    flash_sim_set_poll(PollHook);
+    flash_sim_set_trace(TraceHook);
+    /* Not initialized: direct callers are never held back. */
+    CHECK(hal_flash_sched_gap_fits(HAL_FLASH_JOB_ERASE, FLASH_SIM_SECTOR_SIZE));
+    TestBasebandDefault();
+    TestLongInterval();
+    TestShortInterval();
+    TestInitKeeps();
+    TestCompareDirect();
+    flash_sim_close();
+    return HostTestResult("hal_flash_sched");
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Flash statistics of the hal_flash extensions (libraries/hal_flash/hal_flash_ext.c): what each
+ * wrapped call accounts, latencies measured on the simulator's modelled clock, and the block kept
+ * across re-initialization as after a warm reset.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "hal_flash_ext.h"
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x10000)
+/*
+ * cmd_overhead_us + page_program_us, cmd_overhead_us + sector_erase_us, and a 16 byte read that misses
+ * the read cache: cmd_overhead_us + HAL_FLASH_READ_CACHE_LINE * read_ns_per_byte.
+ */
+#define PROG_US         705
+#define READ16_US       (5 + HAL_FLASH_READ_CACHE_LINE / 8)
+#define ERASE_US        45005
+
+static uint32_t HistBin(uint32_t us)
+{
+    uint32_t bin = 0;
+
+    while ((bin < HAL_FLASH_STATS_HIST_BINS - 1) && ((us >> (bin + 1)) != 0)) {
+        bin++;
+    }
+    return bin;
+}
+
+static void TestAccounting(void)
+{
+    hal_flash_stats_t st;
+    uint8_t buf[FLASH_SIM_PAGE_SIZE];
+
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    /* First boot: the block holds no valid statistics yet. */
+    hal_flash_ext_init();
+    hal_flash_stats_get(&st);
+    CHECK(st.boots == 1);
+    CHECK(st.op[HAL_FLASH_OP_WRITE].count == 0);
+
+    memset(buf, 0x5A, sizeof(buf));
+    CHECK(hal_flash_ext_erase(PART_ADDR, FLASH_SIM_SECTOR_SIZE));
+    CHECK(hal_flash_ext_write(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(hal_flash_ext_write(PART_ADDR + sizeof(buf), buf, sizeof(buf)) == sizeof(buf));
+    CHECK(hal_flash_ext_read(PART_ADDR, buf, 16) == 16);
+    CHECK(hal_flash_ext_write_r(PART_ADDR + 2 * sizeof(buf), buf, 16) == 16);
+    /* Out of range: counted as a failed call that moved no bytes. */
+    CHECK(hal_flash_ext_read(FLASH_SIM_BASE_ADDR + 0x100000, buf, 16) == 0);
+
+    hal_flash_stats_get(&st);
+    CHECK(st.op[HAL_FLASH_OP_ERASE].count == 1);
+    CHECK(st.op[HAL_FLASH_OP_ERASE].bytes == FLASH_SIM_SECTOR_SIZE);
+    CHECK(st.op[HAL_FLASH_OP_ERASE].max_us == ERASE_US);
+    CHECK(st.op[HAL_FLASH_OP_ERASE].hist[HistBin(ERASE_US)] == 1);
+
+    CHECK(st.op[HAL_FLASH_OP_WRITE].count == 2);
+    CHECK(st.op[HAL_FLASH_OP_WRITE].errors == 0);
+    CHECK(st.op[HAL_FLASH_OP_WRITE].bytes == 2 * sizeof(buf));
+    CHECK(st.op[HAL_FLASH_OP_WRITE].min_us == PROG_US && st.op[HAL_FLASH_OP_WRITE].max_us == PROG_US);
+    CHECK(st.op[HAL_FLASH_OP_WRITE].total_us == 2 * PROG_US);
+    CHECK(st.op[HAL_FLASH_OP_WRITE].hist[HistBin(PROG_US)] == 2);
+
+    CHECK(st.op[HAL_FLASH_OP_WRITE_R].count == 1);
+    CHECK(st.op[HAL_FLASH_OP_WRITE_R].bytes == 16);
+
+    CHECK(st.op[HAL_FLASH_OP_READ].count == 2);
+    CHECK(st.op[HAL_FLASH_OP_READ].errors == 1);
+    CHECK(st.op[HAL_FLASH_OP_READ].bytes == 16);
+    CHECK(st.op[HAL_FLASH_OP_READ].max_us == READ16_US);
+    CHECK(st.op[HAL_FLASH_OP_READ].min_us == 0);
+    CHECK(st.cache_misses == 2 && st.cache_hits == 0);
+
+    /* The line is cached now: no flash access, no time. */
+    CHECK(hal_flash_ext_read(PART_ADDR + 16, buf, 16) == 16);
+    hal_flash_stats_get(&st);
+    CHECK(st.cache_hits == 1);
+    CHECK(st.op[HAL_FLASH_OP_READ].min_us == 0 && st.op[HAL_FLASH_OP_READ].hist[0] == 2);
+    flash_sim_close();
+}
+
+/* A warm reset runs hal_flash_ext_init again on RAM the startup code did not clear. */
+static void TestKeptAcrossBoots(void)
+{
+    hal_flash_stats_t before;
+    hal_flash_stats_t after;
+
+    hal_flash_stats_get(&before);
+    hal_flash_ext_init();
+    hal_flash_ext_init();
+    hal_flash_stats_get(&after);
+    CHECK(after.boots == before.boots + 2);
+    CHECK(memcmp(after.op, before.op, sizeof(after.op)) == 0);
+
+    hal_flash_stats_reset();
+    hal_flash_stats_get(&after);
+    CHECK(after.boots == 1);
+    CHECK(after.op[HAL_FLASH_OP_WRITE].count == 0 && after.op[HAL_FLASH_OP_ERASE].bytes == 0);
+}
+
+int main(void)
+{
+    TestAccounting();
+    TestKeptAcrossBoots();
+    return HostTestResult("hal_flash_stats");
+}
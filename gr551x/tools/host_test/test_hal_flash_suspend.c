@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Erase suspend of the hal_flash extensions (libraries/hal_flash/hal_flash_ext.c): a hold raised from
+ * an "interrupt" (the simulator's status poll hook) suspends the erase within one poll plus tSUS, the
+ * rest of the flash reads while suspended, nested holds keep it suspended, the statistics count the
+ * suspend and its latencies, and programs and erases do not start while a hold is raised.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "hal_flash_ext.h"
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x10000)
+#define OTHER_ADDR      (FLASH_SIM_BASE_ADDR + 0x20000)
+/* Default simulator timing: cmd_overhead_us, suspend_us and sector_erase_us. */
+#define POLL_US         5
+#define SUSPEND_US      20
+#define ERASE_US        45000
+#define HELD_US         2000
+#define WAIT_STEP_US    500
+
+static struct {
+    uint64_t raise_at_us;       /* poll hook raises a hold from then on, 0 never */
+    uint64_t raised_us;
+    uint64_t suspended_us;      /* first hold_wait seen in HAL_FLASH_EXT_SUSPENDED */
+    uint32_t held_us;
+    uint64_t read_us;           /* spent reading while suspended */
+    uint32_t waits;
+    uint32_t pages_at_wait;
+    uint32_t erases_at_wait;
+    uint32_t pages;
+    bool     raise_on_page;     /* trace hook raises a hold after the first page program */
+    bool     nested;
+    bool     read_other_ok;
+    bool     read_busy_failed;
+} g_t;
+
+static void PollHook(uint64_t now_us)
+{
+    if (g_t.raise_at_us != 0 && now_us >= g_t.raise_at_us && g_t.raised_us == 0) {
+        g_t.raised_us = now_us;
+        hal_flash_ext_suspend();
+    }
+}
+
+static void TraceHook(enum flash_sim_op op, uint32_t addr, uint32_t size)
+{
+    if (op == FLASH_SIM_OP_WRITE) {
+        g_t.pages++;
+        if (g_t.raise_on_page && g_t.pages == 1) {
+            hal_flash_ext_suspend();
+        }
+    }
+}
+
+/* The task side: runs while the writer or eraser waits for the holds to go. */
+void hal_flash_ext_hold_wait(void)
+{
+    struct flash_sim_stats st;
+    uint8_t buf[16];
+
+    flash_sim_get_stats(&st);
+    if (g_t.waits++ == 0) {
+        g_t.pages_at_wait = g_t.pages;
+        g_t.erases_at_wait = st.erase_cmds;
+        if (hal_flash_ext_state() == HAL_FLASH_EXT_SUSPENDED) {
+            g_t.suspended_us = flash_sim_clock_us();
+            g_t.read_other_ok = (hal_flash_ext_read(OTHER_ADDR, buf, sizeof(buf)) == sizeof(buf));
+            g_t.read_busy_failed = (hal_flash_ext_read(PART_ADDR, buf, sizeof(buf)) == 0);
+            g_t.read_us = flash_sim_clock_us() - g_t.suspended_us;
+            /* A second holder comes and goes: the first one still holds the erase. */
+            hal_flash_ext_suspend();
+            hal_flash_ext_resume();
+            g_t.nested = (hal_flash_ext_state() == HAL_FLASH_EXT_SUSPENDED);
+        }
+    }
+    flash_sim_advance(WAIT_STEP_US);
+    g_t.held_us += WAIT_STEP_US;
+    if (g_t.held_us >= HELD_US) {
+        hal_flash_ext_resume();
+    }
+}
+
+static void Reset(void)
+{
+    memset(&g_t, 0, sizeof(g_t));
+    flash_sim_reset_stats();
+    flash_sim_set_poll(PollHook);
+    flash_sim_set_trace(TraceHook);
+}
+
+static void TestEraseSuspend(void)
+{
+    hal_flash_stats_t before;
+    hal_flash_stats_t st;
+    struct flash_sim_stats sim;
+    uint8_t buf[16];
+    uint64_t start;
+
+    Reset();
+    hal_flash_stats_get(&before);
+    CHECK(hal_flash_ext_state() == HAL_FLASH_EXT_IDLE);
+    /* A release without a hold is ignored. */
+    hal_flash_ext_resume();
+
+    memset(buf, 0, sizeof(buf));
+    CHECK(hal_flash_ext_write(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    start = flash_sim_clock_us();
+    g_t.raise_at_us = start + ERASE_US / 2;
+    CHECK(hal_flash_ext_erase(PART_ADDR, FLASH_SIM_SECTOR_SIZE));
+    CHECK(hal_flash_ext_state() == HAL_FLASH_EXT_IDLE);
+
+    CHECK(g_t.raised_us != 0 && g_t.suspended_us != 0);
+    printf("suspend latency %u us\n", (unsigned)(g_t.suspended_us - g_t.raised_us));
+    CHECK(g_t.suspended_us - g_t.raised_us <= POLL_US + SUSPEND_US);
+    CHECK(g_t.read_other_ok);
+    CHECK(g_t.read_busy_failed);
+    CHECK(g_t.nested);
+    CHECK(g_t.held_us == HELD_US);
+
+    hal_flash_stats_get(&st);
+    flash_sim_get_stats(&sim);
+    CHECK(st.suspends == before.suspends + 1);
+    CHECK(sim.suspends == 1);
+    CHECK(st.suspend_max_us == g_t.suspended_us - g_t.raised_us);
+    /* The hold goes in hal_flash_ext_hold_wait, and the erase resumes as soon as that returns. */
+    CHECK(st.resume_max_us <= POLL_US);
+    CHECK(st.resume_total_us - before.resume_total_us <= POLL_US);
+
+    /* The erase still took its full time on top of the suspension. */
+    uint64_t took = flash_sim_clock_us() - start - g_t.read_us;
+    CHECK(took >= ERASE_US + HELD_US && took <= ERASE_US + HELD_US + 2 * POLL_US + SUSPEND_US + POLL_US);
+    CHECK(hal_flash_ext_read(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(buf[0] == 0xFF && buf[sizeof(buf) - 1] == 0xFF);
+}
+
+static void TestEraseHeldOff(void)
+{
+    Reset();
+    hal_flash_ext_suspend();
+    CHECK(hal_flash_ext_erase(PART_ADDR, FLASH_SIM_SECTOR_SIZE));
+    CHECK(g_t.waits == HELD_US / WAIT_STEP_US);
+    CHECK(g_t.erases_at_wait == 0);
+    CHECK(g_t.suspended_us == 0);
+}
+
+/* Programs run to the end of the page and the next one waits for the hold. */
+static void TestProgramHeldOff(void)
+{
+    uint8_t buf[3 * FLASH_SIM_PAGE_SIZE];
+
+    Reset();
+    memset(buf, 0x5A, sizeof(buf));
+    g_t.raise_on_page = true;
+    CHECK(hal_flash_ext_write(PART_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(g_t.pages == 3);
+    CHECK(g_t.waits == HELD_US / WAIT_STEP_US);
+    CHECK(g_t.pages_at_wait == 1);
+    CHECK(hal_flash_ext_state() == HAL_FLASH_EXT_IDLE);
+}
+
+int main(void)
+{
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_ext_init();
+    TestEraseSuspend();
+    TestEraseHeldOff();
+    TestProgramHeldOff();
+    flash_sim_close();
+    return HostTestResult("hal_flash_suspend");
+}
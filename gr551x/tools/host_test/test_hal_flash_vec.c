@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Vectored access and CRC32 of the hal_flash extensions (libraries/hal_flash/hal_flash_ext.c): small
+ * segments are packed into one program per page, whole pages go straight from the segment, a failed
+ * program stops the write at the bytes that made it, and the CRC32 matches the IEEE check value.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "hal_flash_ext.h"
+
+#define PART_ADDR           (FLASH_SIM_BASE_ADDR + 0x10000)
+#define CRC32_CHECK_VALUE   0xCBF43926UL    /* CRC32 of "123456789" */
+
+static uint32_t ProgramPages(void)
+{
+    struct flash_sim_stats st;
+
+    flash_sim_get_stats(&st);
+    return st.program_pages;
+}
+
+static void Fill(uint8_t *buf, uint32_t size, uint8_t seed)
+{
+    for (uint32_t i = 0; i < size; i++) {
+        buf[i] = (uint8_t)(seed + i);
+    }
+}
+
+/* A 40 byte header and a 600 byte payload from page offset 100: 3 pages, 3 programs. */
+static void TestPacking(void)
+{
+    uint8_t hdr[40];
+    uint8_t payload[600];
+    uint8_t rd[sizeof(hdr) + sizeof(payload)];
+    hal_flash_iovec_t iov[] = { { hdr, sizeof(hdr) }, { NULL, 0 }, { payload, sizeof(payload) } };
+    hal_flash_iovec_t rd_iov[] = { { rd, sizeof(hdr) }, { rd + sizeof(hdr), sizeof(payload) } };
+    uint32_t addr = PART_ADDR + 100;
+
+    Fill(hdr, sizeof(hdr), 1);
+    Fill(payload, sizeof(payload), 50);
+    CHECK(hal_flash_ext_erase(PART_ADDR, FLASH_SIM_SECTOR_SIZE));
+    flash_sim_reset_stats();
+    CHECK(hal_flash_ext_writev(addr, iov, 3) == sizeof(rd));
+    CHECK(ProgramPages() == 3);
+
+    CHECK(hal_flash_ext_readv(addr, rd_iov, 2) == sizeof(rd));
+    CHECK(memcmp(rd, hdr, sizeof(hdr)) == 0);
+    CHECK(memcmp(rd + sizeof(hdr), payload, sizeof(payload)) == 0);
+    CHECK(hal_flash_ext_writev(addr, NULL, 1) == 0);
+}
+
+static void TestFailedProgram(void)
+{
+    uint8_t data[3 * FLASH_SIM_PAGE_SIZE];
+    hal_flash_iovec_t iov[] = { { data, 10 }, { data + 10, sizeof(data) - 10 } };
+    hal_flash_stats_t st;
+
+    Fill(data, sizeof(data), 7);
+    CHECK(hal_flash_ext_erase(PART_ADDR, FLASH_SIM_SECTOR_SIZE));
+    hal_flash_stats_reset();
+    /* Power goes in the second page: the first one is complete and is all that is reported. */
+    flash_sim_set_power_loss(FLASH_SIM_PAGE_SIZE + 10);
+    CHECK(hal_flash_ext_writev(PART_ADDR, iov, 2) == FLASH_SIM_PAGE_SIZE);
+    flash_sim_power_on();
+    CHECK(memcmp(flash_sim_image() + (PART_ADDR - FLASH_SIM_BASE_ADDR), data, FLASH_SIM_PAGE_SIZE) == 0);
+    hal_flash_stats_get(&st);
+    CHECK(st.op[HAL_FLASH_OP_WRITE].count == 1 && st.op[HAL_FLASH_OP_WRITE].errors == 1);
+}
+
+static void TestCrc32(void)
+{
+    CHECK(hal_flash_ext_crc32(PART_ADDR, 0) == 0);
+    CHECK(hal_flash_ext_erase(PART_ADDR, FLASH_SIM_SECTOR_SIZE));
+    CHECK(hal_flash_ext_write(PART_ADDR + 0x200, (const uint8_t *)"123456789", 9) == 9);
+    CHECK(hal_flash_ext_crc32(PART_ADDR + 0x200, 9) == CRC32_CHECK_VALUE);
+    CHECK(hal_flash_ext_crc32(FLASH_SIM_BASE_ADDR + 0x100000, 16) == 0);
+}
+
+int main(void)
+{
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_ext_init();
+    TestPacking();
+    TestFailedProgram();
+    TestCrc32();
+    flash_sim_close();
+    return HostTestResult("hal_flash_vec");
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Verified writes of the hal_flash extensions (hal_flash_ext_write_r in libraries/hal_flash/hal_flash_ext.c)
+ * in the HAL_FLASH_VERIFY_MODE it is built with: a good write passes without reading the range back
+ * over QSPI in the digest modes, a bad one fails in every mode, and with SHA256 the HMAC interrupt enable
+ * is restored on every path, an engine enabled by another driver is left alone, and every case a
+ * digest cannot be taken in falls back to reading back.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "hal_flash_ext.h"
+
+#define PART_ADDR       (FLASH_SIM_BASE_ADDR + 0x10000)
+#define DATA_SIZE       FLASH_SIM_SECTOR_SIZE
+#define READBACK_OPS    (DATA_SIZE / FLASH_SIM_PAGE_SIZE)
+
+static uint32_t g_data32[DATA_SIZE / sizeof(uint32_t) + 1];
+static uint8_t *g_data = (uint8_t *)g_data32;
+
+static uint32_t g_reads;
+static struct hmac_fake_stats g_hmac;
+
+/* Erase, write the pattern verified, and note the QSPI reads and digests it took. */
+static uint32_t WriteR(const uint8_t *buf)
+{
+    struct flash_sim_stats st;
+    uint32_t ret;
+
+    CHECK(hal_flash_ext_erase(PART_ADDR, DATA_SIZE));
+    flash_sim_reset_stats();
+    hmac_fake_get_stats(&g_hmac);
+    uint32_t digests = g_hmac.digests;
+    ret = hal_flash_ext_write_r(PART_ADDR, buf, DATA_SIZE);
+    flash_sim_get_stats(&st);
+    g_reads = st.read_ops;
+    hmac_fake_get_stats(&g_hmac);
+    g_hmac.digests -= digests;
+    return ret;
+}
+
+static void TestGoodWrite(void)
+{
+    hal_flash_stats_t st;
+
+    hal_flash_stats_reset();
+    CHECK(WriteR(g_data) == DATA_SIZE);
+    CHECK(memcmp(flash_sim_image() + (PART_ADDR - FLASH_SIM_BASE_ADDR), g_data, DATA_SIZE) == 0);
+    printf("good write: %u QSPI reads, %u digests\n", (unsigned)g_reads, (unsigned)g_hmac.digests);
+    if (HAL_FLASH_VERIFY_MODE == HAL_FLASH_VERIFY_SHA256) {
+        CHECK(g_reads == 0 && g_hmac.digests == 2);
+    } else {
+        CHECK(g_reads == READBACK_OPS && g_hmac.digests == 0);
+    }
+    hal_flash_stats_get(&st);
+    CHECK(st.op[HAL_FLASH_OP_WRITE_R].count == 1 && st.op[HAL_FLASH_OP_WRITE_R].errors == 0);
+    CHECK(hal_flash_ext_write_r(PART_ADDR, g_data, 0) == 0);
+}
+
+/* Zero bits left in the range cannot be programmed back to one: the flash differs from the data. */
+static void TestBadWrite(void)
+{
+    hal_flash_stats_t st;
+    struct flash_sim_stats sim;
+
+    CHECK(hal_flash_ext_erase(PART_ADDR, DATA_SIZE));
+    memset(flash_sim_image() + (PART_ADDR - FLASH_SIM_BASE_ADDR) + DATA_SIZE - 8, 0, 8);
+    hal_flash_stats_reset();
+    flash_sim_reset_stats();
+    CHECK(hal_flash_ext_write_r(PART_ADDR, g_data, DATA_SIZE) == 0);
+    flash_sim_get_stats(&sim);
+    CHECK(sim.nor_violations != 0);
+    hal_flash_stats_get(&st);
+    CHECK(st.op[HAL_FLASH_OP_WRITE_R].errors == 1);
+}
+
+static void CheckReadBack(const char *what)
+{
+    printf("%s: %u QSPI reads, %u digests\n", what, (unsigned)g_reads, (unsigned)g_hmac.digests);
+    CHECK(g_reads == READBACK_OPS);
+}
+
+static void TestIrqRestored(void)
+{
+    hmac_fake_reset();
+    NVIC_EnableIRQ(HMAC_IRQn);
+    CHECK(WriteR(g_data) == DATA_SIZE);
+    CHECK(NVIC_GetEnableIRQ(HMAC_IRQn));
+    CHECK(!NVIC_GetPendingIRQ(HMAC_IRQn));
+    /* Our completions never reached the application's vector. */
+    CHECK(g_hmac.stray_irqs == 0);
+
+    NVIC_DisableIRQ(HMAC_IRQn);
+    CHECK(WriteR(g_data) == DATA_SIZE);
+    CHECK(!NVIC_GetEnableIRQ(HMAC_IRQn));
+}
+
+static void TestFallbacks(void)
+{
+    hmac_fake_reset();
+    NVIC_EnableIRQ(HMAC_IRQn);
+
+    /* Another driver runs the engine: not touched, its pending interrupt kept. */
+    hmac_fake_set_foreign(true);
+    NVIC_SetPendingIRQ(HMAC_IRQn);
+    CHECK(WriteR(g_data) == DATA_SIZE);
+    CheckReadBack("engine in use");
+    CHECK(g_hmac.digests == 0);
+    CHECK(NVIC_GetEnableIRQ(HMAC_IRQn) && NVIC_GetPendingIRQ(HMAC_IRQn));
+    NVIC_ClearPendingIRQ(HMAC_IRQn);
+    hmac_fake_set_foreign(false);
+
+    hmac_fake_fail_start();
+    CHECK(WriteR(g_data) == DATA_SIZE);
+    CheckReadBack("start failed");
+    CHECK(NVIC_GetEnableIRQ(HMAC_IRQn));
+
+    /* A digest that never completes times out and gives the engine back. */
+    hmac_fake_hang();
+    CHECK(WriteR(g_data) == DATA_SIZE);
+    CheckReadBack("digest hung");
+    CHECK(NVIC_GetEnableIRQ(HMAC_IRQn) && !NVIC_GetPendingIRQ(HMAC_IRQn));
+    CHECK(!ll_hmac_is_enabled(HMAC));
+    CHECK(WriteR(g_data) == DATA_SIZE);
+    CHECK(g_reads == 0 && g_hmac.digests == 2);
+
+    hal_flash_set_security(true);
+    CHECK(WriteR(g_data) == DATA_SIZE);
+    CheckReadBack("encrypted");
+    hal_flash_set_security(false);
+
+    /* The DMA moves words. */
+    memmove(g_data + 1, g_data, DATA_SIZE);
+    CHECK(WriteR(g_data + 1) == DATA_SIZE);
+    CheckReadBack("unaligned");
+    CHECK(g_hmac.digests == 0);
+    memmove(g_data, g_data + 1, DATA_SIZE);
+    CHECK(!NVIC_GetPendingIRQ(HMAC_IRQn) && NVIC_GetEnableIRQ(HMAC_IRQn));
+}
+
+int main(void)
+{
+    for (uint32_t i = 0; i < DATA_SIZE; i++) {
+        g_data[i] = (uint8_t)(i * 7 + 3);
+    }
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_ext_init();
+    TestGoodWrite();
+    TestBadWrite();
+    if (HAL_FLASH_VERIFY_MODE == HAL_FLASH_VERIFY_SHA256) {
+        TestIrqRestored();
+        TestFallbacks();
+    }
+    flash_sim_close();
+    return HostTestResult(HAL_FLASH_VERIFY_MODE == HAL_FLASH_VERIFY_SHA256 ? "hal_flash_verify" :
+                          HAL_FLASH_VERIFY_MODE == HAL_FLASH_VERIFY_CRC32 ? "hal_flash_verify_crc32" :
+                          "hal_flash_verify_readback");
+}
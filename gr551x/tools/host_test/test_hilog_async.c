@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The asynchronous HiLog ring of platform/uart/uart.c, over a log UART faked in this file. Eight
+ * tasks write numbered records under each ring full policy while another reads and clears the
+ * statistics: every record reaches the wire whole and in its writer's order or is counted as
+ * dropped, none is dropped when writers block, and the cleared counts add up. bsp_uart_flush from a task waits for the ring. From a
+ * fault handler (TEST_ASSERT=0), or with interrupts masked on an assert (TEST_ASSERT=1), the
+ * records still queued go out by polling ahead of the report, while the drain task is stuck
+ * part way through a batch, and the output after that is sent in call order.
+ */
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_test.h"
+#include "app_log.h"
+#include "los_shim.h"
+#include "uart.h"
+
+#ifndef TEST_ASSERT
+#define TEST_ASSERT         0
+#endif
+
+#define PRODUCERS           8
+#define RECORDS             2000
+#define PACE                4       /* records a writer queues between pauses */
+#define WIRE_SIZE           (1024 * 1024)
+#define REC_FMT             "P%u %06u %08x\n"
+#define REC_LEN             19
+
+int HiLogWriteInternal(const char *buffer, size_t bufLen);
+
+static pthread_mutex_t g_wireLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wireCond = PTHREAD_COND_INITIALIZER;
+static char g_wire[WIRE_SIZE];
+static uint32_t g_wireLen;
+static uint32_t g_polled;               /* bytes sent through the LL calls */
+static bool g_hold;                     /* stop the next send half way, for good */
+static bool g_held;
+
+static uint32_t g_puts;                 /* HiLogWriteInternal calls that queued their record */
+static uint32_t g_done;
+static volatile bool g_statsStop;
+static HiLogAsyncStats g_statsSum;
+
+static uart_handle_t g_handle = { .p_instance = UART0 };
+
+static void WireAppend(const uint8_t *p_data, uint32_t len)
+{
+    if (g_wireLen + len <= WIRE_SIZE) {
+        memcpy(g_wire + g_wireLen, p_data, len);
+        g_wireLen += len;
+    }
+}
+
+uint16_t app_uart_init(app_uart_params_t *p_params, app_uart_evt_handler_t evt_handler, app_uart_tx_buf_t *tx_buffer)
+{
+    return APP_DRV_SUCCESS;
+}
+
+/* The drain task's sends: about 10 Mbaud, so that eight writers fill the ring. */
+uint16_t app_uart_transmit_sync(app_uart_id_t id, uint8_t *p_data, uint16_t size, uint32_t timeout)
+{
+    pthread_mutex_lock(&g_wireLock);
+    if (g_hold && !g_held) {
+        WireAppend(p_data, size / 2);
+        g_held = true;
+        pthread_cond_broadcast(&g_wireCond);
+        for (;;) {
+            pthread_cond_wait(&g_wireCond, &g_wireLock);
+        }
+    }
+    WireAppend(p_data, size);
+    pthread_mutex_unlock(&g_wireLock);
+    usleep(size);
+    return APP_DRV_SUCCESS;
+}
+
+uint16_t app_uart_receive_async(app_uart_id_t id, uint8_t *p_data, uint16_t size)
+{
+    return APP_DRV_SUCCESS;
+}
+
+void app_uart_flush(app_uart_id_t id)
+{
+}
+
+uart_handle_t *app_uart_get_handle(app_uart_id_t id)
+{
+    return &g_handle;
+}
+
+uint32_t ll_uart_is_active_flag_tfnf(uart_regs_t *UARTx)
+{
+    return 1;
+}
+
+uint32_t ll_uart_is_active_flag_tfe(uart_regs_t *UARTx)
+{
+    return 1;
+}
+
+/* Called with the drain task stuck in g_hold, or not sending at all: g_wireLock is free. */
+void ll_uart_transmit_data8(uart_regs_t *UARTx, uint8_t value)
+{
+    pthread_mutex_lock(&g_wireLock);
+    WireAppend(&value, 1);
+    g_polled++;
+    pthread_mutex_unlock(&g_wireLock);
+}
+
+sdk_err_t app_log_init(app_log_init_t *p_log_init, app_log_trans_func_t trans_func, app_log_flush_func_t flush_func)
+{
+    return SDK_SUCCESS;
+}
+
+void app_assert_init(void)
+{
+}
+
+static uint32_t Check(uint32_t p, uint32_t seq)
+{
+    return (seq * 2654435761U) ^ (p << 24);
+}
+
+static int Put(const char *fmt, uint32_t p, uint32_t seq)
+{
+    char rec[REC_LEN + 1];
+
+    (void)snprintf(rec, sizeof(rec), fmt, p, seq, Check(p, seq));
+    return HiLogWriteInternal(rec, strlen(rec) + 1);
+}
+
+static VOID *Producer(UINT32 p)
+{
+    for (uint32_t seq = 0; seq < RECORDS; seq++) {
+        if (Put(REC_FMT, p, seq) == 0) {
+            __atomic_fetch_add(&g_puts, 1, __ATOMIC_RELAXED);
+        }
+        if (seq % PACE == PACE - 1) {
+            usleep(1);          /* let the drain task in, so that the ring wraps many times */
+        }
+    }
+    __atomic_fetch_add(&g_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void StatsAdd(const HiLogAsyncStats *st)
+{
+    g_statsSum.records += st->records;
+    g_statsSum.bytes += st->bytes;
+    g_statsSum.droppedRecords += st->droppedRecords;
+    g_statsSum.droppedBytes += st->droppedBytes;
+}
+
+static VOID *StatsReader(UINT32 arg)
+{
+    HiLogAsyncStats st;
+
+    while (!g_statsStop) {
+        HiLogAsyncStatsGet(&st, true);
+        StatsAdd(&st);
+    }
+    __atomic_fetch_add(&g_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void Spawn(TSK_ENTRY_FUNC entry, UINT32 arg)
+{
+    TSK_INIT_PARAM_S task = {
+        .pfnTaskEntry = entry,
+        .uwArg = arg,
+        .pcName = "test",
+    };
+    UINT32 id;
+
+    CHECK(LOS_TaskCreate(&id, &task) == LOS_OK);
+}
+
+static void WaitDone(uint32_t n)
+{
+    while (__atomic_load_n(&g_done, __ATOMIC_ACQUIRE) < n) {
+        (void)LOS_TaskDelay(1);
+    }
+}
+
+/* Parse the wire: whole records only, each writer's in order. Returns how many. */
+static uint32_t WireRecords(const char *wire, uint32_t len)
+{
+    uint32_t next[PRODUCERS] = { 0 };
+    uint32_t n = 0;
+    uint32_t p;
+    uint32_t seq;
+    uint32_t sum;
+    int used;
+
+    for (uint32_t off = 0; off < len; off += REC_LEN) {
+        used = 0;
+        if (len - off < REC_LEN || sscanf(wire + off, "P%u %6u %8x\n%n", &p, &seq, &sum, &used) != 3 ||
+                used != REC_LEN || p >= PRODUCERS || sum != Check(p, seq) || seq < next[p]) {
+            printf("bad record at %u: %.*s\n", (unsigned)off, REC_LEN, wire + off);
+            CHECK(false);
+            return n;
+        }
+        next[p] = seq + 1;
+        n++;
+    }
+
+    return n;
+}
+
+static void Stress(HiLogAsyncPolicy policy, const char *name)
+{
+    HiLogAsyncStats st;
+    uint32_t received;
+    uint32_t sent = PRODUCERS * RECORDS;
+
+    HiLogAsyncSetPolicy(policy);
+    HiLogAsyncStatsGet(&st, true);
+    memset(&g_statsSum, 0, sizeof(g_statsSum));
+    g_wireLen = 0;
+    g_puts = 0;
+    g_done = 0;
+    g_statsStop = false;
+
+    Spawn(StatsReader, 0);
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        Spawn(Producer, p);
+    }
+    WaitDone(PRODUCERS);
+    CHECK(HiLogAsyncFlush(5000) == 0);
+    g_statsStop = true;
+    WaitDone(PRODUCERS + 1);
+    HiLogAsyncStatsGet(&st, true);
+    StatsAdd(&st);
+
+    received = WireRecords(g_wire, g_wireLen);
+    CHECK(received + g_statsSum.droppedRecords == sent);
+    CHECK(g_statsSum.records == g_puts);
+    CHECK(g_statsSum.bytes == g_puts * REC_LEN);
+    CHECK(g_statsSum.droppedBytes == g_statsSum.droppedRecords * REC_LEN);
+    if (policy == HILOG_ASYNC_DROP_NEWEST) {
+        CHECK(g_puts == received);
+    }
+    /* Every writer is a task, so blocking loses nothing. */
+    if (policy == HILOG_ASYNC_BLOCK) {
+        CHECK(g_statsSum.droppedRecords == 0);
+        CHECK(received == sent);
+    }
+    printf("%s: %u records from %u writers, %u on the wire, %u dropped\n", name, (unsigned)sent,
+           PRODUCERS, (unsigned)received, (unsigned)g_statsSum.droppedRecords);
+}
+
+/* A record queued from a task is on the wire when bsp_uart_flush returns, before what follows it. */
+static void FlushWaits(void)
+{
+    HiLogAsyncSetPolicy(HILOG_ASYNC_BLOCK);
+    g_wireLen = 0;
+    for (uint32_t seq = 0; seq < 100; seq++) {
+        CHECK(Put(REC_FMT, 0, seq) == 0);
+    }
+    bsp_uart_flush();
+    bsp_uart_send((uint8_t *)"sync\n", 5);
+    CHECK(g_wireLen == 100 * REC_LEN + 5);
+    CHECK(WireRecords(g_wire, 100 * REC_LEN) == 100);
+    CHECK(memcmp(g_wire + 100 * REC_LEN, "sync\n", 5) == 0);
+}
+
+/*
+ * The drain task stops half way through a batch. The records queued behind it come out by polling
+ * ahead of the report, and what is written after it, by printf or HiLog, follows in call order.
+ */
+static void Panic(void)
+{
+    uint32_t cut;
+    uint32_t queued = 10;
+    uint32_t polled;
+    const char *rest;
+
+    HiLogAsyncSetPolicy(HILOG_ASYNC_DROP_NEWEST);
+    g_wireLen = 0;
+    pthread_mutex_lock(&g_wireLock);
+    g_hold = true;
+    pthread_mutex_unlock(&g_wireLock);
+    CHECK(Put(REC_FMT, 1, 0) == 0);
+    pthread_mutex_lock(&g_wireLock);
+    while (!g_held) {
+        pthread_cond_wait(&g_wireCond, &g_wireLock);
+    }
+    cut = g_wireLen;
+    pthread_mutex_unlock(&g_wireLock);
+    CHECK(cut == REC_LEN / 2);
+    for (uint32_t seq = 0; seq < queued; seq++) {
+        CHECK(Put(REC_FMT, 2, seq) == 0);
+    }
+
+#if (TEST_ASSERT == 1)
+    HostIrqDisable();
+    bsp_uart_flush();
+    bsp_uart_send((uint8_t *)"report\n", 7);
+    HostIrqEnable();
+#else
+    HostFaultEnter(HardFault_IRQn);
+    bsp_uart_send((uint8_t *)"report\n", 7);
+    HostFaultExit();
+#endif
+    polled = g_polled;
+    CHECK(polled == queued * REC_LEN + 7);
+    CHECK(g_wireLen == cut + polled);
+    rest = g_wire + cut;
+    CHECK(WireRecords(rest, queued * REC_LEN) == queued);
+    CHECK(memcmp(rest, "P2 000000", 9) == 0);
+    CHECK(memcmp(rest + queued * REC_LEN, "report\n", 7) == 0);
+
+    /* From now on everything goes out at once, HiLog records included. */
+    CHECK(Put(REC_FMT, 3, 0) == 0);
+    bsp_uart_send((uint8_t *)"after\n", 6);
+    CHECK(g_polled == polled + REC_LEN + 6);
+    CHECK(memcmp(g_wire + g_wireLen - REC_LEN - 6, "P3 000000", 9) == 0);
+    CHECK(memcmp(g_wire + g_wireLen - 6, "after\n", 6) == 0);
+}
+
+int main(void)
+{
+    bsp_log_init();
+    Stress(HILOG_ASYNC_DROP_NEWEST, "drop newest");
+    Stress(HILOG_ASYNC_DROP_OLDEST, "drop oldest");
+    Stress(HILOG_ASYNC_BLOCK, "block");
+    FlushWaits();
+    Panic();
+    return HostTestResult(TEST_ASSERT ? "hilog_async_assert" : "hilog_async");
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The asynchronous IoTUartWrite of hal_iot_uart.c over app_uart.c and the fake UART. Writes larger
+ * than the transmit ring wait for it to drain and go out whole and in order. The drain callback runs
+ * once each time the data IoTUartWrite queued has all been sent, and not for the completion of a
+ * transfer someone else started on the UART. A port that was never opened has no rings to
+ * reconfigure. The FIFO thresholds come from the port's uart_config.hcs node, half full RX and
+ * empty TX without one.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "app_drv_fake.h"
+#include "app_uart.h"
+#include "hcs_fake.h"
+#include "hal_iot_uart_ext.h"
+#include "iot_errno.h"
+#include "iot_uart.h"
+#include "los_shim.h"
+#include "uart_fake.h"
+
+#define MS                  1000000ULL
+#define DATA_SIZE           4096
+
+static uint8_t g_data[DATA_SIZE];
+static uint32_t g_drains;
+
+static void Drained(unsigned int id, void *arg)
+{
+    CHECK(id == APP_UART_ID_0);
+    CHECK(arg == &g_drains);
+    CHECK(__get_IPSR() != 0);
+    g_drains++;
+}
+
+static bool SentMatches(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    const uint8_t *sent;
+
+    return uart_fake_sent(APP_UART_ID_0, &sent) == offset + len && memcmp(sent + offset, data, len) == 0;
+}
+
+int main(void)
+{
+    IotUartAttribute attr = {
+        .baudRate = 921600,
+        .dataBits = IOT_UART_DATA_BIT_8,
+        .stopBits = IOT_UART_STOP_BIT_1,
+        .parity = IOT_UART_PARITY_NONE,
+    };
+    IotUartWriteStats stats;
+    uint32_t rx_th;
+    uint32_t tx_th;
+
+    uart_fake_reset();
+    app_drv_fake_reset();
+    hcs_fake_reset();
+    HostIdleHookSet(uart_fake_idle);
+    for (uint32_t i = 0; i < DATA_SIZE; i++) {
+        g_data[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    CHECK(IoTUartSetFlowCtrl(APP_UART_ID_1, IOT_FLOW_CTRL_NONE) == (unsigned int)IOT_FAILURE);
+
+    CHECK(IoTUartInit(APP_UART_ID_0, &attr) == IOT_SUCCESS);
+    CHECK(IoTUartSetDrainCallback(APP_UART_ID_0, Drained, &g_drains) == IOT_SUCCESS);
+    CHECK(IoTUartSetWriteMode(APP_UART_ID_0, IOT_UART_WRITE_ASYNC) == IOT_SUCCESS);
+
+    /* Four times the ring: the write waits for the ring to drain three times, and returns once the
+     * last part is queued. */
+    CHECK(IoTUartWrite(APP_UART_ID_0, g_data, DATA_SIZE) == IOT_SUCCESS);
+    CHECK(g_drains == 3);
+    CHECK(IoTUartFlush(APP_UART_ID_0, 1000) == IOT_SUCCESS);
+    uart_fake_run(MS);
+    CHECK(SentMatches(0, g_data, DATA_SIZE));
+    CHECK(g_drains == 4);
+
+    /* Two writes within one drain, then a pause: one more drain. */
+    CHECK(IoTUartWrite(APP_UART_ID_0, g_data, 100) == IOT_SUCCESS);
+    CHECK(IoTUartWrite(APP_UART_ID_0, g_data + 100, 100) == IOT_SUCCESS);
+    uart_fake_run(5 * MS);
+    CHECK(SentMatches(DATA_SIZE, g_data, 200));
+    CHECK(g_drains == 5);
+
+    /* A transfer queued on the UART by someone else completes without a drain. */
+    CHECK(app_uart_transmit_async(APP_UART_ID_0, g_data, 64) == APP_DRV_SUCCESS);
+    uart_fake_run(5 * MS);
+    CHECK(SentMatches(DATA_SIZE + 200, g_data, 64));
+    CHECK(g_drains == 5);
+
+    CHECK(IoTUartWriteStatsGet(APP_UART_ID_0, &stats) == IOT_SUCCESS);
+    CHECK(stats.writes == 3);
+    CHECK(stats.bytes == DATA_SIZE + 200);
+    CHECK(stats.blocked == 1);
+    CHECK(stats.timeouts == 0);
+    CHECK(stats.drains == 5);
+
+    CHECK(IoTUartDeinit(APP_UART_ID_0) == IOT_SUCCESS);
+    CHECK(IoTUartSetFlowCtrl(APP_UART_ID_0, IOT_FLOW_CTRL_NONE) == (unsigned int)IOT_FAILURE);
+    CHECK(IoTUartInit(APP_UART_ID_0, &attr) == IOT_SUCCESS);
+    uart_fake_thresholds(APP_UART_ID_0, &rx_th, &tx_th);
+    CHECK(rx_th == UART_FAKE_FIFO_DEPTH / 2);
+    CHECK(tx_th == 0);
+    CHECK(IoTUartDeinit(APP_UART_ID_0) == IOT_SUCCESS);
+
+    hcs_fake_set_uint32("goodix_gr55xx_uart_0", "rx_fifo_threshold", LL_UART_RX_FIFO_TH_QUARTER_FULL);
+    hcs_fake_set_uint32("goodix_gr55xx_uart_0", "tx_fifo_threshold", LL_UART_TX_FIFO_TH_CHAR_2);
+    CHECK(IoTUartInit(APP_UART_ID_0, &attr) == IOT_SUCCESS);
+    uart_fake_thresholds(APP_UART_ID_0, &rx_th, &tx_th);
+    CHECK(rx_th == UART_FAKE_FIFO_DEPTH / 4);
+    CHECK(tx_th == 2);
+    CHECK(IoTUartDeinit(APP_UART_ID_0) == IOT_SUCCESS);
+    HostIdleHookSet(NULL);
+    return HostTestResult("iot_uart");
+}
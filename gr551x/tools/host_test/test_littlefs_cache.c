@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Page cache under the littlefs block callbacks (components/fs/littlefs.c): progs must reach
+ * the flash in the order littlefs issued them, on eviction as well as on sync, and reads must
+ * see progs that are still cached.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+#include "littlefs.h"
+#include "lfs_fake.h"
+
+#define BLOCK_SIZE      4096
+#define BLOCK_COUNT     32
+#define PAGE            256
+#define STREAMS         6
+#define ROUNDS          20000
+
+static struct lfs_config g_cfg = {
+    .read        = (int (*)(const struct lfs_config *, lfs_block_t, lfs_off_t, void *, lfs_size_t))
+                   littlefs_block_read,
+    .prog        = (int (*)(const struct lfs_config *, lfs_block_t, lfs_off_t, const void *, lfs_size_t))
+                   littlefs_block_write,
+    .erase       = littlefs_block_erase,
+    .sync        = littlefs_block_sync,
+    .read_size   = 16,
+    .prog_size   = 16,
+    .block_size  = BLOCK_SIZE,
+    .block_count = BLOCK_COUNT,
+    .cache_size  = 256,
+};
+
+/* Index of the prog that last wrote each byte of the partition, 0 for none. */
+static uint32_t g_owner[BLOCK_SIZE * BLOCK_COUNT];
+static uint8_t g_expect[BLOCK_SIZE * BLOCK_COUNT];
+static uint32_t g_progIdx;
+static uint32_t g_lastWritten;
+static uint32_t g_orderErrors;
+static uint32_t g_partBase;
+
+struct write_rec {
+    uint32_t addr;
+    uint32_t size;
+};
+static struct write_rec g_writes[64];
+static uint32_t g_writeCount;
+
+static void Trace(enum flash_sim_op op, uint32_t addr, uint32_t size)
+{
+    if (op != FLASH_SIM_OP_WRITE) {
+        return;
+    }
+    if (g_writeCount < sizeof(g_writes) / sizeof(g_writes[0])) {
+        g_writes[g_writeCount].addr = addr - g_partBase;
+        g_writes[g_writeCount].size = size;
+        g_writeCount++;
+    }
+    uint32_t lo = UINT32_MAX;
+    uint32_t hi = 0;
+    for (uint32_t i = addr - g_partBase; i < addr - g_partBase + size; i++) {
+        lo = (g_owner[i] < lo) ? g_owner[i] : lo;
+        hi = (g_owner[i] > hi) ? g_owner[i] : hi;
+    }
+    if (lo < g_lastWritten) {
+        g_orderErrors++;
+    }
+    g_lastWritten = (hi > g_lastWritten) ? hi : g_lastWritten;
+}
+
+static void Prog(lfs_block_t block, lfs_off_t off, const uint8_t *buf, lfs_size_t size)
+{
+    g_progIdx++;
+    for (lfs_size_t i = 0; i < size; i++) {
+        g_owner[block * BLOCK_SIZE + off + i] = g_progIdx;
+        g_expect[block * BLOCK_SIZE + off + i] = buf[i];
+    }
+    CHECK(g_cfg.prog(&g_cfg, block, off, buf, size) == 0);
+}
+
+static void Erase(lfs_block_t block)
+{
+    memset(&g_owner[block * BLOCK_SIZE], 0, BLOCK_SIZE * sizeof(g_owner[0]));
+    memset(&g_expect[block * BLOCK_SIZE], 0xFF, BLOCK_SIZE);
+    CHECK(g_cfg.erase(&g_cfg, block) == 0);
+}
+
+static void Setup(void)
+{
+    uint32_t id;
+    uint32_t size;
+
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    /* Keep littlefs reads on the QSPI path, the host has no XIP window. */
+    hal_flash_set_security(true);
+    CHECK(littlefs_flash_init(&g_cfg) == 0);
+    hal_flash_get_info(&id, &size);
+    g_partBase = EXFLASH_START_ADDR + size - EXFLASH_SIZE_SECTOR_BYTES * NVDS_NUM_SECTOR - BLOCK_SIZE * BLOCK_COUNT;
+    memset(g_owner, 0, sizeof(g_owner));
+    memset(g_expect, 0xFF, sizeof(g_expect));
+    g_progIdx = 0;
+    g_lastWritten = 0;
+    g_orderErrors = 0;
+    g_writeCount = 0;
+    flash_sim_set_trace(Trace);
+}
+
+static void Teardown(void)
+{
+    flash_sim_set_trace(NULL);
+    flash_sim_close();
+}
+
+/* A prog merged into an older dirty page must not overtake a later prog to another page. */
+static void TestMergeKeepsOrder(void)
+{
+    uint8_t buf[16];
+
+    Setup();
+    memset(buf, 0xA5, sizeof(buf));
+    Prog(0, 0, buf, 16);
+    Prog(1, 0, buf, 16);
+    Prog(0, 16, buf, 16);
+    CHECK(g_cfg.sync(&g_cfg) == 0);
+
+    CHECK(g_orderErrors == 0);
+    CHECK(g_writeCount == 3);
+    CHECK(g_writes[0].addr == 0 && g_writes[0].size == 16);
+    CHECK(g_writes[1].addr == BLOCK_SIZE && g_writes[1].size == 16);
+    CHECK(g_writes[2].addr == 16 && g_writes[2].size == 16);
+    Teardown();
+
+    /* Appends to the most recent page still merge into one program. */
+    Setup();
+    Prog(2, 0, buf, 16);
+    Prog(2, 16, buf, 16);
+    Prog(2, 32, buf, 16);
+    CHECK(g_cfg.sync(&g_cfg) == 0);
+    CHECK(g_writeCount == 1);
+    CHECK(g_writes[0].size == 48);
+    Teardown();
+}
+
+/* Evicting the LRU page writes back every older dirty range first. */
+static void TestEvictionKeepsOrder(void)
+{
+    uint8_t buf[16];
+    uint8_t rd[16];
+
+    Setup();
+    memset(buf, 0x5A, sizeof(buf));
+    for (lfs_block_t page = 0; page < LFS_BLOCK_CACHE_PAGES; page++) {
+        Prog(3, page * PAGE, buf, sizeof(buf));
+    }
+    /* Page 0 is the oldest dirty range but the most recently used line. */
+    CHECK(g_cfg.read(&g_cfg, 3, 0, rd, sizeof(rd)) == 0);
+    Prog(4, 0, buf, sizeof(buf));
+
+    CHECK(g_writeCount == 2);
+    CHECK(g_writes[0].addr == 3 * BLOCK_SIZE);
+    CHECK(g_writes[1].addr == 3 * BLOCK_SIZE + PAGE);
+    CHECK(g_cfg.sync(&g_cfg) == 0);
+    CHECK(g_orderErrors == 0);
+    Teardown();
+}
+
+/* The next block, round robin, that no stream is appending to. */
+static lfs_block_t NextFreeBlock(const lfs_block_t block[STREAMS], lfs_block_t *next)
+{
+    for (;;) {
+        lfs_block_t candidate = *next;
+        bool held = false;
+
+        *next = (*next + 1) % BLOCK_COUNT;
+        for (int s = 0; s < STREAMS; s++) {
+            held = held || (block[s] == candidate);
+        }
+        if (!held) {
+            return candidate;
+        }
+    }
+}
+
+/* Random interleaved appends, reads, syncs and erases, like littlefs with several open files. */
+static void TestRandomStreams(void)
+{
+    lfs_block_t block[STREAMS];
+    lfs_off_t off[STREAMS];
+    lfs_block_t next = 0;
+    uint8_t buf[PAGE];
+    uint8_t rd[PAGE];
+
+    Setup();
+    srand(1);
+    for (int s = 0; s < STREAMS; s++) {
+        block[s] = next++;
+        off[s] = 0;
+    }
+    for (int round = 0; round < ROUNDS; round++) {
+        int s = rand() % STREAMS;
+        int action = rand() % 100;
+
+        if (action < 70) {
+            lfs_size_t size = (lfs_size_t)(1 + rand() % 6) * g_cfg.prog_size;
+            if (off[s] + size > BLOCK_SIZE) {
+                block[s] = NextFreeBlock(block, &next);
+                off[s] = 0;
+                Erase(block[s]);
+            }
+            for (lfs_size_t i = 0; i < size; i++) {
+                buf[i] = (uint8_t)rand();
+            }
+            Prog(block[s], off[s], buf, size);
+            off[s] += size;
+        } else if (action < 90) {
+            if (off[s] > 0) {
+                lfs_off_t start = (lfs_off_t)rand() % off[s];
+                lfs_size_t size = lfs_min(off[s] - start, (lfs_size_t)(1 + rand() % PAGE));
+                CHECK(g_cfg.read(&g_cfg, block[s], start, rd, size) == 0);
+                CHECK(memcmp(rd, &g_expect[block[s] * BLOCK_SIZE + start], size) == 0);
+            }
+        } else {
+            CHECK(g_cfg.sync(&g_cfg) == 0);
+        }
+    }
+    CHECK(g_cfg.sync(&g_cfg) == 0);
+    CHECK(g_orderErrors == 0);
+    CHECK(memcmp(flash_sim_image() + (g_partBase - EXFLASH_START_ADDR), g_expect, sizeof(g_expect)) == 0);
+    Teardown();
+}
+
+int main(void)
+{
+    lfs_fake_reset();
+    TestMergeKeepsOrder();
+    TestEvictionKeepsOrder();
+    TestRandomStreams();
+    return HostTestResult("littlefs_cache");
+}
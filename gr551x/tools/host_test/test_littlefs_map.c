@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * XIP mapping of littlefs files (littlefs_map in components/fs/littlefs.c) on the flash simulator's
+ * XIP window: the returned address and length, the cases that cannot be mapped, the mounted instance
+ * left untouched, and littlefs callbacks held off for the whole lookup.
+ */
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_test.h"
+#include "littlefs.h"
+#include "lfs_fake.h"
+
+#define BLOCK_SIZE      4096
+#define BLOCK_COUNT     32
+#define CACHE_SIZE      256
+#define HOLD_OFF_US     50000
+
+static struct lfs_config g_cfg = {
+    .read        = (int (*)(const struct lfs_config *, lfs_block_t, lfs_off_t, void *, lfs_size_t))
+                   littlefs_block_read,
+    .prog        = (int (*)(const struct lfs_config *, lfs_block_t, lfs_off_t, const void *, lfs_size_t))
+                   littlefs_block_write,
+    .erase       = littlefs_block_erase,
+    .sync        = littlefs_block_sync,
+    .read_size   = 16,
+    .prog_size   = 16,
+    .block_size  = BLOCK_SIZE,
+    .block_count = BLOCK_COUNT,
+    .cache_size  = CACHE_SIZE,
+};
+
+static lfs_t g_lfs;
+static uint8_t g_rbuf[CACHE_SIZE];
+static uint8_t g_pbuf[CACHE_SIZE];
+static uint32_t g_partBase;
+
+static void Setup(bool security)
+{
+    uint32_t id;
+    uint32_t size;
+    uint8_t data[BLOCK_SIZE];
+
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_set_security(security);
+    CHECK(littlefs_flash_init(&g_cfg) == 0);
+    hal_flash_get_info(&id, &size);
+    g_partBase = EXFLASH_START_ADDR + size - EXFLASH_SIZE_SECTOR_BYTES * NVDS_NUM_SECTOR - BLOCK_SIZE * BLOCK_COUNT;
+    /* Every byte holds the low bits of its block number and offset. */
+    for (lfs_block_t b = 0; b < BLOCK_COUNT; b++) {
+        for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
+            data[i] = (uint8_t)(b * 16 + i);
+        }
+        CHECK(hal_flash_write(g_partBase + b * BLOCK_SIZE, data, BLOCK_SIZE) == BLOCK_SIZE);
+    }
+
+    memset(&g_lfs, 0, sizeof(g_lfs));
+    g_lfs.cfg = &g_cfg;
+    g_lfs.rcache.buffer = g_rbuf;
+    g_lfs.rcache.block = (lfs_block_t)-1;
+    g_lfs.pcache.buffer = g_pbuf;
+    g_lfs.pcache.block = (lfs_block_t)-1;
+    lfs_fake_reset();
+    lfs_fake_file("/a", 4, 6000, false);
+    lfs_fake_file("/inline", 0, 20, true);
+}
+
+static void TestMapsContiguousRange(void)
+{
+    const void *addr = NULL;
+    lfs_size_t size = 0;
+
+    Setup(false);
+    CHECK(littlefs_map(&g_lfs, "/a", 100, &addr, &size) == LFS_ERR_OK);
+    CHECK(addr == (const void *)(uintptr_t)(g_partBase + 4 * BLOCK_SIZE + 100));
+    CHECK(size == BLOCK_SIZE - 100);
+    CHECK(*(const uint8_t *)addr == (uint8_t)(4 * 16 + 100));
+
+    /* The second block ends at the end of the file. */
+    CHECK(littlefs_map(&g_lfs, "/a", 5000, &addr, &size) == LFS_ERR_OK);
+    CHECK(addr == (const void *)(uintptr_t)(g_partBase + 5 * BLOCK_SIZE + 5000 - BLOCK_SIZE));
+    CHECK(size == 1000);
+    CHECK(*(const uint8_t *)addr == (uint8_t)(5 * 16 + 5000 - BLOCK_SIZE));
+    flash_sim_close();
+}
+
+static void TestRejects(void)
+{
+    const void *addr = NULL;
+    lfs_size_t size = 0;
+
+    Setup(false);
+    CHECK(littlefs_map(&g_lfs, "/inline", 0, &addr, &size) == LFS_ERR_INVAL);
+    CHECK(littlefs_map(&g_lfs, "/a", 6000, &addr, &size) == LFS_ERR_INVAL);
+    CHECK(littlefs_map(&g_lfs, "/missing", 0, &addr, &size) == LFS_ERR_NOENT);
+    CHECK(g_lfs.mlist == NULL);
+    flash_sim_close();
+
+    /* Encrypted partitions have no plain-text window. */
+    Setup(true);
+    CHECK(littlefs_map(&g_lfs, "/a", 0, &addr, &size) == LFS_ERR_INVAL);
+    flash_sim_close();
+}
+
+static void TestMountedInstanceUntouched(void)
+{
+    const void *addr = NULL;
+    lfs_size_t size = 0;
+    lfs_file_t open;
+    lfs_t before;
+
+    Setup(false);
+    CHECK(lfs_file_open(&g_lfs, &open, "/a", LFS_O_RDWR) == 0);
+    memset(g_rbuf, 0x11, sizeof(g_rbuf));
+    g_lfs.rcache.block = 4;
+    g_lfs.rcache.off = 0;
+    g_lfs.rcache.size = CACHE_SIZE;
+    memset(g_pbuf, 0x22, sizeof(g_pbuf));
+    g_lfs.pcache.block = 4;
+    g_lfs.pcache.off = 0;
+    g_lfs.pcache.size = CACHE_SIZE;
+    before = g_lfs;
+
+    /* Content in the mounted caches is not what the flash holds and must not leak into the lookup. */
+    CHECK(littlefs_map(&g_lfs, "/a", 0, &addr, &size) == LFS_ERR_OK);
+    CHECK(memcmp(&before, &g_lfs, sizeof(g_lfs)) == 0);
+    CHECK(g_rbuf[0] == 0x11 && g_pbuf[0] == 0x22);
+    CHECK(g_lfs.mlist == (struct lfs_mlist *)&open);
+    CHECK(open.next == NULL);
+    CHECK(lfs_file_close(&g_lfs, &open) == 0);
+    flash_sim_close();
+}
+
+static volatile bool g_progDone;
+static bool g_progStarted;
+static pthread_t g_prog;
+
+static void *ForegroundProg(void *arg)
+{
+    uint8_t buf[16];
+
+    (void)arg;
+    memset(buf, 0, sizeof(buf));
+    CHECK(g_cfg.prog(&g_cfg, 20, 0, buf, sizeof(buf)) == 0);
+    g_progDone = true;
+    return NULL;
+}
+
+/* Start a foreground prog while the lookup reads: it must wait until the lookup is over. */
+static void StartProg(lfs_block_t block)
+{
+    (void)block;
+    if (g_progStarted) {
+        return;
+    }
+    g_progStarted = true;
+    CHECK(pthread_create(&g_prog, NULL, ForegroundProg, NULL) == 0);
+    usleep(HOLD_OFF_US);
+    CHECK(!g_progDone);
+}
+
+static void TestHoldsOffCallbacks(void)
+{
+    const void *addr = NULL;
+    lfs_size_t size = 0;
+
+    Setup(false);
+    g_progDone = false;
+    g_progStarted = false;
+    lfs_fake_set_read_hook(StartProg);
+    CHECK(littlefs_map(&g_lfs, "/a", 0, &addr, &size) == LFS_ERR_OK);
+    CHECK(g_progStarted);
+    pthread_join(g_prog, NULL);
+    CHECK(g_progDone);
+    lfs_fake_set_read_hook(NULL);
+    flash_sim_close();
+}
+
+int main(void)
+{
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    if (!flash_sim_xip()) {
+        printf("littlefs_map: XIP window not available on this host, skipped\n");
+        flash_sim_close();
+        return HostTestResult("littlefs_map");
+    }
+    flash_sim_close();
+    TestMapsContiguousRange();
+    TestRejects();
+    TestMountedInstanceUntouched();
+    TestHoldsOffCallbacks();
+    return HostTestResult("littlefs_map");
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Background pre-erase of the littlefs glue (components/fs/littlefs.c): only blocks that neither the
+ * flash nor the open files reference are erased, the mounted instance is left untouched, and no pass
+ * erases anything while a commit is in flight or littlefs called back meanwhile, or when the erase
+ * could not be suspended before the next radio event.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "littlefs.h"
+#include "lfs_fake.h"
+#include "hal_flash_sched.h"
+
+#define BLOCK_SIZE      4096
+#define BLOCK_COUNT     32
+#define CACHE_SIZE      256
+
+/* Gap an erase needs before the next radio event, less the margin: only its suspend if it can be suspended. */
+#if (HAL_FLASH_SCHED_ERASE_SUSPEND == 1)
+#define ERASE_GAP_US    HAL_FLASH_SCHED_SUSPEND_US
+#else
+#define ERASE_GAP_US    HAL_FLASH_SCHED_ERASE_US
+#endif
+
+static struct lfs_config g_cfg = {
+    .read        = (int (*)(const struct lfs_config *, lfs_block_t, lfs_off_t, void *, lfs_size_t))
+                   littlefs_block_read,
+    .prog        = (int (*)(const struct lfs_config *, lfs_block_t, lfs_off_t, const void *, lfs_size_t))
+                   littlefs_block_write,
+    .erase       = littlefs_block_erase,
+    .sync        = littlefs_block_sync,
+    .read_size   = 16,
+    .prog_size   = 16,
+    .block_size  = BLOCK_SIZE,
+    .block_count = BLOCK_COUNT,
+    .cache_size  = CACHE_SIZE,
+};
+
+/* The mounted instance, as the littlefs adapter holds it. */
+static lfs_t g_lfs;
+static uint8_t g_rbuf[CACHE_SIZE];
+static uint8_t g_pbuf[CACHE_SIZE];
+
+static uint32_t g_partBase;
+static bool g_erased[BLOCK_COUNT];
+static uint32_t g_eraseCount;
+
+static void Trace(enum flash_sim_op op, uint32_t addr, uint32_t size)
+{
+    if (op != FLASH_SIM_OP_ERASE) {
+        return;
+    }
+    for (uint32_t a = addr; a < addr + size; a += BLOCK_SIZE) {
+        g_erased[(a - g_partBase) / BLOCK_SIZE] = true;
+        g_eraseCount++;
+    }
+}
+
+static void ClearErased(void)
+{
+    memset(g_erased, 0, sizeof(g_erased));
+    g_eraseCount = 0;
+}
+
+static void Setup(void)
+{
+    uint32_t id;
+    uint32_t size;
+
+    CHECK(flash_sim_open(NULL, 0x100000) == 0);
+    hal_flash_set_security(true);
+    CHECK(littlefs_flash_init(&g_cfg) == 0);
+    hal_flash_get_info(&id, &size);
+    g_partBase = EXFLASH_START_ADDR + size - EXFLASH_SIZE_SECTOR_BYTES * NVDS_NUM_SECTOR - BLOCK_SIZE * BLOCK_COUNT;
+
+    memset(&g_lfs, 0, sizeof(g_lfs));
+    g_lfs.cfg = &g_cfg;
+    g_lfs.rcache.buffer = g_rbuf;
+    g_lfs.rcache.block = (lfs_block_t)-1;
+    g_lfs.pcache.buffer = g_pbuf;
+    g_lfs.pcache.block = (lfs_block_t)-1;
+    lfs_fake_reset();
+    ClearErased();
+    flash_sim_set_trace(Trace);
+}
+
+static void Teardown(void)
+{
+    flash_sim_set_trace(NULL);
+    flash_sim_close();
+}
+
+/* Free blocks are erased in order up to the batch size, and littlefs then skips their erase. */
+static void TestErasesFreeBlocks(void)
+{
+    Setup();
+    lfs_fake_use(0);
+    lfs_fake_use(1);
+    lfs_fake_use(5);
+
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, 4) == 4);
+    CHECK(g_eraseCount == 4);
+    CHECK(g_erased[2] && g_erased[3] && g_erased[4] && g_erased[6]);
+    CHECK(!g_erased[0] && !g_erased[1] && !g_erased[5]);
+
+    /* The next pass continues with the blocks not erased yet. */
+    ClearErased();
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, 2) == 2);
+    CHECK(g_erased[7] && g_erased[8] && (g_eraseCount == 2));
+
+    ClearErased();
+    CHECK(g_cfg.erase(&g_cfg, 2) == 0);
+    CHECK(g_eraseCount == 0);
+    /* A block littlefs took back is erased by littlefs itself next time. */
+    CHECK(g_cfg.erase(&g_cfg, 2) == 0);
+    CHECK(g_erased[2]);
+    Teardown();
+}
+
+/* The pass works on private caches and a private mlist: the mounted instance stays as it was. */
+static void TestMountedInstanceUntouched(void)
+{
+    lfs_file_t file;
+    lfs_t before;
+    uint8_t rbuf[CACHE_SIZE];
+    uint8_t pbuf[CACHE_SIZE];
+
+    Setup();
+    lfs_fake_use(0);
+    lfs_fake_use(1);
+    lfs_fake_file("/f", 3, 100, false);
+    CHECK(lfs_file_open(&g_lfs, &file, "/f", LFS_O_RDWR) == 0);
+    memset(g_rbuf, 0x11, sizeof(g_rbuf));
+    g_lfs.rcache.block = 0;
+    g_lfs.rcache.off = 0;
+    g_lfs.rcache.size = CACHE_SIZE;
+    /* A prog littlefs has not issued yet: whatever the pass reads must not come from it. */
+    memset(g_pbuf, 0x22, sizeof(g_pbuf));
+    g_lfs.pcache.block = 1;
+    g_lfs.pcache.off = 0;
+    g_lfs.pcache.size = CACHE_SIZE;
+    before = g_lfs;
+    memcpy(rbuf, g_rbuf, sizeof(rbuf));
+    memcpy(pbuf, g_pbuf, sizeof(pbuf));
+
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, BLOCK_COUNT) > 0);
+    CHECK(memcmp(&before, &g_lfs, sizeof(g_lfs)) == 0);
+    CHECK(memcmp(rbuf, g_rbuf, sizeof(rbuf)) == 0);
+    CHECK(memcmp(pbuf, g_pbuf, sizeof(pbuf)) == 0);
+    CHECK(g_lfs.mlist == (struct lfs_mlist *)&file);
+    CHECK(file.next == NULL);
+    CHECK(lfs_file_close(&g_lfs, &file) == 0);
+    Teardown();
+}
+
+/* Blocks only open files reference are kept: a dirty file's new head and the block being written. */
+static void TestOpenFilesKept(void)
+{
+    lfs_file_t dirty;
+    lfs_file_t writing;
+
+    Setup();
+    lfs_fake_use(0);
+    lfs_fake_use(1);
+    lfs_fake_file("/dirty", 2, 10, false);
+    lfs_fake_file("/writing", 3, 10, false);
+    CHECK(lfs_file_open(&g_lfs, &dirty, "/dirty", LFS_O_RDWR) == 0);
+    CHECK(lfs_file_open(&g_lfs, &writing, "/writing", LFS_O_RDWR) == 0);
+    dirty.flags |= LFS_F_DIRTY;
+    dirty.ctz.head = 7;
+    writing.flags |= LFS_F_WRITING;
+    writing.block = 9;
+
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, BLOCK_COUNT) == BLOCK_COUNT - 4);
+    CHECK(!g_erased[0] && !g_erased[1] && !g_erased[7] && !g_erased[9]);
+    CHECK(g_erased[2] && g_erased[3] && g_erased[8]);
+    CHECK(lfs_file_close(&g_lfs, &writing) == 0);
+    CHECK(lfs_file_close(&g_lfs, &dirty) == 0);
+    Teardown();
+}
+
+/* Between a prog or erase and the next sync the blocks of the commit are not on flash yet. */
+static void TestSkipsCommitInFlight(void)
+{
+    uint8_t buf[16];
+
+    Setup();
+    lfs_fake_use(0);
+    lfs_fake_use(1);
+    memset(buf, 0xA5, sizeof(buf));
+    CHECK(g_cfg.erase(&g_cfg, 10) == 0);
+    CHECK(g_cfg.prog(&g_cfg, 10, 0, buf, sizeof(buf)) == 0);
+    ClearErased();
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, BLOCK_COUNT) == 0);
+    CHECK(g_eraseCount == 0);
+
+    /* A commit ends with a sync, blocks it did not reference are free again. */
+    lfs_fake_use(10);
+    CHECK(g_cfg.sync(&g_cfg) == 0);
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, BLOCK_COUNT) == BLOCK_COUNT - 3);
+    CHECK(!g_erased[10]);
+    Teardown();
+}
+
+static bool g_foregroundDone;
+
+static void ForegroundRead(lfs_block_t block)
+{
+    uint8_t buf[16];
+
+    if (!g_foregroundDone) {
+        g_foregroundDone = true;
+        CHECK(g_cfg.read(&g_cfg, block, 0, buf, sizeof(buf)) == 0);
+    }
+}
+
+/* Any littlefs callback during the traversal, even a read, means a foreground operation ran: drop the pass. */
+static void TestDropsOnActivity(void)
+{
+    Setup();
+    lfs_fake_use(0);
+    lfs_fake_use(1);
+    g_foregroundDone = false;
+    lfs_fake_set_traverse_hook(ForegroundRead);
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, BLOCK_COUNT) == 0);
+    CHECK(g_foregroundDone);
+    CHECK(g_eraseCount == 0);
+
+    lfs_fake_set_traverse_hook(NULL);
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, BLOCK_COUNT) == BLOCK_COUNT - 2);
+    Teardown();
+}
+
+static uint32_t g_gapUs;
+
+static uint32_t GapTimeMs(void)
+{
+    return 0;
+}
+
+static uint32_t GapGet(void)
+{
+    return g_gapUs;
+}
+
+/* A pass stops at the first block whose erase does not fit before the next radio event. */
+static void TestWaitsForRadioGap(void)
+{
+    Setup();
+    CHECK(hal_flash_sched_init(GapTimeMs, GapGet));
+    g_gapUs = ERASE_GAP_US;
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, 4) == 0);
+    CHECK(g_eraseCount == 0);
+    g_gapUs = ERASE_GAP_US + HAL_FLASH_SCHED_MARGIN_US;
+    CHECK(littlefs_pre_erase(&g_lfs, &g_cfg, 4) == 4);
+    CHECK(g_eraseCount == 4);
+    g_gapUs = HAL_FLASH_SCHED_GAP_ANY;
+    Teardown();
+}
+
+int main(void)
+{
+    TestErasesFreeBlocks();
+    TestMountedInstanceUntouched();
+    TestOpenFilesKept();
+    TestSkipsCommitInFlight();
+    TestDropsOnActivity();
+    TestWaitsForRadioGap();
+    return HostTestResult("littlefs_pre_erase");
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Quad mode of the external SPI flash driver (drivers_ext/gr551x/gr551x_spi_flash.c) against the
+ * SPI NOR model, for every JESD216 QE type: QE is set with the part's own command sequence and only
+ * once, IO2/IO3 are handed back to the QSPI before the first quad transfer, 0xEB goes out with a
+ * defined mode byte, and data survives a write across pages. Parts whose QE cannot be set, and
+ * builds with SPI_FLASH_QUAD_ENABLE=0, stay on single-line commands. The model must see no
+ * protocol violation anywhere.
+ */
+#include <string.h>
+#include "host_test.h"
+#include "gr551x_spi_flash.h"
+#include "spi_bus_fake.h"
+#include "sfdp_fixture.h"
+
+#ifndef SPI_FLASH_QUAD_ENABLE
+#define SPI_FLASH_QUAD_ENABLE   1
+#endif
+
+#define DATA_ADDR           0x100F0
+#define DATA_SIZE           1000
+#define CMDS_MAX            64
+
+static uint8_t g_cmds[CMDS_MAX];
+static uint32_t g_cmdCount;
+static uint32_t g_quadReads;
+static uint32_t g_badModeReads;
+
+/* Instructions in order, a run of status polls kept as one 0x05. */
+static void Trace(const struct spi_nor_op *op)
+{
+    if (op->cmd == 0xEB) {
+        g_quadReads++;
+        if (op->addr_bits != 32 || (op->addr & 0xFF) != 0x00 || op->dummy_clocks != 4) {
+            g_badModeReads++;
+        }
+    }
+    if (g_cmdCount > 0 && op->cmd == 0x05 && g_cmds[g_cmdCount - 1] == 0x05) {
+        return;
+    }
+    if (g_cmdCount < CMDS_MAX) {
+        g_cmds[g_cmdCount++] = op->cmd;
+    }
+}
+
+static void Open(struct spi_nor_part *part)
+{
+    CHECK(spi_nor_open(part) == 0);
+    spi_bus_fake_reset();
+    spi_nor_set_trace(Trace);
+    g_cmdCount = 0;
+    g_quadReads = 0;
+    g_badModeReads = 0;
+}
+
+static bool Init(void)
+{
+    flash_init_t init = {
+        .spi_type = FLASH_QSPI_ID1,
+        .flash_io = {
+            .spi_cs  = { APP_IO_TYPE_NORMAL, APP_IO_PIN_15, APP_IO_MUX_2 },
+            .spi_clk = { APP_IO_TYPE_NORMAL, APP_IO_PIN_9, APP_IO_MUX_2 },
+            .spi_io0 = { .qspi_io0 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_8, APP_IO_MUX_2 } },
+            .spi_io1 = { .qspi_io1 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_14, APP_IO_MUX_2 } },
+            .qspi_io2 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_13, APP_IO_MUX_2 },
+            .qspi_io3 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_12, APP_IO_MUX_2 },
+        },
+    };
+    bool ret = spi_flash_init(&init);
+
+    spi_bus_fake_idle();
+    return ret;
+}
+
+static void CheckClean(void)
+{
+    struct spi_nor_stats st;
+    struct spi_bus_fake_stats bus;
+
+    spi_nor_get_stats(&st);
+    spi_bus_fake_get_stats(&bus);
+    if (st.violations != 0) {
+        printf("violation: %s\n", st.reason);
+    }
+    CHECK(st.violations == 0);
+    CHECK(bus.busy == 0 && bus.stray_hal == 0);
+}
+
+/* Write across pages and read back, in whichever mode the driver picked. */
+static void RoundTrip(void)
+{
+    static uint8_t data[DATA_SIZE];
+    static uint8_t rd[DATA_SIZE];
+    spi_flash_write_stats_t before;
+    spi_flash_write_stats_t after;
+
+    for (uint32_t i = 0; i < DATA_SIZE; i++) {
+        data[i] = (uint8_t)(i * 13 + 1);
+    }
+    spi_flash_write_stats_get(&before);
+    CHECK(spi_flash_sector_erase(DATA_ADDR & ~0xFFFU, 0x1000));
+    CHECK(spi_flash_write(DATA_ADDR, data, DATA_SIZE) == DATA_SIZE);
+    spi_bus_fake_idle();
+    spi_flash_write_stats_get(&after);
+    /* 16 + 3 * 256 + 216 bytes. */
+    CHECK(after.pages - before.pages == 5);
+    CHECK(memcmp(spi_nor_image() + DATA_ADDR, data, DATA_SIZE) == 0);
+    memset(rd, 0, sizeof(rd));
+    CHECK(spi_flash_read(DATA_ADDR, rd, DATA_SIZE) == DATA_SIZE);
+    CHECK(memcmp(rd, data, DATA_SIZE) == 0);
+}
+
+#if (SPI_FLASH_QUAD_ENABLE == 1)
+static uint8_t g_sfdp[SFDP_FIXTURE_SIZE];
+
+/* A JESD216B table: 1 MB, 4/32/64 KB erases, 1-4-4 0xEB with 2 mode and 4 dummy clocks, QER as given. */
+static void BuildSfdp(uint32_t qer)
+{
+    struct sfdp_fixture_bfpt bfpt = {
+        .dw = {
+            [0]  = 0x00602001,              /* DW1: 4 KB erase 0x20, 1-1-4 and 1-4-4 */
+            [1]  = 0x007FFFFF,              /* DW2: 8 Mbit */
+            [2]  = 0x6B08EB44,              /* DW3: 0x6B 8 dummy, 0xEB 2 mode + 4 dummy */
+            [7]  = 0x520F200C,              /* DW8: 4 KB 0x20, 32 KB 0x52 */
+            [8]  = 0x0000D810,              /* DW9: 64 KB 0xD8 */
+            [10] = 0x00000080,              /* DW11: 256 byte pages */
+            [12] = 0x757A0000,              /* DW13: suspend 0x75, resume 0x7A */
+            [14] = qer << 20,               /* DW15 */
+        },
+        .dwords = 16,
+        .minor  = 6,
+    };
+
+    sfdp_fixture_build(g_sfdp, &bfpt);
+}
+
+static bool SeqIs(const uint8_t *seq, uint32_t len)
+{
+    if (g_cmdCount != len || memcmp(g_cmds, seq, len) != 0) {
+        printf("sequence:");
+        for (uint32_t i = 0; i < g_cmdCount; i++) {
+            printf(" %02X", g_cmds[i]);
+        }
+        printf("\n");
+        return false;
+    }
+    return true;
+}
+
+static void QuadPart(const char *name, struct spi_nor_part *part, const uint8_t *seq, uint32_t len)
+{
+    printf("%s\n", name);
+    Open(part);
+    CHECK(Init());
+    CHECK(spi_flash_mode_get() == SPI_FLASH_MODE_QUAD);
+    CHECK(SeqIs(seq, len));
+    g_cmdCount = 0;
+    RoundTrip();
+    CHECK(g_quadReads == 1 && g_badModeReads == 0);
+    CheckClean();
+
+    /* QE is non-volatile: after a power cycle it is only read, not written again. */
+    spi_nor_power_cycle();
+    g_cmdCount = 0;
+    CHECK(Init());
+    CHECK(spi_flash_mode_get() == SPI_FLASH_MODE_QUAD);
+    CHECK(g_cmdCount >= 3 && g_cmds[0] == 0x5A);
+    for (uint32_t i = 0; i < g_cmdCount; i++) {
+        CHECK(g_cmds[i] != 0x06);
+    }
+    CheckClean();
+}
+
+static void TestQeTypes(void)
+{
+    static const uint8_t probe_wrsr1[] = { 0x5A, 0x9F, 0x35, 0x06, 0x31, 0x05, 0x35 };
+    /* The old type ignores 0x31, the driver then writes SR1 and SR2 with 0x01. */
+    static const uint8_t probe_wrsr[] = {
+        0x5A, 0x9F, 0x35, 0x06, 0x31, 0x05, 0x35, 0x35, 0x05, 0x06, 0x01, 0x05, 0x35,
+    };
+    static const uint8_t probe_mxic[] = { 0x5A, 0x9F, 0x05, 0x06, 0x01, 0x05 };
+    static const uint8_t sfdp_bit7[] = { 0x5A, 0x5A, 0x5A, 0x9F, 0x3F, 0x06, 0x3E, 0x05, 0x3F };
+    static const uint8_t sfdp_wrsr[] = { 0x5A, 0x5A, 0x5A, 0x9F, 0x35, 0x05, 0x06, 0x01, 0x05, 0x35 };
+    static const uint8_t sfdp_none[] = { 0x5A, 0x5A, 0x5A, 0x9F };
+    struct spi_nor_part part;
+
+    spi_nor_part_default(&part, SPI_NOR_QE_SR2_WRSR1);
+    QuadPart("sr2 0x31, no sfdp", &part, probe_wrsr1, sizeof(probe_wrsr1));
+    spi_nor_part_default(&part, SPI_NOR_QE_SR2_WRSR);
+    QuadPart("sr2 0x01, no sfdp", &part, probe_wrsr, sizeof(probe_wrsr));
+    spi_nor_part_default(&part, SPI_NOR_QE_SR1_BIT6);
+    QuadPart("macronix, no sfdp", &part, probe_mxic, sizeof(probe_mxic));
+
+    spi_nor_part_default(&part, SPI_NOR_QE_SR2_BIT7);
+    BuildSfdp(3);
+    part.sfdp = g_sfdp;
+    part.sfdp_len = sizeof(g_sfdp);
+    QuadPart("sr2 bit 7, sfdp", &part, sfdp_bit7, sizeof(sfdp_bit7));
+    spi_nor_part_default(&part, SPI_NOR_QE_SR2_WRSR);
+    BuildSfdp(1);
+    part.sfdp = g_sfdp;
+    part.sfdp_len = sizeof(g_sfdp);
+    QuadPart("sr2 0x01, sfdp", &part, sfdp_wrsr, sizeof(sfdp_wrsr));
+    spi_nor_part_default(&part, SPI_NOR_QE_NONE);
+    BuildSfdp(0);
+    part.sfdp = g_sfdp;
+    part.sfdp_len = sizeof(g_sfdp);
+    QuadPart("no qe, sfdp", &part, sfdp_none, sizeof(sfdp_none));
+}
+
+/* An ISSI-like part: QE in SR1 but no 0x35/0x31, and no SFDP to say so. The probe must not take the floating bus for QE. */
+static void TestQeNotSet(void)
+{
+    struct spi_nor_part part;
+
+    printf("qe not found\n");
+    spi_nor_part_default(&part, SPI_NOR_QE_SR1_BIT6);
+    part.jedec_id = 0x9D6014;
+    Open(&part);
+    CHECK(Init());
+    CHECK(spi_flash_mode_get() == SPI_FLASH_MODE_SINGLE);
+    CHECK((spi_nor_sr(1) & 0x40) == 0);
+    g_cmdCount = 0;
+    RoundTrip();
+    CHECK(g_quadReads == 0);
+    CheckClean();
+}
+#endif
+
+int main(void)
+{
+    struct spi_nor_part part;
+
+    spi_bus_fake_set_timer_handler(spi_flash_write_timer_expired);
+    spi_flash_write_timer_register(spi_bus_fake_timer_start);
+#if (SPI_FLASH_QUAD_ENABLE == 1)
+    TestQeTypes();
+    TestQeNotSet();
+#endif
+
+    /* Single-line mode: no QE write, IO2/IO3 stay WP#/HOLD# high, 0x03 and 0x02 only. */
+    printf("single\n");
+    spi_nor_part_default(&part, SPI_NOR_QE_SR2_WRSR1);
+    Open(&part);
+    CHECK(Init());
+    if (SPI_FLASH_QUAD_ENABLE == 0) {
+        CHECK(spi_flash_mode_get() == SPI_FLASH_MODE_SINGLE);
+        CHECK(spi_nor_sr(2) == 0);
+        g_cmdCount = 0;
+        RoundTrip();
+        CHECK(g_quadReads == 0);
+        CheckClean();
+    }
+    spi_nor_close();
+    return HostTestResult(SPI_FLASH_QUAD_ENABLE ? "spi_flash_quad" : "spi_flash_single");
+}
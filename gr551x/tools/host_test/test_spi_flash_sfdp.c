@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SFDP-driven capabilities of the external SPI flash driver against the SPI NOR model. The basic
+ * flash parameter tables are written by hand from the fields the vendors' datasheets give, not
+ * read out of parts: each part's size, address width, erase types and suspend commands must
+ * reach the read, write and erase paths. Parts above 16 MB go to 4-byte addresses where DWORD 16
+ * says how, on QSPI and SPIM, and are clamped to 16 MB where it does not; an empty erase table
+ * falls back to the 4 KB erase of DWORD 1 or fails the erase; a part without SFDP takes its size
+ * from the JEDEC ID. A read issued during a 64 KB erase gets the flash between suspend and resume
+ * where the part has them. The model must see no protocol violation anywhere.
+ */
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_test.h"
+#include "gr551x_spi_flash.h"
+#include "spi_bus_fake.h"
+#include "sfdp_fixture.h"
+
+#define MB                  0x100000
+#define AREA_SIZE           0x30000
+#define ERASE_OFS           0xF000
+#define ERASE_SIZE          0x12000
+#define DATA_OFS            0x100F0
+#define DATA_SIZE           1000
+#define ERASES_MAX          32
+#define READ_ADDR           0x80000
+#define READ_SIZE           256
+#define NS_PER_MS           1000000ULL
+#define HOLD_ERASE_US       20000
+
+/* DWORD 1 of a typical 3-byte part: 4 KB erase 0x20, 1-1-2, 1-2-2, 1-4-4 and 1-1-4 reads. */
+#define DW1_3B              0xFFF920E5
+#define DW1_3OR4B           0xFFFB20E5
+#define DW1_4B              0xFFFD20E5
+#define DW1_NO_4K           0xFFF920E7
+#define DW3_QUAD            0x6B08EB44      /* 0x6B 8 dummy, 0xEB 2 mode + 4 dummy */
+#define DW8_4K_32K          0x520F200C
+#define DW9_64K             0xFF00D810
+/* 4 KB 48 ms, 32 KB 128 ms, 64 KB 160 ms, in 16 ms units. */
+#define DW10_TIMES          0x00A53A22
+#define DW11_PAGE_256       0x00000081
+#define DW12_NO_SUSPEND     0x80000000
+#define DW13_75_7A          0x757A757A
+#define DW13_B0_30          0xB030B030
+#define DW15_QER(q)         ((uint32_t)(q) << 20)
+#define DW16_EN4B           0x01004000      /* enter with 0xB7, exit with 0xE9 */
+#define DW16_WREN_EN4B      0x02008000      /* the same, each after 0x06 */
+
+struct vendor {
+    const char              *name;
+    uint32_t                 jedec_id;
+    uint32_t                 size;
+    enum spi_nor_qe          qe;
+    enum spi_nor_addr        addr;
+    uint8_t                  suspend_cmd;
+    uint8_t                  resume_cmd;
+    struct sfdp_fixture_bfpt bfpt;
+    bool                     no_sfdp;
+    /* What the driver must make of it. */
+    uint32_t                 caps_size;
+    uint8_t                  addr_bytes;
+    spi_flash_addr4_enter_t  addr4_enter;
+    bool                     suspend;
+    uint8_t                  erases[ERASES_MAX];  /* instructions for ERASE_SIZE at ERASE_OFS */
+    uint32_t                 erase_count;
+};
+
+static const struct vendor g_vendors[] = {
+    {
+        .name = "W25Q32JV-like", .jedec_id = 0xEF4016, .size = 4 * MB, .qe = SPI_NOR_QE_SR2_WRSR1,
+        .bfpt = { .dwords = 16, .minor = 6, .dw = {
+            DW1_3B, 0x01FFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, DW8_4K_32K,
+            DW9_64K, DW10_TIMES, DW11_PAGE_256, 0, DW13_75_7A, 0, DW15_QER(4), 0 } },
+        .caps_size = 4 * MB, .addr_bytes = 3, .suspend = true,
+        .erases = { 0x20, 0xD8, 0x20 }, .erase_count = 3,
+    },
+    {
+        .name = "MX25L3233F-like", .jedec_id = 0xC22016, .size = 4 * MB, .qe = SPI_NOR_QE_SR1_BIT6,
+        .suspend_cmd = 0xB0, .resume_cmd = 0x30,
+        .bfpt = { .dwords = 16, .minor = 6, .dw = {
+            DW1_3B, 0x01FFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, DW8_4K_32K,
+            DW9_64K, DW10_TIMES, DW11_PAGE_256, 0, DW13_B0_30, 0, DW15_QER(2), 0 } },
+        .caps_size = 4 * MB, .addr_bytes = 3, .suspend = true,
+        .erases = { 0x20, 0xD8, 0x20 }, .erase_count = 3,
+    },
+    {
+        /* No 32 KB erase type. */
+        .name = "GD25Q32C-like", .jedec_id = 0xC84016, .size = 4 * MB, .qe = SPI_NOR_QE_SR2_WRSR1,
+        .bfpt = { .dwords = 16, .minor = 6, .dw = {
+            DW1_3B, 0x01FFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, 0xFF00200C,
+            DW9_64K, DW10_TIMES, DW11_PAGE_256, 0, DW13_75_7A, 0, DW15_QER(4), 0 } },
+        .caps_size = 4 * MB, .addr_bytes = 3, .suspend = true,
+        .erases = { 0x20, 0xD8, 0x20 }, .erase_count = 3,
+    },
+    {
+        /* A JESD216 table of 9 DWORDs: no suspend, no QER, the driver probes QE by manufacturer. */
+        .name = "IS25LP032-like", .jedec_id = 0x9D6016, .size = 4 * MB, .qe = SPI_NOR_QE_SR1_BIT6,
+        .bfpt = { .dwords = 9, .minor = 0, .dw = {
+            DW1_3B, 0x01FFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, DW8_4K_32K,
+            DW9_64K } },
+        .caps_size = 4 * MB, .addr_bytes = 3, .suspend = false,
+        .erases = { 0x20, 0xD8, 0x20 }, .erase_count = 3,
+    },
+    {
+        .name = "W25Q256JV-like", .jedec_id = 0xEF4019, .size = 32 * MB, .qe = SPI_NOR_QE_SR2_WRSR1,
+        .addr = SPI_NOR_ADDR_3_OR_4,
+        .bfpt = { .dwords = 16, .minor = 6, .dw = {
+            DW1_3OR4B, 0x0FFFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, DW8_4K_32K,
+            DW9_64K, DW10_TIMES, DW11_PAGE_256, 0, DW13_75_7A, 0, DW15_QER(4), DW16_EN4B } },
+        .caps_size = 32 * MB, .addr_bytes = 4, .addr4_enter = SPI_FLASH_ADDR4_ENTER_EN4B, .suspend = true,
+        .erases = { 0x20, 0xD8, 0x20 }, .erase_count = 3,
+    },
+    {
+        /* No QE bit, and 0x06 before 0xB7. */
+        .name = "MT25QL256-like", .jedec_id = 0x20BA19, .size = 32 * MB, .qe = SPI_NOR_QE_NONE,
+        .addr = SPI_NOR_ADDR_3_OR_4,
+        .bfpt = { .dwords = 16, .minor = 6, .dw = {
+            DW1_3OR4B, 0x0FFFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, DW8_4K_32K,
+            DW9_64K, DW10_TIMES, DW11_PAGE_256, 0, DW13_75_7A, 0, DW15_QER(0), DW16_WREN_EN4B } },
+        .caps_size = 32 * MB, .addr_bytes = 4, .addr4_enter = SPI_FLASH_ADDR4_ENTER_WREN_EN4B, .suspend = true,
+        .erases = { 0x20, 0xD8, 0x20 }, .erase_count = 3,
+    },
+    {
+        .name = "4-byte only", .jedec_id = 0xC84019, .size = 32 * MB, .qe = SPI_NOR_QE_SR2_WRSR1,
+        .addr = SPI_NOR_ADDR_4,
+        .bfpt = { .dwords = 16, .minor = 6, .dw = {
+            DW1_4B, 0x0FFFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, DW8_4K_32K,
+            DW9_64K, DW10_TIMES, DW11_PAGE_256, 0, DW13_75_7A, 0, DW15_QER(4), 0 } },
+        .caps_size = 32 * MB, .addr_bytes = 4, .suspend = true,
+        .erases = { 0x20, 0xD8, 0x20 }, .erase_count = 3,
+    },
+    {
+        /* 3 or 4 bytes, but a JESD216 table without DWORD 16 to say how to switch. */
+        .name = "32 MB, no DWORD 16", .jedec_id = 0xEF4019, .size = 32 * MB, .qe = SPI_NOR_QE_SR2_WRSR1,
+        .addr = SPI_NOR_ADDR_3_OR_4,
+        .bfpt = { .dwords = 9, .minor = 0, .dw = {
+            DW1_3OR4B, 0x0FFFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, DW8_4K_32K,
+            DW9_64K } },
+        .caps_size = 16 * MB, .addr_bytes = 3, .suspend = false,
+        .erases = { 0x20, 0xD8, 0x20 }, .erase_count = 3,
+    },
+    {
+        .name = "empty erase table, 4 KB in DWORD 1", .jedec_id = 0xC84016, .size = 4 * MB,
+        .qe = SPI_NOR_QE_SR2_WRSR1,
+        .bfpt = { .dwords = 16, .minor = 6, .dw = {
+            DW1_3B, 0x01FFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, 0, 0,
+            DW10_TIMES, DW11_PAGE_256, DW12_NO_SUSPEND, 0, 0, DW15_QER(4), 0 } },
+        .caps_size = 4 * MB, .addr_bytes = 3, .suspend = false,
+        .erases = { 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+                    0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20 }, .erase_count = 18,
+    },
+    {
+        .name = "empty erase table, no 4 KB", .jedec_id = 0xC84016, .size = 4 * MB, .qe = SPI_NOR_QE_SR2_WRSR1,
+        .bfpt = { .dwords = 16, .minor = 6, .dw = {
+            DW1_NO_4K, 0x01FFFFFF, DW3_QUAD, 0x3B08BB42, 0xFFFFFFEE, 0xFF00FFFF, 0xFF00FFFF, 0, 0,
+            DW10_TIMES, DW11_PAGE_256, DW12_NO_SUSPEND, 0, 0, DW15_QER(4), 0 } },
+        .caps_size = 4 * MB, .addr_bytes = 3, .suspend = false, .erase_count = 0,
+    },
+    {
+        .name = "no sfdp", .jedec_id = 0xC84016, .size = 4 * MB, .qe = SPI_NOR_QE_SR2_WRSR1, .no_sfdp = true,
+        .caps_size = 4 * MB, .addr_bytes = 3, .suspend = false,
+        .erases = { 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+                    0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20 }, .erase_count = 18,
+    },
+};
+
+static uint8_t g_sfdp[SFDP_FIXTURE_SIZE];
+static uint8_t g_erases[ERASES_MAX];
+static uint32_t g_eraseCount;
+static uint32_t g_en4b;
+static uint32_t g_wrenBeforeEn4b;
+static uint32_t g_suspends;
+static uint32_t g_resumes;
+static uint32_t g_badAddr;
+static uint8_t g_addrBits;
+static uint8_t g_lastCmd;
+static const struct vendor *g_vendor;
+static volatile bool g_eraseStarted;
+static bool g_holdErase;
+static uint64_t g_eraseStartNs;
+
+static bool IsErase(uint8_t cmd)
+{
+    return cmd == 0x20 || cmd == 0x52 || cmd == 0xD8;
+}
+
+/* Array accesses must carry the address width the part is in. */
+static bool IsArrayAccess(uint8_t cmd)
+{
+    return IsErase(cmd) || cmd == 0x02 || cmd == 0x32 || cmd == 0x03 || cmd == 0x6B || cmd == 0xEB;
+}
+
+static void Trace(const struct spi_nor_op *op)
+{
+    if (IsErase(op->cmd)) {
+        if (g_eraseCount < ERASES_MAX) {
+            g_erases[g_eraseCount] = op->cmd;
+        }
+        g_eraseCount++;
+        /* Keep the model clock still until the reader has queued up behind the erase. */
+        if (g_holdErase && !g_eraseStarted) {
+            g_eraseStartNs = spi_nor_now_ns();
+            g_eraseStarted = true;
+            usleep(HOLD_ERASE_US);
+        }
+    }
+    if (IsArrayAccess(op->cmd) && op->addr_bits != g_addrBits && !(op->cmd == 0xEB && op->addr_bits == 32)) {
+        g_badAddr++;
+    }
+    if (op->cmd == 0xB7) {
+        g_en4b++;
+        g_wrenBeforeEn4b += (g_lastCmd == 0x06);
+    }
+    if (op->cmd == g_vendor->suspend_cmd || (g_vendor->suspend_cmd == 0 && op->cmd == 0x75)) {
+        g_suspends++;
+    }
+    if (op->cmd == g_vendor->resume_cmd || (g_vendor->resume_cmd == 0 && op->cmd == 0x7A)) {
+        g_resumes++;
+    }
+    g_lastCmd = op->cmd;
+}
+
+static void ClearTrace(void)
+{
+    g_eraseCount = 0;
+    g_en4b = 0;
+    g_wrenBeforeEn4b = 0;
+    g_suspends = 0;
+    g_resumes = 0;
+    g_badAddr = 0;
+    g_eraseStarted = false;
+}
+
+static bool Init(spi_type_t type)
+{
+    flash_init_t init = {
+        .spi_type = type,
+        .flash_io = {
+            .spi_cs  = { APP_IO_TYPE_NORMAL, APP_IO_PIN_15, APP_IO_MUX_2 },
+            .spi_clk = { APP_IO_TYPE_NORMAL, APP_IO_PIN_9, APP_IO_MUX_2 },
+            .spi_io0 = { .qspi_io0 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_8, APP_IO_MUX_2 } },
+            .spi_io1 = { .qspi_io1 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_14, APP_IO_MUX_2 } },
+            .qspi_io2 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_13, APP_IO_MUX_2 },
+            .qspi_io3 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_12, APP_IO_MUX_2 },
+        },
+    };
+    bool ret = spi_flash_init(&init);
+
+    spi_bus_fake_idle();
+    return ret;
+}
+
+static void Open(const struct vendor *v)
+{
+    struct spi_nor_part part;
+
+    spi_nor_part_default(&part, v->qe);
+    part.jedec_id = v->jedec_id;
+    part.size = v->size;
+    part.addr = v->addr;
+    if (v->suspend_cmd != 0) {
+        part.suspend_cmd = v->suspend_cmd;
+        part.resume_cmd = v->resume_cmd;
+    }
+    if (!v->no_sfdp) {
+        part.sfdp = g_sfdp;
+        part.sfdp_len = sfdp_fixture_build(g_sfdp, &v->bfpt);
+    }
+    g_vendor = v;
+    CHECK(spi_nor_open(&part) == 0);
+    spi_bus_fake_reset();
+    spi_nor_set_trace(Trace);
+    ClearTrace();
+}
+
+static void CheckClean(void)
+{
+    struct spi_nor_stats st;
+    struct spi_bus_fake_stats bus;
+
+    spi_nor_get_stats(&st);
+    spi_bus_fake_get_stats(&bus);
+    if (st.violations != 0) {
+        printf("violation: %s\n", st.reason);
+    }
+    CHECK(st.violations == 0);
+    CHECK(bus.busy == 0 && bus.stray_hal == 0);
+    CHECK(g_badAddr == 0);
+}
+
+static void CheckCaps(const struct vendor *v)
+{
+    const spi_flash_caps_t *caps = spi_flash_caps_get();
+    uint32_t id;
+    uint32_t size;
+
+    CHECK(caps->sfdp == !v->no_sfdp);
+    CHECK(caps->size == v->caps_size);
+    CHECK(caps->addr_bytes == v->addr_bytes);
+    CHECK(caps->addr4_enter == v->addr4_enter);
+    CHECK(caps->suspend == v->suspend);
+    if (v->suspend) {
+        CHECK(caps->suspend_cmd == (v->suspend_cmd ? v->suspend_cmd : 0x75));
+        CHECK(caps->resume_cmd == (v->resume_cmd ? v->resume_cmd : 0x7A));
+    }
+    spi_flash_device_info(&id, &size);
+    CHECK(id == v->jedec_id && size == v->caps_size);
+    CHECK(g_en4b == (v->addr4_enter != SPI_FLASH_ADDR4_ENTER_NONE));
+    CHECK(g_wrenBeforeEn4b == (v->addr4_enter == SPI_FLASH_ADDR4_ENTER_WREN_EN4B));
+}
+
+/* Erase ERASE_SIZE at ERASE_OFS inside a zeroed area, then write and read back across pages. */
+static void EraseWriteRead(const struct vendor *v, uint32_t base)
+{
+    static uint8_t data[DATA_SIZE];
+    static uint8_t rd[DATA_SIZE];
+    uint8_t *img = spi_nor_image() + base;
+
+    memset(img, 0, AREA_SIZE);
+    g_eraseCount = 0;
+    CHECK(spi_flash_sector_erase(base + ERASE_OFS, ERASE_SIZE) == (v->erase_count != 0));
+    CHECK(g_eraseCount == v->erase_count && memcmp(g_erases, v->erases, v->erase_count) == 0);
+    if (v->erase_count == 0) {
+        CHECK(img[ERASE_OFS] == 0);
+        return;
+    }
+    CHECK(img[ERASE_OFS - 1] == 0 && img[ERASE_OFS] == 0xFF);
+    CHECK(img[ERASE_OFS + ERASE_SIZE - 1] == 0xFF && img[ERASE_OFS + ERASE_SIZE] == 0);
+
+    for (uint32_t i = 0; i < DATA_SIZE; i++) {
+        data[i] = (uint8_t)(i * 29 + 5);
+    }
+    CHECK(spi_flash_write(base + DATA_OFS, data, DATA_SIZE) == DATA_SIZE);
+    CHECK(memcmp(img + DATA_OFS, data, DATA_SIZE) == 0);
+    memset(rd, 0, sizeof(rd));
+    CHECK(spi_flash_read(base + DATA_OFS, rd, DATA_SIZE) == DATA_SIZE);
+    CHECK(memcmp(rd, data, DATA_SIZE) == 0);
+}
+
+static void TestVendor(const struct vendor *v, spi_type_t type)
+{
+    /* Above 16 MB where the driver can address it, so that a 3-byte address would miss. */
+    uint32_t base = (v->caps_size > 16 * MB) ? 16 * MB + 0x20000 : 0x20000;
+
+    printf("%s%s\n", v->name, (type == FLASH_SPIM_ID) ? ", spim" : "");
+    Open(v);
+    g_addrBits = (v->addr == SPI_NOR_ADDR_4) ? 32 : 24;
+    if (v->addr4_enter != SPI_FLASH_ADDR4_ENTER_NONE) {
+        g_addrBits = 32;
+    }
+    CHECK(Init(type));
+    CheckCaps(v);
+    EraseWriteRead(v, base);
+    CheckClean();
+
+    /* The reset leaves 4-byte mode and the driver enters it again. */
+    ClearTrace();
+    spi_flash_chip_reset();
+    CHECK(g_en4b == (v->addr4_enter != SPI_FLASH_ADDR4_ENTER_NONE));
+    EraseWriteRead(v, base);
+    CheckClean();
+    spi_nor_close();
+}
+
+static void *Eraser(void *arg)
+{
+    CHECK(spi_flash_sector_erase(0, SPI_FLASH_BLOCK_SIZE));
+    return NULL;
+}
+
+/* Model time from the start of a 64 KB erase until a read issued with it returns. */
+static uint64_t ReadDuringErase(const struct vendor *v)
+{
+    static uint8_t rd[READ_SIZE];
+    pthread_t eraser;
+    uint64_t waited;
+
+    Open(v);
+    g_addrBits = 24;
+    CHECK(Init(FLASH_QSPI_ID1));
+    for (uint32_t i = 0; i < READ_SIZE; i++) {
+        spi_nor_image()[READ_ADDR + i] = (uint8_t)(i + 1);
+    }
+    ClearTrace();
+    g_holdErase = true;
+    CHECK(pthread_create(&eraser, NULL, Eraser, NULL) == 0);
+    while (!g_eraseStarted) {
+        usleep(100);
+    }
+    CHECK(spi_flash_read(READ_ADDR, rd, READ_SIZE) == READ_SIZE);
+    waited = spi_nor_now_ns() - g_eraseStartNs;
+    CHECK(pthread_join(eraser, NULL) == 0);
+    g_holdErase = false;
+    spi_bus_fake_idle();
+
+    for (uint32_t i = 0; i < READ_SIZE; i++) {
+        CHECK(rd[i] == (uint8_t)(i + 1));
+    }
+    for (uint32_t i = 0; i < SPI_FLASH_BLOCK_SIZE; i++) {
+        CHECK(spi_nor_image()[i] == 0xFF);
+    }
+    CHECK(!spi_nor_busy());
+    CHECK(g_suspends == g_resumes && (g_suspends != 0) == v->suspend);
+    CheckClean();
+    spi_nor_close();
+    printf("%s: read issued with a 64 KB erase returned after %.3f ms, %u suspends\n", v->name,
+           (double)waited / NS_PER_MS, (unsigned)g_suspends);
+    return waited;
+}
+
+int main(void)
+{
+    spi_bus_fake_set_timer_handler(spi_flash_write_timer_expired);
+    spi_flash_write_timer_register(spi_bus_fake_timer_start);
+
+    for (uint32_t i = 0; i < sizeof(g_vendors) / sizeof(g_vendors[0]); i++) {
+        TestVendor(&g_vendors[i], FLASH_QSPI_ID1);
+    }
+    /* SPIM sends the 4-byte addresses in its command frames. */
+    TestVendor(&g_vendors[4], FLASH_SPIM_ID);
+    TestVendor(&g_vendors[6], FLASH_SPIM_ID);
+
+    /* W25Q32JV-like and MX25L3233F-like suspend, the 9-DWORD table has no suspend to use. */
+    CHECK(ReadDuringErase(&g_vendors[0]) < NS_PER_MS);
+    CHECK(ReadDuringErase(&g_vendors[1]) < NS_PER_MS);
+    CHECK(ReadDuringErase(&g_vendors[3]) > 100 * NS_PER_MS);
+
+    return HostTestResult("spi_flash_sfdp");
+}
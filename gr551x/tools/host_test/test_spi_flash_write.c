@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2021 GOODIX.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The pipelined writer of the external SPI flash driver against the SPI NOR model: a read issued
+ * while spi_flash_write_async owns the flash waits for it rather than interleaving, interrupt
+ * context is refused instead of waiting, a transfer error ends a write with the part idle and the
+ * flash free again, and chip reset goes through the controller app_qspi set up.
+ */
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_test.h"
+#include "gr551x_spi_flash.h"
+#include "spi_bus_fake.h"
+
+#define AREA_ADDR           0x20000
+#define AREA_SIZE           0x2000
+#define OTHER_ADDR          0x40000
+#define OTHER_SIZE          0x400
+#define HOLD_OFF_US         20000
+
+static uint8_t g_data[AREA_SIZE];
+static uint8_t g_other[OTHER_SIZE];
+static volatile bool g_hold;
+static volatile uint32_t g_heldDelay;
+static volatile bool g_written;
+static volatile uint32_t g_writtenBytes;
+static volatile bool g_readDone;
+static volatile bool g_readAfterWrite;
+static uint32_t g_resetCmds;
+
+/* Timer for the writer that can be stopped, leaving it waiting for a status poll with the flash held. */
+static void HeldTimerStart(uint32_t delay_us)
+{
+    if (g_hold) {
+        g_heldDelay = delay_us;
+        return;
+    }
+    spi_bus_fake_timer_start(delay_us);
+}
+
+static void Release(void)
+{
+    g_hold = false;
+    spi_bus_fake_timer_start(g_heldDelay);
+}
+
+static void WriteDone(uint32_t written, void *p_arg)
+{
+    CHECK(__get_IPSR() != 0);
+    g_writtenBytes = written;
+    g_written = true;
+}
+
+static void *Reader(void *arg)
+{
+    static uint8_t buf[OTHER_SIZE];
+
+    CHECK(spi_flash_read(OTHER_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(memcmp(buf, g_other, sizeof(buf)) == 0);
+    g_readAfterWrite = g_written;
+    g_readDone = true;
+    return NULL;
+}
+
+static void Trace(const struct spi_nor_op *op)
+{
+    if (op->cmd == 0x66 || op->cmd == 0x99) {
+        g_resetCmds++;
+    }
+}
+
+static void Setup(void)
+{
+    struct spi_nor_part part;
+    flash_init_t init = {
+        .spi_type = FLASH_QSPI_ID1,
+        .flash_io = {
+            .spi_cs  = { APP_IO_TYPE_NORMAL, APP_IO_PIN_15, APP_IO_MUX_2 },
+            .spi_clk = { APP_IO_TYPE_NORMAL, APP_IO_PIN_9, APP_IO_MUX_2 },
+            .spi_io0 = { .qspi_io0 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_8, APP_IO_MUX_2 } },
+            .spi_io1 = { .qspi_io1 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_14, APP_IO_MUX_2 } },
+            .qspi_io2 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_13, APP_IO_MUX_2 },
+            .qspi_io3 = { APP_IO_TYPE_NORMAL, APP_IO_PIN_12, APP_IO_MUX_2 },
+        },
+    };
+
+    spi_nor_part_default(&part, SPI_NOR_QE_SR2_WRSR1);
+    CHECK(spi_nor_open(&part) == 0);
+    spi_nor_set_trace(Trace);
+    spi_bus_fake_reset();
+    spi_bus_fake_set_timer_handler(spi_flash_write_timer_expired);
+    spi_flash_write_timer_register(HeldTimerStart);
+    for (uint32_t i = 0; i < AREA_SIZE; i++) {
+        g_data[i] = (uint8_t)(i * 7 + 3);
+    }
+    for (uint32_t i = 0; i < OTHER_SIZE; i++) {
+        g_other[i] = (uint8_t)(i ^ 0xA5);
+        spi_nor_image()[OTHER_ADDR + i] = g_other[i];
+    }
+
+    CHECK(!spi_flash_init(NULL));
+    init.spi_type = FLASH_SPI_ID_MAX;
+    CHECK(!spi_flash_init(&init));
+    init.spi_type = FLASH_QSPI_ID1;
+    CHECK(spi_flash_init(&init));
+    spi_bus_fake_idle();
+}
+
+static void TestReadWaitsForWrite(void)
+{
+    struct spi_bus_fake_stats bus;
+    pthread_t reader;
+
+    g_hold = true;
+    g_written = false;
+    g_readDone = false;
+    CHECK(spi_flash_write_async(AREA_ADDR, g_data, AREA_SIZE, WriteDone, NULL));
+    CHECK(spi_flash_write_busy());
+
+    /* The writer sits between status polls: the reader must not get onto the bus. */
+    CHECK(pthread_create(&reader, NULL, Reader, NULL) == 0);
+    usleep(HOLD_OFF_US);
+    CHECK(!g_readDone && !g_written);
+
+    /* Interrupt handlers cannot wait for it and are refused. */
+    HostIsrEnter();
+    CHECK(spi_flash_read(OTHER_ADDR, g_other, 1) == 0);
+    CHECK(spi_flash_device_id() == 0);
+    CHECK(!spi_flash_write_async(AREA_ADDR, g_data, 1, NULL, NULL));
+    CHECK(spi_flash_write(AREA_ADDR, g_data, 1) == 0);
+    HostIsrExit();
+
+    Release();
+    CHECK(pthread_join(reader, NULL) == 0);
+    CHECK(g_readDone && g_readAfterWrite);
+    CHECK(g_writtenBytes == AREA_SIZE && !spi_flash_write_busy());
+    CHECK(memcmp(spi_nor_image() + AREA_ADDR, g_data, AREA_SIZE) == 0);
+
+    spi_bus_fake_get_stats(&bus);
+    CHECK(bus.busy == 0);
+}
+
+static void TestErrorEndsWrite(void)
+{
+    uint8_t buf[16];
+    struct spi_nor_stats st;
+
+    CHECK(spi_flash_sector_erase(AREA_ADDR, AREA_SIZE));
+
+    /* A transfer fails a few pages in. */
+    spi_bus_fake_idle();
+    spi_bus_fake_fail(12);
+    g_written = false;
+    CHECK(spi_flash_write_async(AREA_ADDR, g_data, AREA_SIZE, WriteDone, NULL));
+    spi_bus_fake_idle();
+    CHECK(g_written && g_writtenBytes > 0 && g_writtenBytes < AREA_SIZE);
+    CHECK((g_writtenBytes % SPI_FLASH_PAGE_SIZE) == 0);
+    CHECK(!spi_flash_write_busy() && !spi_nor_busy());
+
+    /* The blocking write reports the failure, and the flash is usable afterwards. */
+    CHECK(spi_flash_sector_erase(AREA_ADDR, AREA_SIZE));
+    spi_bus_fake_fail(1);
+    CHECK(spi_flash_write(AREA_ADDR, g_data, AREA_SIZE) == 0);
+    CHECK(spi_flash_read(AREA_ADDR, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(spi_flash_sector_erase(AREA_ADDR, AREA_SIZE));
+    CHECK(spi_flash_write(AREA_ADDR, g_data, AREA_SIZE) == AREA_SIZE);
+    CHECK(memcmp(spi_nor_image() + AREA_ADDR, g_data, AREA_SIZE) == 0);
+
+    spi_nor_get_stats(&st);
+    CHECK(st.violations == 0);
+}
+
+static void TestChipReset(void)
+{
+    struct spi_bus_fake_stats bus;
+
+    g_resetCmds = 0;
+    spi_flash_chip_reset();
+    spi_bus_fake_get_stats(&bus);
+    CHECK(bus.stray_hal == 0 && g_resetCmds == 2);
+    CHECK(spi_flash_device_id() == 0xC84014);
+}
+
+int main(void)
+{
+    struct spi_nor_stats st;
+
+    Setup();
+    TestReadWaitsForWrite();
+    TestErrorEndsWrite();
+    TestChipReset();
+
+    spi_nor_get_stats(&st);
+    CHECK(st.violations == 0);
+    spi_nor_close();
+    return HostTestResult("spi_flash_write");
+}